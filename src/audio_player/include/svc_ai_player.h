@@ -57,6 +57,27 @@ extern "C" {
 #define AI_PLAYER_HTTP_TIMEOUT_S (180)
 #endif
 
+#ifndef AI_PLAYER_HTTP_STACK_SIZE
+#define AI_PLAYER_HTTP_STACK_SIZE (5120)
+#endif
+
+#ifndef AI_PLAYER_HTTP_PREFETCH_SIZE
+#define AI_PLAYER_HTTP_PREFETCH_SIZE (16 * 1024)
+#endif
+
+/** url prefetch watermarks, percent of AI_PLAYER_HTTP_PREFETCH_SIZE */
+#ifndef AI_PLAYER_HTTP_HIGH_WATERMARK
+#define AI_PLAYER_HTTP_HIGH_WATERMARK (90)
+#endif
+
+#ifndef AI_PLAYER_HTTP_LOW_WATERMARK
+#define AI_PLAYER_HTTP_LOW_WATERMARK (50)
+#endif
+
+#ifndef AI_PLAYER_HTTP_START_WATERMARK
+#define AI_PLAYER_HTTP_START_WATERMARK (12)
+#endif
+
 /** Feature definition (ROM usage) */
 #define AI_PLAYER_DATASINK_URL  (0x1)
 #define AI_PLAYER_DATASINK_FILE (0x2)
@@ -238,6 +259,44 @@ typedef struct {
     OPERATE_RET (*set_volume)(PLAYER_CONSUMER_HANDLE handle, uint32_t volume);
 } AI_PLAYER_CONSUMER_T;
 
+/**
+ * @brief Player pipeline stages
+ */
+typedef enum {
+    AI_PLAYER_STAGE_SINK = 0,  // datasink read
+    AI_PLAYER_STAGE_DECODE,
+    AI_PLAYER_STAGE_RESAMPLE,
+    AI_PLAYER_STAGE_MIX,       // digital volume and mixing
+    AI_PLAYER_STAGE_OUTPUT,    // consumer write
+    AI_PLAYER_STAGE_MAX
+} AI_PLAYER_STAGE_E;
+
+typedef struct {
+    uint32_t time_ms;     // time spent in the stage
+    uint32_t max_ms;      // longest single run of the stage
+    uint32_t bytes;       // bytes produced by the stage
+    uint32_t copy_bytes;  // bytes copied between buffers by the stage
+} AI_PLAYER_STAGE_STAT_T;
+
+/**
+ * @brief Datasink buffer statistics, only the url datasink keeps them
+ */
+typedef struct {
+    uint32_t buffered;       // bytes prefetched and not read yet
+    uint32_t underrun_cnt;   // times the buffer ran dry during playback
+    uint32_t rebuffer_ms;    // time spent refilling after underruns
+    uint32_t reconnect_cnt;  // resumed after the connection dropped or stalled
+} AI_PLAYER_SINK_STAT_T;
+
+/**
+ * @brief Player pipeline statistics, reset on every start
+ */
+typedef struct {
+    uint32_t first_audio_ms;  // from start to the first pcm handed to the consumer, 0 until then
+    AI_PLAYER_STAGE_STAT_T stage[AI_PLAYER_STAGE_MAX];
+    AI_PLAYER_SINK_STAT_T sink;
+} AI_PLAYER_STAT_T;
+
 /**
  * @brief AI player configuration structure.
  *
@@ -365,6 +424,16 @@ OPERATE_RET tuya_ai_player_resume(AI_PLAYER_HANDLE handle);
  */
 AI_PLAYER_STATE_T tuya_ai_player_get_state(AI_PLAYER_HANDLE handle);
 
+/**
+ * @brief Get the pipeline statistics of the player since its last start
+ *
+ * @param[in]  handle  Handle of the player instance
+ * @param[out] stat    Time to first audio, per stage time and byte counters and datasink buffering
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tuya_ai_player_get_stat(AI_PLAYER_HANDLE handle, AI_PLAYER_STAT_T *stat);
+
 /**
  * @brief Get the current audio codec of the player
  *
@@ -479,6 +548,8 @@ typedef struct {
     bool auto_play;   /** Whether playback should start automatically after adding the first item */
     uint32_t interval;    /** Interval (in ms) to wait before automatically switching to the next item */
     uint32_t capacity;    /** Maximum number of items that the playlist can hold */
+    uint32_t lookahead;   /** Bytes of decoded pcm kept ready for the next item while the current one plays, 0 disables look-ahead */
+    uint32_t crossfade_ms; /** Crossfade between items with look-ahead, capped by the pcm ring and the look-ahead, 0 for a gapless transition */
 } AI_PLAYLIST_CFG_T;
 
 /**
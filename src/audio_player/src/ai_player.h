@@ -24,6 +24,8 @@
 #include "./decoder/ai_player_decoder.h"
 #include "./datasink/ai_player_datasink.h"
 #include "./resample/ai_player_resample.h"
+#include "./mixer/mixer_fixed.h"
+#include "./mixer/pcm_ring.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -33,6 +35,10 @@ extern "C" {
 #define PLAYER_BUSY_TIMEOUT_MS  1
 #define PLAYER_MAX_VOLUME     100
 
+// contiguous pcm a decoder may write at once, one stereo mp3 frame
+#define PLAYER_PCM_RESERVE_MIN  ((AI_PLAYER_DECODEBUF_SIZE < 4608) ? AI_PLAYER_DECODEBUF_SIZE : 4608)
+#define PLAYER_RAW_RESERVE_MIN  256
+
 typedef enum {
     PLAYER_CMD_START = 0,
     PLAYER_CMD_STOP,
@@ -40,6 +46,7 @@ typedef enum {
     PLAYER_CMD_RESUME,
     PLAYER_CMD_EXIT,
     PLAYER_CMD_SERVICE_DEINIT,
+    PLAYER_CMD_PRELOAD,
     PLAYER_CMD_MAX
 } AI_PLAYER_CMD_E;
 
@@ -51,26 +58,63 @@ typedef struct {
             AI_PLAYER_SRC_E src;
             char *value;
             AI_AUDIO_CODEC_E codec;
-        } cmd_start;
+        } cmd_start; // also PLAYER_CMD_PRELOAD
     } param;
 } AI_PLAYER_MSG_T;
 
+// item preloaded by the playlist, it takes over the player at eof of the current one
+typedef struct {
+    bool armed;               // sink and decoder started for the next item
+    bool current;             // pcm left in the buffer belongs to the playing item since the switch
+    bool eof;
+    bool has_pending_output;
+    PLAYER_DATASINK sink;
+    PLAYER_DECODER decoder;
+    uint8_t *framebuf;
+    uint32_t offset;
+    uint8_t *pcm;             // head of the item decoded ahead, decoder output format
+    uint32_t pcm_size;        // look-ahead budget, 0 disables preloading
+    uint32_t pcm_len;
+    uint32_t pcm_rd;
+    DECODER_OUTPUT_T fmt;
+    uint32_t crossfade_ms;    // 0 for a gapless switch
+} AI_PLAYER_NEXT_T;
+
 typedef struct {
     AI_PLAYER_STATE_T state;
     AI_PLAYER_MODE_E  mode;
     PLAYER_DATASINK sink;
     PLAYER_DECODER decoder;
+    PLAYER_RESAMPLE resample;
     uint8_t *framebuf;
     uint32_t offset;
-    uint8_t *decode_buf;
-    uint32_t decode_size;
+    PCM_RING_T *pcm;          // decoded pcm, mixed and played in place
+    uint8_t *decode_buf;      // decoder output of a resampled stream, NULL until needed
+    bool resample_on;
+    DECODER_OUTPUT_T resample_fmt;
     int volume;
+    AI_MIXER_GAIN_T gain; // digital volume, ramped on the player thread
     bool mute;
     bool has_pending_output;  // TRUE: decoder has pending data, skip reading new input
+    AI_PLAYER_STAT_T stat;
+    SYS_TIME_T start_ms;
+    bool first_audio;
+    AI_PLAYER_NEXT_T next;
+    bool hold_release;        // the ring ran full while keeping a crossfade tail, play some of it
+    AI_MIXER_GAIN_T fade_out; // tail of the current item while crossfading
+    AI_MIXER_GAIN_T fade_in;  // head of the preloaded item while crossfading
     AI_PLAYLIST_HANDLE playlist;
+    // AI_PLAYER_STOPPED when an item ended, AI_PLAYER_PLAYING when the preloaded item took over
     void (*playlist_cb)(AI_PLAYLIST_HANDLE playlist, AI_PLAYER_STATE_T state);
 } AI_PLAYER_T;
 
+/**
+ * @brief open and decode an item ahead while the player keeps playing, it takes over at eof
+ *
+ * @note needs next.pcm_size, a later start or stop drops the preloaded item, so does a NULL value
+ */
+OPERATE_RET ai_player_preload(AI_PLAYER_HANDLE handle, AI_PLAYER_SRC_E src, char *value, AI_AUDIO_CODEC_E codec);
+
 extern AI_PLAYER_CONSUMER_T g_consumer_speaker;
 
 #ifdef __cplusplus
@@ -160,4 +160,20 @@ OPERATE_RET ai_player_datasink_read(PLAYER_DATASINK handle, uint8_t *buf, uint32
     }
 
     return ctx->sink->read(ctx->priv, buf, len, out_len);
-}
\ No newline at end of file
+}
+
+OPERATE_RET ai_player_datasink_get_stat(PLAYER_DATASINK handle, AI_PLAYER_SINK_STAT_T *stat)
+{
+    DATASINK_CTX_T *ctx = (DATASINK_CTX_T *)handle;
+
+    if (ctx == NULL || stat == NULL) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if(ctx->sink && ctx->sink->stat && ctx->priv) {
+        return ctx->sink->stat(ctx->priv, stat);
+    }
+
+    memset(stat, 0, sizeof(AI_PLAYER_SINK_STAT_T));
+    return OPRT_OK;
+}
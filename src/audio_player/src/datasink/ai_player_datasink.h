@@ -34,6 +34,7 @@ OPERATE_RET ai_player_datasink_start(PLAYER_DATASINK handle, AI_PLAYER_SRC_E src
 OPERATE_RET ai_player_datasink_stop(PLAYER_DATASINK handle);
 OPERATE_RET ai_player_datasink_read(PLAYER_DATASINK handle, uint8_t *buf, uint32_t len, uint32_t *out_len); // OPRT_NOT_FOUND -- eof
 OPERATE_RET ai_player_datasink_feed(PLAYER_DATASINK handle, uint8_t *data, uint32_t len);
+OPERATE_RET ai_player_datasink_get_stat(PLAYER_DATASINK handle, AI_PLAYER_SINK_STAT_T *stat); // zeroed if the sink keeps none
 
 #ifdef __cplusplus
 }
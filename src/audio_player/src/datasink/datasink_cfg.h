@@ -33,6 +33,7 @@ typedef struct {
     OPERATE_RET (*exit)(void* handle);
     OPERATE_RET (*feed)(void* handle, uint8_t *data, uint32_t len);
     OPERATE_RET (*read)(void* handle, uint8_t *data, uint32_t len, uint32_t *out_len);
+    OPERATE_RET (*stat)(void* handle, AI_PLAYER_SINK_STAT_T *stat);
 } DATASINK_T;
 
 #ifdef __cplusplus
@@ -128,4 +128,5 @@ DATASINK_T g_datasink_file = {
     .exit  = datasink_file_exit,
     .feed  = NULL,
     .read  = datasink_file_read,
+    .stat  = NULL,
 };
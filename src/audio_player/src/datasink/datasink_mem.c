@@ -159,4 +159,5 @@ DATASINK_T g_datasink_mem = {
     .exit  = datasink_mem_exit,
     .feed  = datasink_mem_feed,
     .read  = datasink_mem_read,
+    .stat  = NULL,
 };
@@ -1,6 +1,6 @@
 /**
  * @file datasink_url.c
- * @brief 
+ * @brief url datasink with a prefetch buffer filled by its own fetch thread
  * @version 0.1
  * @date 2025-09-23
  * 
@@ -20,141 +20,414 @@
 #include "tal_api.h"
 #include "http_session.h"
 #include "mix_method.h"
+#include "tuya_ringbuf.h"
 #include "datasink_cfg.h"
 
+#define URLSINK_CHUNK_SIZE      (1024)
+#define URLSINK_RECV_TIMEOUT_MS (100)
+#define URLSINK_STALL_MS        (5 * 1000) // no data for this long, drop the connection and resume
+#define URLSINK_IDLE_WAIT_MS    (1000)
+#define URLSINK_REDIRECT_MAX    (5)
+#define URLSINK_BACKOFF_MIN_MS  (200)
+#define URLSINK_BACKOFF_MAX_MS  (3200)
+
+#define URLSINK_MARK(pct) ((uint32_t)((uint64_t)AI_PLAYER_HTTP_PREFETCH_SIZE * (pct) / 100))
+#define URLSINK_HIGH_MARK  URLSINK_MARK(AI_PLAYER_HTTP_HIGH_WATERMARK)
+#define URLSINK_LOW_MARK   URLSINK_MARK(AI_PLAYER_HTTP_LOW_WATERMARK)
+#define URLSINK_START_MARK URLSINK_MARK(AI_PLAYER_HTTP_START_WATERMARK)
+
 typedef enum {
     URLSINK_STATUS_INIT,
     URLSINK_STATUS_CONNECT,
     URLSINK_STATUS_RECV,
-    URLSINK_STATUS_EXIT
+    URLSINK_STATUS_DONE,  // all data fetched
+    URLSINK_STATUS_EXIT   // gave up, reported once the buffer is drained
 } URLSINK_STATUS_T;
 
 typedef struct {
-    http_session_t session;
-    URLSINK_STATUS_T status;
     uint32_t length;
-    uint32_t offset;
     bool chunked;
-    bool eof;
+    bool partial;  // 206, the server honoured the range
+} URLSINK_RESP_T;
+
+/*
+ * A fetch thread per sink keeps the prefetch buffer between the low and
+ * high watermark, the player thread only copies out of the buffer. After
+ * running dry the reader waits for start_mark bytes again, start_mark is
+ * doubled on every underrun up to the high watermark.
+ */
+typedef struct {
+    // owned by the fetch thread
+    THREAD_HANDLE thread;
+    http_session_t session;
+    uint8_t *chunk;
+    uint32_t backoff_ms;
+    SYS_TIME_T last_rx_ms;
+
+    // shared with the player thread, protected by mutex
+    MUTEX_HANDLE mutex;
+    SEM_HANDLE wakeup;
+    TUYA_RINGBUFF_T ringbuf;
+    uint32_t gen;         // bumped by start and stop, the fetch thread drops the session of an older one
+    URLSINK_STATUS_T status;
     char *url;
+    uint32_t length;      // 0 if unknown
+    uint32_t offset;      // bytes fetched
+    uint32_t skip;        // bytes to drop when the server ignored the range
+    bool chunked;
+    bool paused;          // fetch resumes below the low watermark
+    bool buffering;
+    bool played;
+    bool running;
+    uint32_t start_mark;
+    SYS_TIME_T buffering_ms;
     TIME_T download_start_s;
+    AI_PLAYER_SINK_STAT_T stat;
 } URL_DATASINK_CTX_T;
 
-static void __http_connect(void *data)
+static void __http_close(URL_DATASINK_CTX_T *ctx)
 {
-    URL_DATASINK_CTX_T *ctx = (URL_DATASINK_CTX_T *)data;
-    if(!ctx || (ctx->status == URLSINK_STATUS_INIT)) {
-        return;
+    if(ctx->session) {
+        http_close_session(&ctx->session);
+        ctx->session = NULL;
     }
+}
 
+// OPRT_NOT_FOUND if the server refused the request, it is not retried
+static OPERATE_RET __http_connect(URL_DATASINK_CTX_T *ctx, char **url, uint32_t offset, uint32_t length, URLSINK_RESP_T *resp)
+{
     OPERATE_RET rt = OPRT_OK;
     http_resp_t *response = NULL;
-    http_req_t request = {
-        .type        = HTTP_GET,
-        .version     = HTTP_VER_1_1
-    };
+    http_req_t request = {0};
     uint32_t field_flags = (HTTP_REQUEST_KEEP_ALIVE_FLAG);
-    if(ctx->offset > 0) {
-        request.download_offset = ctx->offset;
-        request.download_size = ctx->length;
-        PR_DEBUG("url sink resume from %d length %d", ctx->offset, ctx->length);
+    uint8_t redirect = 0;
+    char *location = NULL;
+
+    for(;;) {
+        memset(&request, 0, sizeof(http_req_t));
+        request.type    = HTTP_GET;
+        request.version = HTTP_VER_1_1;
+        if(offset > 0) {
+            request.download_offset = offset;
+            request.download_size = (length > offset) ? (length - offset) : 0;
+        }
+
+        TUYA_CALL_ERR_GOTO(http_open_session(&ctx->session, *url, 0), ERR_EXIT);
+        TUYA_CALL_ERR_GOTO(http_send_request(ctx->session, &request, field_flags), ERR_EXIT);
+        TUYA_CALL_ERR_GOTO(http_get_response_hdr(ctx->session, &response), ERR_EXIT);
+
+        if((response->status_code == 200) || (response->status_code == 206)) {
+            break;
+        }
+
+        if(!HTTP_RESP_REDIR(response->status_code) || (NULL == response->location) || (++redirect > URLSINK_REDIRECT_MAX)) {
+            PR_ERR("url sink err status_code: %d", response->status_code);
+            rt = (response->status_code >= 500) ? OPRT_COM_ERROR : OPRT_NOT_FOUND;
+            goto ERR_EXIT;
+        }
+
+        PR_DEBUG("url sink redirect to %s", response->location);
+        location = mm_strdup(response->location);
+        if(NULL == location) {
+            rt = OPRT_MALLOC_FAILED;
+            goto ERR_EXIT;
+        }
+        Free(*url);
+        *url = location;
+
+        http_free_response_hdr(&response);
+        __http_close(ctx);
     }
 
+    resp->length  = response->content_length;
+    resp->chunked = response->chunked;
+    resp->partial = (response->status_code == 206);
+    http_free_response_hdr(&response);
+    http_set_timeout(ctx->session, URLSINK_RECV_TIMEOUT_MS);
 
-    TUYA_CALL_ERR_GOTO(http_open_session(&ctx->session, ctx->url, 0), ERR_EXIT);
-    TUYA_CALL_ERR_GOTO(http_send_request(ctx->session, &request, field_flags), ERR_EXIT);
-    TUYA_CALL_ERR_GOTO(http_get_response_hdr(ctx->session, &response), ERR_EXIT);
+    return OPRT_OK;
 
-    if ((response->status_code != 200) && (response->status_code != 206)) {
-        if(HTTP_RESP_REDIR(response->status_code) && response->location != NULL) { //redirect
-            PR_DEBUG("url sink redirect to %s", response->location);
+ERR_EXIT:
+    if(response) {
+        http_free_response_hdr(&response);
+    }
+    __http_close(ctx);
+    return rt;
+}
 
-            if(ctx->url) {
-                Free(ctx->url);
-                ctx->url = NULL;
-            }
-            ctx->url = mm_strdup(response->location);
-            TUYA_CHECK_NULL_GOTO(ctx->url, ERR_EXIT);
+static void __url_fetch_connect(URL_DATASINK_CTX_T *ctx, uint32_t gen)
+{
+    OPERATE_RET rt = OPRT_OK;
+    URLSINK_RESP_T resp = {0};
+    uint32_t offset = 0, length = 0;
+    char *url = NULL;
 
-            if(ctx->session) {
-                http_close_session(&ctx->session);
-                ctx->session = NULL;
-            }
+    if(ctx->backoff_ms) {
+        tal_semaphore_wait(ctx->wakeup, ctx->backoff_ms);
+    }
 
-            TUYA_CALL_ERR_GOTO(tal_workq_schedule(WORKQ_SYSTEM, __http_connect, (void *)ctx), ERR_EXIT);
-        } else {
-            PR_ERR("url sink err status_code: %d", response->status_code);
-            ctx->status = URLSINK_STATUS_EXIT;
-        }
+    tal_mutex_lock(ctx->mutex);
+    if(gen != ctx->gen) {
+        tal_mutex_unlock(ctx->mutex);
+        return;
+    }
+    url = mm_strdup(ctx->url);
+    offset = ctx->offset;
+    length = ctx->length;
+    tal_mutex_unlock(ctx->mutex);
+
+    if(NULL == url) {
+        rt = OPRT_MALLOC_FAILED;
     } else {
-        if(response->status_code == 200) {
-            ctx->length = response->content_length;
-            ctx->chunked = response->chunked;
-            PR_DEBUG("url sink file size %d chunked %d", response->content_length, response->chunked);
-        }else if(response->status_code == 206) {
+        if(offset > 0) {
+            PR_DEBUG("url sink resume from %u length %u", offset, length);
+        }
+        rt = __http_connect(ctx, &url, offset, length, &resp);
+    }
+
+    tal_mutex_lock(ctx->mutex);
+    if(gen != ctx->gen) {
+        // stopped meanwhile, the session is closed by the fetch loop
+    } else if(OPRT_OK == rt) {
+        if(resp.partial) {
             // in resume mode, server may not return content-length
-            if(response->content_length > 0) {
-                ctx->length = ctx->offset + response->content_length;
+            if(resp.length > 0) {
+                ctx->length = offset + resp.length;
             }
-            ctx->chunked = response->chunked;
-            PR_DEBUG("url sink resume file size %d chunked %d", ctx->length, response->chunked);
+            ctx->skip = 0;
+        } else {
+            ctx->length = resp.length;
+            ctx->skip = offset; // the range was ignored, drop what is already buffered or played
         }
+        ctx->chunked = resp.chunked;
+        PR_DEBUG("url sink file size %u chunked %d skip %u", ctx->length, ctx->chunked, ctx->skip);
+
+        // keep the redirected url for a later resume
+        Free(ctx->url);
+        ctx->url = url;
+        url = NULL;
 
-        http_set_timeout(ctx->session, AI_PLAYER_HTTP_YIELD_MS);
         ctx->status = URLSINK_STATUS_RECV;
+        ctx->backoff_ms = 0;
+        ctx->last_rx_ms = tal_system_get_millisecond();
         ctx->download_start_s = tal_time_get_posix();
+    } else if((OPRT_NOT_FOUND == rt) || ctx->chunked ||
+              ((ctx->download_start_s + AI_PLAYER_HTTP_TIMEOUT_S) < tal_time_get_posix())) {
+        // in chunked mode, do not support retry
+        PR_ERR("url sink connect failed %d offset %u length %u", rt, ctx->offset, ctx->length);
+        ctx->status = URLSINK_STATUS_EXIT;
+    } else {
+        ctx->backoff_ms = ctx->backoff_ms ? ctx->backoff_ms * 2 : URLSINK_BACKOFF_MIN_MS;
+        if(ctx->backoff_ms > URLSINK_BACKOFF_MAX_MS) {
+            ctx->backoff_ms = URLSINK_BACKOFF_MAX_MS;
+        }
     }
+    tal_mutex_unlock(ctx->mutex);
 
-    http_free_response_hdr(&response);
-
-    return;
-
-ERR_EXIT:
-    if(ctx->session) {
-        http_close_session(&ctx->session);
-        ctx->session = NULL;
+    if(url) {
+        Free(url);
     }
-    ctx->status = URLSINK_STATUS_EXIT;
 }
 
-OPERATE_RET datasink_url_start(char *value, void**handle)
+static void __url_fetch_recv(URL_DATASINK_CTX_T *ctx, uint32_t gen)
 {
-    OPERATE_RET rt = OPRT_OK;
-    URL_DATASINK_CTX_T *ctx = (URL_DATASINK_CTX_T *)(*handle);
+    uint32_t used = 0, len = 0, skip = 0;
+    SYS_TIME_T now = 0;
+    bool paused = false;
+    int ret = 0;
+
+    tal_mutex_lock(ctx->mutex);
+    used = tuya_ring_buff_used_size_get(ctx->ringbuf);
+    if(ctx->paused && (used <= URLSINK_LOW_MARK)) {
+        ctx->paused = false;
+        ctx->last_rx_ms = tal_system_get_millisecond();
+        ctx->download_start_s = tal_time_get_posix();
+    } else if(!ctx->paused && (used >= URLSINK_HIGH_MARK)) {
+        ctx->paused = true;
+    }
+    len = tuya_ring_buff_free_size_get(ctx->ringbuf);
+    if(len > URLSINK_CHUNK_SIZE) {
+        len = URLSINK_CHUNK_SIZE;
+    }
+    if(0 == len) {
+        ctx->paused = true;
+    }
+    paused = ctx->paused;
+    tal_mutex_unlock(ctx->mutex);
 
-    if(ctx) {
-        if(ctx->session) {
-            http_close_session(&ctx->session);
-            ctx->session = NULL;
+    if(paused) {
+        tal_semaphore_wait(ctx->wakeup, URLSINK_IDLE_WAIT_MS);
+        return;
+    }
+
+    ret = http_read_content(ctx->session, ctx->chunk, len);
+    now = tal_system_get_millisecond();
+
+    tal_mutex_lock(ctx->mutex);
+    if(gen != ctx->gen) {
+        tal_mutex_unlock(ctx->mutex);
+        return;
+    }
+
+    if(ret > 0) {
+        ctx->last_rx_ms = now;
+        ctx->download_start_s = tal_time_get_posix();
+        skip = (ctx->skip > (uint32_t)ret) ? (uint32_t)ret : ctx->skip;
+        ctx->skip -= skip;
+        tuya_ring_buff_write(ctx->ringbuf, ctx->chunk + skip, ret - skip);
+        ctx->offset += ret - skip;
+        if(!ctx->chunked && ctx->length && (ctx->offset >= ctx->length)) {
+            ctx->status = URLSINK_STATUS_DONE;
         }
-        if(ctx->url) {
-            Free(ctx->url);
-            ctx->url = NULL;
+    } else if((0 == ret) && (ctx->chunked || (0 == ctx->length) || (ctx->offset >= ctx->length))) {
+        ctx->status = URLSINK_STATUS_DONE;
+    } else if((ret < 0) || ((now - ctx->last_rx_ms) > URLSINK_STALL_MS)) {
+        PR_ERR("url sink err offset %u length %u start_s %d", ctx->offset, ctx->length, ctx->download_start_s);
+        __http_close(ctx);
+        if(ctx->chunked) {
+            ctx->status = URLSINK_STATUS_EXIT; // in chunked mode, do not support retry
+        } else {
+            ctx->status = URLSINK_STATUS_CONNECT;
+            ctx->backoff_ms = URLSINK_BACKOFF_MIN_MS;
+            ctx->stat.reconnect_cnt++;
         }
-    } else {
-        ctx = (URL_DATASINK_CTX_T *)Malloc(sizeof(URL_DATASINK_CTX_T));
-        if (ctx == NULL) {
-            return OPRT_MALLOC_FAILED;
+    }
+
+    if(URLSINK_STATUS_DONE == ctx->status) {
+        PR_DEBUG("url sink fetched %u bytes", ctx->offset);
+        __http_close(ctx);
+    }
+    tal_mutex_unlock(ctx->mutex);
+}
+
+static void __url_fetch_task(void *arg)
+{
+    URL_DATASINK_CTX_T *ctx = (URL_DATASINK_CTX_T *)arg;
+    URLSINK_STATUS_T status = URLSINK_STATUS_INIT;
+    uint32_t gen = 0;
+
+    while(tal_thread_get_state(ctx->thread) == THREAD_STATE_RUNNING) {
+        tal_mutex_lock(ctx->mutex);
+        if(gen != ctx->gen) {
+            // started or stopped, the session belongs to the previous stream
+            gen = ctx->gen;
+            __http_close(ctx);
+            ctx->backoff_ms = 0;
+        }
+        status = ctx->status;
+        tal_mutex_unlock(ctx->mutex);
+
+        if(URLSINK_STATUS_CONNECT == status) {
+            __url_fetch_connect(ctx, gen);
+        } else if(URLSINK_STATUS_RECV == status) {
+            __url_fetch_recv(ctx, gen);
+        } else {
+            tal_semaphore_wait(ctx->wakeup, URLSINK_IDLE_WAIT_MS);
         }
-        *handle = ctx;
     }
 
+    tal_mutex_lock(ctx->mutex);
+    __http_close(ctx);
+    ctx->running = false;
+    tal_mutex_unlock(ctx->mutex);
+}
+
+static void __url_ctx_free(URL_DATASINK_CTX_T *ctx)
+{
+    if(ctx->ringbuf) {
+        tuya_ring_buff_free(ctx->ringbuf);
+    }
+    if(ctx->wakeup) {
+        tal_semaphore_release(ctx->wakeup);
+    }
+    if(ctx->mutex) {
+        tal_mutex_release(ctx->mutex);
+    }
+    if(ctx->chunk) {
+        Free(ctx->chunk);
+    }
+    if(ctx->url) {
+        Free(ctx->url);
+    }
+    Free(ctx);
+}
+
+static OPERATE_RET __url_ctx_create(URL_DATASINK_CTX_T **out)
+{
+    OPERATE_RET rt = OPRT_OK;
+    URL_DATASINK_CTX_T *ctx = NULL;
+
+    ctx = (URL_DATASINK_CTX_T *)Malloc(sizeof(URL_DATASINK_CTX_T));
+    if (ctx == NULL) {
+        return OPRT_MALLOC_FAILED;
+    }
     memset(ctx, 0, sizeof(URL_DATASINK_CTX_T));
 
-    ctx->url = mm_strdup(value);
-    if(!ctx->url) {
+    ctx->chunk = Malloc(URLSINK_CHUNK_SIZE);
+    TUYA_CHECK_NULL_GOTO(ctx->chunk, ERR_EXIT);
+    TUYA_CALL_ERR_GOTO(tal_mutex_create_init(&ctx->mutex), ERR_EXIT);
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&ctx->wakeup, 0, 1), ERR_EXIT);
+    TUYA_CALL_ERR_GOTO(tuya_ring_buff_create(AI_PLAYER_HTTP_PREFETCH_SIZE, OVERFLOW_STOP_TYPE, &ctx->ringbuf), ERR_EXIT);
+
+    ctx->running = true;
+    THREAD_CFG_T thread_cfg = {0};
+    thread_cfg.stackDepth = AI_PLAYER_HTTP_STACK_SIZE;
+    thread_cfg.priority   = THREAD_PRIO_2;
+    thread_cfg.thrdname   = "ai_player_url";
+    TUYA_CALL_ERR_GOTO(tal_thread_create_and_start(&ctx->thread, NULL, NULL, __url_fetch_task, ctx, &thread_cfg), ERR_EXIT);
+
+    *out = ctx;
+    return OPRT_OK;
+
+ERR_EXIT:
+    __url_ctx_free(ctx);
+    return (OPRT_OK == rt) ? OPRT_MALLOC_FAILED : rt;
+}
+
+OPERATE_RET datasink_url_start(char *value, void**handle)
+{
+    OPERATE_RET rt = OPRT_OK;
+    URL_DATASINK_CTX_T *ctx = (URL_DATASINK_CTX_T *)(*handle);
+    char *url = NULL;
+
+    url = mm_strdup(value);
+    if(!url) {
         return OPRT_MALLOC_FAILED;
     }
 
+    if(NULL == ctx) {
+        rt = __url_ctx_create(&ctx);
+        if(OPRT_OK != rt) {
+            Free(url);
+            return rt;
+        }
+        *handle = ctx;
+    }
+
+    tal_mutex_lock(ctx->mutex);
+    ctx->gen++;
+    if(ctx->url) {
+        Free(ctx->url);
+    }
+    ctx->url = url;
+    tuya_ring_buff_reset(ctx->ringbuf);
+    ctx->length = 0;
+    ctx->offset = 0;
+    ctx->skip = 0;
+    ctx->chunked = false;
+    ctx->paused = false;
+    ctx->buffering = true;
+    ctx->played = false;
+    ctx->start_mark = URLSINK_START_MARK;
+    ctx->buffering_ms = tal_system_get_millisecond();
     ctx->download_start_s = tal_time_get_posix();
+    memset(&ctx->stat, 0, sizeof(AI_PLAYER_SINK_STAT_T));
     ctx->status = URLSINK_STATUS_CONNECT;
-    ctx->eof = false;
-    rt = tal_workq_schedule(WORKQ_SYSTEM, __http_connect, (void *)ctx);
-    if (rt != OPRT_OK) {
-        ctx->status = URLSINK_STATUS_EXIT;
-    }
+    tal_mutex_unlock(ctx->mutex);
 
-    return rt;
+    tal_semaphore_post(ctx->wakeup);
+
+    return OPRT_OK;
 }
 
 OPERATE_RET datasink_url_stop(void* handle)
@@ -164,24 +437,46 @@ OPERATE_RET datasink_url_stop(void* handle)
         return OPRT_INVALID_PARM;
     }
 
+    // the fetch thread closes the session once it sees the new generation
+    tal_mutex_lock(ctx->mutex);
+    ctx->gen++;
     ctx->status = URLSINK_STATUS_INIT;
-    ctx->eof = false;
-    if(ctx->session) {
-        http_close_session(&ctx->session);
-        ctx->session = NULL;
-    }
+    tuya_ring_buff_reset(ctx->ringbuf);
     if(ctx->url) {
         Free(ctx->url);
         ctx->url = NULL;
     }
+    tal_mutex_unlock(ctx->mutex);
+
+    tal_semaphore_post(ctx->wakeup);
 
     return OPRT_OK;
 }
 
 OPERATE_RET datasink_url_exit(void* handle)
 {
+    URL_DATASINK_CTX_T *ctx = (URL_DATASINK_CTX_T *)handle;
+    bool running = true;
+
+    if(!ctx) {
+        return OPRT_INVALID_PARM;
+    }
+
     datasink_url_stop(handle);
-    Free(handle);
+
+    while(tal_thread_get_state(ctx->thread) == THREAD_STATE_EMPTY) {
+        tal_system_sleep(10);
+    }
+    tal_thread_delete(ctx->thread);
+    while(running) {
+        tal_semaphore_post(ctx->wakeup);
+        tal_system_sleep(10);
+        tal_mutex_lock(ctx->mutex);
+        running = ctx->running;
+        tal_mutex_unlock(ctx->mutex);
+    }
+
+    __url_ctx_free(ctx);
 
     return OPRT_OK;
 }
@@ -189,49 +484,80 @@ OPERATE_RET datasink_url_exit(void* handle)
 OPERATE_RET datasink_url_read(void* handle, uint8_t *data, uint32_t len, uint32_t *out_len)
 {
     URL_DATASINK_CTX_T *ctx = (URL_DATASINK_CTX_T *)handle;
+    SYS_TIME_T now = 0;
+    uint32_t used = 0;
+    bool active = false, wakeup = false;
+
     if(!ctx) {
         return OPRT_INVALID_PARM;
     }
 
     *out_len = 0;
+    now = tal_system_get_millisecond();
 
-    if(ctx->status <= URLSINK_STATUS_CONNECT) {
-        tal_system_sleep(AI_PLAYER_HTTP_YIELD_MS);
-        return OPRT_OK;
-    } else if(ctx->status == URLSINK_STATUS_EXIT) {
-        if(ctx->chunked) { // in chunked mode, do not support retry
-            return OPRT_NETWORK_ERROR;
-        } else if((ctx->download_start_s + AI_PLAYER_HTTP_TIMEOUT_S) < tal_time_get_posix()) { // timeout
-            return OPRT_NETWORK_ERROR;
-        } else {
-            ctx->status = URLSINK_STATUS_CONNECT;
-            return tal_workq_schedule(WORKQ_SYSTEM, __http_connect, (void *)ctx);
+    tal_mutex_lock(ctx->mutex);
+    used = tuya_ring_buff_used_size_get(ctx->ringbuf);
+    active = (URLSINK_STATUS_CONNECT == ctx->status) || (URLSINK_STATUS_RECV == ctx->status);
+
+    if(ctx->buffering) {
+        if(active && (used < ctx->start_mark)) {
+            tal_mutex_unlock(ctx->mutex);
+            tal_system_sleep(AI_PLAYER_HTTP_YIELD_MS);
+            return OPRT_OK;
+        }
+        ctx->buffering = false;
+        if(ctx->played) {
+            ctx->stat.rebuffer_ms += (uint32_t)(now - ctx->buffering_ms);
         }
     }
 
-    if(ctx->eof || ((ctx->offset >= ctx->length) && !ctx->chunked)) {
-        if(ctx->session) {
-            http_close_session(&ctx->session);
-            ctx->session = NULL;
+    if(0 == used) {
+        if(URLSINK_STATUS_DONE == ctx->status) {
+            tal_mutex_unlock(ctx->mutex);
+            return OPRT_NOT_FOUND; // eof
+        } else if(URLSINK_STATUS_EXIT == ctx->status) {
+            tal_mutex_unlock(ctx->mutex);
+            return OPRT_NETWORK_ERROR;
         }
-        ctx->eof = true;
-        return OPRT_NOT_FOUND; // eof
-    }
 
-    int ret = http_read_content(ctx->session, data, len);
-    if(ret > 0) {
-        *out_len = ret;
-        ctx->offset += ret;
-        ctx->download_start_s = tal_time_get_posix();
-        return OPRT_OK;
-    } else if(ret == 0) {
-        ctx->eof = true;
-        return OPRT_NOT_FOUND; // eof
-    } else {
-        PR_ERR("url sink err offset %d length %d start_s %d", ctx->offset, ctx->length, ctx->download_start_s);
-        ctx->status = URLSINK_STATUS_EXIT; // error, let connect again
+        if(active) {
+            // ran dry while playing, ask for more before handing out data again
+            ctx->stat.underrun_cnt++;
+            ctx->start_mark = (ctx->start_mark * 2 > URLSINK_HIGH_MARK) ? URLSINK_HIGH_MARK : ctx->start_mark * 2;
+            ctx->buffering = true;
+            ctx->buffering_ms = now;
+            PR_DEBUG("url sink underrun %u, rebuffer %u bytes", ctx->stat.underrun_cnt, ctx->start_mark);
+        }
+        tal_mutex_unlock(ctx->mutex);
+        tal_system_sleep(AI_PLAYER_HTTP_YIELD_MS);
         return OPRT_OK;
     }
+
+    *out_len = tuya_ring_buff_read(ctx->ringbuf, data, len);
+    ctx->played = true;
+    wakeup = ctx->paused && ((used - *out_len) <= URLSINK_LOW_MARK);
+    tal_mutex_unlock(ctx->mutex);
+
+    if(wakeup) {
+        tal_semaphore_post(ctx->wakeup);
+    }
+
+    return OPRT_OK;
+}
+
+OPERATE_RET datasink_url_stat(void* handle, AI_PLAYER_SINK_STAT_T *stat)
+{
+    URL_DATASINK_CTX_T *ctx = (URL_DATASINK_CTX_T *)handle;
+    if(!ctx || !stat) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(ctx->mutex);
+    memcpy(stat, &ctx->stat, sizeof(AI_PLAYER_SINK_STAT_T));
+    stat->buffered = tuya_ring_buff_used_size_get(ctx->ringbuf);
+    tal_mutex_unlock(ctx->mutex);
+
+    return OPRT_OK;
 }
 
 DATASINK_T g_datasink_url = {
@@ -240,4 +566,5 @@ DATASINK_T g_datasink_url = {
     .exit  = datasink_url_exit,
     .feed  = NULL,
     .read  = datasink_url_read,
+    .stat  = datasink_url_stat,
 };
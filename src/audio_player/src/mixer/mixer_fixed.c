@@ -19,18 +19,297 @@
 
 #include "mixer_fixed.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define MIXER_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MIXER_SIMD_NEON
+#elif defined(__ARM_FEATURE_DSP) && defined(__ARM_FEATURE_SAT)
+#include <arm_acle.h>
+#define MIXER_SIMD_DSP
+#endif
+
 #define CLAMP_S16(x)  ((x) > 32767 ? 32767 : ((x) < -32768 ? -32768 : (x)))
 
+#define MIXER_BLOCK   64 // samples accumulated in 32 bit per round
+
+/* same as CLAMP_S16, written so that compilers emit conditional moves instead of branches */
+static inline int16_t __sat_s16(int32_t v)
+{
+    v = (v < -32768) ? -32768 : v;
+    v = (v > 32767) ? 32767 : v;
+    return (int16_t)v;
+}
+
 void mix_pcm_s16_mono_16k(int16_t *src, int16_t *dst, int samples)
 {
-    for (int i = 0; i < samples; i++) {
-        int32_t mixed = (int32_t)(src[i]  + (dst[i]));
-        dst[i] = (int16_t)CLAMP_S16(mixed);
+    int i = 0;
+#if defined(MIXER_SIMD_SSE2)
+    for (; i + 8 <= samples; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(dst + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_adds_epi16(a, b));
+    }
+#elif defined(MIXER_SIMD_NEON)
+    for (; i + 8 <= samples; i += 8) {
+        vst1q_s16(dst + i, vqaddq_s16(vld1q_s16(src + i), vld1q_s16(dst + i)));
+    }
+#elif defined(MIXER_SIMD_DSP)
+    for (; i + 2 <= samples; i += 2) {
+        int16x2_t a, b;
+        memcpy(&a, src + i, sizeof(a));
+        memcpy(&b, dst + i, sizeof(b));
+        a = __qadd16(a, b);
+        memcpy(dst + i, &a, sizeof(a));
+    }
+#endif
+    for (; i < samples; i++) {
+        dst[i] = __sat_s16((int32_t)src[i] + dst[i]);
+    }
+}
+
+static int32_t __mixer_gain_q15(int volume, int max_volume)
+{
+    if (max_volume <= 0 || volume >= max_volume) {
+        return AI_MIXER_UNITY;
+    }
+    if (volume <= 0) {
+        return 0;
+    }
+    return (int32_t)(((int64_t)volume * AI_MIXER_UNITY) / max_volume);
+}
+
+void ai_mixer_gain_init(AI_MIXER_GAIN_T *gain, int volume, int max_volume)
+{
+    gain->gain = __mixer_gain_q15(volume, max_volume);
+    gain->target = gain->gain;
+    gain->step = 0;
+}
+
+void ai_mixer_gain_set(AI_MIXER_GAIN_T *gain, int volume, int max_volume)
+{
+    int32_t target = __mixer_gain_q15(volume, max_volume);
+    if (target == gain->target) {
+        return;
+    }
+
+    gain->target = target;
+    gain->step = (target - gain->gain) / AI_MIXER_RAMP_SAMPLES;
+    if (gain->step == 0) {
+        gain->step = (target > gain->gain) ? 1 : -1;
+    }
+}
+
+void ai_mixer_gain_ramp(AI_MIXER_GAIN_T *gain, int32_t from, int32_t to, uint32_t samples)
+{
+    gain->gain = from;
+    gain->target = to;
+    gain->step = 0;
+    if (from == to) {
+        return;
+    }
+
+    gain->step = (to - from) / (int32_t)(samples ? samples : 1);
+    if (gain->step == 0) {
+        gain->step = (to > from) ? 1 : -1;
+    }
+}
+
+bool ai_mixer_gain_is_unity(const AI_MIXER_GAIN_T *gain)
+{
+    return gain->step == 0 && gain->gain == AI_MIXER_UNITY;
+}
+
+/* advance the ramp by one sample */
+static inline int32_t __mixer_gain_next(AI_MIXER_GAIN_T *gain)
+{
+    gain->gain += gain->step;
+    if ((gain->step > 0 && gain->gain >= gain->target) || (gain->step < 0 && gain->gain <= gain->target)) {
+        gain->gain = gain->target;
+        gain->step = 0;
+    }
+    return gain->gain;
+}
+
+/* acc = (first ? 0 : acc) + pcm * g, g is a steady Q15 gain below unity */
+static void __mixer_acc_gain(int32_t *acc, const int16_t *pcm, int32_t g, uint32_t n, bool first)
+{
+    uint32_t i = 0;
+#if defined(MIXER_SIMD_SSE2)
+    __m128i vg = _mm_set1_epi16((int16_t)g);
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(pcm + i));
+        __m128i lo = _mm_mullo_epi16(x, vg);
+        __m128i hi = _mm_mulhi_epi16(x, vg);
+        __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 15);
+        __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 15);
+        if (!first) {
+            p0 = _mm_add_epi32(p0, _mm_loadu_si128((const __m128i *)(acc + i)));
+            p1 = _mm_add_epi32(p1, _mm_loadu_si128((const __m128i *)(acc + i + 4)));
+        }
+        _mm_storeu_si128((__m128i *)(acc + i), p0);
+        _mm_storeu_si128((__m128i *)(acc + i + 4), p1);
+    }
+#elif defined(MIXER_SIMD_NEON)
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t x = vld1q_s16(pcm + i);
+        int32x4_t p0 = vshrq_n_s32(vmull_n_s16(vget_low_s16(x), (int16_t)g), 15);
+        int32x4_t p1 = vshrq_n_s32(vmull_n_s16(vget_high_s16(x), (int16_t)g), 15);
+        if (!first) {
+            p0 = vaddq_s32(p0, vld1q_s32(acc + i));
+            p1 = vaddq_s32(p1, vld1q_s32(acc + i + 4));
+        }
+        vst1q_s32(acc + i, p0);
+        vst1q_s32(acc + i + 4, p1);
+    }
+#endif
+    if (first) {
+        for (; i < n; i++) {
+            acc[i] = (pcm[i] * g) >> 15;
+        }
+    } else {
+        for (; i < n; i++) {
+            acc[i] += (pcm[i] * g) >> 15;
+        }
+    }
+}
+
+/* acc = (first ? 0 : acc) + pcm */
+static void __mixer_acc_unity(int32_t *acc, const int16_t *pcm, uint32_t n, bool first)
+{
+    uint32_t i = 0;
+#if defined(MIXER_SIMD_SSE2)
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(pcm + i));
+        __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        if (!first) {
+            p0 = _mm_add_epi32(p0, _mm_loadu_si128((const __m128i *)(acc + i)));
+            p1 = _mm_add_epi32(p1, _mm_loadu_si128((const __m128i *)(acc + i + 4)));
+        }
+        _mm_storeu_si128((__m128i *)(acc + i), p0);
+        _mm_storeu_si128((__m128i *)(acc + i + 4), p1);
+    }
+#elif defined(MIXER_SIMD_NEON)
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t x = vld1q_s16(pcm + i);
+        int32x4_t p0 = vmovl_s16(vget_low_s16(x));
+        int32x4_t p1 = vmovl_s16(vget_high_s16(x));
+        if (!first) {
+            p0 = vaddq_s32(p0, vld1q_s32(acc + i));
+            p1 = vaddq_s32(p1, vld1q_s32(acc + i + 4));
+        }
+        vst1q_s32(acc + i, p0);
+        vst1q_s32(acc + i + 4, p1);
+    }
+#endif
+    if (first) {
+        for (; i < n; i++) {
+            acc[i] = pcm[i];
+        }
+    } else {
+        for (; i < n; i++) {
+            acc[i] += pcm[i];
+        }
+    }
+}
+
+static void __mixer_accumulate(int32_t *acc, const int16_t *pcm, AI_MIXER_GAIN_T *gain, uint32_t n, bool first)
+{
+    uint32_t i = 0;
+
+    if (gain && gain->step) {
+        for (i = 0; i < n; i++) {
+            int32_t v = (pcm[i] * __mixer_gain_next(gain)) >> 15;
+            acc[i] = first ? v : acc[i] + v;
+        }
+    } else if (NULL == gain || gain->gain >= AI_MIXER_UNITY) {
+        __mixer_acc_unity(acc, pcm, n, first);
+    } else if (gain->gain > 0) {
+        __mixer_acc_gain(acc, pcm, gain->gain, n, first);
+    } else if (first) {
+        memset(acc, 0, n * sizeof(int32_t));
+    }
+}
+
+/* out = saturate(acc) */
+static void __mixer_saturate(int16_t *out, const int32_t *acc, uint32_t n)
+{
+    uint32_t i = 0;
+#if defined(MIXER_SIMD_SSE2)
+    for (; i + 8 <= n; i += 8) {
+        __m128i p0 = _mm_loadu_si128((const __m128i *)(acc + i));
+        __m128i p1 = _mm_loadu_si128((const __m128i *)(acc + i + 4));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(p0, p1));
+    }
+#elif defined(MIXER_SIMD_NEON)
+    for (; i + 8 <= n; i += 8) {
+        int16x4_t lo = vqmovn_s32(vld1q_s32(acc + i));
+        int16x4_t hi = vqmovn_s32(vld1q_s32(acc + i + 4));
+        vst1q_s16(out + i, vcombine_s16(lo, hi));
+    }
+#elif defined(MIXER_SIMD_DSP)
+    for (; i < n; i++) {
+        out[i] = (int16_t)__ssat(acc[i], 16);
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = __sat_s16(acc[i]);
+    }
+}
+
+void ai_mixer_gain_apply(AI_MIXER_GAIN_T *gain, int16_t *pcm, uint32_t samples)
+{
+    int32_t acc[MIXER_BLOCK];
+    uint32_t off = 0, n = 0;
+
+    if (NULL == gain || NULL == pcm || ai_mixer_gain_is_unity(gain)) {
+        return;
+    }
+
+#if !defined(MIXER_SIMD_SSE2) && !defined(MIXER_SIMD_NEON)
+    if (0 == gain->step && gain->gain < AI_MIXER_UNITY) {
+        // steady attenuation can not overflow, scalar cores skip the accumulator
+        int32_t g = gain->gain;
+        for (off = 0; off < samples; off++) {
+            pcm[off] = (int16_t)((pcm[off] * g) >> 15);
+        }
+        return;
+    }
+#endif
+
+    for (off = 0; off < samples; off += n) {
+        n = (samples - off > MIXER_BLOCK) ? MIXER_BLOCK : samples - off;
+        __mixer_accumulate(acc, pcm + off, gain, n, true);
+        __mixer_saturate(pcm + off, acc, n);
     }
 }
 
+OPERATE_RET ai_mixer_process(const AI_MIXER_INPUT_T *input, uint32_t num, int16_t *out, uint32_t samples)
+{
+    int32_t acc[MIXER_BLOCK];
+    uint32_t off = 0, n = 0, i = 0;
+
+    if (NULL == input || NULL == out || 0 == num || num > AI_MIXER_INPUT_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+
+    // all inputs of a block are read before out of the block is written
+    for (off = 0; off < samples; off += n) {
+        n = (samples - off > MIXER_BLOCK) ? MIXER_BLOCK : samples - off;
+        for (i = 0; i < num; i++) {
+            __mixer_accumulate(acc, input[i].pcm + off, input[i].gain, n, (i == 0));
+        }
+        __mixer_saturate(out + off, acc, n);
+    }
+
+    return OPRT_OK;
+}
+
 OPERATE_RET ai_player_mixer_process(uint8_t *src_decode_buf, uint8_t *dst_decode_buf, uint32_t samples)
 {
+    // two unity inputs mixed in place, a saturating 16 bit add needs no accumulator
     mix_pcm_s16_mono_16k((int16_t *)src_decode_buf, (int16_t *)dst_decode_buf, samples);
     return OPRT_OK;
 }
@@ -41,13 +320,106 @@ OPERATE_RET ai_player_volume_process(uint8_t *decode_buf, uint32_t len, int volu
         return OPRT_OK; // only support 16bits
     }
 
-    int samples = len / 2; // 16bits = 2 bytes
-    int i = 0;
-    for(i = 0; i < samples; i++) {
-        int32_t sample = ((int16_t *)decode_buf)[i];
+    AI_MIXER_GAIN_T gain;
+    ai_mixer_gain_init(&gain, volume, max_volume);
+    ai_mixer_gain_apply(&gain, (int16_t *)decode_buf, len / 2); // 16bits = 2 bytes
+
+    return OPRT_OK;
+}
+
+#if defined(AI_PLAYER_MIXER_BENCHMARK) && (AI_PLAYER_MIXER_BENCHMARK == 1)
+#include "tal_system.h"
+#include "tal_memory.h"
+#include "tal_log.h"
+
+/* per-sample implementations the engine replaced */
+static void __ref_mix(const int16_t *src, int16_t *dst, uint32_t samples)
+{
+    for (uint32_t i = 0; i < samples; i++) {
+        int32_t mixed = (int32_t)(src[i] + (dst[i]));
+        dst[i] = (int16_t)CLAMP_S16(mixed);
+    }
+}
+
+static void __ref_volume(int16_t *pcm, uint32_t samples, int volume, int max_volume)
+{
+    for (uint32_t i = 0; i < samples; i++) {
+        int32_t sample = pcm[i];
         sample = (sample * volume) / max_volume;
-        ((int16_t *)decode_buf)[i] = (int16_t)CLAMP_S16(sample);
+        pcm[i] = (int16_t)CLAMP_S16(sample);
+    }
+}
+
+static void __bench_report(const char *name, uint32_t ref_ms, uint32_t new_ms, uint64_t total)
+{
+    uint32_t ref_ns = (uint32_t)(((uint64_t)ref_ms * 1000000) / total);
+    uint32_t new_ns = (uint32_t)(((uint64_t)new_ms * 1000000) / total);
+
+    PR_NOTICE("mixer bench %s: ref %u ms, engine %u ms, %u.%03u -> %u.%03u ns/sample, x%u.%02u", name, ref_ms, new_ms,
+              ref_ns / 1000, ref_ns % 1000, new_ns / 1000, new_ns % 1000, ref_ms / (new_ms ? new_ms : 1),
+              (ref_ms * 100 / (new_ms ? new_ms : 1)) % 100);
+#if defined(AI_PLAYER_BENCH_CPU_MHZ)
+    PR_NOTICE("mixer bench %s: %u.%02u -> %u.%02u cycles/sample", name, ref_ns * AI_PLAYER_BENCH_CPU_MHZ / 1000000,
+              (ref_ns * AI_PLAYER_BENCH_CPU_MHZ / 10000) % 100, new_ns * AI_PLAYER_BENCH_CPU_MHZ / 1000000,
+              (new_ns * AI_PLAYER_BENCH_CPU_MHZ / 10000) % 100);
+#endif
+}
+
+OPERATE_RET ai_player_mixer_benchmark(uint32_t samples, uint32_t rounds)
+{
+    int16_t *src = NULL, *dst = NULL;
+    uint32_t i = 0, r = 0, start = 0, ref_ms = 0, new_ms = 0;
+    uint64_t total = (uint64_t)samples * rounds;
+    AI_MIXER_GAIN_T gain;
+
+    if (0 == samples || 0 == rounds) {
+        return OPRT_INVALID_PARM;
+    }
+
+    src = Malloc(samples * sizeof(int16_t));
+    dst = Malloc(samples * sizeof(int16_t));
+    if (NULL == src || NULL == dst) {
+        Free(src);
+        Free(dst);
+        return OPRT_MALLOC_FAILED;
+    }
+    for (i = 0; i < samples; i++) {
+        src[i] = (int16_t)((i * 2654435761u) >> 16);
+        dst[i] = (int16_t)((i * 40503u) & 0xffff);
+    }
+
+    start = tal_system_get_millisecond();
+    for (r = 0; r < rounds; r++) {
+        __ref_mix(src, dst, samples);
     }
+    ref_ms = tal_system_get_millisecond() - start;
+
+    start = tal_system_get_millisecond();
+    for (r = 0; r < rounds; r++) {
+        ai_player_mixer_process((uint8_t *)src, (uint8_t *)dst, samples);
+    }
+    new_ms = tal_system_get_millisecond() - start;
+    __bench_report("mix", ref_ms, new_ms, total);
+
+    start = tal_system_get_millisecond();
+    for (r = 0; r < rounds; r++) {
+        __ref_volume(dst, samples, 70, 100);
+        __ref_volume(dst, samples, 100, 70);
+    }
+    ref_ms = tal_system_get_millisecond() - start;
+
+    ai_mixer_gain_init(&gain, 70, 100);
+    start = tal_system_get_millisecond();
+    for (r = 0; r < rounds; r++) {
+        ai_mixer_gain_apply(&gain, dst, samples);
+        ai_mixer_gain_apply(&gain, dst, samples);
+    }
+    new_ms = tal_system_get_millisecond() - start;
+    __bench_report("volume", ref_ms, new_ms, total * 2);
+
+    Free(src);
+    Free(dst);
 
     return OPRT_OK;
 }
+#endif
@@ -25,10 +25,67 @@
 extern "C" {
 #endif
 
+#define AI_MIXER_UNITY        (32768) // Q15 gain 1.0
+#define AI_MIXER_RAMP_SAMPLES (256)   // gain change is spread over 16ms at 16k
+#define AI_MIXER_INPUT_MAX    (8)
+
+// Q15 gain ramped linearly to its target to avoid zipper noise
+typedef struct {
+    int32_t gain;   // current gain
+    int32_t target; // gain being ramped to
+    int32_t step;   // per sample step while ramping
+} AI_MIXER_GAIN_T;
+
+typedef struct {
+    const int16_t *pcm;
+    AI_MIXER_GAIN_T *gain; // NULL means unity
+} AI_MIXER_INPUT_T;
+
 OPERATE_RET ai_player_mixer_process(uint8_t *src_decode_buf, uint8_t *dst_decode_buf, uint32_t samples);
 
 OPERATE_RET ai_player_volume_process(uint8_t *decode_buf, uint32_t len, int volume, int max_volume, uint32_t datebits);
 
+/**
+ * @brief set gain to volume/max_volume at once
+ */
+void ai_mixer_gain_init(AI_MIXER_GAIN_T *gain, int volume, int max_volume);
+
+/**
+ * @brief ramp gain to volume/max_volume over AI_MIXER_RAMP_SAMPLES
+ */
+void ai_mixer_gain_set(AI_MIXER_GAIN_T *gain, int volume, int max_volume);
+
+/**
+ * @brief ramp a Q15 gain from one value to another over the given samples, e.g. for a crossfade
+ */
+void ai_mixer_gain_ramp(AI_MIXER_GAIN_T *gain, int32_t from, int32_t to, uint32_t samples);
+
+/**
+ * @brief TRUE if the gain is unity and not ramping, applying it is a no-op
+ */
+bool ai_mixer_gain_is_unity(const AI_MIXER_GAIN_T *gain);
+
+/**
+ * @brief apply gain to 16 bit pcm in place
+ */
+void ai_mixer_gain_apply(AI_MIXER_GAIN_T *gain, int16_t *pcm, uint32_t samples);
+
+/**
+ * @brief sum num inputs with their gain into out, saturated to 16 bit
+ *
+ * @note out can be one of the inputs
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET ai_mixer_process(const AI_MIXER_INPUT_T *input, uint32_t num, int16_t *out, uint32_t samples);
+
+/**
+ * @brief compare the mixer engine with the per-sample implementation
+ *
+ * @note need AI_PLAYER_MIXER_BENCHMARK
+ */
+OPERATE_RET ai_player_mixer_benchmark(uint32_t samples, uint32_t rounds);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,243 @@
+/**
+ * @file pcm_ring.c
+ * @brief pcm staging ring shared by decoder, mixer and consumer
+ * @version 0.1
+ * @date 2025-10-09
+ *
+ * @copyright Copyright (c) 2025 Tuya Inc. All Rights Reserved.
+ *
+ * Permission is hereby granted, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), Under the premise of complying
+ * with the license of the third-party open source software contained in the software,
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software.
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ */
+
+#include "tal_memory.h"
+#include "pcm_ring.h"
+
+typedef struct {
+    uint32_t off;
+    uint32_t len;
+    uint32_t rd;  // bytes consumed
+    uint16_t ref; // readers holding the slice
+} PCM_RING_SLICE_T;
+
+/*
+ * bip buffer: data is [head, wr) or, once the writer wrapped,
+ * [head, wrap) followed by [0, wr). A reservation never splits.
+ */
+struct PCM_RING {
+    uint8_t *buf;
+    uint32_t size;
+    uint32_t wr;
+    uint32_t wrap;     // end of data before the writer wrapped, 0 if not wrapped
+    uint32_t resv;     // offset of the last reservation
+    uint32_t resv_cap; // 0 if nothing is reserved
+    uint32_t used;
+    uint8_t head;
+    uint8_t num;
+    PCM_RING_SLICE_T slice[PCM_RING_SLICE_MAX];
+};
+
+PCM_RING_T *pcm_ring_create(uint32_t size)
+{
+    PCM_RING_T *ring = NULL;
+
+    if (0 == size) {
+        return NULL;
+    }
+
+    ring = Malloc(SIZEOF(PCM_RING_T) + size);
+    if (NULL == ring) {
+        return NULL;
+    }
+    memset(ring, 0, SIZEOF(PCM_RING_T));
+    ring->buf = (uint8_t *)(ring + 1);
+    ring->size = size;
+
+    return ring;
+}
+
+void pcm_ring_destroy(PCM_RING_T *ring)
+{
+    if (ring) {
+        Free(ring);
+    }
+}
+
+void pcm_ring_reset(PCM_RING_T *ring)
+{
+    ring->wr = 0;
+    ring->wrap = 0;
+    ring->resv_cap = 0;
+    ring->used = 0;
+    ring->head = 0;
+    ring->num = 0;
+}
+
+uint32_t pcm_ring_used(PCM_RING_T *ring)
+{
+    return ring->used;
+}
+
+OPERATE_RET pcm_ring_reserve(PCM_RING_T *ring, uint32_t min, uint8_t **buf, uint32_t *cap)
+{
+    uint32_t head_off = 0;
+
+    if (0 == min) {
+        min = 1;
+    }
+    ring->resv_cap = 0;
+    if (ring->num >= PCM_RING_SLICE_MAX || min > ring->size) {
+        return OPRT_BUFFER_NOT_ENOUGH;
+    }
+
+    if (0 == ring->num) {
+        ring->wr = 0;
+        ring->wrap = 0;
+        ring->resv = 0;
+        ring->resv_cap = ring->size;
+    } else {
+        head_off = ring->slice[ring->head].off;
+        if (0 == ring->wrap) {
+            if (ring->size - ring->wr >= min) {
+                ring->resv = ring->wr;
+                ring->resv_cap = ring->size - ring->wr;
+            } else if (head_off >= min) {
+                ring->resv = 0;
+                ring->resv_cap = head_off;
+            }
+        } else if (head_off - ring->wr >= min) {
+            ring->resv = ring->wr;
+            ring->resv_cap = head_off - ring->wr;
+        }
+    }
+
+    if (0 == ring->resv_cap) {
+        return OPRT_BUFFER_NOT_ENOUGH;
+    }
+
+    *buf = ring->buf + ring->resv;
+    *cap = ring->resv_cap;
+    return OPRT_OK;
+}
+
+OPERATE_RET pcm_ring_commit(PCM_RING_T *ring, uint32_t len)
+{
+    PCM_RING_SLICE_T *slice = NULL;
+
+    if (0 == len) {
+        return OPRT_OK;
+    }
+    if (len > ring->resv_cap) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (0 == ring->resv && ring->num && 0 == ring->wrap) {
+        ring->wrap = ring->wr;
+    }
+
+    slice = &ring->slice[(ring->head + ring->num) % PCM_RING_SLICE_MAX];
+    slice->off = ring->resv;
+    slice->len = len;
+    slice->rd = 0;
+    slice->ref = 0;
+    ring->num++;
+    ring->wr = ring->resv + len;
+    ring->used += len;
+    ring->resv_cap = 0;
+
+    return OPRT_OK;
+}
+
+OPERATE_RET pcm_ring_peek(PCM_RING_T *ring, PCM_SLICE_T *slice)
+{
+    uint8_t i = 0, idx = 0;
+
+    for (i = 0; i < ring->num; i++) {
+        idx = (ring->head + i) % PCM_RING_SLICE_MAX;
+        PCM_RING_SLICE_T *s = &ring->slice[idx];
+        if (s->rd < s->len) {
+            s->ref++;
+            slice->data = ring->buf + s->off + s->rd;
+            slice->len = s->len - s->rd;
+            slice->idx = idx;
+            return OPRT_OK;
+        }
+    }
+
+    return OPRT_NOT_FOUND;
+}
+
+OPERATE_RET pcm_ring_get(PCM_RING_T *ring, uint8_t nth, PCM_SLICE_T *slice)
+{
+    uint8_t i = 0, idx = 0;
+
+    for (i = 0; i < ring->num; i++) {
+        idx = (ring->head + i) % PCM_RING_SLICE_MAX;
+        PCM_RING_SLICE_T *s = &ring->slice[idx];
+        if (s->rd >= s->len) {
+            continue;
+        }
+        if (nth) {
+            nth--;
+            continue;
+        }
+        slice->data = ring->buf + s->off + s->rd;
+        slice->len = s->len - s->rd;
+        slice->idx = idx;
+        return OPRT_OK;
+    }
+
+    return OPRT_NOT_FOUND;
+}
+
+void pcm_slice_consume(PCM_RING_T *ring, PCM_SLICE_T *slice, uint32_t len)
+{
+    PCM_RING_SLICE_T *s = &ring->slice[slice->idx];
+
+    if (len > s->len - s->rd) {
+        len = s->len - s->rd;
+    }
+    s->rd += len;
+    ring->used -= len;
+    slice->data += len;
+    slice->len -= len;
+}
+
+void pcm_slice_get(PCM_RING_T *ring, PCM_SLICE_T *slice)
+{
+    ring->slice[slice->idx].ref++;
+}
+
+void pcm_slice_put(PCM_RING_T *ring, PCM_SLICE_T *slice)
+{
+    PCM_RING_SLICE_T *s = &ring->slice[slice->idx];
+    uint32_t off = 0;
+
+    if (s->ref) {
+        s->ref--;
+    }
+
+    // reclaim from the oldest slice only, space is handed back in order
+    while (ring->num) {
+        s = &ring->slice[ring->head];
+        if (s->ref || s->rd < s->len) {
+            break;
+        }
+        off = s->off;
+        ring->head = (ring->head + 1) % PCM_RING_SLICE_MAX;
+        ring->num--;
+        if (0 == ring->num) {
+            ring->wr = 0;
+            ring->wrap = 0;
+        } else if (ring->wrap && ring->slice[ring->head].off < off) {
+            ring->wrap = 0; // the remaining data starts at the front
+        }
+    }
+}
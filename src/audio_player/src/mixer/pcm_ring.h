@@ -0,0 +1,107 @@
+/**
+ * @file pcm_ring.h
+ * @brief pcm staging ring shared by decoder, mixer and consumer
+ * @version 0.1
+ * @date 2025-10-09
+ *
+ * @copyright Copyright (c) 2025 Tuya Inc. All Rights Reserved.
+ *
+ * Permission is hereby granted, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), Under the premise of complying
+ * with the license of the third-party open source software contained in the software,
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software.
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ */
+
+#ifndef __PCM_RING_H__
+#define __PCM_RING_H__
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PCM_RING_SLICE_MAX (8)
+
+/*
+ * The writer reserves a contiguous region, fills it in place (decoder,
+ * resample, gain) and commits it as a slice. Readers look at the oldest
+ * slice in place and consume it. Space of a slice goes back to the
+ * writer once it is fully consumed and no reader holds a reference.
+ */
+typedef struct PCM_RING PCM_RING_T;
+
+typedef struct {
+    uint8_t *data;  // first unread byte
+    uint32_t len;   // unread bytes
+    uint8_t idx;    // slice index in the ring
+} PCM_SLICE_T;
+
+PCM_RING_T *pcm_ring_create(uint32_t size);
+void pcm_ring_destroy(PCM_RING_T *ring);
+
+/**
+ * @brief drop all slices, slice references held by readers are invalid afterwards
+ */
+void pcm_ring_reset(PCM_RING_T *ring);
+
+/**
+ * @brief unread bytes of all slices
+ */
+uint32_t pcm_ring_used(PCM_RING_T *ring);
+
+/**
+ * @brief reserve a contiguous writable region of at least min bytes
+ *
+ * @param[out] buf start of the region
+ * @param[out] cap size of the region, it can be larger than min
+ *
+ * @return OPRT_OK on success, OPRT_BUFFER_NOT_ENOUGH if the ring is full
+ */
+OPERATE_RET pcm_ring_reserve(PCM_RING_T *ring, uint32_t min, uint8_t **buf, uint32_t *cap);
+
+/**
+ * @brief publish len bytes at the start of the last reserved region as a slice
+ */
+OPERATE_RET pcm_ring_commit(PCM_RING_T *ring, uint32_t len);
+
+/**
+ * @brief take a reference on the oldest slice with unread data
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND if nothing is queued
+ */
+OPERATE_RET pcm_ring_peek(PCM_RING_T *ring, PCM_SLICE_T *slice);
+
+/**
+ * @brief look at the nth slice with unread data without taking a reference
+ *
+ * @note for post-processing queued pcm in place on the writer thread
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND if there are fewer slices
+ */
+OPERATE_RET pcm_ring_get(PCM_RING_T *ring, uint8_t nth, PCM_SLICE_T *slice);
+
+/**
+ * @brief mark len bytes of the slice as read
+ */
+void pcm_slice_consume(PCM_RING_T *ring, PCM_SLICE_T *slice, uint32_t len);
+
+/**
+ * @brief take another reference on a slice, e.g. to hand it to an async consumer
+ */
+void pcm_slice_get(PCM_RING_T *ring, PCM_SLICE_T *slice);
+
+/**
+ * @brief drop a reference, space is reclaimed once the slice is read and unreferenced
+ */
+void pcm_slice_put(PCM_RING_T *ring, PCM_SLICE_T *slice);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __PCM_RING_H__
@@ -19,15 +19,30 @@
 
 #include "tal_log.h"
 #include "tal_memory.h"
+#include "tal_system.h"
 #include "ai_player_resample.h"
 #include "resample_fixed.h"
 
+#define RESAMPLE_DEF_OUT_SAMPLE 16000
+
 typedef struct {
     TKL_AUDIO_SAMPLE_E sample;
     TKL_AUDIO_DATABITS_E datebits;
     TKL_AUDIO_CHANNEL_E channel;
 } RESAMPLE_CTX_T;
 
+// per player stream, filter history is kept across decoder chunks
+typedef struct {
+    RESAMPLE_STREAM_T *stream;
+    void *mem;
+    int in_rate;
+    int in_ch;
+    int out_rate;
+    int out_ch;
+    uint8_t *tmp; // output buffer when resampling in place
+    int tmp_size;
+} RESAMPLE_STREAM_CTX_T;
+
 static RESAMPLE_CTX_T s_resample_ctx = {0};
 
 OPERATE_RET ai_player_resample_init(TKL_AUDIO_SAMPLE_E sample, TKL_AUDIO_DATABITS_E datebits, TKL_AUDIO_CHANNEL_E channel)
@@ -44,21 +59,206 @@ OPERATE_RET ai_player_resample_deinit(void)
     return OPRT_OK;
 }
 
-OPERATE_RET ai_player_resample_process(uint8_t *in_buf, DECODER_OUTPUT_T *in_cfg, uint8_t *out_buf, int *out_size)
+OPERATE_RET ai_player_resample_create(PLAYER_RESAMPLE *handle)
 {
-    if(in_buf == NULL || out_buf == NULL || out_size == NULL || *out_size <= 0 || in_cfg == NULL) {
+    if (handle == NULL) {
         return OPRT_INVALID_PARM;
     }
 
-    size_t out_frames_out = 0;
-    OPERATE_RET ret = -1;
+    RESAMPLE_STREAM_CTX_T *ctx = (RESAMPLE_STREAM_CTX_T *)Malloc(sizeof(RESAMPLE_STREAM_CTX_T));
+    if (ctx == NULL) {
+        return OPRT_MALLOC_FAILED;
+    }
 
-    ret = resample_to_16k_fixed((const int16_t *)in_buf, in_cfg->samples, in_cfg->sample, in_cfg->channel, (int16_t *)out_buf, &out_frames_out);
-    if(ret == 0) {
-        *out_size = out_frames_out * 2;
+    memset(ctx, 0, sizeof(RESAMPLE_STREAM_CTX_T));
+    *handle = (PLAYER_RESAMPLE)ctx;
+    return OPRT_OK;
+}
+
+OPERATE_RET ai_player_resample_destroy(PLAYER_RESAMPLE handle)
+{
+    RESAMPLE_STREAM_CTX_T *ctx = (RESAMPLE_STREAM_CTX_T *)handle;
+    if (ctx == NULL) {
+        return OPRT_INVALID_PARM;
     }
 
-    // PR_DEBUG("resample in %d out %d", in_cfg->samples, out_frames_out);
+    if (ctx->mem) {
+        Free(ctx->mem);
+    }
+    if (ctx->tmp) {
+        Free(ctx->tmp);
+    }
+    Free(ctx);
+    return OPRT_OK;
+}
+
+OPERATE_RET ai_player_resample_reset(PLAYER_RESAMPLE handle)
+{
+    RESAMPLE_STREAM_CTX_T *ctx = (RESAMPLE_STREAM_CTX_T *)handle;
+    if (ctx == NULL) {
+        return OPRT_INVALID_PARM;
+    }
 
-    return ret;
+    resample_stream_reset(ctx->stream);
+    return OPRT_OK;
+}
+
+static OPERATE_RET __resample_stream_setup(RESAMPLE_STREAM_CTX_T *ctx, int in_rate, int in_ch, int out_rate, int out_ch)
+{
+    if (ctx->stream && ctx->in_rate == in_rate && ctx->in_ch == in_ch && ctx->out_rate == out_rate && ctx->out_ch == out_ch) {
+        return OPRT_OK;
+    }
+
+    if (ctx->mem) {
+        Free(ctx->mem);
+        ctx->mem = NULL;
+        ctx->stream = NULL;
+    }
+
+    size_t mem_size = resample_stream_mem_size(in_rate, out_rate, in_ch, out_ch);
+    if (mem_size == 0) {
+        return OPRT_NOT_SUPPORTED;
+    }
+    ctx->mem = Malloc(mem_size);
+    if (ctx->mem == NULL) {
+        return OPRT_MALLOC_FAILED;
+    }
+
+    ctx->stream = resample_stream_init(ctx->mem, mem_size, in_rate, out_rate, in_ch, out_ch);
+    ctx->in_rate = in_rate;
+    ctx->in_ch = in_ch;
+    ctx->out_rate = out_rate;
+    ctx->out_ch = out_ch;
+    PR_DEBUG("resample %d/%d -> %d/%d, taps %d, mem %d", in_rate, in_ch, out_rate, out_ch,
+             resample_stream_taps(ctx->stream), (int)mem_size);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief resample one decoder chunk to the configured sample rate
+ *
+ * @param[in] handle resample handle of the player
+ * @param[in] in_buf 16 bit pcm, can be the same buffer as out_buf
+ * @param[in] in_cfg format of in_buf
+ * @param[out] out_buf output pcm
+ * @param[in,out] out_size size of out_buf in, output bytes out
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET ai_player_resample_process(PLAYER_RESAMPLE handle, uint8_t *in_buf, DECODER_OUTPUT_T *in_cfg, uint8_t *out_buf, int *out_size)
+{
+    RESAMPLE_STREAM_CTX_T *ctx = (RESAMPLE_STREAM_CTX_T *)handle;
+
+    if(ctx == NULL || in_buf == NULL || out_buf == NULL || out_size == NULL || *out_size <= 0 || in_cfg == NULL) {
+        return OPRT_INVALID_PARM;
+    }
+    if(in_cfg->datebits != TKL_AUDIO_DATABITS_16) {
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    OPERATE_RET rt = OPRT_OK;
+    int in_ch = (int)in_cfg->channel;
+    int out_ch = (s_resample_ctx.channel == TKL_AUDIO_CHANNEL_MONO || s_resample_ctx.channel == 0) ? 1 : in_ch;
+    int out_rate = s_resample_ctx.sample ? (int)s_resample_ctx.sample : RESAMPLE_DEF_OUT_SAMPLE;
+
+    TUYA_CALL_ERR_RETURN(__resample_stream_setup(ctx, (int)in_cfg->sample, in_ch, out_rate, out_ch));
+
+    // the stream reads input block by block, so output must not overlap input
+    uint8_t *dst = out_buf;
+    uint32_t in_size = in_cfg->samples * in_ch * 2;
+    if(out_buf < in_buf + in_size && in_buf < out_buf + *out_size) {
+        if(ctx->tmp_size < *out_size) {
+            if(ctx->tmp) {
+                Free(ctx->tmp);
+            }
+            ctx->tmp_size = 0;
+            ctx->tmp = Malloc(*out_size);
+            if(ctx->tmp == NULL) {
+                return OPRT_MALLOC_FAILED;
+            }
+            ctx->tmp_size = *out_size;
+        }
+        dst = ctx->tmp;
+    }
+
+    size_t out_frames = 0;
+    int ret = resample_stream_process(ctx->stream, (const int16_t *)in_buf, in_cfg->samples, (int16_t *)dst,
+                                      *out_size / (2 * out_ch), &out_frames);
+    if(ret == -2) {
+        return OPRT_BUFFER_NOT_ENOUGH;
+    } else if(ret != 0) {
+        return OPRT_INVALID_PARM;
+    }
+
+    *out_size = out_frames * 2 * out_ch;
+    if(dst != out_buf) {
+        memcpy(out_buf, dst, *out_size);
+    }
+
+    // PR_DEBUG("resample in %d out %d", in_cfg->samples, out_frames);
+
+    return rt;
+}
+
+#if defined(AI_PLAYER_RESAMPLE_BENCHMARK) && (AI_PLAYER_RESAMPLE_BENCHMARK == 1)
+/**
+ * @brief measure resample cost of 44.1k/48k -> 16k mono
+ *
+ * @note cpu load is the time spent per second of audio, MIPS per channel is
+ * the load multiplied by the core clock in MHz
+ *
+ * @param[in] seconds seconds of audio to process per rate
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET ai_player_resample_benchmark(uint32_t seconds)
+{
+    const int in_rates[] = {44100, 48000};
+    const int out_rate = 16000;
+    const int chunk = 960; // 20ms at 48k
+    uint32_t i = 0, j = 0;
+
+    int16_t *in = Malloc(chunk * sizeof(int16_t));
+    int16_t *out = Malloc(chunk * sizeof(int16_t));
+    if(in == NULL || out == NULL) {
+        Free(in);
+        Free(out);
+        return OPRT_MALLOC_FAILED;
+    }
+
+    for(i = 0; i < chunk; i++) {
+        // two tones to keep both passband and stopband busy
+        in[i] = (int16_t)(((i * 64) & 0x3fff) - 0x2000 + ((i * 1500) & 0x1fff));
+    }
+
+    for(i = 0; i < CNTSOF(in_rates); i++) {
+        size_t mem_size = resample_stream_mem_size(in_rates[i], out_rate, 1, 1);
+        void *mem = Malloc(mem_size);
+        if(mem == NULL) {
+            break;
+        }
+        RESAMPLE_STREAM_T *rs = resample_stream_init(mem, mem_size, in_rates[i], out_rate, 1, 1);
+        uint32_t rounds = (uint32_t)((uint64_t)in_rates[i] * seconds / chunk);
+        size_t out_frames = 0, total = 0;
+
+        SYS_TIME_T start = tal_system_get_millisecond();
+        for(j = 0; j < rounds; j++) {
+            resample_stream_process(rs, in, chunk, out, chunk, &out_frames);
+            total += out_frames;
+        }
+        SYS_TIME_T cost = tal_system_get_millisecond() - start;
+
+        // cost ms per (seconds * 1000) ms of audio, in 1/10000
+        uint32_t load = (uint32_t)(cost * 10000 / (seconds * 1000));
+        PR_NOTICE("resample %d->%d: taps %d, %d kMAC/s, %u frames in %u ms, cpu %u.%02u%% per channel", in_rates[i],
+                  out_rate, resample_stream_taps(rs), resample_stream_taps(rs) * out_rate / 1000, (uint32_t)total,
+                  (uint32_t)cost, load / 100, load % 100);
+        Free(mem);
+    }
+
+    Free(in);
+    Free(out);
+    return OPRT_OK;
 }
+#endif
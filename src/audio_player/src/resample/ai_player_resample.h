@@ -26,9 +26,15 @@
 extern "C" {
 #endif
 
+typedef void* PLAYER_RESAMPLE;
+
 OPERATE_RET ai_player_resample_init(TKL_AUDIO_SAMPLE_E sample, TKL_AUDIO_DATABITS_E datebits, TKL_AUDIO_CHANNEL_E channel);
 OPERATE_RET ai_player_resample_deinit(void);
-OPERATE_RET ai_player_resample_process(uint8_t *in_buf, DECODER_OUTPUT_T *in_cfg, uint8_t *out_buf, int *out_size);
+OPERATE_RET ai_player_resample_create(PLAYER_RESAMPLE *handle);
+OPERATE_RET ai_player_resample_destroy(PLAYER_RESAMPLE handle);
+OPERATE_RET ai_player_resample_reset(PLAYER_RESAMPLE handle);
+OPERATE_RET ai_player_resample_process(PLAYER_RESAMPLE handle, uint8_t *in_buf, DECODER_OUTPUT_T *in_cfg, uint8_t *out_buf, int *out_size);
+OPERATE_RET ai_player_resample_benchmark(uint32_t seconds);
 
 #ifdef __cplusplus
 }
@@ -105,3 +105,335 @@ int resample_to_8k_fixed(const int16_t *in, size_t in_frames, int in_rate, int c
     *out_frames_out = out_frames;
     return 0;
 }
+
+/* ---------------------------------------------------------------------------
+ * Streaming polyphase resampler
+ *
+ * in_rate/out_rate = down/up after dividing by the gcd. Output sample j sits
+ * at input position j*down/up, its integer part selects the input window and
+ * the fraction (in 1/up units) selects one of the precomputed kernel phases.
+ * Input is kept planar per channel so the inner loop is a plain int16 dot
+ * product over taps, taps is a multiple of 8 for SSE2/NEON.
+ * ------------------------------------------------------------------------- */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+#include <math.h>
+
+#ifndef RESAMPLE_ZERO_CROSS
+#define RESAMPLE_ZERO_CROSS   8     /* sinc zero crossings each side, more is sharper and slower */
+#endif
+#define RESAMPLE_PHASE_MAX    256   /* with more phases the nearest lower phase is used */
+#define RESAMPLE_BLOCK_FRAMES 256   /* input frames buffered per round */
+#define RESAMPLE_CH_MAX       2
+#define RESAMPLE_CUTOFF       0.92  /* pass band edge relative to the lower nyquist */
+#define RESAMPLE_KAISER_BETA  8.0
+#define RESAMPLE_PI           3.14159265358979323846
+#define RESAMPLE_ALIGN(x)     (((x) + 15) & ~(size_t)15)
+
+struct resample_stream {
+    int in_rate;
+    int out_rate;
+    int in_ch;
+    int out_ch;
+    uint32_t up;
+    uint32_t down;
+    uint32_t step_int;  /* down / up */
+    uint32_t step_frac; /* down % up */
+    uint32_t phases;
+    uint32_t taps;
+    uint32_t phase;     /* position fraction, 0..up-1 */
+    uint32_t pos;       /* first tap of next output in hist */
+    uint32_t fill;      /* frames in hist */
+    int16_t *coef;      /* phases * taps, Q15 */
+    int16_t *hist[RESAMPLE_CH_MAX];
+};
+
+static uint32_t __gcd(uint32_t a, uint32_t b)
+{
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static uint32_t __resample_taps(int in_rate, int out_rate)
+{
+    double ratio = (in_rate > out_rate) ? (double)in_rate / out_rate : 1.0;
+    uint32_t taps = (uint32_t)ceil(2.0 * RESAMPLE_ZERO_CROSS * ratio);
+    return (taps + 7) & ~7u;
+}
+
+static uint32_t __resample_phases(int in_rate, int out_rate)
+{
+    uint32_t up = (uint32_t)out_rate / __gcd((uint32_t)in_rate, (uint32_t)out_rate);
+    return (up > RESAMPLE_PHASE_MAX) ? RESAMPLE_PHASE_MAX : up;
+}
+
+static double __bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0, q = x * x / 4.0;
+    int k;
+    for (k = 1; k < 64; ++k) {
+        term *= q / ((double)k * k);
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+/* kaiser windowed sinc low pass, t in input samples from the output position */
+static double __resample_kernel(double t, double fc, double half, double i0_beta)
+{
+    double x = t / half;
+    double v = 2.0 * fc;
+
+    if (x <= -1.0 || x >= 1.0) return 0.0;
+    if (t != 0.0) v = sin(2.0 * RESAMPLE_PI * fc * t) / (RESAMPLE_PI * t);
+    return v * __bessel_i0(RESAMPLE_KAISER_BETA * sqrt(1.0 - x * x)) / i0_beta;
+}
+
+static void __resample_kernel_build(RESAMPLE_STREAM_T *rs)
+{
+    double fc = 0.5 * RESAMPLE_CUTOFF;
+    double half = rs->taps / 2.0;
+    double i0_beta = __bessel_i0(RESAMPLE_KAISER_BETA);
+    uint32_t p, k;
+
+    if (rs->in_rate > rs->out_rate) fc = fc * rs->out_rate / rs->in_rate;
+
+    for (p = 0; p < rs->phases; ++p) {
+        /* tap k covers input (pos + k), the output sits at pos + half - 1 + frac */
+        double frac = (double)p / rs->phases, sum = 0;
+        int16_t *coef = rs->coef + (size_t)p * rs->taps;
+        int32_t qsum = 0, q = 0;
+        uint32_t peak = 0;
+
+        for (k = 0; k < rs->taps; ++k) {
+            sum += __resample_kernel((double)k - (half - 1.0) - frac, fc, half, i0_beta);
+        }
+        /* unity dc gain per phase, rounding residue goes to the peak tap */
+        for (k = 0; k < rs->taps; ++k) {
+            q = (int32_t)lround(__resample_kernel((double)k - (half - 1.0) - frac, fc, half, i0_beta) / sum * 32768.0);
+            if (q > 32767) q = 32767;
+            if (q < -32767) q = -32767;
+            coef[k] = (int16_t)q;
+            qsum += q;
+            if (coef[k] > coef[peak]) peak = k;
+        }
+        q = coef[peak] + (32768 - qsum);
+        coef[peak] = (int16_t)((q > 32767) ? 32767 : q);
+    }
+}
+
+static inline int32_t __resample_dot(const int16_t *x, const int16_t *h, uint32_t taps)
+{
+    uint32_t i;
+#if defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    for (i = 0; i < taps; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(x + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(h + i));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(a, b));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+    return _mm_cvtsi128_si32(acc);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    int32x4_t acc = vdupq_n_s32(0);
+    for (i = 0; i < taps; i += 8) {
+        int16x8_t a = vld1q_s16(x + i);
+        int16x8_t b = vld1q_s16(h + i);
+        acc = vmlal_s16(acc, vget_low_s16(a), vget_low_s16(b));
+        acc = vmlal_s16(acc, vget_high_s16(a), vget_high_s16(b));
+    }
+    int32x2_t sum = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+    return vget_lane_s32(vpadd_s32(sum, sum), 0);
+#else
+    int32_t acc0 = 0, acc1 = 0;
+    for (i = 0; i < taps; i += 2) {
+        acc0 += (int32_t)x[i] * h[i];
+        acc1 += (int32_t)x[i + 1] * h[i + 1];
+    }
+    return acc0 + acc1;
+#endif
+}
+
+size_t resample_stream_mem_size(int in_rate, int out_rate, int in_ch, int out_ch)
+{
+    if (in_rate <= 0 || out_rate <= 0 || in_ch <= 0 || out_ch <= 0 || out_ch > RESAMPLE_CH_MAX) return 0;
+    if (out_ch != in_ch && out_ch != 1) return 0;
+
+    uint32_t taps = __resample_taps(in_rate, out_rate);
+    return RESAMPLE_ALIGN(sizeof(RESAMPLE_STREAM_T)) +
+           RESAMPLE_ALIGN((size_t)__resample_phases(in_rate, out_rate) * taps * sizeof(int16_t)) +
+           (size_t)out_ch * RESAMPLE_ALIGN((taps + RESAMPLE_BLOCK_FRAMES) * sizeof(int16_t));
+}
+
+RESAMPLE_STREAM_T *resample_stream_init(void *mem, size_t mem_size, int in_rate, int out_rate, int in_ch, int out_ch)
+{
+    size_t need = resample_stream_mem_size(in_rate, out_rate, in_ch, out_ch);
+    if (!mem || need == 0 || mem_size < need) return NULL;
+
+    RESAMPLE_STREAM_T *rs = (RESAMPLE_STREAM_T *)mem;
+    uint8_t *p = (uint8_t *)mem + RESAMPLE_ALIGN(sizeof(RESAMPLE_STREAM_T));
+    uint32_t g = __gcd((uint32_t)in_rate, (uint32_t)out_rate);
+    int c;
+
+    memset(rs, 0, sizeof(RESAMPLE_STREAM_T));
+    rs->in_rate = in_rate;
+    rs->out_rate = out_rate;
+    rs->in_ch = in_ch;
+    rs->out_ch = out_ch;
+    rs->up = (uint32_t)out_rate / g;
+    rs->down = (uint32_t)in_rate / g;
+    rs->step_int = rs->down / rs->up;
+    rs->step_frac = rs->down % rs->up;
+    rs->phases = __resample_phases(in_rate, out_rate);
+    rs->taps = __resample_taps(in_rate, out_rate);
+    rs->coef = (int16_t *)p;
+    p += RESAMPLE_ALIGN((size_t)rs->phases * rs->taps * sizeof(int16_t));
+    for (c = 0; c < out_ch; ++c) {
+        rs->hist[c] = (int16_t *)p;
+        p += RESAMPLE_ALIGN((rs->taps + RESAMPLE_BLOCK_FRAMES) * sizeof(int16_t));
+    }
+
+    __resample_kernel_build(rs);
+    resample_stream_reset(rs);
+    return rs;
+}
+
+void resample_stream_reset(RESAMPLE_STREAM_T *rs)
+{
+    int c;
+    if (!rs) return;
+
+    /* half a window of silence, so the first output lines up with the first input */
+    for (c = 0; c < rs->out_ch; ++c) {
+        memset(rs->hist[c], 0, (rs->taps + RESAMPLE_BLOCK_FRAMES) * sizeof(int16_t));
+    }
+    rs->fill = rs->taps / 2 - 1;
+    rs->pos = 0;
+    rs->phase = 0;
+}
+
+size_t resample_stream_out_max(const RESAMPLE_STREAM_T *rs, size_t in_frames)
+{
+    if (!rs) return 0;
+    size_t pending = (rs->fill > rs->pos) ? rs->fill - rs->pos : 0;
+    return (size_t)(((uint64_t)(pending + in_frames) * rs->up) / rs->down) + 1;
+}
+
+int resample_stream_taps(const RESAMPLE_STREAM_T *rs)
+{
+    return rs ? (int)rs->taps : 0;
+}
+
+/* output every sample whose window is complete in hist */
+static size_t __resample_run(RESAMPLE_STREAM_T *rs, int16_t *out)
+{
+    size_t n = 0;
+    int c;
+
+    while (rs->pos + rs->taps <= rs->fill) {
+        uint32_t idx = (rs->phases == rs->up) ? rs->phase
+                                               : (uint32_t)(((uint64_t)rs->phase * rs->phases) / rs->up);
+        const int16_t *coef = rs->coef + (size_t)idx * rs->taps;
+
+        for (c = 0; c < rs->out_ch; ++c) {
+            int32_t acc = __resample_dot(rs->hist[c] + rs->pos, coef, rs->taps);
+            out[n * rs->out_ch + c] = clip16_from_i64(((int64_t)acc + (1 << 14)) >> 15);
+        }
+        ++n;
+
+        rs->pos += rs->step_int;
+        rs->phase += rs->step_frac;
+        if (rs->phase >= rs->up) {
+            rs->phase -= rs->up;
+            rs->pos++;
+        }
+    }
+    return n;
+}
+
+/* append up to one block of input (NULL for silence), return frames taken */
+static size_t __resample_feed(RESAMPLE_STREAM_T *rs, const int16_t *in, size_t in_frames)
+{
+    size_t n = rs->taps + RESAMPLE_BLOCK_FRAMES - rs->fill;
+    size_t i;
+    int c;
+
+    if (n > in_frames) n = in_frames;
+
+    if (!in) {
+        for (c = 0; c < rs->out_ch; ++c) memset(rs->hist[c] + rs->fill, 0, n * sizeof(int16_t));
+    } else if (rs->out_ch == 1 && rs->in_ch == 1) {
+        memcpy(rs->hist[0] + rs->fill, in, n * sizeof(int16_t));
+    } else if (rs->out_ch == 1) {
+        int16_t *dst = rs->hist[0] + rs->fill;
+        for (i = 0; i < n; ++i) {
+            int32_t sum = 0;
+            for (c = 0; c < rs->in_ch; ++c) sum += in[i * rs->in_ch + c];
+            dst[i] = (int16_t)((rs->in_ch == 2) ? (sum >> 1) : (sum / rs->in_ch));
+        }
+    } else {
+        for (c = 0; c < rs->out_ch; ++c) {
+            int16_t *dst = rs->hist[c] + rs->fill;
+            for (i = 0; i < n; ++i) dst[i] = in[i * rs->in_ch + c];
+        }
+    }
+    rs->fill += (uint32_t)n;
+    return n;
+}
+
+/* drop consumed history, pos may point past the buffered frames when decimating */
+static void __resample_compact(RESAMPLE_STREAM_T *rs)
+{
+    uint32_t drop = (rs->pos < rs->fill) ? rs->pos : rs->fill;
+    int c;
+
+    if (drop == 0) return;
+    for (c = 0; c < rs->out_ch; ++c) {
+        memmove(rs->hist[c], rs->hist[c] + drop, (rs->fill - drop) * sizeof(int16_t));
+    }
+    rs->fill -= drop;
+    rs->pos -= drop;
+}
+
+static int __resample_stream_push(RESAMPLE_STREAM_T *rs, const int16_t *in, size_t in_frames,
+                                  int16_t *out, size_t out_cap, size_t *out_frames)
+{
+    size_t done = 0, n = 0;
+
+    if (out_cap < resample_stream_out_max(rs, in_frames)) return -2;
+
+    while (in_frames) {
+        n = __resample_feed(rs, in, in_frames);
+        if (in) in += n * rs->in_ch;
+        in_frames -= n;
+        done += __resample_run(rs, out + done * rs->out_ch);
+        __resample_compact(rs);
+    }
+
+    *out_frames = done;
+    return 0;
+}
+
+int resample_stream_process(RESAMPLE_STREAM_T *rs, const int16_t *in, size_t in_frames,
+                            int16_t *out, size_t out_cap, size_t *out_frames)
+{
+    if (!rs || !in || !out || !out_frames) return -1;
+    return __resample_stream_push(rs, in, in_frames, out, out_cap, out_frames);
+}
+
+int resample_stream_flush(RESAMPLE_STREAM_T *rs, int16_t *out, size_t out_cap, size_t *out_frames)
+{
+    if (!rs || !out || !out_frames) return -1;
+    int ret = __resample_stream_push(rs, NULL, rs->taps / 2, out, out_cap, out_frames);
+    if (ret == 0) resample_stream_reset(rs);
+    return ret;
+}
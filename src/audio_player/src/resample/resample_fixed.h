@@ -20,6 +20,35 @@ int resample_to_16k_fixed(const int16_t *in, size_t in_frames, int in_rate, int
 int resample_to_8k_fixed(const int16_t *in, size_t in_frames, int in_rate, int channels,
                          int16_t *out_buf_out, size_t *out_frames_out);
 
+/* Streaming polyphase windowed-sinc resampler, Q15 kernels, int16 in/out.
+ * Any in/out rate pair. Filter history and phase are kept between calls, so
+ * a stream can be fed in chunks of any size without clicks at the borders.
+ * out_ch must be equal to in_ch, or 1 to downmix. The object lives in caller
+ * memory of resample_stream_mem_size() bytes.
+ * Return 0 on success, -1 on invalid param, -2 if out buffer is too small.
+ */
+typedef struct resample_stream RESAMPLE_STREAM_T;
+
+size_t resample_stream_mem_size(int in_rate, int out_rate, int in_ch, int out_ch);
+
+RESAMPLE_STREAM_T *resample_stream_init(void *mem, size_t mem_size, int in_rate, int out_rate, int in_ch, int out_ch);
+
+/* drop history, next sample starts a new stream */
+void resample_stream_reset(RESAMPLE_STREAM_T *rs);
+
+/* max output frames for in_frames more input frames */
+size_t resample_stream_out_max(const RESAMPLE_STREAM_T *rs, size_t in_frames);
+
+/* taps per phase of the kernel, a multiply-accumulate per tap per output sample */
+int resample_stream_taps(const RESAMPLE_STREAM_T *rs);
+
+/* in and out must not overlap */
+int resample_stream_process(RESAMPLE_STREAM_T *rs, const int16_t *in, size_t in_frames,
+                            int16_t *out, size_t out_cap, size_t *out_frames);
+
+/* output the samples held back by the filter delay at end of stream */
+int resample_stream_flush(RESAMPLE_STREAM_T *rs, int16_t *out, size_t out_cap, size_t *out_frames);
+
 #ifdef __cplusplus
 }
 #endif
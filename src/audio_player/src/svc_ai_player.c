@@ -34,7 +34,8 @@ static char *s_player_cmd_str[PLAYER_CMD_MAX] = {
     "PAUSE",
     "RESUME",
     "EXIT",
-    "DEINIT"
+    "DEINIT",
+    "PRELOAD"
 };
 
 static char *s_player_mode_str[AI_PLAYER_MODE_MAX] = {
@@ -56,9 +57,6 @@ typedef struct {
     bool mute;
     bool mixer_mode;
     bool decoder_mode;
-    uint8_t *mixer_buf; // AI_PLAYER_DECODEBUF_SIZE
-    uint32_t mixer_offset;
-    uint32_t mixer_flag; // 0-null, 1-fg, 2-bg
 } AI_PLAYER_CTX_T;
 
 static AI_PLAYER_CTX_T s_ai_player_ctx = {0};
@@ -98,18 +96,40 @@ static void __switch_player_mode(void)
     }
 }
 
+static void __player_drop_next(AI_PLAYER_T *player)
+{
+    AI_PLAYER_NEXT_T *next = &player->next;
+
+    if(next->armed) {
+        ai_player_datasink_stop(next->sink);
+        ai_player_decoder_stop(next->decoder);
+        next->armed = false;
+    }
+    next->current = false;
+    next->pcm_len = 0;
+    next->pcm_rd = 0;
+    player->hold_release = false;
+}
+
 static OPERATE_RET __cmd_player_start(AI_PLAYER_T *player, AI_PLAYER_MSG_T *msg)
 {
     OPERATE_RET rt = OPRT_OK;
 
     PR_DEBUG("start player %s value=%s", s_player_mode_str[player->mode], msg->param.cmd_start.value ? msg->param.cmd_start.value : "null");
 
+    __player_drop_next(player);
+
     TUYA_CALL_ERR_RETURN(ai_player_datasink_start(player->sink, msg->param.cmd_start.src, msg->param.cmd_start.value));
     TUYA_CALL_ERR_RETURN(ai_player_decoder_start(player->decoder, msg->param.cmd_start.codec));
 
     player->state = AI_PLAYER_PLAYING;
     player->offset = 0;
     player->has_pending_output = FALSE;
+    ai_player_resample_reset(player->resample);
+    pcm_ring_reset(player->pcm);
+    memset(&player->stat, 0, SIZEOF(AI_PLAYER_STAT_T));
+    player->start_ms = tal_system_get_millisecond();
+    player->first_audio = false;
     if(msg->param.cmd_start.value) {
         Free(msg->param.cmd_start.value);
     }
@@ -132,11 +152,14 @@ static OPERATE_RET __cmd_player_stop(AI_PLAYER_T *player)
 {
     PR_DEBUG("stop player %s", s_player_mode_str[player->mode]);
 
+    __player_drop_next(player);
     ai_player_datasink_stop(player->sink);
     ai_player_decoder_stop(player->decoder);
     player->state = AI_PLAYER_STOPPED;
     player->offset = 0;
     player->has_pending_output = FALSE;
+    ai_player_resample_reset(player->resample);
+    pcm_ring_reset(player->pcm);
     if(player->playlist && player->playlist_cb) {
         player->playlist_cb(player->playlist, player->state);
     }
@@ -179,14 +202,100 @@ static OPERATE_RET __cmd_player_resume(AI_PLAYER_T *player)
     return OPRT_OK;
 }
 
+static OPERATE_RET __cmd_player_preload(AI_PLAYER_T *player, AI_PLAYER_MSG_T *msg)
+{
+    OPERATE_RET rt = OPRT_OK;
+    AI_PLAYER_NEXT_T *next = &player->next;
+
+    PR_DEBUG("preload player %s value=%s", s_player_mode_str[player->mode], msg->param.cmd_start.value ? msg->param.cmd_start.value : "null");
+
+    // a failed preload only costs the gap, the playing item goes on
+    if((0 == next->pcm_size) || !s_ai_player_ctx.decoder_mode || (player->state == AI_PLAYER_STOPPED)) {
+        goto EXIT;
+    }
+
+    if(next->armed) {
+        ai_player_datasink_stop(next->sink);
+        ai_player_decoder_stop(next->decoder);
+        next->armed = false;
+        if(!next->current) {
+            next->pcm_len = 0;
+            next->pcm_rd = 0;
+        }
+    }
+    if(NULL == msg->param.cmd_start.value) {
+        goto EXIT; // only drop the preloaded item
+    }
+
+    // kept until the player exits, the finished item's sink and decoder are swapped in at every switch
+    if(!next->sink) {
+        TUYA_CALL_ERR_GOTO(ai_player_datasink_init(&next->sink), EXIT);
+    }
+    if(!next->decoder) {
+        TUYA_CALL_ERR_GOTO(ai_player_decoder_init(&next->decoder), EXIT);
+    }
+    if(!next->framebuf) {
+        next->framebuf = Malloc(AI_PLAYER_FRAMEBUF_SIZE);
+        TUYA_CHECK_NULL_GOTO(next->framebuf, EXIT);
+    }
+    if(!next->pcm) {
+        next->pcm = Malloc(next->pcm_size);
+        TUYA_CHECK_NULL_GOTO(next->pcm, EXIT);
+    }
+
+    TUYA_CALL_ERR_GOTO(ai_player_datasink_start(next->sink, msg->param.cmd_start.src, msg->param.cmd_start.value), EXIT);
+    rt = ai_player_decoder_start(next->decoder, msg->param.cmd_start.codec);
+    if(OPRT_OK != rt) {
+        ai_player_datasink_stop(next->sink);
+        goto EXIT;
+    }
+
+    next->armed = true;
+    next->eof = false;
+    next->has_pending_output = false;
+    next->offset = 0;
+    if(!next->current) {
+        next->pcm_len = 0;
+        next->pcm_rd = 0;
+    }
+
+EXIT:
+    if(OPRT_OK != rt) {
+        PR_ERR("ai player %s preload error: %d", s_player_mode_str[player->mode], rt);
+    }
+    if(msg->param.cmd_start.value) {
+        Free(msg->param.cmd_start.value);
+    }
+    return OPRT_OK;
+}
+
 static OPERATE_RET __cmd_player_exit(AI_PLAYER_T *player)
 {
+    AI_PLAYER_NEXT_T *next = &player->next;
+
     ai_player_datasink_deinit(player->sink);
     ai_player_decoder_deinit(player->decoder);
+    ai_player_resample_destroy(player->resample);
     s_ai_player_ctx.player[player->mode] = NULL;
 
+    if(next->sink) {
+        ai_player_datasink_deinit(next->sink);
+    }
+    if(next->decoder) {
+        ai_player_decoder_deinit(next->decoder);
+    }
+    if(next->framebuf) {
+        Free(next->framebuf);
+    }
+    if(next->pcm) {
+        Free(next->pcm);
+    }
+
     Free(player->framebuf);
-    Free(player->decode_buf);
+    pcm_ring_destroy(player->pcm);
+    if(player->decode_buf) {
+        Free(player->decode_buf);
+    }
     Free(player);
     return OPRT_OK;
 }
@@ -204,11 +313,6 @@ static OPERATE_RET __cmd_player_service_deinit(void)
     tal_queue_free(s_ai_player_ctx.queue);
     ai_player_resample_deinit();
 
-    if(s_ai_player_ctx.mixer_buf) {
-        Free(s_ai_player_ctx.mixer_buf);
-        s_ai_player_ctx.mixer_buf = NULL;
-    }
-
     if(s_ai_player_ctx.consumer.close) {
         s_ai_player_ctx.consumer.close(s_ai_player_ctx.consumer_handle);
     }
@@ -218,19 +322,437 @@ static OPERATE_RET __cmd_player_service_deinit(void)
 }
 
 
+static void __stat_stage(AI_PLAYER_T *player, AI_PLAYER_STAGE_E stage, SYS_TIME_T start, uint32_t bytes, uint32_t copy_bytes)
+{
+    AI_PLAYER_STAGE_STAT_T *st = &player->stat.stage[stage];
+    uint32_t cost = (uint32_t)(tal_system_get_millisecond() - start);
+
+    st->time_ms += cost;
+    if(cost > st->max_ms) {
+        st->max_ms = cost;
+    }
+    st->bytes += bytes;
+    st->copy_bytes += copy_bytes;
+}
+
+static void __stat_first_audio(AI_PLAYER_T *player)
+{
+    if(!player->first_audio) {
+        player->first_audio = true;
+        player->stat.first_audio_ms = (uint32_t)(tal_system_get_millisecond() - player->start_ms);
+        PR_DEBUG("ai player %s first audio %u ms", s_player_mode_str[player->mode], player->stat.first_audio_ms);
+    }
+}
+
+// decoder output size that still fits pcm_cap once resampled, based on the previous chunk
+static uint32_t __resample_in_size(AI_PLAYER_T *player, uint32_t pcm_cap)
+{
+    DECODER_OUTPUT_T *fmt = &player->resample_fmt;
+    uint32_t in_ch = fmt->channel ? fmt->channel : 1;
+    uint32_t out_ch = (s_ai_player_ctx.cfg.channel > TKL_AUDIO_CHANNEL_MONO) ? in_ch : 1;
+    uint64_t in_rate = (uint64_t)fmt->sample * in_ch;
+    uint64_t out_rate = (uint64_t)s_ai_player_ctx.cfg.sample * out_ch;
+    uint32_t size = pcm_cap;
+
+    if(in_rate && out_rate && in_rate < out_rate) {
+        // keep two output frames for filter phase rounding
+        uint32_t out_frames = pcm_cap / (2 * out_ch);
+        out_frames = (out_frames > 2) ? out_frames - 2 : 0;
+        size = (uint32_t)(out_frames * in_rate / out_rate) * 2;
+    }
+    size -= size % (2 * in_ch);
+
+    return (size > AI_PLAYER_DECODEBUF_SIZE) ? AI_PLAYER_DECODEBUF_SIZE : size;
+}
+
+// hand the queued pcm of a player to the consumer in place
+static void __player_output(AI_PLAYER_T *player, PCM_SLICE_T *slice, uint32_t len)
+{
+    SYS_TIME_T start = tal_system_get_millisecond();
+
+    if(s_ai_player_ctx.consumer.write) {
+        s_ai_player_ctx.consumer.write(s_ai_player_ctx.consumer_handle, slice->data, len);
+    }
+    __stat_stage(player, AI_PLAYER_STAGE_OUTPUT, start, len, 0);
+    __stat_first_audio(player);
+}
+
+// bytes of the current item kept queued to crossfade into the preloaded one, 0 for a gapless switch
+static uint32_t __player_crossfade_size(AI_PLAYER_T *player)
+{
+    AI_PLAYER_NEXT_T *next = &player->next;
+    uint32_t frame = s_ai_player_ctx.cfg.channel * 2;
+    uint32_t size = 0;
+
+    if(!next->armed || next->current || 0 == next->crossfade_ms || 0 == next->pcm_len ||
+       s_ai_player_ctx.cfg.datebits != TKL_AUDIO_DATABITS_16 || next->fmt.sample != s_ai_player_ctx.cfg.sample ||
+       next->fmt.channel != s_ai_player_ctx.cfg.channel || next->fmt.datebits != s_ai_player_ctx.cfg.datebits) {
+        return 0;
+    }
+
+    size = (uint32_t)((uint64_t)next->crossfade_ms * s_ai_player_ctx.cfg.sample / 1000) * frame;
+    // the ring has to take one more decoder frame next to the tail
+    if(size > AI_PLAYER_DECODEBUF_SIZE - PLAYER_PCM_RESERVE_MIN) {
+        size = AI_PLAYER_DECODEBUF_SIZE - PLAYER_PCM_RESERVE_MIN;
+    }
+    if(size > next->pcm_len) {
+        size = next->pcm_len;
+    }
+
+    return size - size % frame;
+}
+
+static void __player_output_all(AI_PLAYER_T *player)
+{
+    PCM_SLICE_T slice;
+    uint32_t hold = __player_crossfade_size(player);
+    uint32_t used = 0, len = 0;
+
+    while(OPRT_OK == pcm_ring_peek(player->pcm, &slice)) {
+        used = pcm_ring_used(player->pcm);
+        len = (used > hold) ? used - hold : 0;
+        if(player->hold_release) {
+            // a partly read slice keeps its space, give up the oldest one so the decoder can go on
+            player->hold_release = false;
+            len = slice.len;
+        }
+        len = (len > slice.len) ? slice.len : len;
+        if(0 == len) {
+            pcm_slice_put(player->pcm, &slice);
+            break;
+        }
+        __player_output(player, &slice, len);
+        pcm_slice_consume(player->pcm, &slice, len);
+        pcm_slice_put(player->pcm, &slice);
+    }
+}
+
+static OPERATE_RET __handle_player_streaming_raw(AI_PLAYER_T *player, uint8_t *pcm, uint32_t pcm_cap)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t out_len = 0;
+    SYS_TIME_T start = tal_system_get_millisecond();
+
+    // the datasink writes straight into the ring, framebuf only holds data left by decoder mode
+    if(player->offset) {
+        out_len = (player->offset > pcm_cap) ? pcm_cap : player->offset;
+        memcpy(pcm, player->framebuf, out_len);
+        player->offset -= out_len;
+        memmove(player->framebuf, player->framebuf + out_len, player->offset);
+        __stat_stage(player, AI_PLAYER_STAGE_SINK, start, out_len, out_len + player->offset);
+        return pcm_ring_commit(player->pcm, out_len);
+    }
+
+    rt = ai_player_datasink_read(player->sink, pcm, pcm_cap, &out_len);
+    ai_player_datasink_get_stat(player->sink, &player->stat.sink);
+    if(OPRT_NOT_FOUND == rt) {
+        if(0 == pcm_ring_used(player->pcm)) {
+            PR_NOTICE("ai player %s eof", s_player_mode_str[player->mode]);
+
+            __cmd_player_stop(player);
+            __switch_player_mode();
+        }
+        return OPRT_OK;
+    } else if(OPRT_OK != rt) {
+        PR_ERR("ai player %s datasink read error: %d", s_player_mode_str[player->mode], rt);
+        return rt;
+    }
+    __stat_stage(player, AI_PLAYER_STAGE_SINK, start, out_len, out_len);
+
+    if(0 == out_len) {
+        tal_system_sleep(10);
+        return OPRT_OK;
+    }
+
+    return pcm_ring_commit(player->pcm, out_len);
+}
+
+// decode the head of the preloaded item into its look-ahead buffer while the current one plays
+static void __player_preload_step(AI_PLAYER_T *player)
+{
+    OPERATE_RET rt = OPRT_OK;
+    AI_PLAYER_NEXT_T *next = &player->next;
+    DECODER_OUTPUT_T output;
+    uint32_t out_len = 0;
+
+    if(!next->armed) {
+        return;
+    }
+    if(next->current) {
+        if(next->pcm_rd < next->pcm_len) {
+            return; // the playing item still drains the buffer
+        }
+        next->current = false;
+        next->pcm_len = 0;
+        next->pcm_rd = 0;
+    }
+    if(next->pcm_size - next->pcm_len < PLAYER_PCM_RESERVE_MIN) {
+        return; // budget used up
+    }
+
+    if(!next->has_pending_output && !next->eof) {
+        rt = ai_player_datasink_read(next->sink, next->framebuf + next->offset, AI_PLAYER_FRAMEBUF_SIZE - next->offset, &out_len);
+        if(OPRT_OK == rt) {
+            next->offset += out_len;
+        } else if(OPRT_NOT_FOUND == rt) {
+            next->eof = true;
+        } else {
+            // the item is started again the usual way once the current one ends
+            PR_ERR("ai player %s preload read error: %d", s_player_mode_str[player->mode], rt);
+            __player_drop_next(player);
+            return;
+        }
+    }
+
+    if(0 == next->offset && !next->has_pending_output) {
+        return;
+    }
+
+    memset(&output, 0, SIZEOF(DECODER_OUTPUT_T));
+    rt = ai_player_decoder_process(next->decoder, next->framebuf, next->offset, next->pcm + next->pcm_len,
+                                   next->pcm_size - next->pcm_len, &output);
+    next->has_pending_output = (rt == OPRT_BUFFER_NOT_ENOUGH);
+    if(rt > 0) {
+        if((rt == next->offset) && next->eof) {
+            next->offset = 0;
+        } else {
+            memmove(next->framebuf, next->framebuf + (next->offset - rt), rt);
+            next->offset = rt;
+        }
+    } else {
+        next->offset = 0;
+        if(rt < 0) {
+            return;
+        }
+    }
+
+    if(output.sample == 0 || output.used_size == 0) {
+        return;
+    }
+    if(0 == next->pcm_len) {
+        memcpy(&next->fmt, &output, SIZEOF(DECODER_OUTPUT_T));
+    } else if(output.sample != next->fmt.sample || output.channel != next->fmt.channel || output.datebits != next->fmt.datebits) {
+        PR_WARN("ai player %s preload format changed, %u bytes dropped", s_player_mode_str[player->mode], output.used_size);
+        return;
+    }
+    next->pcm_len += output.used_size;
+}
+
+// hand pcm decoded ahead to the resample and mix steps as if the decoder just produced it
+static void __player_take_predecoded(AI_PLAYER_T *player, uint8_t *dec_buf, uint32_t dec_size, DECODER_OUTPUT_T *output)
+{
+    AI_PLAYER_NEXT_T *next = &player->next;
+    uint32_t frame = (next->fmt.datebits / 8) * (next->fmt.channel ? next->fmt.channel : 1);
+    uint32_t len = next->pcm_len - next->pcm_rd;
+
+    frame = frame ? frame : 2;
+    len = (len > dec_size) ? dec_size : len;
+    len -= len % frame;
+    memcpy(dec_buf, next->pcm + next->pcm_rd, len);
+    next->pcm_rd += len;
+
+    memcpy(output, &next->fmt, SIZEOF(DECODER_OUTPUT_T));
+    output->used_size = len;
+    output->samples = len / frame;
+    player->stat.stage[AI_PLAYER_STAGE_DECODE].copy_bytes += len;
+}
+
+// mix the head of the preloaded item into the tail of the current one still queued in the ring
+static void __player_crossfade(AI_PLAYER_T *player)
+{
+    AI_PLAYER_NEXT_T *next = &player->next;
+    PCM_SLICE_T slice;
+    uint32_t size = __player_crossfade_size(player);
+    uint32_t used = pcm_ring_used(player->pcm);
+    uint32_t skip = 0, len = 0;
+    uint8_t nth = 0;
+    int32_t volume = AI_MIXER_UNITY;
+    SYS_TIME_T start = tal_system_get_millisecond();
+
+    size = (size > used) ? used : size;
+    if(0 == size) {
+        return;
+    }
+    skip = used - size;
+
+#if defined(AI_PLAYER_SUPPORT_DIGITAL_VOLUME) && (AI_PLAYER_SUPPORT_DIGITAL_VOLUME == 1)
+    // the queued tail is already scaled, the head is not
+    volume = player->gain.gain;
+#endif
+    ai_mixer_gain_ramp(&player->fade_out, AI_MIXER_UNITY, 0, size / 2);
+    ai_mixer_gain_ramp(&player->fade_in, 0, volume, size / 2);
+
+    while(size && OPRT_OK == pcm_ring_get(player->pcm, nth++, &slice)) {
+        if(skip >= slice.len) {
+            skip -= slice.len;
+            continue;
+        }
+        len = slice.len - skip;
+        len = (len > size) ? size : len;
+
+        AI_MIXER_INPUT_T input[2] = {
+            {(const int16_t *)(slice.data + skip), &player->fade_out},
+            {(const int16_t *)(next->pcm + next->pcm_rd), &player->fade_in},
+        };
+        ai_mixer_process(input, 2, (int16_t *)(slice.data + skip), len / 2);
+        next->pcm_rd += len;
+        size -= len;
+        skip = 0;
+    }
+    __stat_stage(player, AI_PLAYER_STAGE_MIX, start, 0, 0);
+    PR_DEBUG("ai player %s crossfade %u ms", s_player_mode_str[player->mode], next->crossfade_ms);
+}
+
+// the preloaded item takes over, pcm of the current item still queued in the ring plays out first
+static void __player_switch_next(AI_PLAYER_T *player)
+{
+    AI_PLAYER_NEXT_T *next = &player->next;
+    PLAYER_DATASINK sink = player->sink;
+    PLAYER_DECODER decoder = player->decoder;
+    uint8_t *framebuf = player->framebuf;
+
+    PR_NOTICE("ai player %s eof, preloaded item takes over", s_player_mode_str[player->mode]);
+
+    ai_player_datasink_stop(sink);
+    ai_player_decoder_stop(decoder);
+
+    player->sink = next->sink;
+    player->decoder = next->decoder;
+    player->framebuf = next->framebuf;
+    player->offset = next->offset;
+    player->has_pending_output = next->has_pending_output;
+    ai_player_resample_reset(player->resample);
+
+    next->sink = sink;
+    next->decoder = decoder;
+    next->framebuf = framebuf;
+    next->offset = 0;
+    next->armed = false;
+    next->current = true;
+
+    if(player->playlist && player->playlist_cb) {
+        player->playlist_cb(player->playlist, AI_PLAYER_PLAYING);
+    }
+}
+
+// resample, adjust and queue one chunk of decoder output
+static OPERATE_RET __handle_player_pcm(AI_PLAYER_T *player, uint8_t *dec_buf, DECODER_OUTPUT_T *decoded, uint8_t *pcm, uint32_t pcm_cap)
+{
+    OPERATE_RET rt = OPRT_OK;
+    DECODER_OUTPUT_T output;
+    uint32_t pcm_len = 0;
+    SYS_TIME_T start = 0;
+
+    memcpy(&output, decoded, SIZEOF(DECODER_OUTPUT_T));
+
+    // 3. Resample data if needed
+    pcm_len = output.used_size;
+    if(output.channel == s_ai_player_ctx.cfg.channel && output.sample  == s_ai_player_ctx.cfg.sample && output.datebits == s_ai_player_ctx.cfg.datebits) {
+        // No need to resample
+        if(player->resample_on) {
+            // the format changed back, this chunk was decoded aside
+            player->resample_on = false;
+            pcm_len = (pcm_len > pcm_cap) ? pcm_cap : pcm_len;
+            memcpy(pcm, dec_buf, pcm_len);
+            player->stat.stage[AI_PLAYER_STAGE_RESAMPLE].copy_bytes += pcm_len;
+        }
+    } else {
+#if defined(AI_PLAYER_SUPPORT_RESAMPLE) && (AI_PLAYER_SUPPORT_RESAMPLE == 1)
+        if(!player->resample_on) {
+            // first chunk of a resampled stream was decoded into the ring, move it aside
+            if(!player->decode_buf) {
+                player->decode_buf = Malloc(AI_PLAYER_DECODEBUF_SIZE);
+                if(!player->decode_buf) {
+                    return OPRT_MALLOC_FAILED;
+                }
+            }
+            memcpy(player->decode_buf, pcm, output.used_size);
+            player->stat.stage[AI_PLAYER_STAGE_RESAMPLE].copy_bytes += output.used_size;
+            player->resample_on = true;
+        }
+        memcpy(&player->resample_fmt, &output, SIZEOF(DECODER_OUTPUT_T));
+
+        start = tal_system_get_millisecond();
+        int out_size = (int)pcm_cap;
+        rt = ai_player_resample_process(player->resample, player->decode_buf, &output, pcm, &out_size);
+        if(OPRT_OK != rt) {
+            PR_ERR("ai player %s resample error: %d", s_player_mode_str[player->mode], rt);
+            return rt;
+        }
+        pcm_len = (uint32_t)out_size;
+        __stat_stage(player, AI_PLAYER_STAGE_RESAMPLE, start, pcm_len, 0);
+#else
+        PR_ERR("ai player %s resample not support!", s_player_mode_str[player->mode]);
+        return OPRT_NOT_SUPPORTED;
+#endif
+    }
+
+#if defined(AI_PLAYER_SUPPORT_DIGITAL_VOLUME) && (AI_PLAYER_SUPPORT_DIGITAL_VOLUME == 1)
+    // 4. Adjust volume in place, a changed volume is ramped to avoid zipper noise
+    ai_mixer_gain_set(&player->gain, player->volume, PLAYER_MAX_VOLUME);
+    if(!ai_mixer_gain_is_unity(&player->gain) && s_ai_player_ctx.cfg.datebits == TKL_AUDIO_DATABITS_16) {
+        start = tal_system_get_millisecond();
+        ai_mixer_gain_apply(&player->gain, (int16_t *)pcm, pcm_len / 2);
+        __stat_stage(player, AI_PLAYER_STAGE_MIX, start, 0, 0);
+    }
+#endif
+
+    // 5. Queue the pcm for the mixer and consumer
+    return pcm_ring_commit(player->pcm, pcm_len);
+}
+
 static OPERATE_RET __handle_player_streaming_source(AI_PLAYER_T *player)
 {
     OPERATE_RET rt = OPRT_OK;
     bool is_eof = false;
+    uint8_t *pcm = NULL;
+    uint32_t pcm_cap = 0;
+    SYS_TIME_T start = 0;
+
+    if(s_ai_player_ctx.decoder_mode) {
+        __player_preload_step(player);
+    }
+
+    // 0. Reserve pcm space in the ring, nothing is read until queued pcm is played out
+    rt = pcm_ring_reserve(player->pcm, s_ai_player_ctx.decoder_mode ? PLAYER_PCM_RESERVE_MIN : PLAYER_RAW_RESERVE_MIN,
+                          &pcm, &pcm_cap);
+    if(OPRT_OK != rt) {
+        player->hold_release = (0 != __player_crossfade_size(player));
+        return OPRT_OK;
+    }
+
+    if(!s_ai_player_ctx.decoder_mode) {
+        return __handle_player_streaming_raw(player, pcm, pcm_cap);
+    }
+
+    uint8_t *dec_buf = pcm;
+    uint32_t dec_size = pcm_cap;
+    if(player->resample_on) {
+        dec_buf = player->decode_buf;
+        dec_size = __resample_in_size(player, pcm_cap);
+    }
 
-    player->decode_size = 0;
+    DECODER_OUTPUT_T output = {0};
+    memset(&output, 0, SIZEOF(DECODER_OUTPUT_T));
+
+    // Pcm decoded ahead while this item was preloaded goes first
+    if(player->next.current && (player->next.pcm_rd < player->next.pcm_len)) {
+        __player_take_predecoded(player, dec_buf, dec_size, &output);
+        if(0 == output.used_size) {
+            return OPRT_OK;
+        }
+        return __handle_player_pcm(player, dec_buf, &output, pcm, pcm_cap);
+    }
 
     // 1. Read data from datasink (skip if decoder has pending output)
     if (!player->has_pending_output) {
         uint32_t out_len = 0;
+        start = tal_system_get_millisecond();
         rt = ai_player_datasink_read(player->sink, player->framebuf + player->offset, AI_PLAYER_FRAMEBUF_SIZE - player->offset, &out_len);
+        ai_player_datasink_get_stat(player->sink, &player->stat.sink);
         if(OPRT_OK == rt) {
             player->offset += out_len;
+            __stat_stage(player, AI_PLAYER_STAGE_SINK, start, out_len, out_len);
         } else if(OPRT_NOT_FOUND == rt) {
             is_eof = true;
         } else {
@@ -240,7 +762,14 @@ static OPERATE_RET __handle_player_streaming_source(AI_PLAYER_T *player)
     }
 
     if(0 == player->offset && !player->has_pending_output) {
-        if(is_eof) {
+        if(is_eof && player->next.armed) {
+            // no need to wait for the queued pcm, the next item is appended right after it
+            __player_crossfade(player);
+            __player_switch_next(player);
+            return OPRT_OK;
+        }
+        if(is_eof && 0 == pcm_ring_used(player->pcm)) {
+            // stop once the queued pcm has been played
             PR_NOTICE("ai player %s eof", s_player_mode_str[player->mode]);
 
             __cmd_player_stop(player);
@@ -250,27 +779,21 @@ static OPERATE_RET __handle_player_streaming_source(AI_PLAYER_T *player)
         return OPRT_OK;
     }
 
-    if(!s_ai_player_ctx.decoder_mode) {
-        player->decode_size = (player->offset > AI_PLAYER_DECODEBUF_SIZE) ? AI_PLAYER_DECODEBUF_SIZE : player->offset;
-        memcpy(player->decode_buf, player->framebuf, player->decode_size);
-        player->offset -= player->decode_size;
-        return OPRT_OK;
-    }
-
-    // 2. Decode data
-    DECODER_OUTPUT_T output = {0};
-    memset(&output, 0, SIZEOF(DECODER_OUTPUT_T));
-    rt = ai_player_decoder_process(player->decoder, player->framebuf, player->offset, player->decode_buf, AI_PLAYER_DECODEBUF_SIZE, &output);
+    // 2. Decode data, straight into the ring unless the stream is resampled
+    start = tal_system_get_millisecond();
+    rt = ai_player_decoder_process(player->decoder, player->framebuf, player->offset, dec_buf, dec_size, &output);
 
     // Update player's pending output flag based on decoder return value
     player->has_pending_output = (rt == OPRT_BUFFER_NOT_ENOUGH);
 
+    uint32_t moved = 0;
     if(rt > 0) { // buf is not completely consumed
         if((rt == player->offset) && is_eof) {
             player->offset = 0; // all data consumed and eof
         } else {
             memmove(player->framebuf, player->framebuf + (player->offset - rt), rt);
             player->offset = rt;
+            moved = rt;
         }
     } else if (rt == 0) {
         player->offset = 0;
@@ -278,132 +801,49 @@ static OPERATE_RET __handle_player_streaming_source(AI_PLAYER_T *player)
         player->offset = 0;
         return OPRT_OK;
     }
+    __stat_stage(player, AI_PLAYER_STAGE_DECODE, start, output.used_size, moved);
 
     if(output.sample == 0) {
         return OPRT_OK; //id3 tag?
     }
 
-#if defined(AI_PLAYER_SUPPORT_DIGITAL_VOLUME) && (AI_PLAYER_SUPPORT_DIGITAL_VOLUME == 1)
-    // 3. Adjust volume
-    if(player->volume != PLAYER_MAX_VOLUME) {
-        ai_player_volume_process(player->decode_buf, output.used_size, player->volume, PLAYER_MAX_VOLUME, output.datebits);
-    }
-#endif
-
-    // 4. Resample data if needed
-    player->decode_size = output.used_size;
-    if(output.channel == s_ai_player_ctx.cfg.channel && output.sample  == s_ai_player_ctx.cfg.sample && output.datebits == s_ai_player_ctx.cfg.datebits) {
-        // No need to resample
-    } else {
-#if defined(AI_PLAYER_SUPPORT_RESAMPLE) && (AI_PLAYER_SUPPORT_RESAMPLE == 1)
-        rt = ai_player_resample_process(player->decode_buf, &output, player->decode_buf, (int *)&player->decode_size);
-        if(OPRT_OK != rt) {
-            PR_ERR("ai player %s resample error: %d", s_player_mode_str[player->mode], rt);
-            return rt;
-        }
-#else
-        PR_ERR("ai player %s resample not support!", s_player_mode_str[player->mode]);
-        return OPRT_NOT_SUPPORTED;
-#endif
-    }
-
-    return OPRT_OK;
+    return __handle_player_pcm(player, dec_buf, &output, pcm, pcm_cap);
 }
 
 #if defined(AI_PLAYER_SUPPORT_MIX_MODE) && (AI_PLAYER_SUPPORT_MIX_MODE == 1)
-static OPERATE_RET __handle_player_streaming_mix(AI_PLAYER_T *fg_player, AI_PLAYER_T *bg_player)
+static void __handle_player_streaming_mix(AI_PLAYER_T *fg_player, AI_PLAYER_T *bg_player)
 {
-    uint32_t samples = 0;
-
-    if(fg_player && bg_player) {
-        if(fg_player->decode_size >= bg_player->decode_size) {
-            samples = bg_player->decode_size/2;
-            ai_player_mixer_process(bg_player->decode_buf, fg_player->decode_buf, samples);
-            if(s_ai_player_ctx.consumer.write) {
-                s_ai_player_ctx.consumer.write(s_ai_player_ctx.consumer_handle, fg_player->decode_buf, samples*2);
-            }
-            s_ai_player_ctx.mixer_offset = fg_player->decode_size - bg_player->decode_size;
-            if(s_ai_player_ctx.mixer_offset) {
-                memmove(s_ai_player_ctx.mixer_buf, fg_player->decode_buf + bg_player->decode_size, s_ai_player_ctx.mixer_offset);
-                s_ai_player_ctx.mixer_flag = 1;
-            } else {
-                s_ai_player_ctx.mixer_flag = 0;
-            }
-        } else {
-            samples = fg_player->decode_size/2;
-            ai_player_mixer_process(bg_player->decode_buf, fg_player->decode_buf, samples);
-            if(s_ai_player_ctx.consumer.write) {
-                s_ai_player_ctx.consumer.write(s_ai_player_ctx.consumer_handle, fg_player->decode_buf, samples*2);
-            }
-            s_ai_player_ctx.mixer_offset = bg_player->decode_size - fg_player->decode_size;
-            if(s_ai_player_ctx.mixer_offset) {
-                memmove(s_ai_player_ctx.mixer_buf, bg_player->decode_buf + fg_player->decode_size, s_ai_player_ctx.mixer_offset);
-                s_ai_player_ctx.mixer_flag = 2;
-            } else {
-                s_ai_player_ctx.mixer_flag = 0;
-            }
-        }
-    } else if(fg_player) {
-        if(fg_player->decode_size >= s_ai_player_ctx.mixer_offset) {
-            samples = s_ai_player_ctx.mixer_offset/2;
-            ai_player_mixer_process(s_ai_player_ctx.mixer_buf, fg_player->decode_buf, samples);
-            if(s_ai_player_ctx.consumer.write) {
-                s_ai_player_ctx.consumer.write(s_ai_player_ctx.consumer_handle, fg_player->decode_buf, samples*2);
-            }
-            s_ai_player_ctx.mixer_offset = fg_player->decode_size - s_ai_player_ctx.mixer_offset;
-            if(s_ai_player_ctx.mixer_offset) {
-                memmove(s_ai_player_ctx.mixer_buf, fg_player->decode_buf + samples*2, s_ai_player_ctx.mixer_offset);
-                s_ai_player_ctx.mixer_flag = 1;
-            } else {
-                s_ai_player_ctx.mixer_flag = 0;
-            }
-        } else {
-            samples = fg_player->decode_size/2;
-            ai_player_mixer_process(s_ai_player_ctx.mixer_buf, fg_player->decode_buf, samples);
-            if(s_ai_player_ctx.consumer.write) {
-                s_ai_player_ctx.consumer.write(s_ai_player_ctx.consumer_handle, fg_player->decode_buf, samples*2);
-            }
-            s_ai_player_ctx.mixer_offset = s_ai_player_ctx.mixer_offset - fg_player->decode_size;
-            if(s_ai_player_ctx.mixer_offset) {
-                memmove(s_ai_player_ctx.mixer_buf, s_ai_player_ctx.mixer_buf + samples*2, s_ai_player_ctx.mixer_offset);
-                s_ai_player_ctx.mixer_flag = 2;
-            } else {
-                s_ai_player_ctx.mixer_flag = 0;
-            }
-        }
-    } else if(bg_player) {
-        if(bg_player->decode_size >= s_ai_player_ctx.mixer_offset) {
-            samples = s_ai_player_ctx.mixer_offset/2;
-            ai_player_mixer_process(s_ai_player_ctx.mixer_buf, bg_player->decode_buf, samples);
-            if(s_ai_player_ctx.consumer.write) {
-                s_ai_player_ctx.consumer.write(s_ai_player_ctx.consumer_handle, bg_player->decode_buf, samples*2);
-            }
-            s_ai_player_ctx.mixer_offset = bg_player->decode_size - s_ai_player_ctx.mixer_offset;
-            if(s_ai_player_ctx.mixer_offset) {
-                memmove(s_ai_player_ctx.mixer_buf, bg_player->decode_buf + samples*2, s_ai_player_ctx.mixer_offset);
-                s_ai_player_ctx.mixer_flag = 2;
-            } else {
-                s_ai_player_ctx.mixer_flag = 0;
-            }
-        } else {
-            samples = bg_player->decode_size/2;
-            ai_player_mixer_process(s_ai_player_ctx.mixer_buf, bg_player->decode_buf, samples);
-            if(s_ai_player_ctx.consumer.write) {
-                s_ai_player_ctx.consumer.write(s_ai_player_ctx.consumer_handle, bg_player->decode_buf, samples*2);
-            }
-            s_ai_player_ctx.mixer_offset = s_ai_player_ctx.mixer_offset - bg_player->decode_size;
-            if(s_ai_player_ctx.mixer_offset) {
-                memmove(s_ai_player_ctx.mixer_buf, s_ai_player_ctx.mixer_buf + samples*2, s_ai_player_ctx.mixer_offset);
-                s_ai_player_ctx.mixer_flag = 1;
-            } else {
-                s_ai_player_ctx.mixer_flag = 0;
-            }
-        }
+    PCM_SLICE_T fg, bg;
+    uint32_t len = 0;
+
+    if(OPRT_OK != pcm_ring_peek(fg_player->pcm, &fg)) {
+        return;
+    }
+    if(OPRT_OK != pcm_ring_peek(bg_player->pcm, &bg)) {
+        pcm_slice_put(fg_player->pcm, &fg);
+        return;
     }
 
-    return OPRT_OK;
+    // mix the overlap into the foreground slice, the rest of the longer one waits for the other stream
+    SYS_TIME_T start = tal_system_get_millisecond();
+    AI_MIXER_INPUT_T input[2] = {
+        {(const int16_t *)fg.data, NULL},
+        {(const int16_t *)bg.data, NULL},
+    };
+    len = ((fg.len < bg.len) ? fg.len : bg.len) & ~1u;
+    ai_mixer_process(input, 2, (int16_t *)fg.data, len / 2);
+    __stat_stage(fg_player, AI_PLAYER_STAGE_MIX, start, len, 0);
+
+    __player_output(fg_player, &fg, len);
+    __stat_first_audio(bg_player);
+
+    pcm_slice_consume(fg_player->pcm, &fg, len);
+    pcm_slice_consume(bg_player->pcm, &bg, len);
+    pcm_slice_put(fg_player->pcm, &fg);
+    pcm_slice_put(bg_player->pcm, &bg);
 }
 #endif
+
 static OPERATE_RET __handle_player_streaming(void)
 {
     OPERATE_RET rt = OPRT_OK;
@@ -414,59 +854,26 @@ static OPERATE_RET __handle_player_streaming(void)
     AI_PLAYER_T *bg_player = s_ai_player_ctx.player[AI_PLAYER_MODE_BACKGROUND];
     if(s_ai_player_ctx.mixer_mode && (active_player->mode == AI_PLAYER_MODE_FOREGROUND)) {
         if(bg_player && (bg_player->state == AI_PLAYER_PLAYING)) {
-            if(s_ai_player_ctx.mixer_flag == 0) {
-                rt = __handle_player_streaming_source(bg_player);
-                rt = __handle_player_streaming_source(active_player);
-                if(!s_ai_player_ctx.decoder_mode) {
-                    if(s_ai_player_ctx.consumer.write) {
-                        if(bg_player->decode_size) {
-                            s_ai_player_ctx.consumer.write(s_ai_player_ctx.consumer_handle, bg_player->decode_buf, bg_player->decode_size);
-                            bg_player->decode_size = 0;
-                        }
-                        if(active_player->decode_size) {
-                            s_ai_player_ctx.consumer.write(s_ai_player_ctx.consumer_handle, active_player->decode_buf, active_player->decode_size);
-                            active_player->decode_size = 0;
-                        }
-                    }
-                } else {
-                    rt = __handle_player_streaming_mix(active_player, bg_player);
-                }
-            } else if(s_ai_player_ctx.mixer_flag == 1) {
-                rt = __handle_player_streaming_source(bg_player);
-                if(!s_ai_player_ctx.decoder_mode) {
-                    if((OPRT_OK == rt) && bg_player->decode_size && s_ai_player_ctx.consumer.write) {
-                        s_ai_player_ctx.consumer.write(s_ai_player_ctx.consumer_handle, bg_player->decode_buf, bg_player->decode_size);
-                        bg_player->decode_size = 0;
-                    }
-                } else {
-                    rt = __handle_player_streaming_mix(NULL, bg_player);
-                }
-            } else {
-                rt = __handle_player_streaming_source(active_player);
-                if(!s_ai_player_ctx.decoder_mode) {
-                    if((OPRT_OK == rt) && active_player->decode_size && s_ai_player_ctx.consumer.write) {
-                        s_ai_player_ctx.consumer.write(s_ai_player_ctx.consumer_handle, active_player->decode_buf, active_player->decode_size);
-                        active_player->decode_size = 0;
-                    }
-                } else {
-                    rt = __handle_player_streaming_mix(active_player, NULL);
-                }
+            // a player whose ring is full skips its source step, so the faster stream waits here
+            rt = __handle_player_streaming_source(bg_player);
+            rt = __handle_player_streaming_source(active_player);
+            if(!s_ai_player_ctx.decoder_mode) {
+                __player_output_all(bg_player);
+                __player_output_all(active_player);
+            } else if(active_player->state == AI_PLAYER_PLAYING && bg_player->state == AI_PLAYER_PLAYING) {
+                __handle_player_streaming_mix(active_player, bg_player);
             }
 
             return OPRT_OK; // mixed
         }
-    } else if(s_ai_player_ctx.mixer_offset) {
-        s_ai_player_ctx.mixer_flag = 0;
-        s_ai_player_ctx.mixer_offset = 0;
     }
 #endif
 
     // No mixing
     rt = __handle_player_streaming_source(active_player);
-    if((OPRT_OK == rt) && active_player->decode_size && s_ai_player_ctx.consumer.write) {
-        s_ai_player_ctx.consumer.write(s_ai_player_ctx.consumer_handle, active_player->decode_buf, active_player->decode_size);
+    if(OPRT_OK == rt) {
+        __player_output_all(active_player);
     }
-    active_player->decode_size = 0;
 
     return rt;
 }
@@ -512,6 +919,9 @@ static void __ai_player_thread_cb(void* args)
             case PLAYER_CMD_EXIT:
                 rt = __cmd_player_exit(player);
                 break;
+            case PLAYER_CMD_PRELOAD:
+                rt = __cmd_player_preload(player, &msg);
+                break;
             case PLAYER_CMD_SERVICE_DEINIT:
                 tal_thread_delete(s_ai_player_ctx.thread);
                 break;
@@ -626,8 +1036,9 @@ OPERATE_RET tuya_ai_player_create(AI_PLAYER_MODE_E mode, AI_PLAYER_HANDLE *handl
         return OPRT_MALLOC_FAILED;
     }
 
-    player->decode_buf = Malloc(AI_PLAYER_DECODEBUF_SIZE);
-    if (!player->decode_buf) {
+    // decoded pcm is staged here until the consumer takes it, decode_buf is only allocated for resampled streams
+    player->pcm = pcm_ring_create(AI_PLAYER_DECODEBUF_SIZE);
+    if (!player->pcm) {
         Free(player->framebuf);
         Free(player);
         return OPRT_MALLOC_FAILED;
@@ -637,9 +1048,11 @@ OPERATE_RET tuya_ai_player_create(AI_PLAYER_MODE_E mode, AI_PLAYER_HANDLE *handl
     player->mode = mode;
     player->mute = false;
     player->volume = PLAYER_MAX_VOLUME;
+    ai_mixer_gain_init(&player->gain, player->volume, PLAYER_MAX_VOLUME);
     player->has_pending_output = FALSE;
     ai_player_datasink_init(&player->sink);
     ai_player_decoder_init(&player->decoder);
+    ai_player_resample_create(&player->resample);
     s_ai_player_ctx.player[mode] = player;
 
     *handle = (AI_PLAYER_HANDLE)player;
@@ -715,6 +1128,33 @@ OPERATE_RET tuya_ai_player_start(AI_PLAYER_HANDLE handle, AI_PLAYER_SRC_E src, c
     return OPRT_OK;
 }
 
+OPERATE_RET ai_player_preload(AI_PLAYER_HANDLE handle, AI_PLAYER_SRC_E src, char *value, AI_AUDIO_CODEC_E codec)
+{
+    AI_PLAYER_T *player = (AI_PLAYER_T *)handle;
+
+    if (!__is_player_valid(player) || (src == AI_PLAYER_SRC_MEM) || (0 == player->next.pcm_size)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    AI_PLAYER_MSG_T msg = {0};
+    msg.mode = player->mode;
+    msg.cmd  = PLAYER_CMD_PRELOAD;
+    msg.param.cmd_start.src = src;
+    msg.param.cmd_start.codec = codec;
+    if(value) {
+        msg.param.cmd_start.value = mm_strdup(value);
+        if(!msg.param.cmd_start.value) {
+            return OPRT_MALLOC_FAILED;
+        }
+    }
+
+    OPERATE_RET rt = tal_queue_post(s_ai_player_ctx.queue, &msg, 0);
+    if(OPRT_OK != rt) {
+        Free(msg.param.cmd_start.value);
+    }
+    return rt;
+}
+
 /**
  * @brief Feed raw audio data to the player (used in memory mode).
  *
@@ -836,6 +1276,26 @@ AI_PLAYER_STATE_T tuya_ai_player_get_state(AI_PLAYER_HANDLE handle)
     return player->state;
 }
 
+/**
+ * @brief Get the pipeline statistics of the player since its last start
+ *
+ * @param[in]  handle  Handle of the player instance
+ * @param[out] stat    Time to first audio, per stage time and byte counters and datasink buffering
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tuya_ai_player_get_stat(AI_PLAYER_HANDLE handle, AI_PLAYER_STAT_T *stat)
+{
+    AI_PLAYER_T *player = (AI_PLAYER_T *)handle;
+
+    if (!__is_player_valid(player) || !stat) {
+        return OPRT_INVALID_PARM;
+    }
+
+    memcpy(stat, &player->stat, SIZEOF(AI_PLAYER_STAT_T));
+    return OPRT_OK;
+}
+
 /**
  * @brief Get the current audio codec of the player
  *
@@ -1007,14 +1467,6 @@ OPERATE_RET tuya_ai_player_get_mute(AI_PLAYER_HANDLE handle, bool *mute)
  */
 OPERATE_RET tuya_ai_player_set_mix_mode(bool enable)
 {
-    if(enable && !s_ai_player_ctx.mixer_buf) {
-        s_ai_player_ctx.mixer_buf = Malloc(AI_PLAYER_DECODEBUF_SIZE);
-        if(!s_ai_player_ctx.mixer_buf) {
-            return OPRT_MALLOC_FAILED;
-        }
-    }
-    s_ai_player_ctx.mixer_offset = 0;
-    s_ai_player_ctx.mixer_flag = 0;
     s_ai_player_ctx.mixer_mode = enable;
     return OPRT_OK;
 }
@@ -38,10 +38,40 @@ typedef struct {
     uint32_t count;
     uint32_t index;
     uint32_t target_index;
+    uint32_t preload_index; // item handed to the player ahead, INVALID_INDEX if none
     bool playing;
     bool single;
 } AI_PLAYLIST_CTX_T;
 
+// let the player open and decode the item after ctx->index while ctx->index plays
+static void __playlist_preload(AI_PLAYLIST_CTX_T *ctx)
+{
+    uint32_t next = ctx->index;
+
+    ctx->preload_index = INVALID_INDEX;
+    if(0 == ctx->cfg.lookahead || 0 == ctx->count) {
+        return;
+    }
+
+    if(!ctx->single && (++next >= ctx->count)) {
+        if(!ctx->cfg.loop) {
+            ai_player_preload(ctx->player, AI_PLAYER_SRC_FILE, NULL, AI_AUDIO_CODEC_MAX); // nothing follows, drop a stale one
+            return;
+        }
+        next = 0;
+    }
+
+    if(OPRT_OK == ai_player_preload(ctx->player, ctx->playlist[next]->src, ctx->playlist[next]->value, ctx->playlist[next]->codec)) {
+        ctx->preload_index = next;
+    }
+}
+
+static void __playlist_start(AI_PLAYLIST_CTX_T *ctx)
+{
+    tuya_ai_player_start(ctx->player, ctx->playlist[ctx->index]->src, ctx->playlist[ctx->index]->value, ctx->playlist[ctx->index]->codec);
+    __playlist_preload(ctx);
+}
+
 static void __player_status_cb(AI_PLAYLIST_HANDLE handle, AI_PLAYER_STATE_T state)
 {
     AI_PLAYLIST_CTX_T *ctx = (AI_PLAYLIST_CTX_T *)handle;
@@ -52,22 +82,29 @@ static void __player_status_cb(AI_PLAYLIST_HANDLE handle, AI_PLAYER_STATE_T stat
     PR_DEBUG("playlist player state %d index %d count %d loop %d single %d", state, ctx->index, ctx->count, ctx->cfg.loop, ctx->single);
 
     tal_mutex_lock(ctx->mutex);
-    if(AI_PLAYER_STOPPED == state) {
+    if(AI_PLAYER_PLAYING == state) {
+        // the preloaded item took over without a stop
+        if(ctx->preload_index < ctx->count) {
+            ctx->index = ctx->preload_index;
+            __playlist_preload(ctx);
+        }
+    } else if(AI_PLAYER_STOPPED == state) {
+        ctx->preload_index = INVALID_INDEX;
         if((ctx->target_index != INVALID_INDEX) && (ctx->target_index < ctx->count)) {
             ctx->index = ctx->target_index;
             ctx->target_index = INVALID_INDEX;
-            tuya_ai_player_start(ctx->player, ctx->playlist[ctx->index]->src, ctx->playlist[ctx->index]->value, ctx->playlist[ctx->index]->codec);
+            __playlist_start(ctx);
         } else if(ctx->single) {
-            tuya_ai_player_start(ctx->player, ctx->playlist[ctx->index]->src, ctx->playlist[ctx->index]->value, ctx->playlist[ctx->index]->codec);
+            __playlist_start(ctx);
         } else if(++ctx->index >= ctx->count) {
             ctx->index = 0;
             if(ctx->cfg.loop) {
-                tuya_ai_player_start(ctx->player, ctx->playlist[ctx->index]->src, ctx->playlist[ctx->index]->value, ctx->playlist[ctx->index]->codec);
+                __playlist_start(ctx);
             } else {
                 ctx->playing = FALSE;
             }
         } else {
-            tuya_ai_player_start(ctx->player, ctx->playlist[ctx->index]->src, ctx->playlist[ctx->index]->value, ctx->playlist[ctx->index]->codec);
+            __playlist_start(ctx);
         }
     }
     tal_mutex_unlock(ctx->mutex);
@@ -105,6 +142,12 @@ OPERATE_RET tuya_ai_playlist_create(AI_PLAYER_HANDLE player, AI_PLAYLIST_CFG_T *
     ctx->player = player;
     ctx->single = FALSE;
     ctx->target_index = INVALID_INDEX;
+    ctx->preload_index = INVALID_INDEX;
+    if(cfg->lookahead && cfg->lookahead < PLAYER_PCM_RESERVE_MIN) {
+        ctx->cfg.lookahead = PLAYER_PCM_RESERVE_MIN; // room for one decoded frame at least
+    }
+    player_instance->next.pcm_size = ctx->cfg.lookahead;
+    player_instance->next.crossfade_ms = ctx->cfg.crossfade_ms;
     player_instance->playlist = ctx;
     player_instance->playlist_cb = __player_status_cb;
 
@@ -180,12 +223,13 @@ OPERATE_RET tuya_ai_playlist_add(AI_PLAYLIST_HANDLE handle, AI_PLAYER_SRC_E src,
 
     tal_mutex_lock(ctx->mutex);
     ctx->playlist[ctx->count++] = item;
-    tal_mutex_unlock(ctx->mutex);
-
     if((1 == ctx->count) && ctx->cfg.auto_play) {
-        tuya_ai_player_start(ctx->player, src, value, codec);
+        __playlist_start(ctx);
         ctx->playing = TRUE;
+    } else if(ctx->playing && (INVALID_INDEX == ctx->preload_index)) {
+        __playlist_preload(ctx); // the playing item was the last one so far
     }
+    tal_mutex_unlock(ctx->mutex);
 
     return OPRT_OK;
 }
@@ -210,6 +254,7 @@ OPERATE_RET tuya_ai_playlist_prev(AI_PLAYLIST_HANDLE handle)
     } else if(ctx->cfg.loop) {
         ctx->index = ctx->count - 1;
     }
+    ctx->preload_index = INVALID_INDEX;
     tuya_ai_player_stop(ctx->player);
     tal_mutex_unlock(ctx->mutex);
 
@@ -238,6 +283,7 @@ OPERATE_RET tuya_ai_playlist_next(AI_PLAYLIST_HANDLE handle)
             ctx->index = (ctx->count >= 1) ? (ctx->count - 1) : 0;
         }
     }
+    ctx->preload_index = INVALID_INDEX;
     tuya_ai_player_stop(ctx->player);
     tal_mutex_unlock(ctx->mutex);
 
@@ -259,6 +305,7 @@ OPERATE_RET tuya_ai_playlist_stop(AI_PLAYLIST_HANDLE handle)
     }
 
     tal_mutex_lock(ctx->mutex);
+    ctx->preload_index = INVALID_INDEX;
     tuya_ai_player_stop(ctx->player);
     ctx->playing = FALSE;
     tal_mutex_unlock(ctx->mutex);
@@ -284,12 +331,13 @@ OPERATE_RET tuya_ai_playlist_restart(AI_PLAYLIST_HANDLE handle)
     }
 
     tal_mutex_lock(ctx->mutex);
+    ctx->index = 0;
     if(ctx->playing) {
+        ctx->preload_index = INVALID_INDEX;
         tuya_ai_player_stop(ctx->player);
     } else if(ctx->count > 0) {
-        tuya_ai_player_start(ctx->player, ctx->playlist[0]->src, ctx->playlist[0]->value, ctx->playlist[0]->codec);
+        __playlist_start(ctx);
     }
-    ctx->index = 0;
     ctx->playing = TRUE;
     tal_mutex_unlock(ctx->mutex);
 
@@ -314,6 +362,7 @@ OPERATE_RET tuya_ai_playlist_clear(AI_PLAYLIST_HANDLE handle)
 
     tal_mutex_lock(ctx->mutex);
     if(ctx->playing) {
+        ctx->preload_index = INVALID_INDEX;
         tuya_ai_player_stop(ctx->player);
     }
 
@@ -360,10 +409,11 @@ OPERATE_RET tuya_ai_playlist_play(AI_PLAYLIST_HANDLE handle, uint32_t index)
 
     if(ctx->playing) {
         ctx->target_index = index;
+        ctx->preload_index = INVALID_INDEX;
         tuya_ai_player_stop(ctx->player);
     } else {
         ctx->index = index;
-        tuya_ai_player_start(ctx->player, ctx->playlist[ctx->index]->src, ctx->playlist[ctx->index]->value, ctx->playlist[ctx->index]->codec);
+        __playlist_start(ctx);
     }
     ctx->playing = TRUE;
     tal_mutex_unlock(ctx->mutex);
@@ -400,6 +450,9 @@ OPERATE_RET tuya_ai_playlist_set_loop(AI_PLAYLIST_HANDLE handle, bool loop, bool
     tal_mutex_lock(ctx->mutex);
     ctx->cfg.loop = loop;
     ctx->single = loop ? single : FALSE;
+    if(ctx->playing) {
+        __playlist_preload(ctx); // the item after the current one may have changed
+    }
     tal_mutex_unlock(ctx->mutex);
 
     return OPRT_OK;
@@ -56,4 +56,30 @@ unsigned int hash_crc32i_finish(unsigned int hash);
  */
 unsigned int hash_crc32i_total(const void* data, unsigned int size);
 
+/**
+ * @brief Combines the CRC32I hash values of two consecutive blocks.
+ *
+ * The hash of A followed by B is built from the hashes of A and B, so the
+ * chunks of an image can be hashed apart, in any order, and joined.
+ *
+ * @param crc1 The final hash value of the first block.
+ * @param crc2 The final hash value of the second block.
+ * @param len2 The size of the second block in bytes.
+ * @return The final hash value of the two blocks.
+ */
+unsigned int hash_crc32i_combine(unsigned int crc1, unsigned int crc2, unsigned int len2);
+
+/**
+ * @brief Benchmarks every CRC32I variant built in and prints GB/s.
+ *
+ * @note Available when ENABLE_CRC_BENCHMARK is defined. The variants are the
+ * byte table, slicing-by-8 and, when the cpu has them, the ARMv8 crc32 or the
+ * x86 pclmulqdq instructions.
+ *
+ * @param len The size of the buffer hashed each round.
+ * @param rounds The number of rounds timed per variant.
+ * @return 0 on success, -1 if a variant disagrees or on no memory.
+ */
+int hash_crc32i_benchmark(unsigned int len, unsigned int rounds);
+
 #endif
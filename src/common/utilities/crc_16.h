@@ -28,6 +28,18 @@ extern "C" {
 __CRC_16_MODULE_EXT
 unsigned short get_crc_16(unsigned char *data, unsigned short size);
 
+/**
+ * @brief Benchmarks the bitwise and the table CRC-16 and prints GB/s.
+ *
+ * @note Available when ENABLE_CRC_BENCHMARK is defined.
+ *
+ * @param len The size of the buffer hashed each round.
+ * @param rounds The number of rounds timed per variant.
+ * @return 0 on success, -1 if the variants disagree or on no memory.
+ */
+__CRC_16_MODULE_EXT
+int crc_16_benchmark(unsigned int len, unsigned int rounds);
+
 #ifdef __cplusplus
 }
 #endif
@@ -79,4 +79,10 @@ uint16_t mqtt_client_unsubscribe(void *client, const char *topic, uint8_t qos);
 
 uint16_t mqtt_client_publish(void *client, const char *topic, const uint8_t *payload, size_t length, uint8_t qos);
 
+/* reserves a msgid, so the caller can track the message before it is sent */
+uint16_t mqtt_client_packet_id(void *client);
+
+mqtt_client_status_t mqtt_client_publish_with_id(void *client, const char *topic, const uint8_t *payload,
+                                                 size_t length, uint8_t qos, uint16_t msgid);
+
 #endif /* ifndef MQTT_CLIENT_INTERFACE_H */
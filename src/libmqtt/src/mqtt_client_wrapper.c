@@ -287,12 +287,18 @@ uint16_t mqtt_client_unsubscribe(void *client, const char *topic, uint8_t qos)
     return msgid;
 }
 
-uint16_t mqtt_client_publish(void *client, const char *topic, const uint8_t *payload, size_t length, uint8_t qos)
+uint16_t mqtt_client_packet_id(void *client)
 {
     mqtt_client_context_t *context = (mqtt_client_context_t *)client;
-    MQTTStatus_t mqtt_status;
 
-    uint16_t msgid = MQTT_GetPacketId(&context->mqclient);
+    return MQTT_GetPacketId(&context->mqclient);
+}
+
+mqtt_client_status_t mqtt_client_publish_with_id(void *client, const char *topic, const uint8_t *payload,
+                                                 size_t length, uint8_t qos, uint16_t msgid)
+{
+    mqtt_client_context_t *context = (mqtt_client_context_t *)client;
+    MQTTStatus_t mqtt_status;
 
     mqtt_status = MQTT_Publish(&context->mqclient,
                                &(const MQTTPublishInfo_t){.qos = qos,
@@ -303,6 +309,16 @@ uint16_t mqtt_client_publish(void *client, const char *topic, const uint8_t *pay
                                msgid);
 
     if (MQTTSuccess != mqtt_status) {
+        return MQTT_STATUS_NETWORK_TIMEOUT;
+    }
+    return MQTT_STATUS_SUCCESS;
+}
+
+uint16_t mqtt_client_publish(void *client, const char *topic, const uint8_t *payload, size_t length, uint8_t qos)
+{
+    uint16_t msgid = mqtt_client_packet_id(client);
+
+    if (MQTT_STATUS_SUCCESS != mqtt_client_publish_with_id(client, topic, payload, length, qos, msgid)) {
         return 0;
     }
     return msgid;
@@ -3,8 +3,8 @@
  * @brief Provides key-value storage functionality for Tuya applications.
  *
  * This header file defines the interface for Tuya's key-value (KV) storage
- * system, which is designed to serialize and deserialize data to and from JSON
- * format for efficient storage and retrieval. It supports various data types
+ * system, which is designed to serialize and deserialize data to and from a
+ * compact binary record for efficient storage and retrieval. It supports various data types
  * including integers, booleans, strings, and raw binary data. The API
  * facilitates the initialization of the KV storage system, setting and getting
  * key-value pairs, deleting keys, and performing serialization and
@@ -26,24 +26,22 @@ extern "C" {
 #include "lfs.h"
 /**
  * @brief tuya key-value database type define, used for serialize/deserialize
- * data to json format
+ * data to the binary record, each field takes key len+3 byte plus the value
  *
  */
 typedef uint8_t kv_tp_t;
-#define KV_CHAR   0 // char, same as int, need 11+6 byte
-#define KV_BYTE   1 // byte, same as int, need 11+6 byte
-#define KV_SHORT  2 // short, same as int, need 11+6 byte
-#define KV_USHORT 3 // unsigned short, same as int, need 11+6 byte
-#define KV_INT    4 // int, need 11+6 byte when serialize to json format
-#define KV_BOOL   5 // bool, need 6+6 byte when serialize to json format
-#define KV_STRING 6 // string, need len+6 byte when serialize to json format
-#define KV_RAW                                                                                                         \
-    7 // raw, need len/3*4+len%3?4:0+6 (base64 encode) when serialize to json
-      // format
+#define KV_CHAR   0 // char, same as int
+#define KV_BYTE   1 // byte, same as int
+#define KV_SHORT  2 // short, same as int
+#define KV_USHORT 3 // unsigned short, same as int
+#define KV_INT    4 // int, zigzag varint, need 1-5 byte
+#define KV_BOOL   5 // bool, need 1 byte
+#define KV_STRING 6 // string, need strlen byte
+#define KV_RAW    7 // raw, need len byte
 
 /**
- * @brief tuya key-value database, used for serialize/deserialize data to json
- * format
+ * @brief tuya key-value database, used for serialize/deserialize data to the
+ * binary record
  *
  */
 typedef struct {
@@ -60,6 +58,30 @@ typedef struct {
     char key[TAL_LV_KEY_LEN + 1];
 } tal_kv_cfg_t;
 
+/**
+ * @brief one key of a tal_kv_batch_set
+ *
+ */
+typedef struct {
+    const char *key;
+    const uint8_t *value; // NULL to delete the key
+    size_t length;
+} tal_kv_item_t;
+
+/**
+ * @brief tal_kv counters since init
+ *
+ */
+typedef struct {
+    uint32_t sets;
+    uint32_t gets;
+    uint32_t cache_hits;
+    uint32_t flushes;
+    uint32_t user_bytes;   // value bytes passed to set
+    uint32_t prog_bytes;   // bytes programmed to flash
+    uint32_t erase_blocks; // flash blocks erased
+} tal_kv_stat_t;
+
 /**
  * @brief Initializes the TAL Key-Value (KV) module.
  *
@@ -84,6 +106,55 @@ int tal_kv_init(tal_kv_cfg_t *kv_cfg);
  */
 int tal_kv_set(const char *key, const uint8_t *value, size_t length);
 
+/**
+ * @brief Sets and deletes several keys as one transaction.
+ *
+ * The items are written to a journal first and applied after, a power loss in
+ * between is completed by the next tal_kv_init. So either all items are
+ * stored or none.
+ *
+ * @param items The keys to set, an item with a NULL value deletes its key.
+ * @param num The number of items.
+ * @return 0 if all items were stored, or a negative error code if an error
+ * occurred.
+ */
+int tal_kv_batch_set(const tal_kv_item_t *items, uint32_t num);
+
+/**
+ * @brief Writes the values held by the write-back cache to flash.
+ *
+ * With ENABLE_KV_CACHE a tal_kv_set is kept in RAM and written out together
+ * with the other pending keys after TAL_KV_CACHE_FLUSH_MS, or once
+ * TAL_KV_CACHE_DIRTY_MAX bytes are pending. Call this before a reboot.
+ *
+ * @return 0 if all pending values were written, or a negative error code if an
+ * error occurred.
+ */
+int tal_kv_flush(void);
+
+/**
+ * @brief Gets the tal_kv counters.
+ *
+ * @param stat The counters.
+ * @return 0 on success, or a negative error code if an error occurred.
+ */
+int tal_kv_stat_get(tal_kv_stat_t *stat);
+
+/**
+ * @brief Benchmarks set, batch set and get on the configured backend.
+ *
+ * The keys are written round robin, ops/s, write amplification (flash bytes
+ * programmed per value byte) and erased blocks are printed with PR_NOTICE. On
+ * the linux platform tkl_flash is backed by a file, so this runs on the host.
+ * Available when ENABLE_KV_BENCHMARK is defined.
+ *
+ * @param keys The number of distinct keys.
+ * @param value_len The value length.
+ * @param rounds The number of sets per measurement.
+ * @return 0 on success, or a negative error code if an error occurred.
+ */
+int tal_kv_benchmark(uint32_t keys, uint32_t value_len, uint32_t rounds);
+
 /**
  * @brief Retrieves the value associated with the specified key from the
  * key-value store.
@@ -153,6 +224,17 @@ int tal_kv_serialize_set(const char *key, kv_db_t *db, size_t dbcnt);
  */
 int tal_kv_serialize_get(const char *key, kv_db_t *db, size_t dbcnt);
 
+/**
+ * @brief Compares the binary and the JSON kv_db_t record.
+ *
+ * Encode and decode time and the record size of both formats are printed
+ * with PR_NOTICE. Available when ENABLE_KV_BENCHMARK is defined.
+ *
+ * @param rounds The number of encodes and decodes per measurement.
+ * @return 0 on success, or a negative error code if an error occurred.
+ */
+int tal_kv_serialize_benchmark(uint32_t rounds);
+
 /**
  * @brief Executes the TAL KV command.
  *
@@ -0,0 +1,53 @@
+/**
+ * @file tal_kv_port.h
+ * @brief Storage backend interface of tal_kv.
+ *
+ * tal_kv encrypts a value and hands the cipher text to a backend. The
+ * littlefs backend keeps one file per key, the log backend (ENABLE_KV_LOG)
+ * appends records to the KV_DATA partition.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#ifndef __TAL_KV_PORT_H__
+#define __TAL_KV_PORT_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief a storage backend, called with the tal_kv mutex held
+ *
+ * read returns a buffer from tal_malloc, with one spare byte for the NUL,
+ * that the caller frees.
+ */
+typedef struct {
+    const char *name;
+    int (*write)(const char *key, const uint8_t *data, size_t len);
+    int (*read)(const char *key, uint8_t **data, size_t *len);
+    int (*remove)(const char *key);
+} tal_kv_backend_t;
+
+/**
+ * @brief Count flash programming and erasing for tal_kv_stat_get
+ *
+ * @param[in] prog_bytes: bytes programmed
+ * @param[in] erase_blocks: blocks erased
+ */
+void tal_kv_flash_account(uint32_t prog_bytes, uint32_t erase_blocks);
+
+/**
+ * @brief Mount the log backend on the TUYA_FLASH_TYPE_KV_DATA partition
+ *
+ * @return the backend, NULL on error
+ */
+const tal_kv_backend_t *tal_kv_log_backend_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TAL_KV_PORT_H__ */
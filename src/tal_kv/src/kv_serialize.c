@@ -1,19 +1,24 @@
 /**
  * @file kv_serialize.c
- * @brief Implements serialization of key-value pairs into a JSON string.
+ * @brief Implements serialization of key-value pairs for tal_kv.
  *
- * This file contains the implementation of the kv_serialize function, which is
- * responsible for converting a database of key-value pairs into a JSON
- * formatted string. It supports various data types including integers,
- * booleans, strings, and raw binary data. The serialization process calculates
- * the necessary buffer size, iterates through the key-value pairs, and formats
- * them according to their type into a JSON string. This functionality is
- * crucial for storing configuration data in a human-readable and easily
- * transmittable format.
+ * A kv_db_t array is stored as a compact binary record: a magic byte, a
+ * format version and the field count, then one TLV per field made of the
+ * key, the kv_tp_t type, a varint length and the value. Integers are zigzag
+ * varints, strings and raw data are stored as is, so nothing is base64
+ * expanded or printed. The
+ * size is computed exactly before the single output buffer is allocated,
+ * and decoding writes straight into the storage the kv_db_t entries point
+ * to without allocating.
  *
- * The implementation utilizes the cJSON library for JSON serialization and
- * includes optimizations for memory usage and processing time, making it
- * suitable for resource-constrained environments.
+ * Fields are matched by key, a field missing from the record is zeroed like
+ * before, and a field of the record that is not in the kv_db_t is skipped,
+ * so fields can be added to or removed from a kv_db_t between versions.
+ *
+ * Records written by older SDKs are JSON text, which never starts with the
+ * magic byte. They are still decoded through cJSON when
+ * KV_SERIALIZE_JSON_COMPAT is set, and tal_kv_serialize_get writes them back
+ * in the binary format.
  *
  * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
  *
@@ -26,9 +31,27 @@
 #include "cJSON.h"
 #include "mix_method.h"
 
+/***********************************************************
+************************macro define************************
+***********************************************************/
+// decode records written as JSON by older SDKs
+#ifndef KV_SERIALIZE_JSON_COMPAT
+#define KV_SERIALIZE_JSON_COMPAT 1
+#endif
+
+#define KV_SERIALIZE_MAGIC   0xB5
+#define KV_SERIALIZE_VERSION 1
+#define KV_SERIALIZE_HEAD    2
+
+#define KV_VARINT_MAX 5
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+#if defined(ENABLE_KV_BENCHMARK)
 /**
  * Serializes the key-value pairs in the given database into a JSON-formatted
- * string.
+ * string, the format of older SDKs kept for tal_kv_serialize_benchmark.
  *
  * @param db The pointer to the database containing the key-value pairs.
  * @param dbcnt The number of key-value pairs in the database.
@@ -37,7 +60,7 @@
  * @return Returns OPRT_OK if serialization is successful, otherwise returns an
  * error code.
  */
-int kv_serialize(const kv_db_t *db, const uint32_t dbcnt, char **out, uint32_t *out_len)
+static int __kv_serialize_json(const kv_db_t *db, const uint32_t dbcnt, char **out, uint32_t *out_len)
 {
     int i = 0;
     // conut need buf size
@@ -149,12 +172,15 @@ int kv_serialize(const kv_db_t *db, const uint32_t dbcnt, char **out, uint32_t *
 
     return OPRT_OK;
 }
+#endif
 
+#if KV_SERIALIZE_JSON_COMPAT || defined(ENABLE_KV_BENCHMARK)
 /**
  * @brief Deserialize a JSON string and populate a key-value database.
  *
  * This function takes a JSON string, parses it using cJSON library, and
- * populates a key-value database with the values extracted from the JSON. The
+ * populates a key-value database with the values extracted from the JSON, the
+ * format records were written in by older SDKs. The
  * key-value database is represented by the `kv_db_t` structure array. The
  * number of elements in the `kv_db_t` array is specified by the `dbcnt`
  * parameter.
@@ -165,7 +191,7 @@ int kv_serialize(const kv_db_t *db, const uint32_t dbcnt, char **out, uint32_t *
  * @return Returns OPRT_OK if the deserialization is successful. Otherwise, it
  * returns an error code indicating the failure reason.
  */
-int kv_deserialize(const char *in, kv_db_t *db, const uint32_t dbcnt)
+static int __kv_deserialize_json(const char *in, kv_db_t *db, const uint32_t dbcnt)
 {
     cJSON *root = cJSON_Parse(in);
     if (NULL == root) {
@@ -275,3 +301,399 @@ ERR_EXIT:
 
     return op_ret;
 }
+#endif
+
+/**
+ * @brief put a varint, p may be NULL to count the bytes
+ */
+static uint32_t __kv_varint_put(uint8_t *p, uint32_t v)
+{
+    uint32_t n = 0;
+
+    do {
+        if (p) {
+            p[n] = (v & 0x7F) | ((v > 0x7F) ? 0x80 : 0);
+        }
+        v >>= 7;
+        n++;
+    } while (v);
+
+    return n;
+}
+
+/**
+ * @brief get a varint
+ *
+ * @return bytes used, 0 if it is truncated or too long
+ */
+static uint32_t __kv_varint_get(const uint8_t *p, const uint8_t *end, uint32_t *v)
+{
+    uint32_t n = 0;
+
+    *v = 0;
+    while (p + n < end && n < KV_VARINT_MAX) {
+        *v |= (uint32_t)(p[n] & 0x7F) << (7 * n);
+        if (0 == (p[n++] & 0x80)) {
+            return n;
+        }
+    }
+
+    return 0;
+}
+
+static int32_t __kv_int_get(const kv_db_t *db)
+{
+    switch (db->tp) {
+    case KV_CHAR:
+        return *((char *)(db->val));
+    case KV_BYTE:
+        return *((uint8_t *)(db->val));
+    case KV_SHORT:
+        return *((int16_t *)(db->val));
+    case KV_USHORT:
+        return *((uint16_t *)(db->val));
+    default:
+        return *((int32_t *)(db->val));
+    }
+}
+
+static int __kv_int_set(kv_db_t *db, int32_t v)
+{
+    switch (db->tp) {
+    case KV_CHAR:
+        if (v < -128 || v > 127) {
+            return OPRT_COM_ERROR;
+        }
+        *((char *)db->val) = v;
+        break;
+    case KV_BYTE:
+        if (v < 0 || v > 255) {
+            return OPRT_COM_ERROR;
+        }
+        *((uint8_t *)db->val) = v;
+        break;
+    case KV_SHORT:
+        if (v < -32768 || v > 32767) {
+            return OPRT_COM_ERROR;
+        }
+        *((int16_t *)db->val) = v;
+        break;
+    case KV_USHORT:
+        if (v < 0 || v > 65535) {
+            return OPRT_COM_ERROR;
+        }
+        *((uint16_t *)db->val) = v;
+        break;
+    default:
+        *((int *)db->val) = v;
+        break;
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief the value of a field as bytes, integers are zigzag varints
+ *
+ * @return value length, -1 if the type is invalid
+ */
+static int __kv_value(const kv_db_t *db, uint8_t ibuf[KV_VARINT_MAX], const uint8_t **value)
+{
+    int32_t v;
+
+    if (db->tp <= KV_INT) {
+        v = __kv_int_get(db);
+        *value = ibuf;
+        return __kv_varint_put(ibuf, ((uint32_t)v << 1) ^ (uint32_t)(v >> 31));
+    } else if (db->tp == KV_BOOL) {
+        ibuf[0] = (FALSE == *((BOOL_T *)(db->val))) ? 0 : 1;
+        *value = ibuf;
+        return 1;
+    } else if (db->tp == KV_STRING) {
+        *value = db->val;
+        return strlen((char *)db->val);
+    } else if (db->tp == KV_RAW) {
+        *value = db->val;
+        return db->len;
+    }
+
+    return -1;
+}
+
+/**
+ * Serializes the key-value pairs in the given database into a binary record.
+ *
+ * @param db The pointer to the database containing the key-value pairs.
+ * @param dbcnt The number of key-value pairs in the database.
+ * @param out The pointer to store the record, free it with tal_free.
+ * @param out_len The pointer to store the length of the record.
+ * @return Returns OPRT_OK if serialization is successful, otherwise returns an
+ * error code.
+ */
+int kv_serialize(const kv_db_t *db, const uint32_t dbcnt, char **out, uint32_t *out_len)
+{
+    uint32_t i, key_len, len = KV_SERIALIZE_HEAD + __kv_varint_put(NULL, dbcnt), offset = 0;
+    uint8_t ibuf[KV_VARINT_MAX];
+    const uint8_t *value = NULL;
+    uint8_t *buf = NULL;
+    int value_len;
+
+    // exact size first
+    for (i = 0; i < dbcnt; i++) {
+        value_len = __kv_value(&db[i], ibuf, &value);
+        if (value_len < 0) {
+            PR_ERR("type invalid %d", db[i].tp);
+            return OPRT_COM_ERROR;
+        }
+        key_len = strlen(db[i].key);
+        len += __kv_varint_put(NULL, key_len) + key_len + 1 + __kv_varint_put(NULL, value_len) + value_len;
+    }
+
+    buf = tal_malloc(len);
+    if (NULL == buf) {
+        PR_ERR("maloc fails %d", len);
+        return OPRT_MALLOC_FAILED;
+    }
+    buf[offset++] = KV_SERIALIZE_MAGIC;
+    buf[offset++] = KV_SERIALIZE_VERSION;
+    offset += __kv_varint_put(buf + offset, dbcnt);
+    for (i = 0; i < dbcnt; i++) {
+        value_len = __kv_value(&db[i], ibuf, &value);
+        key_len = strlen(db[i].key);
+        offset += __kv_varint_put(buf + offset, key_len);
+        memcpy(buf + offset, db[i].key, key_len);
+        offset += key_len;
+        buf[offset++] = db[i].tp;
+        offset += __kv_varint_put(buf + offset, value_len);
+        memcpy(buf + offset, value, value_len);
+        offset += value_len;
+    }
+
+    *out = (char *)buf;
+    *out_len = offset;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief walk the fields of a binary record
+ *
+ * @param[inout] p: position, moved past the field
+ * @param[out] key / key_len / tp / value / value_len: the field
+ *
+ * @return OPRT_OK, OPRT_NOT_FOUND at the end, others if it is truncated
+ */
+static int __kv_field_next(const uint8_t **p, const uint8_t *end, const char **key, uint32_t *key_len, kv_tp_t *tp,
+                           const uint8_t **value, uint32_t *value_len)
+{
+    const uint8_t *q = *p;
+    uint32_t n;
+
+    if (q == end) {
+        return OPRT_NOT_FOUND;
+    }
+    n = __kv_varint_get(q, end, key_len);
+    if (0 == n || *key_len >= (uint32_t)(end - q - n)) {
+        return OPRT_COM_ERROR;
+    }
+    q += n;
+    *key = (const char *)q;
+    q += *key_len;
+    *tp = *q++;
+    n = __kv_varint_get(q, end, value_len);
+    if (0 == n || *value_len > (uint32_t)(end - q - n)) {
+        return OPRT_COM_ERROR;
+    }
+    q += n;
+    *value = q;
+    *p = q + *value_len;
+
+    return OPRT_OK;
+}
+
+static int __kv_field_decode(kv_db_t *db, kv_tp_t tp, const uint8_t *value, uint32_t value_len)
+{
+    uint32_t v;
+
+    if (db->tp <= KV_INT) {
+        if (tp > KV_INT || value_len != __kv_varint_get(value, value + value_len, &v)) {
+            return OPRT_COM_ERROR;
+        }
+        return __kv_int_set(db, (int32_t)((v >> 1) ^ (0 - (v & 1))));
+    } else if (db->tp == KV_BOOL) {
+        if (tp != KV_BOOL || 1 != value_len) {
+            return OPRT_COM_ERROR;
+        }
+        *((BOOL_T *)db->val) = value[0] ? 1 : 0;
+    } else if (db->tp == KV_STRING) {
+        if ((tp != KV_STRING && tp != KV_RAW) || db->len < value_len + 1) {
+            return OPRT_COM_ERROR;
+        }
+        memcpy(db->val, value, value_len);
+        ((char *)db->val)[value_len] = 0;
+    } else if (db->tp == KV_RAW) {
+        if ((tp != KV_STRING && tp != KV_RAW) || db->len < value_len) {
+            return OPRT_COM_ERROR;
+        }
+        memcpy(db->val, value, value_len);
+        if (0 == value_len) {
+            db->len = 0;
+        }
+    } else {
+        PR_ERR("type invalid %d", db->tp);
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Check if a record was written as JSON by an older SDK
+ *
+ * @param[in] in: the record
+ * @param[in] in_len: length of the record
+ *
+ * @return TRUE if it should be written again with kv_serialize
+ */
+BOOL_T kv_serialize_is_legacy(const char *in, const uint32_t in_len)
+{
+    return (0 == in_len || KV_SERIALIZE_MAGIC != (uint8_t)in[0]) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Deserialize a record and populate a key-value database.
+ *
+ * The values are written to the storage of the kv_db_t entries, nothing is
+ * allocated. A field that is not in the record is set to zero.
+ *
+ * @param[in] in The record, from kv_serialize or JSON of an older SDK. A JSON
+ * record must be NUL terminated.
+ * @param[in] in_len The length of the record.
+ * @param[in,out] db The key-value database to populate.
+ * @param[in] dbcnt The number of elements in the key-value database.
+ * @return Returns OPRT_OK if the deserialization is successful. Otherwise, it
+ * returns an error code indicating the failure reason.
+ */
+int kv_deserialize(const char *in, const uint32_t in_len, kv_db_t *db, const uint32_t dbcnt)
+{
+    const uint8_t *begin = NULL, *end = (const uint8_t *)in + in_len;
+    const uint8_t *p = NULL, *value = NULL;
+    const char *key = NULL;
+    uint32_t i, n, cnt, key_len, value_len;
+    kv_tp_t tp = 0;
+    int op_ret = OPRT_OK;
+
+    if (NULL == in || NULL == db) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (kv_serialize_is_legacy(in, in_len)) {
+#if KV_SERIALIZE_JSON_COMPAT
+        return __kv_deserialize_json(in, db, dbcnt);
+#else
+        return OPRT_NOT_SUPPORTED;
+#endif
+    }
+    if (in_len < KV_SERIALIZE_HEAD || (uint8_t)in[1] > KV_SERIALIZE_VERSION) {
+        PR_ERR("kv record version %d not supported", (in_len > 1) ? in[1] : -1);
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    n = __kv_varint_get((const uint8_t *)in + KV_SERIALIZE_HEAD, end, &cnt);
+    begin = (const uint8_t *)in + KV_SERIALIZE_HEAD + n;
+
+    // check the whole record before writing to db
+    p = begin;
+    for (i = 0; OPRT_OK == (op_ret = __kv_field_next(&p, end, &key, &key_len, &tp, &value, &value_len)); i++) {
+    }
+    if (0 == n || OPRT_NOT_FOUND != op_ret || i != cnt) {
+        PR_ERR("kv record truncated");
+        return OPRT_COM_ERROR;
+    }
+
+    for (i = 0; i < dbcnt; i++) {
+        size_t db_key_len = strlen(db[i].key);
+        const char *found = NULL;
+
+        p = begin;
+        while (OPRT_OK == __kv_field_next(&p, end, &key, &key_len, &tp, &value, &value_len)) {
+            if (key_len == db_key_len && 0 == memcmp(key, db[i].key, key_len)) {
+                found = key;
+                break;
+            }
+        }
+        if (NULL == found) { // default set zero
+            memset(db[i].val, 0, db[i].len);
+            continue;
+        }
+        op_ret = __kv_field_decode(&db[i], tp, value, value_len);
+        if (OPRT_OK != op_ret) {
+            PR_ERR("deserial %s fails %d", db[i].key, op_ret);
+            return op_ret;
+        }
+    }
+
+    return OPRT_OK;
+}
+
+#if defined(ENABLE_KV_BENCHMARK)
+/**
+ * @brief Compare the binary and the JSON record of a typical kv_db_t
+ *
+ * @param rounds The number of encodes and decodes per measurement.
+ * @return 0 on success, or a negative error code if an error occurred.
+ */
+int tal_kv_serialize_benchmark(uint32_t rounds)
+{
+    char host[64] = "a1.tuyaus.com", path[32] = "/d.json", name[32] = "";
+    uint16_t port = 443, mqtt_port = 8883;
+    int32_t region = -12345;
+    BOOL_T active = TRUE;
+    uint8_t secret[32];
+    kv_db_t db[] = {
+        {"atop.host", KV_STRING, host, sizeof(host)},     {"atop.port", KV_USHORT, &port, sizeof(port)},
+        {"atop.path", KV_STRING, path, sizeof(path)},     {"mqtt.port", KV_USHORT, &mqtt_port, sizeof(mqtt_port)},
+        {"region", KV_INT, &region, sizeof(region)},      {"active", KV_BOOL, &active, sizeof(active)},
+        {"secret", KV_RAW, secret, sizeof(secret)},       {"name", KV_STRING, name, sizeof(name)},
+    };
+    const char *fmt_name[] = {"binary", "json"};
+    char *buf = NULL;
+    uint32_t len = 0, i, fmt;
+    SYS_TIME_T start, enc_ms, dec_ms;
+    int rt = OPRT_OK;
+
+    if (0 == rounds) {
+        return OPRT_INVALID_PARM;
+    }
+    for (i = 0; i < sizeof(secret); i++) {
+        secret[i] = i * 7;
+    }
+
+    for (fmt = 0; fmt < 2 && OPRT_OK == rt; fmt++) {
+        start = tal_system_get_millisecond();
+        for (i = 0; i < rounds && OPRT_OK == rt; i++) {
+            tal_free(buf);
+            buf = NULL;
+            rt = (0 == fmt) ? kv_serialize(db, CNTSOF(db), &buf, &len) : __kv_serialize_json(db, CNTSOF(db), &buf, &len);
+        }
+        enc_ms = tal_system_get_millisecond() - start;
+
+        start = tal_system_get_millisecond();
+        for (i = 0; i < rounds && OPRT_OK == rt; i++) {
+            db[6].len = sizeof(secret);
+            rt = kv_deserialize(buf, len, db, CNTSOF(db));
+        }
+        dec_ms = tal_system_get_millisecond() - start;
+        if (OPRT_OK != rt || 443 != port || -12345 != region || strcmp(host, "a1.tuyaus.com") || secret[31] != 217) {
+            PR_ERR("kv serialize %s mismatch %d", fmt_name[fmt], rt);
+            rt = OPRT_COM_ERROR;
+        }
+
+        PR_NOTICE("kv serialize %-6s: %u bytes, encode %u ns, decode %u ns", fmt_name[fmt], len,
+                  (uint32_t)(enc_ms * 1000000 / rounds), (uint32_t)(dec_ms * 1000000 / rounds));
+    }
+    tal_free(buf);
+
+    return rt;
+}
+#endif
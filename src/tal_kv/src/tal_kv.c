@@ -20,6 +20,14 @@
  * applications. It requires the LittleFS library and Tuya's hardware
  * abstraction libraries for proper functionality.
  *
+ * Values are encrypted with one keyed tal_cipher handle and stored through a
+ * backend, one littlefs file per key, or with ENABLE_KV_LOG appended to a
+ * log on the KV_DATA partition (tal_kv_log.c).
+ * With ENABLE_KV_CACHE a set is held in a RAM cache and the pending keys are
+ * written out together, so a hot key rewritten many times costs one flash
+ * write per flush. tal_kv_batch_set stores several keys through a journal
+ * that tal_kv_init completes after a power loss.
+ *
  * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
  *
  */
@@ -29,15 +37,76 @@
 #include "tkl_flash.h"
 #include "tal_api.h"
 #include "tal_security.h"
+#include "tal_kv_port.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+// bytes of keys and values held by the write-back cache
+#ifndef TAL_KV_CACHE_SIZE
+#define TAL_KV_CACHE_SIZE (8 * 1024)
+#endif
+
+// pending values are written out this long after the first one is set
+#ifndef TAL_KV_CACHE_FLUSH_MS
+#define TAL_KV_CACHE_FLUSH_MS 3000
+#endif
+
+// or at once when this many value bytes are pending
+#ifndef TAL_KV_CACHE_DIRTY_MAX
+#define TAL_KV_CACHE_DIRTY_MAX (TAL_KV_CACHE_SIZE / 2)
+#endif
+
+#define TAL_KV_KEY_MAX     255
+#define TAL_KV_JOURNAL_KEY "tal_kv_journal"
+
+/* journal: item count(2), then per item key len(1), op(1), value len(4), key, value */
+#define KV_JOURNAL_HEAD_LEN 2
+#define KV_JOURNAL_ITEM_LEN 6
+#define KV_JOURNAL_OP_SET   0
+#define KV_JOURNAL_OP_DEL   1
 
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+#if defined(ENABLE_KV_CACHE) && (ENABLE_KV_CACHE == 1)
+typedef struct kv_cache_node {
+    struct kv_cache_node *next;
+    uint8_t *value;
+    uint32_t len;
+    uint32_t size; // bytes charged to the cache
+    BOOL_T dirty;
+    char key[];
+} kv_cache_node_t;
+
+typedef struct {
+    kv_cache_node_t *head; // most recently used first
+    uint32_t bytes;
+    uint32_t dirty_bytes;
+    TIMER_ID timer;
+    BOOL_T bypass;
+} kv_cache_t;
+#endif
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
 // variables used by the filesystem
 static lfs_t lfs;
 static lfs_size_t lfs_flash_addr;
 static tal_kv_cfg_t lfs_kv_cfg;
 static MUTEX_HANDLE lfs_mutex;
 
+static TAL_CIPHER_HANDLE s_kv_cipher;
+static const tal_kv_backend_t *s_kv_backend;
+static tal_kv_stat_t s_kv_stat;
+#if defined(ENABLE_KV_CACHE) && (ENABLE_KV_CACHE == 1)
+static kv_cache_t s_kv_cache;
+#endif
+
 extern int kv_serialize(const kv_db_t *db, const uint32_t dbcnt, char **out, uint32_t *out_len);
-extern int kv_deserialize(const char *in, kv_db_t *db, const uint32_t dbcnt);
+extern int kv_deserialize(const char *in, const uint32_t in_len, kv_db_t *db, const uint32_t dbcnt);
+extern BOOL_T kv_serialize_is_legacy(const char *in, const uint32_t in_len);
 
 /**
  * Reads data from a user-provided block device.
@@ -87,6 +156,7 @@ int user_provided_block_device_prog(const struct lfs_config *c, lfs_block_t bloc
     if (OPRT_OK != ret) {
         return LFS_ERR_IO;
     }
+    tal_kv_flash_account(size, 0);
     return LFS_ERR_OK;
 }
 
@@ -108,6 +178,7 @@ int user_provided_block_device_erase(const struct lfs_config *c, lfs_block_t blo
     if (OPRT_OK != ret) {
         return LFS_ERR_IO;
     }
+    tal_kv_flash_account(0, 1);
     return LFS_ERR_OK;
 }
 
@@ -126,6 +197,376 @@ int user_provided_block_device_sync(const struct lfs_config *c)
     return LFS_ERR_OK;
 }
 
+/**
+ * @brief Count flash programming and erasing for tal_kv_stat_get
+ *
+ * @param[in] prog_bytes: bytes programmed
+ * @param[in] erase_blocks: blocks erased
+ */
+void tal_kv_flash_account(uint32_t prog_bytes, uint32_t erase_blocks)
+{
+    s_kv_stat.prog_bytes += prog_bytes;
+    s_kv_stat.erase_blocks += erase_blocks;
+}
+
+static int __kv_lfs_write(const char *key, const uint8_t *data, size_t len)
+{
+    int result;
+    lfs_file_t file;
+
+    result = lfs_file_open(&lfs, &file, key, LFS_O_RDWR | LFS_O_CREAT | LFS_O_TRUNC);
+    if (LFS_ERR_OK != result) {
+        PR_ERR("lfs open %s err", key);
+        return result;
+    }
+    result = lfs_file_write(&lfs, &file, data, len);
+    lfs_file_close(&lfs, &file);
+    if (result != (int)len) {
+        PR_ERR("kv write fail %d", result);
+        return OPRT_KVS_WR_FAIL;
+    }
+
+    return OPRT_OK;
+}
+
+static int __kv_lfs_read(const char *key, uint8_t **data, size_t *len)
+{
+    int result;
+    lfs_file_t file;
+    uint8_t *buf = NULL;
+    lfs_soff_t size;
+
+    result = lfs_file_open(&lfs, &file, key, LFS_O_RDONLY);
+    if (LFS_ERR_OK != result) {
+        return result;
+    }
+    size = lfs_file_size(&lfs, &file);
+    buf = (size > 0) ? tal_malloc(size + 1) : NULL;
+    if (NULL == buf) {
+        lfs_file_close(&lfs, &file);
+        return (size > 0) ? OPRT_MALLOC_FAILED : OPRT_KVS_RD_FAIL;
+    }
+    result = lfs_file_read(&lfs, &file, buf, size);
+    lfs_file_close(&lfs, &file);
+    if (result != size) {
+        tal_free(buf);
+        PR_ERR("kv read error %d", result);
+        return OPRT_KVS_RD_FAIL;
+    }
+    *data = buf;
+    *len = size;
+
+    return OPRT_OK;
+}
+
+static int __kv_lfs_remove(const char *key)
+{
+    return lfs_remove(&lfs, key);
+}
+
+static const tal_kv_backend_t s_kv_lfs_backend = {
+    .name = "littlefs",
+    .write = __kv_lfs_write,
+    .read = __kv_lfs_read,
+    .remove = __kv_lfs_remove,
+};
+
+/**
+ * @brief encrypt a value with PKCS7 padding and write it to the backend
+ */
+static int __kv_store(const char *key, const uint8_t *value, size_t length)
+{
+    int result;
+    uint8_t iv[16];
+    uint32_t ec_len = (length / TAL_CIPHER_BLOCK_SIZE + 1) * TAL_CIPHER_BLOCK_SIZE;
+    uint8_t *ec_data = tal_malloc(ec_len);
+
+    if (NULL == ec_data) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memcpy(ec_data, value, length);
+    tal_pkcs7padding_buffer(ec_data, length);
+    memcpy(iv, lfs_kv_cfg.seed, 16);
+    result = tal_cipher_cbc_crypt(s_kv_cipher, SYMMETRY_ENCRYPT, iv, ec_data, ec_data, ec_len);
+    if (OPRT_OK != result) {
+        PR_DEBUG("key %s encrypt failed", key);
+    } else {
+        result = s_kv_backend->write(key, ec_data, ec_len);
+    }
+    tal_free(ec_data);
+
+    return result;
+}
+
+/**
+ * @brief read a value from the backend and decrypt it in place, the value
+ * is NUL terminated
+ */
+static int __kv_load(const char *key, uint8_t **value, size_t *length)
+{
+    int result;
+    uint8_t iv[16];
+    uint8_t *ec_data = NULL;
+    size_t ec_len = 0;
+    int32_t dec_len;
+
+    result = s_kv_backend->read(key, &ec_data, &ec_len);
+    if (OPRT_OK != result) {
+        return result;
+    }
+    PR_DEBUG("key:%s, len:%d", key, ec_len);
+    if (0 != ec_len % TAL_CIPHER_BLOCK_SIZE) {
+        tal_free(ec_data);
+        PR_ERR("key %s len %d err", key, ec_len);
+        return OPRT_KVS_RD_FAIL;
+    }
+    memcpy(iv, lfs_kv_cfg.seed, 16);
+    result = tal_cipher_cbc_crypt(s_kv_cipher, SYMMETRY_DECRYPT, iv, ec_data, ec_data, ec_len);
+    dec_len = tal_aes_get_actual_length(ec_data, ec_len);
+    if (OPRT_OK != result || dec_len < 0) {
+        tal_free(ec_data);
+        PR_ERR("key %s decrypt failed %d, %d-%d", key, result, dec_len, ec_len);
+        return OPRT_BUFFER_NOT_ENOUGH;
+    }
+    ec_data[dec_len] = 0;
+    *value = ec_data;
+    *length = (size_t)dec_len;
+
+    return OPRT_OK;
+}
+
+#if defined(ENABLE_KV_CACHE) && (ENABLE_KV_CACHE == 1)
+static kv_cache_node_t **__kv_cache_link(const char *key)
+{
+    kv_cache_node_t **link = &s_kv_cache.head;
+
+    while (*link && strcmp((*link)->key, key)) {
+        link = &(*link)->next;
+    }
+
+    return link;
+}
+
+static void __kv_cache_unlink(kv_cache_node_t **link)
+{
+    kv_cache_node_t *node = *link;
+
+    *link = node->next;
+    s_kv_cache.bytes -= node->size;
+    if (node->dirty) {
+        s_kv_cache.dirty_bytes -= node->len;
+    }
+    tal_free(node);
+}
+
+/**
+ * @brief drop the cached value of a key
+ *
+ * @return TRUE if the value was not written to flash yet
+ */
+static BOOL_T __kv_cache_drop(const char *key)
+{
+    kv_cache_node_t **link = __kv_cache_link(key);
+    BOOL_T dirty = FALSE;
+
+    if (*link) {
+        dirty = (*link)->dirty;
+        __kv_cache_unlink(link);
+    }
+
+    return dirty;
+}
+
+static kv_cache_node_t *__kv_cache_get(const char *key)
+{
+    kv_cache_node_t **link = __kv_cache_link(key);
+    kv_cache_node_t *node = *link;
+
+    if (node) {
+        *link = node->next;
+        node->next = s_kv_cache.head;
+        s_kv_cache.head = node;
+    }
+
+    return node;
+}
+
+static int __kv_cache_flush(void)
+{
+    kv_cache_node_t *node;
+    int rt = OPRT_OK, result;
+
+    if (0 == s_kv_cache.dirty_bytes) {
+        return OPRT_OK;
+    }
+
+    for (node = s_kv_cache.head; node; node = node->next) {
+        if (!node->dirty) {
+            continue;
+        }
+        result = __kv_store(node->key, node->value, node->len);
+        if (OPRT_OK != result) {
+            PR_ERR("kv flush %s err %d", node->key, result);
+            rt = result;
+            continue;
+        }
+        node->dirty = FALSE;
+        s_kv_cache.dirty_bytes -= node->len;
+    }
+    s_kv_stat.flushes++;
+
+    return rt;
+}
+
+// drop the least recently used value that is on flash already
+static BOOL_T __kv_cache_evict(void)
+{
+    kv_cache_node_t **link, **victim = NULL;
+
+    for (link = &s_kv_cache.head; *link; link = &(*link)->next) {
+        if (!(*link)->dirty) {
+            victim = link;
+        }
+    }
+    if (NULL == victim) {
+        return FALSE;
+    }
+    __kv_cache_unlink(victim);
+
+    return TRUE;
+}
+
+static int __kv_cache_put(const char *key, const uint8_t *value, size_t length, BOOL_T dirty)
+{
+    kv_cache_node_t *node = NULL;
+    size_t key_len = strlen(key);
+    uint32_t size = sizeof(kv_cache_node_t) + key_len + 1 + length;
+
+    if (size > TAL_KV_CACHE_SIZE) {
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+
+    __kv_cache_drop(key);
+    while (s_kv_cache.bytes + size > TAL_KV_CACHE_SIZE) {
+        if (__kv_cache_evict()) {
+            continue;
+        }
+        // full of pending values, write them out to make room
+        if (!dirty || OPRT_OK != __kv_cache_flush()) {
+            return OPRT_EXCEED_UPPER_LIMIT;
+        }
+    }
+
+    node = tal_malloc(size);
+    if (NULL == node) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memcpy(node->key, key, key_len + 1);
+    node->value = (uint8_t *)node->key + key_len + 1;
+    memcpy(node->value, value, length);
+    node->len = length;
+    node->size = size;
+    node->dirty = dirty;
+    node->next = s_kv_cache.head;
+    s_kv_cache.head = node;
+    s_kv_cache.bytes += size;
+    if (dirty) {
+        s_kv_cache.dirty_bytes += length;
+    }
+
+    return OPRT_OK;
+}
+
+static void __kv_cache_schedule(void)
+{
+    if (s_kv_cache.dirty_bytes >= TAL_KV_CACHE_DIRTY_MAX) {
+        __kv_cache_flush();
+    }
+    if (s_kv_cache.dirty_bytes && !tal_sw_timer_is_running(s_kv_cache.timer)) {
+        tal_sw_timer_start(s_kv_cache.timer, TAL_KV_CACHE_FLUSH_MS, TAL_TIMER_ONCE);
+    }
+}
+
+static void __kv_cache_flush_work(void *data)
+{
+    tal_mutex_lock(lfs_mutex);
+    __kv_cache_flush();
+    // retry what failed
+    if (s_kv_cache.dirty_bytes && !tal_sw_timer_is_running(s_kv_cache.timer)) {
+        tal_sw_timer_start(s_kv_cache.timer, TAL_KV_CACHE_FLUSH_MS, TAL_TIMER_ONCE);
+    }
+    tal_mutex_unlock(lfs_mutex);
+}
+
+static void __kv_cache_timer_cb(TIMER_ID timer_id, void *arg)
+{
+    // flash erase and write block for long, they run on the system workqueue
+    if (OPRT_OK != tal_workq_schedule(WORKQ_SYSTEM, __kv_cache_flush_work, NULL)) {
+        tal_sw_timer_start(s_kv_cache.timer, TAL_KV_CACHE_FLUSH_MS, TAL_TIMER_ONCE);
+    }
+}
+#endif
+
+static int __kv_journal_apply(const uint8_t *journal, size_t len)
+{
+    char key[TAL_KV_KEY_MAX + 1];
+    uint32_t num, i, value_len;
+    size_t off = KV_JOURNAL_HEAD_LEN;
+    uint8_t key_len, op;
+    int result;
+
+    if (len < KV_JOURNAL_HEAD_LEN) {
+        return OPRT_KVS_RD_FAIL;
+    }
+
+    num = journal[0] | (journal[1] << 8);
+    for (i = 0; i < num; i++) {
+        if (off + KV_JOURNAL_ITEM_LEN > len) {
+            return OPRT_KVS_RD_FAIL;
+        }
+        key_len = journal[off];
+        op = journal[off + 1];
+        value_len = journal[off + 2] | (journal[off + 3] << 8) | (journal[off + 4] << 16) |
+                    ((uint32_t)journal[off + 5] << 24);
+        off += KV_JOURNAL_ITEM_LEN;
+        if (value_len > len || off + key_len + value_len > len) {
+            return OPRT_KVS_RD_FAIL;
+        }
+        memcpy(key, journal + off, key_len);
+        key[key_len] = 0;
+        off += key_len;
+
+        if (KV_JOURNAL_OP_DEL == op) {
+            // may not exist
+            s_kv_backend->remove(key);
+        } else {
+            result = __kv_store(key, journal + off, value_len);
+            if (OPRT_OK != result) {
+                return result;
+            }
+        }
+        off += value_len;
+    }
+
+    return OPRT_OK;
+}
+
+// complete a tal_kv_batch_set interrupted by a power loss
+static void __kv_journal_replay(void)
+{
+    uint8_t *journal = NULL;
+    size_t len = 0;
+
+    if (OPRT_OK != __kv_load(TAL_KV_JOURNAL_KEY, &journal, &len)) {
+        return;
+    }
+    PR_NOTICE("kv replay journal %d", len);
+    if (OPRT_OK == __kv_journal_apply(journal, len)) {
+        s_kv_backend->remove(TAL_KV_JOURNAL_KEY);
+    }
+    tal_free(journal);
+}
+
 /**
  * @brief Initializes the TAL Key-Value (KV) module.
  *
@@ -177,8 +618,40 @@ int tal_kv_init(tal_kv_cfg_t *kv_cfg)
         lfs_format(&lfs, &lfs_cfg);
         err = lfs_mount(&lfs, &lfs_cfg);
     }
+    if (err) {
+        return err;
+    }
+
+    s_kv_backend = &s_kv_lfs_backend;
+#if defined(ENABLE_KV_LOG) && (ENABLE_KV_LOG == 1)
+    // littlefs stays mounted for tal_fs
+    s_kv_backend = tal_kv_log_backend_init();
+    if (NULL == s_kv_backend) {
+        PR_ERR("kv log init failed, use littlefs");
+        s_kv_backend = &s_kv_lfs_backend;
+    }
+#endif
+
+    // keyed once, the key schedule is not rebuilt per value
+    if (s_kv_cipher) {
+        tal_cipher_destroy(s_kv_cipher);
+        s_kv_cipher = NULL;
+    }
+    err = tal_cipher_create(NULL, (const uint8_t *)lfs_kv_cfg.key, 128, &s_kv_cipher);
+    if (OPRT_OK != err) {
+        PR_ERR("kv cipher create err %d", err);
+        return err;
+    }
+
+#if defined(ENABLE_KV_CACHE) && (ENABLE_KV_CACHE == 1)
+    if (NULL == s_kv_cache.timer && OPRT_OK != tal_sw_timer_create(__kv_cache_timer_cb, NULL, &s_kv_cache.timer)) {
+        s_kv_cache.bypass = TRUE;
+    }
+#endif
 
-    return err;
+    __kv_journal_replay();
+
+    return OPRT_OK;
 }
 
 /**
@@ -197,7 +670,6 @@ int tal_kv_init(tal_kv_cfg_t *kv_cfg)
 int tal_kv_set(const char *key, const uint8_t *value, size_t length)
 {
     int result;
-    lfs_file_t file;
 
     PR_DEBUG("key:%s, len %d", key, length);
 
@@ -206,36 +678,21 @@ int tal_kv_set(const char *key, const uint8_t *value, size_t length)
     }
 
     tal_mutex_lock(lfs_mutex);
-    result = lfs_file_open(&lfs, &file, key, LFS_O_RDWR | LFS_O_CREAT | LFS_O_TRUNC);
-    if (LFS_ERR_OK != result) {
-        tal_mutex_unlock(lfs_mutex);
-        PR_ERR("lfs open %s err", key);
-        return result;
-    }
-    uint8_t *ec_data = NULL;
-    uint32_t ec_len = 0;
-    uint8_t iv[16];
-
-    memcpy(iv, lfs_kv_cfg.seed, 16);
-    result =
-        tal_aes128_cbc_encode((uint8_t *)value, length, (uint8_t *)lfs_kv_cfg.key, iv, &ec_data, (uint32_t *)&ec_len);
-    if (OPRT_OK != result) {
-        lfs_file_close(&lfs, &file);
+    s_kv_stat.sets++;
+    s_kv_stat.user_bytes += length;
+#if defined(ENABLE_KV_CACHE) && (ENABLE_KV_CACHE == 1)
+    if (!s_kv_cache.bypass && OPRT_OK == __kv_cache_put(key, value, length, TRUE)) {
+        __kv_cache_schedule();
         tal_mutex_unlock(lfs_mutex);
-        PR_DEBUG("key %s encrypt failed", key);
-        return result;
+        return OPRT_OK;
     }
-    lfs_file_rewind(&lfs, &file);
-    result = lfs_file_write(&lfs, &file, ec_data, ec_len);
-    lfs_file_close(&lfs, &file);
-    tal_aes_free_data(ec_data);
+    // too large for the cache, write through
+    __kv_cache_drop(key);
+#endif
+    result = __kv_store(key, value, length);
     tal_mutex_unlock(lfs_mutex);
-    if (result != ec_len) {
-        PR_ERR("kv write fail %d", result);
-        return OPRT_KVS_WR_FAIL;
-    }
 
-    return OPRT_OK;
+    return result;
 }
 
 /**
@@ -257,55 +714,43 @@ int tal_kv_set(const char *key, const uint8_t *value, size_t length)
 int tal_kv_get(const char *key, uint8_t **value, size_t *length)
 {
     int result;
-    lfs_file_t file;
 
     if (NULL == key || NULL == value || NULL == length) {
         return OPRT_INVALID_PARM;
     }
 
     tal_mutex_lock(lfs_mutex);
-    result = lfs_file_open(&lfs, &file, key, LFS_O_RDONLY);
-    if (LFS_ERR_OK != result) {
-        PR_ERR("lfs open %s %d err", key, result);
+    s_kv_stat.gets++;
+#if defined(ENABLE_KV_CACHE) && (ENABLE_KV_CACHE == 1)
+    kv_cache_node_t *node = __kv_cache_get(key);
+    if (node) {
+        uint8_t *buf = tal_malloc(node->len + 1);
+        if (NULL == buf) {
+            tal_mutex_unlock(lfs_mutex);
+            return OPRT_MALLOC_FAILED;
+        }
+        memcpy(buf, node->value, node->len);
+        buf[node->len] = 0;
+        *value = buf;
+        *length = node->len;
+        s_kv_stat.cache_hits++;
         tal_mutex_unlock(lfs_mutex);
-        return result;
+        return OPRT_OK;
     }
-    uint8_t *ec_data = NULL;
-    uint32_t ec_len = lfs_file_size(&lfs, &file);
-
-    ec_data = tal_malloc(ec_len + 1);
-    if (NULL == ec_data) {
-        result = OPRT_MALLOC_FAILED;
-        tal_mutex_unlock(lfs_mutex);
-        return result;
+#endif
+    result = __kv_load(key, value, length);
+#if defined(ENABLE_KV_CACHE) && (ENABLE_KV_CACHE == 1)
+    if (OPRT_OK == result && !s_kv_cache.bypass) {
+        __kv_cache_put(key, *value, *length, FALSE);
     }
-    PR_DEBUG("key:%s, len:%d", key, ec_len);
-    result = lfs_file_read(&lfs, &file, ec_data, ec_len);
-    lfs_file_close(&lfs, &file);
+#endif
     tal_mutex_unlock(lfs_mutex);
-    if (result <= 0) {
+    if (OPRT_OK != result) {
         *length = 0;
-        tal_free(ec_data);
-        PR_ERR("kv read error %d", result);
-        return OPRT_KVS_RD_FAIL;
-    }
-    uint8_t *dec_data = NULL;
-    uint32_t dec_len = 0;
-    uint8_t iv[16];
-
-    memcpy(iv, lfs_kv_cfg.seed, 16);
-    result = tal_aes128_cbc_decode(ec_data, ec_len, (uint8_t *)lfs_kv_cfg.key, iv, &dec_data, (uint32_t *)&dec_len);
-    dec_len = tal_aes_get_actual_length(dec_data, dec_len);
-    tal_free(ec_data);
-    if (OPRT_OK != result || dec_len > ec_len) {
-        PR_ERR("key %s decrypt failed %d, %d-%d", key, result, dec_len, ec_len);
-        return OPRT_BUFFER_NOT_ENOUGH;
+        PR_ERR("kv get %s err %d", key, result);
     }
-    *value = dec_data;
-    *length = (size_t)dec_len;
-    dec_data[dec_len] = 0;
 
-    return OPRT_OK;
+    return result;
 }
 
 /**
@@ -322,9 +767,15 @@ int tal_kv_del(const char *key)
     PR_DEBUG("key:%s", key);
 
     tal_mutex_lock(lfs_mutex);
-    int result = lfs_remove(&lfs, key);
+    int result = s_kv_backend->remove(key);
+#if defined(ENABLE_KV_CACHE) && (ENABLE_KV_CACHE == 1)
+    // a value still pending in the cache is not on flash yet
+    if (__kv_cache_drop(key)) {
+        result = OPRT_OK;
+    }
+#endif
     tal_mutex_unlock(lfs_mutex);
-    if (LFS_ERR_OK == result) {
+    if (OPRT_OK == result) {
         PR_DEBUG("Deleted successfully");
         return OPRT_OK;
     }
@@ -334,6 +785,148 @@ int tal_kv_del(const char *key)
     return OPRT_COM_ERROR;
 }
 
+/**
+ * @brief Sets and deletes several keys as one transaction.
+ *
+ * More than one item is serialized into a journal value that is stored
+ * before the items are applied and removed after, tal_kv_init applies a
+ * journal that is left over. The cache is updated once the items are stored.
+ *
+ * @param items The keys to set, an item with a NULL value deletes its key.
+ * @param num The number of items.
+ * @return 0 if all items were stored, or a negative error code if an error
+ * occurred.
+ */
+int tal_kv_batch_set(const tal_kv_item_t *items, uint32_t num)
+{
+    int result;
+    uint32_t i, value_len, user_bytes = 0;
+    size_t key_len, off, journal_len = KV_JOURNAL_HEAD_LEN;
+    uint8_t *journal = NULL;
+    BOOL_T committed = FALSE;
+
+    if (NULL == items || 0 == num || num > 0xFFFF) {
+        return OPRT_INVALID_PARM;
+    }
+    for (i = 0; i < num; i++) {
+        if (NULL == items[i].key || (items[i].value && 0 == items[i].length)) {
+            return OPRT_INVALID_PARM;
+        }
+        key_len = strlen(items[i].key);
+        if (0 == key_len || key_len > TAL_KV_KEY_MAX) {
+            return OPRT_INVALID_PARM;
+        }
+        value_len = items[i].value ? items[i].length : 0;
+        journal_len += KV_JOURNAL_ITEM_LEN + key_len + value_len;
+        user_bytes += value_len;
+    }
+
+    if (num > 1) {
+        journal = tal_malloc(journal_len);
+        if (NULL == journal) {
+            return OPRT_MALLOC_FAILED;
+        }
+        journal[0] = num & 0xFF;
+        journal[1] = (num >> 8) & 0xFF;
+        for (i = 0, off = KV_JOURNAL_HEAD_LEN; i < num; i++) {
+            key_len = strlen(items[i].key);
+            value_len = items[i].value ? items[i].length : 0;
+            journal[off] = key_len;
+            journal[off + 1] = items[i].value ? KV_JOURNAL_OP_SET : KV_JOURNAL_OP_DEL;
+            journal[off + 2] = value_len & 0xFF;
+            journal[off + 3] = (value_len >> 8) & 0xFF;
+            journal[off + 4] = (value_len >> 16) & 0xFF;
+            journal[off + 5] = (value_len >> 24) & 0xFF;
+            off += KV_JOURNAL_ITEM_LEN;
+            memcpy(journal + off, items[i].key, key_len);
+            off += key_len;
+            if (value_len) {
+                memcpy(journal + off, items[i].value, value_len);
+                off += value_len;
+            }
+        }
+    }
+
+    tal_mutex_lock(lfs_mutex);
+    s_kv_stat.sets += num;
+    s_kv_stat.user_bytes += user_bytes;
+    if (NULL == journal) {
+        result = OPRT_OK;
+        if (items[0].value) {
+            result = __kv_store(items[0].key, items[0].value, items[0].length);
+        } else {
+            // may not exist
+            s_kv_backend->remove(items[0].key);
+        }
+        committed = (OPRT_OK == result);
+    } else {
+        result = __kv_store(TAL_KV_JOURNAL_KEY, journal, journal_len);
+        if (OPRT_OK == result) {
+            committed = TRUE;
+            result = __kv_journal_apply(journal, journal_len);
+            if (OPRT_OK == result) {
+                s_kv_backend->remove(TAL_KV_JOURNAL_KEY);
+            }
+        }
+        tal_free(journal);
+    }
+#if defined(ENABLE_KV_CACHE) && (ENABLE_KV_CACHE == 1)
+    // the batch supersedes pending values of its keys
+    for (i = 0; committed && i < num; i++) {
+        if (OPRT_OK != result || NULL == items[i].value || s_kv_cache.bypass ||
+            OPRT_OK != __kv_cache_put(items[i].key, items[i].value, items[i].length, FALSE)) {
+            __kv_cache_drop(items[i].key);
+        }
+    }
+#endif
+    tal_mutex_unlock(lfs_mutex);
+    if (OPRT_OK != result) {
+        PR_ERR("kv batch of %d %s err %d", num, committed ? "apply" : "commit", result);
+    }
+
+    return result;
+}
+
+/**
+ * @brief Writes the values held by the write-back cache to flash.
+ *
+ * @return 0 if all pending values were written, or a negative error code if an
+ * error occurred.
+ */
+int tal_kv_flush(void)
+{
+#if defined(ENABLE_KV_CACHE) && (ENABLE_KV_CACHE == 1)
+    int result;
+
+    tal_mutex_lock(lfs_mutex);
+    result = __kv_cache_flush();
+    tal_mutex_unlock(lfs_mutex);
+
+    return result;
+#else
+    return OPRT_OK;
+#endif
+}
+
+/**
+ * @brief Gets the tal_kv counters.
+ *
+ * @param stat The counters.
+ * @return 0 on success, or a negative error code if an error occurred.
+ */
+int tal_kv_stat_get(tal_kv_stat_t *stat)
+{
+    if (NULL == stat) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(lfs_mutex);
+    memcpy(stat, &s_kv_stat, sizeof(tal_kv_stat_t));
+    tal_mutex_unlock(lfs_mutex);
+
+    return OPRT_OK;
+}
+
 /**
  * @brief Frees the memory allocated for a value in the TAL Key-Value store.
  *
@@ -365,6 +958,21 @@ int tal_kv_free(uint8_t *value)
  */
 void tal_kv_cmd(int argc, char *argv[])
 {
+    if (argc < 2) {
+        return;
+    }
+
+    if (0 == strcmp("flush", argv[1])) {
+        tal_kv_flush();
+        return;
+    } else if (0 == strcmp("stat", argv[1])) {
+        tal_kv_stat_t stat;
+        tal_kv_stat_get(&stat);
+        PR_DEBUG("%s sets %d gets %d hits %d flushes %d bytes %d prog %d erase %d", s_kv_backend->name, stat.sets,
+                 stat.gets, stat.cache_hits, stat.flushes, stat.user_bytes, stat.prog_bytes, stat.erase_blocks);
+        return;
+    }
+
     if (argc < 3) {
         return;
     }
@@ -419,7 +1027,6 @@ int tal_kv_serialize_set(const char *key, kv_db_t *db, size_t dbcnt)
         PR_ERR("kv_serialize  fail. %d", ret);
         return ret;
     }
-    PR_TRACE("write buf:%s", buf);
     ret = tal_kv_set(key, (const uint8_t *)buf, len);
     tal_free(buf);
     if (OPRT_OK != ret) {
@@ -458,11 +1065,15 @@ int tal_kv_serialize_get(const char *key, kv_db_t *db, size_t dbcnt)
         PR_ERR("kv_get fails %s %d", key, ret);
         return ret;
     }
-    ret = kv_deserialize((char *)buf, db, dbcnt);
-    tal_free(buf);
+    ret = kv_deserialize((char *)buf, len, db, dbcnt);
     if (OPRT_OK != ret) {
         PR_ERR("kv_deserialize fail. %d", ret);
+    } else if (kv_serialize_is_legacy((char *)buf, len)) {
+        // written as JSON by an older SDK, store it in the binary format
+        PR_NOTICE("kv %s migrate to binary", key);
+        tal_kv_serialize_set(key, db, dbcnt);
     }
+    tal_free(buf);
 
     return ret;
 }
@@ -475,4 +1086,136 @@ int tal_kv_serialize_get(const char *key, kv_db_t *db, size_t dbcnt)
 lfs_t *tal_lfs_get()
 {
     return &lfs;
-}
\ No newline at end of file
+}
+
+#if defined(ENABLE_KV_BENCHMARK)
+#define KV_BENCH_KEY_LEN 16
+
+static void __kv_bench_reset(void)
+{
+    tal_mutex_lock(lfs_mutex);
+    memset(&s_kv_stat, 0, sizeof(s_kv_stat));
+    tal_mutex_unlock(lfs_mutex);
+}
+
+static void __kv_bench_report(const char *name, uint32_t ops, SYS_TIME_T start)
+{
+    tal_kv_stat_t stat;
+    SYS_TIME_T ms = tal_system_get_millisecond() - start;
+    uint32_t amp = 0;
+
+    tal_kv_stat_get(&stat);
+    if (0 == ms) {
+        ms = 1;
+    }
+    if (stat.user_bytes) {
+        amp = (uint32_t)((uint64_t)stat.prog_bytes * 100 / stat.user_bytes);
+    }
+    PR_NOTICE("kv %s %-6s: %u ops/s, write amp %u.%02u, %u blocks erased, %u cache hits", s_kv_backend->name, name,
+              (uint32_t)((uint64_t)ops * 1000 / ms), amp / 100, amp % 100, stat.erase_blocks, stat.cache_hits);
+}
+
+/**
+ * @brief Benchmarks set, batch set and get on the configured backend.
+ *
+ * @param keys The number of distinct keys.
+ * @param value_len The value length.
+ * @param rounds The number of sets per measurement.
+ * @return 0 on success, or a negative error code if an error occurred.
+ */
+int tal_kv_benchmark(uint32_t keys, uint32_t value_len, uint32_t rounds)
+{
+    int rt = OPRT_OK;
+    uint32_t i, batches;
+    SYS_TIME_T start;
+    uint8_t *value = NULL, *buf = NULL;
+    size_t len;
+    char(*names)[KV_BENCH_KEY_LEN] = NULL;
+    tal_kv_item_t *items = NULL;
+
+    if (0 == keys || 0 == value_len || 0 == rounds) {
+        return OPRT_INVALID_PARM;
+    }
+
+    value = tal_malloc(value_len);
+    names = tal_malloc(keys * KV_BENCH_KEY_LEN);
+    items = tal_malloc(keys * sizeof(tal_kv_item_t));
+    if (NULL == value || NULL == names || NULL == items) {
+        rt = OPRT_MALLOC_FAILED;
+        goto __exit;
+    }
+    memset(value, 0x5a, value_len);
+    for (i = 0; i < keys; i++) {
+        snprintf(names[i], KV_BENCH_KEY_LEN, "kvbench%u", (unsigned)i);
+        items[i].key = names[i];
+        items[i].value = value;
+        items[i].length = value_len;
+    }
+    PR_NOTICE("kv bench %u keys, %u bytes, %u rounds", keys, value_len, rounds);
+
+    // every set goes to flash
+#if defined(ENABLE_KV_CACHE) && (ENABLE_KV_CACHE == 1)
+    tal_kv_flush();
+    s_kv_cache.bypass = TRUE;
+#endif
+    __kv_bench_reset();
+    start = tal_system_get_millisecond();
+    for (i = 0; i < rounds && OPRT_OK == rt; i++) {
+        value[0] = (uint8_t)i;
+        rt = tal_kv_set(names[i % keys], value, value_len);
+    }
+    __kv_bench_report("set", rounds, start);
+#if defined(ENABLE_KV_CACHE) && (ENABLE_KV_CACHE == 1)
+    s_kv_cache.bypass = FALSE;
+
+    // the same sets coalesced by the cache, the flush is timed too
+    __kv_bench_reset();
+    start = tal_system_get_millisecond();
+    for (i = 0; i < rounds && OPRT_OK == rt; i++) {
+        value[0] = (uint8_t)i;
+        rt = tal_kv_set(names[i % keys], value, value_len);
+    }
+    if (OPRT_OK == rt) {
+        rt = tal_kv_flush();
+    }
+    __kv_bench_report("cached", rounds, start);
+#endif
+
+    // all keys in one transaction
+    batches = (rounds + keys - 1) / keys;
+    __kv_bench_reset();
+    start = tal_system_get_millisecond();
+    for (i = 0; i < batches && OPRT_OK == rt; i++) {
+        value[0] = (uint8_t)i;
+        rt = tal_kv_batch_set(items, keys);
+    }
+    __kv_bench_report("batch", batches * keys, start);
+
+    __kv_bench_reset();
+    start = tal_system_get_millisecond();
+    for (i = 0; i < rounds && OPRT_OK == rt; i++) {
+        rt = tal_kv_get(names[i % keys], &buf, &len);
+        if (OPRT_OK == rt) {
+            if (len != value_len) {
+                rt = OPRT_COM_ERROR;
+            }
+            tal_kv_free(buf);
+        }
+    }
+    __kv_bench_report("get", rounds, start);
+
+    for (i = 0; i < keys; i++) {
+        tal_kv_del(names[i]);
+    }
+    if (OPRT_OK != rt) {
+        PR_ERR("kv bench err %d", rt);
+    }
+
+__exit:
+    tal_free(value);
+    tal_free(names);
+    tal_free(items);
+
+    return rt;
+}
+#endif
@@ -0,0 +1,604 @@
+/**
+ * @file tal_kv_log.c
+ * @brief Log-structured tal_kv backend.
+ *
+ * The TUYA_FLASH_TYPE_KV_DATA partition is used as a circular log of sectors.
+ * A value is appended as a new record and the RAM index moves to it, so an
+ * update programs only the record instead of rewriting a littlefs file and
+ * its metadata pair. A delete appends a tombstone.
+ *
+ * Every sector starts with a header holding a sequence number, a record is
+ * valid only with the sequence number of its sector and a matching CRC, so
+ * data left over from an earlier use of the sector is never taken for a
+ * record. One sector is always kept free: when the log runs out of room the
+ * oldest sector is compacted, its live records are copied to the free sector
+ * and the oldest sector is released. As the oldest sector goes first, a
+ * tombstone found there is dropped, no older record of the key is left.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tal_kv.h"
+#include "tal_kv_port.h"
+#include "tal_api.h"
+#include "tkl_flash.h"
+#include "crc32i.h"
+
+#if defined(ENABLE_KV_LOG) && (ENABLE_KV_LOG == 1)
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+// buckets of the RAM index
+#ifndef TAL_KV_LOG_BUCKETS
+#define TAL_KV_LOG_BUCKETS 32
+#endif
+
+#define KV_LOG_KEY_MAX      255
+#define KV_LOG_SECTOR_MAGIC 0x4C564B54 // "TKVL"
+#define KV_LOG_REC_MAGIC    0x4552
+#define KV_LOG_OP_SET       0
+#define KV_LOG_OP_DEL       1
+#define KV_LOG_NONE         0xFFFFFFFF
+
+#define KV_LOG_ALIGN(x)     (((x) + 3) & ~3u)
+#define KV_LOG_REC_SIZE(key_len, len) KV_LOG_ALIGN(sizeof(kv_log_rec_head_t) + (key_len) + (len))
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t crc; // of magic and seq
+    uint32_t reserved;
+} kv_log_sector_head_t;
+
+/* record: head, key without '\0', value, padded to 4 bytes */
+typedef struct {
+    uint16_t magic;
+    uint8_t key_len;
+    uint8_t op;
+    uint32_t len; // value length
+    uint32_t seq; // seq of the sector
+    uint32_t crc; // of the fields above, key and value
+} kv_log_rec_head_t;
+
+typedef struct kv_log_node {
+    struct kv_log_node *next;
+    uint32_t addr; // record offset in the partition
+    uint32_t len;  // value length
+    BOOL_T deleted;
+    char key[];
+} kv_log_node_t;
+
+typedef struct {
+    uint32_t base; // partition address
+    uint32_t sector_size;
+    uint32_t sector_num;
+    uint32_t *sector_seq; // 0: free
+    uint32_t active;      // sector appended to, KV_LOG_NONE until the first write
+    uint32_t offset;      // append offset in the active sector
+    uint32_t seq;         // highest sector seq
+    uint32_t live_bytes;  // bytes of the records the index points to
+    kv_log_node_t *bucket[TAL_KV_LOG_BUCKETS];
+} kv_log_t;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static kv_log_t s_kv_log;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static uint32_t __log_hash(const char *key)
+{
+    uint32_t hash = 2166136261u;
+
+    while (*key) {
+        hash = (hash ^ (uint8_t)*key++) * 16777619u;
+    }
+    return hash % TAL_KV_LOG_BUCKETS;
+}
+
+static uint32_t __log_sector_addr(uint32_t sector)
+{
+    return sector * s_kv_log.sector_size;
+}
+
+static int __log_flash_write(uint32_t addr, const void *data, uint32_t len)
+{
+    if (OPRT_OK != tkl_flash_write(s_kv_log.base + addr, (const uint8_t *)data, len)) {
+        return OPRT_KVS_WR_FAIL;
+    }
+    tal_kv_flash_account(len, 0);
+    return OPRT_OK;
+}
+
+static int __log_flash_read(uint32_t addr, void *data, uint32_t len)
+{
+    return (OPRT_OK == tkl_flash_read(s_kv_log.base + addr, (uint8_t *)data, len)) ? OPRT_OK : OPRT_KVS_RD_FAIL;
+}
+
+static uint32_t __log_sector_crc(const kv_log_sector_head_t *head)
+{
+    return hash_crc32i_total(head, offsetof(kv_log_sector_head_t, crc));
+}
+
+static uint32_t __log_rec_crc(const kv_log_rec_head_t *head, const void *data, uint32_t len)
+{
+    uint32_t crc = hash_crc32i_init();
+
+    crc = hash_crc32i_update(crc, head, offsetof(kv_log_rec_head_t, crc));
+    crc = hash_crc32i_update(crc, data, len);
+    return hash_crc32i_finish(crc);
+}
+
+static uint32_t __log_free_num(void)
+{
+    uint32_t i, num = 0;
+
+    for (i = 0; i < s_kv_log.sector_num; i++) {
+        if (0 == s_kv_log.sector_seq[i]) {
+            num++;
+        }
+    }
+    return num;
+}
+
+/* returns the free sector following the active one, the sectors are used round robin */
+static uint32_t __log_free_next(void)
+{
+    uint32_t i, sector;
+    uint32_t start = (KV_LOG_NONE == s_kv_log.active) ? 0 : s_kv_log.active + 1;
+
+    for (i = 0; i < s_kv_log.sector_num; i++) {
+        sector = (start + i) % s_kv_log.sector_num;
+        if (0 == s_kv_log.sector_seq[sector]) {
+            return sector;
+        }
+    }
+    return KV_LOG_NONE;
+}
+
+static uint32_t __log_oldest(void)
+{
+    uint32_t i, oldest = KV_LOG_NONE;
+
+    for (i = 0; i < s_kv_log.sector_num; i++) {
+        if (s_kv_log.sector_seq[i] &&
+            (KV_LOG_NONE == oldest || s_kv_log.sector_seq[i] < s_kv_log.sector_seq[oldest])) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+static int __log_sector_open(uint32_t sector)
+{
+    kv_log_sector_head_t head;
+    int rt;
+
+    if (OPRT_OK != tkl_flash_erase(s_kv_log.base + __log_sector_addr(sector), s_kv_log.sector_size)) {
+        return OPRT_KVS_WR_FAIL;
+    }
+    tal_kv_flash_account(0, 1);
+
+    memset(&head, 0xFF, sizeof(head));
+    head.magic = KV_LOG_SECTOR_MAGIC;
+    head.seq = s_kv_log.seq + 1;
+    head.crc = __log_sector_crc(&head);
+    rt = __log_flash_write(__log_sector_addr(sector), &head, sizeof(head));
+    if (OPRT_OK != rt) {
+        return rt;
+    }
+    s_kv_log.seq = head.seq;
+    s_kv_log.sector_seq[sector] = head.seq;
+    s_kv_log.active = sector;
+    s_kv_log.offset = sizeof(head);
+
+    return OPRT_OK;
+}
+
+/* clears the magic, programming bits to 0 needs no erase */
+static int __log_sector_release(uint32_t sector)
+{
+    uint32_t magic = 0;
+    int rt;
+
+    rt = __log_flash_write(__log_sector_addr(sector), &magic, sizeof(magic));
+    if (OPRT_OK != rt) {
+        PR_ERR("kv log release sector %d err", sector);
+        return rt;
+    }
+    s_kv_log.sector_seq[sector] = 0;
+    if (sector == s_kv_log.active) {
+        s_kv_log.active = KV_LOG_NONE;
+    }
+
+    return OPRT_OK;
+}
+
+static kv_log_node_t **__log_node_link(const char *key)
+{
+    kv_log_node_t **link = &s_kv_log.bucket[__log_hash(key)];
+
+    while (*link && strcmp((*link)->key, key)) {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+static int __log_node_set(const char *key, uint32_t addr, uint32_t len, BOOL_T deleted)
+{
+    kv_log_node_t **link = __log_node_link(key);
+    kv_log_node_t *node = *link;
+    size_t key_len = strlen(key);
+
+    if (node) {
+        s_kv_log.live_bytes -= KV_LOG_REC_SIZE(key_len, node->len);
+    } else {
+        node = tal_malloc(sizeof(kv_log_node_t) + key_len + 1);
+        if (NULL == node) {
+            return OPRT_MALLOC_FAILED;
+        }
+        memcpy(node->key, key, key_len + 1);
+        node->next = NULL;
+        *link = node;
+    }
+    node->addr = addr;
+    node->len = len;
+    node->deleted = deleted;
+    s_kv_log.live_bytes += KV_LOG_REC_SIZE(key_len, len);
+
+    return OPRT_OK;
+}
+
+static void __log_node_drop(kv_log_node_t **link)
+{
+    kv_log_node_t *node = *link;
+
+    s_kv_log.live_bytes -= KV_LOG_REC_SIZE(strlen(node->key), node->len);
+    *link = node->next;
+    tal_free(node);
+}
+
+/* appends one record to the active sector, room is reserved by the caller */
+static int __log_append(uint8_t op, const char *key, const uint8_t *data, uint32_t len, uint32_t *addr)
+{
+    uint8_t buf[sizeof(kv_log_rec_head_t) + KV_LOG_KEY_MAX];
+    kv_log_rec_head_t *head = (kv_log_rec_head_t *)buf;
+    uint8_t key_len = (uint8_t)strlen(key);
+    uint32_t crc;
+    int rt;
+
+    head->magic = KV_LOG_REC_MAGIC;
+    head->key_len = key_len;
+    head->op = op;
+    head->len = len;
+    head->seq = s_kv_log.sector_seq[s_kv_log.active];
+    memcpy(buf + sizeof(kv_log_rec_head_t), key, key_len);
+
+    crc = hash_crc32i_init();
+    crc = hash_crc32i_update(crc, head, offsetof(kv_log_rec_head_t, crc));
+    crc = hash_crc32i_update(crc, key, key_len);
+    crc = hash_crc32i_update(crc, data, len);
+    head->crc = hash_crc32i_finish(crc);
+
+    *addr = __log_sector_addr(s_kv_log.active) + s_kv_log.offset;
+    rt = __log_flash_write(*addr, buf, sizeof(kv_log_rec_head_t) + key_len);
+    if (OPRT_OK == rt && len) {
+        rt = __log_flash_write(*addr + sizeof(kv_log_rec_head_t) + key_len, data, len);
+    }
+    s_kv_log.offset += KV_LOG_REC_SIZE(key_len, len);
+    // the scan on mount stops at a broken record, nothing may follow it
+    if (OPRT_OK != rt) {
+        s_kv_log.active = KV_LOG_NONE;
+    }
+
+    return rt;
+}
+
+static int __log_load(void);
+
+/* copies the live records of the oldest sector to the free sector and releases it */
+static int __log_compact(void)
+{
+    uint32_t victim = __log_oldest();
+    uint32_t target = __log_free_next();
+    uint32_t i, addr, start, end;
+    kv_log_node_t **link;
+    uint8_t *buf = NULL;
+    int rt;
+
+    if (KV_LOG_NONE == victim || KV_LOG_NONE == target) {
+        return OPRT_KVS_WR_FAIL;
+    }
+    start = __log_sector_addr(victim);
+    end = start + s_kv_log.sector_size;
+    PR_DEBUG("kv log compact sector %d into %d", victim, target);
+
+    buf = tal_malloc(s_kv_log.sector_size);
+    if (NULL == buf) {
+        return OPRT_MALLOC_FAILED;
+    }
+    rt = __log_sector_open(target);
+    if (OPRT_OK != rt) {
+        tal_free(buf);
+        return rt;
+    }
+    for (i = 0; i < TAL_KV_LOG_BUCKETS && OPRT_OK == rt; i++) {
+        link = &s_kv_log.bucket[i];
+        while (*link && OPRT_OK == rt) {
+            kv_log_node_t *node = *link;
+            uint32_t key_len = strlen(node->key);
+
+            if (node->addr < start || node->addr >= end) {
+                link = &node->next;
+                continue;
+            }
+            // no older sector is left which the tombstone has to hide
+            if (node->deleted) {
+                __log_node_drop(link);
+                continue;
+            }
+            rt = __log_flash_read(node->addr + sizeof(kv_log_rec_head_t) + key_len, buf, node->len);
+            if (OPRT_OK == rt) {
+                rt = __log_append(KV_LOG_OP_SET, node->key, buf, node->len, &addr);
+            }
+            if (OPRT_OK == rt) {
+                node->addr = addr;
+            }
+            link = &node->next;
+        }
+    }
+    tal_free(buf);
+    if (OPRT_OK == rt) {
+        rt = __log_sector_release(victim);
+    }
+    if (OPRT_OK != rt) {
+        // the index may point into the copy, drop it and read the log again
+        PR_ERR("kv log compact err %d", rt);
+        __log_sector_release(target);
+        __log_load();
+    }
+
+    return rt;
+}
+
+/* makes room for a record in the active sector, one sector always stays free.
+ * replaced is the size of the record it supersedes. */
+static int __log_reserve(uint32_t size, uint32_t replaced)
+{
+    uint32_t round;
+    int rt;
+
+    if (size > s_kv_log.sector_size - sizeof(kv_log_sector_head_t)) {
+        PR_ERR("kv log record %d larger than a sector", size);
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+    if (s_kv_log.live_bytes - replaced + size >
+        (s_kv_log.sector_num - 1) * (s_kv_log.sector_size - sizeof(kv_log_sector_head_t))) {
+        PR_ERR("kv log full");
+        return OPRT_KVS_WR_FAIL;
+    }
+
+    for (round = 0; KV_LOG_NONE == s_kv_log.active || s_kv_log.offset + size > s_kv_log.sector_size; round++) {
+        if (round > s_kv_log.sector_num) {
+            PR_ERR("kv log full");
+            return OPRT_KVS_WR_FAIL;
+        }
+        if (__log_free_num() >= 2) {
+            rt = __log_sector_open(__log_free_next());
+        } else {
+            rt = __log_compact();
+        }
+        if (OPRT_OK != rt) {
+            return rt;
+        }
+    }
+
+    return OPRT_OK;
+}
+
+static int __kv_log_write(const char *key, const uint8_t *data, size_t len)
+{
+    uint32_t key_len = strlen(key);
+    kv_log_node_t *node = NULL;
+    uint32_t addr;
+    int rt;
+
+    if (0 == key_len || key_len > KV_LOG_KEY_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+    node = *__log_node_link(key);
+    rt = __log_reserve(KV_LOG_REC_SIZE(key_len, len), node ? KV_LOG_REC_SIZE(key_len, node->len) : 0);
+    if (OPRT_OK == rt) {
+        rt = __log_append(KV_LOG_OP_SET, key, data, len, &addr);
+    }
+    if (OPRT_OK == rt) {
+        rt = __log_node_set(key, addr, len, FALSE);
+    }
+
+    return rt;
+}
+
+static int __kv_log_read(const char *key, uint8_t **data, size_t *len)
+{
+    kv_log_node_t *node = *__log_node_link(key);
+    uint8_t *buf = NULL;
+
+    if (NULL == node || node->deleted) {
+        return OPRT_NOT_FOUND;
+    }
+    buf = tal_malloc(node->len + 1);
+    if (NULL == buf) {
+        return OPRT_MALLOC_FAILED;
+    }
+    if (OPRT_OK != __log_flash_read(node->addr + sizeof(kv_log_rec_head_t) + strlen(key), buf, node->len)) {
+        tal_free(buf);
+        PR_ERR("kv log read %s err", key);
+        return OPRT_KVS_RD_FAIL;
+    }
+    *data = buf;
+    *len = node->len;
+
+    return OPRT_OK;
+}
+
+static int __kv_log_remove(const char *key)
+{
+    kv_log_node_t *node = *__log_node_link(key);
+    uint32_t addr;
+    int rt;
+
+    if (NULL == node || node->deleted) {
+        return OPRT_NOT_FOUND;
+    }
+    rt = __log_reserve(KV_LOG_REC_SIZE(strlen(key), 0), KV_LOG_REC_SIZE(strlen(key), node->len));
+    if (OPRT_OK == rt) {
+        rt = __log_append(KV_LOG_OP_DEL, key, NULL, 0, &addr);
+    }
+    if (OPRT_OK == rt) {
+        rt = __log_node_set(key, addr, 0, TRUE);
+    }
+
+    return rt;
+}
+
+/* rebuilds the index from the records of one sector, stops at the first invalid one */
+static void __log_sector_scan(uint32_t sector, uint8_t *buf)
+{
+    char key[KV_LOG_KEY_MAX + 1];
+    kv_log_rec_head_t head;
+    uint32_t offset = sizeof(kv_log_sector_head_t);
+    uint32_t addr, size;
+
+    while (offset + sizeof(head) <= s_kv_log.sector_size) {
+        addr = __log_sector_addr(sector) + offset;
+        if (OPRT_OK != __log_flash_read(addr, &head, sizeof(head)) || KV_LOG_REC_MAGIC != head.magic ||
+            s_kv_log.sector_seq[sector] != head.seq || 0 == head.key_len || head.op > KV_LOG_OP_DEL) {
+            break;
+        }
+        size = KV_LOG_REC_SIZE(head.key_len, head.len);
+        if (head.len > s_kv_log.sector_size || offset + size > s_kv_log.sector_size) {
+            break;
+        }
+        if (OPRT_OK != __log_flash_read(addr + sizeof(head), buf, head.key_len + head.len) ||
+            head.crc != __log_rec_crc(&head, buf, head.key_len + head.len)) {
+            break;
+        }
+        memcpy(key, buf, head.key_len);
+        key[head.key_len] = '\0';
+        if (OPRT_OK != __log_node_set(key, addr, head.len, KV_LOG_OP_DEL == head.op)) {
+            break;
+        }
+        offset += size;
+    }
+}
+
+/* reads the sector heads and rebuilds the index, appending starts in a fresh sector */
+static int __log_load(void)
+{
+    kv_log_sector_head_t head;
+    uint32_t i, sector = 0, last;
+    kv_log_node_t *node;
+    uint8_t *buf = tal_malloc(s_kv_log.sector_size);
+
+    if (NULL == buf) {
+        return OPRT_MALLOC_FAILED;
+    }
+    for (i = 0; i < TAL_KV_LOG_BUCKETS; i++) {
+        while (NULL != (node = s_kv_log.bucket[i])) {
+            s_kv_log.bucket[i] = node->next;
+            tal_free(node);
+        }
+    }
+    s_kv_log.live_bytes = 0;
+    s_kv_log.active = KV_LOG_NONE;
+
+    for (i = 0; i < s_kv_log.sector_num; i++) {
+        s_kv_log.sector_seq[i] = 0;
+        if (OPRT_OK == __log_flash_read(__log_sector_addr(i), &head, sizeof(head)) &&
+            KV_LOG_SECTOR_MAGIC == head.magic && head.seq && head.crc == __log_sector_crc(&head)) {
+            s_kv_log.sector_seq[i] = head.seq;
+            if (head.seq > s_kv_log.seq) {
+                s_kv_log.seq = head.seq;
+            }
+        }
+    }
+
+    // no free sector: a compaction was cut off, its copies in the newest sector are dropped
+    if (0 == __log_free_num()) {
+        for (i = 0; i < s_kv_log.sector_num; i++) {
+            if (s_kv_log.sector_seq[i] == s_kv_log.seq) {
+                __log_sector_release(i);
+            }
+        }
+    }
+
+    // oldest first, a later record of a key replaces the earlier one
+    for (last = 0;; last = s_kv_log.sector_seq[sector]) {
+        sector = KV_LOG_NONE;
+        for (i = 0; i < s_kv_log.sector_num; i++) {
+            if (s_kv_log.sector_seq[i] > last &&
+                (KV_LOG_NONE == sector || s_kv_log.sector_seq[i] < s_kv_log.sector_seq[sector])) {
+                sector = i;
+            }
+        }
+        if (KV_LOG_NONE == sector) {
+            break;
+        }
+        __log_sector_scan(sector, buf);
+    }
+    tal_free(buf);
+
+    return OPRT_OK;
+}
+
+static const tal_kv_backend_t s_kv_log_backend = {
+    .name = "log",
+    .write = __kv_log_write,
+    .read = __kv_log_read,
+    .remove = __kv_log_remove,
+};
+
+/**
+ * @brief Mount the log on the TUYA_FLASH_TYPE_KV_DATA partition
+ *
+ * @return backend, NULL on error
+ */
+const tal_kv_backend_t *tal_kv_log_backend_init(void)
+{
+    TUYA_FLASH_BASE_INFO_T info;
+
+    if (s_kv_log.sector_seq) {
+        return &s_kv_log_backend;
+    }
+    if (OPRT_OK != tkl_flash_get_one_type_info(TUYA_FLASH_TYPE_KV_DATA, &info) ||
+        info.partition[0].size / info.partition[0].block_size < 2) {
+        PR_ERR("kv log needs 2 sectors");
+        return NULL;
+    }
+    memset(&s_kv_log, 0, sizeof(s_kv_log));
+    s_kv_log.base = info.partition[0].start_addr;
+    s_kv_log.sector_size = info.partition[0].block_size;
+    s_kv_log.sector_num = info.partition[0].size / info.partition[0].block_size;
+    s_kv_log.active = KV_LOG_NONE;
+    s_kv_log.sector_seq = tal_malloc(s_kv_log.sector_num * sizeof(uint32_t));
+    if (NULL == s_kv_log.sector_seq || OPRT_OK != __log_load()) {
+        tal_free(s_kv_log.sector_seq);
+        s_kv_log.sector_seq = NULL;
+        return NULL;
+    }
+
+    // the tail of the last sector may hold a record cut off by a power loss,
+    // appending starts in a fresh sector
+    PR_DEBUG("kv log %d sectors, seq %d, live %d", s_kv_log.sector_num, s_kv_log.seq, s_kv_log.live_bytes);
+
+    return &s_kv_log_backend;
+}
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * @file tal_net_poll.h
+ * @brief Readiness based socket event loop backend for Tuya SDK.
+ *
+ * A poll set watches registered sockets and reports only the ready ones, so
+ * the caller dispatches in O(active) instead of scanning every socket after
+ * select. On linux with the posix network card it is backed by epoll (poll if
+ * epoll is not available) and has an eventfd to wake up the waiting thread.
+ * Other systems fall back to tal_net_select over the registered sockets.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#ifndef __TAL_NET_POLL_H__
+#define __TAL_NET_POLL_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+/* readable, also set at eof or on a pending socket error, the same as the select read set */
+#define TAL_NET_POLL_IN  (1 << 0)
+/* exceptional condition, the same as the select error set */
+#define TAL_NET_POLL_ERR (1 << 1)
+/* writable, the same as the select write set */
+#define TAL_NET_POLL_OUT (1 << 2)
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef uint8_t TAL_NET_POLL_TYPE_E;
+#define TAL_NET_POLL_AUTO   (0)
+#define TAL_NET_POLL_EPOLL  (1)
+#define TAL_NET_POLL_POLL   (2)
+#define TAL_NET_POLL_SELECT (3)
+
+typedef void *TAL_NET_POLL_HANDLE;
+
+typedef struct {
+    int fd;
+    uint32_t events; // TAL_NET_POLL_IN / TAL_NET_POLL_ERR / TAL_NET_POLL_OUT
+    void *arg;       // arg given to tal_net_poll_add
+} TAL_NET_POLL_EVENT_T;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+
+/**
+ * @brief Create a poll set
+ *
+ * @param[in] type: backend, TAL_NET_POLL_AUTO picks the best one available
+ * @param[in] max_fds: max count of sockets watched at the same time
+ * @param[out] handle: poll set handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_poll_create(TAL_NET_POLL_TYPE_E type, uint32_t max_fds, TAL_NET_POLL_HANDLE *handle);
+
+/**
+ * @brief Destroy a poll set, the registered sockets are not closed
+ *
+ * @param[in] handle: poll set handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_poll_destroy(TAL_NET_POLL_HANDLE handle);
+
+/**
+ * @brief Watch a socket, or change the events and arg of a watched one
+ *
+ * @param[in] handle: poll set handle
+ * @param[in] fd: socket
+ * @param[in] events: TAL_NET_POLL_IN / TAL_NET_POLL_ERR / TAL_NET_POLL_OUT
+ * @param[in] arg: reported with the events of the socket
+ *
+ * @note Call it on the thread that waits, remove the socket before closing it.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_poll_add(TAL_NET_POLL_HANDLE handle, int fd, uint32_t events, void *arg);
+
+/**
+ * @brief Stop watching a socket
+ *
+ * @param[in] handle: poll set handle
+ * @param[in] fd: socket
+ *
+ * @note Call it on the thread that waits.
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND if the socket is not watched.
+ */
+OPERATE_RET tal_net_poll_del(TAL_NET_POLL_HANDLE handle, int fd);
+
+/**
+ * @brief Wait for ready sockets
+ *
+ * @param[in] handle: poll set handle
+ * @param[out] events: ready sockets
+ * @param[in] max_events: size of events
+ * @param[in] ms_timeout: time out
+ *
+ * @return >0 the count of ready sockets, 0 on time out or wake up, <0 error.
+ */
+int tal_net_poll_wait(TAL_NET_POLL_HANDLE handle, TAL_NET_POLL_EVENT_T *events, int max_events, uint32_t ms_timeout);
+
+/**
+ * @brief Make a pending or the next tal_net_poll_wait return at once
+ *
+ * @param[in] handle: poll set handle
+ *
+ * @note It can be called from any thread. The select backend has no wake up
+ * socket, it notices the request within TAL_NET_POLL_SELECT_SLICE_MS.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_poll_wakeup(TAL_NET_POLL_HANDLE handle);
+
+/**
+ * @brief Get the backend name of a poll set, such as "epoll"
+ *
+ * @param[in] handle: poll set handle
+ *
+ * @return backend name
+ */
+const char *tal_net_poll_get_name(TAL_NET_POLL_HANDLE handle);
+
+/**
+ * @brief Benchmark wait and dispatch of every backend with udp sessions on loopback
+ *
+ * @param[in] sessions: sockets watched, such as 1/16/64
+ * @param[in] rounds: datagrams sent to a random session
+ *
+ * @note Available when ENABLE_NET_POLL_BENCHMARK is defined, the sessions are
+ * bound to 127.0.0.1 from TAL_NET_POLL_BENCH_PORT on.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_poll_benchmark(uint32_t sessions, uint32_t rounds);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TAL_NET_POLL_H__ */
@@ -0,0 +1,831 @@
+/**
+ * @file tal_net_poll.c
+ * @brief Readiness based socket event loop backend for Tuya SDK.
+ *
+ * The poll set keeps the registered sockets in a slot table. The epoll
+ * backend stores the slot index in the kernel event so a ready socket is
+ * found in O(1), the poll backend keeps a pollfd array in step with the slot
+ * table, and the select backend rebuilds the fd sets from the slot table on
+ * every wait. The kernel backends are only used on linux with the posix
+ * network card, the sockets of other cards are not kernel descriptors.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#include "tuya_iot_config.h"
+#include "tal_api.h"
+#include "tal_network_register.h"
+#include "tal_net_poll.h"
+
+#if 100 == OPERATING_SYSTEM
+#define NET_POLL_USING_KERNEL 1
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#ifndef TAL_NET_POLL_SELECT_SLICE_MS
+#define TAL_NET_POLL_SELECT_SLICE_MS (100)
+#endif
+
+#ifndef TAL_NET_POLL_BENCH_PORT
+#define TAL_NET_POLL_BENCH_PORT (46000)
+#endif
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    int fd; // -1 if the slot is free
+    uint32_t events;
+    void *arg;
+} NET_POLL_SLOT_T;
+
+typedef struct NET_POLL NET_POLL_T;
+
+typedef struct {
+    const char *name;
+    OPERATE_RET (*open)(NET_POLL_T *ps);
+    void (*close)(NET_POLL_T *ps);
+    OPERATE_RET (*add)(NET_POLL_T *ps, uint32_t slot, BOOL_T update);
+    void (*del)(NET_POLL_T *ps, uint32_t slot);
+    int (*wait)(NET_POLL_T *ps, TAL_NET_POLL_EVENT_T *events, int max_events, uint32_t ms_timeout);
+    void (*wakeup)(NET_POLL_T *ps);
+} NET_POLL_OPS_T;
+
+struct NET_POLL {
+    const NET_POLL_OPS_T *ops;
+    uint32_t max;
+    NET_POLL_SLOT_T *slot;
+    volatile BOOL_T woken; // select only, the kernel backends wake up through the eventfd
+    int max_fd;         // select only
+    TUYA_FD_SET_T *rfds;
+    TUYA_FD_SET_T *wfds;
+    TUYA_FD_SET_T *efds;
+#if defined(NET_POLL_USING_KERNEL)
+    int wake_fd;
+    int epfd;
+    struct epoll_event *ev;
+    struct pollfd *pfd; // one per slot, the wake up eventfd last
+#endif
+};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+static void __slot_event(NET_POLL_T *ps, uint32_t slot, uint32_t events, TAL_NET_POLL_EVENT_T *event)
+{
+    event->fd = ps->slot[slot].fd;
+    event->events = events & ps->slot[slot].events;
+    event->arg = ps->slot[slot].arg;
+}
+
+/* select backend, O(registered) per wait but it works with every network card */
+static OPERATE_RET __select_open(NET_POLL_T *ps)
+{
+    ps->rfds = tal_malloc(sizeof(TUYA_FD_SET_T));
+    ps->wfds = tal_malloc(sizeof(TUYA_FD_SET_T));
+    ps->efds = tal_malloc(sizeof(TUYA_FD_SET_T));
+    if (NULL == ps->rfds || NULL == ps->wfds || NULL == ps->efds) {
+        return OPRT_MALLOC_FAILED;
+    }
+
+    return OPRT_OK;
+}
+
+static void __select_close(NET_POLL_T *ps)
+{
+    if (ps->rfds) {
+        tal_free(ps->rfds);
+        ps->rfds = NULL;
+    }
+    if (ps->wfds) {
+        tal_free(ps->wfds);
+        ps->wfds = NULL;
+    }
+    if (ps->efds) {
+        tal_free(ps->efds);
+        ps->efds = NULL;
+    }
+}
+
+static OPERATE_RET __select_add(NET_POLL_T *ps, uint32_t slot, BOOL_T update)
+{
+    if (ps->slot[slot].fd >= TUYA_FD_MAX_COUNT) {
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+    if (ps->slot[slot].fd > ps->max_fd) {
+        ps->max_fd = ps->slot[slot].fd;
+    }
+
+    return OPRT_OK;
+}
+
+static void __select_del(NET_POLL_T *ps, uint32_t slot)
+{
+    return;
+}
+
+static int __select_wait(NET_POLL_T *ps, TAL_NET_POLL_EVENT_T *events, int max_events, uint32_t ms_timeout)
+{
+    SYS_TIME_T start = tal_system_get_millisecond();
+    uint32_t idx = 0, elapsed = 0, slice = 0, num = 0;
+    uint32_t ready = 0;
+    int ret = 0, cnt = 0;
+
+    // there is no socket to wake the select up, look at the wake up flag between slices
+    do {
+        if (ps->woken) {
+            ps->woken = FALSE;
+            return 0;
+        }
+
+        slice = ms_timeout - elapsed;
+        slice = (slice > TAL_NET_POLL_SELECT_SLICE_MS) ? TAL_NET_POLL_SELECT_SLICE_MS : slice;
+
+        tal_net_fd_zero(ps->rfds);
+        tal_net_fd_zero(ps->wfds);
+        tal_net_fd_zero(ps->efds);
+        for (idx = 0, num = 0; idx < ps->max; idx++) {
+            if (ps->slot[idx].fd < 0) {
+                continue;
+            }
+            if (ps->slot[idx].events & TAL_NET_POLL_IN) {
+                tal_net_fd_set(ps->slot[idx].fd, ps->rfds);
+            }
+            if (ps->slot[idx].events & TAL_NET_POLL_OUT) {
+                tal_net_fd_set(ps->slot[idx].fd, ps->wfds);
+            }
+            if (ps->slot[idx].events & TAL_NET_POLL_ERR) {
+                tal_net_fd_set(ps->slot[idx].fd, ps->efds);
+            }
+            num++;
+        }
+
+        if (0 == num) {
+            tal_system_sleep(slice ? slice : 1);
+        } else {
+            ret = tal_net_select(ps->max_fd + 1, ps->rfds, ps->wfds, ps->efds, slice);
+            if (ret < 0) {
+                return ret;
+            }
+            if (ret > 0) {
+                for (idx = 0; idx < ps->max && cnt < max_events; idx++) {
+                    if (ps->slot[idx].fd < 0) {
+                        continue;
+                    }
+                    ready = 0;
+                    if (tal_net_fd_isset(ps->slot[idx].fd, ps->rfds)) {
+                        ready |= TAL_NET_POLL_IN;
+                    }
+                    if (tal_net_fd_isset(ps->slot[idx].fd, ps->wfds)) {
+                        ready |= TAL_NET_POLL_OUT;
+                    }
+                    if (tal_net_fd_isset(ps->slot[idx].fd, ps->efds)) {
+                        ready |= TAL_NET_POLL_ERR;
+                    }
+                    if (ready) {
+                        __slot_event(ps, idx, ready, &events[cnt++]);
+                    }
+                }
+                return cnt;
+            }
+        }
+        elapsed = (uint32_t)(tal_system_get_millisecond() - start);
+    } while (elapsed < ms_timeout);
+
+    return 0;
+}
+
+static void __select_wakeup(NET_POLL_T *ps)
+{
+    ps->woken = TRUE;
+}
+
+static const NET_POLL_OPS_T s_net_poll_select = {
+    .name = "select",
+    .open = __select_open,
+    .close = __select_close,
+    .add = __select_add,
+    .del = __select_del,
+    .wait = __select_wait,
+    .wakeup = __select_wakeup,
+};
+
+#if defined(NET_POLL_USING_KERNEL)
+static void __wake_fd_drain(NET_POLL_T *ps)
+{
+    uint64_t cnt = 0;
+
+    while (read(ps->wake_fd, &cnt, sizeof(cnt)) > 0) {
+        ;
+    }
+}
+
+static void __wake_fd_wakeup(NET_POLL_T *ps)
+{
+    uint64_t one = 1;
+
+    if (write(ps->wake_fd, &one, sizeof(one)) < 0) {
+        // the counter is already non zero, the waiter wakes up anyway
+    }
+}
+
+static uint32_t __epoll_events(uint32_t events)
+{
+    return ((events & TAL_NET_POLL_IN) ? EPOLLIN : 0) | ((events & TAL_NET_POLL_ERR) ? EPOLLPRI : 0) |
+           ((events & TAL_NET_POLL_OUT) ? EPOLLOUT : 0);
+}
+
+/* epoll backend, the slot index rides in the kernel event */
+static OPERATE_RET __epoll_open(NET_POLL_T *ps)
+{
+    struct epoll_event ev = {0};
+
+    ps->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (ps->epfd < 0) {
+        return OPRT_COM_ERROR;
+    }
+    ps->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ps->wake_fd < 0) {
+        return OPRT_COM_ERROR;
+    }
+    ps->ev = tal_malloc((ps->max + 1) * sizeof(struct epoll_event));
+    if (NULL == ps->ev) {
+        return OPRT_MALLOC_FAILED;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.u32 = ps->max;
+    if (epoll_ctl(ps->epfd, EPOLL_CTL_ADD, ps->wake_fd, &ev) < 0) {
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+static void __epoll_close(NET_POLL_T *ps)
+{
+    if (ps->epfd >= 0) {
+        close(ps->epfd);
+        ps->epfd = -1;
+    }
+    if (ps->wake_fd >= 0) {
+        close(ps->wake_fd);
+        ps->wake_fd = -1;
+    }
+    if (ps->ev) {
+        tal_free(ps->ev);
+        ps->ev = NULL;
+    }
+}
+
+static OPERATE_RET __epoll_add(NET_POLL_T *ps, uint32_t slot, BOOL_T update)
+{
+    struct epoll_event ev = {0};
+    int ret = 0;
+
+    ev.events = __epoll_events(ps->slot[slot].events);
+    ev.data.u32 = slot;
+    ret = epoll_ctl(ps->epfd, update ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, ps->slot[slot].fd, &ev);
+    if (ret < 0 && !update && EEXIST == errno) {
+        // closed without being removed and the number was handed out again
+        ret = epoll_ctl(ps->epfd, EPOLL_CTL_MOD, ps->slot[slot].fd, &ev);
+    }
+
+    return (ret < 0) ? OPRT_COM_ERROR : OPRT_OK;
+}
+
+static void __epoll_del(NET_POLL_T *ps, uint32_t slot)
+{
+    struct epoll_event ev = {0};
+
+    // fails if the socket is already closed, the kernel dropped it then
+    epoll_ctl(ps->epfd, EPOLL_CTL_DEL, ps->slot[slot].fd, &ev);
+}
+
+static int __epoll_wait(NET_POLL_T *ps, TAL_NET_POLL_EVENT_T *events, int max_events, uint32_t ms_timeout)
+{
+    int ret = 0, idx = 0, cnt = 0;
+    uint32_t ready = 0, slot = 0;
+
+    if (max_events > (int)ps->max + 1) {
+        max_events = ps->max + 1;
+    }
+
+    ret = epoll_wait(ps->epfd, ps->ev, max_events, (int)ms_timeout);
+    if (ret < 0) {
+        return (EINTR == errno) ? 0 : ret;
+    }
+
+    for (idx = 0; idx < ret; idx++) {
+        slot = ps->ev[idx].data.u32;
+        if (slot == ps->max) {
+            __wake_fd_drain(ps);
+            continue;
+        }
+        if (slot > ps->max || ps->slot[slot].fd < 0) {
+            continue;
+        }
+
+        // eof and socket errors are readable (errors also writable) for select, keep it that way
+        ready = 0;
+        if (ps->ev[idx].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+            ready |= TAL_NET_POLL_IN;
+        }
+        if (ps->ev[idx].events & EPOLLPRI) {
+            ready |= TAL_NET_POLL_ERR;
+        }
+        if (ps->ev[idx].events & (EPOLLOUT | EPOLLERR)) {
+            ready |= TAL_NET_POLL_OUT;
+        }
+        __slot_event(ps, slot, ready, &events[cnt]);
+        if (events[cnt].events) {
+            cnt++;
+        }
+    }
+
+    return cnt;
+}
+
+static const NET_POLL_OPS_T s_net_poll_epoll = {
+    .name = "epoll",
+    .open = __epoll_open,
+    .close = __epoll_close,
+    .add = __epoll_add,
+    .del = __epoll_del,
+    .wait = __epoll_wait,
+    .wakeup = __wake_fd_wakeup,
+};
+
+/* poll backend, the pollfd array follows the slot table and skips free slots */
+static OPERATE_RET __poll_open(NET_POLL_T *ps)
+{
+    uint32_t idx = 0;
+
+    ps->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ps->wake_fd < 0) {
+        return OPRT_COM_ERROR;
+    }
+    ps->pfd = tal_malloc((ps->max + 1) * sizeof(struct pollfd));
+    if (NULL == ps->pfd) {
+        return OPRT_MALLOC_FAILED;
+    }
+    for (idx = 0; idx < ps->max; idx++) {
+        ps->pfd[idx].fd = -1;
+        ps->pfd[idx].events = 0;
+    }
+    ps->pfd[ps->max].fd = ps->wake_fd;
+    ps->pfd[ps->max].events = POLLIN;
+
+    return OPRT_OK;
+}
+
+static void __poll_close(NET_POLL_T *ps)
+{
+    if (ps->wake_fd >= 0) {
+        close(ps->wake_fd);
+        ps->wake_fd = -1;
+    }
+    if (ps->pfd) {
+        tal_free(ps->pfd);
+        ps->pfd = NULL;
+    }
+}
+
+static OPERATE_RET __poll_add(NET_POLL_T *ps, uint32_t slot, BOOL_T update)
+{
+    ps->pfd[slot].fd = ps->slot[slot].fd;
+    ps->pfd[slot].events = ((ps->slot[slot].events & TAL_NET_POLL_IN) ? POLLIN : 0) |
+                             ((ps->slot[slot].events & TAL_NET_POLL_ERR) ? POLLPRI : 0) |
+                             ((ps->slot[slot].events & TAL_NET_POLL_OUT) ? POLLOUT : 0);
+    ps->pfd[slot].revents = 0;
+
+    return OPRT_OK;
+}
+
+static void __poll_del(NET_POLL_T *ps, uint32_t slot)
+{
+    ps->pfd[slot].fd = -1;
+}
+
+static int __poll_wait(NET_POLL_T *ps, TAL_NET_POLL_EVENT_T *events, int max_events, uint32_t ms_timeout)
+{
+    int ret = 0, cnt = 0;
+    uint32_t idx = 0, ready = 0;
+
+    ret = poll(ps->pfd, ps->max + 1, (int)ms_timeout);
+    if (ret <= 0) {
+        return (ret < 0 && EINTR == errno) ? 0 : ret;
+    }
+
+    if (ps->pfd[ps->max].revents) {
+        __wake_fd_drain(ps);
+        ret--;
+    }
+
+    for (idx = 0; idx < ps->max && ret > 0 && cnt < max_events; idx++) {
+        if (ps->pfd[idx].fd < 0 || 0 == ps->pfd[idx].revents) {
+            continue;
+        }
+        ret--;
+        ready = 0;
+        if (ps->pfd[idx].revents & (POLLIN | POLLHUP | POLLERR)) {
+            ready |= TAL_NET_POLL_IN;
+        }
+        if (ps->pfd[idx].revents & POLLPRI) {
+            ready |= TAL_NET_POLL_ERR;
+        }
+        if (ps->pfd[idx].revents & (POLLOUT | POLLERR)) {
+            ready |= TAL_NET_POLL_OUT;
+        }
+        __slot_event(ps, idx, ready, &events[cnt]);
+        if (events[cnt].events) {
+            cnt++;
+        }
+    }
+
+    return cnt;
+}
+
+static const NET_POLL_OPS_T s_net_poll_poll = {
+    .name = "poll",
+    .open = __poll_open,
+    .close = __poll_close,
+    .add = __poll_add,
+    .del = __poll_del,
+    .wait = __poll_wait,
+    .wakeup = __wake_fd_wakeup,
+};
+#endif
+
+static const NET_POLL_OPS_T *__net_poll_get_ops(TAL_NET_POLL_TYPE_E type)
+{
+    switch (type) {
+    case TAL_NET_POLL_SELECT:
+        return &s_net_poll_select;
+#if defined(NET_POLL_USING_KERNEL)
+    case TAL_NET_POLL_EPOLL:
+        return (TAL_NET_TYPE_POSIX == tal_network_card_get_active_type()) ? &s_net_poll_epoll : NULL;
+    case TAL_NET_POLL_POLL:
+        return (TAL_NET_TYPE_POSIX == tal_network_card_get_active_type()) ? &s_net_poll_poll : NULL;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+static OPERATE_RET __net_poll_open(NET_POLL_T *ps, TAL_NET_POLL_TYPE_E type)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    ps->ops = __net_poll_get_ops(type);
+    if (NULL == ps->ops) {
+        return OPRT_NOT_SUPPORTED;
+    }
+
+#if defined(NET_POLL_USING_KERNEL)
+    ps->wake_fd = -1;
+    ps->epfd = -1;
+#endif
+    rt = ps->ops->open(ps);
+    if (OPRT_OK != rt) {
+        ps->ops->close(ps);
+        ps->ops = NULL;
+    }
+
+    return rt;
+}
+
+/**
+ * @brief Create a poll set
+ *
+ * @param[in] type: backend, TAL_NET_POLL_AUTO picks the best one available
+ * @param[in] max_fds: max count of sockets watched at the same time
+ * @param[out] handle: poll set handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_poll_create(TAL_NET_POLL_TYPE_E type, uint32_t max_fds, TAL_NET_POLL_HANDLE *handle)
+{
+    OPERATE_RET rt = OPRT_OK;
+    NET_POLL_T *ps = NULL;
+    uint32_t idx = 0;
+
+    if (0 == max_fds || NULL == handle) {
+        return OPRT_INVALID_PARM;
+    }
+
+    ps = tal_malloc(sizeof(NET_POLL_T) + max_fds * sizeof(NET_POLL_SLOT_T));
+    if (NULL == ps) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memset(ps, 0, sizeof(NET_POLL_T));
+    ps->max = max_fds;
+    ps->max_fd = -1;
+    ps->slot = (NET_POLL_SLOT_T *)(ps + 1);
+    for (idx = 0; idx < max_fds; idx++) {
+        ps->slot[idx].fd = -1;
+    }
+
+    if (TAL_NET_POLL_AUTO == type) {
+        rt = __net_poll_open(ps, TAL_NET_POLL_EPOLL);
+        if (OPRT_OK != rt) {
+            rt = __net_poll_open(ps, TAL_NET_POLL_POLL);
+        }
+        if (OPRT_OK != rt) {
+            rt = __net_poll_open(ps, TAL_NET_POLL_SELECT);
+        }
+    } else {
+        rt = __net_poll_open(ps, type);
+    }
+    if (OPRT_OK != rt) {
+        PR_ERR("net poll create err:%d", rt);
+        tal_free(ps);
+        return rt;
+    }
+
+    PR_DEBUG("net poll %s, max fds:%d", ps->ops->name, max_fds);
+    *handle = (TAL_NET_POLL_HANDLE)ps;
+    return OPRT_OK;
+}
+
+/**
+ * @brief Destroy a poll set, the registered sockets are not closed
+ *
+ * @param[in] handle: poll set handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_poll_destroy(TAL_NET_POLL_HANDLE handle)
+{
+    NET_POLL_T *ps = (NET_POLL_T *)handle;
+
+    if (NULL == ps) {
+        return OPRT_INVALID_PARM;
+    }
+
+    ps->ops->close(ps);
+    tal_free(ps);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Watch a socket, or change the events and arg of a watched one
+ *
+ * @param[in] handle: poll set handle
+ * @param[in] fd: socket
+ * @param[in] events: TAL_NET_POLL_IN / TAL_NET_POLL_ERR / TAL_NET_POLL_OUT
+ * @param[in] arg: reported with the events of the socket
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_poll_add(TAL_NET_POLL_HANDLE handle, int fd, uint32_t events, void *arg)
+{
+    NET_POLL_T *ps = (NET_POLL_T *)handle;
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t idx = 0, free_idx = 0;
+
+    if (NULL == ps || fd < 0) {
+        return OPRT_INVALID_PARM;
+    }
+
+    free_idx = ps->max;
+    for (idx = 0; idx < ps->max; idx++) {
+        if (ps->slot[idx].fd == fd) {
+            break;
+        }
+        if (ps->slot[idx].fd < 0 && free_idx == ps->max) {
+            free_idx = idx;
+        }
+    }
+
+    if (idx < ps->max) {
+        ps->slot[idx].events = events;
+        ps->slot[idx].arg = arg;
+        return ps->ops->add(ps, idx, TRUE);
+    }
+
+    if (free_idx == ps->max) {
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+    ps->slot[free_idx].fd = fd;
+    ps->slot[free_idx].events = events;
+    ps->slot[free_idx].arg = arg;
+    rt = ps->ops->add(ps, free_idx, FALSE);
+    if (OPRT_OK != rt) {
+        ps->slot[free_idx].fd = -1;
+    }
+
+    return rt;
+}
+
+/**
+ * @brief Stop watching a socket
+ *
+ * @param[in] handle: poll set handle
+ * @param[in] fd: socket
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND if the socket is not watched.
+ */
+OPERATE_RET tal_net_poll_del(TAL_NET_POLL_HANDLE handle, int fd)
+{
+    NET_POLL_T *ps = (NET_POLL_T *)handle;
+    uint32_t idx = 0;
+
+    if (NULL == ps || fd < 0) {
+        return OPRT_INVALID_PARM;
+    }
+
+    for (idx = 0; idx < ps->max; idx++) {
+        if (ps->slot[idx].fd == fd) {
+            ps->ops->del(ps, idx);
+            ps->slot[idx].fd = -1;
+            ps->slot[idx].arg = NULL;
+            return OPRT_OK;
+        }
+    }
+
+    return OPRT_NOT_FOUND;
+}
+
+/**
+ * @brief Wait for ready sockets
+ *
+ * @param[in] handle: poll set handle
+ * @param[out] events: ready sockets
+ * @param[in] max_events: size of events
+ * @param[in] ms_timeout: time out
+ *
+ * @return >0 the count of ready sockets, 0 on time out or wake up, <0 error.
+ */
+int tal_net_poll_wait(TAL_NET_POLL_HANDLE handle, TAL_NET_POLL_EVENT_T *events, int max_events, uint32_t ms_timeout)
+{
+    NET_POLL_T *ps = (NET_POLL_T *)handle;
+
+    if (NULL == ps || NULL == events || max_events <= 0) {
+        return OPRT_INVALID_PARM;
+    }
+
+    return ps->ops->wait(ps, events, max_events, ms_timeout);
+}
+
+/**
+ * @brief Make a pending or the next tal_net_poll_wait return at once
+ *
+ * @param[in] handle: poll set handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_poll_wakeup(TAL_NET_POLL_HANDLE handle)
+{
+    NET_POLL_T *ps = (NET_POLL_T *)handle;
+
+    if (NULL == ps) {
+        return OPRT_INVALID_PARM;
+    }
+
+    ps->ops->wakeup(ps);
+    return OPRT_OK;
+}
+
+/**
+ * @brief Get the backend name of a poll set, such as "epoll"
+ *
+ * @param[in] handle: poll set handle
+ *
+ * @return backend name
+ */
+const char *tal_net_poll_get_name(TAL_NET_POLL_HANDLE handle)
+{
+    NET_POLL_T *ps = (NET_POLL_T *)handle;
+
+    return ps ? ps->ops->name : "none";
+}
+
+#if defined(ENABLE_NET_POLL_BENCHMARK)
+static OPERATE_RET __net_poll_bench_one(TAL_NET_POLL_TYPE_E type, int *fds, uint32_t sessions, int sender,
+                                        uint32_t rounds)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TAL_NET_POLL_HANDLE handle = NULL;
+    TAL_NET_POLL_EVENT_T events[4];
+    SYS_TIME_T t0 = 0, cost = 0;
+    uint32_t idx = 0, r = 0, miss = 0, val = 0;
+    int cnt = 0;
+
+    rt = tal_net_poll_create(type, sessions, &handle);
+    if (OPRT_OK != rt) {
+        return rt;
+    }
+    for (idx = 0; idx < sessions; idx++) {
+        rt = tal_net_poll_add(handle, fds[idx], TAL_NET_POLL_IN | TAL_NET_POLL_ERR, (void *)(uintptr_t)idx);
+        if (OPRT_OK != rt) {
+            goto __EXIT;
+        }
+    }
+
+    // one session at a time is active, like a lan client sending a frame
+    t0 = tal_system_get_millisecond();
+    for (r = 0; r < rounds; r++) {
+        idx = (uint32_t)tal_system_get_random(sessions);
+        tal_net_send_to(sender, &r, sizeof(r), TY_IPADDR_LOOPBACK, TAL_NET_POLL_BENCH_PORT + idx);
+        cnt = tal_net_poll_wait(handle, events, CNTSOF(events), 1000);
+        if (1 != cnt || (uint32_t)(uintptr_t)events[0].arg != idx) {
+            miss++;
+        }
+        tal_net_recv(fds[idx], &val, sizeof(val));
+    }
+    cost = tal_system_get_millisecond() - t0;
+
+    PR_NOTICE("net poll bench[%s] sessions:%d %dus/event miss:%d", tal_net_poll_get_name(handle), sessions,
+              (uint32_t)(cost * 1000 / rounds), miss);
+
+__EXIT:
+    tal_net_poll_destroy(handle);
+    return rt;
+}
+
+/**
+ * @brief Benchmark wait and dispatch of every backend with udp sessions on loopback
+ *
+ * @param[in] sessions: sockets watched, such as 1/16/64
+ * @param[in] rounds: datagrams sent to a random session
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_poll_benchmark(uint32_t sessions, uint32_t rounds)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TAL_NET_POLL_TYPE_E type = 0;
+    int *fds = NULL;
+    int sender = -1;
+    uint32_t idx = 0;
+
+    if (0 == sessions || 0 == rounds) {
+        return OPRT_INVALID_PARM;
+    }
+
+    fds = (int *)tal_malloc(sessions * sizeof(int));
+    if (NULL == fds) {
+        return OPRT_MALLOC_FAILED;
+    }
+    for (idx = 0; idx < sessions; idx++) {
+        fds[idx] = -1;
+    }
+
+    for (idx = 0; idx < sessions; idx++) {
+        fds[idx] = tal_net_socket_create(PROTOCOL_UDP);
+        if (fds[idx] < 0) {
+            rt = OPRT_SOCK_ERR;
+            goto __EXIT;
+        }
+        tal_net_set_reuse(fds[idx]);
+        if (tal_net_bind(fds[idx], TY_IPADDR_LOOPBACK, TAL_NET_POLL_BENCH_PORT + idx) < 0) {
+            PR_ERR("bench bind port %d err", TAL_NET_POLL_BENCH_PORT + idx);
+            rt = OPRT_SOCK_ERR;
+            goto __EXIT;
+        }
+    }
+    sender = tal_net_socket_create(PROTOCOL_UDP);
+    if (sender < 0) {
+        rt = OPRT_SOCK_ERR;
+        goto __EXIT;
+    }
+
+    for (type = TAL_NET_POLL_EPOLL; type <= TAL_NET_POLL_SELECT; type++) {
+        if (NULL == __net_poll_get_ops(type)) {
+            continue;
+        }
+        rt = __net_poll_bench_one(type, fds, sessions, sender, rounds);
+        if (OPRT_OK != rt) {
+            break;
+        }
+    }
+
+__EXIT:
+    if (sender >= 0) {
+        tal_net_close(sender);
+    }
+    for (idx = 0; idx < sessions; idx++) {
+        if (fds[idx] >= 0) {
+            tal_net_close(fds[idx]);
+        }
+    }
+    tal_free(fds);
+
+    return rt;
+}
+#endif
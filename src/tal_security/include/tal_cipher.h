@@ -0,0 +1,227 @@
+/**
+ * @file tal_cipher.h
+ * @brief Keyed AES cipher contexts on pluggable providers for Tuya SDK.
+ *
+ * A cipher handle is keyed once and reused for any number of messages, so
+ * the key schedule and the GHASH table are not rebuilt per message. CBC and
+ * GCM work on caller buffers and may run in place (input == output). GCM
+ * messages can be handed over in a batch, the counter blocks of all of them
+ * are then encrypted together to keep a pipelined or hardware AES busy.
+ *
+ * The block cipher comes from a provider. Built in are AES-NI (x86 hosts,
+ * with PCLMUL for GHASH), ARMv8 crypto extensions (aarch64 hosts) and TKL,
+ * which is the platform AES engine when ENABLE_PLATFORM_AES is set and
+ * mbedtls otherwise. A platform can register its own provider in front.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#ifndef __TAL_CIPHER_H__
+#define __TAL_CIPHER_H__
+
+#include "tuya_cloud_types.h"
+#include "tal_symmetry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define TAL_CIPHER_BLOCK_SIZE 16
+/* round keys of the largest key, 14 rounds */
+#define TAL_CIPHER_RK_SIZE    (15 * TAL_CIPHER_BLOCK_SIZE)
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef void *TAL_CIPHER_HANDLE;
+
+/**
+ * @brief A block cipher backend
+ *
+ * All block counts are in TAL_CIPHER_BLOCK_SIZE units, in and out may be
+ * the same buffer. cbc_encrypt / cbc_decrypt update iv like tkl_aes_crypt_cbc.
+ */
+typedef struct {
+    const char *name;
+    uint32_t ctx_size;
+    // usable on this chip, NULL if always
+    BOOL_T (*probe)(void);
+    OPERATE_RET (*setkey)(void *ctx, const uint8_t *key, uint32_t keybits);
+    void (*clear)(void *ctx);
+    OPERATE_RET (*ecb_encrypt)(void *ctx, const uint8_t *in, uint8_t *out, uint32_t blocks);
+    OPERATE_RET (*cbc_encrypt)(void *ctx, uint8_t iv[16], const uint8_t *in, uint8_t *out, uint32_t blocks);
+    OPERATE_RET (*cbc_decrypt)(void *ctx, uint8_t iv[16], const uint8_t *in, uint8_t *out, uint32_t blocks);
+    // y = (y ^ block) * H over the blocks, NULL to use the portable table
+    void (*ghash)(void *ctx, uint8_t y[16], const uint8_t *data, uint32_t blocks);
+} TAL_CIPHER_PROVIDER_T;
+
+/* one gcm message, input and output may be the same buffer */
+typedef struct {
+    const uint8_t *iv;
+    size_t iv_len;
+    const uint8_t *ad;
+    size_t ad_len;
+    const uint8_t *input;
+    uint8_t *output;
+    size_t length;
+    uint8_t *tag; // written on encrypt, checked on decrypt
+    size_t tag_len;
+} TAL_CIPHER_GCM_T;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+
+/**
+ * @brief Register a provider, it is preferred over the built in ones
+ *
+ * @param[in] provider: provider, it must stay valid
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_cipher_provider_register(const TAL_CIPHER_PROVIDER_T *provider);
+
+/**
+ * @brief Get the nth usable provider, in the order they are preferred
+ *
+ * @param[in] idx: index from 0
+ *
+ * @return provider, NULL if there are fewer
+ */
+const TAL_CIPHER_PROVIDER_T *tal_cipher_provider_get(uint32_t idx);
+
+/**
+ * @brief Create a keyed cipher context
+ *
+ * @param[in] provider: provider name, NULL for the preferred one
+ * @param[in] key: aes key
+ * @param[in] keybits: 128, 192 or 256
+ * @param[out] handle: cipher handle
+ *
+ * @note A handle is not thread safe, use one per thread or serialize the calls.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_cipher_create(const char *provider, const uint8_t *key, uint32_t keybits, TAL_CIPHER_HANDLE *handle);
+
+/**
+ * @brief Destroy a cipher context, the key material is wiped
+ *
+ * @param[in] handle: cipher handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_cipher_destroy(TAL_CIPHER_HANDLE handle);
+
+/**
+ * @brief Get the provider name of a cipher context, such as "aesni"
+ *
+ * @param[in] handle: cipher handle
+ *
+ * @return provider name
+ */
+const char *tal_cipher_get_name(TAL_CIPHER_HANDLE handle);
+
+/**
+ * @brief AES-CBC on full blocks
+ *
+ * @param[in] handle: cipher handle
+ * @param[in] mode: SYMMETRY_ENCRYPT or SYMMETRY_DECRYPT
+ * @param[inout] iv: initialization vector, updated for the next call
+ * @param[in] input: input data
+ * @param[out] output: output data, it can be input
+ * @param[in] length: multiple of TAL_CIPHER_BLOCK_SIZE, pad with
+ * tal_pkcs7padding_buffer first
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_cipher_cbc_crypt(TAL_CIPHER_HANDLE handle, TAL_SYMMETRY_CRYPT_MODE mode, uint8_t iv[16],
+                                 const uint8_t *input, uint8_t *output, size_t length);
+
+/**
+ * @brief AES-GCM authenticated encryption of a batch of messages
+ *
+ * @param[in] handle: cipher handle
+ * @param[inout] msg: messages, the tag of each is written
+ * @param[in] num: count of messages
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_cipher_gcm_encrypt_batch(TAL_CIPHER_HANDLE handle, TAL_CIPHER_GCM_T *msg, uint32_t num);
+
+/**
+ * @brief AES-GCM authenticated decryption of a batch of messages
+ *
+ * @param[in] handle: cipher handle
+ * @param[inout] msg: messages
+ * @param[in] num: count of messages
+ *
+ * @note The output of a message that fails authentication is wiped.
+ *
+ * @return OPRT_OK if all messages are authentic, OPRT_AUTHENTICATION_FAIL if
+ * any is not. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tal_cipher_gcm_decrypt_batch(TAL_CIPHER_HANDLE handle, TAL_CIPHER_GCM_T *msg, uint32_t num);
+
+/**
+ * @brief AES-GCM authenticated encryption of one message
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_cipher_gcm_encrypt(TAL_CIPHER_HANDLE handle, const uint8_t *iv, size_t iv_len, const uint8_t *ad,
+                                   size_t ad_len, const uint8_t *input, uint8_t *output, size_t length, uint8_t *tag,
+                                   size_t tag_len);
+
+/**
+ * @brief AES-GCM authenticated decryption of one message
+ *
+ * @return OPRT_OK on success, OPRT_AUTHENTICATION_FAIL if the tag does not
+ * match. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tal_cipher_gcm_decrypt(TAL_CIPHER_HANDLE handle, const uint8_t *iv, size_t iv_len, const uint8_t *ad,
+                                   size_t ad_len, const uint8_t *input, uint8_t *output, size_t length,
+                                   const uint8_t *tag, size_t tag_len);
+
+/**
+ * @brief Expand an aes key for a provider
+ *
+ * @param[in] key: aes key
+ * @param[in] keybits: 128, 192 or 256
+ * @param[out] rk: encryption round keys in FIPS-197 byte order, TAL_CIPHER_RK_SIZE
+ * @param[out] dk: round keys of the equivalent inverse cipher in the order they
+ * are used, the middle ones with InvMixColumns applied, NULL if not needed
+ *
+ * @note The layout fits the AES-NI and ARMv8 aes instructions.
+ *
+ * @return count of rounds, 0 if keybits is invalid
+ */
+uint32_t tal_cipher_key_expand(const uint8_t *key, uint32_t keybits, uint8_t *rk, uint8_t *dk);
+
+/**
+ * @brief Benchmark AES-128-CBC and AES-128-GCM of every usable provider
+ *
+ * @param[in] len: message length, such as 64/1024/16384
+ * @param[in] rounds: messages per measurement
+ *
+ * @note Available when ENABLE_CIPHER_BENCHMARK is defined. The output of every
+ * provider is checked against the TKL one, MB/s is printed with PR_NOTICE.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_cipher_benchmark(uint32_t len, uint32_t rounds);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TAL_CIPHER_H__ */
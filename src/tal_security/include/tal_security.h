@@ -12,7 +12,8 @@
 #include "tal_x509.h"
 #include "tal_hash.h"
 #include "tal_symmetry.h"
-#include "tal_asymmetrical.h"
+#include "tal_asymmetrical.h"
+#include "tal_cipher.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -0,0 +1,729 @@
+/**
+ * @file tal_cipher.c
+ * @brief Keyed AES-CBC and batched AES-GCM on pluggable block cipher
+ * providers.
+ *
+ * GCM is built here on top of the provider's ECB, so one counter block walk
+ * serves every provider: the counter blocks of a batch are laid out in one
+ * keystream buffer and encrypted with a single provider call, which lets a
+ * hardware engine or the pipelined AES-NI/ARMv8 rounds work on several blocks
+ * at once. GHASH uses the provider's carry-less multiply when it has one and
+ * the 4-bit table otherwise.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tuya_iot_config.h"
+#include "tal_cipher.h"
+#include "tal_log.h"
+#include "tal_memory.h"
+#include "tal_system.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#ifndef TAL_CIPHER_PROVIDER_MAX
+#define TAL_CIPHER_PROVIDER_MAX 4
+#endif
+
+/* keystream blocks encrypted per provider call */
+#ifndef TAL_CIPHER_BATCH_BLOCKS
+#define TAL_CIPHER_BATCH_BLOCKS 16
+#endif
+
+/* gcm messages in flight together, at most TAL_CIPHER_BATCH_BLOCKS */
+#ifndef TAL_CIPHER_BATCH_MSG
+#define TAL_CIPHER_BATCH_MSG 8
+#endif
+
+#define CIPHER_ALIGN(x) (((x) + 15) & ~(uintptr_t)15)
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint8_t y[TAL_CIPHER_BLOCK_SIZE];
+    uint8_t ctr[TAL_CIPHER_BLOCK_SIZE];
+    uint8_t ek0[TAL_CIPHER_BLOCK_SIZE];
+} TAL_CIPHER_GCM_STATE_T;
+
+typedef struct {
+    const TAL_CIPHER_PROVIDER_T *provider;
+    void *ctx;
+    uint64_t hl[16];
+    uint64_t hh[16];
+    TAL_CIPHER_GCM_STATE_T st[TAL_CIPHER_BATCH_MSG];
+    uint8_t ks[TAL_CIPHER_BATCH_BLOCKS * TAL_CIPHER_BLOCK_SIZE];
+} TAL_CIPHER_T;
+
+typedef struct {
+    TKL_SYMMETRY_HANDLE enc;
+    TKL_SYMMETRY_HANDLE dec;
+} TAL_CIPHER_TKL_CTX_T;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/* built in providers, NULL when not compiled for this cpu */
+extern const TAL_CIPHER_PROVIDER_T *tal_cipher_aesni_provider(void);
+extern const TAL_CIPHER_PROVIDER_T *tal_cipher_armce_provider(void);
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static const TAL_CIPHER_PROVIDER_T *s_cipher_provider[TAL_CIPHER_PROVIDER_MAX];
+static uint32_t s_cipher_provider_num = 0;
+
+// reduction of the 4 bits shifted out, from mbedtls gcm.c
+static const uint64_t s_ghash_last4[16] = {0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+                                           0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static uint64_t __get_be64(const uint8_t *p)
+{
+    return ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) | ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) |
+           ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) | ((uint64_t)p[6] << 8) | (uint64_t)p[7];
+}
+
+static void __put_be64(uint64_t v, uint8_t *p)
+{
+    uint32_t i;
+
+    for (i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(v >> (56 - 8 * i));
+    }
+}
+
+static uint8_t __gf_mul(uint8_t a, uint8_t b)
+{
+    uint8_t p = 0;
+
+    while (b) {
+        if (b & 1) {
+            p ^= a;
+        }
+        a = (uint8_t)((a << 1) ^ ((a & 0x80) ? 0x1b : 0));
+        b >>= 1;
+    }
+
+    return p;
+}
+
+// computed rather than looked up, it only runs on key setup
+static uint8_t __aes_sbox(uint8_t x)
+{
+    uint8_t inv = 1, sq = x, s = 0;
+    uint32_t i;
+
+    // x^254 is the inverse, x^2 * x^4 * ... * x^128
+    for (i = 0; i < 7; i++) {
+        sq = __gf_mul(sq, sq);
+        inv = __gf_mul(inv, sq);
+    }
+    s = inv;
+    for (i = 1; i < 5; i++) {
+        s ^= (uint8_t)((inv << i) | (inv >> (8 - i)));
+    }
+
+    return s ^ 0x63;
+}
+
+uint32_t tal_cipher_key_expand(const uint8_t *key, uint32_t keybits, uint8_t *rk, uint8_t *dk)
+{
+    uint32_t nk = keybits / 32, nr = 0, i = 0, j = 0;
+    uint8_t t[4], rcon = 1, a0, a1, a2, a3;
+
+    if (NULL == key || NULL == rk || (128 != keybits && 192 != keybits && 256 != keybits)) {
+        return 0;
+    }
+    nr = nk + 6;
+
+    memcpy(rk, key, nk * 4);
+    for (i = nk; i < 4 * (nr + 1); i++) {
+        memcpy(t, rk + (i - 1) * 4, 4);
+        if (0 == i % nk) {
+            a0 = t[0];
+            t[0] = __aes_sbox(t[1]) ^ rcon;
+            t[1] = __aes_sbox(t[2]);
+            t[2] = __aes_sbox(t[3]);
+            t[3] = __aes_sbox(a0);
+            rcon = __gf_mul(rcon, 2);
+        } else if (nk > 6 && 4 == i % nk) {
+            for (j = 0; j < 4; j++) {
+                t[j] = __aes_sbox(t[j]);
+            }
+        }
+        for (j = 0; j < 4; j++) {
+            rk[i * 4 + j] = rk[(i - nk) * 4 + j] ^ t[j];
+        }
+    }
+
+    if (dk) {
+        memcpy(dk, rk + nr * 16, 16);
+        for (i = 1; i < nr; i++) {
+            for (j = 0; j < 16; j += 4) {
+                a0 = rk[(nr - i) * 16 + j];
+                a1 = rk[(nr - i) * 16 + j + 1];
+                a2 = rk[(nr - i) * 16 + j + 2];
+                a3 = rk[(nr - i) * 16 + j + 3];
+                dk[i * 16 + j] = __gf_mul(a0, 14) ^ __gf_mul(a1, 11) ^ __gf_mul(a2, 13) ^ __gf_mul(a3, 9);
+                dk[i * 16 + j + 1] = __gf_mul(a0, 9) ^ __gf_mul(a1, 14) ^ __gf_mul(a2, 11) ^ __gf_mul(a3, 13);
+                dk[i * 16 + j + 2] = __gf_mul(a0, 13) ^ __gf_mul(a1, 9) ^ __gf_mul(a2, 14) ^ __gf_mul(a3, 11);
+                dk[i * 16 + j + 3] = __gf_mul(a0, 11) ^ __gf_mul(a1, 13) ^ __gf_mul(a2, 9) ^ __gf_mul(a3, 14);
+            }
+        }
+        memcpy(dk + nr * 16, rk, 16);
+    }
+
+    return nr;
+}
+
+/* tkl provider, the platform aes engine or mbedtls */
+static OPERATE_RET __tkl_setkey(void *ctx, const uint8_t *key, uint32_t keybits)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TAL_CIPHER_TKL_CTX_T *tkl = (TAL_CIPHER_TKL_CTX_T *)ctx;
+
+    TUYA_CALL_ERR_RETURN(tkl_aes_create_init(&tkl->enc));
+    TUYA_CALL_ERR_RETURN(tkl_aes_create_init(&tkl->dec));
+    TUYA_CALL_ERR_RETURN(tkl_aes_setkey_enc(tkl->enc, key, keybits));
+    TUYA_CALL_ERR_RETURN(tkl_aes_setkey_dec(tkl->dec, key, keybits));
+
+    return OPRT_OK;
+}
+
+static void __tkl_clear(void *ctx)
+{
+    TAL_CIPHER_TKL_CTX_T *tkl = (TAL_CIPHER_TKL_CTX_T *)ctx;
+
+    if (tkl->enc) {
+        tkl_aes_free(tkl->enc);
+        tkl->enc = NULL;
+    }
+    if (tkl->dec) {
+        tkl_aes_free(tkl->dec);
+        tkl->dec = NULL;
+    }
+}
+
+static OPERATE_RET __tkl_ecb_encrypt(void *ctx, const uint8_t *in, uint8_t *out, uint32_t blocks)
+{
+    TAL_CIPHER_TKL_CTX_T *tkl = (TAL_CIPHER_TKL_CTX_T *)ctx;
+
+    return tkl_aes_crypt_ecb(tkl->enc, SYMMETRY_ENCRYPT, blocks * TAL_CIPHER_BLOCK_SIZE, in, out);
+}
+
+static OPERATE_RET __tkl_cbc_encrypt(void *ctx, uint8_t iv[16], const uint8_t *in, uint8_t *out, uint32_t blocks)
+{
+    TAL_CIPHER_TKL_CTX_T *tkl = (TAL_CIPHER_TKL_CTX_T *)ctx;
+
+    return tkl_aes_crypt_cbc(tkl->enc, SYMMETRY_ENCRYPT, blocks * TAL_CIPHER_BLOCK_SIZE, iv, in, out);
+}
+
+static OPERATE_RET __tkl_cbc_decrypt(void *ctx, uint8_t iv[16], const uint8_t *in, uint8_t *out, uint32_t blocks)
+{
+    TAL_CIPHER_TKL_CTX_T *tkl = (TAL_CIPHER_TKL_CTX_T *)ctx;
+
+    return tkl_aes_crypt_cbc(tkl->dec, SYMMETRY_DECRYPT, blocks * TAL_CIPHER_BLOCK_SIZE, iv, in, out);
+}
+
+static const TAL_CIPHER_PROVIDER_T s_cipher_tkl = {
+    .name = "tkl",
+    .ctx_size = SIZEOF(TAL_CIPHER_TKL_CTX_T),
+    .probe = NULL,
+    .setkey = __tkl_setkey,
+    .clear = __tkl_clear,
+    .ecb_encrypt = __tkl_ecb_encrypt,
+    .cbc_encrypt = __tkl_cbc_encrypt,
+    .cbc_decrypt = __tkl_cbc_decrypt,
+    .ghash = NULL,
+};
+
+OPERATE_RET tal_cipher_provider_register(const TAL_CIPHER_PROVIDER_T *provider)
+{
+    if (NULL == provider || NULL == provider->name || NULL == provider->setkey || NULL == provider->ecb_encrypt ||
+        NULL == provider->cbc_encrypt || NULL == provider->cbc_decrypt) {
+        return OPRT_INVALID_PARM;
+    }
+    if (s_cipher_provider_num >= TAL_CIPHER_PROVIDER_MAX) {
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+
+    s_cipher_provider[s_cipher_provider_num++] = provider;
+    return OPRT_OK;
+}
+
+const TAL_CIPHER_PROVIDER_T *tal_cipher_provider_get(uint32_t idx)
+{
+    const TAL_CIPHER_PROVIDER_T *list[TAL_CIPHER_PROVIDER_MAX + 3];
+    uint32_t num = 0, i = 0;
+
+    for (i = 0; i < s_cipher_provider_num; i++) {
+        list[num++] = s_cipher_provider[i];
+    }
+    list[num++] = tal_cipher_aesni_provider();
+    list[num++] = tal_cipher_armce_provider();
+    list[num++] = &s_cipher_tkl;
+
+    for (i = 0; i < num; i++) {
+        if (NULL == list[i] || (list[i]->probe && !list[i]->probe())) {
+            continue;
+        }
+        if (0 == idx) {
+            return list[i];
+        }
+        idx--;
+    }
+
+    return NULL;
+}
+
+static void __ghash_gen_table(TAL_CIPHER_T *cipher, const uint8_t h[16])
+{
+    uint64_t vh = __get_be64(h), vl = __get_be64(h + 8);
+    uint64_t *hl = NULL, *hh = NULL;
+    uint32_t i = 0, j = 0, t = 0;
+
+    cipher->hl[8] = vl;
+    cipher->hh[8] = vh;
+    cipher->hl[0] = 0;
+    cipher->hh[0] = 0;
+    for (i = 4; i > 0; i >>= 1) {
+        t = (uint32_t)(vl & 1) * 0xe1000000U;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ ((uint64_t)t << 32);
+        cipher->hl[i] = vl;
+        cipher->hh[i] = vh;
+    }
+    for (i = 2; i <= 8; i *= 2) {
+        hl = cipher->hl + i;
+        hh = cipher->hh + i;
+        vl = *hl;
+        vh = *hh;
+        for (j = 1; j < i; j++) {
+            hl[j] = vl ^ cipher->hl[j];
+            hh[j] = vh ^ cipher->hh[j];
+        }
+    }
+}
+
+static void __ghash_mult(TAL_CIPHER_T *cipher, uint8_t x[16])
+{
+    uint64_t zh, zl;
+    uint8_t lo, hi, rem;
+    int i;
+
+    lo = x[15] & 0xf;
+    zh = cipher->hh[lo];
+    zl = cipher->hl[lo];
+    for (i = 15; i >= 0; i--) {
+        lo = x[i] & 0xf;
+        hi = (x[i] >> 4) & 0xf;
+        if (i != 15) {
+            rem = (uint8_t)zl & 0xf;
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ (s_ghash_last4[rem] << 48);
+            zh ^= cipher->hh[lo];
+            zl ^= cipher->hl[lo];
+        }
+        rem = (uint8_t)zl & 0xf;
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ (s_ghash_last4[rem] << 48);
+        zh ^= cipher->hh[hi];
+        zl ^= cipher->hl[hi];
+    }
+    __put_be64(zh, x);
+    __put_be64(zl, x + 8);
+}
+
+// y = GHASH(y, data), a partial tail block is zero padded
+static void __ghash_update(TAL_CIPHER_T *cipher, uint8_t y[16], const uint8_t *data, size_t len)
+{
+    uint8_t tail[TAL_CIPHER_BLOCK_SIZE];
+    size_t blocks = len / TAL_CIPHER_BLOCK_SIZE, i = 0, j = 0;
+
+    if (blocks) {
+        if (cipher->provider->ghash) {
+            cipher->provider->ghash(cipher->ctx, y, data, blocks);
+        } else {
+            for (i = 0; i < blocks; i++) {
+                for (j = 0; j < TAL_CIPHER_BLOCK_SIZE; j++) {
+                    y[j] ^= data[i * TAL_CIPHER_BLOCK_SIZE + j];
+                }
+                __ghash_mult(cipher, y);
+            }
+        }
+    }
+
+    len -= blocks * TAL_CIPHER_BLOCK_SIZE;
+    if (len) {
+        memset(tail, 0, SIZEOF(tail));
+        memcpy(tail, data + blocks * TAL_CIPHER_BLOCK_SIZE, len);
+        __ghash_update(cipher, y, tail, TAL_CIPHER_BLOCK_SIZE);
+    }
+}
+
+static void __gcm_inc32(uint8_t ctr[16])
+{
+    int i;
+
+    for (i = 15; i >= 12; i--) {
+        if (++ctr[i]) {
+            break;
+        }
+    }
+}
+
+static OPERATE_RET __gcm_check(TAL_CIPHER_GCM_T *msg)
+{
+    if (NULL == msg->iv || 0 == msg->iv_len || NULL == msg->tag || msg->tag_len < 4 ||
+        msg->tag_len > TAL_CIPHER_BLOCK_SIZE || (msg->ad_len && NULL == msg->ad) ||
+        (msg->length && (NULL == msg->input || NULL == msg->output))) {
+        return OPRT_INVALID_PARM;
+    }
+    // the 32 bit counter must not wrap, 2^32 - 2 blocks at most
+    if ((uint64_t)msg->length >= ((uint64_t)0xFFFFFFFE << 4)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    return OPRT_OK;
+}
+
+// j0 from the iv, y from the additional data
+static void __gcm_start(TAL_CIPHER_T *cipher, TAL_CIPHER_GCM_STATE_T *st, TAL_CIPHER_GCM_T *msg)
+{
+    uint8_t len_block[TAL_CIPHER_BLOCK_SIZE];
+
+    memset(st, 0, SIZEOF(TAL_CIPHER_GCM_STATE_T));
+    if (12 == msg->iv_len) {
+        memcpy(st->ctr, msg->iv, 12);
+        st->ctr[15] = 1;
+    } else {
+        __ghash_update(cipher, st->ctr, msg->iv, msg->iv_len);
+        memset(len_block, 0, 8);
+        __put_be64((uint64_t)msg->iv_len * 8, len_block + 8);
+        __ghash_update(cipher, st->ctr, len_block, TAL_CIPHER_BLOCK_SIZE);
+    }
+    if (msg->ad_len) {
+        __ghash_update(cipher, st->y, msg->ad, msg->ad_len);
+    }
+}
+
+// xor a run of keystream into a message, ghash the ciphertext side
+static void __gcm_apply(TAL_CIPHER_T *cipher, TAL_CIPHER_GCM_STATE_T *st, TAL_CIPHER_GCM_T *msg, size_t off,
+                        const uint8_t *ks, size_t len, BOOL_T encrypt)
+{
+    const uint8_t *in = msg->input + off;
+    uint8_t *out = msg->output + off;
+    size_t i;
+
+    if (!encrypt) {
+        __ghash_update(cipher, st->y, in, len);
+    }
+    for (i = 0; i < len; i++) {
+        out[i] = in[i] ^ ks[i];
+    }
+    if (encrypt) {
+        __ghash_update(cipher, st->y, out, len);
+    }
+}
+
+static OPERATE_RET __gcm_batch(TAL_CIPHER_T *cipher, TAL_CIPHER_GCM_T *msg, uint32_t num, BOOL_T encrypt)
+{
+    OPERATE_RET rt = OPRT_OK, auth = OPRT_OK;
+    TAL_CIPHER_GCM_STATE_T *st = NULL;
+    uint8_t len_block[TAL_CIPHER_BLOCK_SIZE];
+    uint32_t i = 0, j = 0, m = 0, n = 0, k = 0, fm = 0;
+    size_t off = 0, foff = 0, take = 0;
+    uint8_t diff = 0;
+
+    while (num) {
+        n = (num < TAL_CIPHER_BATCH_MSG) ? num : TAL_CIPHER_BATCH_MSG;
+
+        // e(j0) of every message in one call
+        for (i = 0; i < n; i++) {
+            TUYA_CALL_ERR_RETURN(__gcm_check(&msg[i]));
+            __gcm_start(cipher, &cipher->st[i], &msg[i]);
+            memcpy(cipher->ks + i * TAL_CIPHER_BLOCK_SIZE, cipher->st[i].ctr, TAL_CIPHER_BLOCK_SIZE);
+            __gcm_inc32(cipher->st[i].ctr);
+        }
+        TUYA_CALL_ERR_RETURN(cipher->provider->ecb_encrypt(cipher->ctx, cipher->ks, cipher->ks, n));
+        for (i = 0; i < n; i++) {
+            memcpy(cipher->st[i].ek0, cipher->ks + i * TAL_CIPHER_BLOCK_SIZE, TAL_CIPHER_BLOCK_SIZE);
+        }
+
+        // counter blocks run on across message boundaries to fill each call
+        m = 0;
+        off = 0;
+        while (m < n) {
+            k = 0;
+            fm = m;
+            foff = off;
+            while (fm < n && k < TAL_CIPHER_BATCH_BLOCKS) {
+                if (foff >= msg[fm].length) {
+                    fm++;
+                    foff = 0;
+                    continue;
+                }
+                memcpy(cipher->ks + k * TAL_CIPHER_BLOCK_SIZE, cipher->st[fm].ctr, TAL_CIPHER_BLOCK_SIZE);
+                __gcm_inc32(cipher->st[fm].ctr);
+                foff += TAL_CIPHER_BLOCK_SIZE;
+                k++;
+            }
+            if (0 == k) {
+                break;
+            }
+            TUYA_CALL_ERR_RETURN(cipher->provider->ecb_encrypt(cipher->ctx, cipher->ks, cipher->ks, k));
+
+            for (j = 0; m < n && j < k;) {
+                take = msg[m].length - off;
+                if (take > (size_t)(k - j) * TAL_CIPHER_BLOCK_SIZE) {
+                    take = (size_t)(k - j) * TAL_CIPHER_BLOCK_SIZE;
+                }
+                __gcm_apply(cipher, &cipher->st[m], &msg[m], off, cipher->ks + j * TAL_CIPHER_BLOCK_SIZE, take,
+                            encrypt);
+                j += (take + TAL_CIPHER_BLOCK_SIZE - 1) / TAL_CIPHER_BLOCK_SIZE;
+                off += take;
+                if (off >= msg[m].length) {
+                    m++;
+                    off = 0;
+                }
+            }
+        }
+
+        for (i = 0; i < n; i++) {
+            st = &cipher->st[i];
+            __put_be64((uint64_t)msg[i].ad_len * 8, len_block);
+            __put_be64((uint64_t)msg[i].length * 8, len_block + 8);
+            __ghash_update(cipher, st->y, len_block, TAL_CIPHER_BLOCK_SIZE);
+            for (j = 0; j < TAL_CIPHER_BLOCK_SIZE; j++) {
+                st->y[j] ^= st->ek0[j];
+            }
+            if (encrypt) {
+                memcpy(msg[i].tag, st->y, msg[i].tag_len);
+                continue;
+            }
+            diff = 0;
+            for (j = 0; j < msg[i].tag_len; j++) {
+                diff |= st->y[j] ^ msg[i].tag[j];
+            }
+            if (diff) {
+                memset(msg[i].output, 0, msg[i].length);
+                auth = OPRT_AUTHENTICATION_FAIL;
+            }
+        }
+
+        msg += n;
+        num -= n;
+    }
+
+    memset(cipher->st, 0, SIZEOF(cipher->st));
+    memset(cipher->ks, 0, SIZEOF(cipher->ks));
+    return auth;
+}
+
+OPERATE_RET tal_cipher_create(const char *provider, const uint8_t *key, uint32_t keybits, TAL_CIPHER_HANDLE *handle)
+{
+    OPERATE_RET rt = OPRT_OK;
+    const TAL_CIPHER_PROVIDER_T *p = NULL;
+    TAL_CIPHER_T *cipher = NULL;
+    uint8_t h[TAL_CIPHER_BLOCK_SIZE];
+    uint32_t i = 0;
+
+    TUYA_CHECK_NULL_RETURN(key, OPRT_INVALID_PARM);
+    TUYA_CHECK_NULL_RETURN(handle, OPRT_INVALID_PARM);
+    if (128 != keybits && 192 != keybits && 256 != keybits) {
+        return OPRT_INVALID_PARM;
+    }
+
+    while ((p = tal_cipher_provider_get(i++)) != NULL) {
+        if (NULL == provider || 0 == strcmp(provider, p->name)) {
+            break;
+        }
+    }
+    if (NULL == p) {
+        PR_ERR("cipher provider %s not usable", provider ? provider : "");
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    cipher = tal_malloc(SIZEOF(TAL_CIPHER_T) + p->ctx_size + 15);
+    TUYA_CHECK_NULL_RETURN(cipher, OPRT_MALLOC_FAILED);
+    memset(cipher, 0, SIZEOF(TAL_CIPHER_T) + p->ctx_size + 15);
+    cipher->provider = p;
+    cipher->ctx = (void *)CIPHER_ALIGN((uintptr_t)(cipher + 1));
+
+    TUYA_CALL_ERR_GOTO(p->setkey(cipher->ctx, key, keybits), __error);
+
+    memset(h, 0, SIZEOF(h));
+    TUYA_CALL_ERR_GOTO(p->ecb_encrypt(cipher->ctx, h, h, 1), __error);
+    __ghash_gen_table(cipher, h);
+    memset(h, 0, SIZEOF(h));
+
+    *handle = cipher;
+    return OPRT_OK;
+
+__error:
+    tal_cipher_destroy(cipher);
+    return rt;
+}
+
+OPERATE_RET tal_cipher_destroy(TAL_CIPHER_HANDLE handle)
+{
+    TAL_CIPHER_T *cipher = (TAL_CIPHER_T *)handle;
+
+    TUYA_CHECK_NULL_RETURN(cipher, OPRT_INVALID_PARM);
+
+    if (cipher->provider->clear) {
+        cipher->provider->clear(cipher->ctx);
+    }
+    memset(cipher, 0, SIZEOF(TAL_CIPHER_T) + cipher->provider->ctx_size + 15);
+    tal_free(cipher);
+
+    return OPRT_OK;
+}
+
+const char *tal_cipher_get_name(TAL_CIPHER_HANDLE handle)
+{
+    TAL_CIPHER_T *cipher = (TAL_CIPHER_T *)handle;
+
+    return cipher ? cipher->provider->name : NULL;
+}
+
+OPERATE_RET tal_cipher_cbc_crypt(TAL_CIPHER_HANDLE handle, TAL_SYMMETRY_CRYPT_MODE mode, uint8_t iv[16],
+                                 const uint8_t *input, uint8_t *output, size_t length)
+{
+    TAL_CIPHER_T *cipher = (TAL_CIPHER_T *)handle;
+
+    TUYA_CHECK_NULL_RETURN(cipher, OPRT_INVALID_PARM);
+    TUYA_CHECK_NULL_RETURN(iv, OPRT_INVALID_PARM);
+    if (length % TAL_CIPHER_BLOCK_SIZE) {
+        return OPRT_INVALID_PARM;
+    }
+    if (0 == length) {
+        return OPRT_OK;
+    }
+    TUYA_CHECK_NULL_RETURN(input, OPRT_INVALID_PARM);
+    TUYA_CHECK_NULL_RETURN(output, OPRT_INVALID_PARM);
+
+    if (SYMMETRY_ENCRYPT == mode) {
+        return cipher->provider->cbc_encrypt(cipher->ctx, iv, input, output, length / TAL_CIPHER_BLOCK_SIZE);
+    }
+    return cipher->provider->cbc_decrypt(cipher->ctx, iv, input, output, length / TAL_CIPHER_BLOCK_SIZE);
+}
+
+OPERATE_RET tal_cipher_gcm_encrypt_batch(TAL_CIPHER_HANDLE handle, TAL_CIPHER_GCM_T *msg, uint32_t num)
+{
+    TUYA_CHECK_NULL_RETURN(handle, OPRT_INVALID_PARM);
+    TUYA_CHECK_NULL_RETURN(msg, OPRT_INVALID_PARM);
+
+    return __gcm_batch((TAL_CIPHER_T *)handle, msg, num, TRUE);
+}
+
+OPERATE_RET tal_cipher_gcm_decrypt_batch(TAL_CIPHER_HANDLE handle, TAL_CIPHER_GCM_T *msg, uint32_t num)
+{
+    TUYA_CHECK_NULL_RETURN(handle, OPRT_INVALID_PARM);
+    TUYA_CHECK_NULL_RETURN(msg, OPRT_INVALID_PARM);
+
+    return __gcm_batch((TAL_CIPHER_T *)handle, msg, num, FALSE);
+}
+
+OPERATE_RET tal_cipher_gcm_encrypt(TAL_CIPHER_HANDLE handle, const uint8_t *iv, size_t iv_len, const uint8_t *ad,
+                                   size_t ad_len, const uint8_t *input, uint8_t *output, size_t length, uint8_t *tag,
+                                   size_t tag_len)
+{
+    TAL_CIPHER_GCM_T msg = {iv, iv_len, ad, ad_len, input, output, length, tag, tag_len};
+
+    return tal_cipher_gcm_encrypt_batch(handle, &msg, 1);
+}
+
+OPERATE_RET tal_cipher_gcm_decrypt(TAL_CIPHER_HANDLE handle, const uint8_t *iv, size_t iv_len, const uint8_t *ad,
+                                   size_t ad_len, const uint8_t *input, uint8_t *output, size_t length,
+                                   const uint8_t *tag, size_t tag_len)
+{
+    TAL_CIPHER_GCM_T msg = {iv, iv_len, ad, ad_len, input, output, length, (uint8_t *)tag, tag_len};
+
+    return tal_cipher_gcm_decrypt_batch(handle, &msg, 1);
+}
+
+#if defined(ENABLE_CIPHER_BENCHMARK)
+static uint32_t __bench_kbps(uint32_t len, uint32_t rounds, SYS_TIME_T ms)
+{
+    return (uint32_t)((uint64_t)len * rounds * 1000 / 1024 / (ms ? ms : 1));
+}
+
+OPERATE_RET tal_cipher_benchmark(uint32_t len, uint32_t rounds)
+{
+    OPERATE_RET rt = OPRT_OK;
+    const TAL_CIPHER_PROVIDER_T *p = NULL;
+    TAL_CIPHER_HANDLE handle = NULL;
+    uint8_t key[16], iv[16], tag[16], ref_tag[16];
+    uint8_t *buf = NULL, *ref = NULL;
+    SYS_TIME_T start = 0, cbc_ms = 0, gcm_ms = 0;
+    uint32_t i = 0, j = 0;
+
+    len = (len + TAL_CIPHER_BLOCK_SIZE - 1) & ~(TAL_CIPHER_BLOCK_SIZE - 1);
+    if (0 == len || 0 == rounds) {
+        return OPRT_INVALID_PARM;
+    }
+
+    buf = tal_malloc(len * 2);
+    TUYA_CHECK_NULL_RETURN(buf, OPRT_MALLOC_FAILED);
+    ref = buf + len;
+    for (i = 0; i < SIZEOF(key); i++) {
+        key[i] = (uint8_t)(i * 7 + 1);
+    }
+
+    // reference output from tkl
+    for (i = 0; i < len; i++) {
+        ref[i] = (uint8_t)i;
+    }
+    memset(iv, 0x5a, SIZEOF(iv));
+    TUYA_CALL_ERR_GOTO(tal_cipher_create("tkl", key, 128, &handle), __exit);
+    TUYA_CALL_ERR_GOTO(tal_cipher_gcm_encrypt(handle, iv, 12, key, SIZEOF(key), ref, ref, len, ref_tag, 16), __exit);
+    tal_cipher_destroy(handle);
+    handle = NULL;
+
+    for (j = 0; (p = tal_cipher_provider_get(j)) != NULL; j++) {
+        TUYA_CALL_ERR_GOTO(tal_cipher_create(p->name, key, 128, &handle), __exit);
+
+        for (i = 0; i < len; i++) {
+            buf[i] = (uint8_t)i;
+        }
+        memset(iv, 0x5a, SIZEOF(iv));
+        TUYA_CALL_ERR_GOTO(tal_cipher_gcm_encrypt(handle, iv, 12, key, SIZEOF(key), buf, buf, len, tag, 16), __exit);
+        if (memcmp(buf, ref, len) || memcmp(tag, ref_tag, 16)) {
+            PR_ERR("cipher %s gcm output differs from tkl", p->name);
+            rt = OPRT_COM_ERROR;
+            goto __exit;
+        }
+
+        start = tal_system_get_millisecond();
+        for (i = 0; i < rounds; i++) {
+            tal_cipher_cbc_crypt(handle, SYMMETRY_ENCRYPT, iv, buf, buf, len);
+        }
+        cbc_ms = tal_system_get_millisecond() - start;
+
+        start = tal_system_get_millisecond();
+        for (i = 0; i < rounds; i++) {
+            tal_cipher_gcm_encrypt(handle, iv, 12, NULL, 0, buf, buf, len, tag, 16);
+        }
+        gcm_ms = tal_system_get_millisecond() - start;
+
+        PR_NOTICE("cipher %s len %u: cbc %u KB/s, gcm %u KB/s", p->name, len, __bench_kbps(len, rounds, cbc_ms),
+                  __bench_kbps(len, rounds, gcm_ms));
+
+        tal_cipher_destroy(handle);
+        handle = NULL;
+    }
+
+__exit:
+    if (handle) {
+        tal_cipher_destroy(handle);
+    }
+    tal_free(buf);
+    return rt;
+}
+#endif
@@ -0,0 +1,282 @@
+/**
+ * @file tal_cipher_aesni.c
+ * @brief AES-NI and PCLMULQDQ cipher provider for x86 hosts.
+ *
+ * ECB and CBC decryption run four independent blocks per loop so the aesenc
+ * / aesdec latency overlaps, CBC encryption is serial by nature. GHASH is a
+ * carry-less multiply with the shift-left reduction from the Intel GCM white
+ * paper. The functions are compiled with target attributes and only picked
+ * once cpuid reports the extensions, so the rest of the build keeps the
+ * baseline flags.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tuya_iot_config.h"
+#include "tal_cipher.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define AESNI_TARGET __attribute__((target("aes,pclmul,ssse3,sse4.1")))
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    __m128i rk[15];
+    __m128i dk[15];
+    __m128i h; // byte reflected hash key
+    uint32_t nr;
+} TAL_CIPHER_AESNI_CTX_T;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static BOOL_T __aesni_probe(void)
+{
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return FALSE;
+    }
+
+    // aes, pclmulqdq, ssse3, sse4.1
+    return ((ecx & (1u << 25)) && (ecx & (1u << 1)) && (ecx & (1u << 9)) && (ecx & (1u << 19))) ? TRUE : FALSE;
+}
+
+AESNI_TARGET static __m128i __aesni_bswap(__m128i x)
+{
+    return _mm_shuffle_epi8(x, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+}
+
+AESNI_TARGET static __m128i __aesni_enc1(TAL_CIPHER_AESNI_CTX_T *aes, __m128i b)
+{
+    uint32_t r;
+
+    b = _mm_xor_si128(b, aes->rk[0]);
+    for (r = 1; r < aes->nr; r++) {
+        b = _mm_aesenc_si128(b, aes->rk[r]);
+    }
+    return _mm_aesenclast_si128(b, aes->rk[aes->nr]);
+}
+
+AESNI_TARGET static __m128i __aesni_dec1(TAL_CIPHER_AESNI_CTX_T *aes, __m128i b)
+{
+    uint32_t r;
+
+    b = _mm_xor_si128(b, aes->dk[0]);
+    for (r = 1; r < aes->nr; r++) {
+        b = _mm_aesdec_si128(b, aes->dk[r]);
+    }
+    return _mm_aesdeclast_si128(b, aes->dk[aes->nr]);
+}
+
+// a * b in GF(2^128) on bit reflected operands
+AESNI_TARGET static __m128i __aesni_gfmul(__m128i a, __m128i b)
+{
+    __m128i t3, t4, t5, t6, t7, t8, t9;
+
+    t3 = _mm_clmulepi64_si128(a, b, 0x00);
+    t4 = _mm_clmulepi64_si128(a, b, 0x10);
+    t5 = _mm_clmulepi64_si128(a, b, 0x01);
+    t6 = _mm_clmulepi64_si128(a, b, 0x11);
+    t4 = _mm_xor_si128(t4, t5);
+    t5 = _mm_slli_si128(t4, 8);
+    t4 = _mm_srli_si128(t4, 8);
+    t3 = _mm_xor_si128(t3, t5);
+    t6 = _mm_xor_si128(t6, t4);
+
+    // shift the 256 bit product left by one
+    t7 = _mm_srli_epi32(t3, 31);
+    t8 = _mm_srli_epi32(t6, 31);
+    t3 = _mm_slli_epi32(t3, 1);
+    t6 = _mm_slli_epi32(t6, 1);
+    t9 = _mm_srli_si128(t7, 12);
+    t8 = _mm_slli_si128(t8, 4);
+    t7 = _mm_slli_si128(t7, 4);
+    t3 = _mm_or_si128(t3, t7);
+    t6 = _mm_or_si128(t6, t8);
+    t6 = _mm_or_si128(t6, t9);
+
+    // reduce modulo x^128 + x^7 + x^2 + x + 1
+    t7 = _mm_slli_epi32(t3, 31);
+    t8 = _mm_slli_epi32(t3, 30);
+    t9 = _mm_slli_epi32(t3, 25);
+    t7 = _mm_xor_si128(t7, t8);
+    t7 = _mm_xor_si128(t7, t9);
+    t8 = _mm_srli_si128(t7, 4);
+    t7 = _mm_slli_si128(t7, 12);
+    t3 = _mm_xor_si128(t3, t7);
+
+    t4 = _mm_srli_epi32(t3, 1);
+    t5 = _mm_srli_epi32(t3, 2);
+    t9 = _mm_srli_epi32(t3, 7);
+    t4 = _mm_xor_si128(t4, t5);
+    t4 = _mm_xor_si128(t4, t9);
+    t4 = _mm_xor_si128(t4, t8);
+    t3 = _mm_xor_si128(t3, t4);
+
+    return _mm_xor_si128(t6, t3);
+}
+
+AESNI_TARGET static OPERATE_RET __aesni_setkey(void *ctx, const uint8_t *key, uint32_t keybits)
+{
+    TAL_CIPHER_AESNI_CTX_T *aes = (TAL_CIPHER_AESNI_CTX_T *)ctx;
+    uint8_t rk[TAL_CIPHER_RK_SIZE], dk[TAL_CIPHER_RK_SIZE];
+    uint32_t i;
+
+    aes->nr = tal_cipher_key_expand(key, keybits, rk, dk);
+    if (0 == aes->nr) {
+        return OPRT_INVALID_PARM;
+    }
+    for (i = 0; i <= aes->nr; i++) {
+        aes->rk[i] = _mm_loadu_si128((const __m128i *)(rk + i * 16));
+        aes->dk[i] = _mm_loadu_si128((const __m128i *)(dk + i * 16));
+    }
+    memset(rk, 0, SIZEOF(rk));
+    memset(dk, 0, SIZEOF(dk));
+
+    aes->h = __aesni_bswap(__aesni_enc1(aes, _mm_setzero_si128()));
+
+    return OPRT_OK;
+}
+
+static void __aesni_clear(void *ctx)
+{
+    memset(ctx, 0, SIZEOF(TAL_CIPHER_AESNI_CTX_T));
+}
+
+AESNI_TARGET static OPERATE_RET __aesni_ecb_encrypt(void *ctx, const uint8_t *in, uint8_t *out, uint32_t blocks)
+{
+    TAL_CIPHER_AESNI_CTX_T *aes = (TAL_CIPHER_AESNI_CTX_T *)ctx;
+    __m128i b0, b1, b2, b3, k;
+    uint32_t r;
+
+    for (; blocks >= 4; blocks -= 4, in += 64, out += 64) {
+        k = aes->rk[0];
+        b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in), k);
+        b1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 16)), k);
+        b2 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 32)), k);
+        b3 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 48)), k);
+        for (r = 1; r < aes->nr; r++) {
+            k = aes->rk[r];
+            b0 = _mm_aesenc_si128(b0, k);
+            b1 = _mm_aesenc_si128(b1, k);
+            b2 = _mm_aesenc_si128(b2, k);
+            b3 = _mm_aesenc_si128(b3, k);
+        }
+        k = aes->rk[aes->nr];
+        _mm_storeu_si128((__m128i *)out, _mm_aesenclast_si128(b0, k));
+        _mm_storeu_si128((__m128i *)(out + 16), _mm_aesenclast_si128(b1, k));
+        _mm_storeu_si128((__m128i *)(out + 32), _mm_aesenclast_si128(b2, k));
+        _mm_storeu_si128((__m128i *)(out + 48), _mm_aesenclast_si128(b3, k));
+    }
+    for (; blocks; blocks--, in += 16, out += 16) {
+        _mm_storeu_si128((__m128i *)out, __aesni_enc1(aes, _mm_loadu_si128((const __m128i *)in)));
+    }
+
+    return OPRT_OK;
+}
+
+AESNI_TARGET static OPERATE_RET __aesni_cbc_encrypt(void *ctx, uint8_t iv[16], const uint8_t *in, uint8_t *out,
+                                                    uint32_t blocks)
+{
+    TAL_CIPHER_AESNI_CTX_T *aes = (TAL_CIPHER_AESNI_CTX_T *)ctx;
+    __m128i c = _mm_loadu_si128((const __m128i *)iv);
+
+    for (; blocks; blocks--, in += 16, out += 16) {
+        c = __aesni_enc1(aes, _mm_xor_si128(c, _mm_loadu_si128((const __m128i *)in)));
+        _mm_storeu_si128((__m128i *)out, c);
+    }
+    _mm_storeu_si128((__m128i *)iv, c);
+
+    return OPRT_OK;
+}
+
+AESNI_TARGET static OPERATE_RET __aesni_cbc_decrypt(void *ctx, uint8_t iv[16], const uint8_t *in, uint8_t *out,
+                                                    uint32_t blocks)
+{
+    TAL_CIPHER_AESNI_CTX_T *aes = (TAL_CIPHER_AESNI_CTX_T *)ctx;
+    __m128i prev = _mm_loadu_si128((const __m128i *)iv);
+    __m128i c0, c1, c2, c3, b0, b1, b2, b3, k;
+    uint32_t r;
+
+    // the ciphertext is loaded before any store, so in place works
+    for (; blocks >= 4; blocks -= 4, in += 64, out += 64) {
+        c0 = _mm_loadu_si128((const __m128i *)in);
+        c1 = _mm_loadu_si128((const __m128i *)(in + 16));
+        c2 = _mm_loadu_si128((const __m128i *)(in + 32));
+        c3 = _mm_loadu_si128((const __m128i *)(in + 48));
+        k = aes->dk[0];
+        b0 = _mm_xor_si128(c0, k);
+        b1 = _mm_xor_si128(c1, k);
+        b2 = _mm_xor_si128(c2, k);
+        b3 = _mm_xor_si128(c3, k);
+        for (r = 1; r < aes->nr; r++) {
+            k = aes->dk[r];
+            b0 = _mm_aesdec_si128(b0, k);
+            b1 = _mm_aesdec_si128(b1, k);
+            b2 = _mm_aesdec_si128(b2, k);
+            b3 = _mm_aesdec_si128(b3, k);
+        }
+        k = aes->dk[aes->nr];
+        _mm_storeu_si128((__m128i *)out, _mm_xor_si128(_mm_aesdeclast_si128(b0, k), prev));
+        _mm_storeu_si128((__m128i *)(out + 16), _mm_xor_si128(_mm_aesdeclast_si128(b1, k), c0));
+        _mm_storeu_si128((__m128i *)(out + 32), _mm_xor_si128(_mm_aesdeclast_si128(b2, k), c1));
+        _mm_storeu_si128((__m128i *)(out + 48), _mm_xor_si128(_mm_aesdeclast_si128(b3, k), c2));
+        prev = c3;
+    }
+    for (; blocks; blocks--, in += 16, out += 16) {
+        c0 = _mm_loadu_si128((const __m128i *)in);
+        _mm_storeu_si128((__m128i *)out, _mm_xor_si128(__aesni_dec1(aes, c0), prev));
+        prev = c0;
+    }
+    _mm_storeu_si128((__m128i *)iv, prev);
+
+    return OPRT_OK;
+}
+
+AESNI_TARGET static void __aesni_ghash(void *ctx, uint8_t y[16], const uint8_t *data, uint32_t blocks)
+{
+    TAL_CIPHER_AESNI_CTX_T *aes = (TAL_CIPHER_AESNI_CTX_T *)ctx;
+    __m128i x = __aesni_bswap(_mm_loadu_si128((const __m128i *)y));
+
+    for (; blocks; blocks--, data += 16) {
+        x = _mm_xor_si128(x, __aesni_bswap(_mm_loadu_si128((const __m128i *)data)));
+        x = __aesni_gfmul(x, aes->h);
+    }
+    _mm_storeu_si128((__m128i *)y, __aesni_bswap(x));
+}
+
+static const TAL_CIPHER_PROVIDER_T s_cipher_aesni = {
+    .name = "aesni",
+    .ctx_size = SIZEOF(TAL_CIPHER_AESNI_CTX_T),
+    .probe = __aesni_probe,
+    .setkey = __aesni_setkey,
+    .clear = __aesni_clear,
+    .ecb_encrypt = __aesni_ecb_encrypt,
+    .cbc_encrypt = __aesni_cbc_encrypt,
+    .cbc_decrypt = __aesni_cbc_decrypt,
+    .ghash = __aesni_ghash,
+};
+
+const TAL_CIPHER_PROVIDER_T *tal_cipher_aesni_provider(void)
+{
+    return &s_cipher_aesni;
+}
+
+#else
+
+const TAL_CIPHER_PROVIDER_T *tal_cipher_aesni_provider(void)
+{
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,202 @@
+/**
+ * @file tal_cipher_armce.c
+ * @brief ARMv8 crypto extension cipher provider for aarch64 hosts.
+ *
+ * Built when the compiler targets the aes extension (-march=armv8-a+crypto),
+ * on linux the hwcap is checked as well before the provider is offered. ECB
+ * and CBC decryption interleave four blocks like the AES-NI provider. GHASH
+ * stays on the portable table.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tuya_iot_config.h"
+#include "tal_cipher.h"
+
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint8x16_t rk[15];
+    uint8x16_t dk[15];
+    uint32_t nr;
+} TAL_CIPHER_ARMCE_CTX_T;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static BOOL_T __armce_probe(void)
+{
+#if defined(__linux__) && defined(HWCAP_AES)
+    return (getauxval(AT_HWCAP) & HWCAP_AES) ? TRUE : FALSE;
+#else
+    return TRUE;
+#endif
+}
+
+static uint8x16_t __armce_enc1(TAL_CIPHER_ARMCE_CTX_T *aes, uint8x16_t b)
+{
+    uint32_t r;
+
+    for (r = 0; r + 1 < aes->nr; r++) {
+        b = vaesmcq_u8(vaeseq_u8(b, aes->rk[r]));
+    }
+    b = vaeseq_u8(b, aes->rk[aes->nr - 1]);
+    return veorq_u8(b, aes->rk[aes->nr]);
+}
+
+static uint8x16_t __armce_dec1(TAL_CIPHER_ARMCE_CTX_T *aes, uint8x16_t b)
+{
+    uint32_t r;
+
+    for (r = 0; r + 1 < aes->nr; r++) {
+        b = vaesimcq_u8(vaesdq_u8(b, aes->dk[r]));
+    }
+    b = vaesdq_u8(b, aes->dk[aes->nr - 1]);
+    return veorq_u8(b, aes->dk[aes->nr]);
+}
+
+static OPERATE_RET __armce_setkey(void *ctx, const uint8_t *key, uint32_t keybits)
+{
+    TAL_CIPHER_ARMCE_CTX_T *aes = (TAL_CIPHER_ARMCE_CTX_T *)ctx;
+    uint8_t rk[TAL_CIPHER_RK_SIZE], dk[TAL_CIPHER_RK_SIZE];
+    uint32_t i;
+
+    aes->nr = tal_cipher_key_expand(key, keybits, rk, dk);
+    if (0 == aes->nr) {
+        return OPRT_INVALID_PARM;
+    }
+    for (i = 0; i <= aes->nr; i++) {
+        aes->rk[i] = vld1q_u8(rk + i * 16);
+        aes->dk[i] = vld1q_u8(dk + i * 16);
+    }
+    memset(rk, 0, SIZEOF(rk));
+    memset(dk, 0, SIZEOF(dk));
+
+    return OPRT_OK;
+}
+
+static void __armce_clear(void *ctx)
+{
+    memset(ctx, 0, SIZEOF(TAL_CIPHER_ARMCE_CTX_T));
+}
+
+static OPERATE_RET __armce_ecb_encrypt(void *ctx, const uint8_t *in, uint8_t *out, uint32_t blocks)
+{
+    TAL_CIPHER_ARMCE_CTX_T *aes = (TAL_CIPHER_ARMCE_CTX_T *)ctx;
+    uint8x16_t b0, b1, b2, b3, k;
+    uint32_t r;
+
+    for (; blocks >= 4; blocks -= 4, in += 64, out += 64) {
+        b0 = vld1q_u8(in);
+        b1 = vld1q_u8(in + 16);
+        b2 = vld1q_u8(in + 32);
+        b3 = vld1q_u8(in + 48);
+        for (r = 0; r + 1 < aes->nr; r++) {
+            k = aes->rk[r];
+            b0 = vaesmcq_u8(vaeseq_u8(b0, k));
+            b1 = vaesmcq_u8(vaeseq_u8(b1, k));
+            b2 = vaesmcq_u8(vaeseq_u8(b2, k));
+            b3 = vaesmcq_u8(vaeseq_u8(b3, k));
+        }
+        k = aes->rk[aes->nr - 1];
+        vst1q_u8(out, veorq_u8(vaeseq_u8(b0, k), aes->rk[aes->nr]));
+        vst1q_u8(out + 16, veorq_u8(vaeseq_u8(b1, k), aes->rk[aes->nr]));
+        vst1q_u8(out + 32, veorq_u8(vaeseq_u8(b2, k), aes->rk[aes->nr]));
+        vst1q_u8(out + 48, veorq_u8(vaeseq_u8(b3, k), aes->rk[aes->nr]));
+    }
+    for (; blocks; blocks--, in += 16, out += 16) {
+        vst1q_u8(out, __armce_enc1(aes, vld1q_u8(in)));
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __armce_cbc_encrypt(void *ctx, uint8_t iv[16], const uint8_t *in, uint8_t *out, uint32_t blocks)
+{
+    TAL_CIPHER_ARMCE_CTX_T *aes = (TAL_CIPHER_ARMCE_CTX_T *)ctx;
+    uint8x16_t c = vld1q_u8(iv);
+
+    for (; blocks; blocks--, in += 16, out += 16) {
+        c = __armce_enc1(aes, veorq_u8(c, vld1q_u8(in)));
+        vst1q_u8(out, c);
+    }
+    vst1q_u8(iv, c);
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __armce_cbc_decrypt(void *ctx, uint8_t iv[16], const uint8_t *in, uint8_t *out, uint32_t blocks)
+{
+    TAL_CIPHER_ARMCE_CTX_T *aes = (TAL_CIPHER_ARMCE_CTX_T *)ctx;
+    uint8x16_t prev = vld1q_u8(iv);
+    uint8x16_t c0, c1, c2, c3, b0, b1, b2, b3, k;
+    uint32_t r;
+
+    for (; blocks >= 4; blocks -= 4, in += 64, out += 64) {
+        b0 = c0 = vld1q_u8(in);
+        b1 = c1 = vld1q_u8(in + 16);
+        b2 = c2 = vld1q_u8(in + 32);
+        b3 = c3 = vld1q_u8(in + 48);
+        for (r = 0; r + 1 < aes->nr; r++) {
+            k = aes->dk[r];
+            b0 = vaesimcq_u8(vaesdq_u8(b0, k));
+            b1 = vaesimcq_u8(vaesdq_u8(b1, k));
+            b2 = vaesimcq_u8(vaesdq_u8(b2, k));
+            b3 = vaesimcq_u8(vaesdq_u8(b3, k));
+        }
+        k = aes->dk[aes->nr - 1];
+        b0 = veorq_u8(vaesdq_u8(b0, k), aes->dk[aes->nr]);
+        b1 = veorq_u8(vaesdq_u8(b1, k), aes->dk[aes->nr]);
+        b2 = veorq_u8(vaesdq_u8(b2, k), aes->dk[aes->nr]);
+        b3 = veorq_u8(vaesdq_u8(b3, k), aes->dk[aes->nr]);
+        vst1q_u8(out, veorq_u8(b0, prev));
+        vst1q_u8(out + 16, veorq_u8(b1, c0));
+        vst1q_u8(out + 32, veorq_u8(b2, c1));
+        vst1q_u8(out + 48, veorq_u8(b3, c2));
+        prev = c3;
+    }
+    for (; blocks; blocks--, in += 16, out += 16) {
+        c0 = vld1q_u8(in);
+        vst1q_u8(out, veorq_u8(__armce_dec1(aes, c0), prev));
+        prev = c0;
+    }
+    vst1q_u8(iv, prev);
+
+    return OPRT_OK;
+}
+
+static const TAL_CIPHER_PROVIDER_T s_cipher_armce = {
+    .name = "armce",
+    .ctx_size = SIZEOF(TAL_CIPHER_ARMCE_CTX_T),
+    .probe = __armce_probe,
+    .setkey = __armce_setkey,
+    .clear = __armce_clear,
+    .ecb_encrypt = __armce_ecb_encrypt,
+    .cbc_encrypt = __armce_cbc_encrypt,
+    .cbc_decrypt = __armce_cbc_decrypt,
+    .ghash = NULL,
+};
+
+const TAL_CIPHER_PROVIDER_T *tal_cipher_armce_provider(void)
+{
+    return &s_cipher_armce;
+}
+
+#else
+
+const TAL_CIPHER_PROVIDER_T *tal_cipher_armce_provider(void)
+{
+    return NULL;
+}
+
+#endif
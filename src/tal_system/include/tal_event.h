@@ -31,6 +31,7 @@
 #include "tuya_list.h"
 #include "tal_event_info.h"
 #include "tal_mutex.h"
+#include "tal_workqueue.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -50,6 +51,14 @@ extern "C" {
  */
 #define EVENT_DESC_MAX_LEN (32)
 
+/**
+ * @brief bucket number of the event name hash index, must be power of 2
+ *
+ */
+#ifndef EVENT_HASH_BUCKET_NUM
+#define EVENT_HASH_BUCKET_NUM (32)
+#endif
+
 /**
  * @brief subscriber type
  *
@@ -86,9 +95,47 @@ typedef struct {
     char desc[EVENT_DESC_MAX_LEN + 1]; // description, used to record the subscribe info
     SUBSCRIBE_TYPE_E type;             // the subscribe type
     EVENT_SUBSCRIBE_CB cb;             // the subscribe callback function
+    void *defer;                       // deferred dispatch context, NULL means call in publisher thread
     struct tuya_list_head node;        // list node, used to attch to the event node
 } SUBSCRIBE_NODE_T;
 
+/**
+ * @brief the deferred dispatch config, the callback runs in the workqueue
+ *
+ */
+typedef struct {
+    WORKQUEUE_HANDLE workq; // the workqueue to run the subscribe callback
+    uint16_t data_len;      // bytes of event data copied on publish, 0 means pass the data pointer as is
+} EVENT_DEFER_CFG_T;
+
+/**
+ * @brief the deferred dispatch statistics of one subscriber
+ *
+ */
+typedef struct {
+    uint32_t post_cnt;    // publish count delivered to this subscriber
+    uint32_t run_cnt;     // callback count
+    uint32_t drop_cnt;    // data replaced by a newer publish or failed to schedule
+    uint32_t latency_avg; // average ms from publish to callback
+    uint32_t latency_max; // max ms from publish to callback
+} EVENT_DEFER_STAT_T;
+
+/**
+ * @brief the read-only copy of the subscriber list used by publish
+ *
+ */
+typedef struct {
+    EVENT_SUBSCRIBE_CB cb; // the subscribe callback function
+    void *defer;           // deferred dispatch context
+} SUBSCRIBE_ENTRY_T;
+
+typedef struct {
+    int ref_cnt;              // reference count, protected by the event mutex
+    int sub_cnt;              // subscriber number
+    int onetime_cnt;          // one-time subscriber number
+    SUBSCRIBE_ENTRY_T sub[0]; // subscriber in dispatch order
+} SUBSCRIBE_SNAPSHOT_T;
+
 /**
  * @brief the event node
  *
@@ -97,8 +144,11 @@ typedef struct {
     MUTEX_HANDLE mutex; // mutex, protection the event publish and subscribe
 
     char name[EVENT_NAME_MAX_LEN + 1];    // name, the event name
+    uint32_t hash;                        // hash of the event name
     struct tuya_list_head node;           // list node, used to attach to the event manage module
+    struct tuya_list_head hash_node;      // list node, used to attach to the hash bucket
     struct tuya_list_head subscribe_root; // subscibe root, used to manage the subscriber
+    SUBSCRIBE_SNAPSHOT_T *snapshot;       // copy of subscribe root, NULL means need rebuild
 } EVENT_NODE_T;
 
 /**
@@ -112,8 +162,15 @@ typedef struct {
     struct tuya_list_head event_root;          // event root, used to manage the event
     struct tuya_list_head free_subscribe_root; // free subscriber list, used to manage the
                                                // subscribe which not found the event
+    struct tuya_list_head hash_root[EVENT_HASH_BUCKET_NUM]; // hash index of the event name
 } EVENT_MANAGE_T;
 
+/**
+ * @brief the event handle, resolved once by name and valid forever
+ *
+ */
+typedef void *EVENT_HANDLE;
+
 /**
  * @brief event initialization
  *
@@ -155,6 +212,80 @@ OPERATE_RET tal_event_subscribe(const char *name, const char *desc, const EVENT_
  */
 OPERATE_RET tal_event_unsubscribe(const char *name, const char *desc, EVENT_SUBSCRIBE_CB cb);
 
+/**
+ * @brief: subscribe event, the callback will be called in the workqueue
+ *
+ * @param[in] name: event name
+ * @param[in] desc: subscribe description
+ * @param[in] cb: subscribe callback function
+ * @param[in] type: subscribe type
+ * @param[in] cfg: deferred dispatch config
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ *
+ * @note only the latest data is kept when the callback is not running in time,
+ * publisher will not be blocked by the subscriber.
+ */
+OPERATE_RET tal_event_subscribe_deferred(const char *name, const char *desc, const EVENT_SUBSCRIBE_CB cb,
+                                         SUBSCRIBE_TYPE_E type, const EVENT_DEFER_CFG_T *cfg);
+
+/**
+ * @brief: get the deferred dispatch statistics of the subscriber
+ *
+ * @param[in] name: event name
+ * @param[in] desc: subscribe description
+ * @param[in] cb: subscribe callback function
+ * @param[out] stat: the statistics
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_event_subscribe_stat_get(const char *name, const char *desc, EVENT_SUBSCRIBE_CB cb,
+                                         EVENT_DEFER_STAT_T *stat);
+
+/**
+ * @brief: get the event handle by name, the event will be created if not exist
+ *
+ * @param[in] name: event name
+ * @param[out] handle: event handle
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_event_handle_get(const char *name, EVENT_HANDLE *handle);
+
+/**
+ * @brief: publish event by handle
+ *
+ * @param[in] handle: event handle
+ * @param[in] data: event data
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_event_publish_by_handle(EVENT_HANDLE handle, void *data);
+
+/**
+ * @brief: subscribe event by handle
+ *
+ * @param[in] handle: event handle
+ * @param[in] desc: subscribe description
+ * @param[in] cb: subscribe callback function
+ * @param[in] type: subscribe type
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_event_subscribe_by_handle(EVENT_HANDLE handle, const char *desc, const EVENT_SUBSCRIBE_CB cb,
+                                          SUBSCRIBE_TYPE_E type);
+
+/**
+ * @brief: unsubscribe event by handle
+ *
+ * @param[in] handle: event handle
+ * @param[in] desc: subscribe description
+ * @param[in] cb: subscribe callback function
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_event_unsubscribe_by_handle(EVENT_HANDLE handle, const char *desc, EVENT_SUBSCRIBE_CB cb);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -148,6 +148,14 @@ OPERATE_RET tal_log_print_secure(BOOL_T is_const_fmt, const TAL_LOG_LEVEL_E leve
 // prototype of log output function
 typedef void (*TAL_LOG_OUTPUT_CB)(const char *str);
 
+// statistics of asynchronous log output
+typedef struct {
+    uint32_t ring_used; // threads which own a log ring
+    uint32_t rec_cnt;   // records formatted by the log thread
+    uint32_t drop_cnt;  // records dropped because the ring was full
+    uint32_t sync_cnt;  // records printed in caller context (no free ring / unsupported format / too large)
+} TAL_LOG_ASYNC_STAT_T;
+
 /***********************************************************************
  ********************* variable ****************************************
  **********************************************************************/
@@ -388,6 +396,55 @@ void tal_log_color_set(const TAL_LOG_LEVEL_E level, TAL_LOG_DISPLAY_MODE_E displ
 OPERATE_RET tal_log_color_print_raw(TAL_LOG_DISPLAY_MODE_E display_mode, TAL_LOG_FONT_COLOR_E font_color,
                                     TAL_LOG_BACKGROUND_COLOR_E background_color, const char *pFmt, ...);
 
+/**
+ * @brief start asynchronous log output
+ *
+ * @param[in] stack_size stack size of the log thread, 0 means default
+ *
+ * @note After started, PR_XXX logs with a constant format only push a binary
+ * record (format pointer, args, level, timestamp) into a ring owned by the
+ * calling thread, the log thread formats and outputs them. String args are
+ * copied into the record. Raw logs and tal_log_print are still synchronous.
+ * Need ENABLE_LOG_ASYNC.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_log_async_start(uint32_t stack_size);
+
+/**
+ * @brief stop asynchronous log output, pending records are flushed
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_log_async_stop(void);
+
+/**
+ * @brief wait until all pending records are output
+ *
+ * @param[in] timeout_ms max time to wait
+ *
+ * @return OPRT_OK on success, OPRT_TIMEOUT if records are still pending
+ */
+OPERATE_RET tal_log_async_flush(uint32_t timeout_ms);
+
+/**
+ * @brief get statistics of asynchronous log output
+ *
+ * @param[out] stat statistics
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_log_async_stat_get(TAL_LOG_ASYNC_STAT_T *stat);
+
+/**
+ * @brief give up the log ring of the calling thread, pending records are still
+ * output. Called by tal_thread when a thread it created exits.
+ */
+void tal_log_async_thread_exit(void);
+
 #ifdef __cplusplus
 }
 #endif /* __TAL_LOG_H__ */
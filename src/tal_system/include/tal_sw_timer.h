@@ -180,6 +180,20 @@ OPERATE_RET tal_sw_timer_release(void);
  */
 int tal_sw_timer_get_num(void);
 
+/**
+ * @brief Benchmark the software timer backend with start/stop/expire churn
+ *
+ * @param[in] timer_num: timer count, such as 10/100/1000
+ * @param[in] rounds: start/stop churn rounds
+ *
+ * @note Available when ENABLE_SW_TIMER_BENCHMARK is defined, run it on builds
+ * with and without ENABLE_SW_TIMER_WHEEL to compare the backends.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_sw_timer_benchmark(uint32_t timer_num, uint32_t rounds);
+
 #ifdef __cplusplus
 }
 #endif
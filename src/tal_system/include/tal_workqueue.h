@@ -39,6 +39,41 @@ typedef struct {
 } WORK_ITEM_T;
 typedef BOOL_T (*WORKQUEUE_TRAVERSE_CB)(WORK_ITEM_T *item, void *ctx);
 
+/**
+ * @brief priority lane of the multi-worker workqueue
+ */
+typedef enum {
+    WORKQ_PRIO_HIGH = 0,
+    WORKQ_PRIO_NORMAL,
+    WORKQ_PRIO_LOW,
+    WORKQ_PRIO_NUM,
+} WORKQ_PRIO_E;
+
+// handle of a scheduled work, used to cancel it in O(1), 0 is invalid
+typedef uint32_t WORK_HANDLE;
+
+#define WORKQ_WORKER_MAX         8
+#define WORKQ_BATCH_MAX          8
+#define WORKQ_LATENCY_BUCKET_NUM 8 // <1, <5, <10, <50, <100, <500, <1000, >=1000 ms
+
+typedef struct {
+    uint8_t worker_num;      // worker thread number, 1 ~ WORKQ_WORKER_MAX
+    uint8_t batch_num;       // max items dequeued by one wake-up, 1 ~ WORKQ_BATCH_MAX
+    uint16_t queue_len;      // the maximum number of items that the workqueue can contain
+    THREAD_CFG_T thread_cfg; // thread param of every worker
+} WORKQUEUE_MULTI_CFG_T;
+
+typedef struct {
+    uint16_t depth[WORKQ_PRIO_NUM];                 // current items of each lane
+    uint16_t depth_max;                             // max items ever queued
+    uint32_t done_cnt;                              // executed items
+    uint32_t cancel_cnt;                            // canceled items
+    uint32_t latency_hist[WORKQ_LATENCY_BUCKET_NUM]; // queued ms before execution
+    uint8_t worker_num;
+    WORKQUEUE_CB last_cb[WORKQ_WORKER_MAX]; // running callback of each worker, NULL when idle
+    uint32_t run_ms[WORKQ_WORKER_MAX];      // ms the running callback has taken
+} WORKQUEUE_STAT_T;
+
 /**
  * @brief create and initialize a workqueue which runs in thread context
  *
@@ -52,6 +87,56 @@ typedef BOOL_T (*WORKQUEUE_TRAVERSE_CB)(WORK_ITEM_T *item, void *ctx);
  */
 OPERATE_RET tal_workqueue_create(const uint16_t queue_len, THREAD_CFG_T *thread_cfg, WORKQUEUE_HANDLE *handle);
 
+/**
+ * @brief create a workqueue with multiple worker threads and priority lanes
+ *
+ * @param[in] cfg the workqueue config
+ * @param[out] handle the workqueue handle
+ *
+ * @note the handle can be used by all tal_workqueue_* APIs, schedule goes to
+ * WORKQ_PRIO_NORMAL and schedule_instant goes to the head of WORKQ_PRIO_HIGH.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_create_multi(const WORKQUEUE_MULTI_CFG_T *cfg, WORKQUEUE_HANDLE *handle);
+
+/**
+ * @brief put work task in the priority lane of a multi-worker workqueue
+ *
+ * @param[in] handle the workqueue handle
+ * @param[in] cb the work callback
+ * @param[in] data the work data
+ * @param[in] prio the priority lane
+ * @param[out] work handle used to cancel the work, can be NULL
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_schedule_prio(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb, void *data, WORKQ_PRIO_E prio,
+                                        WORK_HANDLE *work);
+
+/**
+ * @brief cancel the work by handle
+ *
+ * @param[in] handle the workqueue handle
+ * @param[in] work the work handle
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND if the work has been dequeued.
+ */
+OPERATE_RET tal_workqueue_cancel_work(WORKQUEUE_HANDLE handle, WORK_HANDLE work);
+
+/**
+ * @brief get the statistics of a multi-worker workqueue
+ *
+ * @param[in] handle the workqueue handle
+ * @param[out] stat the statistics
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_stat_get(WORKQUEUE_HANDLE handle, WORKQUEUE_STAT_T *stat);
+
 /**
  * @brief put work task in workqueue
  *
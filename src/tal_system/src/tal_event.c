@@ -19,6 +19,9 @@
  * - Event node creation and initialization
  * - Subscription management (addition, deletion, retrieval)
  * - Event dispatching to subscribed listeners
+ * - Hash index and handle based access to avoid repeated name lookup
+ * - Copy-on-write subscriber snapshot, callbacks run without the event lock
+ * - Deferred dispatch to a workqueue with latest-data coalescing
  * - Thread-safe operations through mutex locking
  * - Debugging utilities for event and subscription dumping
  *
@@ -36,6 +39,26 @@
 
 static EVENT_MANAGE_T g_event_manager = {0};
 
+/**
+ * @brief the deferred dispatch context, protected by the event mutex
+ *
+ */
+typedef struct {
+    EVENT_NODE_T *event;
+    EVENT_SUBSCRIBE_CB cb;
+    WORKQUEUE_HANDLE workq;
+    int ref_cnt;      // hold by subscribe node, snapshot and scheduled work
+    BOOL_T removed;   // unsubscribed, drop the pending data
+    BOOL_T pending;   // new data wait for callback
+    BOOL_T scheduled; // work is in the workqueue or running
+    SYS_TIME_T post_ms;
+    uint64_t latency_sum;
+    EVENT_DEFER_STAT_T stat;
+    void *data;        // pending data pointer
+    uint16_t data_len; // copy data into buf[0, data_len) when not zero, callback use the second half
+    uint8_t buf[0];
+} EVENT_DEFER_T;
+
 BOOL_T _event_name_is_valid(const char *name)
 {
     if (!name) {
@@ -62,8 +85,39 @@ BOOL_T _event_desc_is_valid(const char *desc)
     return TRUE;
 }
 
+static uint32_t _event_name_hash(const char *name)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+
+    while (*name) {
+        hash ^= (uint8_t)(*name++);
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static EVENT_NODE_T *_event_node_find(const char *name, uint32_t hash)
+{
+    EVENT_NODE_T *entry = NULL;
+    struct tuya_list_head *pos = NULL;
+    tuya_list_for_each(pos, &g_event_manager.hash_root[hash & (EVENT_HASH_BUCKET_NUM - 1)])
+    {
+        // find by hash first, then by name
+        entry = tuya_list_entry(pos, EVENT_NODE_T, hash_node);
+        if (entry->hash == hash && 0 == strcmp(entry->name, name)) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
 EVENT_NODE_T *_event_node_create_init(const char *name)
 {
+    EVENT_NODE_T *exist = NULL;
+
     // allocate memory
     EVENT_NODE_T *event = tal_malloc(sizeof(EVENT_NODE_T));
     TUYA_CHECK_NULL_RETURN(event, NULL);
@@ -72,11 +126,21 @@ EVENT_NODE_T *_event_node_create_init(const char *name)
     // initialze the event node
     memcpy(event->name, name, strlen(name));
     event->name[strlen(name)] = '\0';
+    event->hash = _event_name_hash(event->name);
     INIT_LIST_HEAD(&event->subscribe_root);
     tal_mutex_create_init(&event->mutex);
 
     tal_mutex_lock(g_event_manager.mutex);
 
+    // the event maybe created by others at the same time
+    exist = _event_node_find(event->name, event->hash);
+    if (exist) {
+        tal_mutex_unlock(g_event_manager.mutex);
+        tal_mutex_release(event->mutex);
+        tal_free(event);
+        return exist;
+    }
+
     // need check if there have free subscriber which subscribe this event
     struct tuya_list_head *free_pos = NULL;
     struct tuya_list_head *free_next = NULL;
@@ -98,8 +162,9 @@ EVENT_NODE_T *_event_node_create_init(const char *name)
         }
     }
 
-    // at last, need add this event to event manage root
+    // at last, need add this event to event manage root and hash index
     tuya_list_add_tail(&event->node, &g_event_manager.event_root);
+    tuya_list_add_tail(&event->hash_node, &g_event_manager.hash_root[event->hash & (EVENT_HASH_BUCKET_NUM - 1)]);
     g_event_manager.event_cnt++;
 
     tal_mutex_unlock(g_event_manager.mutex);
@@ -109,19 +174,8 @@ EVENT_NODE_T *_event_node_create_init(const char *name)
 
 EVENT_NODE_T *_event_node_get(const char *name)
 {
-    // try to get event from event root
-    EVENT_NODE_T *entry = NULL;
-    struct tuya_list_head *pos = NULL;
-    tuya_list_for_each(pos, &g_event_manager.event_root)
-    {
-        // find by name
-        entry = tuya_list_entry(pos, EVENT_NODE_T, node);
-        if (0 == strcmp(entry->name, name)) {
-            return entry;
-        }
-    }
-
-    return NULL;
+    // try to get event from the hash index
+    return _event_node_find(name, _event_name_hash(name));
 }
 
 SUBSCRIBE_NODE_T *_event_node_get_free_subscribe(SUBSCRIBE_NODE_T *subscribe)
@@ -157,6 +211,172 @@ SUBSCRIBE_NODE_T *_event_node_get_subscribe(EVENT_NODE_T *event, SUBSCRIBE_NODE_
     return NULL;
 }
 
+static void _event_defer_put(EVENT_DEFER_T *defer)
+{
+    if (--defer->ref_cnt == 0) {
+        tal_free(defer);
+    }
+}
+
+static void _event_subscribe_free(SUBSCRIBE_NODE_T *entry)
+{
+    if (entry->defer) {
+        _event_defer_put((EVENT_DEFER_T *)entry->defer);
+    }
+    tal_free(entry);
+}
+
+static void _event_defer_work_cb(void *data)
+{
+    EVENT_DEFER_T *defer = (EVENT_DEFER_T *)data;
+    EVENT_NODE_T *event = defer->event;
+    void *cb_data = NULL;
+    uint32_t latency = 0;
+
+    tal_mutex_lock(event->mutex);
+    while (defer->pending && !defer->removed) {
+        defer->pending = FALSE;
+        cb_data = defer->data;
+        if (defer->data_len) {
+            memcpy(defer->buf + defer->data_len, defer->buf, defer->data_len);
+            cb_data = defer->buf + defer->data_len;
+        }
+        latency = (uint32_t)(tal_system_get_millisecond() - defer->post_ms);
+        defer->latency_sum += latency;
+        if (latency > defer->stat.latency_max) {
+            defer->stat.latency_max = latency;
+        }
+        defer->stat.run_cnt++;
+        tal_mutex_unlock(event->mutex);
+
+        defer->cb(cb_data);
+
+        tal_mutex_lock(event->mutex);
+    }
+    defer->scheduled = FALSE;
+    _event_defer_put(defer);
+    tal_mutex_unlock(event->mutex);
+}
+
+// must be called in event mutex lock
+static OPERATE_RET _event_defer_post(EVENT_DEFER_T *defer, void *data)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (defer->removed) {
+        return OPRT_OK;
+    }
+
+    defer->stat.post_cnt++;
+    if (defer->pending) {
+        // only keep the latest data
+        defer->stat.drop_cnt++;
+    } else {
+        defer->pending = TRUE;
+        defer->post_ms = tal_system_get_millisecond();
+    }
+
+    defer->data = data;
+    if (defer->data_len) {
+        if (data) {
+            memcpy(defer->buf, data, defer->data_len);
+        } else {
+            memset(defer->buf, 0, defer->data_len);
+        }
+    }
+
+    if (!defer->scheduled) {
+        rt = tal_workqueue_schedule(defer->workq, _event_defer_work_cb, defer);
+        if (OPRT_OK != rt) {
+            defer->pending = FALSE;
+            defer->stat.drop_cnt++;
+            return rt;
+        }
+        defer->scheduled = TRUE;
+        defer->ref_cnt++;
+    }
+
+    return rt;
+}
+
+static void _event_node_snapshot_put(SUBSCRIBE_SNAPSHOT_T *snapshot)
+{
+    int i = 0;
+
+    if (--snapshot->ref_cnt == 0) {
+        for (i = 0; i < snapshot->sub_cnt; i++) {
+            if (snapshot->sub[i].defer) {
+                _event_defer_put((EVENT_DEFER_T *)snapshot->sub[i].defer);
+            }
+        }
+        tal_free(snapshot);
+    }
+}
+
+// subscriber list changed, the snapshot will be rebuilt on next publish
+static void _event_node_snapshot_invalidate(EVENT_NODE_T *event)
+{
+    if (event->snapshot) {
+        _event_node_snapshot_put(event->snapshot);
+        event->snapshot = NULL;
+    }
+}
+
+// must be called in event mutex lock, the onetime subscriber will be claimed by the caller
+static SUBSCRIBE_SNAPSHOT_T *_event_node_snapshot_get(EVENT_NODE_T *event)
+{
+    struct tuya_list_head *p = NULL;
+    struct tuya_list_head *n = NULL;
+    SUBSCRIBE_NODE_T *entry = NULL;
+    SUBSCRIBE_SNAPSHOT_T *snapshot = event->snapshot;
+    int cnt = 0;
+
+    if (NULL == snapshot) {
+        tuya_list_for_each(p, &event->subscribe_root)
+        {
+            cnt++;
+        }
+
+        snapshot = tal_malloc(sizeof(SUBSCRIBE_SNAPSHOT_T) + cnt * sizeof(SUBSCRIBE_ENTRY_T));
+        TUYA_CHECK_NULL_RETURN(snapshot, NULL);
+        memset(snapshot, 0, sizeof(SUBSCRIBE_SNAPSHOT_T));
+
+        tuya_list_for_each(p, &event->subscribe_root)
+        {
+            entry = tuya_list_entry(p, SUBSCRIBE_NODE_T, node);
+            if (entry->type == SUBSCRIBE_TYPE_ONETIME) {
+                snapshot->onetime_cnt++;
+            }
+            if (entry->defer) {
+                ((EVENT_DEFER_T *)entry->defer)->ref_cnt++;
+            }
+            snapshot->sub[snapshot->sub_cnt].cb = entry->cb;
+            snapshot->sub[snapshot->sub_cnt].defer = entry->defer;
+            snapshot->sub_cnt++;
+        }
+
+        snapshot->ref_cnt = 1;
+        event->snapshot = snapshot;
+    }
+
+    snapshot->ref_cnt++;
+
+    // one-time subscriber only belongs to this publish
+    if (snapshot->onetime_cnt) {
+        tuya_list_for_each_safe(p, n, &event->subscribe_root)
+        {
+            entry = tuya_list_entry(p, SUBSCRIBE_NODE_T, node);
+            if (entry->type == SUBSCRIBE_TYPE_ONETIME) {
+                tuya_list_del(&entry->node);
+                _event_subscribe_free(entry);
+            }
+        }
+        _event_node_snapshot_invalidate(event);
+    }
+
+    return snapshot;
+}
+
 OPERATE_RET _event_node_dispatch(EVENT_NODE_T *event, void *data)
 {
     OPERATE_RET rt = OPRT_OK;
@@ -169,18 +389,62 @@ OPERATE_RET _event_node_dispatch(EVENT_NODE_T *event, void *data)
     {
         // find and call cb one by one
         entry = tuya_list_entry(p, SUBSCRIBE_NODE_T, node);
-        if (entry->cb) {
+        if (entry->defer) {
+            TUYA_CALL_ERR_LOG(_event_defer_post((EVENT_DEFER_T *)entry->defer, data));
+        } else if (entry->cb) {
             TUYA_CALL_ERR_LOG(entry->cb(data));
         }
 
         // one-time event should be removed after dispatch
         if (entry->type == SUBSCRIBE_TYPE_ONETIME) {
             tuya_list_del(&entry->node);
-            tal_free(entry);
+            _event_subscribe_free(entry);
             entry = NULL;
+            _event_node_snapshot_invalidate(event);
+        }
+    }
+
+    return rt;
+}
+
+OPERATE_RET _event_node_publish(EVENT_NODE_T *event, void *data)
+{
+    OPERATE_RET rt = OPRT_OK;
+    SUBSCRIBE_SNAPSHOT_T *snapshot = NULL;
+    int i = 0;
+
+    tal_mutex_lock(event->mutex);
+
+    if (tuya_list_empty(&event->subscribe_root)) {
+        tal_mutex_unlock(event->mutex);
+        return OPRT_OK;
+    }
+
+    snapshot = _event_node_snapshot_get(event);
+    if (NULL == snapshot) {
+        // no memory to copy the subscriber, dispatch in lock
+        TUYA_CALL_ERR_LOG(_event_node_dispatch(event, data));
+        tal_mutex_unlock(event->mutex);
+        return rt;
+    }
+
+    tal_mutex_unlock(event->mutex);
+
+    // dispatch without lock, slow subscriber will not block others
+    for (i = 0; i < snapshot->sub_cnt; i++) {
+        if (snapshot->sub[i].defer) {
+            tal_mutex_lock(event->mutex);
+            TUYA_CALL_ERR_LOG(_event_defer_post((EVENT_DEFER_T *)snapshot->sub[i].defer, data));
+            tal_mutex_unlock(event->mutex);
+        } else if (snapshot->sub[i].cb) {
+            TUYA_CALL_ERR_LOG(snapshot->sub[i].cb(data));
         }
     }
 
+    tal_mutex_lock(event->mutex);
+    _event_node_snapshot_put(snapshot);
+    tal_mutex_unlock(event->mutex);
+
     return rt;
 }
 
@@ -224,6 +488,7 @@ OPERATE_RET _event_node_add_subscribe(EVENT_NODE_T *event, SUBSCRIBE_NODE_T *sub
     } else {
         tuya_list_add_tail(&new_entry->node, &event->subscribe_root);
     }
+    _event_node_snapshot_invalidate(event);
 
     return rt;
 }
@@ -255,10 +520,14 @@ OPERATE_RET _event_node_del_subscribe(EVENT_NODE_T *event, SUBSCRIBE_NODE_T *sub
         return OPRT_OK;
     }
 
-    // dont forget remove and free
+    // dont forget remove and free, the pending deferred data is dropped too
     tuya_list_del(&new_entry->node);
-    tal_free(new_entry);
+    if (new_entry->defer) {
+        ((EVENT_DEFER_T *)new_entry->defer)->removed = TRUE;
+    }
+    _event_subscribe_free(new_entry);
     new_entry = NULL;
+    _event_node_snapshot_invalidate(event);
     return rt;
 }
 
@@ -337,6 +606,9 @@ OPERATE_RET tal_event_init(void)
 
     INIT_LIST_HEAD(&g_event_manager.event_root);
     INIT_LIST_HEAD(&g_event_manager.free_subscribe_root);
+    for (int i = 0; i < EVENT_HASH_BUCKET_NUM; i++) {
+        INIT_LIST_HEAD(&g_event_manager.hash_root[i]);
+    }
     tal_mutex_create_init(&g_event_manager.mutex);
     g_event_manager.event_cnt = 0;
     g_event_manager.inited = TRUE;
@@ -359,6 +631,10 @@ OPERATE_RET tal_event_init(void)
  * subscribers fail, the function continues dispatching the event but returns a
  * failed status to record the execution status.
  *
+ * @note Subscribers are called on a snapshot of the subscriber list without
+ * holding the event lock, so a subscriber removed during a publish may still
+ * be called once by that publish.
+ *
  * @param[in] name The name of the event to publish.
  * @param[in] data The data associated with the event.
  * @return The operation result. Returns OPRT_OK on success, or an error code on
@@ -382,14 +658,10 @@ OPERATE_RET tal_event_publish(const char *name, void *data)
         TUYA_CHECK_NULL_RETURN(event, OPRT_MALLOC_FAILED);
     }
 
-    // to keep the consistency, dispatch will done in mutex lock
-    tal_mutex_lock(event->mutex);
     // try to dispatch event to all subscribe
     // if one of the subscribe failed, it will continue but will return failed
     // to record the execute status
-    TUYA_CALL_ERR_LOG(_event_node_dispatch(event, data));
-
-    tal_mutex_unlock(event->mutex);
+    TUYA_CALL_ERR_LOG(_event_node_publish(event, data));
 
     return rt;
 }
@@ -502,3 +774,249 @@ OPERATE_RET tal_event_unsubscribe(const char *name, const char *desc, EVENT_SUBS
 
     return rt;
 }
+
+/**
+ * @brief Subscribes to an event with deferred dispatch.
+ *
+ * The callback is called in the given workqueue instead of the publisher
+ * thread, so publish returns without waiting for this subscriber. If the
+ * callback is still pending when the event is published again, only the latest
+ * data is kept and the drop counter is increased.
+ *
+ * @param name The name of the event to subscribe to.
+ * @param desc The description of the event.
+ * @param cb The callback function to be called when the event is triggered.
+ * @param type The type of subscription.
+ * @param cfg The deferred dispatch config.
+ * @return The result of the operation.
+ *         - OPRT_OK: Operation successful.
+ *         - OPRT_INVALID_PARM: Invalid callback or config.
+ *         - OPRT_BASE_EVENT_INVALID_EVENT_DESC: Invalid event description.
+ *         - OPRT_BASE_EVENT_INVALID_EVENT_NAME: Invalid event name.
+ */
+OPERATE_RET tal_event_subscribe_deferred(const char *name, const char *desc, const EVENT_SUBSCRIBE_CB cb,
+                                         SUBSCRIBE_TYPE_E type, const EVENT_DEFER_CFG_T *cfg)
+{
+    if (NULL == cb || NULL == cfg || NULL == cfg->workq) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (!_event_desc_is_valid(desc)) {
+        return OPRT_BASE_EVENT_INVALID_EVENT_DESC;
+    }
+
+    OPERATE_RET rt = OPRT_OK;
+    EVENT_HANDLE handle = NULL;
+    TUYA_CALL_ERR_RETURN(tal_event_handle_get(name, &handle));
+
+    EVENT_NODE_T *event = (EVENT_NODE_T *)handle;
+    SUBSCRIBE_NODE_T subscribe = {0};
+    subscribe.cb = cb;
+    subscribe.type = type;
+    memcpy(subscribe.name, event->name, strlen(event->name));
+    memcpy(subscribe.desc, desc, strlen(desc));
+
+    EVENT_DEFER_T *defer = tal_malloc(sizeof(EVENT_DEFER_T) + 2 * cfg->data_len);
+    TUYA_CHECK_NULL_RETURN(defer, OPRT_MALLOC_FAILED);
+    memset(defer, 0, sizeof(EVENT_DEFER_T));
+    defer->event = event;
+    defer->cb = cb;
+    defer->workq = cfg->workq;
+    defer->data_len = cfg->data_len;
+    defer->ref_cnt = 1;
+    subscribe.defer = defer;
+
+    tal_mutex_lock(event->mutex);
+    if (_event_node_get_subscribe(event, &subscribe)) {
+        // existed, keep the old one
+        tal_free(defer);
+    } else {
+        TUYA_CALL_ERR_LOG(_event_node_add_subscribe(event, &subscribe));
+        if (OPRT_OK != rt) {
+            tal_free(defer);
+        }
+    }
+    tal_mutex_unlock(event->mutex);
+
+    return rt;
+}
+
+/**
+ * @brief Gets the deferred dispatch statistics of a subscriber.
+ *
+ * @param[in] name The name of the event.
+ * @param[in] desc The description of the subscriber.
+ * @param[in] cb The callback function of the subscriber.
+ * @param[out] stat The statistics.
+ *
+ * @return OPERATE_RET Returns OPRT_OK on success. Returns OPRT_NOT_FOUND if the
+ * subscriber does not exist or is not deferred.
+ */
+OPERATE_RET tal_event_subscribe_stat_get(const char *name, const char *desc, EVENT_SUBSCRIBE_CB cb,
+                                         EVENT_DEFER_STAT_T *stat)
+{
+    if (NULL == stat) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (!_event_desc_is_valid(desc)) {
+        return OPRT_BASE_EVENT_INVALID_EVENT_DESC;
+    }
+
+    if (!_event_name_is_valid(name)) {
+        return OPRT_BASE_EVENT_INVALID_EVENT_NAME;
+    }
+
+    OPERATE_RET rt = OPRT_NOT_FOUND;
+    SUBSCRIBE_NODE_T subscribe = {0};
+    subscribe.cb = cb;
+    memcpy(subscribe.desc, desc, strlen(desc));
+
+    EVENT_NODE_T *event = _event_node_get(name);
+    if (NULL == event) {
+        return OPRT_NOT_FOUND;
+    }
+
+    tal_mutex_lock(event->mutex);
+    SUBSCRIBE_NODE_T *entry = _event_node_get_subscribe(event, &subscribe);
+    if (entry && entry->defer) {
+        EVENT_DEFER_T *defer = (EVENT_DEFER_T *)entry->defer;
+        *stat = defer->stat;
+        stat->latency_avg = defer->stat.run_cnt ? (uint32_t)(defer->latency_sum / defer->stat.run_cnt) : 0;
+        rt = OPRT_OK;
+    }
+    tal_mutex_unlock(event->mutex);
+
+    return rt;
+}
+
+/**
+ * @brief Gets the handle of an event by name.
+ *
+ * The event is created if it does not exist. Events are never destroyed, so
+ * the handle can be cached by the caller and used by the *_by_handle APIs to
+ * skip the name lookup on every publish.
+ *
+ * @param[in] name The name of the event.
+ * @param[out] handle The event handle.
+ * @return OPERATE_RET Returns OPRT_OK on success. Returns an error code if the
+ * event name is invalid or no memory.
+ */
+OPERATE_RET tal_event_handle_get(const char *name, EVENT_HANDLE *handle)
+{
+    if (g_event_manager.inited != TRUE) {
+        tal_event_init();
+    }
+
+    if (NULL == handle) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (!_event_name_is_valid(name)) {
+        return OPRT_BASE_EVENT_INVALID_EVENT_NAME;
+    }
+
+    EVENT_NODE_T *event = _event_node_get(name);
+    if (!event) {
+        event = _event_node_create_init(name);
+        TUYA_CHECK_NULL_RETURN(event, OPRT_MALLOC_FAILED);
+    }
+
+    *handle = event;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Publishes an event by handle.
+ *
+ * Same as tal_event_publish() without the name lookup.
+ *
+ * @param[in] handle The event handle got from tal_event_handle_get().
+ * @param[in] data The data associated with the event.
+ * @return The operation result. Returns OPRT_OK on success, or an error code on
+ * failure.
+ */
+OPERATE_RET tal_event_publish_by_handle(EVENT_HANDLE handle, void *data)
+{
+    if (NULL == handle) {
+        return OPRT_INVALID_PARM;
+    }
+
+    OPERATE_RET rt = OPRT_OK;
+    TUYA_CALL_ERR_LOG(_event_node_publish((EVENT_NODE_T *)handle, data));
+
+    return rt;
+}
+
+/**
+ * @brief Subscribes to an event by handle.
+ *
+ * @param handle The event handle got from tal_event_handle_get().
+ * @param desc The description of the event.
+ * @param cb The callback function to be called when the event is triggered.
+ * @param type The type of subscription.
+ * @return The result of the operation.
+ *         - OPRT_OK: Operation successful.
+ *         - OPRT_INVALID_PARM: Invalid event handle.
+ *         - OPRT_BASE_EVENT_INVALID_EVENT_DESC: Invalid event description.
+ */
+OPERATE_RET tal_event_subscribe_by_handle(EVENT_HANDLE handle, const char *desc, const EVENT_SUBSCRIBE_CB cb,
+                                          SUBSCRIBE_TYPE_E type)
+{
+    if (NULL == handle) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (!_event_desc_is_valid(desc)) {
+        return OPRT_BASE_EVENT_INVALID_EVENT_DESC;
+    }
+
+    OPERATE_RET rt = OPRT_OK;
+    EVENT_NODE_T *event = (EVENT_NODE_T *)handle;
+    SUBSCRIBE_NODE_T subscribe = {0};
+    subscribe.cb = cb;
+    subscribe.type = type;
+    memcpy(subscribe.name, event->name, strlen(event->name));
+    memcpy(subscribe.desc, desc, strlen(desc));
+
+    tal_mutex_lock(event->mutex);
+    TUYA_CALL_ERR_LOG(_event_node_add_subscribe(event, &subscribe));
+    tal_mutex_unlock(event->mutex);
+
+    return rt;
+}
+
+/**
+ * @brief Unsubscribes from an event by handle.
+ *
+ * @param[in] handle The event handle got from tal_event_handle_get().
+ * @param[in] desc The description of the event to unsubscribe from.
+ * @param[in] cb The callback function to be unregistered.
+ *
+ * @return OPERATE_RET Returns OPRT_OK on success. Returns an error code if the
+ * event handle or description is invalid.
+ */
+OPERATE_RET tal_event_unsubscribe_by_handle(EVENT_HANDLE handle, const char *desc, EVENT_SUBSCRIBE_CB cb)
+{
+    if (NULL == handle) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (!_event_desc_is_valid(desc)) {
+        return OPRT_BASE_EVENT_INVALID_EVENT_DESC;
+    }
+
+    OPERATE_RET rt = OPRT_OK;
+    EVENT_NODE_T *event = (EVENT_NODE_T *)handle;
+    SUBSCRIBE_NODE_T subscribe = {0};
+    subscribe.cb = cb;
+    memcpy(subscribe.name, event->name, strlen(event->name));
+    memcpy(subscribe.desc, desc, strlen(desc));
+
+    tal_mutex_lock(event->mutex);
+    TUYA_CALL_ERR_LOG(_event_node_del_subscribe(event, &subscribe));
+    tal_mutex_unlock(event->mutex);
+
+    return rt;
+}
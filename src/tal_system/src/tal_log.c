@@ -13,6 +13,8 @@
  * - Configurable log levels ranging from debug to critical errors.
  * - Support for multiple log output destinations through callback registration.
  * - Thread-safe log message output using mutexes.
+ * - Optional asynchronous output: producers push binary records into per-thread
+ *   rings and a background thread formats them (ENABLE_LOG_ASYNC).
  * - Integration with Tuya's IoT SDK for memory management and system utilities.
  *
  * The logging system is implemented using a linked list to manage output
@@ -38,6 +40,11 @@
 #include "tal_system.h"
 #include "tal_time_service.h"
 #include "tal_memory.h"
+#if defined(ENABLE_LOG_ASYNC) && (ENABLE_LOG_ASYNC == 1)
+#include "tal_thread.h"
+#include "tal_semaphore.h"
+#include "tkl_thread.h"
+#endif
 
 /***********************************************************
 *************************micro define***********************
@@ -62,6 +69,88 @@ typedef struct {
     LOG_TEXT_STYLE_S style[LOG_LEVEL_MAX + 1];
 } LOG_COLOR_S;
 
+#if defined(ENABLE_LOG_ASYNC) && (ENABLE_LOG_ASYNC == 1)
+#ifndef LOG_ASYNC_RING_NUM
+#define LOG_ASYNC_RING_NUM 8
+#endif
+#ifndef LOG_ASYNC_RING_SIZE
+#define LOG_ASYNC_RING_SIZE 2048
+#endif
+#if (LOG_ASYNC_RING_SIZE & (LOG_ASYNC_RING_SIZE - 1))
+#error "LOG_ASYNC_RING_SIZE must be power of 2"
+#endif
+#define LOG_ASYNC_STACK_SIZE 4096
+#define LOG_ASYNC_IDLE_MS    100
+#define LOG_ASYNC_STOP_MS    1000
+#define LOG_ASYNC_SPEC_LEN   16 // max length of one conversion spec in format
+#define LOG_ASYNC_SPEC_BUF   48 // spec with '*' replaced by numbers
+
+typedef enum {
+    LOG_ARG_NONE = 0, // "%%"
+    LOG_ARG_INT,
+    LOG_ARG_LONG,
+    LOG_ARG_LLONG,
+    LOG_ARG_INTMAX,
+    LOG_ARG_SIZE,
+    LOG_ARG_PTRDIFF,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_LDOUBLE,
+    LOG_ARG_PTR,
+    LOG_ARG_STR,
+} LOG_ARG_TYPE_E;
+
+typedef struct {
+    uint8_t type;
+    uint8_t width_star;
+    uint8_t prec_star;
+    int prec; // -1: no precision
+} LOG_SPEC_T;
+
+// record in ring: head + args in format order, strings are copied with '\0'
+typedef struct {
+    uint32_t len; // record length, head included
+    uint32_t line;
+    uint8_t level;
+    SYS_TICK_T time_ms;
+    const char *fmt;
+    const char *file;
+} LOG_REC_HEAD_T;
+
+// single producer (owner thread), single consumer (log thread)
+typedef struct {
+    TKL_THREAD_HANDLE owner;
+    uint32_t head;      // written by owner
+    uint32_t tail;      // written by log thread
+    uint32_t drop_cnt;  // written by owner
+    uint32_t drop_seen; // written by log thread
+    uint8_t closing;    // set by owner on exit, log thread frees the ring once drained
+    uint8_t *buf;
+} LOG_RING_T;
+
+typedef struct {
+    LOG_RING_T *ring;
+    uint32_t pos; // next write position
+    uint32_t end; // tail + ring size
+} LOG_REC_WRITER_T;
+
+typedef struct {
+    const uint8_t *pos;
+    const uint8_t *end;
+} LOG_REC_READER_T;
+
+typedef struct {
+    BOOL_T enable;
+    uint8_t sleeping;
+    THREAD_HANDLE thread;
+    SEM_HANDLE sem;
+    uint32_t rec_cnt;
+    uint32_t sync_cnt;
+    LOG_RING_T ring[LOG_ASYNC_RING_NUM];
+    uint8_t *rec;   // record copied out of ring
+    char *line_buf; // formatted line
+} LOG_ASYNC_T;
+#endif
+
 typedef struct {
     LOG_LEVEL curLogLevel;
     LIST_HEAD listHead;
@@ -73,6 +162,9 @@ typedef struct {
     int log_buf_len;
     BOOL_T ms_level;
     char *log_buf;
+#if defined(ENABLE_LOG_ASYNC) && (ENABLE_LOG_ASYNC == 1)
+    LOG_ASYNC_T *async;
+#endif
 } LOG_MANAGE, *P_LOG_MANAGE;
 
 #define DEF_OUTPUT_NAME "def_output"
@@ -134,6 +226,9 @@ OPERATE_RET tal_log_init(const TAL_LOG_LEVEL_E level, const int buf_len, const T
         INIT_LIST_HEAD(&(tmp_log_mng->log_list));
         tmp_log_mng->curLogLevel = level;
         tmp_log_mng->ms_level = FALSE;
+#if defined(ENABLE_LOG_ASYNC) && (ENABLE_LOG_ASYNC == 1)
+        tmp_log_mng->async = NULL;
+#endif
         pLogManage = tmp_log_mng;
 
         // set default log style
@@ -153,7 +248,7 @@ OPERATE_RET tal_log_init(const TAL_LOG_LEVEL_E level, const int buf_len, const T
     return OPRT_OK;
 }
 
-void __output_logManage_buf(void)
+static void __output_log_str(const char *str)
 {
     P_LIST_HEAD pPos;
     LOG_OUT_NODE_S *output_node;
@@ -161,11 +256,16 @@ void __output_logManage_buf(void)
     {
         output_node = tuya_list_entry(pPos, LOG_OUT_NODE_S, node);
         if (output_node->out_term) {
-            output_node->out_term(pLogManage->log_buf);
+            output_node->out_term(str);
         }
     }
 }
 
+void __output_logManage_buf(void)
+{
+    __output_log_str(pLogManage->log_buf);
+}
+
 OPERATE_RET __find_out_term_node(const char *name, LOG_OUT_NODE_S **node)
 {
     P_LIST_HEAD pPos;
@@ -407,6 +507,94 @@ OPERATE_RET tal_log_get_level(TAL_LOG_LEVEL_E *level)
     return OPRT_OK;
 }
 
+static const char *__log_file_name(const char *pFile)
+{
+    int pos = 0;
+
+    if (NULL == pFile) {
+        return "Null";
+    }
+
+    pos = tal_log_strrchr((char *)pFile, '/');
+    if (pos < 0) {
+        pos = tal_log_strrchr((char *)pFile, '\\');
+    }
+
+    return (pos >= 0) ? pFile + pos + 1 : pFile;
+}
+
+/**
+ * @brief format color, time, level and file:line of a log line
+ *
+ * @param[in] time_ms posix time in ms, 0 means now
+ *
+ * @return length of the prefix, -1 on error
+ */
+static int __log_prefix_fmt(char *buf, int buf_len, LOG_LEVEL logLevel, const char *filename, uint32_t line,
+                            SYS_TICK_T time_ms)
+{
+    int len = 0;
+    int cnt = 0;
+    const char *pTmpModuleName = "ty";
+
+    // color prefix
+    if (pLogManage->log_color.enable_color) {
+        cnt = snprintf(buf, buf_len, "\033[%d;%d;%dm", pLogManage->log_color.style[logLevel].display_mode,
+                       pLogManage->log_color.style[logLevel].font_color,
+                       pLogManage->log_color.style[logLevel].background_color);
+        if (cnt <= 0) {
+            return -1;
+        }
+        len += cnt;
+    }
+
+    POSIX_TM_S tm;
+    memset(&tm, 0, sizeof(tm));
+
+    TIME_T sec = (TIME_T)(time_ms / 1000);
+    if (pLogManage->ms_level == FALSE) {
+        tal_time_get_local_time_custom(sec, &tm);
+        cnt = snprintf(buf + len, buf_len - len, "[%02d-%02d %02d:%02d:%02d %s %s][%s:%" PRIu32 "] ", tm.tm_mon + 1,
+                       tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, pTmpModuleName, sLevelStr[logLevel], filename,
+                       line);
+    } else {
+        uint32_t ms = (uint32_t)(time_ms % 1000);
+        tal_time_get_local_time_custom(sec, &tm);
+        cnt = snprintf(buf + len, buf_len - len, "[%02d-%02d %02d:%02d:%02d:%" PRIu32 " %s %s][%s:%" PRIu32 "] ",
+                       tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, ms, pTmpModuleName,
+                       sLevelStr[logLevel], filename, line);
+    }
+    if (cnt <= 0) {
+        return -1;
+    }
+    len += cnt;
+
+    return len;
+}
+
+/**
+ * @brief append color reset and line end to a log line, buf must have buf_len + 1 bytes
+ *
+ * @return length of the line, -1 on error
+ */
+static int __log_suffix_fmt(char *buf, int buf_len, int len)
+{
+    int cnt = 0;
+    char *p_suffix = (pLogManage->log_color.enable_color) ? "\033[0m\r\n" : "\r\n";
+
+    if (len > (int)(buf_len - strlen(p_suffix) - 1)) { // 1 -> "\0"
+        len = buf_len - strlen(p_suffix) - 1;
+    }
+    cnt = snprintf(buf + len, buf_len - len, "%s", p_suffix);
+    if (cnt <= 0) {
+        return -1;
+    }
+    len += cnt;
+    buf[len] = '\0';
+
+    return len;
+}
+
 /**
  * @brief Prints a log message with the specified log level, file name, line
  * number, and format string.
@@ -449,59 +637,13 @@ OPERATE_RET PrintLogV(LOG_LEVEL logLevel, char *pFile, uint32_t line, const char
     if (logLevel > tmpLogLevel) {
         return OPRT_BASE_LOG_MNG_PRINT_LOG_LEVEL_HIGHER;
     }
-    const char *pTmpModuleName = "ty";
-    const char *pTmpFilename = NULL;
-
-    if (NULL == pFile) {
-        pTmpFilename = "Null";
-    } else {
-        int pos = 0;
-        pTmpFilename = pFile;
-        pos = tal_log_strrchr((char *)pFile, '/');
-        if (pos < 0) {
-            pos = tal_log_strrchr((char *)pFile, '\\');
-            if (pos >= 0) {
-                pTmpFilename = pFile + pos + 1;
-            }
-        } else {
-            pTmpFilename = pFile + pos + 1;
-        }
-    }
     tal_mutex_lock(pLogManage->mutex);
 
-    // color prefix
-    if (pLogManage->log_color.enable_color) {
-        cnt = snprintf(pLogManage->log_buf, pLogManage->log_buf_len, "\033[%d;%d;%dm",
-                       pLogManage->log_color.style[logLevel].display_mode,
-                       pLogManage->log_color.style[logLevel].font_color,
-                       pLogManage->log_color.style[logLevel].background_color);
-        if (cnt <= 0) {
-            goto ERR_EXIT;
-        }
-        len += cnt;
-    }
-
-    POSIX_TM_S tm;
-    memset(&tm, 0, sizeof(tm));
-
-    if (pLogManage->ms_level == FALSE) {
-        tal_time_get_local_time_custom(0, &tm);
-        cnt = snprintf(pLogManage->log_buf + len, pLogManage->log_buf_len - len,
-                       "[%02d-%02d %02d:%02d:%02d %s %s][%s:%" PRIu32 "] ", tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
-                       tm.tm_min, tm.tm_sec, pTmpModuleName, sLevelStr[logLevel], pTmpFilename, line);
-    } else {
-        SYS_TICK_T time_ms = tal_time_get_posix_ms();
-        TIME_T sec = (TIME_T)(time_ms / 1000);
-        uint32_t ms = (uint32_t)(time_ms % 1000);
-        tal_time_get_local_time_custom(sec, &tm);
-        cnt = snprintf(pLogManage->log_buf + len, pLogManage->log_buf_len - len,
-                       "[%02d-%02d %02d:%02d:%02d:%" PRIu32 " %s %s][%s:%" PRIu32 "] ", tm.tm_mon + 1, tm.tm_mday,
-                       tm.tm_hour, tm.tm_min, tm.tm_sec, ms, pTmpModuleName, sLevelStr[logLevel], pTmpFilename, line);
-    }
-    if (cnt <= 0) {
+    len = __log_prefix_fmt(pLogManage->log_buf, pLogManage->log_buf_len, logLevel, __log_file_name(pFile), line,
+                           (pLogManage->ms_level) ? tal_time_get_posix_ms() : 0);
+    if (len < 0) {
         goto ERR_EXIT;
     }
-    len += cnt;
 
     // Check if there's enough space left for the formatted message
     int remaining = pLogManage->log_buf_len - len;
@@ -521,16 +663,10 @@ OPERATE_RET PrintLogV(LOG_LEVEL logLevel, char *pFile, uint32_t line, const char
     }
     len += cnt;
 
-    char *p_suffix = (pLogManage->log_color.enable_color) ? "\033[0m\r\n" : "\r\n";
-    if (len > (int)(pLogManage->log_buf_len - strlen(p_suffix) - 1)) { // 1 -> "\0"
-        len = pLogManage->log_buf_len - strlen(p_suffix) - 1;
-    }
-    cnt = snprintf(pLogManage->log_buf + len, pLogManage->log_buf_len - len, "%s", p_suffix);
-    if (cnt <= 0) {
+    len = __log_suffix_fmt(pLogManage->log_buf, pLogManage->log_buf_len, len);
+    if (len < 0) {
         goto ERR_EXIT;
     }
-    len += cnt;
-    pLogManage->log_buf[len] = '\0';
 
     __output_logManage_buf();
     tal_mutex_unlock(pLogManage->mutex);
@@ -542,6 +678,662 @@ ERR_EXIT:
     return OPRT_BASE_LOG_MNG_FORMAT_STRING_FAILED;
 }
 
+#if defined(ENABLE_LOG_ASYNC) && (ENABLE_LOG_ASYNC == 1)
+/**
+ * @brief parse one conversion spec, p points to '%'
+ *
+ * @return pointer behind the spec, NULL if the spec can't be deferred
+ */
+static const char *__log_spec_parse(const char *p, LOG_SPEC_T *spec)
+{
+    const char *start = p;
+    char lmod = 0;
+
+    memset(spec, 0, sizeof(LOG_SPEC_T));
+    spec->prec = -1;
+
+    p++;
+    if (*p == '%') {
+        spec->type = LOG_ARG_NONE;
+        return p + 1;
+    }
+
+    while (*p && (*p == ' ' || *p == '#' || *p == '+' || *p == '-' || *p == '0' || *p == '\'')) {
+        p++;
+    }
+    if (*p == '*') {
+        spec->width_star = 1;
+        p++;
+    } else {
+        while (isdigit((unsigned char)(*p))) {
+            p++;
+        }
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec->prec_star = 1;
+            p++;
+        } else {
+            spec->prec = 0;
+            while (isdigit((unsigned char)(*p))) {
+                spec->prec = spec->prec * 10 + (*p - '0');
+                p++;
+            }
+        }
+    }
+
+    switch (*p) {
+    case 'h':
+        p++;
+        if (*p == 'h') {
+            p++;
+        }
+        break;
+    case 'l':
+        p++;
+        lmod = 'l';
+        if (*p == 'l') {
+            p++;
+            lmod = 'q';
+        }
+        break;
+    case 'j':
+    case 'z':
+    case 't':
+    case 'L':
+        lmod = *p++;
+        break;
+    default:
+        break;
+    }
+
+    switch (*p) {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+        spec->type = (lmod == 'l')   ? LOG_ARG_LONG
+                     : (lmod == 'q') ? LOG_ARG_LLONG
+                     : (lmod == 'j') ? LOG_ARG_INTMAX
+                     : (lmod == 'z') ? LOG_ARG_SIZE
+                     : (lmod == 't') ? LOG_ARG_PTRDIFF
+                                     : LOG_ARG_INT;
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        spec->type = (lmod == 'L') ? LOG_ARG_LDOUBLE : LOG_ARG_DOUBLE;
+        break;
+    case 'c':
+        spec->type = LOG_ARG_INT;
+        break;
+    case 'p':
+        spec->type = LOG_ARG_PTR;
+        break;
+    case 's':
+        spec->type = LOG_ARG_STR;
+        break;
+    default:
+        return NULL;
+    }
+    // wide char and string are not supported
+    if ((*p == 'c' || *p == 's') && lmod) {
+        return NULL;
+    }
+    p++;
+
+    return (p - start <= LOG_ASYNC_SPEC_LEN) ? p : NULL;
+}
+
+static void __log_ring_write(LOG_RING_T *ring, uint32_t pos, const void *data, uint32_t len)
+{
+    uint32_t off = pos & (LOG_ASYNC_RING_SIZE - 1);
+    uint32_t first = LOG_ASYNC_RING_SIZE - off;
+
+    if (first > len) {
+        first = len;
+    }
+    memcpy(ring->buf + off, data, first);
+    memcpy(ring->buf, (const uint8_t *)data + first, len - first);
+}
+
+static void __log_ring_read(LOG_RING_T *ring, uint32_t pos, void *data, uint32_t len)
+{
+    uint32_t off = pos & (LOG_ASYNC_RING_SIZE - 1);
+    uint32_t first = LOG_ASYNC_RING_SIZE - off;
+
+    if (first > len) {
+        first = len;
+    }
+    memcpy(data, ring->buf + off, first);
+    memcpy((uint8_t *)data + first, ring->buf, len - first);
+}
+
+// without ring the record is only measured
+static BOOL_T __log_rec_put(LOG_REC_WRITER_T *wr, const void *data, uint32_t len)
+{
+    if (wr->end - wr->pos < len) {
+        return FALSE;
+    }
+    if (wr->ring) {
+        __log_ring_write(wr->ring, wr->pos, data, len);
+    }
+    wr->pos += len;
+
+    return TRUE;
+}
+
+static BOOL_T __log_rec_get(LOG_REC_READER_T *rd, void *data, uint32_t len)
+{
+    if ((uint32_t)(rd->end - rd->pos) < len) {
+        return FALSE;
+    }
+    memcpy(data, rd->pos, len);
+    rd->pos += len;
+
+    return TRUE;
+}
+
+/**
+ * @brief write the args of fmt into the record
+ *
+ * @return OPRT_OK on success, OPRT_NOT_SUPPORTED if the format can't be
+ * deferred, OPRT_BUFFER_NOT_ENOUGH if the ring is full
+ */
+static OPERATE_RET __log_rec_encode(LOG_REC_WRITER_T *wr, const char *fmt, va_list ap)
+{
+    LOG_SPEC_T spec;
+    BOOL_T ok = TRUE;
+    const char *p = fmt;
+
+    // check the whole format first, the ring is untouched if it can't be deferred
+    while (NULL != (p = strchr(p, '%'))) {
+        p = __log_spec_parse(p, &spec);
+        if (NULL == p) {
+            return OPRT_NOT_SUPPORTED;
+        }
+    }
+
+    p = fmt;
+    while (ok && NULL != (p = strchr(p, '%'))) {
+        p = __log_spec_parse(p, &spec);
+        if (spec.width_star) {
+            int width = va_arg(ap, int);
+            ok = ok && __log_rec_put(wr, &width, sizeof(width));
+        }
+        if (spec.prec_star) {
+            spec.prec = va_arg(ap, int);
+            ok = ok && __log_rec_put(wr, &spec.prec, sizeof(spec.prec));
+        }
+
+        switch (spec.type) {
+        case LOG_ARG_INT: {
+            int val = va_arg(ap, int);
+            ok = ok && __log_rec_put(wr, &val, sizeof(val));
+        } break;
+        case LOG_ARG_LONG: {
+            long val = va_arg(ap, long);
+            ok = ok && __log_rec_put(wr, &val, sizeof(val));
+        } break;
+        case LOG_ARG_LLONG: {
+            long long val = va_arg(ap, long long);
+            ok = ok && __log_rec_put(wr, &val, sizeof(val));
+        } break;
+        case LOG_ARG_INTMAX: {
+            intmax_t val = va_arg(ap, intmax_t);
+            ok = ok && __log_rec_put(wr, &val, sizeof(val));
+        } break;
+        case LOG_ARG_SIZE: {
+            size_t val = va_arg(ap, size_t);
+            ok = ok && __log_rec_put(wr, &val, sizeof(val));
+        } break;
+        case LOG_ARG_PTRDIFF: {
+            ptrdiff_t val = va_arg(ap, ptrdiff_t);
+            ok = ok && __log_rec_put(wr, &val, sizeof(val));
+        } break;
+        case LOG_ARG_DOUBLE: {
+            double val = va_arg(ap, double);
+            ok = ok && __log_rec_put(wr, &val, sizeof(val));
+        } break;
+        case LOG_ARG_LDOUBLE: {
+            long double val = va_arg(ap, long double);
+            ok = ok && __log_rec_put(wr, &val, sizeof(val));
+        } break;
+        case LOG_ARG_PTR: {
+            void *val = va_arg(ap, void *);
+            ok = ok && __log_rec_put(wr, &val, sizeof(val));
+        } break;
+        case LOG_ARG_STR: {
+            const char *val = va_arg(ap, const char *);
+            if (NULL == val) {
+                val = "(null)";
+            }
+            // the caller's string may be gone when formatted, copy it
+            uint32_t len = 0;
+            while ((spec.prec < 0 || len < (uint32_t)spec.prec) && val[len]) {
+                len++;
+            }
+            ok = ok && __log_rec_put(wr, val, len) && __log_rec_put(wr, "", 1);
+        } break;
+        default:
+            break;
+        }
+    }
+
+    return ok ? OPRT_OK : OPRT_BUFFER_NOT_ENOUGH;
+}
+
+/**
+ * @brief rebuild one conversion spec with '*' replaced by the recorded value
+ */
+static void __log_spec_build(const char *start, const char *end, const LOG_SPEC_T *spec, int width, int prec,
+                             char *buf)
+{
+    int len = 0;
+    BOOL_T dot = FALSE;
+
+    for (; start < end; start++) {
+        if (*start == '.') {
+            dot = TRUE;
+            if (spec->prec_star && prec < 0) {
+                start++; // negative precision is taken as omitted, skip ".*"
+                continue;
+            }
+        }
+        if (*start == '*') {
+            len += snprintf(buf + len, LOG_ASYNC_SPEC_BUF - len, "%d", dot ? prec : width);
+            continue;
+        }
+        buf[len++] = *start;
+    }
+    buf[len] = '\0';
+}
+
+/**
+ * @brief format the message of a record
+ *
+ * @return length of the message
+ */
+static int __log_rec_render(const LOG_REC_HEAD_T *head, const uint8_t *args, uint32_t args_len, char *out,
+                            int out_len)
+{
+    LOG_REC_READER_T rd = {args, args + args_len};
+    LOG_SPEC_T spec;
+    char spec_buf[LOG_ASYNC_SPEC_BUF];
+    const char *p = head->fmt, *next = NULL;
+    int width = 0, prec = -1;
+    int len = 0, cnt = 0;
+    BOOL_T ok = TRUE;
+
+    if (out_len <= 0) {
+        return 0;
+    }
+
+    while (*p && len < out_len - 1) {
+        if (*p != '%') {
+            out[len++] = *p++;
+            continue;
+        }
+        next = __log_spec_parse(p, &spec);
+        if (NULL == next) {
+            break;
+        }
+        if (spec.type == LOG_ARG_NONE) {
+            out[len++] = '%';
+            p = next;
+            continue;
+        }
+        if (spec.width_star) {
+            ok = ok && __log_rec_get(&rd, &width, sizeof(width));
+        }
+        if (spec.prec_star) {
+            ok = ok && __log_rec_get(&rd, &prec, sizeof(prec));
+        }
+        __log_spec_build(p, next, &spec, width, prec, spec_buf);
+
+        cnt = 0;
+        switch (spec.type) {
+        case LOG_ARG_INT: {
+            int val = 0;
+            ok = ok && __log_rec_get(&rd, &val, sizeof(val));
+            cnt = snprintf(out + len, out_len - len, spec_buf, val);
+        } break;
+        case LOG_ARG_LONG: {
+            long val = 0;
+            ok = ok && __log_rec_get(&rd, &val, sizeof(val));
+            cnt = snprintf(out + len, out_len - len, spec_buf, val);
+        } break;
+        case LOG_ARG_LLONG: {
+            long long val = 0;
+            ok = ok && __log_rec_get(&rd, &val, sizeof(val));
+            cnt = snprintf(out + len, out_len - len, spec_buf, val);
+        } break;
+        case LOG_ARG_INTMAX: {
+            intmax_t val = 0;
+            ok = ok && __log_rec_get(&rd, &val, sizeof(val));
+            cnt = snprintf(out + len, out_len - len, spec_buf, val);
+        } break;
+        case LOG_ARG_SIZE: {
+            size_t val = 0;
+            ok = ok && __log_rec_get(&rd, &val, sizeof(val));
+            cnt = snprintf(out + len, out_len - len, spec_buf, val);
+        } break;
+        case LOG_ARG_PTRDIFF: {
+            ptrdiff_t val = 0;
+            ok = ok && __log_rec_get(&rd, &val, sizeof(val));
+            cnt = snprintf(out + len, out_len - len, spec_buf, val);
+        } break;
+        case LOG_ARG_DOUBLE: {
+            double val = 0;
+            ok = ok && __log_rec_get(&rd, &val, sizeof(val));
+            cnt = snprintf(out + len, out_len - len, spec_buf, val);
+        } break;
+        case LOG_ARG_LDOUBLE: {
+            long double val = 0;
+            ok = ok && __log_rec_get(&rd, &val, sizeof(val));
+            cnt = snprintf(out + len, out_len - len, spec_buf, val);
+        } break;
+        case LOG_ARG_PTR: {
+            void *val = NULL;
+            ok = ok && __log_rec_get(&rd, &val, sizeof(val));
+            cnt = snprintf(out + len, out_len - len, spec_buf, val);
+        } break;
+        case LOG_ARG_STR: {
+            const char *val = (const char *)rd.pos;
+            uint32_t str_len = 0;
+            while (rd.pos + str_len < rd.end && val[str_len]) {
+                str_len++;
+            }
+            ok = ok && (rd.pos + str_len < rd.end);
+            if (ok) {
+                rd.pos += str_len + 1;
+                cnt = snprintf(out + len, out_len - len, spec_buf, val);
+            }
+        } break;
+        default:
+            break;
+        }
+        if (!ok || cnt < 0) {
+            break;
+        }
+        len += (cnt >= out_len - len) ? (out_len - len - 1) : cnt;
+        p = next;
+    }
+    out[len] = '\0';
+
+    return len;
+}
+
+static void __log_rec_output(LOG_ASYNC_T *async, const LOG_REC_HEAD_T *head, const uint8_t *args, uint32_t args_len)
+{
+    char *buf = async->line_buf;
+    int buf_len = pLogManage->log_buf_len;
+    int len = 0;
+
+    // line_buf is only used by log thread, format without lock
+    len = __log_prefix_fmt(buf, buf_len, head->level, __log_file_name(head->file), head->line, head->time_ms);
+    if (len < 0 || len >= buf_len) {
+        return;
+    }
+    len += __log_rec_render(head, args, args_len, buf + len, buf_len - len);
+    len = __log_suffix_fmt(buf, buf_len, len);
+    if (len < 0) {
+        return;
+    }
+
+    tal_mutex_lock(pLogManage->mutex);
+    __output_log_str(buf);
+    tal_mutex_unlock(pLogManage->mutex);
+    __atomic_store_n(&async->rec_cnt, async->rec_cnt + 1, __ATOMIC_RELAXED);
+}
+
+static LOG_RING_T *__log_ring_get(LOG_ASYNC_T *async)
+{
+    TKL_THREAD_HANDLE self = NULL;
+    LOG_RING_T *ring = NULL;
+    uint32_t i = 0;
+
+    if (OPRT_OK != tkl_thread_get_id(&self) || NULL == self) {
+        return NULL;
+    }
+
+    // only the owner writes its handle, no lock needed to find it. A closing
+    // ring belongs to an exited thread whose handle was reused.
+    for (i = 0; i < LOG_ASYNC_RING_NUM; i++) {
+        if (async->ring[i].owner == self && !__atomic_load_n(&async->ring[i].closing, __ATOMIC_ACQUIRE)) {
+            return &async->ring[i];
+        }
+    }
+
+    tal_mutex_lock(pLogManage->mutex);
+    for (i = 0; i < LOG_ASYNC_RING_NUM; i++) {
+        if (NULL == async->ring[i].owner) {
+            ring = &async->ring[i];
+            __atomic_store_n(&ring->owner, self, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+    tal_mutex_unlock(pLogManage->mutex);
+
+    return ring;
+}
+
+static OPERATE_RET __log_async_push(LOG_ASYNC_T *async, LOG_LEVEL level, const char *file, uint32_t line,
+                                    const char *fmt, va_list ap)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+    LOG_REC_HEAD_T head;
+    LOG_REC_WRITER_T wr;
+    va_list cp;
+    LOG_RING_T *ring = __log_ring_get(async);
+
+    if (NULL == ring) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    wr.ring = ring;
+    wr.end = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) + LOG_ASYNC_RING_SIZE;
+    if (wr.end - ring->head < sizeof(head)) {
+        __atomic_store_n(&ring->drop_cnt, ring->drop_cnt + 1, __ATOMIC_RELAXED);
+        return OPRT_BUFFER_NOT_ENOUGH;
+    }
+    wr.pos = ring->head + sizeof(head);
+
+    va_copy(cp, ap);
+    op_ret = __log_rec_encode(&wr, fmt, ap);
+    if (OPRT_BUFFER_NOT_ENOUGH == op_ret) {
+        // a record which doesn't fit even an empty ring is printed in caller context
+        wr.ring = NULL;
+        wr.pos = ring->head + sizeof(head);
+        wr.end = ring->head + LOG_ASYNC_RING_SIZE;
+        if (OPRT_BUFFER_NOT_ENOUGH == __log_rec_encode(&wr, fmt, cp)) {
+            op_ret = OPRT_NOT_SUPPORTED;
+        } else {
+            __atomic_store_n(&ring->drop_cnt, ring->drop_cnt + 1, __ATOMIC_RELAXED);
+        }
+    }
+    va_end(cp);
+    if (OPRT_OK != op_ret) {
+        return op_ret;
+    }
+
+    head.len = wr.pos - ring->head;
+    head.line = line;
+    head.level = (uint8_t)level;
+    head.time_ms = tal_time_get_posix_ms();
+    head.fmt = fmt;
+    head.file = file;
+    __log_ring_write(ring, ring->head, &head, sizeof(head));
+    __atomic_store_n(&ring->head, wr.pos, __ATOMIC_RELEASE);
+
+    // pairs with the fence in log thread before it sleeps
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&async->sleeping, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&async->sleeping, 0, __ATOMIC_ACQ_REL)) {
+        tal_semaphore_post(async->sem);
+    }
+
+    return OPRT_OK;
+}
+
+static void __log_async_drop_report(LOG_ASYNC_T *async, LOG_RING_T *ring)
+{
+    LOG_REC_HEAD_T head;
+    uint8_t args[sizeof(unsigned int) + sizeof(void *)];
+    uint32_t drop_cnt = __atomic_load_n(&ring->drop_cnt, __ATOMIC_RELAXED);
+    unsigned int dropped = drop_cnt - ring->drop_seen;
+    void *owner = ring->owner;
+
+    if (0 == dropped) {
+        return;
+    }
+    ring->drop_seen = drop_cnt;
+
+    memset(&head, 0, sizeof(head));
+    head.level = TAL_LOG_LEVEL_WARN;
+    head.line = __LINE__;
+    head.file = __FILE__;
+    head.time_ms = tal_time_get_posix_ms();
+    head.fmt = "%u log dropped, thread %p";
+    memcpy(args, &dropped, sizeof(dropped));
+    memcpy(args + sizeof(dropped), &owner, sizeof(owner));
+    __log_rec_output(async, &head, args, sizeof(args));
+}
+
+/**
+ * @brief output pending records of all rings in time order
+ *
+ * @return number of records output
+ */
+static uint32_t __log_async_drain(LOG_ASYNC_T *async)
+{
+    LOG_REC_HEAD_T head, best_head;
+    LOG_RING_T *ring = NULL, *best = NULL;
+    uint32_t i = 0, cnt = 0;
+
+    for (;;) {
+        best = NULL;
+        for (i = 0; i < LOG_ASYNC_RING_NUM; i++) {
+            ring = &async->ring[i];
+            if (NULL == __atomic_load_n(&ring->owner, __ATOMIC_ACQUIRE) ||
+                ring->tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+                continue;
+            }
+            __log_ring_read(ring, ring->tail, &head, sizeof(head));
+            if (NULL == best || head.time_ms < best_head.time_ms) {
+                best = ring;
+                best_head = head;
+            }
+        }
+        if (NULL == best) {
+            break;
+        }
+
+        __log_ring_read(best, best->tail + sizeof(head), async->rec, best_head.len - sizeof(head));
+        __atomic_store_n(&best->tail, best->tail + best_head.len, __ATOMIC_RELEASE);
+        __log_rec_output(async, &best_head, async->rec, best_head.len - sizeof(head));
+        cnt++;
+    }
+
+    for (i = 0; i < LOG_ASYNC_RING_NUM; i++) {
+        __log_async_drop_report(async, &async->ring[i]);
+    }
+
+    // rings of exited threads are free again once drained
+    for (i = 0; i < LOG_ASYNC_RING_NUM; i++) {
+        ring = &async->ring[i];
+        if (__atomic_load_n(&ring->closing, __ATOMIC_ACQUIRE) &&
+            ring->tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+            ring->closing = 0;
+            __atomic_store_n(&ring->owner, NULL, __ATOMIC_RELEASE);
+        }
+    }
+
+    return cnt;
+}
+
+static BOOL_T __log_async_is_empty(LOG_ASYNC_T *async)
+{
+    uint32_t i = 0;
+
+    for (i = 0; i < LOG_ASYNC_RING_NUM; i++) {
+        if (__atomic_load_n(&async->ring[i].tail, __ATOMIC_ACQUIRE) !=
+            __atomic_load_n(&async->ring[i].head, __ATOMIC_ACQUIRE)) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static void __log_async_thread_cb(void *arg)
+{
+    LOG_ASYNC_T *async = (LOG_ASYNC_T *)arg;
+
+    while (THREAD_STATE_RUNNING == tal_thread_get_state(async->thread)) {
+        if (__log_async_drain(async) > 0) {
+            continue;
+        }
+
+        // producers post the semaphore only when sleeping is set
+        __atomic_store_n(&async->sleeping, 1, __ATOMIC_SEQ_CST);
+        if (0 == __log_async_drain(async)) {
+            tal_semaphore_wait(async->sem, LOG_ASYNC_IDLE_MS);
+        }
+        __atomic_store_n(&async->sleeping, 0, __ATOMIC_SEQ_CST);
+    }
+
+    __log_async_drain(async);
+}
+#endif
+
+/**
+ * @brief print a log, deferred to log thread if asynchronous log is started and
+ * the format is a constant which stays valid until formatted
+ */
+static OPERATE_RET __log_print_v(BOOL_T is_const_fmt, LOG_LEVEL level, const char *file, uint32_t line,
+                                 const char *fmt, va_list ap)
+{
+#if defined(ENABLE_LOG_ASYNC) && (ENABLE_LOG_ASYNC == 1)
+    LOG_ASYNC_T *async = (pLogManage) ? pLogManage->async : NULL;
+
+    if (is_const_fmt && async && __atomic_load_n(&async->enable, __ATOMIC_ACQUIRE) && level >= LOG_LEVEL_MIN &&
+        level <= pLogManage->curLogLevel) {
+        va_list cp;
+        va_copy(cp, ap);
+        OPERATE_RET op_ret = __log_async_push(async, level, file, line, fmt, cp);
+        va_end(cp);
+        if (OPRT_NOT_SUPPORTED != op_ret && OPRT_RESOURCE_NOT_READY != op_ret) {
+            return op_ret;
+        }
+        __atomic_fetch_add(&async->sync_cnt, 1, __ATOMIC_RELAXED);
+    }
+#endif
+
+    return PrintLogV(level, (char *)file, line, fmt, ap);
+}
+
+static OPERATE_RET __log_print(BOOL_T is_const_fmt, LOG_LEVEL level, const char *file, uint32_t line,
+                               const char *fmt, ...)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+    va_list ap;
+
+    va_start(ap, fmt);
+    op_ret = __log_print_v(is_const_fmt, level, file, line, fmt, ap);
+    va_end(ap);
+
+    return op_ret;
+}
+
 /**
  * @brief Prints a log message with the specified log level, file, line number,
  * and format string.
@@ -592,7 +1384,7 @@ OPERATE_RET tal_log_print_secure(BOOL_T is_const_fmt, const TAL_LOG_LEVEL_E leve
         }
         va_list ap;
         va_start(ap, fmt);
-        OPERATE_RET ret = PrintLogV(level, (char *)file, line, fmt, ap);
+        OPERATE_RET ret = __log_print_v(TRUE, level, file, line, fmt, ap);
         va_end(ap);
         return ret;
     }
@@ -681,9 +1473,9 @@ OPERATE_RET tal_log_print_escape(const TAL_LOG_LEVEL_E level, const char *file,
 
     OPERATE_RET log_ret = OPRT_INVALID_PARM;
     if (prefix && prefix[0] != '\0') {
-        log_ret = tal_log_print(level, file, line, "%s%s", prefix, escaped);
+        log_ret = __log_print(TRUE, level, file, line, "%s%s", prefix, escaped);
     } else {
-        log_ret = tal_log_print(level, file, line, "%s", escaped);
+        log_ret = __log_print(TRUE, level, file, line, "%s", escaped);
     }
 
     tal_free(escaped);
@@ -723,6 +1515,15 @@ void tal_log_release(void)
         return;
     }
 
+#if defined(ENABLE_LOG_ASYNC) && (ENABLE_LOG_ASYNC == 1)
+    if (pLogManage->async) {
+        tal_log_async_stop();
+        tal_semaphore_release(pLogManage->async->sem);
+        tal_free(pLogManage->async);
+        pLogManage->async = NULL;
+    }
+#endif
+
     while (!tuya_list_empty(&(pLogManage->log_list))) {
         LOG_OUT_NODE_S *log_out_nd = NULL;
         log_out_nd = tuya_list_entry(&(pLogManage->log_list.next), LOG_OUT_NODE_S, node);
@@ -913,3 +1714,196 @@ __EXIT:
 
     return opRet;
 }
+
+#if defined(ENABLE_LOG_ASYNC) && (ENABLE_LOG_ASYNC == 1)
+/**
+ * @brief Starts asynchronous log output.
+ *
+ * PR_XXX logs with a constant format are pushed as binary records into a ring
+ * owned by the calling thread and formatted by a background thread. Threads
+ * beyond LOG_ASYNC_RING_NUM, formats which can't be deferred and records
+ * larger than a ring fall back to the synchronous path. A full ring drops the record and the drop is reported
+ * by the log thread.
+ *
+ * @param stack_size Stack size of the log thread, 0 means default.
+ * @return OPRT_OK on success, or an error code on failure.
+ */
+OPERATE_RET tal_log_async_start(uint32_t stack_size)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+    LOG_ASYNC_T *async = NULL;
+    uint32_t i = 0;
+
+    if (NULL == pLogManage) {
+        return OPRT_INVALID_PARM;
+    }
+
+    async = pLogManage->async;
+    if (async && async->thread) {
+        return OPRT_OK;
+    }
+
+    if (NULL == async) {
+        async = (LOG_ASYNC_T *)tal_calloc(1, sizeof(LOG_ASYNC_T) + (LOG_ASYNC_RING_NUM + 1) * LOG_ASYNC_RING_SIZE +
+                                                 pLogManage->log_buf_len + 1);
+        if (NULL == async) {
+            return OPRT_MALLOC_FAILED;
+        }
+        for (i = 0; i < LOG_ASYNC_RING_NUM; i++) {
+            async->ring[i].buf = (uint8_t *)(async + 1) + i * LOG_ASYNC_RING_SIZE;
+        }
+        async->rec = (uint8_t *)(async + 1) + LOG_ASYNC_RING_NUM * LOG_ASYNC_RING_SIZE;
+        async->line_buf = (char *)(async->rec + LOG_ASYNC_RING_SIZE);
+
+        op_ret = tal_semaphore_create_init(&async->sem, 0, 1);
+        if (OPRT_OK != op_ret) {
+            tal_free(async);
+            return op_ret;
+        }
+        pLogManage->async = async;
+    }
+
+    THREAD_CFG_T thread_cfg = {.stackDepth = (stack_size) ? stack_size : LOG_ASYNC_STACK_SIZE,
+                               .priority = THREAD_PRIO_4,
+                               .thrdname = "log_async"};
+    op_ret = tal_thread_create_and_start(&async->thread, NULL, NULL, __log_async_thread_cb, async, &thread_cfg);
+    if (OPRT_OK != op_ret) {
+        async->thread = NULL;
+        return op_ret;
+    }
+    __atomic_store_n(&async->enable, TRUE, __ATOMIC_RELEASE);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Waits until all pending asynchronous log records are output.
+ *
+ * @param timeout_ms Max time to wait in ms.
+ * @return OPRT_OK if all records are output, OPRT_TIMEOUT otherwise.
+ */
+OPERATE_RET tal_log_async_flush(uint32_t timeout_ms)
+{
+    LOG_ASYNC_T *async = (pLogManage) ? pLogManage->async : NULL;
+    SYS_TIME_T start = tal_system_get_millisecond();
+
+    if (NULL == async || NULL == async->thread) {
+        return OPRT_OK;
+    }
+
+    while (!__log_async_is_empty(async)) {
+        if (tal_system_get_millisecond() - start >= timeout_ms) {
+            return OPRT_TIMEOUT;
+        }
+        tal_semaphore_post(async->sem);
+        tal_system_sleep(5);
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Stops asynchronous log output, pending records are flushed and later
+ * logs are printed synchronously. Rings are kept for the next start.
+ *
+ * @return OPRT_OK on success, or an error code on failure.
+ */
+OPERATE_RET tal_log_async_stop(void)
+{
+    LOG_ASYNC_T *async = (pLogManage) ? pLogManage->async : NULL;
+    uint32_t count = 1;
+
+    if (NULL == async || NULL == async->thread) {
+        return OPRT_OK;
+    }
+
+    __atomic_store_n(&async->enable, FALSE, __ATOMIC_RELEASE);
+    tal_log_async_flush(LOG_ASYNC_STOP_MS);
+
+    tal_thread_delete(async->thread);
+    tal_semaphore_post(async->sem);
+    while (THREAD_STATE_DELETE != tal_thread_get_state(async->thread)) {
+        tal_system_sleep(10);
+        if ((count++) % 500 == 0) {
+            PR_NOTICE("log thread still running");
+        }
+    }
+    async->thread = NULL;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Gets statistics of asynchronous log output.
+ *
+ * @param stat Output statistics.
+ * @return OPRT_OK on success, OPRT_INVALID_PARM if not started.
+ */
+OPERATE_RET tal_log_async_stat_get(TAL_LOG_ASYNC_STAT_T *stat)
+{
+    LOG_ASYNC_T *async = (pLogManage) ? pLogManage->async : NULL;
+    uint32_t i = 0;
+
+    if (NULL == stat || NULL == async) {
+        return OPRT_INVALID_PARM;
+    }
+
+    memset(stat, 0, sizeof(TAL_LOG_ASYNC_STAT_T));
+    for (i = 0; i < LOG_ASYNC_RING_NUM; i++) {
+        if (__atomic_load_n(&async->ring[i].owner, __ATOMIC_ACQUIRE)) {
+            stat->ring_used++;
+        }
+        stat->drop_cnt += __atomic_load_n(&async->ring[i].drop_cnt, __ATOMIC_RELAXED);
+    }
+    stat->rec_cnt = __atomic_load_n(&async->rec_cnt, __ATOMIC_RELAXED);
+    stat->sync_cnt = __atomic_load_n(&async->sync_cnt, __ATOMIC_RELAXED);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Gives up the log ring of the calling thread, called when it exits.
+ * Records still pending are output and the log thread frees the ring then.
+ */
+void tal_log_async_thread_exit(void)
+{
+    LOG_ASYNC_T *async = (pLogManage) ? pLogManage->async : NULL;
+    TKL_THREAD_HANDLE self = NULL;
+    uint32_t i = 0;
+
+    if (NULL == async || OPRT_OK != tkl_thread_get_id(&self) || NULL == self) {
+        return;
+    }
+
+    for (i = 0; i < LOG_ASYNC_RING_NUM; i++) {
+        if (async->ring[i].owner == self && !__atomic_load_n(&async->ring[i].closing, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&async->ring[i].closing, 1, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+}
+#else
+OPERATE_RET tal_log_async_start(uint32_t stack_size)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+OPERATE_RET tal_log_async_flush(uint32_t timeout_ms)
+{
+    return OPRT_OK;
+}
+
+OPERATE_RET tal_log_async_stop(void)
+{
+    return OPRT_OK;
+}
+
+OPERATE_RET tal_log_async_stat_get(TAL_LOG_ASYNC_STAT_T *stat)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+void tal_log_async_thread_exit(void)
+{
+}
+#endif
@@ -40,6 +40,235 @@ typedef struct {
 
 static SW_TIMER_MGR_T s_timer_mgr;
 
+#if defined(ENABLE_SW_TIMER_WHEEL) && (ENABLE_SW_TIMER_WHEEL == 1)
+/*
+ * hierarchical timing wheel, one tick equals one millisecond.
+ * level n holds timers which expire within (64 ^ (n + 1)) ticks, timers beyond
+ * the top level are clamped and re-cascaded until they get close enough.
+ */
+#define WHEEL_LEVEL_BITS     6
+#define WHEEL_LEVEL_SIZE     (1 << WHEEL_LEVEL_BITS)
+#define WHEEL_LEVEL_MASK     (WHEEL_LEVEL_SIZE - 1)
+#define WHEEL_LEVEL_NUM      4
+#define WHEEL_LEVEL_SHIFT(n) ((n) * WHEEL_LEVEL_BITS)
+#define WHEEL_MAX_DELTA      ((1ULL << (WHEEL_LEVEL_NUM * WHEEL_LEVEL_BITS)) - 1)
+#define WHEEL_TICK_NONE      ((uint64_t)-1)
+
+typedef struct {
+    LIST_HEAD slot[WHEEL_LEVEL_NUM][WHEEL_LEVEL_SIZE];
+    uint64_t bitmap[WHEEL_LEVEL_NUM]; // maybe stale, slots are checked before use
+    LIST_HEAD list_expired;
+    uint64_t cur_tick; // next tick to be processed
+} SW_TIMER_WHEEL_T;
+
+static SW_TIMER_WHEEL_T s_timer_wheel;
+
+static void __wheel_init(uint64_t now)
+{
+    uint32_t level, idx;
+
+    for (level = 0; level < WHEEL_LEVEL_NUM; level++) {
+        for (idx = 0; idx < WHEEL_LEVEL_SIZE; idx++) {
+            INIT_LIST_HEAD(&(s_timer_wheel.slot[level][idx]));
+        }
+        s_timer_wheel.bitmap[level] = 0;
+    }
+    INIT_LIST_HEAD(&(s_timer_wheel.list_expired));
+    s_timer_wheel.cur_tick = now;
+}
+
+static void __timer_attach(TIMER_T *timer)
+{
+    uint64_t expires = timer->expire_time;
+    uint64_t delta = 0;
+    uint32_t level = 0, idx = 0;
+
+    tuya_list_del(&(timer->node));
+
+    if (expires < s_timer_wheel.cur_tick) {
+        expires = s_timer_wheel.cur_tick;
+    }
+
+    delta = expires - s_timer_wheel.cur_tick;
+    if (delta > WHEEL_MAX_DELTA) {
+        delta = WHEEL_MAX_DELTA;
+        expires = s_timer_wheel.cur_tick + WHEEL_MAX_DELTA;
+    }
+
+    for (level = 0; level < WHEEL_LEVEL_NUM - 1; level++) {
+        if (delta < (1ULL << WHEEL_LEVEL_SHIFT(level + 1))) {
+            break;
+        }
+    }
+
+    idx = (expires >> WHEEL_LEVEL_SHIFT(level)) & WHEEL_LEVEL_MASK;
+    tuya_list_add_tail(&(timer->node), &(s_timer_wheel.slot[level][idx]));
+    s_timer_wheel.bitmap[level] |= (1ULL << idx);
+}
+
+// find the first non-empty slot of the level starting from idx, WHEEL_LEVEL_SIZE if none
+static uint32_t __wheel_slot_next(uint32_t level, uint32_t idx)
+{
+    uint64_t pending = 0;
+
+    while (idx < WHEEL_LEVEL_SIZE) {
+        pending = s_timer_wheel.bitmap[level] >> idx;
+        if (0 == pending) {
+            break;
+        }
+
+        idx += __builtin_ctzll(pending);
+        if (!tuya_list_empty(&(s_timer_wheel.slot[level][idx]))) {
+            return idx;
+        }
+
+        // timer of this slot has been stopped or deleted
+        s_timer_wheel.bitmap[level] &= ~(1ULL << idx);
+        idx++;
+    }
+
+    return WHEEL_LEVEL_SIZE;
+}
+
+static void __wheel_cascade(uint32_t level)
+{
+    uint32_t idx = (s_timer_wheel.cur_tick >> WHEEL_LEVEL_SHIFT(level)) & WHEEL_LEVEL_MASK;
+    struct tuya_list_head *p = NULL;
+    struct tuya_list_head *n = NULL;
+    LIST_HEAD list;
+
+    // detach the slot first, timers may be attached to the same slot again
+    INIT_LIST_HEAD(&list);
+    tuya_list_for_each_safe(p, n, &(s_timer_wheel.slot[level][idx]))
+    {
+        tuya_list_del(p);
+        tuya_list_add_tail(p, &list);
+    }
+    s_timer_wheel.bitmap[level] &= ~(1ULL << idx);
+
+    tuya_list_for_each_safe(p, n, &list)
+    {
+        __timer_attach(tuya_list_entry(p, TIMER_T, node));
+    }
+}
+
+// the earliest tick at which the wheel has work to do, WHEEL_TICK_NONE if empty
+static uint64_t __wheel_next_tick(void)
+{
+    uint64_t next_tick = WHEEL_TICK_NONE;
+    uint64_t base = 0, tick = 0;
+    uint32_t level = 0, shift = 0, idx = 0, slot = 0;
+
+    for (level = 0; level < WHEEL_LEVEL_NUM; level++) {
+        // the first round at which this level is serviced, in units of the level
+        shift = WHEEL_LEVEL_SHIFT(level);
+        base = (s_timer_wheel.cur_tick + (1ULL << shift) - 1) >> shift;
+        idx = base & WHEEL_LEVEL_MASK;
+
+        slot = __wheel_slot_next(level, idx);
+        if (slot < WHEEL_LEVEL_SIZE) {
+            tick = (base + slot - idx) << shift;
+        } else {
+            slot = __wheel_slot_next(level, 0);
+            if (slot >= idx) {
+                continue;
+            }
+            tick = (base + WHEEL_LEVEL_SIZE - idx + slot) << shift;
+        }
+
+        if (tick < next_tick) {
+            next_tick = tick;
+        }
+    }
+
+    return next_tick;
+}
+
+static void __wheel_advance(uint64_t now)
+{
+    uint32_t idx = 0, next = 0, level = 0;
+    uint64_t tick = 0;
+    struct tuya_list_head *p = NULL;
+    struct tuya_list_head *n = NULL;
+
+    while (s_timer_wheel.cur_tick <= now) {
+        idx = s_timer_wheel.cur_tick & WHEEL_LEVEL_MASK;
+        if (0 == idx) {
+            for (level = 1; level < WHEEL_LEVEL_NUM; level++) {
+                __wheel_cascade(level);
+                if ((s_timer_wheel.cur_tick >> WHEEL_LEVEL_SHIFT(level)) & WHEEL_LEVEL_MASK) {
+                    break;
+                }
+            }
+        }
+
+        next = __wheel_slot_next(0, idx);
+        if (next >= WHEEL_LEVEL_SIZE) {
+            // nothing left in this round, jump over the empty rounds
+            tick = __wheel_next_tick();
+            if (tick > now) {
+                break;
+            }
+            s_timer_wheel.cur_tick = tick;
+            continue;
+        }
+
+        tick = (s_timer_wheel.cur_tick & ~((uint64_t)WHEEL_LEVEL_MASK)) + next;
+        if (tick > now) {
+            break;
+        }
+
+        tuya_list_for_each_safe(p, n, &(s_timer_wheel.slot[0][next]))
+        {
+            tuya_list_del(p);
+            tuya_list_add_tail(p, &(s_timer_wheel.list_expired));
+        }
+        s_timer_wheel.bitmap[0] &= ~(1ULL << next);
+        s_timer_wheel.cur_tick = tick + 1;
+    }
+
+    if (s_timer_wheel.cur_tick <= now) {
+        s_timer_wheel.cur_tick = now + 1;
+    }
+}
+
+static TIMER_T *__timer_expired_get(uint64_t nowMS, SYS_TIME_T *next_expired)
+{
+    uint64_t next_tick = 0;
+
+    __wheel_advance(nowMS);
+
+    if (!tuya_list_empty(&(s_timer_wheel.list_expired))) {
+        return tuya_list_entry(s_timer_wheel.list_expired.next, TIMER_T, node);
+    }
+
+    next_tick = __wheel_next_tick();
+    if (WHEEL_TICK_NONE != next_tick) {
+        *next_expired = (next_tick > nowMS) ? (next_tick - nowMS) : 0;
+    }
+
+    return NULL;
+}
+
+static void __timer_active_trigger(TIMER_T *timer)
+{
+    tuya_list_del(&(timer->node));
+    tuya_list_add(&(timer->node), &(s_timer_wheel.list_expired));
+}
+
+static void __timer_active_dump(void (*dump_list)(LIST_HEAD *list))
+{
+    uint32_t level, idx;
+
+    dump_list(&(s_timer_wheel.list_expired));
+    for (level = 0; level < WHEEL_LEVEL_NUM; level++) {
+        for (idx = 0; idx < WHEEL_LEVEL_SIZE; idx++) {
+            dump_list(&(s_timer_wheel.slot[level][idx]));
+        }
+    }
+}
+#else
+
 static void __timer_attach(TIMER_T *timer)
 {
     tuya_list_del(&(timer->node));
@@ -65,13 +294,58 @@ static void __timer_attach(TIMER_T *timer)
     }
 }
 
-static void __timer_dump(void)
+static TIMER_T *__timer_expired_get(uint64_t nowMS, SYS_TIME_T *next_expired)
+{
+    TIMER_T *timer = NULL;
+
+    if (tuya_list_empty(&(s_timer_mgr.list_active))) {
+        return NULL;
+    }
+
+    timer = tuya_list_entry(s_timer_mgr.list_active.next, TIMER_T, node);
+    if (timer->expire_time > nowMS) {
+        *next_expired = timer->expire_time - nowMS;
+        return NULL;
+    }
+
+    return timer;
+}
+
+static void __timer_active_trigger(TIMER_T *timer)
+{
+    tuya_list_del(&(timer->node));
+    tuya_list_add(&(timer->node), &(s_timer_mgr.list_active));
+}
+
+static void __timer_active_dump(void (*dump_list)(LIST_HEAD *list))
+{
+    dump_list(&(s_timer_mgr.list_active));
+}
+#endif
+
+static void __timer_dump_list(LIST_HEAD *list)
 {
     struct tuya_list_head *p = NULL;
     TIMER_T *timer = NULL;
     TAL_TIMER_CB *cb = NULL;
     TIMER_ID *timer_id = NULL;
 
+    tuya_list_for_each(p, list)
+    {
+        timer = tuya_list_entry(p, TIMER_T, node);
+        cb = &(timer->cb);
+        if (timer->data) {
+            timer_id = timer->data;
+            if (*timer_id == timer->timer_id) {
+                cb = (TAL_TIMER_CB *)((char *)timer->data + sizeof(TIMER_ID));
+            }
+        }
+        PR_NOTICE("%08x %d %d %p", timer->timer_id, timer->type, timer->interval, *cb);
+    }
+}
+
+static void __timer_dump(void)
+{
     TIME_S nowSecTime = 0;
     TIME_MS nowMsTime = 0;
 
@@ -86,32 +360,10 @@ static void __timer_dump(void)
     tal_mutex_lock(s_timer_mgr.mutex);
 
     PR_NOTICE("running timers count:%d", s_timer_mgr.running_cnt);
-    tuya_list_for_each(p, &(s_timer_mgr.list_active))
-    {
-        timer = tuya_list_entry(p, TIMER_T, node);
-        cb = &(timer->cb);
-        if (timer->data) {
-            timer_id = timer->data;
-            if (*timer_id == timer->timer_id) {
-                cb = (TAL_TIMER_CB *)((char *)timer->data + sizeof(TIMER_ID));
-            }
-        }
-        PR_NOTICE("%08x %d %d %p", timer->timer_id, timer->type, timer->interval, *cb);
-    }
+    __timer_active_dump(__timer_dump_list);
 
     PR_NOTICE("standby timers count:%d", s_timer_mgr.total_cnt - s_timer_mgr.running_cnt);
-    tuya_list_for_each(p, &(s_timer_mgr.list_standby))
-    {
-        timer = tuya_list_entry(p, TIMER_T, node);
-        cb = &(timer->cb);
-        if (timer->data) {
-            timer_id = timer->data;
-            if (*timer_id == timer->timer_id) {
-                cb = (TAL_TIMER_CB *)((char *)timer->data + sizeof(TIMER_ID));
-            }
-        }
-        PR_NOTICE("%08x %d %d %p", timer->timer_id, timer->type, timer->interval, *cb);
-    }
+    __timer_dump_list(&(s_timer_mgr.list_standby));
 
     tal_mutex_unlock(s_timer_mgr.mutex);
 }
@@ -123,7 +375,6 @@ static void __timer_dispatch(SYS_TIME_T *next_expired)
     uint64_t nowMS = 0;
     TIMER_T *timer = NULL;
     TAL_TIMER_CB timer_cb = NULL;
-    struct tuya_list_head *p = NULL;
 
     *next_expired = SEM_WAIT_FOREVER;
 
@@ -134,28 +385,19 @@ static void __timer_dispatch(SYS_TIME_T *next_expired)
         tal_mutex_lock(s_timer_mgr.mutex);
 
         timer_cb = NULL;
-        tuya_list_for_each(p, &(s_timer_mgr.list_active))
-        {
-            timer = tuya_list_entry(p, TIMER_T, node);
-
-            if (timer->expire_time > nowMS) {
-                p = &(s_timer_mgr.list_active);
-                *next_expired = timer->expire_time - nowMS;
+        timer = __timer_expired_get(nowMS, next_expired);
+        if (timer) {
+            timer_cb = timer->cb;
+
+            if (TAL_TIMER_ONCE == timer->type) {
+                timer->is_running = FALSE;
+                s_timer_mgr.running_cnt--;
+                tuya_list_del(&(timer->node));
+                tuya_list_add_tail(&(timer->node), &(s_timer_mgr.list_standby));
             } else {
-                timer_cb = timer->cb;
-
-                if (TAL_TIMER_ONCE == timer->type) {
-                    timer->is_running = FALSE;
-                    s_timer_mgr.running_cnt--;
-                    tuya_list_del(&(timer->node));
-                    tuya_list_add_tail(&(timer->node), &(s_timer_mgr.list_standby));
-                } else {
-                    timer->expire_time = nowMS + timer->interval;
-                    __timer_attach(timer);
-                }
+                timer->expire_time = nowMS + timer->interval;
+                __timer_attach(timer);
             }
-
-            break;
         }
 
         tal_mutex_unlock(s_timer_mgr.mutex);
@@ -163,10 +405,9 @@ static void __timer_dispatch(SYS_TIME_T *next_expired)
         if (timer_cb) {
             s_timer_mgr.last_cb = timer_cb;
             timer_cb(timer->timer_id, timer->data);
-            timer_cb = NULL;
             s_timer_mgr.last_cb = NULL;
         }
-    } while (p != &(s_timer_mgr.list_active));
+    } while (timer_cb);
 }
 
 static void __timer_thread_cb(void *data)
@@ -203,6 +444,12 @@ OPERATE_RET tal_sw_timer_init(void)
 
     INIT_LIST_HEAD(&(s_timer_mgr.list_active));
     INIT_LIST_HEAD(&(s_timer_mgr.list_standby));
+#if defined(ENABLE_SW_TIMER_WHEEL) && (ENABLE_SW_TIMER_WHEEL == 1)
+    TIME_S secTime = 0;
+    TIME_MS msTime = 0;
+    tal_time_get_system_time(&secTime, &msTime);
+    __wheel_init((uint64_t)secTime * 1000 + (uint64_t)msTime);
+#endif
 
     THREAD_CFG_T thread_cfg = {.stackDepth = STACK_SIZE_TIMERQ, .priority = THREAD_PRIO_0, .thrdname = "sys_timer"};
 
@@ -442,8 +689,7 @@ OPERATE_RET tal_sw_timer_trigger(TIMER_ID timer_id)
     tal_mutex_lock(s_timer_mgr.mutex);
     timer->expire_time = 0;
     if (timer->is_running) {
-        tuya_list_del(&(timer->node));
-        tuya_list_add(&(timer->node), &(s_timer_mgr.list_active));
+        __timer_active_trigger(timer);
     }
     tal_mutex_unlock(s_timer_mgr.mutex);
     tal_semaphore_post(s_timer_mgr.sem);
@@ -493,3 +739,101 @@ void tal_sw_timer_dump(void)
     __timer_dump();
     PR_NOTICE("---------timer queue dump end---------");
 }
+
+#if defined(ENABLE_SW_TIMER_BENCHMARK)
+#if defined(ENABLE_SW_TIMER_WHEEL) && (ENABLE_SW_TIMER_WHEEL == 1)
+#define SW_TIMER_BACKEND_NAME "wheel"
+#else
+#define SW_TIMER_BACKEND_NAME "list"
+#endif
+
+static volatile uint32_t s_bench_fired;
+
+static void __bench_timer_cb(TIMER_ID timer_id, void *arg)
+{
+    s_bench_fired++;
+}
+
+/**
+ * @brief Benchmark the software timer backend with start/stop/expire churn
+ *
+ * @param[in] timer_num: timer count, such as 10/100/1000
+ * @param[in] rounds: start/stop churn rounds
+ *
+ * @note run it on builds with and without ENABLE_SW_TIMER_WHEEL to compare backends
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_sw_timer_benchmark(uint32_t timer_num, uint32_t rounds)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TIMER_ID *timers = NULL;
+    SYS_TIME_T start_ms = 0, stop_ms = 0, expire_ms = 0, t0 = 0;
+    uint32_t i = 0, r = 0, ops = 0;
+
+    if (0 == timer_num || 0 == rounds) {
+        return OPRT_INVALID_PARM;
+    }
+
+    timers = (TIMER_ID *)tal_calloc(timer_num, sizeof(TIMER_ID));
+    if (NULL == timers) {
+        return OPRT_MALLOC_FAILED;
+    }
+
+    for (i = 0; i < timer_num; i++) {
+        rt = tal_sw_timer_create(__bench_timer_cb, NULL, &timers[i]);
+        if (OPRT_OK != rt) {
+            goto __EXIT;
+        }
+    }
+
+    // restart churn, the timers never expire during the measurement
+    t0 = tal_system_get_millisecond();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < timer_num; i++) {
+            tal_sw_timer_start(timers[i], 60000 + tal_system_get_random(60000), TAL_TIMER_CYCLE);
+        }
+    }
+    start_ms = tal_system_get_millisecond() - t0;
+
+    t0 = tal_system_get_millisecond();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < timer_num; i++) {
+            tal_sw_timer_stop(timers[i]);
+            tal_sw_timer_start(timers[i], 60000 + tal_system_get_random(60000), TAL_TIMER_CYCLE);
+        }
+    }
+    stop_ms = tal_system_get_millisecond() - t0;
+
+    for (i = 0; i < timer_num; i++) {
+        tal_sw_timer_stop(timers[i]);
+    }
+
+    // expire churn, all timers are due within 100ms
+    s_bench_fired = 0;
+    t0 = tal_system_get_millisecond();
+    for (i = 0; i < timer_num; i++) {
+        tal_sw_timer_start(timers[i], 1 + (i % 100), TAL_TIMER_ONCE);
+    }
+    while (s_bench_fired < timer_num && (tal_system_get_millisecond() - t0) < 5000) {
+        tal_system_sleep(1);
+    }
+    expire_ms = tal_system_get_millisecond() - t0;
+
+    ops = timer_num * rounds;
+    PR_NOTICE("sw timer bench[%s] num:%d start:%dus/op restart:%dus/op expire:%d/%d in %dms", SW_TIMER_BACKEND_NAME,
+              timer_num, (uint32_t)(start_ms * 1000 / ops), (uint32_t)(stop_ms * 1000 / ops), s_bench_fired,
+              timer_num, (uint32_t)expire_ms);
+
+__EXIT:
+    for (i = 0; i < timer_num; i++) {
+        if (timers[i]) {
+            tal_sw_timer_delete(timers[i]);
+        }
+    }
+    tal_free(timers);
+
+    return rt;
+}
+#endif
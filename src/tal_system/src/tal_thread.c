@@ -259,6 +259,7 @@ static void __WrapRunFunc(void *pArg)
         pThrdManage->exit();
     }
     PR_DEBUG("Thread:%s Exec Finish. Set to Del Stat", pThrdManage->thread_name);
+    tal_log_async_thread_exit();
     tal_mutex_lock(s_del_thrd_mag->mutex);
     pThrdManage->thrdRunSta = THREAD_STATE_DELETE;
     tal_mutex_unlock(s_del_thrd_mag->mutex);
@@ -16,6 +16,8 @@
  * - Implementation of the work queue thread callback for task execution.
  * - Synchronization mechanisms to ensure thread-safe operation and task
  * execution.
+ * - Multi-worker variant with priority lanes, batched dequeue, O(1) cancel
+ * by work handle and queue statistics.
  *
  * The implementation leverages Tuya's infrastructure components, such as
  * queues, threads, and semaphores, to provide a robust and efficient work queue
@@ -32,7 +34,9 @@
  */
 
 #include "tuya_queue.h"
+#include "tuya_list.h"
 #include "tal_log.h"
+#include "tal_mutex.h"
 #include "tal_memory.h"
 #include "tal_thread.h"
 #include "tal_system.h"
@@ -40,11 +44,46 @@
 #include "tal_workqueue.h"
 #include "tal_sw_timer.h"
 
+#define WORKQ_STALL_MS 5000 // report the worker if a callback runs longer than this
+
+typedef struct {
+    LIST_HEAD node;
+    WORK_ITEM_T item;
+    SYS_TIME_T enqueue_ms;
+    uint16_t gen; // increased on every use, makes the stale work handle invalid
+    uint8_t prio;
+    uint8_t queued;
+} WORKQ_NODE_T;
+
+typedef struct {
+    THREAD_HANDLE thread;
+    void *workqueue;
+    WORKQUEUE_CB last_cb; // used to debug which cb is blocked
+    SYS_TIME_T start_ms;
+} WORKQ_WORKER_T;
+
+typedef struct {
+    MUTEX_HANDLE mutex;
+    SEM_HANDLE sem;
+    LIST_HEAD lane[WORKQ_PRIO_NUM];
+    LIST_HEAD free_list;
+    WORKQ_NODE_T *nodes;
+    uint16_t queue_len;
+    uint16_t used_num;
+    uint8_t batch_num;
+    uint8_t worker_num;
+    uint8_t idle_num; // workers waiting on sem, sem is posted only when someone is idle
+    BOOL_T stop;
+    WORKQUEUE_STAT_T stat;
+    WORKQ_WORKER_T worker[WORKQ_WORKER_MAX];
+} WORKQ_MULTI_T;
+
 typedef struct {
     TUYA_QUEUE_HANDLE queue;
     THREAD_HANDLE thread;
     SEM_HANDLE sem;
     WORKQUEUE_CB last_cb; // used to debug which cb is blocked
+    WORKQ_MULTI_T *multi; // multi-worker workqueue, NULL for the single thread one
 } TAL_WORKQUEUE_T;
 
 static void __work_thread_cb(void *data)
@@ -97,6 +136,200 @@ static BOOL_T __work_cancel_traverse(void *item, void *ctx)
     return TRUE;
 }
 
+static void __multi_latency_record(WORKQ_MULTI_T *multi, uint32_t latency)
+{
+    static const uint32_t bucket_ms[WORKQ_LATENCY_BUCKET_NUM - 1] = {1, 5, 10, 50, 100, 500, 1000};
+    uint32_t i = 0;
+
+    for (i = 0; i < WORKQ_LATENCY_BUCKET_NUM - 1; i++) {
+        if (latency < bucket_ms[i]) {
+            break;
+        }
+    }
+    multi->stat.latency_hist[i]++;
+}
+
+static void __multi_node_free(WORKQ_MULTI_T *multi, WORKQ_NODE_T *work_node)
+{
+    tuya_list_del(&work_node->node);
+    multi->stat.depth[work_node->prio]--;
+    multi->used_num--;
+    work_node->queued = FALSE;
+    work_node->item.cb = NULL;
+    tuya_list_add_tail(&work_node->node, &multi->free_list);
+}
+
+static void __multi_work_thread_cb(void *data)
+{
+    WORKQ_WORKER_T *worker = (WORKQ_WORKER_T *)data;
+    WORKQ_MULTI_T *multi = ((TAL_WORKQUEUE_T *)worker->workqueue)->multi;
+    WORK_ITEM_T batch[WORKQ_BATCH_MAX];
+    WORKQ_NODE_T *work_node = NULL;
+    SYS_TIME_T now = 0;
+    uint32_t i = 0, num = 0, prio = 0, skip = 0;
+
+    while (THREAD_STATE_RUNNING == tal_thread_get_state(worker->thread)) {
+        // dequeue a batch in one lock, higher lane first
+        tal_mutex_lock(multi->mutex);
+        if (multi->stop) {
+            tal_mutex_unlock(multi->mutex);
+            break;
+        }
+
+        num = 0;
+        now = tal_system_get_millisecond();
+        for (prio = 0; prio < WORKQ_PRIO_NUM && num < multi->batch_num; prio++) {
+            while (num < multi->batch_num && !tuya_list_empty(&multi->lane[prio])) {
+                work_node = tuya_list_entry(multi->lane[prio].next, WORKQ_NODE_T, node);
+                batch[num++] = work_node->item;
+                __multi_latency_record(multi, (uint32_t)(now - work_node->enqueue_ms));
+                __multi_node_free(multi, work_node);
+            }
+        }
+
+        if (0 == num) {
+            multi->idle_num++;
+            tal_mutex_unlock(multi->mutex);
+            tal_semaphore_wait(multi->sem, SEM_WAIT_FOREVER);
+            continue;
+        }
+        tal_mutex_unlock(multi->mutex);
+
+        skip = 0;
+        for (i = 0; i < num; i++) {
+            if (NULL == batch[i].cb) {
+                skip++;
+                continue;
+            }
+            worker->start_ms = tal_system_get_millisecond();
+            worker->last_cb = batch[i].cb;
+            batch[i].cb(batch[i].data);
+            worker->last_cb = NULL;
+        }
+
+        tal_mutex_lock(multi->mutex);
+        multi->stat.done_cnt += num - skip;
+        multi->stat.cancel_cnt += skip;
+        tal_mutex_unlock(multi->mutex);
+    }
+}
+
+static OPERATE_RET __multi_schedule(TAL_WORKQUEUE_T *workqueue, WORKQUEUE_CB cb, void *data, WORKQ_PRIO_E prio,
+                                    BOOL_T instant, WORK_HANDLE *work)
+{
+    WORKQ_MULTI_T *multi = workqueue->multi;
+    WORKQ_NODE_T *work_node = NULL;
+    BOOL_T wakeup = FALSE;
+
+    if (prio >= WORKQ_PRIO_NUM) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(multi->mutex);
+    if (tuya_list_empty(&multi->free_list)) {
+        tal_mutex_unlock(multi->mutex);
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+
+    work_node = tuya_list_entry(multi->free_list.next, WORKQ_NODE_T, node);
+    tuya_list_del(&work_node->node);
+    work_node->item.cb = cb;
+    work_node->item.data = data;
+    work_node->enqueue_ms = tal_system_get_millisecond();
+    work_node->prio = prio;
+    work_node->queued = TRUE;
+    if (++work_node->gen == 0) {
+        work_node->gen = 1;
+    }
+
+    if (instant) {
+        tuya_list_add(&work_node->node, &multi->lane[prio]);
+    } else {
+        tuya_list_add_tail(&work_node->node, &multi->lane[prio]);
+    }
+    multi->stat.depth[prio]++;
+    if (++multi->used_num > multi->stat.depth_max) {
+        multi->stat.depth_max = multi->used_num;
+    }
+
+    if (multi->idle_num) {
+        multi->idle_num--;
+        wakeup = TRUE;
+    }
+
+    if (work) {
+        *work = ((uint32_t)work_node->gen << 16) | (uint32_t)(work_node - multi->nodes);
+    }
+    tal_mutex_unlock(multi->mutex);
+
+    if (wakeup) {
+        tal_semaphore_post(multi->sem);
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __multi_traverse(WORKQ_MULTI_T *multi, WORKQUEUE_TRAVERSE_CB cb, void *ctx, BOOL_T is_cancel)
+{
+    struct tuya_list_head *p = NULL;
+    struct tuya_list_head *n = NULL;
+    WORKQ_NODE_T *work_node = NULL;
+    uint32_t prio = 0;
+
+    tal_mutex_lock(multi->mutex);
+    for (prio = 0; prio < WORKQ_PRIO_NUM; prio++) {
+        tuya_list_for_each_safe(p, n, &multi->lane[prio])
+        {
+            work_node = tuya_list_entry(p, WORKQ_NODE_T, node);
+            if (!cb(&work_node->item, ctx)) {
+                tal_mutex_unlock(multi->mutex);
+                return OPRT_OK;
+            }
+
+            // canceled item is removed instead of running a NULL callback
+            if (is_cancel && NULL == work_node->item.cb) {
+                __multi_node_free(multi, work_node);
+                multi->stat.cancel_cnt++;
+            }
+        }
+    }
+    tal_mutex_unlock(multi->mutex);
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __multi_release(TAL_WORKQUEUE_T *workqueue)
+{
+    WORKQ_MULTI_T *multi = workqueue->multi;
+    uint32_t i = 0, count = 1;
+
+    tal_mutex_lock(multi->mutex);
+    multi->stop = TRUE;
+    tal_mutex_unlock(multi->mutex);
+
+    for (i = 0; i < multi->worker_num; i++) {
+        tal_thread_delete(multi->worker[i].thread);
+        tal_semaphore_post(multi->sem);
+    }
+
+    for (i = 0; i < multi->worker_num; i++) {
+        while (THREAD_STATE_DELETE != tal_thread_get_state(multi->worker[i].thread)) {
+            tal_system_sleep(10);
+            if ((count++) % 500 == 0) {
+                PR_NOTICE("%p still running", multi->worker[i].thread);
+            }
+        }
+    }
+
+    tal_semaphore_release(multi->sem);
+    tal_mutex_release(multi->mutex);
+    tal_free(multi->nodes);
+    tal_free(multi);
+    tal_free(workqueue);
+
+    return OPRT_OK;
+}
+
 /**
  * @brief create and initialize a workqueue which runs in thread context
  *
@@ -147,6 +380,185 @@ OPERATE_RET tal_workqueue_create(const uint16_t queue_len, THREAD_CFG_T *thread_
     return op_ret;
 }
 
+/**
+ * @brief create a workqueue with multiple worker threads and priority lanes
+ *
+ * @param[in] cfg the workqueue config
+ * @param[out] handle the workqueue handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_create_multi(const WORKQUEUE_MULTI_CFG_T *cfg, WORKQUEUE_HANDLE *handle)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+    TAL_WORKQUEUE_T *workqueue = NULL;
+    WORKQ_MULTI_T *multi = NULL;
+    uint32_t i = 0;
+
+    if ((NULL == cfg) || (NULL == handle) || (0 == cfg->queue_len) || (0 == cfg->worker_num) ||
+        (cfg->worker_num > WORKQ_WORKER_MAX) || (0 == cfg->batch_num) || (cfg->batch_num > WORKQ_BATCH_MAX)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    workqueue = (TAL_WORKQUEUE_T *)tal_calloc(1, sizeof(TAL_WORKQUEUE_T));
+    multi = (WORKQ_MULTI_T *)tal_calloc(1, sizeof(WORKQ_MULTI_T));
+    if (multi) {
+        multi->nodes = (WORKQ_NODE_T *)tal_calloc(cfg->queue_len, sizeof(WORKQ_NODE_T));
+    }
+    if ((NULL == workqueue) || (NULL == multi) || (NULL == multi->nodes)) {
+        op_ret = OPRT_MALLOC_FAILED;
+        goto __ERR;
+    }
+
+    for (i = 0; i < WORKQ_PRIO_NUM; i++) {
+        INIT_LIST_HEAD(&multi->lane[i]);
+    }
+    INIT_LIST_HEAD(&multi->free_list);
+    for (i = 0; i < cfg->queue_len; i++) {
+        tuya_list_add_tail(&multi->nodes[i].node, &multi->free_list);
+    }
+    multi->queue_len = cfg->queue_len;
+    multi->batch_num = cfg->batch_num;
+    multi->stat.worker_num = cfg->worker_num;
+    workqueue->multi = multi;
+
+    op_ret = tal_mutex_create_init(&multi->mutex);
+    if (OPRT_OK != op_ret) {
+        goto __ERR;
+    }
+
+    op_ret = tal_semaphore_create_init(&multi->sem, 0, cfg->worker_num);
+    if (OPRT_OK != op_ret) {
+        tal_mutex_release(multi->mutex);
+        goto __ERR;
+    }
+
+    for (i = 0; i < cfg->worker_num; i++) {
+        multi->worker[i].workqueue = workqueue;
+        op_ret = tal_thread_create_and_start(&multi->worker[i].thread, NULL, NULL, __multi_work_thread_cb,
+                                             &multi->worker[i], &cfg->thread_cfg);
+        if (OPRT_OK != op_ret) {
+            // release the started workers
+            multi->worker_num = i;
+            __multi_release(workqueue);
+            return op_ret;
+        }
+    }
+    multi->worker_num = cfg->worker_num;
+    workqueue->thread = multi->worker[0].thread;
+
+    *handle = workqueue;
+
+    return OPRT_OK;
+
+__ERR:
+    if (multi) {
+        tal_free(multi->nodes);
+        tal_free(multi);
+    }
+    tal_free(workqueue);
+
+    return op_ret;
+}
+
+/**
+ * @brief put work task in the priority lane of a multi-worker workqueue
+ *
+ * @param[in] handle the workqueue handle
+ * @param[in] cb the work callback
+ * @param[in] data the work data
+ * @param[in] prio the priority lane
+ * @param[out] work handle used to cancel the work, can be NULL
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_schedule_prio(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb, void *data, WORKQ_PRIO_E prio,
+                                        WORK_HANDLE *work)
+{
+    if ((NULL == handle) || (NULL == cb)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
+    if (NULL == workqueue->multi) {
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    return __multi_schedule(workqueue, cb, data, prio, FALSE, work);
+}
+
+/**
+ * @brief cancel the work by handle
+ *
+ * @param[in] handle the workqueue handle
+ * @param[in] work the work handle
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND if the work has been dequeued.
+ */
+OPERATE_RET tal_workqueue_cancel_work(WORKQUEUE_HANDLE handle, WORK_HANDLE work)
+{
+    if ((NULL == handle) || (0 == work)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
+    WORKQ_MULTI_T *multi = workqueue->multi;
+    uint32_t index = work & 0xFFFF;
+    OPERATE_RET op_ret = OPRT_NOT_FOUND;
+
+    if ((NULL == multi) || (index >= multi->queue_len)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(multi->mutex);
+    if (multi->nodes[index].queued && (multi->nodes[index].gen == (work >> 16))) {
+        __multi_node_free(multi, &multi->nodes[index]);
+        multi->stat.cancel_cnt++;
+        op_ret = OPRT_OK;
+    }
+    tal_mutex_unlock(multi->mutex);
+
+    return op_ret;
+}
+
+/**
+ * @brief get the statistics of a multi-worker workqueue
+ *
+ * @param[in] handle the workqueue handle
+ * @param[out] stat the statistics
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_stat_get(WORKQUEUE_HANDLE handle, WORKQUEUE_STAT_T *stat)
+{
+    if ((NULL == handle) || (NULL == stat)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
+    WORKQ_MULTI_T *multi = workqueue->multi;
+    SYS_TIME_T now = tal_system_get_millisecond();
+    uint32_t i = 0;
+
+    if (NULL == multi) {
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    tal_mutex_lock(multi->mutex);
+    *stat = multi->stat;
+    tal_mutex_unlock(multi->mutex);
+
+    for (i = 0; i < multi->worker_num; i++) {
+        stat->last_cb[i] = multi->worker[i].last_cb;
+        stat->run_ms[i] = stat->last_cb[i] ? (uint32_t)(now - multi->worker[i].start_ms) : 0;
+    }
+
+    return OPRT_OK;
+}
+
 /**
  * @brief put work task in workqueue
  *
@@ -168,6 +580,10 @@ OPERATE_RET tal_workqueue_schedule(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb, voi
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
     WORK_ITEM_T work_item = {.cb = cb, .data = data};
 
+    if (workqueue->multi) {
+        return __multi_schedule(workqueue, cb, data, WORKQ_PRIO_NORMAL, FALSE, NULL);
+    }
+
     op_ret = tuya_queue_input(workqueue->queue, &work_item);
     if (OPRT_OK == op_ret) {
         op_ret = tal_semaphore_post(workqueue->sem);
@@ -197,6 +613,10 @@ OPERATE_RET tal_workqueue_schedule_instant(WORKQUEUE_HANDLE handle, WORKQUEUE_CB
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
     WORK_ITEM_T work_item = {.cb = cb, .data = data};
 
+    if (workqueue->multi) {
+        return __multi_schedule(workqueue, cb, data, WORKQ_PRIO_HIGH, TRUE, NULL);
+    }
+
     op_ret = tuya_queue_input_instant(workqueue->queue, &work_item);
     if (OPRT_OK == op_ret) {
         op_ret = tal_semaphore_post(workqueue->sem);
@@ -224,6 +644,10 @@ OPERATE_RET tal_workqueue_cancel(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb, void
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
     WORK_ITEM_T work_item = {.cb = cb, .data = data};
 
+    if (workqueue->multi) {
+        return __multi_traverse(workqueue->multi, (WORKQUEUE_TRAVERSE_CB)__work_cancel_traverse, &work_item, TRUE);
+    }
+
     return tuya_queue_traverse(workqueue->queue, __work_cancel_traverse, &work_item);
 }
 
@@ -244,6 +668,10 @@ OPERATE_RET tal_workqueue_traverse(WORKQUEUE_HANDLE handle, WORKQUEUE_TRAVERSE_C
     }
 
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
+    if (workqueue->multi) {
+        return __multi_traverse(workqueue->multi, cb, ctx, FALSE);
+    }
+
     return tuya_queue_traverse(workqueue->queue, (TRAVERSE_CB)cb, ctx);
 }
 
@@ -262,6 +690,22 @@ uint16_t tal_workqueue_get_num(WORKQUEUE_HANDLE handle)
 
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
 
+    if (workqueue->multi) {
+        WORKQ_MULTI_T *multi = workqueue->multi;
+        SYS_TIME_T now = tal_system_get_millisecond();
+        uint16_t used_num = 0;
+        for (uint32_t i = 0; i < multi->worker_num; i++) {
+            if (multi->worker[i].last_cb && (now - multi->worker[i].start_ms) > WORKQ_STALL_MS) {
+                PR_NOTICE("%p:last_cb %p stall %dms", multi->worker[i].thread, multi->worker[i].last_cb,
+                          (uint32_t)(now - multi->worker[i].start_ms));
+            }
+        }
+        tal_mutex_lock(multi->mutex);
+        used_num = multi->used_num;
+        tal_mutex_unlock(multi->mutex);
+        return used_num;
+    }
+
     if (workqueue->last_cb) {
         PR_NOTICE("%p:last_cb %p", workqueue->thread, workqueue->last_cb);
     }
@@ -287,6 +731,10 @@ OPERATE_RET tal_workqueue_release(WORKQUEUE_HANDLE handle)
     uint32_t count = 1;
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
 
+    if (workqueue->multi) {
+        return __multi_release(workqueue);
+    }
+
     op_ret = tal_thread_delete(workqueue->thread);
     if (OPRT_OK != op_ret) {
         return op_ret;
@@ -70,6 +70,17 @@ typedef struct {
     AI_INPUT_SEND_T send[AI_BIZ_MAX_NUM];
 } AI_INPUT_CFG_T;
 
+typedef struct {
+    /** uploads measured since init */
+    uint32_t count;
+    /** last latency in ms */
+    uint32_t last_ms;
+    /** average latency in ms */
+    uint32_t avg_ms;
+    /** max latency in ms */
+    uint32_t max_ms;
+} AI_INPUT_LATENCY_T;
+
 /**
  * @brief ai input start
  * @param[in] force force start new session(break old session)
@@ -179,6 +190,19 @@ typedef void(*AI_ALERT_FB_CB)(AI_CLOUD_ALERT_TYPE_E type);
  */
 OPERATE_RET tuya_ai_input_alert(AI_CLOUD_ALERT_TYPE_E type, AI_ALERT_FB_CB cb);
 
+/**
+ * @brief get the latency from an input call to the socket write of its data
+ *
+ * @param[in] type AI_PT_AUDIO / AI_PT_VIDEO / AI_PT_IMAGE / AI_PT_TEXT / AI_PT_FILE
+ * @param[out] stat latency statistics
+ *
+ * @note audio is measured from tuya_ai_audio_input to the upload of the merged
+ * frames, including encoding. tuya_ai_audio_input_direct is not measured.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tuya_ai_input_get_latency(AI_PACKET_PT type, AI_INPUT_LATENCY_T *stat);
+
 /**
  * @brief check ai input is started
  *
@@ -20,7 +20,7 @@
 #include "tal_thread.h"
 #include "tal_system.h"
 #include "tal_mutex.h"
-#include "tuya_ringbuf.h"
+#include "tal_semaphore.h"
 #include "uni_log.h"
 #include "tuya_ai_agent.h"
 #include "tuya_ai_biz.h"
@@ -42,10 +42,15 @@
 #define AI_INPUT_BUF_SIZE (6*1024)
 #endif
 
+// idle wake up of the input thread, the rings wake it at once
 #define AI_INPUT_TASK_DELAY   (80)
+#define AI_INPUT_STOPPING_DELAY (10)
 
 #define AI_ALERT_DEFAULT_TIMEOUT   (1500) // ms
 
+#define AI_INPUT_LOAD(p)     __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define AI_INPUT_STORE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
 typedef enum {
     /** alert idle state */
     AI_ALERT_IDLE = 0,
@@ -62,13 +67,49 @@ typedef struct {
     AI_CLOUD_ALERT_TYPE_E type;
 } AI_ALERT_CTX_T;
 
+/* audio comes first, the others are served round robin between audio uploads */
+typedef enum {
+    AI_INPUT_RING_AUDIO = 0,
+    AI_INPUT_RING_VIDEO,
+    AI_INPUT_RING_IMAGE,
+    AI_INPUT_RING_TEXT,
+    AI_INPUT_RING_FILE,
+    AI_INPUT_RING_NUM
+} AI_INPUT_RING_E;
+
+typedef struct {
+    AI_RINGBUF_HEAD_T head;
+    SYS_TIME_T ts;  // time the record was queued
+    uint8_t *ref;   // payload kept by the waiting caller, NULL if it follows the record
+} AI_INPUT_REC_T;
+
+/*
+ * single producer single consumer ring of records, the input thread is
+ * the only consumer. Audio is copied into the ring, the other media are
+ * large and the caller already blocks until they are sent, so only the
+ * record is queued and the caller waits on done.
+ */
+typedef struct {
+    uint8_t *buf;
+    uint32_t size;
+    uint32_t wr;           // advanced by the producer only
+    uint32_t rd;           // advanced by the input thread only
+    MUTEX_HANDLE wr_mutex; // producers of one media take turns
+    SEM_HANDLE done;       // NULL if the payload is copied
+    OPERATE_RET done_rt;
+    uint64_t lat_sum;
+    AI_INPUT_LATENCY_T lat;
+} AI_INPUT_RING_T;
+
 typedef struct {
     THREAD_HANDLE thread;
     AI_INPUT_STATE_E state;
-    TUYA_RINGBUFF_T ringbuf;
+    AI_INPUT_RING_T ring[AI_INPUT_RING_NUM];
+    uint8_t rr;
     uint32_t lazy_input;
     MUTEX_HANDLE mutex;
     QUEUE_HANDLE queue;
+    SEM_HANDLE wake;
     char *input_buf;
     bool terminate;
     bool queue_sync;
@@ -78,85 +119,246 @@ STATIC AI_INPUT_CTX_T ai_input_ctx;
 
 STATIC VOID_T __alert_timeout_cb(TIMER_ID timer_id, VOID_T *arg);
 
-OPERATE_RET tuya_ai_input_write(AI_RINGBUF_HEAD_T *head, uint8_t *data)
+STATIC AI_INPUT_RING_T *__ai_input_ring_get(AI_PACKET_PT type)
 {
-    uint32_t rt = 0;
-    // if ((ai_input_ctx.state != AI_INPUT_PROC) && (ai_input_ctx.state != AI_INPUT_STOPPING)) {
-    //     return OPRT_OK;
-    // }
+    switch (type) {
+    case AI_PT_AUDIO:
+        return &ai_input_ctx.ring[AI_INPUT_RING_AUDIO];
+    case AI_PT_VIDEO:
+        return &ai_input_ctx.ring[AI_INPUT_RING_VIDEO];
+    case AI_PT_IMAGE:
+        return &ai_input_ctx.ring[AI_INPUT_RING_IMAGE];
+    case AI_PT_TEXT:
+        return &ai_input_ctx.ring[AI_INPUT_RING_TEXT];
+    case AI_PT_FILE:
+        return &ai_input_ctx.ring[AI_INPUT_RING_FILE];
+    default:
+        return NULL;
+    }
+}
 
-    if (data == NULL || head->len == 0) {
-        return OPRT_OK;
+STATIC uint32_t __ai_input_ring_copy_in(AI_INPUT_RING_T *ring, uint32_t pos, const VOID *data, uint32_t len)
+{
+    uint32_t part = ring->size - pos;
+    if (part > len) {
+        part = len;
     }
-    if (head->len > AI_INPUT_BUF_SIZE) {
-        PR_ERR("input data len is too long %d, type:%d", head->len, head->type);
-        return OPRT_INVALID_PARM;
+    memcpy(ring->buf + pos, data, part);
+    memcpy(ring->buf, (const uint8_t *)data + part, len - part);
+    return (pos + len) % ring->size;
+}
+
+STATIC uint32_t __ai_input_ring_copy_out(AI_INPUT_RING_T *ring, uint32_t pos, VOID *data, uint32_t len)
+{
+    uint32_t part = ring->size - pos;
+    if (part > len) {
+        part = len;
     }
+    if (data) {
+        memcpy(data, ring->buf + pos, part);
+        memcpy((uint8_t *)data + part, ring->buf, len - part);
+    }
+    return (pos + len) % ring->size;
+}
 
-    tal_mutex_lock(ai_input_ctx.mutex);
-    uint32_t free_size = tuya_ring_buff_free_size_get(ai_input_ctx.ringbuf);
-    if (free_size < (SIZEOF(AI_RINGBUF_HEAD_T) + head->len)) {
-        tal_mutex_unlock(ai_input_ctx.mutex);
+// producer side, called with wr_mutex held
+STATIC OPERATE_RET __ai_input_ring_put(AI_INPUT_RING_T *ring, AI_RINGBUF_HEAD_T *head, uint8_t *data)
+{
+    AI_INPUT_REC_T rec;
+    uint32_t wr = ring->wr;
+    uint32_t rd = AI_INPUT_LOAD(&ring->rd);
+    uint32_t used = (wr + ring->size - rd) % ring->size;
+    uint32_t need = SIZEOF(rec) + (ring->done ? 0 : head->len);
+
+    if (ring->size - 1 - used < need) {
         return OPRT_RESOURCE_NOT_READY;
     }
-    rt = tuya_ring_buff_write(ai_input_ctx.ringbuf, (VOID_T *)head, SIZEOF(AI_RINGBUF_HEAD_T));
-    if (rt != SIZEOF(AI_RINGBUF_HEAD_T)) {
-        PR_ERR("input ring buf write head failed %d %d", rt, SIZEOF(AI_RINGBUF_HEAD_T));
-        goto EXIT;
-    }
-    rt = tuya_ring_buff_write(ai_input_ctx.ringbuf, data, head->len);
-    if (rt != head->len) {
-        PR_ERR("ring buf write pbuf failed %d %d", rt, head->len);
-        goto EXIT;
+    memcpy(&rec.head, head, SIZEOF(rec.head));
+    rec.ts = tal_system_get_millisecond();
+    rec.ref = ring->done ? data : NULL;
+    wr = __ai_input_ring_copy_in(ring, wr, &rec, SIZEOF(rec));
+    if (NULL == rec.ref) {
+        wr = __ai_input_ring_copy_in(ring, wr, data, head->len);
     }
-    tal_mutex_unlock(ai_input_ctx.mutex);
+    AI_INPUT_STORE(&ring->wr, wr);
     return OPRT_OK;
+}
 
-EXIT:
-    tuya_ring_buff_reset(ai_input_ctx.ringbuf);
-    ai_input_ctx.state = AI_INPUT_STOP;
-    tal_mutex_unlock(ai_input_ctx.mutex);
-    return OPRT_COM_ERROR;
+// consumer side, look at the oldest record
+STATIC bool __ai_input_ring_peek(AI_INPUT_RING_T *ring, AI_INPUT_REC_T *rec)
+{
+    if (NULL == ring->buf || AI_INPUT_LOAD(&ring->wr) == ring->rd) {
+        return FALSE;
+    }
+    __ai_input_ring_copy_out(ring, ring->rd, rec, SIZEOF(*rec));
+    return TRUE;
 }
 
-OPERATE_RET tuya_ai_input_read(AI_RINGBUF_HEAD_T *head, char *buf)
+// consumer side, drop the peeked record, its copied payload goes to buf if not NULL
+STATIC VOID __ai_input_ring_pop(AI_INPUT_RING_T *ring, AI_INPUT_REC_T *rec, char *buf)
+{
+    uint32_t rd = (ring->rd + SIZEOF(*rec)) % ring->size;
+    if (NULL == rec->ref) {
+        rd = __ai_input_ring_copy_out(ring, rd, buf, rec->head.len);
+    }
+    AI_INPUT_STORE(&ring->rd, rd);
+}
+
+// consumer side, waiting callers get OPRT_COM_ERROR
+STATIC VOID __ai_input_ring_reset(AI_INPUT_RING_T *ring)
+{
+    AI_INPUT_REC_T rec;
+    while (__ai_input_ring_peek(ring, &rec)) {
+        __ai_input_ring_pop(ring, &rec, NULL);
+        if (rec.ref) {
+            ring->done_rt = OPRT_COM_ERROR;
+            tal_semaphore_post(ring->done);
+        }
+    }
+}
+
+STATIC VOID __ai_input_latency_add(AI_INPUT_RING_T *ring, SYS_TIME_T ts)
+{
+    uint32_t ms = (uint32_t)(tal_system_get_millisecond() - ts);
+    ring->lat.last_ms = ms;
+    if (ms > ring->lat.max_ms) {
+        ring->lat.max_ms = ms;
+    }
+    ring->lat_sum += ms;
+    ring->lat.count++;
+    ring->lat.avg_ms = (uint32_t)(ring->lat_sum / ring->lat.count);
+}
+
+OPERATE_RET tuya_ai_input_write(AI_RINGBUF_HEAD_T *head, uint8_t *data)
 {
     OPERATE_RET rt = OPRT_OK;
-    uint32_t read_len = 0, total_len = 0;
+    AI_INPUT_RING_T *ring = __ai_input_ring_get(head->type);
 
-    if (ai_input_ctx.ringbuf == NULL) {
-        PR_ERR("ring buffer is not initialized");
-        return OPRT_COM_ERROR;
+    if (data == NULL || head->len == 0) {
+        return OPRT_OK;
+    }
+    if (ring == NULL || ring->buf == NULL) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+    if (NULL == ring->done && head->len > AI_INPUT_BUF_SIZE) {
+        PR_ERR("input data len is too long %d, type:%d", head->len, head->type);
+        return OPRT_INVALID_PARM;
     }
 
-    tal_mutex_lock(ai_input_ctx.mutex);
-    while (total_len < AI_INPUT_BUF_SIZE) {
-        if (ai_input_ctx.state == AI_INPUT_STOP) {
-            break;
+    tal_mutex_lock(ring->wr_mutex);
+    rt = __ai_input_ring_put(ring, head, data);
+    if (OPRT_OK == rt) {
+        tal_semaphore_post(ai_input_ctx.wake);
+        if (ring->done) {
+            // the input thread owns data until it posts done
+            tal_semaphore_wait_forever(ring->done);
+            rt = ring->done_rt;
         }
-        read_len = tuya_ring_buff_peek(ai_input_ctx.ringbuf, (VOID_T *)head, SIZEOF(AI_RINGBUF_HEAD_T));
-        if (read_len != SIZEOF(AI_RINGBUF_HEAD_T)) {
+    }
+    tal_mutex_unlock(ring->wr_mutex);
+    return rt;
+}
+
+STATIC OPERATE_RET __ai_input_post(AI_PACKET_PT type, AI_BIZ_HD_T *biz, uint8_t *data, uint32_t len, uint32_t total_len)
+{
+    BOOL_T self = FALSE;
+    AI_RINGBUF_HEAD_T head = {0};
+
+    if (!tuya_ai_input_is_started()) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+    // callbacks run on the input thread can not wait for it
+    tal_thread_is_self(ai_input_ctx.thread, &self);
+    if (self || data == NULL || len == 0) {
+        return tuya_ai_agent_upload_stream(type, biz, (char *)data, len, total_len);
+    }
+    head.type = type;
+    head.len = len;
+    head.total_len = total_len;
+    if (biz) {
+        memcpy(&head.biz, biz, SIZEOF(head.biz));
+    }
+    return tuya_ai_input_write(&head, data);
+}
+
+// merge queued audio up to AI_INPUT_BUF_SIZE and upload it
+STATIC OPERATE_RET __ai_input_upload_audio(VOID)
+{
+    AI_INPUT_RING_T *ring = &ai_input_ctx.ring[AI_INPUT_RING_AUDIO];
+    AI_INPUT_REC_T rec, first;
+    uint32_t total_len = 0;
+
+    while (ai_input_ctx.state != AI_INPUT_STOP && __ai_input_ring_peek(ring, &rec)) {
+        if (rec.head.len + total_len > AI_INPUT_BUF_SIZE) {
             break;
         }
-        if (head->len + total_len > AI_INPUT_BUF_SIZE) {
-            break;
+        if (0 == total_len) {
+            memcpy(&first, &rec, SIZEOF(first));
         }
-        read_len = tuya_ring_buff_read(ai_input_ctx.ringbuf, head, SIZEOF(AI_RINGBUF_HEAD_T));
-        if (read_len != SIZEOF(AI_RINGBUF_HEAD_T)) {
-            break;
+        __ai_input_ring_pop(ring, &rec, ai_input_ctx.input_buf + total_len);
+        total_len += rec.head.len;
+    }
+    if (0 == total_len) {
+        return OPRT_NOT_FOUND;
+    }
+    tuya_ai_agent_upload_stream(first.head.type, &first.head.biz, ai_input_ctx.input_buf, total_len, total_len);
+    __ai_input_latency_add(ring, first.ts);
+    return OPRT_OK;
+}
+
+// upload the record a caller waits for
+STATIC OPERATE_RET __ai_input_upload_ref(AI_INPUT_RING_T *ring)
+{
+    AI_INPUT_REC_T rec;
+
+    if (!__ai_input_ring_peek(ring, &rec)) {
+        return OPRT_NOT_FOUND;
+    }
+    ring->done_rt = tuya_ai_agent_upload_stream(rec.head.type, &rec.head.biz, (char *)rec.ref, rec.head.len,
+                                                rec.head.total_len);
+    __ai_input_latency_add(ring, rec.ts);
+    __ai_input_ring_pop(ring, &rec, NULL);
+    tal_semaphore_post(ring->done);
+    return OPRT_OK;
+}
+
+/**
+ * @brief send what is queued, audio has strict priority and is checked
+ * again before each record of the other media
+ *
+ * @return count of audio uploads
+ */
+STATIC uint32_t __ai_input_schedule(bool with_audio)
+{
+    uint32_t audio_cnt = 0;
+    uint8_t i = 0, idx = 0;
+    bool busy = TRUE;
+
+    while (busy && !ai_input_ctx.terminate) {
+        busy = FALSE;
+        while (with_audio && OPRT_OK == __ai_input_upload_audio()) {
+            audio_cnt++;
         }
-        read_len = tuya_ring_buff_read(ai_input_ctx.ringbuf, buf + total_len, head->len);
-        if (read_len != head->len) {
-            PR_ERR("ring buf read pbuf failed %d %d", read_len, head->len);
-            rt = OPRT_COM_ERROR;
-            break;
+        for (i = 0; i < AI_INPUT_RING_NUM - 1; i++) {
+            idx = 1 + (ai_input_ctx.rr + i) % (AI_INPUT_RING_NUM - 1);
+            if (OPRT_OK == __ai_input_upload_ref(&ai_input_ctx.ring[idx])) {
+                ai_input_ctx.rr = (ai_input_ctx.rr + i + 1) % (AI_INPUT_RING_NUM - 1);
+                busy = TRUE;
+                break;
+            }
         }
-        total_len += read_len;
     }
-    head->len = total_len;
-    head->total_len = total_len;
-    tal_mutex_unlock(ai_input_ctx.mutex);
-    return rt;
+    return audio_cnt;
+}
+
+OPERATE_RET tuya_ai_input_get_latency(AI_PACKET_PT type, AI_INPUT_LATENCY_T *stat)
+{
+    AI_INPUT_RING_T *ring = __ai_input_ring_get(type);
+    if (ring == NULL || stat == NULL) {
+        return OPRT_INVALID_PARM;
+    }
+    memcpy(stat, &ring->lat, SIZEOF(*stat));
+    return OPRT_OK;
 }
 
 bool tuya_ai_input_is_started(VOID)
@@ -174,13 +376,10 @@ bool tuya_ai_input_is_started(VOID)
 
 OPERATE_RET tuya_ai_video_input(uint64_t timestamp, uint64_t pts, uint8_t *data, uint32_t len, uint32_t total_len)
 {
-    if (!tuya_ai_input_is_started()) {
-        return OPRT_RESOURCE_NOT_READY;
-    }
     AI_BIZ_HD_T biz = {0};
     biz.video.timestamp = timestamp;
     biz.video.pts = pts;
-    return tuya_ai_agent_upload_stream(AI_PT_VIDEO, &biz, (char *)data, len, total_len);
+    return __ai_input_post(AI_PT_VIDEO, &biz, data, len, total_len);
 }
 
 OPERATE_RET tuya_ai_audio_input_direct(uint64_t timestamp, uint64_t pts, uint8_t *data, uint32_t len, uint32_t total_len)
@@ -218,28 +417,19 @@ OPERATE_RET tuya_ai_audio_input(uint64_t timestamp, uint64_t pts, uint8_t *data,
 
 OPERATE_RET tuya_ai_image_input(uint64_t timestamp, uint8_t *data, uint32_t len, uint32_t total_len)
 {
-    if (!tuya_ai_input_is_started()) {
-        return OPRT_RESOURCE_NOT_READY;
-    }
     AI_BIZ_HD_T biz = {0};
     biz.image.timestamp = timestamp;
-    return tuya_ai_agent_upload_stream(AI_PT_IMAGE, &biz, (char *)data, len, total_len);
+    return __ai_input_post(AI_PT_IMAGE, &biz, data, len, total_len);
 }
 
 OPERATE_RET tuya_ai_text_input(uint8_t *data, uint32_t len, uint32_t total_len)
 {
-    if (!tuya_ai_input_is_started()) {
-        return OPRT_RESOURCE_NOT_READY;
-    }
-    return tuya_ai_agent_upload_stream(AI_PT_TEXT, NULL, (char *)data, len, total_len);
+    return __ai_input_post(AI_PT_TEXT, NULL, data, len, total_len);
 }
 
 OPERATE_RET tuya_ai_file_input(uint8_t *data, uint32_t len, uint32_t total_len)
 {
-    if (!tuya_ai_input_is_started()) {
-        return OPRT_RESOURCE_NOT_READY;
-    }
-    return tuya_ai_agent_upload_stream(AI_PT_FILE, NULL, (char *)data, len, total_len);
+    return __ai_input_post(AI_PT_FILE, NULL, data, len, total_len);
 }
 
 VOID tuya_ai_input_start(bool force)
@@ -261,6 +451,7 @@ VOID tuya_ai_input_start(bool force)
     if (OPRT_OK != rt) {
         PR_ERR("queue post err, rt:%d", rt);
     } else {
+        tal_semaphore_post(ai_input_ctx.wake);
         PR_DEBUG("ai input start, state:%d", state);
     }
     return;
@@ -285,6 +476,7 @@ VOID tuya_ai_input_stop(VOID)
     if (OPRT_OK != rt) {
         PR_ERR("queue post err, rt:%d", rt);
     } else {
+        tal_semaphore_post(ai_input_ctx.wake);
         PR_DEBUG("ai input stop, state:%d", state);
         while (!ai_input_ctx.queue_sync) {
             tal_system_sleep(100);
@@ -300,17 +492,41 @@ VOID tuya_ai_input_stop(VOID)
 VOID tuya_ai_input_deinit(VOID)
 {
     ai_input_ctx.terminate = TRUE;
+    if (ai_input_ctx.wake) {
+        tal_semaphore_post(ai_input_ctx.wake);
+    }
 }
 
 STATIC VOID __ai_input_free(VOID)
 {
+    uint8_t i = 0;
     if (ai_input_ctx.thread) {
         tal_thread_delete(ai_input_ctx.thread);
         ai_input_ctx.thread = NULL;
     }
-    if (ai_input_ctx.ringbuf) {
-        tuya_ring_buff_free(ai_input_ctx.ringbuf);
-        ai_input_ctx.ringbuf = NULL;
+    for (i = 0; i < AI_INPUT_RING_NUM; i++) {
+        AI_INPUT_RING_T *ring = &ai_input_ctx.ring[i];
+        __ai_input_ring_reset(ring);
+        if (ring->buf) {
+#if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
+            tal_psram_free(ring->buf);
+#else
+            Free(ring->buf);
+#endif
+            ring->buf = NULL;
+        }
+        if (ring->wr_mutex) {
+            tal_mutex_release(ring->wr_mutex);
+            ring->wr_mutex = NULL;
+        }
+        if (ring->done) {
+            tal_semaphore_release(ring->done);
+            ring->done = NULL;
+        }
+    }
+    if (ai_input_ctx.wake) {
+        tal_semaphore_release(ai_input_ctx.wake);
+        ai_input_ctx.wake = NULL;
     }
     if (ai_input_ctx.input_buf) {
         Free(ai_input_ctx.input_buf);
@@ -336,9 +552,12 @@ STATIC VOID __ai_input_thread(VOID* arg)
 {
     OPERATE_RET rt = OPRT_OK;
     AI_INPUT_STATE_E queue_state = AI_INPUT_IDLE;
-    AI_RINGBUF_HEAD_T head = {0};
+    uint32_t delay = 0;
 
     while (!ai_input_ctx.terminate && tal_thread_get_state(ai_input_ctx.thread) == THREAD_STATE_RUNNING) {
+        if (delay) {
+            tal_semaphore_wait(ai_input_ctx.wake, delay);
+        }
         queue_state = ai_input_ctx.state;
         if (tal_queue_fetch(ai_input_ctx.queue, &queue_state, 0) == 0) {
             PR_DEBUG("recv queue state %d", queue_state);
@@ -377,25 +596,12 @@ STATIC VOID __ai_input_thread(VOID* arg)
         }
         break;
         case AI_INPUT_PROC: {
-            tal_mutex_lock(ai_input_ctx.mutex);
-            rt = tuya_ai_input_read(&head, ai_input_ctx.input_buf);
-            tal_mutex_unlock(ai_input_ctx.mutex);
-            if ((rt == OPRT_OK) && (head.len > 0)) {
-                tuya_ai_agent_upload_stream(head.type, &head.biz, ai_input_ctx.input_buf, head.len, head.total_len);
-            }
+            __ai_input_schedule(TRUE);
         }
         break;
         case AI_INPUT_STOPPING: {
-            if (ai_input_ctx.lazy_input++ < 30) {
-                tal_mutex_lock(ai_input_ctx.mutex);
-                rt = tuya_ai_input_read(&head, ai_input_ctx.input_buf);
-                tal_mutex_unlock(ai_input_ctx.mutex);
-                if ((rt == OPRT_OK) && (head.len > 0)) {
-                    tuya_ai_agent_upload_stream(head.type, &head.biz, ai_input_ctx.input_buf, head.len, head.total_len);
-                    ai_input_ctx.state = AI_INPUT_STOPPING;
-                } else {
-                    ai_input_ctx.state = AI_INPUT_STOP;
-                }
+            if ((ai_input_ctx.lazy_input++ < 30) && __ai_input_schedule(TRUE)) {
+                ai_input_ctx.state = AI_INPUT_STOPPING;
             } else {
                 ai_input_ctx.state = AI_INPUT_STOP;
             }
@@ -403,23 +609,24 @@ STATIC VOID __ai_input_thread(VOID* arg)
         break;
         case AI_INPUT_STOP: {
             tuya_ai_agent_end();
-            tal_mutex_lock(ai_input_ctx.mutex);
-            tuya_ring_buff_reset(ai_input_ctx.ringbuf);
-            tal_mutex_unlock(ai_input_ctx.mutex);
+            __ai_input_ring_reset(&ai_input_ctx.ring[AI_INPUT_RING_AUDIO]);
             ai_input_ctx.state = AI_INPUT_IDLE;
             ai_input_ctx.queue_sync = TRUE;
         }
         break;
         case AI_INPUT_IDLE:
-            break;
         default:
+            // the other media are sent whatever the state, as they were sent by their callers
+            __ai_input_schedule(FALSE);
             break;
         }
 
-        if (ai_input_ctx.state != AI_INPUT_STOPPING) {
-            tal_system_sleep(AI_INPUT_TASK_DELAY);
+        if (ai_input_ctx.state == AI_INPUT_STOP) {
+            delay = 0;
+        } else if (ai_input_ctx.state == AI_INPUT_STOPPING) {
+            delay = AI_INPUT_STOPPING_DELAY;
         } else {
-            tal_system_sleep(10);
+            delay = AI_INPUT_TASK_DELAY;
         }
     }
     __ai_input_free();
@@ -428,21 +635,34 @@ STATIC VOID __ai_input_thread(VOID* arg)
 OPERATE_RET tuya_ai_input_init(VOID)
 {
     OPERATE_RET rt = OPRT_OK;
+    uint8_t i = 0;
     if (ai_input_ctx.input_buf) {
         return OPRT_OK;
     }
     memset(&ai_input_ctx, 0, SIZEOF(ai_input_ctx));
     TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&ai_input_ctx.mutex));
     TUYA_CALL_ERR_GOTO(tal_queue_create_init(&ai_input_ctx.queue, SIZEOF(AI_INPUT_STATE_E), 3), EXIT);
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&ai_input_ctx.wake, 0, 1), EXIT);
     TUYA_CALL_ERR_GOTO(tal_sw_timer_create(__alert_timeout_cb, NULL, &ai_input_ctx.alert.timer), EXIT);
     ai_input_ctx.input_buf = Malloc(AI_INPUT_BUF_SIZE);
     TUYA_CHECK_NULL_GOTO(ai_input_ctx.input_buf, EXIT);
+    for (i = 0; i < AI_INPUT_RING_NUM; i++) {
+        AI_INPUT_RING_T *ring = &ai_input_ctx.ring[i];
+        TUYA_CALL_ERR_GOTO(tal_mutex_create_init(&ring->wr_mutex), EXIT);
+        if (AI_INPUT_RING_AUDIO == i) {
+            ring->size = AI_INPUT_RINGBUF_SIZE;
+        } else {
+            // one caller at a time waits on done, the ring holds its record only
+            TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&ring->done, 0, 1), EXIT);
+            ring->size = SIZEOF(AI_INPUT_REC_T) + 1;
+        }
 #if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
-    TUYA_CALL_ERR_GOTO(tuya_ring_buff_create(AI_INPUT_RINGBUF_SIZE, OVERFLOW_PSRAM_STOP_TYPE, &ai_input_ctx.ringbuf),
-                       EXIT);
+        ring->buf = tal_psram_malloc(ring->size);
 #else
-    TUYA_CALL_ERR_GOTO(tuya_ring_buff_create(AI_INPUT_RINGBUF_SIZE, OVERFLOW_STOP_TYPE, &ai_input_ctx.ringbuf), EXIT);
+        ring->buf = Malloc(ring->size);
 #endif
+        TUYA_CHECK_NULL_GOTO(ring->buf, EXIT);
+    }
 
     THREAD_CFG_T thrd_param = {0};
     thrd_param.priority = THREAD_PRIO_1;
@@ -39,6 +39,10 @@
 #ifndef AI_MAX_ATTR_NUM
 #define AI_MAX_ATTR_NUM 10
 #endif
+
+#ifndef AI_RECV_ATTR_MAX_NUM
+#define AI_RECV_ATTR_MAX_NUM 16
+#endif
 #define AI_KEY_LEN 32
 #define AI_RANDOM_LEN 32
 #define AI_IV_LEN 16
@@ -317,6 +321,12 @@ typedef struct {
     AI_ATTR_VALUE value;
 } AI_ATTRIBUTE_T;
 
+/* attributes of a received packet parsed in one pass, values point into the packet */
+typedef struct {
+    uint32_t num;
+    AI_ATTRIBUTE_T attr[AI_RECV_ATTR_MAX_NUM];
+} AI_ATTR_INDEX_T;
+
 typedef struct {
     AI_ATTR_TYPE type;
     uint16_t length;
@@ -371,6 +381,12 @@ typedef struct ai_send_packet_t {
     AI_PACKET_WRITER_T *writer;
 } AI_SEND_PACKET_T;
 
+typedef struct {
+    uint32_t packets;   // packets framed by the send path
+    uint32_t allocs;    // heap allocations made while framing them
+    uint32_t pool_hits; // packets framed in a pooled buffer without allocation
+} AI_PKT_STAT_T;
+
 typedef struct {
     uint32_t biz_code;
     uint64_t biz_tag;
@@ -548,6 +564,9 @@ OPERATE_RET tuya_ai_basic_conn_close(AI_STATUS_CODE code);
  * @param[out] out_len packet data length
  * @param[out] out_frag packet fragment flag
  *
+ * @note out points into the receive buffer unless the packet was reassembled,
+ * it is valid until the next read, release it with tuya_ai_basic_pkt_free
+ *
  * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
  */
 OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *out_frag);
@@ -577,6 +596,16 @@ OPERATE_RET tuya_ai_basic_pkt_send(AI_SEND_PACKET_T *info);
  */
 OPERATE_RET tuya_ai_basic_pkt_frag_send(AI_SEND_PACKET_T *info);
 
+/**
+ * @brief get the allocation counters of the packet send path
+ *
+ * @param[out] stat counters since boot, allocs / packets is the
+ * allocations per packet
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tuya_ai_basic_pkt_stat(AI_PKT_STAT_T *stat);
+
 /**
  * @brief create user attrs
  *
@@ -735,6 +764,27 @@ OPERATE_RET tuya_ai_basic_event(AI_EVENT_ATTR_T *event, char *data, uint32_t len
  */
 OPERATE_RET tuya_ai_get_attr_value(char *de_buf, uint32_t *offset, AI_ATTRIBUTE_T *attr);
 
+/**
+ * @brief parse all attributes of a packet into an index
+ *
+ * @param[in] de_buf attribute buffer
+ * @param[in] attr_len length of the attributes
+ * @param[out] index attribute index
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tuya_ai_attr_index_parse(char *de_buf, uint32_t attr_len, AI_ATTR_INDEX_T *index);
+
+/**
+ * @brief find an attribute in an index
+ *
+ * @param[in] index attribute index
+ * @param[in] type attribute type
+ *
+ * @return the attribute, NULL if not found
+ */
+AI_ATTRIBUTE_T *tuya_ai_attr_index_find(AI_ATTR_INDEX_T *index, AI_ATTR_TYPE type);
+
 /**
  * @brief connect refresh resp parse
  *
@@ -54,6 +54,8 @@ typedef struct {
     MUTEX_HANDLE mutex;
     AI_SESSION_T session[AI_SESSION_MAX_NUM];
     AI_BIZ_RECV_CB cb;
+    VOID *usr_data;
+    AI_STREAM_TYPE frag_end_flag;
     AI_BASIC_BIZ_MONITOR_T *monitor;
 } AI_BASIC_BIZ_T;
 
@@ -474,36 +476,31 @@ STATIC OPERATE_RET __ai_biz_create_task(VOID)
     return rt;
 }
 
-OPERATE_RET __ai_parse_video_attr(char *de_buf, uint32_t attr_len, AI_VIDEO_ATTR_T *video)
+STATIC OPERATE_RET __ai_parse_video_attr(AI_ATTR_INDEX_T *index, AI_VIDEO_ATTR_T *video)
 {
     OPERATE_RET rt = OPRT_OK;
-    uint32_t offset = 0;
-    AI_ATTRIBUTE_T attr = {0};
+    uint32_t idx = 0;
+    AI_ATTRIBUTE_T *attr = NULL;
 
-    while (offset < attr_len) {
-        memset(&attr, 0, SIZEOF(AI_ATTRIBUTE_T));
-        rt = tuya_ai_get_attr_value(de_buf, &offset, &attr);
-        if (OPRT_OK != rt) {
-            PR_ERR("get attr value failed, rt:%d", rt);
-            return rt;
-        }
+    for (idx = 0; idx < index->num; idx++) {
+        attr = &index->attr[idx];
 #if defined(AI_VERSION) && (0x01 == AI_VERSION)
-        if (attr.type == AI_ATTR_VIDEO_CODEC_TYPE) {
-            video->base.codec_type = attr.value.u16;
-        } else if (attr.type == AI_ATTR_VIDEO_SAMPLE_RATE) {
-            video->base.sample_rate = attr.value.u32;
-        } else if (attr.type == AI_ATTR_VIDEO_WIDTH) {
-            video->base.width = attr.value.u16;
-        } else if (attr.type == AI_ATTR_VIDEO_HEIGHT) {
-            video->base.height = attr.value.u16;
-        } else if (attr.type == AI_ATTR_VIDEO_FPS) {
-            video->base.fps = attr.value.u16;
+        if (attr->type == AI_ATTR_VIDEO_CODEC_TYPE) {
+            video->base.codec_type = attr->value.u16;
+        } else if (attr->type == AI_ATTR_VIDEO_SAMPLE_RATE) {
+            video->base.sample_rate = attr->value.u32;
+        } else if (attr->type == AI_ATTR_VIDEO_WIDTH) {
+            video->base.width = attr->value.u16;
+        } else if (attr->type == AI_ATTR_VIDEO_HEIGHT) {
+            video->base.height = attr->value.u16;
+        } else if (attr->type == AI_ATTR_VIDEO_FPS) {
+            video->base.fps = attr->value.u16;
         }
 #else
-        if (attr.type == AI_ATTR_VIDEO_PARAMS) {
-            AI_PROTO_D("parase vedio params attr value:%s", attr.value.str);
+        if (attr->type == AI_ATTR_VIDEO_PARAMS) {
+            AI_PROTO_D("parase vedio params attr value:%s", attr->value.str);
             uint32_t codec_type = 0, sample_rate = 0, width = 0, height = 0, fps = 0;
-            char parased = sscanf(attr.value.str, "%d %d %d %d %d", &codec_type, &width, &height, &fps, &sample_rate);
+            char parased = sscanf(attr->value.str, "%d %d %d %d %d", &codec_type, &width, &height, &fps, &sample_rate);
             if (OPRT_COM_ERROR == parased) {
                 PR_ERR("parase vedio params attr value failed, rt:%d ", parased);
                 return parased;
@@ -515,46 +512,41 @@ OPERATE_RET __ai_parse_video_attr(char *de_buf, uint32_t attr_len, AI_VIDEO_ATTR
             video->base.fps = (uint16_t)fps;
         }
 #endif
-        else if (attr.type == AI_ATTR_USER_DATA) {
-            video->option.user_data = attr.value.bytes;
-            video->option.user_len = attr.length;
-        } else if (attr.type == AI_ATTR_SESSION_ID_LIST) {
-            video->option.session_id_list = attr.value.str;
+        else if (attr->type == AI_ATTR_USER_DATA) {
+            video->option.user_data = attr->value.bytes;
+            video->option.user_len = attr->length;
+        } else if (attr->type == AI_ATTR_SESSION_ID_LIST) {
+            video->option.session_id_list = attr->value.str;
         } else {
-            PR_ERR("unknow attr type:%d", attr.type);
+            PR_ERR("unknow attr type:%d", attr->type);
         }
     }
     return rt;
 }
 
-OPERATE_RET __ai_parse_audio_attr(char *de_buf, uint32_t attr_len, AI_AUDIO_ATTR_T *audio)
+STATIC OPERATE_RET __ai_parse_audio_attr(AI_ATTR_INDEX_T *index, AI_AUDIO_ATTR_T *audio)
 {
     OPERATE_RET rt = OPRT_OK;
-    uint32_t offset = 0;
-    AI_ATTRIBUTE_T attr = {0};
+    uint32_t idx = 0;
+    AI_ATTRIBUTE_T *attr = NULL;
 
-    while (offset < attr_len) {
-        memset(&attr, 0, SIZEOF(AI_ATTRIBUTE_T));
-        rt = tuya_ai_get_attr_value(de_buf, &offset, &attr);
-        if (OPRT_OK != rt) {
-            PR_ERR("get attr value failed, rt:%d", rt);
-            return rt;
-        }
+    for (idx = 0; idx < index->num; idx++) {
+        attr = &index->attr[idx];
 #if defined(AI_VERSION) && (0x01 == AI_VERSION)
-        if (attr.type == AI_ATTR_AUDIO_CODEC_TYPE) {
-            audio->base.codec_type = attr.value.u16;
-        } else if (attr.type == AI_ATTR_AUDIO_SAMPLE_RATE) {
-            audio->base.sample_rate = attr.value.u32;
-        } else if (attr.type == AI_ATTR_AUDIO_CHANNELS) {
-            audio->base.channels = attr.value.u16;
-        } else if (attr.type == AI_ATTR_AUDIO_DEPTH) {
-            audio->base.bit_depth = attr.value.u16;
+        if (attr->type == AI_ATTR_AUDIO_CODEC_TYPE) {
+            audio->base.codec_type = attr->value.u16;
+        } else if (attr->type == AI_ATTR_AUDIO_SAMPLE_RATE) {
+            audio->base.sample_rate = attr->value.u32;
+        } else if (attr->type == AI_ATTR_AUDIO_CHANNELS) {
+            audio->base.channels = attr->value.u16;
+        } else if (attr->type == AI_ATTR_AUDIO_DEPTH) {
+            audio->base.bit_depth = attr->value.u16;
         }
 #else
-        if (attr.type == AI_ATTR_AUDIO_PARAMS) {
-            AI_PROTO_D("parase audio params attr value:%s", attr.value.str);
+        if (attr->type == AI_ATTR_AUDIO_PARAMS) {
+            AI_PROTO_D("parase audio params attr value:%s", attr->value.str);
             uint32_t codec_type = 0, sample_rate = 0, channels = 0, bit_depth = 0;
-            char parased = sscanf(attr.value.str, "%d %d %d %d", &codec_type, &channels, &bit_depth, &sample_rate);
+            char parased = sscanf(attr->value.str, "%d %d %d %d", &codec_type, &channels, &bit_depth, &sample_rate);
             if (OPRT_COM_ERROR == parased) {
                 PR_ERR("parase audio params attr value failed, rt:%d ", parased);
                 return parased;
@@ -565,44 +557,39 @@ OPERATE_RET __ai_parse_audio_attr(char *de_buf, uint32_t attr_len, AI_AUDIO_ATTR
             audio->base.sample_rate = (uint32_t)sample_rate;
         }
 #endif
-        else if (attr.type == AI_ATTR_USER_DATA) {
-            audio->option.user_data = attr.value.bytes;
-            audio->option.user_len = attr.length;
-        } else if (attr.type == AI_ATTR_SESSION_ID_LIST) {
-            audio->option.session_id_list = attr.value.str;
+        else if (attr->type == AI_ATTR_USER_DATA) {
+            audio->option.user_data = attr->value.bytes;
+            audio->option.user_len = attr->length;
+        } else if (attr->type == AI_ATTR_SESSION_ID_LIST) {
+            audio->option.session_id_list = attr->value.str;
         } else {
-            PR_ERR("unknow attr type:%d", attr.type);
+            PR_ERR("unknow attr type:%d", attr->type);
         }
     }
     return rt;
 }
 
-OPERATE_RET __ai_parse_image_attr(char *de_buf, uint32_t attr_len, AI_IMAGE_ATTR_T *image)
+STATIC OPERATE_RET __ai_parse_image_attr(AI_ATTR_INDEX_T *index, AI_IMAGE_ATTR_T *image)
 {
     OPERATE_RET rt = OPRT_OK;
-    uint32_t offset = 0;
-    AI_ATTRIBUTE_T attr = {0};
+    uint32_t idx = 0;
+    AI_ATTRIBUTE_T *attr = NULL;
 
-    while (offset < attr_len) {
-        memset(&attr, 0, SIZEOF(AI_ATTRIBUTE_T));
-        rt = tuya_ai_get_attr_value(de_buf, &offset, &attr);
-        if (OPRT_OK != rt) {
-            PR_ERR("get attr value failed, rt:%d", rt);
-            return rt;
-        }
+    for (idx = 0; idx < index->num; idx++) {
+        attr = &index->attr[idx];
 #if defined(AI_VERSION) && (0x01 == AI_VERSION)
-        if (attr.type == AI_ATTR_IMAGE_FORMAT) {
-            image->base.format = attr.value.u8;
-        } else if (attr.type == AI_ATTR_IMAGE_WIDTH) {
-            image->base.width = attr.value.u16;
-        } else if (attr.type == AI_ATTR_IMAGE_HEIGHT) {
-            image->base.height = attr.value.u16;
+        if (attr->type == AI_ATTR_IMAGE_FORMAT) {
+            image->base.format = attr->value.u8;
+        } else if (attr->type == AI_ATTR_IMAGE_WIDTH) {
+            image->base.width = attr->value.u16;
+        } else if (attr->type == AI_ATTR_IMAGE_HEIGHT) {
+            image->base.height = attr->value.u16;
         }
 #else
-        if (AI_ATTR_IMAGE_PARAMS == attr.type) {
-            AI_PROTO_D("parase image params attr value:%s", attr.value.str);
+        if (AI_ATTR_IMAGE_PARAMS == attr->type) {
+            AI_PROTO_D("parase image params attr value:%s", attr->value.str);
             uint32_t image_type = 0, image_format = 0, image_width = 0, image_height = 0;
-            char parased = sscanf(attr.value.str, "%d %d %d %d", &image_type, &image_format, &image_width, &image_height);
+            char parased = sscanf(attr->value.str, "%d %d %d %d", &image_type, &image_format, &image_width, &image_height);
             if (OPRT_COM_ERROR == parased) {
                 PR_ERR("parase image params attr value failed, rt:%d ", parased);
                 return parased;
@@ -617,47 +604,42 @@ OPERATE_RET __ai_parse_image_attr(char *de_buf, uint32_t attr_len, AI_IMAGE_ATTR
             }
         }
 #endif
-        else if (attr.type == AI_ATTR_USER_DATA) {
-            image->option.user_data = attr.value.bytes;
-            image->option.user_len = attr.length;
-        } else if (attr.type == AI_ATTR_SESSION_ID_LIST) {
-            image->option.session_id_list = attr.value.str;
+        else if (attr->type == AI_ATTR_USER_DATA) {
+            image->option.user_data = attr->value.bytes;
+            image->option.user_len = attr->length;
+        } else if (attr->type == AI_ATTR_SESSION_ID_LIST) {
+            image->option.session_id_list = attr->value.str;
         } else {
-            PR_ERR("unknow attr type:%d", attr.type);
+            PR_ERR("unknow attr type:%d", attr->type);
         }
     }
     return rt;
 }
 
-OPERATE_RET __ai_parse_file_attr(char *de_buf, uint32_t attr_len, AI_FILE_ATTR_T *file)
+STATIC OPERATE_RET __ai_parse_file_attr(AI_ATTR_INDEX_T *index, AI_FILE_ATTR_T *file)
 {
     OPERATE_RET rt = OPRT_OK;
-    uint32_t offset = 0;
-    AI_ATTRIBUTE_T attr = {0};
+    uint32_t idx = 0;
+    AI_ATTRIBUTE_T *attr = NULL;
 
-    while (offset < attr_len) {
-        memset(&attr, 0, SIZEOF(AI_ATTRIBUTE_T));
-        rt = tuya_ai_get_attr_value(de_buf, &offset, &attr);
-        if (OPRT_OK != rt) {
-            PR_ERR("get attr value failed, rt:%d", rt);
-            return rt;
-        }
+    for (idx = 0; idx < index->num; idx++) {
+        attr = &index->attr[idx];
 #if defined(AI_VERSION) && (0x01 == AI_VERSION)
-        if (attr.type == AI_ATTR_FILE_FORMAT) {
-            file->base.format = attr.value.u8;
-        } else if (attr.type == AI_ATTR_FILE_NAME) {
-            if (attr.length > SIZEOF(file->base.file_name)) {
-                PR_ERR("file name too long %d", attr.length);
+        if (attr->type == AI_ATTR_FILE_FORMAT) {
+            file->base.format = attr->value.u8;
+        } else if (attr->type == AI_ATTR_FILE_NAME) {
+            if (attr->length > SIZEOF(file->base.file_name)) {
+                PR_ERR("file name too long %d", attr->length);
                 return OPRT_INVALID_PARM;
             }
-            memcpy(file->base.file_name, attr.value.str, attr.length);
+            memcpy(file->base.file_name, attr->value.str, attr->length);
         }
 #else
-        if (AI_ATTR_FILE_PARAMS == attr.type) {
-            AI_PROTO_D("parase file params attr value:%s", attr.value.str);
+        if (AI_ATTR_FILE_PARAMS == attr->type) {
+            AI_PROTO_D("parase file params attr value:%s", attr->value.str);
             uint32_t file_type = 0, file_format = 0;
             uint8_t file_name[256] = {0};
-            char parased = sscanf(attr.value.str, "%d %d %s", &file_type, &file_format, file_name);
+            char parased = sscanf(attr->value.str, "%d %d %s", &file_type, &file_format, file_name);
             if (OPRT_COM_ERROR == parased) {
                 PR_ERR("parase image params attr value failed, rt:%d ", parased);
                 return parased;
@@ -673,13 +655,13 @@ OPERATE_RET __ai_parse_file_attr(char *de_buf, uint32_t attr_len, AI_FILE_ATTR_T
             memcpy(file->base.file_name, file_name, strlen((char *)file_name));
         }
 #endif
-        else if (attr.type == AI_ATTR_USER_DATA) {
-            file->option.user_data = attr.value.bytes;
-            file->option.user_len = attr.length;
-        } else if (attr.type == AI_ATTR_SESSION_ID_LIST) {
-            file->option.session_id_list = attr.value.str;
+        else if (attr->type == AI_ATTR_USER_DATA) {
+            file->option.user_data = attr->value.bytes;
+            file->option.user_len = attr->length;
+        } else if (attr->type == AI_ATTR_SESSION_ID_LIST) {
+            file->option.session_id_list = attr->value.str;
         } else {
-            PR_ERR("unknow attr type:%d", attr.type);
+            PR_ERR("unknow attr type:%d", attr->type);
         }
     }
     if (file->base.file_name[0] == '\0') {
@@ -689,62 +671,52 @@ OPERATE_RET __ai_parse_file_attr(char *de_buf, uint32_t attr_len, AI_FILE_ATTR_T
     return rt;
 }
 
-OPERATE_RET __ai_parse_text_attr(char *de_buf, uint32_t attr_len, AI_TEXT_ATTR_T *text)
+STATIC OPERATE_RET __ai_parse_text_attr(AI_ATTR_INDEX_T *index, AI_TEXT_ATTR_T *text)
 {
     OPERATE_RET rt = OPRT_OK;
-    uint32_t offset = 0;
-    AI_ATTRIBUTE_T attr = {0};
+    uint32_t idx = 0;
+    AI_ATTRIBUTE_T *attr = NULL;
 
-    while (offset < attr_len) {
-        memset(&attr, 0, SIZEOF(AI_ATTRIBUTE_T));
-        rt = tuya_ai_get_attr_value(de_buf, &offset, &attr);
-        if (OPRT_OK != rt) {
-            PR_ERR("get attr value failed, rt:%d", rt);
-            return rt;
-        }
+    for (idx = 0; idx < index->num; idx++) {
+        attr = &index->attr[idx];
 
-        if (attr.type == AI_ATTR_SESSION_ID_LIST) {
-            text->session_id_list = attr.value.str;
+        if (attr->type == AI_ATTR_SESSION_ID_LIST) {
+            text->session_id_list = attr->value.str;
         } else {
-            PR_ERR("unknow attr type:%d", attr.type);
+            PR_ERR("unknow attr type:%d", attr->type);
         }
     }
     return rt;
 }
 
-OPERATE_RET __ai_parse_event_attr(char *de_buf, uint32_t attr_len, AI_EVENT_ATTR_T *event)
+STATIC OPERATE_RET __ai_parse_event_attr(AI_ATTR_INDEX_T *index, AI_EVENT_ATTR_T *event)
 {
     OPERATE_RET rt = OPRT_OK;
-    uint32_t offset = 0;
-    AI_ATTRIBUTE_T attr = {0};
+    uint32_t idx = 0;
+    AI_ATTRIBUTE_T *attr = NULL;
 
-    while (offset < attr_len) {
-        memset(&attr, 0, SIZEOF(AI_ATTRIBUTE_T));
-        rt = tuya_ai_get_attr_value(de_buf, &offset, &attr);
-        if (OPRT_OK != rt) {
-            PR_ERR("get attr value failed, rt:%d", rt);
-            return rt;
-        }
+    for (idx = 0; idx < index->num; idx++) {
+        attr = &index->attr[idx];
 
-        if (attr.type == AI_ATTR_SESSION_ID) {
-            event->session_id = attr.value.str;
+        if (attr->type == AI_ATTR_SESSION_ID) {
+            event->session_id = attr->value.str;
             AI_PROTO_D("recv event session id:%s", event->session_id);
-        } else if (attr.type == AI_ATTR_EVENT_ID) {
-            event->event_id = attr.value.str;
+        } else if (attr->type == AI_ATTR_EVENT_ID) {
+            event->event_id = attr->value.str;
             AI_PROTO_D("recv event id:%s", event->event_id);
-        } else if (attr.type == AI_ATTR_USER_DATA) {
-            event->user_data = attr.value.bytes;
-            event->user_len = attr.length;
-        } else if (attr.type == AI_ATTR_EVENT_TS) {
-            event->end_ts = attr.value.u64;
-        } else if (attr.type == AI_ATTR_CMD_DATA) {
-            event->cmd_data = attr.value.str;
-        } else if (attr.type == AI_ATTR_ASSIGN_DATAS) {
-            event->assign_datas = attr.value.str;
-        } else if (attr.type == AI_ATTR_UNASSIGN_DATAS) {
-            event->unassign_datas = attr.value.str;
+        } else if (attr->type == AI_ATTR_USER_DATA) {
+            event->user_data = attr->value.bytes;
+            event->user_len = attr->length;
+        } else if (attr->type == AI_ATTR_EVENT_TS) {
+            event->end_ts = attr->value.u64;
+        } else if (attr->type == AI_ATTR_CMD_DATA) {
+            event->cmd_data = attr->value.str;
+        } else if (attr->type == AI_ATTR_ASSIGN_DATAS) {
+            event->assign_datas = attr->value.str;
+        } else if (attr->type == AI_ATTR_UNASSIGN_DATAS) {
+            event->unassign_datas = attr->value.str;
         } else {
-            PR_ERR("unknow attr type:%d", attr.type);
+            PR_ERR("unknow attr type:%d", attr->type);
         }
     }
     if ((NULL == event->event_id) || (NULL == event->session_id)) {
@@ -755,28 +727,23 @@ OPERATE_RET __ai_parse_event_attr(char *de_buf, uint32_t attr_len, AI_EVENT_ATTR
     return rt;
 }
 
-OPERATE_RET __ai_parse_session_close_attr(char *de_buf, uint32_t attr_len, AI_SESSION_CLOSE_ATTR_T *close)
+STATIC OPERATE_RET __ai_parse_session_close_attr(AI_ATTR_INDEX_T *index, AI_SESSION_CLOSE_ATTR_T *close)
 {
     OPERATE_RET rt = OPRT_OK;
-    uint32_t offset = 0;
-    AI_ATTRIBUTE_T attr = {0};
+    uint32_t idx = 0;
+    AI_ATTRIBUTE_T *attr = NULL;
 
-    while (offset < attr_len) {
-        memset(&attr, 0, SIZEOF(AI_ATTRIBUTE_T));
-        rt = tuya_ai_get_attr_value(de_buf, &offset, &attr);
-        if (OPRT_OK != rt) {
-            PR_ERR("get attr value failed, rt:%d", rt);
-            return rt;
-        }
+    for (idx = 0; idx < index->num; idx++) {
+        attr = &index->attr[idx];
 
-        if (attr.type == AI_ATTR_SESSION_ID) {
-            close->id = attr.value.str;
+        if (attr->type == AI_ATTR_SESSION_ID) {
+            close->id = attr->value.str;
             PR_NOTICE("close session id:%s", close->id);
-        } else if (attr.type == AI_ATTR_SESSION_CLOSE_ERR_CODE) {
-            close->code = attr.value.u16;
+        } else if (attr->type == AI_ATTR_SESSION_CLOSE_ERR_CODE) {
+            close->code = attr->value.u16;
             PR_NOTICE("close session err code:%d", close->code);
         } else {
-            PR_ERR("unknow attr type:%d", attr.type);
+            PR_ERR("unknow attr type:%d", attr->type);
         }
     }
     if (NULL == close->id) {
@@ -787,31 +754,26 @@ OPERATE_RET __ai_parse_session_close_attr(char *de_buf, uint32_t attr_len, AI_SE
     return rt;
 }
 
-OPERATE_RET __ai_parse_session_state_attr(char *de_buf, uint32_t attr_len, AI_SESSION_STATE_ATTR_T *state)
+STATIC OPERATE_RET __ai_parse_session_state_attr(AI_ATTR_INDEX_T *index, AI_SESSION_STATE_ATTR_T *state)
 {
     OPERATE_RET rt = OPRT_OK;
-    uint32_t offset = 0;
-    AI_ATTRIBUTE_T attr = {0};
+    uint32_t idx = 0;
+    AI_ATTRIBUTE_T *attr = NULL;
 
-    while (offset < attr_len) {
-        memset(&attr, 0, SIZEOF(AI_ATTRIBUTE_T));
-        rt = tuya_ai_get_attr_value(de_buf, &offset, &attr);
-        if (OPRT_OK != rt) {
-            PR_ERR("get attr value failed, rt:%d", rt);
-            return rt;
-        }
+    for (idx = 0; idx < index->num; idx++) {
+        attr = &index->attr[idx];
 
-        if (attr.type == AI_ATTR_SESSION_ID) {
-            state->id = attr.value.str;
+        if (attr->type == AI_ATTR_SESSION_ID) {
+            state->id = attr->value.str;
             PR_NOTICE("state session id:%s", state->id);
-        } else if (attr.type == AI_ATTR_SESSION_STATE_CHANGE_CODE) {
-            state->code = attr.value.u16;
+        } else if (attr->type == AI_ATTR_SESSION_STATE_CHANGE_CODE) {
+            state->code = attr->value.u16;
             PR_NOTICE("state session code:%d", state->code);
-        } else if (attr.type == AI_ATTR_USER_DATA) {
-            state->user_data = attr.value.bytes;
-            state->user_len = attr.length;
+        } else if (attr->type == AI_ATTR_USER_DATA) {
+            state->user_data = attr->value.bytes;
+            state->user_len = attr->length;
         } else {
-            PR_ERR("unknow attr type:%d", attr.type);
+            PR_ERR("unknow attr type:%d", attr->type);
         }
     }
     if (NULL == state->id) {
@@ -822,53 +784,53 @@ OPERATE_RET __ai_parse_session_state_attr(char *de_buf, uint32_t attr_len, AI_SE
     return rt;
 }
 
-STATIC OPERATE_RET __ai_parse_biz_attr(AI_PACKET_PT type, char *attr_buf, uint32_t attr_len, AI_BIZ_ATTR_INFO_T *attr)
+STATIC OPERATE_RET __ai_parse_biz_attr(AI_PACKET_PT type, AI_ATTR_INDEX_T *index, AI_BIZ_ATTR_INFO_T *attr)
 {
     OPERATE_RET rt = OPRT_OK;
     if (type == AI_PT_VIDEO) {
-        rt = __ai_parse_video_attr(attr_buf, attr_len, &attr->value.video);
+        rt = __ai_parse_video_attr(index, &attr->value.video);
         if (OPRT_OK != rt) {
             PR_ERR("parse video attr failed, rt:%d", rt);
             return rt;
         }
     } else if (type == AI_PT_AUDIO) {
-        rt = __ai_parse_audio_attr(attr_buf, attr_len, &attr->value.audio);
+        rt = __ai_parse_audio_attr(index, &attr->value.audio);
         if (OPRT_OK != rt) {
             PR_ERR("parse audio attr failed, rt:%d", rt);
             return rt;
         }
     } else if (type == AI_PT_IMAGE) {
-        rt = __ai_parse_image_attr(attr_buf, attr_len, &attr->value.image);
+        rt = __ai_parse_image_attr(index, &attr->value.image);
         if (OPRT_OK != rt) {
             PR_ERR("parse image attr failed, rt:%d", rt);
             return rt;
         }
     } else if (type == AI_PT_FILE) {
-        rt = __ai_parse_file_attr(attr_buf, attr_len, &attr->value.file);
+        rt = __ai_parse_file_attr(index, &attr->value.file);
         if (OPRT_OK != rt) {
             PR_ERR("parse file attr failed, rt:%d", rt);
             return rt;
         }
     } else if (type == AI_PT_TEXT) {
-        rt = __ai_parse_text_attr(attr_buf, attr_len, &attr->value.text);
+        rt = __ai_parse_text_attr(index, &attr->value.text);
         if (OPRT_OK != rt) {
             PR_ERR("parse text attr failed, rt:%d", rt);
             return rt;
         }
     } else if (type == AI_PT_EVENT) {
-        rt = __ai_parse_event_attr(attr_buf, attr_len, &attr->value.event);
+        rt = __ai_parse_event_attr(index, &attr->value.event);
         if (OPRT_OK != rt) {
             PR_ERR("parse event attr failed, rt:%d", rt);
             return rt;
         }
     } else if (type == AI_PT_SESSION_CLOSE) {
-        rt = __ai_parse_session_close_attr(attr_buf, attr_len, &attr->value.close);
+        rt = __ai_parse_session_close_attr(index, &attr->value.close);
         if (OPRT_OK != rt) {
             PR_ERR("parse close attr failed, rt:%d", rt);
             return rt;
         }
     } else if (type == AI_PT_SESSION_STATE_CHANGE) {
-        rt = __ai_parse_session_state_attr(attr_buf, attr_len, &attr->value.state);
+        rt = __ai_parse_session_state_attr(index, &attr->value.state);
         if (OPRT_OK != rt) {
             PR_ERR("parse state attr failed, rt:%d", rt);
             return rt;
@@ -1055,6 +1017,7 @@ OPERATE_RET __ai_biz_recv_handle(char *data, uint32_t len, AI_FRAG_FLAG frag)
         }
 
         AI_BIZ_ATTR_INFO_T attr_info;
+        AI_ATTR_INDEX_T attr_index;
         memset(&attr_info, 0, SIZEOF(AI_BIZ_ATTR_INFO_T));
         attr_info.flag = attr_flag;
         attr_info.type = type;
@@ -1063,7 +1026,12 @@ OPERATE_RET __ai_biz_recv_handle(char *data, uint32_t len, AI_FRAG_FLAG frag)
             attr_len = UNI_NTOHL(attr_len);
             offset += SIZEOF(attr_len);
             attr_buf = data + offset;
-            rt = __ai_parse_biz_attr(type, attr_buf, attr_len, &attr_info);
+            // one pass over the tlv, the type parsers pick their values from the index
+            rt = tuya_ai_attr_index_parse(attr_buf, attr_len, &attr_index);
+            if (OPRT_OK != rt) {
+                return rt;
+            }
+            rt = __ai_parse_biz_attr(type, &attr_index, &attr_info);
             if (OPRT_OK != rt) {
                 return rt;
             }
@@ -1107,7 +1075,17 @@ OPERATE_RET __ai_biz_recv_handle(char *data, uint32_t len, AI_FRAG_FLAG frag)
         }
 
         if (frag == AI_PACKET_FRAG_START) {
-            biz_head.len = len; // not packet actually, need fix later
+            // the fragments are passed on as they arrive, len is the data of this one and
+            // the end of a fragmented END/ONE packet is reported with its last fragment
+            biz_head.len = len - (payload - data) - offset;
+            ai_basic_biz->frag_end_flag = AI_STREAM_ING;
+            if (biz_head.stream_flag == AI_STREAM_ONE) {
+                biz_head.stream_flag = AI_STREAM_START;
+                ai_basic_biz->frag_end_flag = AI_STREAM_END;
+            } else if (biz_head.stream_flag == AI_STREAM_END) {
+                biz_head.stream_flag = AI_STREAM_ING;
+                ai_basic_biz->frag_end_flag = AI_STREAM_END;
+            }
         }
 
         uint16_t recv_id = 0;
@@ -1148,6 +1126,7 @@ OPERATE_RET __ai_biz_recv_handle(char *data, uint32_t len, AI_FRAG_FLAG frag)
                 PR_ERR("recv data handle failed, rt:%d", rt);
             }
             ai_basic_biz->cb = cb;
+            ai_basic_biz->usr_data = usr_data;
         }
         if (idx == AI_SESSION_MAX_NUM) {
             PR_ERR("session not found");
@@ -1155,7 +1134,7 @@ OPERATE_RET __ai_biz_recv_handle(char *data, uint32_t len, AI_FRAG_FLAG frag)
         }
     } else {
         biz_head.len = len;
-        biz_head.stream_flag = AI_STREAM_ING;
+        biz_head.stream_flag = (frag == AI_PACKET_FRAG_END) ? ai_basic_biz->frag_end_flag : AI_STREAM_ING;
         if (ai_basic_biz->monitor && ai_basic_biz->monitor->recv_cb) {
             rt = ai_basic_biz->monitor->recv_cb(0, NULL, &biz_head, data, ai_basic_biz->monitor->usr_data);
             if (OPRT_OK != rt) {
@@ -1163,7 +1142,7 @@ OPERATE_RET __ai_biz_recv_handle(char *data, uint32_t len, AI_FRAG_FLAG frag)
             }
         }
         if (ai_basic_biz->cb) {
-            rt = ai_basic_biz->cb(NULL, &biz_head, data, usr_data);
+            rt = ai_basic_biz->cb(NULL, &biz_head, data, ai_basic_biz->usr_data);
             if (rt != OPRT_OK) {
                 PR_ERR("recv data handle failed, rt:%d", rt);
             }
@@ -1387,32 +1366,50 @@ AI_SESSION_CFG_T* tuya_ai_biz_get_session_cfg(AI_SESSION_ID id)
 
 OPERATE_RET tuya_ai_parse_video_attr(char *de_buf, uint32_t attr_len, AI_VIDEO_ATTR_T *video)
 {
-    return __ai_parse_video_attr(de_buf, attr_len, video);
+    OPERATE_RET rt = OPRT_OK;
+    AI_ATTR_INDEX_T index;
+    TUYA_CALL_ERR_RETURN(tuya_ai_attr_index_parse(de_buf, attr_len, &index));
+    return __ai_parse_video_attr(&index, video);
 }
 
 OPERATE_RET tuya_ai_parse_audio_attr(char *de_buf, uint32_t attr_len, AI_AUDIO_ATTR_T *audio)
 {
-    return __ai_parse_audio_attr(de_buf, attr_len, audio);
+    OPERATE_RET rt = OPRT_OK;
+    AI_ATTR_INDEX_T index;
+    TUYA_CALL_ERR_RETURN(tuya_ai_attr_index_parse(de_buf, attr_len, &index));
+    return __ai_parse_audio_attr(&index, audio);
 }
 
 OPERATE_RET tuya_ai_parse_image_attr(char *de_buf, uint32_t attr_len, AI_IMAGE_ATTR_T *image)
 {
-    return __ai_parse_image_attr(de_buf, attr_len, image);
+    OPERATE_RET rt = OPRT_OK;
+    AI_ATTR_INDEX_T index;
+    TUYA_CALL_ERR_RETURN(tuya_ai_attr_index_parse(de_buf, attr_len, &index));
+    return __ai_parse_image_attr(&index, image);
 }
 
 OPERATE_RET tuya_ai_parse_file_attr(char *de_buf, uint32_t attr_len, AI_FILE_ATTR_T *file)
 {
-    return __ai_parse_file_attr(de_buf, attr_len, file);
+    OPERATE_RET rt = OPRT_OK;
+    AI_ATTR_INDEX_T index;
+    TUYA_CALL_ERR_RETURN(tuya_ai_attr_index_parse(de_buf, attr_len, &index));
+    return __ai_parse_file_attr(&index, file);
 }
 
 OPERATE_RET tuya_ai_parse_text_attr(char *de_buf, uint32_t attr_len, AI_TEXT_ATTR_T *text)
 {
-    return __ai_parse_text_attr(de_buf, attr_len, text);
+    OPERATE_RET rt = OPRT_OK;
+    AI_ATTR_INDEX_T index;
+    TUYA_CALL_ERR_RETURN(tuya_ai_attr_index_parse(de_buf, attr_len, &index));
+    return __ai_parse_text_attr(&index, text);
 }
 
 OPERATE_RET tuya_ai_parse_event_attr(char *de_buf, uint32_t attr_len, AI_EVENT_ATTR_T *event)
 {
-    return __ai_parse_event_attr(de_buf, attr_len, event);
+    OPERATE_RET rt = OPRT_OK;
+    AI_ATTR_INDEX_T index;
+    TUYA_CALL_ERR_RETURN(tuya_ai_attr_index_parse(de_buf, attr_len, &index));
+    return __ai_parse_event_attr(&index, event);
 }
 
 OPERATE_RET tuya_ai_biz_monitor_register(AI_BIZ_MONITOR_CB recv_cb, AI_BIZ_MONITOR_CB send_cb, VOID *usr_data)
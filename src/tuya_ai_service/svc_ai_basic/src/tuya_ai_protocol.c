@@ -21,6 +21,7 @@
 #include "tuya_iot_config.h"
 #include "mbedtls/hkdf.h"
 #include "mbedtls/chacha20.h"
+#include "mbedtls/gcm.h"
 #include "gw_intf.h"
 #include "uni_log.h"
 #include "uni_random.h"
@@ -51,6 +52,15 @@
 #ifndef AI_SEND_PKT_TIMEOUT
 #define AI_SEND_PKT_TIMEOUT 6
 #endif
+/* send buffers kept across packets, each grows to the largest frame seen */
+#ifndef AI_PKT_POOL_NUM
+#define AI_PKT_POOL_NUM 2
+#endif
+#define AI_PKT_POOL_ALIGN 512
+/* hand fragments of downlink audio to the biz layer as they arrive instead of reassembling */
+#ifndef AI_RECV_AUDIO_STREAM
+#define AI_RECV_AUDIO_STREAM 1
+#endif
 
 /**
 *
@@ -72,6 +82,11 @@ typedef struct {
 typedef struct {
     uint32_t offset;
 } AI_SEND_FRAG_MNG_T;
+typedef struct {
+    char *buf;
+    uint32_t size;
+    BOOL_T busy;
+} AI_PKT_BUF_T;
 typedef struct {
     MUTEX_HANDLE mutex;
     tuya_transporter_t transporter;
@@ -90,12 +105,15 @@ typedef struct {
     AI_RECV_FRAG_MNG_T recv_frag_mng;
     AI_SEND_FRAG_MNG_T send_frag_mng[5];
     BOOL_T frag_flag;
+    BOOL_T recv_stream;
     char recv_buf[AI_MAX_FRAGMENT_LENGTH + AI_ADD_PKT_LEN];
     char *rsa_public_key;
     uint32_t file_seq;
     uint32_t text_seq;
+    AI_PKT_BUF_T pkt_pool[AI_PKT_POOL_NUM];
 } AI_BASIC_PROTO_T;
 STATIC AI_BASIC_PROTO_T *ai_basic_proto = NULL;
+STATIC AI_PKT_STAT_T s_pkt_stat = {0};
 
 STATIC OPERATE_RET __default_write(AI_PACKET_WRITER_T *writer, VOID *buf, uint32_t buf_len);
 
@@ -270,6 +288,7 @@ STATIC AI_PACKET_SL __ai_get_sl(AI_SEND_PACKET_T *info, BOOL_T is_decrypt)
 
 STATIC VOID __ai_basic_proto_deinit(VOID)
 {
+    uint32_t idx = 0;
     if (ai_basic_proto) {
         if (ai_basic_proto->transporter) {
             tuya_transporter_close(ai_basic_proto->transporter);
@@ -284,6 +303,11 @@ STATIC VOID __ai_basic_proto_deinit(VOID)
             OS_FREE(ai_basic_proto->connection_id);
             ai_basic_proto->connection_id = NULL;
         }
+        for (idx = 0; idx < AI_PKT_POOL_NUM; idx++) {
+            if (ai_basic_proto->pkt_pool[idx].buf) {
+                OS_FREE(ai_basic_proto->pkt_pool[idx].buf);
+            }
+        }
         OS_FREE(ai_basic_proto);
         ai_basic_proto = NULL;
         PR_NOTICE("ai proto deinit success");
@@ -317,6 +341,7 @@ STATIC VOID __ai_basic_proto_reinit(VOID)
     memset(ai_basic_proto->decrypt_iv, 0, AI_IV_LEN);
     memset(&ai_basic_proto->recv_frag_mng, 0, SIZEOF(ai_basic_proto->recv_frag_mng));
     memset(&ai_basic_proto->send_frag_mng, 0, SIZEOF(ai_basic_proto->send_frag_mng));
+    ai_basic_proto->recv_stream = FALSE;
     tal_mutex_unlock(ai_basic_proto->mutex);
     PR_NOTICE("ai proto reinit success");
     return;
@@ -634,13 +659,20 @@ STATIC OPERATE_RET __ai_encrypt_clint_hello_info(char *pubkey, char *out, uint32
         PR_ERR("RSA encrypt error \r\n");
         return OPRT_COM_ERROR;
     }
+    // the body is serialized behind the room reserved for rsa and iv
+    if (positon > AI_RSA_PKT_LEN) {
+        PR_ERR("RSA len %d over %d", positon, AI_RSA_PKT_LEN);
+        return OPRT_COM_ERROR;
+    }
 
     memcpy(out + positon, iv, AI_IV_LEN);
     positon += AI_IV_LEN;
     // tuya_debug_hex_dump("RSA +iv ", 64, (uint8_t *)out, positon);
 
     aes_p = out + positon;
-    memcpy(aes_p, data, len);
+    if (aes_p != data) {
+        memmove(aes_p, data, len);
+    }
 
     rt = mbedtls_cipher_auth_encrypt_wrapper(
     &(CONST cipher_params_t) {
@@ -679,7 +711,9 @@ STATIC OPERATE_RET __ai_encrypt_packet(AI_SEND_PACKET_T *info, char *data, uint3
     AI_PACKET_SL sl = __ai_get_sl(info, FALSE);
     if (sl == AI_PACKET_SL2) {
 #if (AI_PACKET_SECURITY_LEVEL == AI_PACKET_SL2)
-        memcpy(output, data, len);
+        if (output != data) {
+            memcpy(output, data, len);
+        }
         data_out_len = __ai_encrypt_add_pkcs(output, len);
         char nonce[12] = {0};
         memcpy(nonce, ai_basic_proto->encrypt_iv, SIZEOF(nonce));
@@ -692,7 +726,9 @@ STATIC OPERATE_RET __ai_encrypt_packet(AI_SEND_PACKET_T *info, char *data, uint3
 #endif
     } else if (sl == AI_PACKET_SL3) {
 #if (AI_PACKET_SECURITY_LEVEL == AI_PACKET_SL3)
-        memcpy(output, data, len);
+        if (output != data) {
+            memcpy(output, data, len);
+        }
         data_out_len = tal_pkcs7padding_buffer((uint8_t *)output, len);
         rt = tal_aes256_cbc_encode_raw((uint8_t *)output, data_out_len, (uint8_t *)key, (uint8_t *)ai_basic_proto->encrypt_iv, (uint8_t *)output);
         if (OPRT_OK != rt) {
@@ -711,7 +747,9 @@ STATIC OPERATE_RET __ai_encrypt_packet(AI_SEND_PACKET_T *info, char *data, uint3
 #endif
 
         uint8_t tag[AI_GCM_TAG_LEN] = {0};
-        memcpy(output, data, len);
+        if (output != data) {
+            memcpy(output, data, len);
+        }
 #if defined(AI_VERSION) && (0x01 == AI_VERSION)
         data_out_len = __ai_encrypt_add_pkcs(output, len);
 #else
@@ -744,7 +782,9 @@ STATIC OPERATE_RET __ai_encrypt_packet(AI_SEND_PACKET_T *info, char *data, uint3
 #endif
     } else if (sl == AI_PACKET_SL0) {
         AI_PROTO_D("sl:%d do not need crypt", sl);
-        memcpy(output, data, len);
+        if (output != data) {
+            memcpy(output, data, len);
+        }
         *en_len = len;
     } else if (sl == AI_PACKET_RSA) {
         rt = __ai_encrypt_clint_hello_info(ai_basic_proto->rsa_public_key, output, en_len, data, len);
@@ -800,24 +840,26 @@ STATIC OPERATE_RET __ai_decrypt_packet(char *data, uint32_t len, char *output, u
         // tuya_debug_hex_dump("decrypt_iv v2", 64, (uint8_t *)iv, AI_IV_LEN);
 #endif
         // tuya_debug_hex_dump("decrypt_tag", 64, (uint8_t *)(data + len - AI_GCM_TAG_LEN), AI_GCM_TAG_LEN);
-        rt = mbedtls_cipher_auth_decrypt_wrapper(
-        &(CONST cipher_params_t) {
-            .cipher_type = MBEDTLS_CIPHER_AES_256_GCM,
-            .key = (unsigned char *)key,
-            .key_len = AI_KEY_LEN,
+        if (len < AI_GCM_TAG_LEN) {
+            PR_ERR("gcm packet too short:%d", len);
+            return OPRT_INVALID_PARM;
+        }
 #if defined(AI_VERSION) && (0x01 == AI_VERSION)
-            .nonce = (uint8_t *)ai_basic_proto->decrypt_iv,
+        uint8_t *nonce = (uint8_t *)ai_basic_proto->decrypt_iv;
 #else
-            .nonce = (uint8_t *)iv,
+        uint8_t *nonce = iv;
 #endif
-            .nonce_len = AI_IV_LEN,
-            .ad = NULL,
-            .ad_len = 0,
-            .data = (uint8_t *)data,
-            .data_len = len - AI_GCM_TAG_LEN
-        },
-        (uint8_t *)output, (size_t *)de_len,
-        (uint8_t *)(data + len - AI_GCM_TAG_LEN), AI_GCM_TAG_LEN);
+        // gcm can decrypt in place, the tag is verified before the plaintext is released
+        mbedtls_gcm_context gcm;
+        mbedtls_gcm_init(&gcm);
+        rt = mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, (uint8_t *)key, AI_KEY_LEN * 8);
+        if (OPRT_OK == rt) {
+            rt = mbedtls_gcm_auth_decrypt(&gcm, len - AI_GCM_TAG_LEN, nonce, AI_IV_LEN, NULL, 0,
+                                          (uint8_t *)(data + len - AI_GCM_TAG_LEN), AI_GCM_TAG_LEN,
+                                          (uint8_t *)data, (uint8_t *)output);
+        }
+        mbedtls_gcm_free(&gcm);
+        *de_len = len - AI_GCM_TAG_LEN;
         if (rt != OPRT_OK) {
             PR_ERR("aes128_gcm_decode error:%x", rt);
             return rt;
@@ -830,7 +872,9 @@ STATIC OPERATE_RET __ai_decrypt_packet(char *data, uint32_t len, char *output, u
 #endif
     } else if (sl == AI_PACKET_SL0) {
         AI_PROTO_D("sl:%d do not need crypt ", sl);
-        memcpy(output, data, len);
+        if (output != data) {
+            memcpy(output, data, len);
+        }
         *de_len = len;
     } else {
         AI_PROTO_D("sl:%d err", sl);
@@ -848,9 +892,11 @@ STATIC OPERATE_RET __ai_pack_payload(AI_SEND_PACKET_T *info, char *payload_buf,
     TUYA_CHECK_NULL_RETURN(info, OPRT_INVALID_PARM);
     packet_len = __ai_get_send_payload_len(info, frag);
 
-    char *buf = OS_MALLOC(packet_len);
-    TUYA_CHECK_NULL_RETURN(buf, OPRT_MALLOC_FAILED);
-    memset(buf, 0, packet_len);
+    // serialize in place, client hello keeps the room for rsa and iv in front
+    char *buf = payload_buf;
+    if (AI_PACKET_RSA == __ai_get_sl(info, FALSE)) {
+        buf += AI_RSA_PKT_LEN + AI_IV_LEN;
+    }
 
     if (tuya_ai_is_need_attr(frag)) {
         AI_PAYLOAD_HEAD_T payload_head = {0};
@@ -899,7 +945,6 @@ STATIC OPERATE_RET __ai_pack_payload(AI_SEND_PACKET_T *info, char *payload_buf,
                     memcpy(buf + offset, info->attrs[idx]->value.str, attr_idx_len);
                 } else {
                     PR_ERR("unknow payload type:%d", payload_type);
-                    OS_FREE(buf);
                     return OPRT_COM_ERROR;
                 }
                 offset += attr_idx_len;
@@ -918,6 +963,9 @@ STATIC OPERATE_RET __ai_pack_payload(AI_SEND_PACKET_T *info, char *payload_buf,
     memcpy(buf + offset, info->data, info->len);
     offset += info->len;
     AI_PROTO_D("payload len:%d, offset:%d", packet_len, offset);
+    if (offset < packet_len) {
+        memset(buf + offset, 0, packet_len - offset);
+    }
 
     // tuya_debug_hex_dump("payload_uncrypt", 64, (uint8_t *)buf, packet_len);
     rt = __ai_encrypt_packet(info, buf, packet_len, payload_buf, payload_len, sequence);
@@ -925,7 +973,6 @@ STATIC OPERATE_RET __ai_pack_payload(AI_SEND_PACKET_T *info, char *payload_buf,
         PR_ERR("encrypt packet failed, rt:%d", rt);
     }
 
-    OS_FREE(buf);
     return rt;
 }
 
@@ -1060,6 +1107,100 @@ OPERATE_RET tuya_ai_get_attr_value(char *de_buf, uint32_t *offset, AI_ATTRIBUTE_
     return rt;
 }
 
+OPERATE_RET tuya_ai_attr_index_parse(char *de_buf, uint32_t attr_len, AI_ATTR_INDEX_T *index)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t offset = 0;
+    TUYA_CHECK_NULL_RETURN(index, OPRT_INVALID_PARM);
+
+    index->num = 0;
+    while (offset < attr_len) {
+        if (index->num >= AI_RECV_ATTR_MAX_NUM) {
+            PR_ERR("too many attrs, max:%d", AI_RECV_ATTR_MAX_NUM);
+            return OPRT_EXCEED_UPPER_LIMIT;
+        }
+        memset(&index->attr[index->num], 0, SIZEOF(AI_ATTRIBUTE_T));
+        rt = tuya_ai_get_attr_value(de_buf, &offset, &index->attr[index->num]);
+        if (OPRT_OK != rt) {
+            PR_ERR("get attr value failed, rt:%d", rt);
+            return rt;
+        }
+        index->num++;
+    }
+    return rt;
+}
+
+AI_ATTRIBUTE_T *tuya_ai_attr_index_find(AI_ATTR_INDEX_T *index, AI_ATTR_TYPE type)
+{
+    uint32_t idx = 0;
+    for (idx = 0; idx < index->num; idx++) {
+        if (index->attr[idx].type == type) {
+            return &index->attr[idx];
+        }
+    }
+    return NULL;
+}
+
+/* called with ai_basic_proto->mutex held, the pool needs no lock of its own */
+STATIC char *__ai_pkt_buf_get(uint32_t len)
+{
+    uint32_t idx = 0, size = 0;
+    AI_PKT_BUF_T *slot = NULL;
+    char *buf = NULL;
+
+    s_pkt_stat.packets++;
+    for (idx = 0; idx < AI_PKT_POOL_NUM; idx++) {
+        if (!ai_basic_proto->pkt_pool[idx].busy) {
+            slot = &ai_basic_proto->pkt_pool[idx];
+            break;
+        }
+    }
+    if (NULL == slot) {
+        s_pkt_stat.allocs++;
+        return OS_MALLOC(len);
+    }
+
+    if (slot->size < len) {
+        size = (len + AI_PKT_POOL_ALIGN - 1) & ~(AI_PKT_POOL_ALIGN - 1);
+        if (size > AI_MAX_FRAGMENT_LENGTH) {
+            size = len;
+        }
+        buf = OS_MALLOC(size);
+        TUYA_CHECK_NULL_RETURN(buf, NULL);
+        s_pkt_stat.allocs++;
+        if (slot->buf) {
+            OS_FREE(slot->buf);
+        }
+        slot->buf = buf;
+        slot->size = size;
+    } else {
+        s_pkt_stat.pool_hits++;
+    }
+    slot->busy = TRUE;
+
+    return slot->buf;
+}
+
+STATIC VOID __ai_pkt_buf_put(char *buf)
+{
+    uint32_t idx = 0;
+
+    for (idx = 0; idx < AI_PKT_POOL_NUM; idx++) {
+        if (ai_basic_proto->pkt_pool[idx].buf == buf) {
+            ai_basic_proto->pkt_pool[idx].busy = FALSE;
+            return;
+        }
+    }
+    OS_FREE(buf);
+}
+
+OPERATE_RET tuya_ai_basic_pkt_stat(AI_PKT_STAT_T *stat)
+{
+    TUYA_CHECK_NULL_RETURN(stat, OPRT_INVALID_PARM);
+    memcpy(stat, &s_pkt_stat, SIZEOF(AI_PKT_STAT_T));
+    return OPRT_OK;
+}
+
 STATIC OPERATE_RET __ai_packet_write(AI_SEND_PACKET_T *info, AI_FRAG_FLAG frag, uint32_t origin_len)
 {
     OPERATE_RET rt = OPRT_OK;
@@ -1087,9 +1228,8 @@ STATIC OPERATE_RET __ai_packet_write(AI_SEND_PACKET_T *info, AI_FRAG_FLAG frag,
         PR_ERR("send packet too long, len: %d", uncrypt_len);
         return OPRT_COM_ERROR;
     }
-    char *send_pkt_buf = OS_MALLOC(uncrypt_len);
+    char *send_pkt_buf = __ai_pkt_buf_get(uncrypt_len);
     TUYA_CHECK_NULL_RETURN(send_pkt_buf, OPRT_MALLOC_FAILED);
-    memset(send_pkt_buf, 0, uncrypt_len);
 
 #if defined(AI_VERSION) && (0x01 == AI_VERSION)
     uint32_t head_len = SIZEOF(AI_PACKET_HEAD_T);
@@ -1188,7 +1328,7 @@ STATIC OPERATE_RET __ai_packet_write(AI_SEND_PACKET_T *info, AI_FRAG_FLAG frag,
     }
 
 EXIT:
-    OS_FREE(send_pkt_buf);
+    __ai_pkt_buf_put(send_pkt_buf);
     return rt;
 }
 
@@ -1776,6 +1916,11 @@ STATIC int __ai_baisc_read_pkt_head(char *recv_buf)
 
 VOID tuya_ai_basic_pkt_free(char *data)
 {
+    // packets that were not reassembled are decrypted in the receive buffer
+    if ((data >= ai_basic_proto->recv_buf) &&
+        (data < ai_basic_proto->recv_buf + SIZEOF(ai_basic_proto->recv_buf))) {
+        return;
+    }
     if (data == ai_basic_proto->recv_frag_mng.data) {
         OS_FREE(data);
         ai_basic_proto->recv_frag_mng.data = NULL;
@@ -1799,6 +1944,15 @@ STATIC BOOL_T __ai_basic_get_frag_flag()
     return ai_basic_proto->frag_flag;
 }
 
+STATIC BOOL_T __ai_basic_is_stream_pkt(char *payload)
+{
+#if defined(AI_RECV_AUDIO_STREAM) && (AI_RECV_AUDIO_STREAM == 1)
+    return (AI_PT_AUDIO == ((AI_PAYLOAD_HEAD_T *)payload)->type) ? TRUE : FALSE;
+#else
+    return FALSE;
+#endif
+}
+
 OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *out_frag)
 {
     OPERATE_RET rt = OPRT_OK;
@@ -1806,11 +1960,9 @@ OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *
     uint8_t calc_sign[AI_SIGN_LEN] = {0};
     uint8_t packet_sign[AI_SIGN_LEN] = {0};
 #endif
-    char *decrypt_buf = NULL;
     char *recv_buf = ai_basic_proto->recv_buf;
     TUYA_CHECK_NULL_RETURN(recv_buf, OPRT_COM_ERROR);
 
-    memset(recv_buf, 0, SIZEOF(ai_basic_proto->recv_buf));
     AI_PROTO_D("recv packet ing");
     int recv_len = __ai_baisc_read_pkt_head(recv_buf);
     if (recv_len <= 0) {
@@ -1840,7 +1992,8 @@ OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *
     AI_PROTO_D("recv head len:%d", head_len);
     AI_PROTO_D("recv packet len:%d", packet_len);
 
-    if (packet_len + head_len > SIZEOF(ai_basic_proto->recv_buf)) {
+    // keep a byte behind the packet to terminate the plaintext
+    if (packet_len + head_len >= SIZEOF(ai_basic_proto->recv_buf)) {
         PR_ERR("recv packet too long, pkt len:%u, head len:%u", packet_len, head_len);
         recv_len = OPRT_RESOURCE_NOT_READY;
         goto EXIT;
@@ -1900,19 +2053,30 @@ OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *
     char *payload = recv_buf + head_len;
 #endif
     uint32_t decrypt_len = 0;
-    decrypt_buf = OS_MALLOC(packet_len + head_len + AI_ADD_PKT_LEN);
-    TUYA_CHECK_NULL_RETURN(decrypt_buf, OPRT_MALLOC_FAILED);
-    memset(decrypt_buf, 0, packet_len + head_len + AI_ADD_PKT_LEN);
+    // decrypt in place, the plaintext is never longer than the cipher text
+    char *decrypt_buf = payload;
     rt = __ai_decrypt_packet(payload, payload_len, decrypt_buf, &decrypt_len, UNI_NTOHS(head->sequence));
     if (OPRT_OK != rt) {
         PR_ERR("decrypt packet failed, rt:%d", rt);
         goto EXIT;
     }
+    decrypt_buf[decrypt_len] = 0;
     AI_PROTO_D("decrypt len:%d", decrypt_len);
     AI_PROTO_D("frag flag:%d, sdk frag flag:%d", head->frag_flag, __ai_basic_get_frag_flag());
 
-    if (!__ai_basic_get_frag_flag()) {
-        AI_FRAG_FLAG current_frag_flag = head->frag_flag;
+    AI_FRAG_FLAG current_frag_flag = head->frag_flag;
+    if (ai_basic_proto->recv_stream &&
+        ((current_frag_flag == AI_PACKET_NO_FRAG) || (current_frag_flag == AI_PACKET_FRAG_START))) {
+        PR_ERR("recv new packet, but stream frag not end %d", current_frag_flag);
+        ai_basic_proto->recv_stream = FALSE;
+    }
+    if (!__ai_basic_get_frag_flag() && (current_frag_flag == AI_PACKET_FRAG_START) &&
+        __ai_basic_is_stream_pkt(decrypt_buf)) {
+        AI_PROTO_D("recv stream frag start, len:%d", decrypt_len);
+        ai_basic_proto->recv_stream = TRUE;
+    }
+
+    if (!__ai_basic_get_frag_flag() && !ai_basic_proto->recv_stream) {
         AI_FRAG_FLAG last_frag_flag = ai_basic_proto->recv_frag_mng.frag_flag;
         if ((last_frag_flag == AI_PACKET_FRAG_START) || (last_frag_flag == AI_PACKET_FRAG_ING)) {
             if ((current_frag_flag != AI_PACKET_FRAG_ING) && (current_frag_flag != AI_PACKET_FRAG_END)) {
@@ -1957,8 +2121,6 @@ OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *
             memset(ai_basic_proto->recv_frag_mng.data, 0, frag_total_len);
             memcpy(ai_basic_proto->recv_frag_mng.data, decrypt_buf, decrypt_len);
             ai_basic_proto->recv_frag_mng.offset = decrypt_len;
-            OS_FREE(decrypt_buf);
-            decrypt_buf = NULL;
             rt = tuya_ai_basic_pkt_read(out, out_len, out_frag);
             if (rt != OPRT_OK) {
                 PR_ERR("read continue frag packet failed, rt:%d", rt);
@@ -1968,8 +2130,6 @@ OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *
             memcpy(ai_basic_proto->recv_frag_mng.data + ai_basic_proto->recv_frag_mng.offset, decrypt_buf, decrypt_len);
             ai_basic_proto->recv_frag_mng.frag_flag = current_frag_flag;
             ai_basic_proto->recv_frag_mng.offset += decrypt_len;
-            OS_FREE(decrypt_buf);
-            decrypt_buf = NULL;
             rt = tuya_ai_basic_pkt_read(out, out_len, out_frag);
             if (rt != OPRT_OK) {
                 PR_ERR("read continue ing frag packet failed, rt:%d", rt);
@@ -1979,8 +2139,6 @@ OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *
             memcpy(ai_basic_proto->recv_frag_mng.data + ai_basic_proto->recv_frag_mng.offset, decrypt_buf, decrypt_len);
             ai_basic_proto->recv_frag_mng.frag_flag = current_frag_flag;
             ai_basic_proto->recv_frag_mng.offset += decrypt_len;
-            OS_FREE(decrypt_buf);
-            decrypt_buf = NULL;
             *out = ai_basic_proto->recv_frag_mng.data;
             *out_len = ai_basic_proto->recv_frag_mng.offset;
             *out_frag = AI_PACKET_NO_FRAG;
@@ -1990,18 +2148,19 @@ OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *
             *out_frag = AI_PACKET_NO_FRAG;
         }
     } else {
+        // each fragment is authenticated on its own, pass it on before the rest arrives
+        if (current_frag_flag == AI_PACKET_FRAG_END) {
+            ai_basic_proto->recv_stream = FALSE;
+        }
         *out = decrypt_buf;
         *out_len = decrypt_len;
-        *out_frag = head->frag_flag;
+        *out_frag = current_frag_flag;
     }
     AI_PROTO_D("recv packet len:%d", *out_len);
     return rt;
 
 EXIT:
-    if (decrypt_buf) {
-        OS_FREE(decrypt_buf);
-        decrypt_buf = NULL;
-    }
+    ai_basic_proto->recv_stream = FALSE;
     if (ai_basic_proto->recv_frag_mng.data) {
         OS_FREE(ai_basic_proto->recv_frag_mng.data);
     }
@@ -2139,7 +2298,7 @@ OPERATE_RET tuya_ai_auth_resp(VOID)
     AI_PAYLOAD_HEAD_T *packet = (AI_PAYLOAD_HEAD_T *)de_buf;
     if (packet->attribute_flag != AI_HAS_ATTR) {
         PR_ERR("auth resp packet has no attribute");
-        OS_FREE(de_buf);
+        tuya_ai_basic_pkt_free(de_buf);
         return OPRT_COM_ERROR;
     }
 
@@ -2155,7 +2314,7 @@ OPERATE_RET tuya_ai_auth_resp(VOID)
         PR_ERR("auth resp packet type error %d", packet->type);
         rt = OPRT_COM_ERROR;
     }
-    OS_FREE(de_buf);
+    tuya_ai_basic_pkt_free(de_buf);
     return rt;
 }
 
@@ -336,26 +336,327 @@ static void mqtt_client_subscribed_cb(void *client, uint16_t msgid, void *userda
     PR_DEBUG("Subscribe successed ID:%d", msgid);
 }
 
+/*
+ * Publish buffers carry their publish handle in front of the protocol frame:
+ * [handle][PV23 head room][data][PV23 tail room]. A QoS1 message is waiting
+ * in the send queue until it has a msgid, then in the in-flight bucket of
+ * its msgid, and meanwhile in the timeout wheel slot of its timeout. All of
+ * it is guarded by publish_mutex, the notify callbacks run unlocked.
+ */
+#define MQTT_PUBLISH_HANDLE_ROOM ((sizeof(mqtt_publish_handle_t) + 7) & ~(size_t)7)
+
+/* called with publish_mutex held */
+static uint8_t *mqtt_publish_buf_alloc(tuya_mqtt_context_t *context, size_t len)
+{
+    mqtt_publish_buf_t *slot = NULL;
+    uint8_t *buf = NULL;
+    size_t size = 0;
+    int idx;
+
+    for (idx = 0; idx < MQTT_PUBLISH_POOL_NUM; idx++) {
+        if (!context->publish_pool[idx].busy) {
+            slot = &context->publish_pool[idx];
+            break;
+        }
+    }
+    if (slot == NULL || len > MQTT_PUBLISH_POOL_SIZE_MAX) {
+        return tal_malloc(len);
+    }
+
+    if (slot->size < len) {
+        size = (len + MQTT_PUBLISH_POOL_ALIGN - 1) & ~(size_t)(MQTT_PUBLISH_POOL_ALIGN - 1);
+        buf = tal_malloc(size);
+        TUYA_CHECK_NULL_RETURN(buf, NULL);
+        if (slot->buf) {
+            tal_free(slot->buf);
+        }
+        slot->buf = buf;
+        slot->size = size;
+    }
+    slot->busy = true;
+
+    return slot->buf;
+}
+
+/* called with publish_mutex held */
+static void mqtt_publish_buf_free(tuya_mqtt_context_t *context, uint8_t *buf)
+{
+    int idx;
+
+    for (idx = 0; idx < MQTT_PUBLISH_POOL_NUM; idx++) {
+        if (context->publish_pool[idx].buf == buf) {
+            context->publish_pool[idx].busy = false;
+            return;
+        }
+    }
+    tal_free(buf);
+}
+
+static void mqtt_publish_link(mqtt_publish_handle_t **head, mqtt_publish_handle_t *handle)
+{
+    handle->next = *head;
+    if (*head) {
+        (*head)->pprev = &handle->next;
+    }
+    handle->pprev = head;
+    *head = handle;
+}
+
+static void mqtt_publish_unlink(tuya_mqtt_context_t *context, mqtt_publish_handle_t *handle)
+{
+    if (handle->pprev) {
+        if (context->publish_queue_tail == &handle->next) {
+            context->publish_queue_tail = handle->pprev;
+        }
+        *handle->pprev = handle->next;
+        if (handle->next) {
+            handle->next->pprev = handle->pprev;
+        }
+        handle->pprev = NULL;
+    }
+    handle->next = NULL;
+}
+
+static void mqtt_publish_queue_add(tuya_mqtt_context_t *context, mqtt_publish_handle_t *handle)
+{
+    handle->next = NULL;
+    handle->pprev = context->publish_queue_tail;
+    *context->publish_queue_tail = handle;
+    context->publish_queue_tail = &handle->next;
+}
+
+static void mqtt_publish_queue_add_head(tuya_mqtt_context_t *context, mqtt_publish_handle_t *handle)
+{
+    mqtt_publish_link(&context->publish_queue, handle);
+    if (handle->next == NULL) {
+        context->publish_queue_tail = &handle->next;
+    }
+}
+
+static void mqtt_publish_inflight_add(tuya_mqtt_context_t *context, mqtt_publish_handle_t *handle)
+{
+    mqtt_publish_link(&context->publish_inflight[handle->msgid & (MQTT_PUBLISH_INFLIGHT_BUCKETS - 1)], handle);
+}
+
+static void mqtt_publish_wheel_add(tuya_mqtt_context_t *context, mqtt_publish_handle_t *handle)
+{
+    uint32_t tick = handle->timeout / MQTT_PUBLISH_WHEEL_TICK_MS;
+
+    /* already due, the next expire visits the current slot */
+    if ((int32_t)(tick - context->publish_wheel_tick) < 0) {
+        tick = context->publish_wheel_tick;
+    }
+
+    mqtt_publish_handle_t **slot = &context->publish_wheel[tick % MQTT_PUBLISH_WHEEL_SLOTS];
+    handle->tnext = *slot;
+    if (*slot) {
+        (*slot)->tprev = &handle->tnext;
+    }
+    handle->tprev = slot;
+    *slot = handle;
+}
+
+static void mqtt_publish_wheel_del(mqtt_publish_handle_t *handle)
+{
+    if (handle->tprev) {
+        *handle->tprev = handle->tnext;
+        if (handle->tnext) {
+            handle->tnext->tprev = handle->tprev;
+        }
+        handle->tprev = NULL;
+    }
+    handle->tnext = NULL;
+}
+
+/* called with publish_mutex held, returns the timed out messages linked by next */
+static mqtt_publish_handle_t *mqtt_publish_expire(tuya_mqtt_context_t *context, uint32_t now)
+{
+    mqtt_publish_handle_t *expired = NULL;
+    uint32_t tick = now / MQTT_PUBLISH_WHEEL_TICK_MS;
+    uint32_t t = context->publish_wheel_tick;
+
+    /* one turn of the wheel visits every slot */
+    if (tick - t >= MQTT_PUBLISH_WHEEL_SLOTS) {
+        t = tick - (MQTT_PUBLISH_WHEEL_SLOTS - 1);
+    }
+
+    for (;; t++) {
+        mqtt_publish_handle_t *handle = context->publish_wheel[t % MQTT_PUBLISH_WHEEL_SLOTS];
+        while (handle) {
+            mqtt_publish_handle_t *tnext = handle->tnext;
+            if ((int32_t)(handle->timeout - now) <= 0) {
+                mqtt_publish_wheel_del(handle);
+                mqtt_publish_unlink(context, handle);
+                handle->next = expired;
+                expired = handle;
+            }
+            handle = tnext;
+        }
+        if (t == tick) {
+            break;
+        }
+    }
+    /* revisit the current slot, it may still get messages due in this tick */
+    context->publish_wheel_tick = tick;
+
+    return expired;
+}
+
+/* releases the messages linked by next and notifies them, called unlocked */
+static void mqtt_publish_done(tuya_mqtt_context_t *context, mqtt_publish_handle_t *list, int result)
+{
+    while (list) {
+        mqtt_publish_handle_t *handle = list;
+        mqtt_publish_notify_cb_t cb = handle->cb;
+        void *user_data = handle->user_data;
+
+        list = handle->next;
+        tal_mutex_lock(context->publish_mutex);
+        mqtt_publish_buf_free(context, handle->buffer);
+        tal_mutex_unlock(context->publish_mutex);
+        cb(result, user_data);
+    }
+}
+
+/* puts the message in flight before it is sent, so an early PUBACK finds it.
+ * Called with publish_mutex held. */
+static void mqtt_publish_send_begin(tuya_mqtt_context_t *context, mqtt_publish_handle_t *handle)
+{
+    handle->msgid = mqtt_client_packet_id(context->mqtt_client);
+    handle->sending = true;
+    handle->acked = false;
+    mqtt_publish_inflight_add(context, handle);
+}
+
+/* takes the message out of flight again if the send failed, returns true if
+ * it was acked meanwhile and is done. Called with publish_mutex held. */
+static bool mqtt_publish_send_end(tuya_mqtt_context_t *context, mqtt_publish_handle_t *handle,
+                                  mqtt_client_status_t status)
+{
+    handle->sending = false;
+    if (status != MQTT_STATUS_SUCCESS) {
+        mqtt_publish_unlink(context, handle);
+        handle->msgid = 0;
+        return false;
+    }
+    if (handle->acked) {
+        mqtt_publish_wheel_del(handle);
+        mqtt_publish_unlink(context, handle);
+        return true;
+    }
+    return false;
+}
+
+/* takes over buf, the handle lives at its start */
+static int mqtt_publish_start(tuya_mqtt_context_t *context, const char *topic, uint8_t *buf, uint8_t *payload,
+                              size_t payload_length, mqtt_publish_notify_cb_t cb, void *user_data, int timeout_ms,
+                              bool async)
+{
+    mqtt_publish_handle_t *handle = (mqtt_publish_handle_t *)buf;
+    mqtt_publish_handle_t *acked = NULL;
+
+    memset(handle, 0, sizeof(mqtt_publish_handle_t));
+    handle->topic = (char *)topic;
+    handle->timeout = (uint32_t)tal_system_get_millisecond() + timeout_ms;
+    handle->cb = cb;
+    handle->user_data = user_data;
+    handle->payload = payload;
+    handle->payload_length = payload_length;
+    handle->buffer = buf;
+
+    if (async) {
+        tal_mutex_lock(context->publish_mutex);
+        mqtt_publish_queue_add(context, handle);
+        mqtt_publish_wheel_add(context, handle);
+        tal_mutex_unlock(context->publish_mutex);
+        return OPRT_OK;
+    }
+
+    /* not yet on the wheel, so the loop cannot time it out while it is sent unlocked */
+    tal_mutex_lock(context->publish_mutex);
+    mqtt_publish_send_begin(context, handle);
+    tal_mutex_unlock(context->publish_mutex);
+
+    mqtt_client_status_t status = mqtt_client_publish_with_id(context->mqtt_client, handle->topic, handle->payload,
+                                                              handle->payload_length, MQTT_QOS_1, handle->msgid);
+
+    tal_mutex_lock(context->publish_mutex);
+    if (mqtt_publish_send_end(context, handle, status)) {
+        acked = handle;
+    } else {
+        if (status != MQTT_STATUS_SUCCESS) {
+            mqtt_publish_queue_add(context, handle);
+        }
+        mqtt_publish_wheel_add(context, handle);
+    }
+    tal_mutex_unlock(context->publish_mutex);
+    mqtt_publish_done(context, acked, OPRT_OK);
+
+    return OPRT_OK;
+}
+
+/* times out and sends the queued messages, runs in the loop */
+static void mqtt_publish_process(tuya_mqtt_context_t *context)
+{
+    mqtt_publish_handle_t *handle = NULL;
+
+    tal_mutex_lock(context->publish_mutex);
+    handle = mqtt_publish_expire(context, (uint32_t)tal_system_get_millisecond());
+    tal_mutex_unlock(context->publish_mutex);
+    mqtt_publish_done(context, handle, OPRT_TIMEOUT);
+
+    /* in order, a message that fails waits for the next loop with the rest.
+     * While it is sent unlocked it is in flight and on the wheel, which is
+     * expired by this loop alone. */
+    tal_mutex_lock(context->publish_mutex);
+    while ((handle = context->publish_queue) != NULL) {
+        mqtt_publish_unlink(context, handle);
+        mqtt_publish_send_begin(context, handle);
+        tal_mutex_unlock(context->publish_mutex);
+
+        mqtt_client_status_t status = mqtt_client_publish_with_id(
+            context->mqtt_client, handle->topic, handle->payload, handle->payload_length, MQTT_QOS_1, handle->msgid);
+
+        tal_mutex_lock(context->publish_mutex);
+        if (mqtt_publish_send_end(context, handle, status)) {
+            tal_mutex_unlock(context->publish_mutex);
+            mqtt_publish_done(context, handle, OPRT_OK);
+            tal_mutex_lock(context->publish_mutex);
+            continue;
+        }
+        if (status != MQTT_STATUS_SUCCESS) {
+            mqtt_publish_queue_add_head(context, handle);
+            break;
+        }
+    }
+    tal_mutex_unlock(context->publish_mutex);
+}
+
 static void mqtt_client_puback_cb(void *client, uint16_t msgid, void *userdata)
 {
     client = client;
     tuya_mqtt_context_t *context = (tuya_mqtt_context_t *)userdata;
+    mqtt_publish_handle_t *handle = NULL;
     PR_DEBUG("PUBACK ID:%d", msgid);
 
-    /* LOCK */
-    /* publish async process */
-    mqtt_publish_handle_t **next_handle = &context->publish_list;
-    for (; *next_handle; next_handle = &(*next_handle)->next) {
-        mqtt_publish_handle_t *entry = *next_handle;
-        if (msgid == entry->msgid) {
-            entry->cb(OPRT_OK, entry->user_data);
-            *next_handle = entry->next;
-            tal_free(entry->payload);
-            tal_free(entry);
+    tal_mutex_lock(context->publish_mutex);
+    handle = context->publish_inflight[msgid & (MQTT_PUBLISH_INFLIGHT_BUCKETS - 1)];
+    for (; handle; handle = handle->next) {
+        if (msgid == handle->msgid && handle->sending) {
+            /* the sender completes it once the send returns */
+            handle->acked = true;
+            handle = NULL;
+            break;
+        }
+        if (msgid == handle->msgid) {
+            mqtt_publish_wheel_del(handle);
+            mqtt_publish_unlink(context, handle);
             break;
         }
     }
-    /* UNLOCK */
+    tal_mutex_unlock(context->publish_mutex);
+
+    mqtt_publish_done(context, handle, OPRT_OK);
 }
 
 /**
@@ -375,6 +676,8 @@ int tuya_mqtt_init(tuya_mqtt_context_t *context, const tuya_mqtt_config_t *confi
 
     /* Clean to zero */
     memset(context, 0, sizeof(tuya_mqtt_context_t));
+    context->publish_queue_tail = &context->publish_queue;
+    context->publish_wheel_tick = (uint32_t)tal_system_get_millisecond() / MQTT_PUBLISH_WHEEL_TICK_MS;
 
     /* configuration */
     context->user_data = config->user_data;
@@ -433,6 +736,20 @@ int tuya_mqtt_init(tuya_mqtt_context_t *context, const tuya_mqtt_config_t *confi
     context->sequence_out = rand() & 0xffff;
     context->sequence_in = -1;
 
+    /* Publish path, the cipher is keyed once for every frame */
+    rt = tal_mutex_create_init(&context->publish_mutex);
+    if (OPRT_OK != rt) {
+        PR_ERR("publish mutex create error:%d", rt);
+        return rt;
+    }
+    rt = tal_cipher_create(NULL, (const uint8_t *)context->signature.cipherkey, 128, &context->cipher);
+    if (OPRT_OK != rt) {
+        PR_ERR("publish cipher create error:%d", rt);
+        tal_mutex_release(context->publish_mutex);
+        context->publish_mutex = NULL;
+        return rt;
+    }
+
     /* Wait start task */
     context->is_inited = true;
     context->manual_disconnect = true;
@@ -659,43 +976,120 @@ int tuya_mqtt_client_publish_common(tuya_mqtt_context_t *context, const char *to
         return OPRT_OK;
     }
 
-    mqtt_publish_handle_t *handle = tal_malloc(sizeof(mqtt_publish_handle_t));
-    TUYA_CHECK_NULL_RETURN(handle, OPRT_MALLOC_FAILED);
-    handle->next = NULL;
-    handle->msgid = 0;
-    handle->topic = (char *)topic;
-    handle->timeout = tal_time_get_posix() + timeout_ms;
-    handle->cb = cb;
-    handle->user_data = user_data;
-    handle->payload_length = payload_length;
-    if (payload_length > 0) {
-        handle->payload = tal_malloc(payload_length);
-        if (handle->payload == NULL) {
-            tal_free(handle);
-            return OPRT_MALLOC_FAILED;
-        }
-        memcpy(handle->payload, payload, payload_length);
-    } else {
-        handle->payload = NULL;
+    /* The payload is kept until the PUBACK, behind its handle */
+    tal_mutex_lock(context->publish_mutex);
+    uint8_t *buf = mqtt_publish_buf_alloc(context, MQTT_PUBLISH_HANDLE_ROOM + payload_length);
+    tal_mutex_unlock(context->publish_mutex);
+    TUYA_CHECK_NULL_RETURN(buf, OPRT_MALLOC_FAILED);
+    memcpy(buf + MQTT_PUBLISH_HANDLE_ROOM, payload, payload_length);
+
+    return mqtt_publish_start(context, topic, buf, buf + MQTT_PUBLISH_HANDLE_ROOM, payload_length, cb, user_data,
+                              timeout_ms, async);
+}
+
+/**
+ * @brief Gets a publish buffer for protocol data.
+ *
+ * @param context The MQTT context.
+ * @param data_len The maximum length of the protocol data.
+ * @param data Receives where the protocol data goes.
+ * @return The buffer, or NULL when out of memory.
+ */
+uint8_t *tuya_mqtt_publish_buf_get(tuya_mqtt_context_t *context, size_t data_len, char **data)
+{
+    if (context == NULL || context->is_inited == false || data == NULL) {
+        return NULL;
     }
 
-    if (async == false) {
-        handle->msgid = mqtt_client_publish(context->mqtt_client, handle->topic, handle->payload,
-                                            handle->payload_length, MQTT_QOS_1);
+    tal_mutex_lock(context->publish_mutex);
+    uint8_t *buf = mqtt_publish_buf_alloc(context, MQTT_PUBLISH_HANDLE_ROOM + PV23_INPLACE_HEADROOM + data_len +
+                                                       PV23_INPLACE_TAILROOM);
+    tal_mutex_unlock(context->publish_mutex);
+    TUYA_CHECK_NULL_RETURN(buf, NULL);
+
+    *data = (char *)(buf + MQTT_PUBLISH_HANDLE_ROOM + PV23_INPLACE_HEADROOM);
+    return buf;
+}
+
+/**
+ * @brief Puts back a publish buffer that was not published.
+ *
+ * @param context The MQTT context.
+ * @param buf The buffer from tuya_mqtt_publish_buf_get().
+ */
+void tuya_mqtt_publish_buf_put(tuya_mqtt_context_t *context, uint8_t *buf)
+{
+    if (context == NULL || context->is_inited == false || buf == NULL) {
+        return;
     }
 
-    if (context->publish_list == NULL) {
-        context->publish_list = handle;
-        return OPRT_OK;
+    tal_mutex_lock(context->publish_mutex);
+    mqtt_publish_buf_free(context, buf);
+    tal_mutex_unlock(context->publish_mutex);
+}
+
+/**
+ * @brief Publishes the protocol data held in a publish buffer.
+ *
+ * The frame is packed and encrypted in place and sent from the buffer, there
+ * is no copy of the data between its JSON and the socket.
+ *
+ * @param context The MQTT context.
+ * @param topic The topic to publish the data to.
+ * @param protocol_id The protocol ID.
+ * @param buf The buffer from tuya_mqtt_publish_buf_get(), taken over.
+ * @param data_len The length of the protocol data.
+ * @param cb The callback for the PUBACK, NULL publishes with QoS0.
+ * @param user_data User data to be passed to the callback function.
+ * @param timeout_ms The timeout for the PUBACK in milliseconds.
+ * @param async Send from tuya_mqtt_loop() instead of now.
+ * @return 0 on success, or a negative error code on failure.
+ */
+int tuya_mqtt_protocol_buf_publish_common(tuya_mqtt_context_t *context, const char *topic, uint16_t protocol_id,
+                                          uint8_t *buf, size_t data_len, mqtt_publish_notify_cb_t cb, void *user_data,
+                                          int timeout_ms, bool async)
+{
+    if (context == NULL || context->is_inited == false || buf == NULL) {
+        return OPRT_INVALID_PARM;
     }
 
-    mqtt_publish_handle_t *last = context->publish_list;
-    while (last->next != NULL) {
-        last = last->next;
+    int ret = OPRT_OK;
+    uint8_t *frame = NULL;
+    uint32_t frame_len = 0;
+
+    if (topic == NULL || (cb == NULL && async == true)) {
+        ret = OPRT_INVALID_PARM;
+        goto __exit;
     }
-    last->next = handle;
 
-    return OPRT_OK;
+    if (context->is_connected == false) {
+        ret = OPRT_COM_ERROR;
+        goto __exit;
+    }
+
+    /* The cipher handle is shared, serialize it */
+    tal_mutex_lock(context->publish_mutex);
+    ret = tuya_pack_protocol_data_inplace(context->cipher, protocol_id, buf + MQTT_PUBLISH_HANDLE_ROOM,
+                                          (uint32_t)data_len, &frame, &frame_len);
+    tal_mutex_unlock(context->publish_mutex);
+    if (ret != OPRT_OK) {
+        PR_ERR("tuya_pack_protocol_data_inplace error:%d", ret);
+        goto __exit;
+    }
+
+    if (cb == NULL) {
+        uint16_t msgid = mqtt_client_publish(context->mqtt_client, topic, frame, frame_len, MQTT_QOS_0);
+        if (msgid <= 0) {
+            ret = OPRT_COM_ERROR;
+        }
+        goto __exit;
+    }
+
+    return mqtt_publish_start(context, topic, buf, frame, frame_len, cb, user_data, timeout_ms, async);
+
+__exit:
+    tuya_mqtt_publish_buf_put(context, buf);
+    return ret;
 }
 
 /**
@@ -728,23 +1122,15 @@ int tuya_mqtt_protocol_data_publish_with_topic_common(tuya_mqtt_context_t *conte
         return OPRT_COM_ERROR;
     }
 
-    int ret = OPRT_OK;
-
-    char *buffer = NULL;
-    uint32_t buffer_len = 0;
+    /* The data is a string, as for tuya_pack_protocol_data() */
+    size_t data_len = strlen((const char *)data);
+    char *out = NULL;
+    uint8_t *buf = tuya_mqtt_publish_buf_get(context, data_len, &out);
+    TUYA_CHECK_NULL_RETURN(buf, OPRT_MALLOC_FAILED);
+    memcpy(out, data, data_len);
 
-    ret = tuya_pack_protocol_data(DP_CMD_MQ, (const char *)data, protocol_id, (uint8_t *)context->signature.cipherkey,
-                                  &buffer, &buffer_len);
-    if (ret != OPRT_OK) {
-        PR_ERR("tuya_pack_protocol_data error:%d", ret);
-        return ret;
-    }
-
-    /* mqtt client publish */
-    ret = tuya_mqtt_client_publish_common(context, (const char *)topic, (const uint8_t *)buffer, buffer_len, cb,
-                                          user_data, timeout_ms, async);
-    tal_free(buffer);
-    return ret;
+    return tuya_mqtt_protocol_buf_publish_common(context, topic, protocol_id, buf, data_len, cb, user_data, timeout_ms,
+                                                 async);
 }
 
 /**
@@ -861,26 +1247,8 @@ int tuya_mqtt_loop(tuya_mqtt_context_t *context)
         return rt;
     }
 
-    /* LOCK */
     /* publish async process */
-    mqtt_publish_handle_t **next_handle = &context->publish_list;
-    for (; *next_handle; next_handle = &(*next_handle)->next) {
-        mqtt_publish_handle_t *entry = *next_handle;
-
-        if (entry->timeout <= tal_time_get_posix()) {
-            entry->cb(OPRT_TIMEOUT, entry->user_data);
-            *next_handle = entry->next;
-            tal_free(entry->payload);
-            tal_free(entry);
-            continue;
-        }
-
-        if (entry->msgid <= 0) {
-            entry->msgid =
-                mqtt_client_publish(context->mqtt_client, entry->topic, entry->payload, entry->payload_length, 1);
-        }
-    }
-    /* UNLOCK */
+    mqtt_publish_process(context);
 
     /* yield */
     mqtt_client_yield(context->mqtt_client);
@@ -904,6 +1272,41 @@ int tuya_mqtt_destory(tuya_mqtt_context_t *context)
     }
 
     tuya_mqtt_protocol_unregister_all(context);
+
+    /* Drop the messages still waiting for a PUBACK */
+    mqtt_publish_handle_t *list = NULL;
+    mqtt_publish_handle_t *handle = NULL;
+    int idx;
+    tal_mutex_lock(context->publish_mutex);
+    while ((handle = context->publish_queue) != NULL) {
+        mqtt_publish_wheel_del(handle);
+        mqtt_publish_unlink(context, handle);
+        handle->next = list;
+        list = handle;
+    }
+    for (idx = 0; idx < MQTT_PUBLISH_INFLIGHT_BUCKETS; idx++) {
+        while ((handle = context->publish_inflight[idx]) != NULL) {
+            mqtt_publish_wheel_del(handle);
+            mqtt_publish_unlink(context, handle);
+            handle->next = list;
+            list = handle;
+        }
+    }
+    tal_mutex_unlock(context->publish_mutex);
+    mqtt_publish_done(context, list, OPRT_COM_ERROR);
+
+    for (idx = 0; idx < MQTT_PUBLISH_POOL_NUM; idx++) {
+        if (context->publish_pool[idx].buf) {
+            tal_free(context->publish_pool[idx].buf);
+            context->publish_pool[idx].buf = NULL;
+        }
+    }
+    tal_cipher_destroy(context->cipher);
+    context->cipher = NULL;
+    tal_mutex_release(context->publish_mutex);
+    context->publish_mutex = NULL;
+    context->is_inited = false;
+
     if (context->mqtt_client) {
         mqtt_client_status_t mqtt_status = mqtt_client_deinit(context->mqtt_client);
         mqtt_client_free(context->mqtt_client);
@@ -952,21 +1355,17 @@ int tuya_mqtt_upgrade_progress_report(tuya_mqtt_context_t *context, int channel,
         return OPRT_INVALID_PARM;
     }
 
-    uint8_t *data_buf = tal_malloc(128);
-    if (NULL == data_buf) {
+    char *data_buf = NULL;
+    uint8_t *buf = tuya_mqtt_publish_buf_get(context, 128, &data_buf);
+    if (NULL == buf) {
         return OPRT_MALLOC_FAILED;
     }
 
-    int buffer_size = snprintf((char *)data_buf, 128, "{\"progress\":\"%d\",\"firmwareType\":%d}", percent,
-                               channel);
-    if (buffer_size < 0 || buffer_size >= 128) {
-        tal_free(data_buf);
+    int buffer_size = snprintf(data_buf, 128 + 1, "{\"progress\":\"%d\",\"firmwareType\":%d}", percent, channel);
+    if (buffer_size < 0 || buffer_size > 128) {
+        tuya_mqtt_publish_buf_put(context, buf);
         return OPRT_BUFFER_NOT_ENOUGH;
     }
-    uint16_t msgid = tuya_mqtt_protocol_data_publish(context, PRO_UPGE_PUSH, data_buf, (uint16_t)buffer_size);
-    tal_free(data_buf);
-    if (msgid <= 0) {
-        return OPRT_COM_ERROR;
-    }
-    return OPRT_OK;
+    return tuya_mqtt_protocol_buf_publish_common(context, context->signature.topic_out, PRO_UPGE_PUSH, buf,
+                                                 buffer_size, NULL, NULL, 0, false);
 }
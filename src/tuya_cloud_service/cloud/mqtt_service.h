@@ -30,6 +30,8 @@ extern "C" {
 #include "cJSON.h"
 #include "mqtt_client_interface.h"
 #include "backoff_algorithm.h"
+#include "tal_mutex.h"
+#include "tal_cipher.h"
 
 // data max len
 #define TUYA_MQTT_CLIENTID_MAXLEN   (32U)
@@ -41,6 +43,26 @@ extern "C" {
 #define TUYA_MQTT_TOPIC_MAXLEN      (64U)
 #define TUYA_MQTT_TOPIC_MAXLEN      (64U)
 
+// publish path
+#ifndef MQTT_PUBLISH_POOL_NUM
+#define MQTT_PUBLISH_POOL_NUM (4) /* pooled publish buffers */
+#endif
+#ifndef MQTT_PUBLISH_POOL_ALIGN
+#define MQTT_PUBLISH_POOL_ALIGN (256) /* pooled buffers grow in these steps */
+#endif
+#ifndef MQTT_PUBLISH_POOL_SIZE_MAX
+#define MQTT_PUBLISH_POOL_SIZE_MAX (4096) /* larger buffers are not kept */
+#endif
+#ifndef MQTT_PUBLISH_INFLIGHT_BUCKETS
+#define MQTT_PUBLISH_INFLIGHT_BUCKETS (16) /* in-flight index by msgid, power of 2 */
+#endif
+#ifndef MQTT_PUBLISH_WHEEL_SLOTS
+#define MQTT_PUBLISH_WHEEL_SLOTS (64) /* timeout wheel slots */
+#endif
+#ifndef MQTT_PUBLISH_WHEEL_TICK_MS
+#define MQTT_PUBLISH_WHEEL_TICK_MS (100) /* timeout wheel resolution */
+#endif
+
 // Tuya mqtt protocol
 #define PRO_DATA_PUSH            4  /* device -> cloud push dp data */
 #define PRO_CMD                  5  /* cloud -> device send dp data */
@@ -154,22 +176,44 @@ typedef struct mqtt_subscribe_handle {
 typedef void (*mqtt_publish_notify_cb_t)(int result, void *user_data);
 
 typedef struct mqtt_publish_handle {
+    /* msgid bucket, or the send queue before a msgid is assigned */
     struct mqtt_publish_handle *next;
+    struct mqtt_publish_handle **pprev;
+    /* timeout wheel slot */
+    struct mqtt_publish_handle *tnext;
+    struct mqtt_publish_handle **tprev;
     uint16_t msgid;
-    int timeout;
+    /* in flight while it is still being sent, a PUBACK meanwhile is kept for the sender */
+    bool sending;
+    bool acked;
+    uint32_t timeout;
     char *topic;
     uint8_t *payload;
     size_t payload_length;
+    uint8_t *buffer; /* publish buffer the payload lives in */
     mqtt_publish_notify_cb_t cb;
     void *user_data;
 } mqtt_publish_handle_t;
 
+typedef struct {
+    uint8_t *buf;
+    uint32_t size;
+    bool busy;
+} mqtt_publish_buf_t;
+
 typedef struct {
     void *mqtt_client;
     tuya_mqtt_access_t signature;
     tuya_protocol_handle_t *protocol_list;
     mqtt_subscribe_handle_t *subscribe_list;
-    mqtt_publish_handle_t *publish_list;
+    MUTEX_HANDLE publish_mutex;
+    TAL_CIPHER_HANDLE cipher;
+    mqtt_publish_buf_t publish_pool[MQTT_PUBLISH_POOL_NUM];
+    mqtt_publish_handle_t *publish_queue;
+    mqtt_publish_handle_t **publish_queue_tail;
+    mqtt_publish_handle_t *publish_inflight[MQTT_PUBLISH_INFLIGHT_BUCKETS];
+    mqtt_publish_handle_t *publish_wheel[MQTT_PUBLISH_WHEEL_SLOTS];
+    uint32_t publish_wheel_tick;
     BackoffAlgorithmContext_t backoff_algorithm;
     uint32_t sequence_in;
     uint32_t sequence_out;
@@ -378,6 +422,51 @@ int tuya_mqtt_client_publish_common(tuya_mqtt_context_t *context, const char *to
                                     size_t payload_length, mqtt_publish_notify_cb_t cb, void *user_data, int timeout_ms,
                                     bool async);
 
+/**
+ * @brief Gets a publish buffer for protocol data.
+ *
+ * The protocol data is written at *data, up to data_len bytes and a
+ * terminating zero. The buffer keeps room in front of and behind the data
+ * for the protocol frame, so the frame is encrypted and sent from the same
+ * buffer. Buffers come from a small pool kept in the context.
+ *
+ * @param context The MQTT context.
+ * @param data_len The maximum length of the protocol data.
+ * @param data Receives where the protocol data goes.
+ * @return The buffer, or NULL when out of memory.
+ */
+uint8_t *tuya_mqtt_publish_buf_get(tuya_mqtt_context_t *context, size_t data_len, char **data);
+
+/**
+ * @brief Puts back a publish buffer that was not published.
+ *
+ * @param context The MQTT context.
+ * @param buf The buffer from tuya_mqtt_publish_buf_get().
+ */
+void tuya_mqtt_publish_buf_put(tuya_mqtt_context_t *context, uint8_t *buf);
+
+/**
+ * @brief Publishes the protocol data held in a publish buffer.
+ *
+ * The data is packed and encrypted in place and sent from the buffer, a
+ * QoS1 message keeps the buffer until it is acknowledged or times out. The
+ * buffer is taken over in any case, also on error.
+ *
+ * @param context The MQTT context.
+ * @param topic The topic to publish the data to.
+ * @param protocol_id The protocol ID.
+ * @param buf The buffer from tuya_mqtt_publish_buf_get().
+ * @param data_len The length of the protocol data.
+ * @param cb The callback for the PUBACK, NULL publishes with QoS0.
+ * @param user_data User data to be passed to the callback function.
+ * @param timeout_ms The timeout for the PUBACK in milliseconds.
+ * @param async Send from tuya_mqtt_loop() instead of now.
+ * @return 0 on success, or a negative error code on failure.
+ */
+int tuya_mqtt_protocol_buf_publish_common(tuya_mqtt_context_t *context, const char *topic, uint16_t protocol_id,
+                                          uint8_t *buf, size_t data_len, mqtt_publish_notify_cb_t cb, void *user_data,
+                                          int timeout_ms, bool async);
+
 /**
  * @brief Registers a callback function for handling MQTT subscribe messages.
  *
@@ -0,0 +1,907 @@
+/**
+ * @file tuya_dp_coalesce.c
+ * @brief Coalescing of DP reports into shared frames.
+ *
+ * A report is split into its DPs with a small scanner, the values are kept
+ * as JSON text in a pending table indexed by DP id. The first report of a
+ * window arms a one-shot timer, when it fires a flush is queued on the
+ * system workqueue. The flush takes the pending DPs out as one dps object
+ * under the lock and hands it to the publish callback unlocked, which
+ * wraps, packs and encrypts them once for the whole window.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tuya_cloud_types.h"
+#include "tal_api.h"
+#include "tuya_dp_coalesce.h"
+
+#if defined(ENABLE_DP_COALESCE) && (ENABLE_DP_COALESCE == 1)
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+/* "255": and the comma */
+#define DP_KEY_LEN_MAX  (7)
+#define DP_UINT_LEN_MAX (10)
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint8_t id;
+    bool emit;
+    uint16_t len;
+    uint16_t cap;
+    uint32_t time;
+    char *value;
+} dp_coalesce_entry_t;
+
+typedef struct {
+    uint8_t id;
+    bool sent;
+    uint32_t interval_ms;
+    SYS_TIME_T last_ms;
+} dp_coalesce_rate_t;
+
+typedef struct {
+    tuya_dp_coalesce_notify_cb_t cb;
+    void *user_data;
+} dp_coalesce_notify_t;
+
+/* the notify callbacks of the reports carried by a frame */
+typedef struct {
+    uint8_t num;
+    dp_coalesce_notify_t notify[0];
+} dp_coalesce_batch_t;
+
+/* a frame taken out of the pending table */
+typedef struct {
+    char *dps;
+    char *time;
+    dp_coalesce_batch_t *batch;
+    int timeout_ms;
+    uint32_t bytes_saved;
+} dp_coalesce_frame_t;
+
+/* a DP of a report, value points into the report */
+typedef struct {
+    uint8_t id;
+    uint16_t len;
+    uint32_t time;
+    const char *value;
+} dp_coalesce_span_t;
+
+struct tuya_dp_coalesce {
+    MUTEX_HANDLE mutex;
+    TIMER_ID timer;
+    tuya_dp_coalesce_publish_cb_t publish;
+    void *ctx;
+    uint32_t window_ms;
+    bool stat_history;
+    /* bytes the pending reports would have sent as frames of their own */
+    uint32_t pending_bytes;
+    uint8_t num;
+    uint8_t rate_num;
+    uint8_t notify_num;
+    int notify_timeout_ms;
+    /* a flush is queued on or running in the workqueue */
+    bool work_queued;
+    bool closing;
+    /* position + 1 of the latest pending entry of each DP id */
+    uint8_t idx[256];
+    dp_coalesce_entry_t entry[DP_COALESCE_ENTRY_MAX];
+    dp_coalesce_rate_t rate[DP_COALESCE_RATE_MAX];
+    dp_coalesce_notify_t notify[DP_COALESCE_NOTIFY_MAX];
+    /* scratch of tuya_dp_coalesce_report, kept here off the caller stack */
+    dp_coalesce_span_t span[DP_COALESCE_ENTRY_MAX];
+    dp_coalesce_span_t time_span[DP_COALESCE_ENTRY_MAX];
+    tuya_dp_coalesce_stat_t stat;
+};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static const char *__skip_ws(const char *p)
+{
+    while (' ' == *p || '\t' == *p || '\r' == *p || '\n' == *p) {
+        p++;
+    }
+    return p;
+}
+
+/* returns the end of the JSON value at p, NULL if it is malformed */
+static const char *__value_end(const char *p)
+{
+    const char *start = p;
+    bool in_str = false;
+    int depth = 0;
+
+    for (; *p; p++) {
+        if (in_str) {
+            if ('\\' == *p) {
+                if ('\0' == *++p) {
+                    return NULL;
+                }
+            } else if ('"' == *p) {
+                in_str = false;
+                if (0 == depth) {
+                    return p + 1;
+                }
+            }
+            continue;
+        }
+        switch (*p) {
+        case '"':
+            in_str = true;
+            break;
+        case '{':
+        case '[':
+            depth++;
+            break;
+        case '}':
+        case ']':
+            if (0 == depth) {
+                return (p > start) ? p : NULL;
+            }
+            if (0 == --depth) {
+                return p + 1;
+            }
+            break;
+        case ',':
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+            if (0 == depth) {
+                return (p > start) ? p : NULL;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    return (0 == depth && !in_str && p > start) ? p : NULL;
+}
+
+/* splits {"id":value,...} into spans, returns the count or -1 if it is not a flat object of DP ids */
+static int __object_split(const char *p, dp_coalesce_span_t *span, int span_max)
+{
+    const char *key, *end;
+    uint32_t id;
+    int num = 0;
+
+    p = __skip_ws(p);
+    if ('{' != *p) {
+        return -1;
+    }
+    p = __skip_ws(p + 1);
+
+    for (;;) {
+        if ('"' != *p++) {
+            return -1;
+        }
+        for (key = p, id = 0; *p >= '0' && *p <= '9' && id <= 255; p++) {
+            id = id * 10 + (*p - '0');
+        }
+        if (p == key || id > 255 || '"' != *p) {
+            return -1;
+        }
+        p = __skip_ws(p + 1);
+        if (':' != *p) {
+            return -1;
+        }
+        p = __skip_ws(p + 1);
+        end = __value_end(p);
+        if (NULL == end || num >= span_max || end - p > UINT16_MAX) {
+            return -1;
+        }
+        span[num].id = id;
+        span[num].value = p;
+        span[num].len = end - p;
+        span[num].time = 0;
+        num++;
+
+        p = __skip_ws(end);
+        if (',' == *p) {
+            p = __skip_ws(p + 1);
+            continue;
+        }
+        if ('}' != *p) {
+            return -1;
+        }
+        return ('\0' == *__skip_ws(p + 1)) ? num : -1;
+    }
+}
+
+static int __uint_parse(const char *p, size_t len, uint32_t *value)
+{
+    uint64_t v = 0;
+    size_t i;
+
+    if (0 == len || len > DP_UINT_LEN_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+    for (i = 0; i < len; i++) {
+        if (p[i] < '0' || p[i] > '9') {
+            return OPRT_INVALID_PARM;
+        }
+        v = v * 10 + (p[i] - '0');
+    }
+    if (v > UINT32_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+    *value = (uint32_t)v;
+
+    return OPRT_OK;
+}
+
+/* time is a timestamp for all the DPs or an object of timestamps keyed by DP id */
+static int __time_apply(tuya_dp_coalesce_t *co, const char *time, int num)
+{
+    const char *p, *end;
+    uint32_t ts;
+    int time_num, i, j;
+
+    if (NULL == time) {
+        return OPRT_OK;
+    }
+
+    p = __skip_ws(time);
+    if ('{' != *p) {
+        end = __value_end(p);
+        if (NULL == end || '\0' != *__skip_ws(end) || OPRT_OK != __uint_parse(p, end - p, &ts)) {
+            return OPRT_INVALID_PARM;
+        }
+        for (i = 0; i < num; i++) {
+            co->span[i].time = ts;
+        }
+        return OPRT_OK;
+    }
+
+    time_num = __object_split(p, co->time_span, DP_COALESCE_ENTRY_MAX);
+    if (time_num < 0) {
+        return OPRT_INVALID_PARM;
+    }
+    for (i = 0; i < time_num; i++) {
+        if (OPRT_OK != __uint_parse(co->time_span[i].value, co->time_span[i].len, &ts)) {
+            return OPRT_INVALID_PARM;
+        }
+        for (j = 0; j < num; j++) {
+            if (co->span[j].id == co->time_span[i].id) {
+                co->span[j].time = ts;
+            }
+        }
+    }
+
+    return OPRT_OK;
+}
+
+static size_t __uint_put(char *p, uint32_t value)
+{
+    char tmp[DP_UINT_LEN_MAX];
+    size_t i = sizeof(tmp);
+
+    do {
+        tmp[--i] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    memcpy(p, tmp + i, sizeof(tmp) - i);
+
+    return sizeof(tmp) - i;
+}
+
+static size_t __key_put(char *p, uint8_t id)
+{
+    size_t len = 0;
+
+    p[len++] = '"';
+    len += __uint_put(p + len, id);
+    p[len++] = '"';
+    p[len++] = ':';
+
+    return len;
+}
+
+static dp_coalesce_rate_t *__rate_find(tuya_dp_coalesce_t *co, uint8_t id)
+{
+    int i;
+
+    for (i = 0; i < co->rate_num; i++) {
+        if (co->rate[i].id == id) {
+            return &co->rate[i];
+        }
+    }
+    return NULL;
+}
+
+static int __entry_put(tuya_dp_coalesce_t *co, const dp_coalesce_span_t *span)
+{
+    dp_coalesce_entry_t *entry = NULL;
+    uint8_t pos = co->idx[span->id];
+    bool is_new = true;
+    char *value = NULL;
+
+    // a timestamped value is kept besides the pending one when the STAT history is retained
+    if (pos && !(co->stat_history && span->time && co->entry[pos - 1].time)) {
+        entry = &co->entry[pos - 1];
+        is_new = false;
+    } else {
+        entry = &co->entry[co->num];
+    }
+
+    if (entry->cap < span->len) {
+        value = tal_malloc(span->len);
+        if (NULL == value) {
+            return OPRT_MALLOC_FAILED;
+        }
+        tal_free(entry->value);
+        entry->value = value;
+        entry->cap = span->len;
+    }
+    memcpy(entry->value, span->value, span->len);
+    entry->len = span->len;
+    entry->time = span->time;
+    entry->id = span->id;
+    entry->emit = false;
+
+    if (is_new) {
+        co->idx[span->id] = ++co->num;
+    } else {
+        co->stat.suppressed++;
+    }
+
+    return OPRT_OK;
+}
+
+/* drops the sent entries, their buffers move behind the pending ones for reuse */
+static void __entry_compact(tuya_dp_coalesce_t *co)
+{
+    dp_coalesce_entry_t tmp;
+    int i, num = 0;
+
+    memset(co->idx, 0, sizeof(co->idx));
+    for (i = 0; i < co->num; i++) {
+        if (co->entry[i].emit) {
+            continue;
+        }
+        if (i != num) {
+            tmp = co->entry[num];
+            co->entry[num] = co->entry[i];
+            co->entry[i] = tmp;
+        }
+        co->idx[co->entry[num].id] = num + 1;
+        num++;
+    }
+    co->num = num;
+}
+
+static void __batch_notify(int result, void *user_data)
+{
+    dp_coalesce_batch_t *batch = (dp_coalesce_batch_t *)user_data;
+    int i;
+
+    for (i = 0; i < batch->num; i++) {
+        batch->notify[i].cb(result, batch->notify[i].user_data);
+    }
+    tal_free(batch);
+}
+
+/* arms the timer for the DPs left pending, called with the mutex held */
+static void __timer_rearm_locked(tuya_dp_coalesce_t *co, uint32_t next_ms)
+{
+    uint32_t window_ms = co->window_ms ? co->window_ms : DP_COALESCE_WINDOW_MS;
+
+    if (co->num && !co->closing) {
+        tal_sw_timer_start(co->timer, (UINT32_MAX == next_ms) ? window_ms : (next_ms ? next_ms : 1), TAL_TIMER_ONCE);
+    }
+}
+
+/* takes the pending DPs whose rate limit allows it out as a frame, called with the mutex held */
+static int __frame_take_locked(tuya_dp_coalesce_t *co, dp_coalesce_frame_t *frame)
+{
+    SYS_TIME_T now = tal_system_get_millisecond();
+    uint32_t window_ms = co->window_ms ? co->window_ms : DP_COALESCE_WINDOW_MS;
+    uint32_t next_ms = UINT32_MAX;
+    bool is_history_left = false;
+    uint8_t seen[256 / 8];
+    size_t dps_len = 2, time_len = 2, dps_off = 0, time_off = 0;
+    char *dps = NULL, *time = NULL;
+    dp_coalesce_batch_t *batch = NULL;
+    dp_coalesce_rate_t *rate = NULL;
+    dp_coalesce_entry_t *entry = NULL;
+    int i, emit_num = 0, time_num = 0, rt = OPRT_OK;
+
+    memset(frame, 0, sizeof(dp_coalesce_frame_t));
+    memset(seen, 0, sizeof(seen));
+    for (i = 0; i < co->num; i++) {
+        entry = &co->entry[i];
+        entry->emit = false;
+        // one value of a DP per frame, the older STAT history goes first
+        if (seen[entry->id >> 3] & (1 << (entry->id & 7))) {
+            is_history_left = true;
+            continue;
+        }
+        seen[entry->id >> 3] |= 1 << (entry->id & 7);
+
+        rate = __rate_find(co, entry->id);
+        if (rate && rate->sent && now - rate->last_ms < rate->interval_ms) {
+            if (rate->interval_ms - (uint32_t)(now - rate->last_ms) < next_ms) {
+                next_ms = rate->interval_ms - (uint32_t)(now - rate->last_ms);
+            }
+            continue;
+        }
+        entry->emit = true;
+        emit_num++;
+        dps_len += DP_KEY_LEN_MAX + entry->len;
+        if (entry->time) {
+            time_num++;
+            time_len += DP_KEY_LEN_MAX + DP_UINT_LEN_MAX;
+        }
+    }
+    if (0 == emit_num) {
+        goto __exit;
+    }
+
+    dps = tal_malloc(dps_len);
+    time = time_num ? tal_malloc(time_len) : NULL;
+    if (co->notify_num) {
+        batch = tal_malloc(sizeof(dp_coalesce_batch_t) + co->notify_num * sizeof(dp_coalesce_notify_t));
+    }
+    if (NULL == dps || (time_num && NULL == time) || (co->notify_num && NULL == batch)) {
+        tal_free(dps);
+        tal_free(time);
+        tal_free(batch);
+        rt = OPRT_MALLOC_FAILED;
+        goto __exit;
+    }
+    dps[dps_off++] = '{';
+    if (time) {
+        time[time_off++] = '{';
+    }
+    for (i = 0; i < co->num; i++) {
+        entry = &co->entry[i];
+        if (!entry->emit) {
+            continue;
+        }
+        dps_off += __key_put(dps + dps_off, entry->id);
+        memcpy(dps + dps_off, entry->value, entry->len);
+        dps_off += entry->len;
+        dps[dps_off++] = ',';
+        if (time && entry->time) {
+            time_off += __key_put(time + time_off, entry->id);
+            time_off += __uint_put(time + time_off, entry->time);
+            time[time_off++] = ',';
+        }
+        if (NULL != (rate = __rate_find(co, entry->id))) {
+            rate->sent = true;
+            rate->last_ms = now;
+        }
+    }
+    dps[dps_off - 1] = '}';
+    dps[dps_off] = '\0';
+    if (time) {
+        time[time_off - 1] = '}';
+        time[time_off] = '\0';
+    }
+
+    if (batch) {
+        batch->num = co->notify_num;
+        memcpy(batch->notify, co->notify, co->notify_num * sizeof(dp_coalesce_notify_t));
+    }
+    frame->dps = dps;
+    frame->time = time;
+    frame->batch = batch;
+    frame->timeout_ms = co->notify_timeout_ms;
+    if (co->pending_bytes > dps_off + time_off + DP_COALESCE_FRAME_OVERHEAD) {
+        frame->bytes_saved = co->pending_bytes - (dps_off + time_off + DP_COALESCE_FRAME_OVERHEAD);
+    }
+    PR_DEBUG("dp coalesce frame %d dps: %s", emit_num, dps);
+
+    co->notify_num = 0;
+    co->notify_timeout_ms = 0;
+    co->pending_bytes = 0;
+    __entry_compact(co);
+
+__exit:
+    // rate limited DPs wait for their interval, the rest for the next window
+    if ((is_history_left || OPRT_OK != rt) && window_ms < next_ms) {
+        next_ms = window_ms;
+    }
+    __timer_rearm_locked(co, next_ms);
+
+    return rt;
+}
+
+/* puts the DPs of a frame that was not sent back, unless a newer value is pending, called with the mutex held */
+static void __frame_requeue_locked(tuya_dp_coalesce_t *co, dp_coalesce_frame_t *frame)
+{
+    int num, i;
+
+    num = __object_split(frame->dps, co->span, DP_COALESCE_ENTRY_MAX);
+    if (num > 0 && OPRT_OK == __time_apply(co, frame->time, num)) {
+        for (i = 0; i < num && co->num < DP_COALESCE_ENTRY_MAX; i++) {
+            if (0 == co->idx[co->span[i].id] || (co->stat_history && co->span[i].time)) {
+                __entry_put(co, &co->span[i]);
+            }
+        }
+    }
+
+    // the reports wait for the frame that carries them
+    if (frame->batch && co->notify_num + frame->batch->num <= DP_COALESCE_NOTIFY_MAX) {
+        memcpy(&co->notify[co->notify_num], frame->batch->notify, frame->batch->num * sizeof(dp_coalesce_notify_t));
+        co->notify_num += frame->batch->num;
+        if (frame->timeout_ms > co->notify_timeout_ms) {
+            co->notify_timeout_ms = frame->timeout_ms;
+        }
+        tal_free(frame->batch);
+        frame->batch = NULL;
+    }
+    __timer_rearm_locked(co, UINT32_MAX);
+}
+
+/* sends the pending DPs whose rate limit allows it, called unlocked */
+static int __flush(tuya_dp_coalesce_t *co)
+{
+    dp_coalesce_frame_t frame;
+    int rt = OPRT_OK;
+
+    memset(&frame, 0, sizeof(frame));
+    tal_mutex_lock(co->mutex);
+    if (co->num) {
+        rt = __frame_take_locked(co, &frame);
+    }
+    tal_mutex_unlock(co->mutex);
+    if (OPRT_OK != rt || NULL == frame.dps) {
+        return rt;
+    }
+
+    // socket I/O, the reporters are not held up meanwhile
+    rt = co->publish(co->ctx, frame.dps, frame.time, frame.batch ? __batch_notify : NULL, frame.batch,
+                     frame.timeout_ms);
+
+    tal_mutex_lock(co->mutex);
+    if (OPRT_OK == rt) {
+        co->stat.frames++;
+        co->stat.bytes_saved += frame.bytes_saved;
+        frame.batch = NULL;
+    } else {
+        // the DPs stay pending and go with the next window
+        PR_ERR("dp coalesce publish err %d", rt);
+        __frame_requeue_locked(co, &frame);
+    }
+    tal_mutex_unlock(co->mutex);
+
+    // no room left to wait for the next frame
+    if (frame.batch) {
+        __batch_notify(rt, frame.batch);
+    }
+    tal_free(frame.dps);
+    tal_free(frame.time);
+
+    return rt;
+}
+
+static void __coalesce_flush_work(void *data)
+{
+    tuya_dp_coalesce_t *co = (tuya_dp_coalesce_t *)data;
+    bool closing;
+
+    tal_mutex_lock(co->mutex);
+    closing = co->closing;
+    tal_mutex_unlock(co->mutex);
+    if (!closing) {
+        __flush(co);
+    }
+
+    // the last access, tuya_dp_coalesce_destroy waits for it
+    tal_mutex_lock(co->mutex);
+    co->work_queued = false;
+    // a timer fired while the flush was queued was skipped
+    if (!tal_sw_timer_is_running(co->timer)) {
+        __timer_rearm_locked(co, UINT32_MAX);
+    }
+    tal_mutex_unlock(co->mutex);
+}
+
+static void __coalesce_timer_cb(TIMER_ID timer_id, void *arg)
+{
+    tuya_dp_coalesce_t *co = (tuya_dp_coalesce_t *)arg;
+
+    // the publish blocks on the socket, it runs on the workqueue and not on the timer thread
+    tal_mutex_lock(co->mutex);
+    if (co->num && !co->closing && !co->work_queued) {
+        if (OPRT_OK == tal_workq_schedule(WORKQ_SYSTEM, __coalesce_flush_work, co)) {
+            co->work_queued = true;
+        } else {
+            __timer_rearm_locked(co, UINT32_MAX);
+        }
+    }
+    tal_mutex_unlock(co->mutex);
+}
+
+static void __timer_sync_cb(TIMER_ID timer_id, void *arg)
+{
+    tal_semaphore_post((SEM_HANDLE)arg);
+}
+
+/* returns once a timer callback already dispatched has returned, the timer callbacks run one by one */
+static void __timer_thread_sync(void)
+{
+    SEM_HANDLE sem = NULL;
+    TIMER_ID timer = NULL;
+
+    if (OPRT_OK != tal_semaphore_create_init(&sem, 0, 1)) {
+        return;
+    }
+    if (OPRT_OK == tal_sw_timer_create(__timer_sync_cb, sem, &timer)) {
+        tal_sw_timer_start(timer, 1, TAL_TIMER_ONCE);
+        tal_semaphore_wait(sem, SEM_WAIT_FOREVER);
+        tal_sw_timer_delete(timer);
+    }
+    tal_semaphore_release(sem);
+}
+
+/**
+ * @brief Creates a DP report coalescer.
+ *
+ * @param window_ms The merge window, 0 sends every report as is.
+ * @param publish Sends a merged frame.
+ * @param ctx Passed to publish.
+ * @param out Receives the coalescer.
+ * @return OPRT_OK on success, or an error code.
+ */
+int tuya_dp_coalesce_create(uint32_t window_ms, tuya_dp_coalesce_publish_cb_t publish, void *ctx,
+                            tuya_dp_coalesce_t **out)
+{
+    OPERATE_RET rt = OPRT_OK;
+    tuya_dp_coalesce_t *co = NULL;
+
+    if (NULL == publish || NULL == out) {
+        return OPRT_INVALID_PARM;
+    }
+
+    co = tal_malloc(sizeof(tuya_dp_coalesce_t));
+    TUYA_CHECK_NULL_RETURN(co, OPRT_MALLOC_FAILED);
+    memset(co, 0, sizeof(tuya_dp_coalesce_t));
+    co->window_ms = window_ms;
+    co->publish = publish;
+    co->ctx = ctx;
+
+    TUYA_CALL_ERR_GOTO(tal_mutex_create_init(&co->mutex), __err);
+    TUYA_CALL_ERR_GOTO(tal_sw_timer_create(__coalesce_timer_cb, co, &co->timer), __err);
+    *out = co;
+
+    return OPRT_OK;
+
+__err:
+    if (co->mutex) {
+        tal_mutex_release(co->mutex);
+    }
+    tal_free(co);
+    return rt;
+}
+
+/**
+ * @brief Destroys a coalescer, pending DPs are dropped and pending notify
+ * callbacks are called with OPRT_COM_ERROR.
+ *
+ * It waits for a flush in progress, do not call it from a timer callback.
+ *
+ * @param co The coalescer.
+ */
+void tuya_dp_coalesce_destroy(tuya_dp_coalesce_t *co)
+{
+    bool busy;
+    int i;
+
+    if (NULL == co) {
+        return;
+    }
+
+    tal_mutex_lock(co->mutex);
+    co->closing = true;
+    tal_mutex_unlock(co->mutex);
+
+    // a timer callback may already be on its way, and it may have queued a flush
+    tal_sw_timer_stop(co->timer);
+    tal_sw_timer_delete(co->timer);
+    __timer_thread_sync();
+    for (;;) {
+        tal_mutex_lock(co->mutex);
+        busy = co->work_queued;
+        tal_mutex_unlock(co->mutex);
+        if (!busy) {
+            break;
+        }
+        tal_system_sleep(10);
+    }
+
+    // no report can come in any more, the callbacks run unlocked as they may report again
+    for (i = 0; i < co->notify_num; i++) {
+        co->notify[i].cb(OPRT_COM_ERROR, co->notify[i].user_data);
+    }
+    for (i = 0; i < DP_COALESCE_ENTRY_MAX; i++) {
+        tal_free(co->entry[i].value);
+    }
+    tal_mutex_release(co->mutex);
+    tal_free(co);
+}
+
+/**
+ * @brief Takes a DP report into the pending frame.
+ *
+ * time is NULL, a timestamp for all the DPs, or an object of timestamps
+ * keyed by DP id. cb is called with the result of the frame that carries
+ * the report.
+ *
+ * @return OPRT_OK if the report is pending, OPRT_NOT_SUPPORTED if it has to
+ * be sent as is: the coalescing is disabled, or dps is not a flat object of
+ * DP ids.
+ */
+int tuya_dp_coalesce_report(tuya_dp_coalesce_t *co, const char *dps, const char *time,
+                            tuya_dp_coalesce_notify_cb_t cb, void *user_data, int timeout_ms)
+{
+    int num, i, rt = OPRT_OK;
+
+    if (NULL == co || NULL == dps) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(co->mutex);
+    if (0 == co->window_ms) {
+        rt = OPRT_NOT_SUPPORTED;
+        goto __exit;
+    }
+
+    num = __object_split(dps, co->span, DP_COALESCE_ENTRY_MAX);
+    if (num <= 0 || OPRT_OK != __time_apply(co, time, num)) {
+        PR_DEBUG("dps not coalesced: %s", dps);
+        rt = OPRT_NOT_SUPPORTED;
+        goto __exit;
+    }
+
+    // room for the worst case, every DP of the report a new entry
+    if (co->num + num > DP_COALESCE_ENTRY_MAX || (cb && co->notify_num >= DP_COALESCE_NOTIFY_MAX)) {
+        tal_mutex_unlock(co->mutex);
+        __flush(co);
+        tal_mutex_lock(co->mutex);
+        // the scratch spans may have been used meanwhile
+        num = __object_split(dps, co->span, DP_COALESCE_ENTRY_MAX);
+        if (num <= 0 || OPRT_OK != __time_apply(co, time, num) || co->num + num > DP_COALESCE_ENTRY_MAX ||
+            (cb && co->notify_num >= DP_COALESCE_NOTIFY_MAX)) {
+            rt = OPRT_NOT_SUPPORTED;
+            goto __exit;
+        }
+    }
+
+    if (co->num) {
+        co->stat.merged++;
+    }
+    co->stat.reports++;
+    for (i = 0; i < num; i++) {
+        rt = __entry_put(co, &co->span[i]);
+        if (OPRT_OK != rt) {
+            PR_ERR("dp coalesce put %d err %d", co->span[i].id, rt);
+            break;
+        }
+    }
+    if (OPRT_OK == rt && cb) {
+        co->notify[co->notify_num].cb = cb;
+        co->notify[co->notify_num].user_data = user_data;
+        co->notify_num++;
+        if (timeout_ms > co->notify_timeout_ms) {
+            co->notify_timeout_ms = timeout_ms;
+        }
+    }
+    co->pending_bytes += strlen(dps) + (time ? strlen(time) : 0) + DP_COALESCE_FRAME_OVERHEAD;
+
+    if (co->num && !tal_sw_timer_is_running(co->timer)) {
+        tal_sw_timer_start(co->timer, co->window_ms, TAL_TIMER_ONCE);
+    }
+
+__exit:
+    tal_mutex_unlock(co->mutex);
+    return rt;
+}
+
+/**
+ * @brief Sends the pending DPs now, rate limited DPs stay pending.
+ *
+ * @param co The coalescer.
+ * @return OPRT_OK on success, or the error of the publish.
+ */
+int tuya_dp_coalesce_flush(tuya_dp_coalesce_t *co)
+{
+    if (NULL == co) {
+        return OPRT_INVALID_PARM;
+    }
+
+    return __flush(co);
+}
+
+/**
+ * @brief Changes the merge window and the STAT history retention.
+ *
+ * @param co The coalescer.
+ * @param window_ms The merge window, 0 flushes and disables the coalescing.
+ * @param stat_history Keep every timestamped value.
+ * @return OPRT_OK on success, or an error code.
+ */
+int tuya_dp_coalesce_config(tuya_dp_coalesce_t *co, uint32_t window_ms, bool stat_history)
+{
+    if (NULL == co) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(co->mutex);
+    co->window_ms = window_ms;
+    co->stat_history = stat_history;
+    tal_mutex_unlock(co->mutex);
+
+    if (0 == window_ms) {
+        __flush(co);
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Sets the minimum interval between two reports of a DP.
+ *
+ * @param co The coalescer.
+ * @param dpid The DP id.
+ * @param interval_ms The interval, 0 removes the limit.
+ * @return OPRT_OK on success, OPRT_EXCEED_UPPER_LIMIT if DP_COALESCE_RATE_MAX
+ * DPs are limited already.
+ */
+int tuya_dp_coalesce_rate_limit_set(tuya_dp_coalesce_t *co, uint8_t dpid, uint32_t interval_ms)
+{
+    dp_coalesce_rate_t *rate = NULL;
+    int rt = OPRT_OK;
+
+    if (NULL == co) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(co->mutex);
+    rate = __rate_find(co, dpid);
+    if (0 == interval_ms) {
+        if (rate) {
+            *rate = co->rate[--co->rate_num];
+        }
+    } else if (rate) {
+        rate->interval_ms = interval_ms;
+    } else if (co->rate_num < DP_COALESCE_RATE_MAX) {
+        rate = &co->rate[co->rate_num++];
+        memset(rate, 0, sizeof(dp_coalesce_rate_t));
+        rate->id = dpid;
+        rate->interval_ms = interval_ms;
+    } else {
+        rt = OPRT_EXCEED_UPPER_LIMIT;
+    }
+    tal_mutex_unlock(co->mutex);
+
+    return rt;
+}
+
+/**
+ * @brief Gets the counters of a coalescer.
+ *
+ * @param co The coalescer.
+ * @param stat Receives the counters.
+ */
+void tuya_dp_coalesce_stat_get(tuya_dp_coalesce_t *co, tuya_dp_coalesce_stat_t *stat)
+{
+    if (NULL == co || NULL == stat) {
+        return;
+    }
+
+    tal_mutex_lock(co->mutex);
+    *stat = co->stat;
+    tal_mutex_unlock(co->mutex);
+}
+
+#endif
@@ -0,0 +1,161 @@
+/**
+ * @file tuya_dp_coalesce.h
+ * @brief Coalescing of DP reports into shared frames.
+ *
+ * DP reports taken within a window are merged per device, a DP reported
+ * again before the window closes keeps only its last value, and the pending
+ * DPs are sent as one encrypted frame when the window closes. A DP can be
+ * given a minimum report interval, its updates wait pending until the
+ * interval has passed.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __TUYA_DP_COALESCE_H__
+#define __TUYA_DP_COALESCE_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The default merge window, 0 disables the coalescing.
+ */
+#ifndef DP_COALESCE_WINDOW_MS
+#define DP_COALESCE_WINDOW_MS (200)
+#endif
+
+/**
+ * @brief Maximum pending DP values, a full table is flushed at once.
+ */
+#ifndef DP_COALESCE_ENTRY_MAX
+#define DP_COALESCE_ENTRY_MAX (64)
+#endif
+
+/**
+ * @brief Maximum DPs with a rate limit.
+ */
+#ifndef DP_COALESCE_RATE_MAX
+#define DP_COALESCE_RATE_MAX (16)
+#endif
+
+/**
+ * @brief Maximum reports with a notify callback waiting in one frame.
+ */
+#ifndef DP_COALESCE_NOTIFY_MAX
+#define DP_COALESCE_NOTIFY_MAX (8)
+#endif
+
+/**
+ * @brief Bytes a frame adds to its DPs: the devId wrapper, the protocol
+ * header and the cipher tag, used for the bytes_saved counter.
+ */
+#ifndef DP_COALESCE_FRAME_OVERHEAD
+#define DP_COALESCE_FRAME_OVERHEAD (80)
+#endif
+
+typedef struct tuya_dp_coalesce tuya_dp_coalesce_t;
+
+typedef void (*tuya_dp_coalesce_notify_cb_t)(int result, void *user_data);
+
+/**
+ * @brief Sends a merged frame, dps and time are JSON objects keyed by DP id.
+ */
+typedef int (*tuya_dp_coalesce_publish_cb_t)(void *ctx, const char *dps, const char *time,
+                                             tuya_dp_coalesce_notify_cb_t cb, void *user_data, int timeout_ms);
+
+typedef struct {
+    /** reports taken */
+    uint32_t reports;
+    /** reports that joined a frame already pending */
+    uint32_t merged;
+    /** DP values replaced by a newer value before they were sent */
+    uint32_t suppressed;
+    /** frames sent */
+    uint32_t frames;
+    /** estimated bytes not sent compared with one frame per report */
+    uint32_t bytes_saved;
+} tuya_dp_coalesce_stat_t;
+
+/**
+ * @brief Creates a DP report coalescer.
+ *
+ * @param window_ms The merge window, 0 sends every report as is.
+ * @param publish Sends a merged frame.
+ * @param ctx Passed to publish.
+ * @param out Receives the coalescer.
+ * @return OPRT_OK on success, or an error code.
+ */
+int tuya_dp_coalesce_create(uint32_t window_ms, tuya_dp_coalesce_publish_cb_t publish, void *ctx,
+                            tuya_dp_coalesce_t **out);
+
+/**
+ * @brief Destroys a coalescer, pending DPs are dropped and pending notify
+ * callbacks are called with OPRT_COM_ERROR.
+ *
+ * @param co The coalescer.
+ */
+void tuya_dp_coalesce_destroy(tuya_dp_coalesce_t *co);
+
+/**
+ * @brief Takes a DP report into the pending frame.
+ *
+ * time is NULL, a timestamp for all the DPs, or an object of timestamps
+ * keyed by DP id. cb is called with the result of the frame that carries
+ * the report.
+ *
+ * @return OPRT_OK if the report is pending, OPRT_NOT_SUPPORTED if it has to
+ * be sent as is: the coalescing is disabled, or dps is not a flat object of
+ * DP ids.
+ */
+int tuya_dp_coalesce_report(tuya_dp_coalesce_t *co, const char *dps, const char *time,
+                            tuya_dp_coalesce_notify_cb_t cb, void *user_data, int timeout_ms);
+
+/**
+ * @brief Sends the pending DPs now, rate limited DPs stay pending.
+ *
+ * @param co The coalescer.
+ * @return OPRT_OK on success, or the error of the publish.
+ */
+int tuya_dp_coalesce_flush(tuya_dp_coalesce_t *co);
+
+/**
+ * @brief Changes the merge window and the STAT history retention.
+ *
+ * With stat_history a timestamped value does not replace the pending value
+ * of its DP, every value is sent in order, one per frame.
+ *
+ * @param co The coalescer.
+ * @param window_ms The merge window, 0 flushes and disables the coalescing.
+ * @param stat_history Keep every timestamped value.
+ * @return OPRT_OK on success, or an error code.
+ */
+int tuya_dp_coalesce_config(tuya_dp_coalesce_t *co, uint32_t window_ms, bool stat_history);
+
+/**
+ * @brief Sets the minimum interval between two reports of a DP.
+ *
+ * @param co The coalescer.
+ * @param dpid The DP id.
+ * @param interval_ms The interval, 0 removes the limit.
+ * @return OPRT_OK on success, OPRT_EXCEED_UPPER_LIMIT if DP_COALESCE_RATE_MAX
+ * DPs are limited already.
+ */
+int tuya_dp_coalesce_rate_limit_set(tuya_dp_coalesce_t *co, uint8_t dpid, uint32_t interval_ms);
+
+/**
+ * @brief Gets the counters of a coalescer.
+ *
+ * @param co The coalescer.
+ * @param stat Receives the counters.
+ */
+void tuya_dp_coalesce_stat_get(tuya_dp_coalesce_t *co, tuya_dp_coalesce_stat_t *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TUYA_DP_COALESCE_H__ */
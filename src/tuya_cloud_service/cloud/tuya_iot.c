@@ -54,6 +54,11 @@ typedef enum {
 
 static tuya_iot_client_t *s_iot_client_solo;
 
+#if defined(ENABLE_DP_COALESCE) && (ENABLE_DP_COALESCE == 1)
+static int tuya_iot_dp_coalesce_publish(void *ctx, const char *dps, const char *time, tuya_dp_coalesce_notify_cb_t cb,
+                                        void *user_data, int timeout_ms);
+#endif
+
 /* -------------------------------------------------------------------------- */
 /*                          Internal utils functions                          */
 /* -------------------------------------------------------------------------- */
@@ -610,6 +615,15 @@ int tuya_iot_init(tuya_iot_client_t *client, const tuya_iot_config_t *config)
     if (OPRT_OK != ret) {
         return ret;
     }
+
+#if defined(ENABLE_DP_COALESCE) && (ENABLE_DP_COALESCE == 1)
+    /* DP report coalescing, a failure leaves the reports unmerged */
+    if (OPRT_OK !=
+        tuya_dp_coalesce_create(DP_COALESCE_WINDOW_MS, tuya_iot_dp_coalesce_publish, client, &client->coalesce)) {
+        PR_ERR("dp coalesce create failed");
+        client->coalesce = NULL;
+    }
+#endif
     s_iot_client_solo = client;
 
     client->state = STATE_IDLE;
@@ -722,6 +736,10 @@ int tuya_iot_reset(tuya_iot_client_t *client)
  */
 int tuya_iot_destroy(tuya_iot_client_t *client)
 {
+#if defined(ENABLE_DP_COALESCE) && (ENABLE_DP_COALESCE == 1)
+    tuya_dp_coalesce_destroy(client->coalesce);
+    client->coalesce = NULL;
+#endif
     return OPRT_OK;
 }
 
@@ -1057,47 +1075,124 @@ int tuya_iot_activated_data_remove(tuya_iot_client_t *client)
     return OPRT_OK;
 }
 
-static int tuya_iot_dp_report_json_common(tuya_iot_client_t *client, const char *dps, const char *time,
-                                          tuya_dp_notify_cb_t cb, void *user_data, int timeout_ms, bool async)
+static int tuya_iot_dp_report_json_publish(tuya_iot_client_t *client, const char *dps, const char *time,
+                                           tuya_dp_notify_cb_t cb, void *user_data, int timeout_ms, bool async)
 {
-    if (client == NULL || dps == NULL) {
-        PR_ERR("param error");
-        return OPRT_INVALID_PARM;
-    }
-
-    int ret;
     int printlen = 0;
     char *buffer = NULL;
+    size_t buf_len = strlen(dps) + (time ? strlen(time) : 0) + 64;
 
-    /* Package JSON format */
+    /* Package JSON format, in the buffer the frame is encrypted and sent from */
+    uint8_t *pubbuf = tuya_mqtt_publish_buf_get(&client->mqctx, buf_len, &buffer);
+    TUYA_CHECK_NULL_RETURN(pubbuf, OPRT_MALLOC_FAILED);
     if (time) {
-        size_t buf_len = strlen(dps) + strlen(time) + 64;
-        buffer = tal_malloc(buf_len);
-        TUYA_CHECK_NULL_RETURN(buffer, OPRT_MALLOC_FAILED);
         printlen = snprintf(buffer, buf_len, "{\"devId\":\"%s\",\"dps\":%s,\"t\":%s}",
                              client->activate.devid, dps, time);
-        if (printlen < 0 || (size_t)printlen >= buf_len) {
-            tal_free(buffer);
-            return OPRT_BUFFER_NOT_ENOUGH;
-        }
     } else {
-        size_t buf_len = strlen(dps) + 64;
-        buffer = tal_malloc(buf_len);
-        TUYA_CHECK_NULL_RETURN(buffer, OPRT_MALLOC_FAILED);
         printlen = snprintf(buffer, buf_len, "{\"devId\":\"%s\",\"dps\":%s}", client->activate.devid, dps);
-        if (printlen < 0 || (size_t)printlen >= buf_len) {
-            tal_free(buffer);
-            return OPRT_BUFFER_NOT_ENOUGH;
-        }
+    }
+    if (printlen < 0 || (size_t)printlen >= buf_len) {
+        tuya_mqtt_publish_buf_put(&client->mqctx, pubbuf);
+        return OPRT_BUFFER_NOT_ENOUGH;
     }
 
     /* Report buffer */
-    ret = tuya_mqtt_protocol_data_publish_common(&client->mqctx, PRO_DATA_PUSH, (const uint8_t *)buffer,
-                                                 (uint16_t)printlen, (mqtt_publish_notify_cb_t)cb, user_data,
-                                                 timeout_ms, async);
-    tal_free(buffer);
-    return ret;
+    return tuya_mqtt_protocol_buf_publish_common(&client->mqctx, client->mqctx.signature.topic_out, PRO_DATA_PUSH,
+                                                 pubbuf, printlen, (mqtt_publish_notify_cb_t)cb, user_data, timeout_ms,
+                                                 async);
+}
+
+#if defined(ENABLE_DP_COALESCE) && (ENABLE_DP_COALESCE == 1)
+static int tuya_iot_dp_coalesce_publish(void *ctx, const char *dps, const char *time, tuya_dp_coalesce_notify_cb_t cb,
+                                        void *user_data, int timeout_ms)
+{
+    return tuya_iot_dp_report_json_publish((tuya_iot_client_t *)ctx, dps, time, cb, user_data, timeout_ms, false);
+}
+#endif
+
+static int tuya_iot_dp_report_json_common(tuya_iot_client_t *client, const char *dps, const char *time,
+                                          tuya_dp_notify_cb_t cb, void *user_data, int timeout_ms, bool async)
+{
+    if (client == NULL || dps == NULL) {
+        PR_ERR("param error");
+        return OPRT_INVALID_PARM;
+    }
+
+    /* Merge into the pending frame, or send as is */
+    if (client->coalesce &&
+        OPRT_OK == tuya_dp_coalesce_report(client->coalesce, dps, time, cb, user_data, timeout_ms)) {
+        return OPRT_OK;
+    }
+
+    return tuya_iot_dp_report_json_publish(client, dps, time, cb, user_data, timeout_ms, async);
+}
+
+/**
+ * @brief Configures the coalescing of DP reports.
+ *
+ * @param client The Tuya IoT client instance.
+ * @param window_ms The merge window, 0 sends every report as is.
+ * @param stat_history Keep every timestamped value instead of the last one.
+ *
+ * @return OPRT_OK on success, OPRT_NOT_SUPPORTED without ENABLE_DP_COALESCE.
+ */
+int tuya_iot_dp_coalesce_config(tuya_iot_client_t *client, uint32_t window_ms, bool stat_history)
+{
+    if (client == NULL || client->coalesce == NULL) {
+        return OPRT_NOT_SUPPORTED;
+    }
+    return tuya_dp_coalesce_config(client->coalesce, window_ms, stat_history);
+}
+
+/**
+ * @brief Sets the minimum interval between two reports of a DP.
+ *
+ * @param client The Tuya IoT client instance.
+ * @param dpid The DP id.
+ * @param interval_ms The minimum interval, 0 removes the limit.
+ *
+ * @return OPRT_OK on success, OPRT_NOT_SUPPORTED without ENABLE_DP_COALESCE.
+ */
+int tuya_iot_dp_rate_limit_set(tuya_iot_client_t *client, uint8_t dpid, uint32_t interval_ms)
+{
+    if (client == NULL || client->coalesce == NULL) {
+        return OPRT_NOT_SUPPORTED;
+    }
+    return tuya_dp_coalesce_rate_limit_set(client->coalesce, dpid, interval_ms);
+}
+
+/**
+ * @brief Sends the pending coalesced DP reports now.
+ *
+ * @param client The Tuya IoT client instance.
+ *
+ * @return OPRT_OK on success, or an error code.
+ */
+int tuya_iot_dp_coalesce_flush(tuya_iot_client_t *client)
+{
+    if (client == NULL || client->coalesce == NULL) {
+        return OPRT_OK;
+    }
+    return tuya_dp_coalesce_flush(client->coalesce);
+}
+
+/**
+ * @brief Gets the counters of the DP report coalescing.
+ *
+ * @param client The Tuya IoT client instance.
+ * @param stat Receives the counters.
+ *
+ * @return OPRT_OK on success, OPRT_NOT_SUPPORTED without ENABLE_DP_COALESCE.
+ */
+int tuya_iot_dp_coalesce_stat_get(tuya_iot_client_t *client, tuya_dp_coalesce_stat_t *stat)
+{
+    if (client == NULL || client->coalesce == NULL || stat == NULL) {
+        return OPRT_NOT_SUPPORTED;
+    }
+    tuya_dp_coalesce_stat_get(client->coalesce, stat);
+    return OPRT_OK;
 }
+
 /**
  * @brief Reports device status asynchronously in JSON format.
  *
@@ -31,6 +31,7 @@ extern "C" {
 #include "tuya_protocol.h"
 #include "dp_schema.h"
 #include "tuya_ota.h"
+#include "tuya_dp_coalesce.h"
 #include "tal_api.h"
 
 /**
@@ -232,6 +233,8 @@ struct tuya_iot_client_handle {
     bool is_activated;
     /** device manage */
     dp_schema_t *schema;
+    /** pending dp reports, NULL if ENABLE_DP_COALESCE is off */
+    tuya_dp_coalesce_t *coalesce;
 };
 
 /**
@@ -346,6 +349,47 @@ int tuya_iot_dp_report_json_async(tuya_iot_client_t *client, const char *dps, co
 int tuya_iot_dp_report_json_with_notify(tuya_iot_client_t *client, const char *dps, const char *time,
                                         tuya_dp_notify_cb_t cb, void *user_data, int timeout_ms);
 
+/**
+ * @brief Configure the coalescing of DP reports.
+ *
+ * With ENABLE_DP_COALESCE, the tuya_iot_dp_report_json* reports taken within
+ * window_ms are sent as one frame keeping the last value of each DP.
+ *
+ * @param client - The Tuya client context.
+ * @param window_ms - merge window, 0 sends every report as is
+ * @param stat_history - keep every timestamped value instead of the last one
+ * @return int - OPRT_OK successful or error code.
+ */
+int tuya_iot_dp_coalesce_config(tuya_iot_client_t *client, uint32_t window_ms, bool stat_history);
+
+/**
+ * @brief Set the minimum interval between two reports of a DP.
+ *
+ * @param client - The Tuya client context.
+ * @param dpid - DP id
+ * @param interval_ms - minimum interval, 0 removes the limit
+ * @return int - OPRT_OK successful or error code.
+ */
+int tuya_iot_dp_rate_limit_set(tuya_iot_client_t *client, uint8_t dpid, uint32_t interval_ms);
+
+/**
+ * @brief Send the pending coalesced DP reports now.
+ *
+ * @param client - The Tuya client context.
+ * @return int - OPRT_OK successful or error code.
+ */
+int tuya_iot_dp_coalesce_flush(tuya_iot_client_t *client);
+
+/**
+ * @brief Get the merged, suppressed and saved bytes counters of the DP
+ * report coalescing.
+ *
+ * @param client - The Tuya client context.
+ * @param stat - the counters
+ * @return int - OPRT_OK successful or error code.
+ */
+int tuya_iot_dp_coalesce_stat_get(tuya_iot_client_t *client, tuya_dp_coalesce_stat_t *stat);
+
 /**
  * @brief Is Tuya client has been activated?
  *
@@ -6,11 +6,12 @@
  * The mechanism is designed to manage multiple socket readers, handle socket
  * events efficiently, and provide a clean shutdown process.
  *
- * The implementation utilizes a select-based approach to monitor and react to
- * socket events across multiple sockets. It supports operations such as adding
- * a new socket reader, updating existing readers, and removing readers. Error
- * handling and socket event detection are integral parts of the loop to ensure
- * robust operation.
+ * The implementation waits on a tal_net_poll set (epoll on linux, select on
+ * other systems) and dispatches only the sockets that are ready. Reader
+ * add/remove requests wake the loop up so they take effect at once. It
+ * supports operations such as adding a new socket reader, updating existing
+ * readers, and removing readers. Error handling and socket event detection
+ * are integral parts of the loop to ensure robust operation.
  *
  * Additionally, the file includes utility functions for setting up the
  * environment for socket event handling, including initializing and
@@ -28,6 +29,7 @@
 #include "lan_sock.h"
 #include "tal_api.h"
 #include "tal_network.h"
+#include "tal_net_poll.h"
 #include "tuya_lan.h"
 
 #pragma pack(1)
@@ -40,6 +42,9 @@ typedef struct LAN_SLOOP_S {
     sloop_sock_t *readers;
     BOOL_T terminate;
     QUEUE_HANDLE queue;
+    TAL_NET_POLL_HANDLE poll;
+    TAL_NET_POLL_EVENT_T *events;
+    uint8_t *writing; // per reader, the sock is polled for writable
 } LAN_SLOOP_S, *P_LAN_SLOOP_S;
 #pragma pack()
 
@@ -50,22 +55,14 @@ static P_LAN_SLOOP_S g_sloop = NULL;
 #define STACK_SIZE_LAN (4 * 1024)
 #endif
 
+// pre_select handlers run at least this often
+#define LAN_SLOOP_WAIT_MS (1000)
+
 static uint32_t __ty_sock_get_reader_num(void)
 {
     return (LAN_UDP_READER_CNT + tuya_lan_get_client_num());
 }
 
-static void __sock_table_set_fds(TUYA_FD_SET_T *rfds, TUYA_FD_SET_T *efds)
-{
-    int idx;
-    for (idx = 0; idx < __ty_sock_get_reader_num(); idx++) {
-        if (g_sloop->readers[idx].sock >= 0) {
-            tal_net_fd_set(g_sloop->readers[idx].sock, rfds);
-            tal_net_fd_set(g_sloop->readers[idx].sock, efds);
-        }
-    }
-}
-
 static void __sock_select_err_handle()
 {
     int idx;
@@ -105,6 +102,15 @@ void __ty_sock_loop_deinit(void)
     if (g_sloop->queue) {
         tal_queue_free(g_sloop->queue);
     }
+    if (g_sloop->poll) {
+        tal_net_poll_destroy(g_sloop->poll);
+    }
+    if (g_sloop->events) {
+        tal_free(g_sloop->events);
+    }
+    if (g_sloop->writing) {
+        tal_free(g_sloop->writing);
+    }
     if (g_sloop->thread) {
         tal_thread_delete(g_sloop->thread);
     }
@@ -114,6 +120,39 @@ void __ty_sock_loop_deinit(void)
     return;
 }
 
+static void __ty_poll_sock_reader(uint8_t idx)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+    uint32_t events = TAL_NET_POLL_IN | TAL_NET_POLL_ERR;
+
+    if (g_sloop->writing[idx]) {
+        events |= TAL_NET_POLL_OUT;
+    }
+
+    // the reader index comes back with the events of the sock
+    op_ret = tal_net_poll_add(g_sloop->poll, g_sloop->readers[idx].sock, events, (void *)(uintptr_t)idx);
+    if (OPRT_OK != op_ret) {
+        PR_ERR("poll lan sock %d err:%d", g_sloop->readers[idx].sock, op_ret);
+    }
+}
+
+static void __ty_flush_sock_reader(uint8_t idx)
+{
+    sloop_sock_t *reader = &g_sloop->readers[idx];
+    BOOL_T pending = FALSE;
+
+    if (reader->sock < 0 || NULL == reader->write) {
+        return;
+    }
+
+    // only poll for writable while output is stuck, a writable sock is ready nearly all the time
+    pending = reader->write(reader->sock);
+    if (pending != g_sloop->writing[idx] && reader->sock >= 0) {
+        g_sloop->writing[idx] = pending;
+        __ty_poll_sock_reader(idx);
+    }
+}
+
 void __ty_add_sock_reader(sloop_sock_t sock_info)
 {
     if (sock_info.sock > g_sloop->max_sock) {
@@ -126,6 +165,7 @@ void __ty_add_sock_reader(sloop_sock_t sock_info)
             PR_DEBUG("update lan sock %d,read:%p", sock_info.sock, sock_info.read);
             memset(&g_sloop->readers[idx], 0, sizeof(sloop_sock_t));
             memcpy(&g_sloop->readers[idx], &sock_info, sizeof(sloop_sock_t));
+            __ty_poll_sock_reader(idx);
             break;
         }
     }
@@ -136,7 +176,9 @@ void __ty_add_sock_reader(sloop_sock_t sock_info)
                 PR_DEBUG("reg lan sock %d,read:%p", sock_info.sock, sock_info.read);
                 memset(&g_sloop->readers[idx], 0, sizeof(sloop_sock_t));
                 memcpy(&g_sloop->readers[idx], &sock_info, sizeof(sloop_sock_t));
+                g_sloop->writing[idx] = FALSE;
                 g_sloop->cnt++;
+                __ty_poll_sock_reader(idx);
                 break;
             }
         }
@@ -156,12 +198,15 @@ void __ty_del_sock_reader(int sock)
     for (idx = 0; idx < __ty_sock_get_reader_num(); idx++) {
         if (g_sloop->readers[idx].sock == sock) {
             PR_DEBUG("unreg lan sock %d and close it", sock);
+            tal_net_poll_del(g_sloop->poll, g_sloop->readers[idx].sock);
             tal_net_close(g_sloop->readers[idx].sock);
             g_sloop->readers[idx].sock = -1;
             // g_sloop->readers[idx].pre_select = NULL;
             g_sloop->readers[idx].read = NULL;
             g_sloop->readers[idx].err = NULL;
             g_sloop->readers[idx].quit = NULL;
+            g_sloop->readers[idx].write = NULL;
+            g_sloop->writing[idx] = FALSE;
             g_sloop->cnt--;
             break;
         }
@@ -179,83 +224,54 @@ void tuya_sock_loop_run(void *data)
 {
     int actv_cnt = 0;
     int idx = 0;
-    TUYA_FD_SET_T *rfds, *efds;
+    sloop_sock_t *reader = NULL;
+    TAL_NET_POLL_EVENT_T *event = NULL;
     sloop_sock_t queue_data = {0};
 
-    rfds = tal_malloc(sizeof(TUYA_FD_SET_T));
-    efds = tal_malloc(sizeof(TUYA_FD_SET_T));
-    if (rfds == NULL || efds == NULL) {
-        PR_ERR("malloc err");
-        goto Err;
-    }
-    memset(rfds, 0, sizeof(TUYA_FD_SET_T));
-    memset(efds, 0, sizeof(TUYA_FD_SET_T));
-
     // while (tuya_get_sock_loop_terminate() &&
     // tal_thread_get_state(g_sloop->thread) == THREAD_STATE_RUNNING) {
     while (tuya_get_sock_loop_terminate()) {
+        // the poster woke the wait up, apply every pending request now
         memset(&queue_data, 0, sizeof(sloop_sock_t));
-        if (tal_queue_fetch(g_sloop->queue, &queue_data, 0) == 0) {
+        while (tal_queue_fetch(g_sloop->queue, &queue_data, 0) == 0) {
             if (queue_data.read) {
                 __ty_add_sock_reader(queue_data);
             } else {
                 __ty_del_sock_reader(queue_data.sock);
             }
+            memset(&queue_data, 0, sizeof(sloop_sock_t));
         }
         for (idx = 0; idx < __ty_sock_get_reader_num(); idx++) {
             if (g_sloop->readers[idx].pre_select) {
                 g_sloop->readers[idx].pre_select();
             }
-        }
-        if (g_sloop->cnt == 0) {
-            tal_system_sleep(2000);
-            continue;
+            __ty_flush_sock_reader(idx);
         }
 
-        tal_net_fd_zero(rfds);
-        tal_net_fd_zero(efds);
-        __sock_table_set_fds(rfds, efds);
-        actv_cnt = tal_net_select(g_sloop->max_sock + 1, rfds, NULL, efds, 1 * 1000);
+        // without readers this only waits for a registration or the pre_select period
+        actv_cnt = tal_net_poll_wait(g_sloop->poll, g_sloop->events, __ty_sock_get_reader_num(), LAN_SLOOP_WAIT_MS);
         if (actv_cnt < 0) {
             PR_ERR("errno:%d", tal_net_get_errno());
             __sock_select_err_handle();
             tal_system_sleep(1000);
             continue;
-        } else if (actv_cnt == 0) {
-            continue;
-        } else {
-            for (idx = 0; idx < __ty_sock_get_reader_num(); idx++) {
-                if (g_sloop->readers[idx].sock >= 0) {
-                    if (0 == tal_net_fd_isset(g_sloop->readers[idx].sock, efds)) {
-                        continue;
-                    }
-                    if (g_sloop->readers[idx].err) {
-                        PR_ERR("socket err:%d, sock:%d, idx:%d", tal_net_get_errno(), g_sloop->readers[idx].sock, idx);
-                        g_sloop->readers[idx].err(g_sloop->readers[idx].sock);
-                    }
-                    actv_cnt--;
-                    if (0 == actv_cnt) {
-                        break;
-                    }
-                }
-            }
-        }
-
-        if (0 == actv_cnt) {
-            continue;
         }
 
-        for (idx = 0; idx < __ty_sock_get_reader_num(); idx++) {
-            if (g_sloop->readers[idx].sock >= 0) {
-                if (tal_net_fd_isset(g_sloop->readers[idx].sock, rfds)) {
-                    if (g_sloop->readers[idx].read) {
-                        g_sloop->readers[idx].read(g_sloop->readers[idx].sock);
-                        actv_cnt--;
-                        if (0 == actv_cnt) {
-                            break;
-                        }
-                    }
-                }
+        for (idx = 0; idx < actv_cnt; idx++) {
+            event = &g_sloop->events[idx];
+            reader = &g_sloop->readers[(uintptr_t)event->arg];
+            if (reader->sock != event->fd) {
+                continue;
+            }
+            if ((event->events & TAL_NET_POLL_ERR) && reader->err) {
+                PR_ERR("socket err:%d, sock:%d, idx:%d", tal_net_get_errno(), reader->sock, (int)(uintptr_t)event->arg);
+                reader->err(reader->sock);
+            }
+            if ((event->events & TAL_NET_POLL_IN) && reader->sock >= 0 && reader->read) {
+                reader->read(reader->sock);
+            }
+            if (event->events & TAL_NET_POLL_OUT) {
+                __ty_flush_sock_reader((uint8_t)(uintptr_t)event->arg);
             }
         }
     }
@@ -266,14 +282,6 @@ void tuya_sock_loop_run(void *data)
         }
     }
 
-Err:
-    if (rfds) {
-        tal_free(rfds);
-    }
-    if (efds) {
-        tal_free(efds);
-    }
-
     tuya_lan_exit();
     __ty_sock_loop_deinit();
 
@@ -323,6 +331,21 @@ OPERATE_RET tuya_sock_loop_init(void)
     for (idx = 0; idx < __ty_sock_get_reader_num(); idx++) {
         g_sloop->readers[idx].sock = -1;
     }
+
+    g_sloop->events = tal_malloc(__ty_sock_get_reader_num() * sizeof(TAL_NET_POLL_EVENT_T));
+    g_sloop->writing = tal_malloc(__ty_sock_get_reader_num());
+    if (NULL == g_sloop->events || NULL == g_sloop->writing) {
+        op_ret = OPRT_MALLOC_FAILED;
+        goto Err;
+    }
+    memset(g_sloop->writing, 0, __ty_sock_get_reader_num());
+    op_ret = tal_net_poll_create(TAL_NET_POLL_AUTO, __ty_sock_get_reader_num(), &g_sloop->poll);
+    if (OPRT_OK != op_ret) {
+        PR_ERR("init poll err");
+        goto Err;
+    }
+    PR_DEBUG("lan sock loop on %s", tal_net_poll_get_name(g_sloop->poll));
+
     THREAD_CFG_T thread_cfg = {.priority = THREAD_PRIO_2, .stackDepth = STACK_SIZE_LAN, .thrdname = "lan_sock_loop"};
 
     op_ret = tal_thread_create_and_start(&g_sloop->thread, NULL, NULL, tuya_sock_loop_run, NULL, &thread_cfg);
@@ -360,6 +383,7 @@ OPERATE_RET tuya_reg_lan_sock(sloop_sock_t sock_info)
         PR_ERR("queue post err");
         return op_ret;
     }
+    tal_net_poll_wakeup(g_sloop->poll);
     PR_DEBUG("reg post queue %d", sock_info.sock);
     return OPRT_OK;
 }
@@ -385,10 +409,26 @@ OPERATE_RET tuya_unreg_lan_sock(int sock)
         PR_ERR("queue post err");
         return op_ret;
     }
+    tal_net_poll_wakeup(g_sloop->poll);
     PR_DEBUG("unreg post queue %d", sock);
     return OPRT_OK;
 }
 
+/**
+ * @brief Wakes the socket loop up.
+ *
+ * The loop then calls the write handler of every socket, so output queued
+ * from another thread is flushed without waiting for the next event.
+ */
+void tuya_sock_loop_wakeup(void)
+{
+    if (NULL == g_sloop) {
+        return;
+    }
+
+    tal_net_poll_wakeup(g_sloop->poll);
+}
+
 /**
  * @brief Disables the socket loop for Tuya Cloud service.
  *
@@ -51,6 +51,17 @@ typedef void (*sloop_sock_pre_select)();
  */
 typedef void (*sloop_sock_err)(int sock);
 
+/**
+ * @brief sock write handler, flush the output queued for the sock
+ *
+ * @param[in] sock fd
+ *
+ * @return TRUE if output is still pending, the loop then waits for the sock
+ * to become writable and calls it again
+ *
+ */
+typedef BOOL_T (*sloop_sock_write)(int sock);
+
 /**
  * @brief sock loop thread quit handler
  *
@@ -67,6 +78,7 @@ typedef struct sloop_sock_t {
     sloop_sock_read read;
     sloop_sock_err err;
     sloop_sock_quit quit;
+    sloop_sock_write write; // optional, called on every loop and when the sock is writable
 } sloop_sock_t;
 
 /**
@@ -91,6 +103,12 @@ OPERATE_RET tuya_reg_lan_sock(sloop_sock_t sock_info);
  */
 OPERATE_RET tuya_unreg_lan_sock(int sock);
 
+/**
+ * @brief wake the sock loop up, e.g. after output was queued for a sock
+ *
+ */
+void tuya_sock_loop_wakeup(void);
+
 /**
  * @brief set sock loop disable
  *
@@ -46,6 +46,32 @@
 #define RAND_LEN       16
 #define SESSIONKEY_LEN 16
 
+// per session send queue, frames are encrypted once when queued
+#define LAN_TXQ_DEPTH    8
+#define LAN_TXQ_BYTES    (8 * 1024)
+#define LAN_TXQ_STALL_MS (10 * 1000) // fault the session if the oldest frame waits longer
+
+typedef struct lan_tx_frame {
+    struct lan_tx_frame *next;
+    SYS_TIME_T time; // queued at
+    uint32_t type;
+    uint32_t len;
+    uint32_t off; // bytes already written
+    uint8_t data[0];
+} lan_tx_frame_t;
+
+typedef struct {
+    lan_tx_frame_t *head;
+    lan_tx_frame_t *tail;
+    uint32_t depth;
+    uint32_t bytes;
+    uint32_t max_depth;
+    uint32_t sent;
+    uint32_t dropped;
+    uint32_t latency;
+    uint32_t latency_max;
+} lan_txq_t;
+
 typedef struct {
     BOOL_T active;
     BOOL_T fault;
@@ -57,6 +83,7 @@ typedef struct {
     uint8_t randB[RAND_LEN];
     uint8_t hmac[HMAC_LEN];
     uint8_t secret_key[SESSIONKEY_LEN];
+    lan_txq_t txq;
 } lan_session_t;
 
 typedef struct {
@@ -111,8 +138,116 @@ static lan_mgr_t *lan_mgr_get(void)
     return s_lan_mgr;
 }
 
+static void lan_txq_clear(lan_txq_t *q)
+{
+    lan_tx_frame_t *tx = NULL;
+
+    while (q->head) {
+        tx = q->head;
+        q->head = tx->next;
+        tal_free(tx);
+    }
+    q->tail = NULL;
+    q->depth = 0;
+    q->bytes = 0;
+}
+
+static BOOL_T lan_txq_drop_report(lan_txq_t *q)
+{
+    lan_tx_frame_t *tx = q->head, *prev = NULL;
+
+    // the oldest status report that is not being written, a newer one carries the latest dp values
+    for (; tx; prev = tx, tx = tx->next) {
+        if (FRM_TP_STAT_REPORT != tx->type || tx->off) {
+            continue;
+        }
+        if (prev) {
+            prev->next = tx->next;
+        } else {
+            q->head = tx->next;
+        }
+        if (q->tail == tx) {
+            q->tail = prev;
+        }
+        q->depth--;
+        q->bytes -= tx->len;
+        q->dropped++;
+        tal_free(tx);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+static OPERATE_RET lan_txq_push(lan_txq_t *q, lan_tx_frame_t *tx)
+{
+    // an empty queue takes any frame
+    while (q->depth && (q->depth >= LAN_TXQ_DEPTH || q->bytes + tx->len > LAN_TXQ_BYTES)) {
+        if (!lan_txq_drop_report(q)) {
+            return OPRT_EXCEED_UPPER_LIMIT;
+        }
+    }
+
+    tx->next = NULL;
+    if (q->tail) {
+        q->tail->next = tx;
+    } else {
+        q->head = tx;
+    }
+    q->tail = tx;
+    q->depth++;
+    q->bytes += tx->len;
+    if (q->depth > q->max_depth) {
+        q->max_depth = q->depth;
+    }
+
+    return OPRT_OK;
+}
+
+// call with lan->mutex held, frames the socket does not take now stay queued
+static int lan_txq_flush(lan_session_t *session)
+{
+    lan_txq_t *q = &session->txq;
+    lan_tx_frame_t *tx = NULL;
+    uint32_t latency = 0;
+    int ret = 0;
+
+    while (q->head) {
+        tx = q->head;
+        ret = tal_net_send(session->fd, tx->data + tx->off, tx->len - tx->off);
+        if (ret <= 0) {
+            if ((tal_net_get_errno() == UNW_EINTR) || (tal_net_get_errno() == UNW_EAGAIN)) {
+                return OPRT_OK;
+            }
+            PR_ERR("ret:%d send_len:%d errno:%d", ret, tx->len - tx->off, tal_net_get_errno());
+            return OPRT_SVC_LAN_SEND_ERR;
+        }
+        tx->off += ret;
+        if (tx->off < tx->len) {
+            continue;
+        }
+
+        latency = (uint32_t)(tal_system_get_millisecond() - tx->time);
+        q->latency = q->sent ? (q->latency * 7 + latency) / 8 : latency;
+        if (latency > q->latency_max) {
+            q->latency_max = latency;
+        }
+        q->sent++;
+        q->head = tx->next;
+        if (NULL == q->head) {
+            q->tail = NULL;
+        }
+        q->depth--;
+        q->bytes -= tx->len;
+        tal_free(tx);
+    }
+
+    return OPRT_OK;
+}
+
 static void lan_session_free(lan_session_t *session)
 {
+    lan_txq_clear(&session->txq);
     memset(session, 0, sizeof(lan_session_t));
     session->fd = -1;
 }
@@ -241,6 +376,14 @@ static void lan_session_time_check(const TIME_T time)
     int i;
     for (i = 0; i < lan->cfg->client_num; i++) {
         if (lan->session[i].active) {
+            tal_mutex_lock(lan->mutex);
+            if (lan->session[i].txq.head &&
+                tal_system_get_millisecond() - lan->session[i].txq.head->time >= LAN_TXQ_STALL_MS) {
+                PR_ERR("session %d send stalled, depth:%d", lan->session[i].fd, lan->session[i].txq.depth);
+                lan_session_fault_set(&lan->session[i]);
+            }
+            tal_mutex_unlock(lan->mutex);
+
             if ((time - lan->session[i].time) >= 2592000 && (true != lan->session[i].fault)) { // 1 month sencond
                 continue;
             } else if ((time - lan->session[i].time >= lan->cfg->heart_timeout) || (lan->session[i].fault == true)) {
@@ -447,7 +590,7 @@ static int lan_send(lan_session_t *session, uint32_t fr_num, uint32_t fr_type, u
     }
     tal_mutex_unlock(s_lan_mgr->mutex);
 
-    uint8_t *send_buf = NULL;
+    lan_tx_frame_t *tx = NULL;
     uint32_t send_len = 0;
 
     PR_TRACE("tcp sendbuf socket:%d fr_num:%u fr_type:%d ret:%d len:%d", session->fd, fr_num, fr_type, ret_code, len);
@@ -474,42 +617,52 @@ static int lan_send(lan_session_t *session, uint32_t fr_num, uint32_t fr_type, u
     plaintext_data->ret_code = ret_code;
     memcpy(plaintext_data->data, data, len);
     // lpv3.5 test arch
-    lpv35_frame_object_t frame = {.sequence = session->sequence_out++,
-                                  .type = fr_type,
-                                  .data = (void *)plaintext_data,
-                                  .data_len = plaintext_len};
-    send_buf = tal_malloc(lpv35_frame_buffer_size_get(&frame));
-    if (send_buf == NULL) {
+    lpv35_frame_object_t frame = {.type = fr_type, .data = (void *)plaintext_data, .data_len = plaintext_len};
+    send_len = lpv35_frame_buffer_size_get(&frame);
+    tx = tal_malloc(sizeof(lan_tx_frame_t) + send_len);
+    if (tx == NULL) {
         PR_ERR("send_buf malloc fail");
         tal_free(plaintext_data);
         return OPRT_MALLOC_FAILED;
     }
-    memset(send_buf, 0, lpv35_frame_buffer_size_get(&frame));
-    op_ret = lpv35_frame_serialize(key, 16, &frame, send_buf, (int *)&send_len);
+    memset(tx, 0, sizeof(lan_tx_frame_t) + send_len);
+
+    // the sequence follows the queue order, the frame is written later as it is
+    tal_mutex_lock(s_lan_mgr->mutex);
+    frame.sequence = session->sequence_out++;
+    op_ret = lpv35_frame_serialize(key, 16, &frame, tx->data, (int *)&send_len);
     tal_free(plaintext_data);
     if (op_ret != OPRT_OK) {
+        tal_mutex_unlock(s_lan_mgr->mutex);
         PR_ERR("lpv35_frame_serialize fail:%d", op_ret);
-        tal_free(send_buf);
+        tal_free(tx);
         return OPRT_COM_ERROR;
     }
-    tal_mutex_lock(s_lan_mgr->mutex);
-    int ret = tal_net_send(session->fd, send_buf, send_len);
-    if (ret <= 0 || ret != send_len) {
-        if ((tal_net_get_errno() == UNW_EINTR) || (tal_net_get_errno() == UNW_EAGAIN)) {
-            tal_system_sleep(100);
-            ret = tal_net_send(session->fd, send_buf, send_len);
-            if (ret <= 0 || ret != send_len) {
-                op_ret = OPRT_SVC_LAN_SEND_ERR;
-            }
+    tx->time = tal_system_get_millisecond();
+    tx->type = fr_type;
+    tx->len = send_len;
+
+    op_ret = lan_txq_push(&session->txq, tx);
+    if (OPRT_OK != op_ret) {
+        tal_free(tx);
+        if (FRM_TP_STAT_REPORT == fr_type) {
+            session->txq.dropped++;
+            PR_DEBUG("session %d queue full, report dropped", session->fd);
         } else {
-            op_ret = OPRT_SVC_LAN_SEND_ERR;
+            // only replies are queued and the peer does not read them
+            lan_session_fault_set(session);
+            PR_ERR("session %d queue full, depth:%d", session->fd, session->txq.depth);
         }
+        tal_mutex_unlock(s_lan_mgr->mutex);
+        return OPRT_SVC_LAN_SEND_ERR;
     }
 
-    tal_free(send_buf);
-    if (op_ret == OPRT_SVC_LAN_SEND_ERR) {
+    op_ret = lan_txq_flush(session);
+    if (op_ret != OPRT_OK) {
         lan_session_fault_set(session);
-        PR_ERR("ret:%d send_len:%d errno:%d", ret, send_len, tal_net_get_errno());
+    } else if (session->txq.head) {
+        // the sock loop writes the rest once the socket is writable
+        tuya_sock_loop_wakeup();
     }
     tal_mutex_unlock(s_lan_mgr->mutex);
     return op_ret;
@@ -904,6 +1057,30 @@ static void lan_tcp_client_sock_err(int fd)
     return;
 }
 
+static BOOL_T lan_tcp_client_sock_write(int fd)
+{
+    lan_mgr_t *lan = lan_mgr_get();
+    lan_session_t *session = NULL;
+    BOOL_T pending = FALSE;
+
+    if (NULL == lan) {
+        return FALSE;
+    }
+
+    tal_mutex_lock(lan->mutex);
+    session = lan_session_get_by_fd(fd);
+    if (session && session->active && !session->fault && session->txq.head) {
+        if (OPRT_OK != lan_txq_flush(session)) {
+            lan_session_fault_set(session);
+        } else {
+            pending = (NULL != session->txq.head);
+        }
+    }
+    tal_mutex_unlock(lan->mutex);
+
+    return pending;
+}
+
 static void lan_tcp_client_sock_read(int32_t fd)
 {
     int ret = 0;
@@ -1090,7 +1267,8 @@ static void lan_tcp_serv_sock_read(int32_t fd)
                               .pre_select = NULL,
                               .read = lan_tcp_client_sock_read,
                               .err = lan_tcp_client_sock_err,
-                              .quit = NULL};
+                              .quit = NULL,
+                              .write = lan_tcp_client_sock_write};
 
     ret = tuya_reg_lan_sock(sock_info);
     if (OPRT_OK != ret) {
@@ -1442,6 +1620,46 @@ int tuya_lan_get_connect_client_num(void)
     return lan_get_valid_socket_num(lan_mgr_get());
 }
 
+/**
+ * @brief get send queue stat of a connection
+ *
+ * @param[in] index connection index, 0 to tuya_lan_get_client_num() - 1
+ * @param[out] stat stat of the connection
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND if no client is connected on the index
+ */
+int tuya_lan_get_session_stat(uint32_t index, lan_session_stat_t *stat)
+{
+    lan_mgr_t *lan = lan_mgr_get();
+    lan_session_t *session = NULL;
+    int op_ret = OPRT_OK;
+
+    if (NULL == stat) {
+        return OPRT_INVALID_PARM;
+    }
+    if (NULL == lan || index >= lan->cfg->client_num) {
+        return OPRT_NOT_FOUND;
+    }
+
+    tal_mutex_lock(lan->mutex);
+    session = &lan->session[index];
+    if (session->active) {
+        stat->fd = session->fd;
+        stat->queue_depth = session->txq.depth;
+        stat->queue_bytes = session->txq.bytes;
+        stat->queue_max_depth = session->txq.max_depth;
+        stat->sent = session->txq.sent;
+        stat->dropped = session->txq.dropped;
+        stat->latency_ms = session->txq.latency;
+        stat->latency_max_ms = session->txq.latency_max;
+    } else {
+        op_ret = OPRT_NOT_FOUND;
+    }
+    tal_mutex_unlock(lan->mutex);
+
+    return op_ret;
+}
+
 /**
  * @brief disconnect all connections
  *
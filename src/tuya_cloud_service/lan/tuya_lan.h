@@ -52,6 +52,21 @@ extern "C" {
 #define FRM_LAN_EXT_BEFORE_ACTIVATE 0x42
 #define FRM_LAN_UPD_LOG             0x30
 
+/**
+ * @brief send queue stat of a lan connection
+ *
+ */
+typedef struct {
+    int fd;
+    uint32_t queue_depth;     // frames waiting to be written
+    uint32_t queue_bytes;     // bytes waiting to be written
+    uint32_t queue_max_depth; // high water mark of queue_depth
+    uint32_t sent;            // frames written
+    uint32_t dropped;         // status reports dropped because the queue was full
+    uint32_t latency_ms;      // average time from queued to written
+    uint32_t latency_max_ms;  // worst time from queued to written
+} lan_session_stat_t;
+
 /**
  * @brief Init and start LAN service
  *
@@ -156,6 +171,16 @@ int tuya_lan_unregister_cb(uint32_t frame_type);
 uint32_t tuya_lan_get_client_num(void);
 int tuya_lan_get_connect_client_num(void);
 
+/**
+ * @brief get send queue stat of a connection
+ *
+ * @param[in] index connection index, 0 to tuya_lan_get_client_num() - 1
+ * @param[out] stat stat of the connection
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND if no client is connected on the index
+ */
+int tuya_lan_get_session_stat(uint32_t index, lan_session_stat_t *stat);
+
 int tuya_lan_data_com_send(const int32_t socket, const uint32_t fr_num, const uint32_t fr_type, const uint32_t ret_code,
                            const uint8_t *data, const uint32_t len);
 
@@ -217,6 +217,26 @@ OPERATE_RET tuya_parse_protocol_data(const DP_CMD_TYPE_E cmd, uint8_t *data, con
     return op_ret;
 }
 
+static void __pv23_head_fill(uint8_t *buf, const char *pv, const uint32_t num)
+{
+    // version
+    memcpy(buf + PV23_VERSION_OFFSET, pv, PV_LEN_22_32);
+
+    // seq
+    uint32_t tmp = UNI_HTONL(num);
+    memcpy(buf + PV23_SEQ_OFFSET, (uint8_t *)(&tmp), sizeof(uint32_t));
+
+    // cmd from
+    tmp = UNI_HTONL(0x00000001);
+    memcpy(buf + PV23_CMD_FROM_OFFSET, (uint8_t *)(&tmp), sizeof(uint32_t));
+
+    // reserve
+    memset(buf + PV23_RESERVE_OFFSET, 0, 1);
+
+    // nonce
+    uni_random_string((char *)(buf + PV23_NONCE_OFFSET), PV23_NONCE_LEN);
+}
+
 static OPERATE_RET __pack_data_with_cmd_pv23(const DP_CMD_TYPE_E cmd, const char *pv, const char *src,
                                              const uint32_t pro, const uint32_t num, const uint8_t *key,
                                              uint8_t **pack_out, uint32_t *out_len)
@@ -264,22 +284,7 @@ static OPERATE_RET __pack_data_with_cmd_pv23(const DP_CMD_TYPE_E cmd, const char
     memset(buf, 0, offset + PV23_EXCEPT_DATA_LEN);
 
     // make head data
-    // version
-    memcpy(buf + PV23_VERSION_OFFSET, pv, PV_LEN_22_32);
-
-    // seq
-    uint32_t tmp = UNI_HTONL(num);
-    memcpy(buf + PV23_SEQ_OFFSET, (uint8_t *)(&tmp), sizeof(uint32_t));
-
-    // cmd from
-    tmp = UNI_HTONL(0x00000001);
-    memcpy(buf + PV23_CMD_FROM_OFFSET, (uint8_t *)(&tmp), sizeof(uint32_t));
-
-    // reserve
-    memset(buf + PV23_RESERVE_OFFSET, 0, 1);
-
-    // nonce
-    uni_random_string((char *)(buf + PV23_NONCE_OFFSET), PV23_NONCE_LEN);
+    __pv23_head_fill(buf, pv, num);
 
     // AES GCM encrypt
     size_t encrypt_olen = 0;
@@ -435,6 +440,64 @@ OPERATE_RET tuya_pack_protocol_data(const DP_CMD_TYPE_E cmd, const char *src, co
     return op_ret;
 }
 
+/**
+ * @brief Packs MQTT protocol data in the buffer that holds it.
+ *
+ * The data sits at buf + PV23_INPLACE_HEADROOM. The JSON wrapper is put
+ * right in front of it and the PV2.3 header in front of the wrapper, the
+ * wrapped data is encrypted in place and the tag written behind it.
+ *
+ * @param cipher Keyed cipher handle of the MQTT cipher key.
+ * @param pro The protocol number.
+ * @param buf The buffer holding the data.
+ * @param data_len The length of the data.
+ * @param out Receives the frame start, inside buf.
+ * @param out_len Receives the frame length.
+ *
+ * @return The operation result status.
+ *     - OPRT_OK: Operation successful.
+ *     - Other error codes: Operation failed.
+ */
+OPERATE_RET tuya_pack_protocol_data_inplace(TAL_CIPHER_HANDLE cipher, const uint32_t pro, uint8_t *buf,
+                                            uint32_t data_len, uint8_t **out, uint32_t *out_len)
+{
+    if (NULL == cipher || NULL == buf || NULL == out || NULL == out_len) {
+        PR_ERR("Invalid Param");
+        return OPRT_INVALID_PARM;
+    }
+
+    char head[PV23_INPLACE_HEADROOM - PV23_DATA_OFFSET];
+    int head_len = snprintf(head, sizeof(head), "{\"protocol\":%" PRIu32 ",\"t\":%" PRIu32 ",\"data\":", pro,
+                            (uint32_t)tal_time_get_posix());
+    if (head_len < 0 || head_len >= (int)sizeof(head)) {
+        return OPRT_BUFFER_NOT_ENOUGH;
+    }
+
+    // wrap the data where it is
+    uint8_t *json = buf + PV23_INPLACE_HEADROOM - head_len;
+    memcpy(json, head, head_len);
+    json[head_len + data_len] = '}';
+    uint32_t json_len = head_len + data_len + 1;
+
+    PR_TRACE("After Pack:%.*s", json_len, json);
+
+    uint8_t *frame = json - PV23_DATA_OFFSET;
+    __pv23_head_fill(frame, TUYA_PV23, tuya_pack_protocol_serial_no());
+
+    // AES GCM encrypt in place, the tag goes behind the data
+    OPERATE_RET op_ret = tal_cipher_gcm_encrypt(cipher, frame + PV23_NONCE_OFFSET, PV23_NONCE_LEN, frame,
+                                                PV23_AD_DATA_LEN, json, json, json_len, json + json_len, PV23_TAG_LEN);
+    if (op_ret != OPRT_OK) {
+        PR_ERR("tal_cipher_gcm_encrypt:%d", op_ret);
+        return op_ret;
+    }
+
+    *out = frame;
+    *out_len = PV23_EXCEPT_DATA_LEN + json_len;
+
+    return OPRT_OK;
+}
+
 /**
  * @brief Retrieves the size of the frame buffer for LPV35 frame objects.
  *
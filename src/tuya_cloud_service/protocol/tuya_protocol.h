@@ -22,6 +22,7 @@
 #define __TUYA_PROTOCOL__
 #include "tuya_cloud_types.h"
 #include "cipher_wrapper.h"
+#include "tal_cipher.h"
 #include "dp_schema.h"
 
 #ifdef __cplusplus
@@ -58,6 +59,11 @@ extern "C" {
 #define LPV35_FRAME_TAG_SIZE      16
 #define LPV35_FRAME_TAIL_SIZE     4
 
+// room a PV2.3 frame packed in place keeps around its data, the header (24)
+// plus the longest {"protocol":..,"t":..,"data": in front, } and the tag behind
+#define PV23_INPLACE_HEADROOM (24 + 48)
+#define PV23_INPLACE_TAILROOM (1 + 16)
+
 #define LPV35_FRAME_MINI_SIZE                                                                                          \
     (LPV35_FRAME_HEAD_SIZE + LPV35_FRAME_VERSION_SIZE + LPV35_FRAME_RESERVE_SIZE + LPV35_FRAME_SEQUENCE_SIZE +         \
      LPV35_FRAME_TYPE_SIZE + LPV35_FRAME_DATALEN_SIZE + LPV35_FRAME_NONCE_SIZE + LPV35_FRAME_TAG_SIZE +                \
@@ -129,6 +135,27 @@ OPERATE_RET tuya_parse_protocol_data(const DP_CMD_TYPE_E cmd, uint8_t *data, con
  */
 OPERATE_RET tuya_pack_protocol_data(const DP_CMD_TYPE_E cmd, const char *src, const uint32_t pro, uint8_t *key,
                                     char **out, uint32_t *out_len);
+
+/**
+ * @brief pack mqtt protocol data in place
+ *
+ * The data is at buf + PV23_INPLACE_HEADROOM with PV23_INPLACE_TAILROOM
+ * behind it. The json wrapper and the header are written in front of it,
+ * the frame is encrypted where it is and the tag appended, so nothing is
+ * allocated or copied.
+ *
+ * @param[in] cipher keyed cipher handle of the mqtt cipher key
+ * @param[in] pro pro
+ * @param[inout] buf buffer holding the data
+ * @param[in] data_len data length
+ * @param[out] out frame start, inside buf
+ * @param[out] out_len frame length
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tuya_pack_protocol_data_inplace(TAL_CIPHER_HANDLE cipher, const uint32_t pro, uint8_t *buf,
+                                            uint32_t data_len, uint8_t **out, uint32_t *out_len);
 /**
  * @brief add head and tail in lpv35 frame
  *
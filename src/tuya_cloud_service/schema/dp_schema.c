@@ -12,8 +12,6 @@
  *
  */
 
-#include <inttypes.h>
-#include <stdarg.h>
 #include "tuya_cloud_types.h"
 #include "dp_schema.h"
 #include "cJSON.h"
@@ -36,23 +34,153 @@ typedef struct {
 
 static dp_schema_mgr_t s_dsmgr = {0};
 
-static bool dp_snprintf_append(char *buf, size_t buf_len, size_t *offset, const char *fmt, ...)
+/* json writer of dp reports, the formatters below replace snprintf on the report path */
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t offset;
+    bool overflow;
+} dp_json_out_t;
+
+static void dp_json_put(dp_json_out_t *out, const char *str, size_t len)
 {
-    if (buf == NULL || offset == NULL || *offset >= buf_len) {
-        return false;
+    // one byte is always left for the NUL
+    if (out->overflow || len >= out->len - out->offset) {
+        out->overflow = true;
+        return;
     }
+    memcpy(out->buf + out->offset, str, len);
+    out->offset += len;
+}
 
-    va_list args;
-    va_start(args, fmt);
-    int ret = vsnprintf(buf + *offset, buf_len - *offset, fmt, args);
-    va_end(args);
+static void dp_json_put_uint(dp_json_out_t *out, uint32_t value)
+{
+    char tmp[10];
+    size_t i = sizeof(tmp);
+
+    do {
+        tmp[--i] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    dp_json_put(out, tmp + i, sizeof(tmp) - i);
+}
+
+static void dp_json_put_int(dp_json_out_t *out, int32_t value)
+{
+    if (value < 0) {
+        dp_json_put(out, "-", 1);
+        dp_json_put_uint(out, 0U - (uint32_t)value);
+        return;
+    }
+    dp_json_put_uint(out, (uint32_t)value);
+}
 
-    if (ret < 0 || (size_t)ret >= buf_len - *offset) {
-        return false;
+/* quoted and escaped the way cJSON_PrintUnformatted does */
+static void dp_json_put_str(dp_json_out_t *out, const char *str)
+{
+    static const char hex[] = "0123456789abcdef";
+    char esc[6] = {'\\', 'u', '0', '0'};
+    const char *run = str;
+    size_t esc_len;
+
+    dp_json_put(out, "\"", 1);
+    for (; *str; str++) {
+        unsigned char c = (unsigned char)*str;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        dp_json_put(out, run, str - run);
+        run = str + 1;
+        esc_len = 2;
+        switch (c) {
+        case '"':
+        case '\\':
+            esc[1] = c;
+            break;
+        case '\b':
+            esc[1] = 'b';
+            break;
+        case '\f':
+            esc[1] = 'f';
+            break;
+        case '\n':
+            esc[1] = 'n';
+            break;
+        case '\r':
+            esc[1] = 'r';
+            break;
+        case '\t':
+            esc[1] = 't';
+            break;
+        default:
+            esc[1] = 'u';
+            esc[4] = hex[c >> 4];
+            esc[5] = hex[c & 0x0f];
+            esc_len = 6;
+            break;
+        }
+        dp_json_put(out, esc, esc_len);
     }
+    dp_json_put(out, run, str - run);
+    dp_json_put(out, "\"", 1);
+}
 
-    *offset += (size_t)ret;
-    return true;
+static void dp_json_put_key(dp_json_out_t *out, uint8_t id)
+{
+    dp_json_put(out, "\"", 1);
+    dp_json_put_uint(out, id);
+    dp_json_put(out, "\":", 2);
+}
+
+static void dp_json_put_obj(dp_json_out_t *out, dp_obj_t *dp, dp_node_t *dpnode)
+{
+    dp_json_put_key(out, dp->id);
+    switch (dp->type) {
+    case PROP_BOOL:
+        if (TRUE == dp->value.dp_bool) {
+            dp_json_put(out, "true", 4);
+        } else {
+            dp_json_put(out, "false", 5);
+        }
+        break;
+    case PROP_VALUE:
+        dp_json_put_int(out, dp->value.dp_value);
+        break;
+    case PROP_BITMAP:
+        dp_json_put_uint(out, dp->value.dp_bitmap);
+        break;
+    case PROP_STR:
+        dp_json_put_str(out, dp->value.dp_str);
+        break;
+    case PROP_ENUM:
+        dp_json_put_str(out, dpnode->prop.prop_enum.pp_enum[dp->value.dp_enum]);
+        break;
+    default:
+        break;
+    }
+    dp_json_put(out, ",", 1);
+}
+
+static void dp_json_put_time(dp_json_out_t *out, dp_obj_t *dp)
+{
+    dp_json_put_key(out, dp->id);
+    dp_json_put_uint(out, (uint32_t)dp->time_stamp);
+    dp_json_put(out, ",", 1);
+}
+
+/* replaces the trailing comma with the closing brace and terminates the string */
+static int dp_json_end(dp_json_out_t *out)
+{
+    if (!out->overflow && out->offset > 1) {
+        out->offset--;
+    }
+    dp_json_put(out, "}", 1);
+    if (out->overflow) {
+        return OPRT_BUFFER_NOT_ENOUGH;
+    }
+    out->buf[out->offset] = '\0';
+
+    return OPRT_OK;
 }
 
 /**
@@ -143,16 +271,11 @@ __err_exit:
  */
 dp_node_t *dp_node_find(dp_schema_t *schema, int id)
 {
-    int i;
-    dp_node_t *dpnode = NULL;
-
-    for (i = 0; i < schema->num; i++) {
-        if (schema->node[i].desc.id == id) {
-            dpnode = &schema->node[i];
-            break;
-        }
+    if (id < 0 || id >= (int)sizeof(schema->idx)) {
+        return NULL;
     }
-    return dpnode;
+
+    return schema->idx[id] ? &schema->node[schema->idx[id] - 1] : NULL;
 }
 
 /**
@@ -193,20 +316,12 @@ dp_schema_t *dp_schema_find(const char *devid)
  */
 dp_node_t *dp_node_find_by_devid(char *devid, int id)
 {
-    int i;
-    dp_node_t *dpnode = NULL;
-
     dp_schema_t *schema = dp_schema_find(devid);
     if (NULL == schema) {
         return NULL;
     }
-    for (i = 0; i < schema->num; i++) {
-        if (schema->node[i].desc.id == id) {
-            dpnode = &schema->node[i];
-            break;
-        }
-    }
-    return dpnode;
+
+    return dp_node_find(schema, id);
 }
 
 static __attribute__((unused)) OPERATE_RET dp_obj_equal_resp(dp_schema_t *schema, uint8_t *dpid, uint8_t num,
@@ -759,6 +874,69 @@ static bool dp_type_check(dp_rept_type_t dp_rept_type, dp_obj_t *dp, dp_node_t *
     return TRUE;
 }
 
+/**
+ * @brief Checks a dp of a report against the schema and diffs it against the
+ * cached value, called with the schema mutex held.
+ *
+ * @param schema The DP schema.
+ * @param dpin The report.
+ * @param dp The dp to check.
+ * @param node_out Receives the node of the dp.
+ * @return OPRT_OK to report the dp, 1 to skip it, or a negative error code.
+ */
+static int dp_rept_check(dp_schema_t *schema, dp_rept_in_t *dpin, dp_obj_t *dp, dp_node_t **node_out)
+{
+    dp_node_t *dpnode = dp_node_find(schema, dp->id);
+    if (NULL == dpnode) {
+        PR_ERR("dpid %d not find", dp->id);
+        return 1;
+    }
+    if (dp->type != dpnode->desc.prop_tp) {
+        PR_ERR("dp %d type not match:%d %d", dp->id, dp->type, dpnode->desc.prop_tp);
+        return OPRT_SVC_DP_TP_NOT_MATCH;
+    }
+
+    // Only the reported interface needs to be checked. Retransmission does not require verification and flow
+    // control
+    if (dpin->rept_type != T_RE_TRANS_REPT) {
+        if (FALSE == dp_type_check(dpin->rept_type, dp, dpnode)) {
+            return 1;
+        }
+
+        if ((schema->actv.preprocess == TRUE) && (dpnode->desc.passive == PSV_TRUE)) {
+            PR_DEBUG("dp passive:true");
+            return 1;
+        }
+        if (dp_rept_update(dpin->rept_type, dp, dpnode, dpin->flags)) {
+            PR_DEBUG("dp np update");
+            return 1;
+        }
+    }
+
+    switch (dp->type) {
+    case PROP_BOOL:
+    case PROP_VALUE:
+    case PROP_BITMAP:
+    case PROP_STR:
+        break;
+
+    case PROP_ENUM: {
+        if (dp->value.dp_enum >= dpnode->prop.prop_enum.cnt) {
+            PR_ERR("dp %d enum not match:%d %d", dp->id, dp->value.dp_enum, dpnode->prop.prop_enum.cnt);
+            return OPRT_SVC_DP_TYPE_PROP_ILLEGAL;
+        }
+    } break;
+
+    default: {
+        PR_ERR("dp %d type invalid %d", dp->id, dp->type);
+        return OPRT_COM_ERROR;
+    }
+    }
+    *node_out = dpnode;
+
+    return OPRT_OK;
+}
+
 /**
  * @brief Performs a validity check on the given data point (DP) repetition.
  *
@@ -774,65 +952,33 @@ static bool dp_type_check(dp_rept_type_t dp_rept_type, dp_obj_t *dp, dp_node_t *
  */
 int dp_rept_valid_check(dp_schema_t *schema, dp_rept_in_t *dpin, dp_rept_valid_t *dpvalid)
 {
-    int i;
+    int i, op_ret;
 
     tal_mutex_lock(schema->mutex);
     for (i = 0; i < dpin->dpscnt; i++) {
         dp_obj_t *dp = &(dpin->dps[i]);
-        dp_node_t *dpnode = dp_node_find(schema, dp->id);
-        if (NULL == dpnode) {
-            PR_ERR("dpnode[%d]: dpid %d not find", i, dp->id);
-            continue;
-        }
-        if (dp->type != dpnode->desc.prop_tp) {
-            PR_ERR("dparr[%d] type not match:%d %d", i, dp->type, dpnode->desc.prop_tp);
-            tal_mutex_unlock(schema->mutex);
-            return OPRT_SVC_DP_TP_NOT_MATCH;
-        }
+        dp_node_t *dpnode = NULL;
 
-        // Only the reported interface needs to be checked. Retransmission does not require verification and flow
-        // control
-        if (dpin->rept_type != T_RE_TRANS_REPT) {
-            if (FALSE == dp_type_check(dpin->rept_type, dp, dpnode)) {
-                continue;
-            }
-
-            if ((schema->actv.preprocess == TRUE) && (dpnode->desc.passive == PSV_TRUE)) {
-                PR_DEBUG("dp passive:true");
-                continue;
-            }
-            if (dp_rept_update(dpin->rept_type, dp, dpnode, dpin->flags)) {
-                PR_DEBUG("dp np update");
-                continue;
-            }
+        op_ret = dp_rept_check(schema, dpin, dp, &dpnode);
+        if (op_ret < 0) {
+            tal_mutex_unlock(schema->mutex);
+            return op_ret;
+        } else if (op_ret > 0) {
+            continue;
         }
 
         switch (dp->type) {
-        case PROP_BOOL:
-        case PROP_VALUE:
-        case PROP_BITMAP: {
-            dpvalid->len += 20;
-            break;
-        }
-
         case PROP_STR: {
             dpvalid->len += 2 * strlen(dp->value.dp_str) + 15;
         } break;
 
         case PROP_ENUM: {
-            if (dp->value.dp_enum >= dpnode->prop.prop_enum.cnt) {
-                PR_ERR("dparr[%d] enum not match:%d %d", i, dp->value.dp_enum, dpnode->prop.prop_enum.cnt);
-                tal_mutex_unlock(schema->mutex);
-                return OPRT_SVC_DP_TYPE_PROP_ILLEGAL;
-            }
             dpvalid->len += strlen(dpnode->prop.prop_enum.pp_enum[dp->value.dp_enum]) + 15;
         } break;
 
         default: {
-            PR_ERR("dparr[%d] type invalid %d", i, dp->type);
-            tal_mutex_unlock(schema->mutex);
-            return OPRT_COM_ERROR;
-        }
+            dpvalid->len += 20;
+        } break;
         }
         if (dp->time_stamp) {
             dpvalid->timelen += 30;
@@ -867,57 +1013,46 @@ int dp_rept_valid_check(dp_schema_t *schema, dp_rept_in_t *dpin, dp_rept_valid_t
  */
 int dp_rept_json_output(dp_schema_t *schema, dp_rept_in_t *dpin, dp_rept_valid_t *dpvalid, dp_rept_out_t *dpout)
 {
-    uint16_t i, j;
-    size_t offset = 0;
-    size_t time_offset = 0;
+    uint16_t i, j = 0;
     OPERATE_RET op_ret = OPRT_OK;
-    char *dpstr = NULL;
-    char *dptimestr = NULL;
+    dp_json_out_t out = {0};
+    dp_json_out_t time_out = {0};
     bool is_need_time = false;
 
-    dpstr = (char *)tal_malloc(dpvalid->len);
-    if (NULL == dpstr) {
+    if (dpvalid->len == 0) {
+        return OPRT_BUFFER_NOT_ENOUGH;
+    }
+    out.len = dpvalid->len;
+    out.buf = (char *)tal_malloc(out.len);
+    if (NULL == out.buf) {
         PR_ERR("malloc err:%d", dpvalid->len);
         return OPRT_MALLOC_FAILED;
     }
     // STAT type DP needs to assemble a timestamp
     if ((T_STAT_REPT == dpin->rept_type) && dpvalid->timelen && dpout->timejson) {
-        dptimestr = (char *)tal_malloc(dpvalid->timelen);
-        if (NULL == dptimestr) {
+        time_out.len = dpvalid->timelen;
+        time_out.buf = (char *)tal_malloc(time_out.len);
+        if (NULL == time_out.buf) {
             PR_ERR("malloc err:%d", dpvalid->timelen);
             op_ret = OPRT_MALLOC_FAILED;
             goto __err_exit;
         }
         is_need_time = true;
+        dp_json_put(&time_out, "{", 1);
     }
-    if (dpvalid->len == 0) {
-        op_ret = OPRT_BUFFER_NOT_ENOUGH;
-        goto __err_exit;
-    }
-
-    dpstr[offset++] = '{';
-    if (is_need_time) {
-        if (dpvalid->timelen == 0) {
-            op_ret = OPRT_BUFFER_NOT_ENOUGH;
-            goto __err_exit;
-        }
-        dptimestr[time_offset++] = '{';
-    }
+    dp_json_put(&out, "{", 1);
 
     for (i = 0; i < dpvalid->num; i++) {
-        dp_obj_t *dp = NULL;
-        for (j = 0; j < dpin->dpscnt; j++) {
-            if (dpvalid->dpid[i] == dpin->dps[j].id) {
-                dp = &dpin->dps[j];
-                break;
-            }
+        // dpvalid->dpid keeps the order of dpin->dps, so one forward scan finds them all
+        while (j < dpin->dpscnt && dpvalid->dpid[i] != dpin->dps[j].id) {
+            j++;
         }
-        if (NULL == dp) {
+        if (j >= dpin->dpscnt) {
             PR_DEBUG("dp not found");
             op_ret = OPRT_SVC_DP_ID_NOT_FOUND;
             goto __err_exit;
         }
-        // dp_obj_t  *dp     = &dpin->dps[dpvalid->dpid[i]];
+        dp_obj_t *dp = &dpin->dps[j++];
         dp_node_t *dpnode = dp_node_find(schema, dp->id);
         if (NULL == dpnode) {
             PR_DEBUG("dp->id = %d not found", dp->id);
@@ -930,104 +1065,144 @@ int dp_rept_json_output(dp_schema_t *schema, dp_rept_in_t *dpin, dp_rept_valid_t
             goto __err_exit;
         }
 
-        switch (dp->type) {
-        case PROP_BOOL: {
-            if (TRUE == dp->value.dp_bool) {
-                if (!dp_snprintf_append(dpstr, dpvalid->len, &offset, "\"%d\":true,", dp->id)) {
-                    op_ret = OPRT_BUFFER_NOT_ENOUGH;
-                    goto __err_exit;
-                }
-            } else {
-                if (!dp_snprintf_append(dpstr, dpvalid->len, &offset, "\"%d\":false,", dp->id)) {
-                    op_ret = OPRT_BUFFER_NOT_ENOUGH;
-                    goto __err_exit;
-                }
-            }
-            break;
+        dp_json_put_obj(&out, dp, dpnode);
+        if (is_need_time && dp->time_stamp) {
+            dp_json_put_time(&time_out, dp);
         }
+    }
 
-        case PROP_VALUE: {
-            if (!dp_snprintf_append(dpstr, dpvalid->len, &offset, "\"%d\":%d,", dp->id, dp->value.dp_value)) {
-                op_ret = OPRT_BUFFER_NOT_ENOUGH;
-                goto __err_exit;
-            }
-            break;
-        }
+    op_ret = dp_json_end(&out);
+    if (OPRT_OK == op_ret && is_need_time) {
+        op_ret = dp_json_end(&time_out);
+    }
+    if (OPRT_OK != op_ret) {
+        goto __err_exit;
+    }
 
-        case PROP_BITMAP: {
-            if (!dp_snprintf_append(dpstr, dpvalid->len, &offset, "\"%d\":%" PRIu32 ",", dp->id,
-                                    dp->value.dp_bitmap)) {
-                op_ret = OPRT_BUFFER_NOT_ENOUGH;
-                goto __err_exit;
-            }
-            break;
-        }
+    dpout->dpsjson = out.buf;
+    PR_DEBUG("dp rept out: %s", out.buf);
+    if (is_need_time) {
+        PR_DEBUG("dptimestr:%s", time_out.buf);
+        dpout->timejson = time_out.buf;
+    }
 
-        case PROP_STR: {
-            cJSON *temp_str = cJSON_CreateString(dp->value.dp_str);
-            char *tmp_data = cJSON_PrintUnformatted(temp_str);
-            if (tmp_data) {
-                if (!dp_snprintf_append(dpstr, dpvalid->len, &offset, "\"%d\":%s,", dp->id, tmp_data)) {
-                    cJSON_free(tmp_data);
-                    cJSON_Delete(temp_str);
-                    op_ret = OPRT_BUFFER_NOT_ENOUGH;
-                    goto __err_exit;
-                }
-            }
-            cJSON_free(tmp_data);
-            cJSON_Delete(temp_str);
-            break;
-        }
+    return OPRT_OK;
 
-        case PROP_ENUM: {
-            if (!dp_snprintf_append(dpstr, dpvalid->len, &offset, "\"%d\":\"%s\",", dp->id,
-                                    dpnode->prop.prop_enum.pp_enum[dp->value.dp_enum])) {
-                op_ret = OPRT_BUFFER_NOT_ENOUGH;
-                goto __err_exit;
-            }
-        } break;
-        }
+__err_exit:
+    tal_free(out.buf);
+    if (time_out.buf) {
+        tal_free(time_out.buf);
+    }
 
-        if (is_need_time && dp->time_stamp) {
-            if (!dp_snprintf_append(dptimestr, dpvalid->timelen, &time_offset, "\"%d\":%u,", dp->id, dp->time_stamp)) {
-                op_ret = OPRT_BUFFER_NOT_ENOUGH;
-                goto __err_exit;
-            }
+    return op_ret;
+}
+
+/**
+ * @brief Returns the buffer size dp_rept_json_build needs for the dps json of
+ * a report, the terminating NUL included.
+ *
+ * @param schema Pointer to the DP schema structure.
+ * @param dpin Pointer to the input data structure.
+ * @return The buffer size in bytes.
+ */
+size_t dp_rept_json_size(dp_schema_t *schema, dp_rept_in_t *dpin)
+{
+    // "{" "}" and the NUL
+    size_t len = 3;
+    int i;
+
+    for (i = 0; i < dpin->dpscnt; i++) {
+        dp_obj_t *dp = &dpin->dps[i];
+        dp_node_t *dpnode = NULL;
+
+        // "255":-2147483648, covers the key and any number, a string escapes to 6 bytes a char at most
+        len += 19;
+        if (PROP_STR == dp->type && dp->value.dp_str) {
+            len += 6 * strlen(dp->value.dp_str);
+        } else if (PROP_ENUM == dp->type && (dpnode = dp_node_find(schema, dp->id)) &&
+                   PROP_ENUM == dpnode->desc.prop_tp && dp->value.dp_enum < dpnode->prop.prop_enum.cnt) {
+            len += 6 * strlen(dpnode->prop.prop_enum.pp_enum[dp->value.dp_enum]);
         }
     }
 
-    if (offset == 0 || offset + 1 >= dpvalid->len) {
-        op_ret = OPRT_BUFFER_NOT_ENOUGH;
-        goto __err_exit;
+    return len;
+}
+
+/**
+ * @brief Validates, diffs and serializes a DP report in one pass.
+ *
+ * Each dp is checked and diffed against the cached value the way
+ * dp_rept_valid_check does, and written to buf as soon as it passes, so the
+ * report is neither looked up twice nor copied through a temporary buffer.
+ *
+ * @param schema Pointer to the DP schema structure.
+ * @param dpin Pointer to the input data structure.
+ * @param dpvalid Receives the ids of the reported dps, room for dpin->dpscnt ids.
+ * @param buf Receives the dps json, dp_rept_json_size bytes are enough.
+ * @param buf_len The size of buf.
+ * @param timebuf Receives the time json of a T_STAT_REPT report, NULL if not needed.
+ * @param timebuf_len The size of timebuf, 30 bytes per dp are enough.
+ * @return OPRT_OK on success, OPRT_SVC_DP_ID_NOT_FOUND if no dp needs to be
+ * reported, or another error code.
+ */
+int dp_rept_json_build(dp_schema_t *schema, dp_rept_in_t *dpin, dp_rept_valid_t *dpvalid, char *buf, size_t buf_len,
+                       char *timebuf, size_t timebuf_len)
+{
+    int i, op_ret = OPRT_OK;
+    dp_json_out_t out = {buf, buf_len, 0, false};
+    dp_json_out_t time_out = {timebuf, timebuf_len, 0, false};
+    bool is_need_time = (T_STAT_REPT == dpin->rept_type) && timebuf;
+
+    if (NULL == buf || 0 == buf_len || (is_need_time && 0 == timebuf_len)) {
+        return OPRT_INVALID_PARM;
     }
 
-    dpstr[offset - 1] = '}';
-    dpstr[offset] = 0;
+    dp_json_put(&out, "{", 1);
+    if (is_need_time) {
+        dp_json_put(&time_out, "{", 1);
+    }
 
-    dpout->dpsjson = dpstr;
+    tal_mutex_lock(schema->mutex);
+    for (i = 0; i < dpin->dpscnt; i++) {
+        dp_obj_t *dp = &(dpin->dps[i]);
+        dp_node_t *dpnode = NULL;
 
-    PR_DEBUG("dp rept out: %s", dpstr);
+        op_ret = dp_rept_check(schema, dpin, dp, &dpnode);
+        if (op_ret < 0) {
+            break;
+        } else if (op_ret > 0) {
+            op_ret = OPRT_OK;
+            continue;
+        }
 
-    if (is_need_time) {
-        if (time_offset == 0 || time_offset + 1 >= dpvalid->timelen) {
-            op_ret = OPRT_BUFFER_NOT_ENOUGH;
-            goto __err_exit;
+        dp_json_put_obj(&out, dp, dpnode);
+        if (is_need_time && dp->time_stamp) {
+            dp_json_put_time(&time_out, dp);
         }
-        dptimestr[time_offset - 1] = '}';
-        dptimestr[time_offset] = 0;
-        PR_DEBUG("dptimestr:%s", dptimestr);
-        dpout->timejson = dptimestr;
+        dpvalid->dpid[dpvalid->num++] = dp->id;
+    }
+    tal_mutex_unlock(schema->mutex);
+    if (OPRT_OK != op_ret) {
+        return op_ret;
     }
 
-    return OPRT_OK;
+    if (0 == dpvalid->num) {
+        PR_DEBUG("no vaild dp to rept");
+        return OPRT_SVC_DP_ID_NOT_FOUND;
+    }
+    dpvalid->schema = schema;
 
-__err_exit:
-    tal_free(dpstr);
-    if (is_need_time) {
-        tal_free(dptimestr);
+    op_ret = dp_json_end(&out);
+    if (OPRT_OK == op_ret && is_need_time) {
+        op_ret = dp_json_end(&time_out);
+    }
+    if (OPRT_OK != op_ret) {
+        PR_ERR("dp rept json overflow %d", (int)buf_len);
+        return op_ret;
     }
+    PR_DEBUG("dp rept out: %s", buf);
 
-    return op_ret;
+    return OPRT_OK;
 }
 
 // int dp_rept_json_output(dp_schema_t *schema, dp_rept_in_t *dpin,
@@ -1615,7 +1790,7 @@ int dp_schema_create(char *devid, char *schema_json, dp_schema_t **dp_schema_out
 {
     OPERATE_RET op_ret = OPRT_OK;
     dp_node_pos_t *nodepos = NULL;
-    int nodenum;
+    int nodenum, i;
 
     nodepos = tal_malloc(sizeof(dp_node_pos_t) * 255);
     if (NULL == nodepos) {
@@ -1653,6 +1828,10 @@ int dp_schema_create(char *devid, char *schema_json, dp_schema_t **dp_schema_out
         PR_ERR("dp_node_parse fail:%d", op_ret);
         goto __exit;
     }
+    // the first node of a duplicated id wins, the same as the former linear search
+    for (i = nodenum - 1; i >= 0; i--) {
+        dp_schema->idx[dp_schema->node[i].desc.id] = i + 1;
+    }
     dp_schema->actv.preprocess = other_attr.preprocess;
     dp_schema->actv.attach_dp_if = TRUE;
     strncpy(dp_schema->devid, devid, DEV_ID_LEN);
@@ -1707,3 +1886,179 @@ int dp_schema_delete(char *devid)
 
     return OPRT_OK;
 }
+
+#if defined(ENABLE_DP_SCHEMA_BENCHMARK)
+static dp_node_t *dp_node_find_linear(dp_schema_t *schema, int id)
+{
+    int i;
+
+    for (i = 0; i < schema->num; i++) {
+        if (schema->node[i].desc.id == id) {
+            return &schema->node[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Measures reports of 10, 50 and 100 dps and prints the results.
+ *
+ * The values change every round so the dps are diffed and cached like a real
+ * report. Run it with the log level above debug, dp_rept_update logs each dp.
+ *
+ * @param rounds The number of reports per measurement.
+ * @return Returns 0 on success, or a negative error code on failure.
+ */
+int dp_schema_benchmark(uint32_t rounds)
+{
+    static char *bench_enum[] = {"white", "colour", "scene", "music"};
+    static char *bench_str[] = {"000e0d0000000000000000c80000", "scene \"sleep\"\n"};
+    const uint8_t dpnum[] = {10, 50, 100};
+    dp_schema_t *schema = NULL;
+    dp_rept_valid_t *dpvalid = NULL;
+    dp_obj_t dps[100];
+    dp_rept_in_t dpin;
+    dp_rept_out_t dpout;
+    char *buf = NULL;
+    size_t buf_len;
+    SYS_TIME_T start, two_ms, one_ms, linear_ms, index_ms;
+    volatile uintptr_t sink = 0;
+    uint32_t r, n, i;
+    int rt = OPRT_OK;
+
+    if (0 == rounds) {
+        return OPRT_INVALID_PARM;
+    }
+    schema = tal_malloc(sizeof(dp_schema_t) + CNTSOF(dps) * sizeof(dp_node_t));
+    dpvalid = tal_malloc(sizeof(dp_rept_valid_t) + CNTSOF(dps));
+    if (NULL == schema || NULL == dpvalid) {
+        rt = OPRT_MALLOC_FAILED;
+        goto __exit;
+    }
+    memset(schema, 0, sizeof(dp_schema_t) + CNTSOF(dps) * sizeof(dp_node_t));
+    TUYA_CALL_ERR_GOTO(tal_mutex_create_init(&schema->mutex), __exit);
+
+    // ids spread over 1..199 so that the linear search walks the whole schema
+    for (i = 0; i < CNTSOF(dps); i++) {
+        dp_node_t *node = &schema->node[i];
+        node->desc.id = 2 * i + 1;
+        node->desc.mode = M_RW;
+        node->desc.type = T_OBJ;
+        node->desc.trig = TRIG_PULSE;
+        node->desc.prop_tp = i % 4;
+        switch (node->desc.prop_tp) {
+        case PROP_VALUE:
+            node->prop.prop_int.max = 1000000;
+            break;
+        case PROP_STR:
+            node->prop.prop_str.max_len = 255;
+            TUYA_CALL_ERR_GOTO(tal_mutex_create_init(&node->prop.prop_str.dp_str_mutex), __exit);
+            break;
+        case PROP_ENUM:
+            node->prop.prop_enum.cnt = CNTSOF(bench_enum);
+            node->prop.prop_enum.pp_enum = bench_enum;
+            break;
+        default:
+            break;
+        }
+        dps[i].id = node->desc.id;
+        dps[i].type = node->desc.prop_tp;
+        dps[i].time_stamp = 0;
+    }
+
+    for (n = 0; n < CNTSOF(dpnum) && OPRT_OK == rt; n++) {
+        schema->num = dpnum[n];
+        memset(schema->idx, 0, sizeof(schema->idx));
+        for (i = 0; i < schema->num; i++) {
+            schema->idx[schema->node[i].desc.id] = i + 1;
+        }
+        memset(&dpin, 0, sizeof(dpin));
+        dpin.rept_type = T_OBJ_REPT;
+        dpin.dpscnt = schema->num;
+        dpin.dps = dps;
+
+        start = tal_system_get_millisecond();
+        for (r = 0; r < rounds && OPRT_OK == rt; r++) {
+            for (i = 0; i < dpin.dpscnt; i++) {
+                dps[i].value.dp_value = r + i;
+                dps[i].value.dp_enum = (r + i) % CNTSOF(bench_enum);
+                dps[i].value.dp_str = bench_str[(r + i) & 1];
+                dps[i].value.dp_bool = (r + i) & 1;
+            }
+            memset(dpvalid, 0, sizeof(dp_rept_valid_t) + dpin.dpscnt);
+            memset(&dpout, 0, sizeof(dpout));
+            rt = dp_rept_valid_check(schema, &dpin, dpvalid);
+            if (OPRT_OK == rt) {
+                rt = dp_rept_json_output(schema, &dpin, dpvalid, &dpout);
+                tal_free(dpout.dpsjson);
+            }
+        }
+        two_ms = tal_system_get_millisecond() - start;
+
+        // the longest values, the size of every round
+        buf_len = dp_rept_json_size(schema, &dpin);
+        tal_free(buf);
+        buf = tal_malloc(buf_len);
+        if (NULL == buf) {
+            rt = OPRT_MALLOC_FAILED;
+            break;
+        }
+        start = tal_system_get_millisecond();
+        for (r = 0; r < rounds && OPRT_OK == rt; r++) {
+            for (i = 0; i < dpin.dpscnt; i++) {
+                dps[i].value.dp_value = r + i + 1;
+                dps[i].value.dp_enum = (r + i + 1) % CNTSOF(bench_enum);
+                dps[i].value.dp_str = bench_str[(r + i + 1) & 1];
+                dps[i].value.dp_bool = (r + i + 1) & 1;
+            }
+            dpvalid->num = 0;
+            rt = dp_rept_json_build(schema, &dpin, dpvalid, buf, buf_len, NULL, 0);
+        }
+        one_ms = tal_system_get_millisecond() - start;
+        if (OPRT_OK == rt && dpvalid->num != dpin.dpscnt) {
+            PR_ERR("dp rept %u dps reported %u", dpin.dpscnt, dpvalid->num);
+            rt = OPRT_COM_ERROR;
+        }
+
+        start = tal_system_get_millisecond();
+        for (r = 0; r < rounds; r++) {
+            for (i = 0; i < dpin.dpscnt; i++) {
+                sink += (uintptr_t)dp_node_find_linear(schema, dps[i].id);
+            }
+        }
+        linear_ms = tal_system_get_millisecond() - start;
+
+        start = tal_system_get_millisecond();
+        for (r = 0; r < rounds; r++) {
+            for (i = 0; i < dpin.dpscnt; i++) {
+                sink += (uintptr_t)dp_node_find(schema, dps[i].id);
+            }
+        }
+        index_ms = tal_system_get_millisecond() - start;
+
+        PR_NOTICE("dp rept %3u dps: two-pass %u ns, one-pass %u ns, find linear %u ns, index %u ns", dpin.dpscnt,
+                  (uint32_t)(two_ms * 1000000 / rounds), (uint32_t)(one_ms * 1000000 / rounds),
+                  (uint32_t)(linear_ms * 1000000 / rounds), (uint32_t)(index_ms * 1000000 / rounds));
+    }
+
+__exit:
+    if (schema) {
+        for (i = 0; i < CNTSOF(dps); i++) {
+            if (PROP_STR == schema->node[i].desc.prop_tp) {
+                if (schema->node[i].prop.prop_str.dp_str_mutex) {
+                    tal_mutex_release(schema->node[i].prop.prop_str.dp_str_mutex);
+                }
+                tal_free(schema->node[i].prop.prop_str.value);
+            }
+        }
+        if (schema->mutex) {
+            tal_mutex_release(schema->mutex);
+        }
+    }
+    tal_free(schema);
+    tal_free(dpvalid);
+    tal_free(buf);
+
+    return rt;
+}
+#endif
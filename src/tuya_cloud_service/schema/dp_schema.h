@@ -331,6 +331,8 @@ typedef struct {
     MUTEX_HANDLE mutex;
     /** count of dp */
     uint8_t num;
+    /** position + 1 in node of each dp id, 0 if the id is not in the schema */
+    uint8_t idx[256];
     /** dp info */
     dp_node_t node[0];
 } dp_schema_t;
@@ -485,6 +487,47 @@ int dp_rept_valid_check(dp_schema_t *schema, dp_rept_in_t *dpin, dp_rept_valid_t
  */
 int dp_rept_json_output(dp_schema_t *schema, dp_rept_in_t *dpin, dp_rept_valid_t *dpvalid, dp_rept_out_t *dpout);
 
+/**
+ * @brief Returns the buffer size dp_rept_json_build needs for the dps json of
+ * a report, the terminating NUL included.
+ *
+ * @param schema The DP schema of the report.
+ * @param dpin The input data for the DP report.
+ * @return The buffer size in bytes.
+ */
+size_t dp_rept_json_size(dp_schema_t *schema, dp_rept_in_t *dpin);
+
+/**
+ * @brief Validates, diffs and serializes a DP report in one pass.
+ *
+ * Does the work of dp_rept_valid_check and dp_rept_json_output in a single
+ * walk over the dps, writing the json into caller-provided buffers.
+ *
+ * @param schema The DP schema of the report.
+ * @param dpin The input data for the DP report.
+ * @param dpvalid Receives the ids of the reported dps, room for dpin->dpscnt ids.
+ * @param buf Receives the dps json, dp_rept_json_size bytes are enough.
+ * @param buf_len The size of buf.
+ * @param timebuf Receives the time json of a T_STAT_REPT report, NULL if not needed.
+ * @param timebuf_len The size of timebuf, 30 bytes per dp are enough.
+ * @return Returns OPRT_OK on success, OPRT_SVC_DP_ID_NOT_FOUND if no dp needs
+ * to be reported, or another error code.
+ */
+int dp_rept_json_build(dp_schema_t *schema, dp_rept_in_t *dpin, dp_rept_valid_t *dpvalid, char *buf, size_t buf_len,
+                       char *timebuf, size_t timebuf_len);
+
+/**
+ * @brief Measures reports of 10, 50 and 100 dps and prints the results.
+ *
+ * Compares the two-pass dp_rept_valid_check and dp_rept_json_output with
+ * dp_rept_json_build, and the id index with a linear node search, on a
+ * synthetic schema. Available when ENABLE_DP_SCHEMA_BENCHMARK is defined.
+ *
+ * @param rounds The number of reports per measurement.
+ * @return Returns 0 on success, or a negative error code on failure.
+ */
+int dp_schema_benchmark(uint32_t rounds);
+
 /**
  * Appends a JSON string to the given data point schema.
  *
@@ -234,7 +234,7 @@ int tuya_iot_dp_obj_report(tuya_iot_client_t *client, const char *devid, dp_obj_
     if (NULL == dpvalid) {
         return OPRT_MALLOC_FAILED;
     }
-    memset(dpvalid, 0, sizeof(sizeof(dp_rept_valid_t) + sizeof(uint8_t) * dpscnt));
+    memset(dpvalid, 0, sizeof(dp_rept_valid_t) + sizeof(uint8_t) * dpscnt);
 
     PR_DEBUG("dp report: devid %s, dps 0x%08x, dpscnt %d, flags %d", devid ? devid : "null", dps, dpscnt, flags);
 
@@ -245,8 +245,17 @@ int tuya_iot_dp_obj_report(tuya_iot_client_t *client, const char *devid, dp_obj_
     dpin.flags = flags;
     dpin.rept_type = T_OBJ_REPT;
 
-    ret = dp_rept_valid_check(schema, &dpin, dpvalid);
+    size_t dpsjson_len = dp_rept_json_size(schema, &dpin);
+    char *dpsjson = tal_malloc(dpsjson_len);
+    if (NULL == dpsjson) {
+        tal_free(dpvalid);
+        return OPRT_MALLOC_FAILED;
+    }
+
+    // validate, diff against the cache and serialize in one pass
+    ret = dp_rept_json_build(schema, &dpin, dpvalid, dpsjson, dpsjson_len, NULL, 0);
     if (OPRT_OK != ret) {
+        tal_free(dpsjson);
         tal_free(dpvalid);
         return ret;
     }
@@ -258,6 +267,7 @@ int tuya_iot_dp_obj_report(tuya_iot_client_t *client, const char *devid, dp_obj_
 
         ble_dpin = tal_malloc(sizeof(dp_rept_in_t) + sizeof(dp_obj_t) * dpvalid->num);
         if (NULL == ble_dpin) {
+            tal_free(dpsjson);
             tal_free(dpvalid);
             return OPRT_MALLOC_FAILED;
         }
@@ -278,6 +288,7 @@ int tuya_iot_dp_obj_report(tuya_iot_client_t *client, const char *devid, dp_obj_
         PR_DEBUG("ble channel report");
         ret = tuya_ble_dp_report(ble_dpin);
         tal_free(ble_dpin);
+        tal_free(dpsjson);
         tal_free(dpvalid);
         tuya_iot_dp_sync_start(client, 5);
 
@@ -285,37 +296,22 @@ int tuya_iot_dp_obj_report(tuya_iot_client_t *client, const char *devid, dp_obj_
     }
 #endif
 
-    dp_rept_out_t dpout;
-
-    memset(&dpout, 0, sizeof(dpout));
-
-    ret = dp_rept_json_output(schema, &dpin, dpvalid, &dpout);
-    if (OPRT_OK != ret) {
-        PR_DEBUG("dp rept json output error %d", ret);
-        return ret;
-    }
-
     if (tuya_lan_is_connected()) {
         char *out = NULL;
         PR_DEBUG("lan channel report");
-        dp_rept_json_append(schema, dpout.dpsjson, NULL, NULL, 0, &out);
+        dp_rept_json_append(schema, dpsjson, NULL, NULL, 0, &out);
         ret = tuya_lan_dp_report(out);
         tal_free(out);
         tal_free(dpvalid);
         tuya_iot_dp_sync_start(client, 5);
     } else if (tuya_iot_is_connected()) {
         PR_DEBUG("mqtt channel report");
-        ret = tuya_iot_dp_report_json_with_notify(client, dpout.dpsjson, NULL, dp_sync_cb, dpvalid, 5000);
+        ret = tuya_iot_dp_report_json_with_notify(client, dpsjson, NULL, dp_sync_cb, dpvalid, 5000);
     } else {
         PR_ERR("no channel for connect");
     }
 
-    if (dpout.dpsjson) {
-        tal_free(dpout.dpsjson);
-    }
-    if (dpout.timejson) {
-        tal_free(dpout.timejson);
-    }
+    tal_free(dpsjson);
 
     return ret;
 }
@@ -191,6 +191,9 @@ typedef struct {
     int32_t is_replay;
     char start_time[32];
     char end_time[32];
+    uint64_t send_bytes;           // bytes sent on the ice transport, kcp header and signature included
+    uint32_t send_kbps;            // average send rate since the first packet
+    uint32_t send_cpu_us_per_mbit; // thread cpu time of encryption and kcp output per megabit sent
 } tuya_p2p_rtc_session_info_t;
 
 // tuya p2p sdk depends on several external services, implemented through callbacks or interfaces:
@@ -372,7 +375,7 @@ int32_t tuya_p2p_rtc_listen();
 // Interrupt listen, after calling this interface, tuya_p2p_rtc_listen returns failure immediately
 int32_t tuya_p2p_rtc_listen_break();
 // Get connection related information, used by device side, to determine if the corresponding connection is p2p
-// connection or webrtc connection
+// connection or webrtc connection, also reports the send throughput and its cpu cost
 int32_t tuya_p2p_rtc_get_session_info(int32_t handle, tuya_p2p_rtc_session_info_t *info);
 // Get session list
 // Returns json format string, need to call tuya_p2p_rtc_free_session_list to release
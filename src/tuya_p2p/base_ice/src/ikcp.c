@@ -170,18 +170,49 @@ void ikcp_allocator(void *(*new_malloc)(size_t), void (*new_free)(void *))
     ikcp_free_hook = new_free;
 }
 
-// allocate a new kcp segment
+// allocate a new kcp segment, segments up to mss are taken from the pool
 static IKCPSEG *ikcp_segment_new(ikcpcb *kcp, int size)
 {
-    return (IKCPSEG *)ikcp_malloc(sizeof(IKCPSEG) + size);
+    IKCPSEG *seg;
+    if (size <= (int)kcp->mss) {
+        if (!iqueue_is_empty(&kcp->seg_pool)) {
+            seg = iqueue_entry(kcp->seg_pool.next, IKCPSEG, node);
+            iqueue_del(&seg->node);
+            kcp->nseg_pool--;
+            return seg;
+        }
+        size = (int)kcp->mss;
+    }
+    seg = (IKCPSEG *)ikcp_malloc(sizeof(IKCPSEG) + size);
+    if (seg) {
+        seg->cap = size;
+    }
+    return seg;
 }
 
-// delete a segment
+// delete a segment, mss sized ones go back to the pool
 static void ikcp_segment_delete(ikcpcb *kcp, IKCPSEG *seg)
 {
+    if (seg->cap == kcp->mss && kcp->nseg_pool < IKCP_SEG_POOL_MAX) {
+        iqueue_add(&seg->node, &kcp->seg_pool);
+        kcp->nseg_pool++;
+        return;
+    }
     ikcp_free(seg);
 }
 
+// free the pooled segments
+static void ikcp_segment_pool_drain(ikcpcb *kcp)
+{
+    IKCPSEG *seg;
+    while (!iqueue_is_empty(&kcp->seg_pool)) {
+        seg = iqueue_entry(kcp->seg_pool.next, IKCPSEG, node);
+        iqueue_del(&seg->node);
+        ikcp_free(seg);
+    }
+    kcp->nseg_pool = 0;
+}
+
 // write log
 void ikcp_log(ikcpcb *kcp, int mask, const char *fmt, ...)
 {
@@ -268,6 +299,8 @@ ikcpcb *ikcp_create(IUINT32 conv, void *user)
     iqueue_init(&kcp->rcv_queue);
     iqueue_init(&kcp->snd_buf);
     iqueue_init(&kcp->rcv_buf);
+    iqueue_init(&kcp->seg_pool);
+    kcp->nseg_pool = 0;
     kcp->nrcv_buf = 0;
     kcp->nsnd_buf = 0;
     kcp->nrcv_que = 0;
@@ -326,6 +359,7 @@ void ikcp_release(ikcpcb *kcp)
             iqueue_del(&seg->node);
             ikcp_segment_delete(kcp, seg);
         }
+        ikcp_segment_pool_drain(kcp);
         if (kcp->buffer) {
             ikcp_free(kcp->buffer);
         }
@@ -1283,6 +1317,7 @@ int ikcp_setmtu(ikcpcb *kcp, int mtu)
         return -2;
     kcp->mtu = mtu;
     kcp->mss = kcp->mtu - IKCP_OVERHEAD;
+    ikcp_segment_pool_drain(kcp);
     ikcp_free(kcp->buffer);
     kcp->buffer = buffer;
     return 0;
@@ -251,6 +251,11 @@ typedef struct IQUEUEHEAD iqueue_head;
 #endif
 #endif
 
+// free mss sized segments kept by each kcp for reuse
+#ifndef IKCP_SEG_POOL_MAX
+#define IKCP_SEG_POOL_MAX 32
+#endif
+
 //=====================================================================
 // SEGMENT
 //=====================================================================
@@ -269,6 +274,7 @@ struct IKCPSEG {
     IUINT32 fastack;
     IUINT32 xmit;
     IUINT32 prepend;
+    IUINT32 cap; // size of data
     char data[1];
 };
 
@@ -291,6 +297,8 @@ struct IKCPCB {
     struct IQUEUEHEAD rcv_queue;
     struct IQUEUEHEAD snd_buf;
     struct IQUEUEHEAD rcv_buf;
+    struct IQUEUEHEAD seg_pool;
+    IUINT32 nseg_pool;
     IUINT32 *acklist;
     IUINT32 ackcount;
     IUINT32 ackblock;
@@ -566,12 +566,11 @@ bool pj_ice_session_sendto(pj_ice_session_t *pIceSession, void *pkt, uint32_t le
 
     pj_status_t status = PJ_FALSE;
     pj_ice_strans *ice_st = pIceSession->pIceSTransport;
-    char szLCandAddr[PJ_INET6_ADDRSTRLEN + 10] = {0};
-    char szRCandAddr[PJ_INET6_ADDRSTRLEN + 10] = {0};
     unsigned comp_id = 1; // Component starts with ID 1
     const pj_ice_sess_check *pIceSessCheck = pj_ice_strans_get_valid_pair(ice_st, comp_id);
-    pj_sockaddr_print(&pIceSessCheck->lcand->addr, szLCandAddr, sizeof(szLCandAddr), 3);
-    pj_sockaddr_print(&pIceSessCheck->rcand->addr, szRCandAddr, sizeof(szRCandAddr), 3);
+    if (pIceSessCheck == NULL) {
+        return false;
+    }
     status = pj_ice_strans_sendto2(ice_st, comp_id, pkt, len, &pIceSessCheck->rcand->addr,
                                    pj_sockaddr_get_len(&pIceSessCheck->rcand->addr));
     if (status != PJ_SUCCESS && status != PJ_EPENDING) {
@@ -579,3 +578,26 @@ bool pj_ice_session_sendto(pj_ice_session_t *pIceSession, void *pkt, uint32_t le
     }
     return true;
 }
+
+unsigned pj_ice_session_sendto_batch(pj_ice_session_t *pIceSession, const pj_ice_session_pkt_t pkts[], unsigned count)
+{
+    pj_thread_register2();
+
+    pj_ice_strans *ice_st = pIceSession->pIceSTransport;
+    unsigned comp_id = 1;
+    unsigned i;
+    // The pair and its address are resolved once for the whole batch
+    const pj_ice_sess_check *pIceSessCheck = pj_ice_strans_get_valid_pair(ice_st, comp_id);
+    if (pIceSessCheck == NULL) {
+        return 0;
+    }
+    const pj_sockaddr_t *rem_addr = &pIceSessCheck->rcand->addr;
+    int rem_addr_len = pj_sockaddr_get_len(rem_addr);
+    for (i = 0; i < count; i++) {
+        pj_status_t status = pj_ice_strans_sendto2(ice_st, comp_id, pkts[i].buf, pkts[i].len, rem_addr, rem_addr_len);
+        if (status != PJ_SUCCESS && status != PJ_EPENDING) {
+            break;
+        }
+    }
+    return i;
+}
@@ -25,6 +25,11 @@ typedef struct pj_ice_session_cfg {
 
 typedef struct pj_ice_session pj_ice_session_t;
 
+typedef struct pj_ice_session_pkt {
+    void *buf;
+    uint32_t len;
+} pj_ice_session_pkt_t;
+
 bool pj_thread_register2();
 int print_cand(char buffer[], unsigned maxlen, const pj_ice_sess_cand *cand);
 int parse_cand(pj_pool_t *pool, const pj_str_t *orig_input, pj_ice_sess_cand *cand);
@@ -35,6 +40,8 @@ bool pj_ice_session_init(pj_ice_session_t *pIceSession, pj_ice_session_cfg_t *pC
 bool pj_ice_session_add_remote_candidate(pj_ice_session_t *pIceSession, pj_str_t *rem_ufrag, pj_str_t *rem_passwd,
                                          unsigned rcand_cnt, pj_ice_sess_cand rcand[], pj_bool_t rcand_end);
 bool pj_ice_session_sendto(pj_ice_session_t *pIceSession, void *pkt, uint32_t len);
+// Send several packets to the nominated pair, returns the number of packets handed to the transport
+unsigned pj_ice_session_sendto_batch(pj_ice_session_t *pIceSession, const pj_ice_session_pkt_t pkts[], unsigned count);
 bool pj_ice_session_handle_events(pj_ice_session_t *pIceSession, unsigned max_msec, unsigned *p_count);
 
 #endif /* PJ_ICE_H_ */
\ No newline at end of file
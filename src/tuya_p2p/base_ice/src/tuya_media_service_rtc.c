@@ -40,6 +40,14 @@
 #define SRTP_MASTER_LENGTH            (SRTP_MASTER_KEY_LENGTH + SRTP_MASTER_SALT_LENGTH)
 #define ENCRYPT_MD5_LEN               16
 
+// kcp datagrams (mtu 1400 + hmac) kept by the worker and sent to ice in one batch
+#ifndef RTC_OUTPUT_BATCH_NUM
+#define RTC_OUTPUT_BATCH_NUM 16
+#endif
+#define RTC_OUTPUT_PKT_SIZE 1500
+// fragments encrypted by a sender for each channel_lock hold
+#define RTC_SEND_BATCH_NUM 8
+
 // CMD is transmitted using kcp's channel number field, and kcp uses little endian
 #define RTC_CHANNEL_CMD   (0x010000F3)
 #define RTC_CMD_SIGNALING (0x0001)
@@ -244,6 +252,21 @@ typedef struct tuya_p2p_rtc_session {
     pj_ice_session_t *pIce;
     pthread_t tid;
     bool bQuitKCPThread;
+
+    // kcp output of one worker pass, sent to ice in one batch
+    struct {
+        uint32_t num;
+        pj_ice_session_pkt_t pkt[RTC_OUTPUT_BATCH_NUM];
+        char data[RTC_OUTPUT_BATCH_NUM][RTC_OUTPUT_PKT_SIZE];
+    } out_batch;
+
+    struct {
+        uint64_t bytes;
+        uint64_t first_ms;
+        uint64_t last_ms;
+        uint64_t enc_cpu_us; // senders, under channel_lock
+        uint64_t out_cpu_us; // worker thread
+    } send_stat;
 } tuya_p2p_rtc_session_t;
 
 tuya_p2p_rtc_options_t g_options;
@@ -1228,13 +1251,49 @@ void rtc_process_kcp_data(tuya_p2p_rtc_session_t *rtc, const tuya_uv_buf_t *pkt)
         }
     }
 
+    pthread_mutex_lock(&rtc->channel_lock);
     ctx_session_channel_process_data(chan, pkt->base, pkt->len - digest_len);
+    pthread_mutex_unlock(&rtc->channel_lock);
 
     return;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////
 
+static uint64_t rtc_thread_cpu_us(void)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Send the queued kcp output, only called on the worker thread
+static void rtc_output_flush(tuya_p2p_rtc_session_t *rtc)
+{
+    uint32_t i, sent;
+    uint64_t bytes = 0;
+
+    if (rtc->out_batch.num == 0) {
+        return;
+    }
+    sent = pj_ice_session_sendto_batch(rtc->pIce, rtc->out_batch.pkt, rtc->out_batch.num);
+    for (i = 0; i < sent; i++) {
+        bytes += rtc->out_batch.pkt[i].len;
+    }
+    rtc->out_batch.num = 0;
+
+    if (bytes > 0) {
+        uint64_t now = tuya_p2p_misc_get_timestamp_ms();
+        if (rtc->send_stat.first_ms == 0) {
+            rtc->send_stat.first_ms = now;
+        }
+        rtc->send_stat.last_ms = now;
+        rtc->send_stat.bytes += bytes;
+    }
+}
+
 static int on_kcp_output(const char *buf, int len, ikcpcb *kcp, void *user_data)
 {
     (void)kcp;
@@ -1246,32 +1305,46 @@ static int on_kcp_output(const char *buf, int len, ikcpcb *kcp, void *user_data)
 
     int md_size = 0;
     if (rtc->cfg.security_level == TUYA_P2P_SECURITY_LEVEL_3) {
+        md_size = mbedtls_md_get_size(rtc->md_info);
+    }
+
+    ctx_session_channel_set_send_time(chan);
+    uint32_t channel_id = ikcp_getconv(buf);
+    unsigned char cmd = ikcp_getcmd(buf);
+    // tuya_p2p_log_trace("channel_id: %08x, sn: %d, cmd: %d\n", channel_id, ikcp_getsn(buf), cmd);
+
+    if (cmd == KCP_CMD_PUSH && channel_id == RTC_CHANNEL_CMD) {
+        chan->socket_send_bytes += (len + md_size);
+        return len;
+    }
+    if (len + md_size > RTC_OUTPUT_PKT_SIZE) {
+        return 0;
+    }
+
+    // kcp reuses buf for the next datagram, queue a copy and sign it in place
+    if (rtc->out_batch.num == RTC_OUTPUT_BATCH_NUM) {
+        rtc_output_flush(rtc);
+    }
+    char *pkt = rtc->out_batch.data[rtc->out_batch.num];
+    memcpy(pkt, buf, len);
+    if (md_size > 0) {
         int ret;
         ret = mbedtls_md_hmac_starts(&rtc->md_ctx, rtc->aes_key, sizeof(rtc->aes_key));
         if (ret != 0) {
             return 0;
         }
-        ret = mbedtls_md_hmac_update(&rtc->md_ctx, (unsigned char *)buf, len);
+        ret = mbedtls_md_hmac_update(&rtc->md_ctx, (unsigned char *)pkt, len);
         if (ret != 0) {
             return 0;
         }
-        ret = mbedtls_md_hmac_finish(&rtc->md_ctx, (unsigned char *)buf + len);
+        ret = mbedtls_md_hmac_finish(&rtc->md_ctx, (unsigned char *)pkt + len);
         if (ret != 0) {
             return 0;
         }
-        md_size = mbedtls_md_get_size(rtc->md_info);
-    }
-
-    ctx_session_channel_set_send_time(chan);
-    uint32_t r = (rand() % 99) + 1;
-    uint32_t channel_id = ikcp_getconv(buf);
-    unsigned char cmd = ikcp_getcmd(buf);
-    uint32_t sn = ikcp_getsn(buf);
-    // tuya_p2p_log_trace("channel_id: %08x, sn: %d, cmd: %d\n", channel_id, sn, cmd);
-
-    if (cmd != KCP_CMD_PUSH || channel_id != RTC_CHANNEL_CMD) {
-        pj_ice_session_sendto(rtc->pIce, (void *)buf, len + md_size);
     }
+    rtc->out_batch.pkt[rtc->out_batch.num].buf = pkt;
+    rtc->out_batch.pkt[rtc->out_batch.num].len = len + md_size;
+    rtc->out_batch.num++;
 
     chan->socket_send_bytes += (len + md_size);
     return len;
@@ -1546,12 +1619,18 @@ void *rtc_worker_thread(void *arg)
     tuya_p2p_rtc_session_t *rtc = (tuya_p2p_rtc_session_t *)arg;
     while (!rtc->bQuitKCPThread) {
         pj_ice_session_handle_events(rtc->pIce, 5, NULL); // Drive ICE state update and execute KCP receive operation
-        for (int i = 0; i < 3; ++i)                        //(rtc->cfg.channel_number + 1)
+        uint64_t cpu_begin = rtc_thread_cpu_us();
+        uint32_t now = tuya_p2p_misc_get_timestamp_ms();
+        // kcp segments are pooled per channel, senders and the worker share them under channel_lock
+        pthread_mutex_lock(&rtc->channel_lock);
+        for (int i = 0; i < 3; ++i) //(rtc->cfg.channel_number + 1)
         {
             rtc_channel_t *channel = &rtc->channels[i];
-            ikcp_update(channel->kcp,
-                        tuya_p2p_misc_get_timestamp_ms()); // Drive KCP state update and execute KCP send operation
+            ikcp_update(channel->kcp, now); // Drive KCP state update and queue the KCP output
         }
+        pthread_mutex_unlock(&rtc->channel_lock);
+        rtc_output_flush(rtc);
+        rtc->send_stat.out_cpu_us += rtc_thread_cpu_us() - cpu_begin;
     }
     return NULL;
 }
@@ -1609,61 +1688,53 @@ int32_t tuya_p2p_rtc_dosend_data(tuya_p2p_rtc_session_t *rtc, uint32_t channel_i
         // }
 
         int fragement_len = 1200;
-        int current = (remain > fragement_len) ? (fragement_len) : remain;
         char decrypted[1500];
-        char *encrypted;
+        char encrypted[1500 + 16 + 16];
         int iv_size = sizeof(rtc->iv);
         int keylen = 16;
         int sign_size = 0;
-        unsigned char padding_size = keylen;
-        int reserve_len_forkcp = sizeof(struct IKCPSEG) + IKCP_PACKET_HEADER_SIZE;
-        /* 60 bytes prepared for signature */
-        int reserve_len = sizeof(struct IKCPSEG) + IKCP_PACKET_HEADER_SIZE + sizeof(rtc->iv) + 60;
-        int buflen;
+        int n;
+        uint64_t cpu_begin = rtc_thread_cpu_us();
 
-        buflen = current;
-        memcpy(decrypted, buf + already, buflen);
+        // GCM encryption automatically generates 16-byte signature
+        if (rtc->cfg.security_level == TUYA_P2P_SECURITY_LEVEL_4) {
+            sign_size = 16;
+        }
 
-        padding_size -= (buflen % keylen);
-        memset(&(decrypted[buflen]), padding_size, padding_size);
+        // Encrypt a run of fragments per lock hold, each one is queued to kcp straight from the stack
+        for (n = 0; n < RTC_SEND_BATCH_NUM && remain > 0; n++) {
+            int current = (remain > fragement_len) ? (fragement_len) : remain;
+            unsigned char padding_size = keylen;
+            int buflen;
 
-        buflen += padding_size;
+            buflen = current;
+            memcpy(decrypted, buf + already, buflen);
 
-        /* Reserved length for control header and kcp packet header needed for kcp chaining */
-        // tuya_mbuf_t *mbuf_encrypted = tuya_mbuf_alloc(chan->send_queue, buflen + reserve_len, reserve_len_forkcp);
-        // if (NULL == mbuf_encrypted) {
-        //     pthread_mutex_unlock(&rtc->channel_lock);
-        //     /* This step will not fail unless out of memory, this step failure also means connection abnormal,
-        //     because the packet just taken down has not been added to the kcp queue */ break;
-        // } else {
-        //     encrypted = TUYA_MBUF_MTOD(mbuf_encrypted);
-        // }
-        encrypted = (char *)malloc(buflen + reserve_len);
-        char tmp_iv[16];
-        tuya_p2p_misc_rand_hex(tmp_iv, sizeof(rtc->iv));
-        memcpy(encrypted, tmp_iv, iv_size);
+            padding_size -= (buflen % keylen);
+            memset(&(decrypted[buflen]), padding_size, padding_size);
 
-        int ret = rtc_crypt_encrypt_aes_128_cbc(rtc, chan->aes_ctx_enc, buflen, (unsigned char *)tmp_iv,
-                                                (const unsigned char *)decrypted, (unsigned char *)encrypted + iv_size);
+            buflen += padding_size;
 
-        // GCM encryption automatically generates 16-byte signature
-        if (rtc->cfg.security_level == TUYA_P2P_SECURITY_LEVEL_4) {
-            sign_size = 16;
-        }
+            char tmp_iv[16];
+            tuya_p2p_misc_rand_hex(tmp_iv, sizeof(rtc->iv));
+            memcpy(encrypted, tmp_iv, iv_size);
 
-        if (ret == 0) {
-            // ikcp_send_mbuf(chan->kcp, mbuf_encrypted, buflen + iv_size + sign_size);
+            int ret = rtc_crypt_encrypt_aes_128_cbc(rtc, chan->aes_ctx_enc, buflen, (unsigned char *)tmp_iv,
+                                                    (const unsigned char *)decrypted,
+                                                    (unsigned char *)encrypted + iv_size);
+            if (ret != 0) {
+                tuya_p2p_log_error("aes encrypt failed, ret = %d\n", ret);
+                rc = -1;
+                break;
+            }
             ikcp_send(chan->kcp, encrypted, buflen + iv_size + sign_size);
             remain -= current;
             already += current;
             chan->write_bytes += current;
-            free(encrypted);
-        } else {
+        }
+        rtc->send_stat.enc_cpu_us += rtc_thread_cpu_us() - cpu_begin;
+        if (rc < 0) {
             pthread_mutex_unlock(&rtc->channel_lock);
-            tuya_p2p_log_error("aes encrypt failed, ret = %d\n", ret);
-            // tuya_mbuf_free(mbuf_encrypted);
-            free(encrypted);
-            rc = -1;
             break;
         }
         pthread_mutex_unlock(&rtc->channel_lock);
@@ -2016,6 +2087,28 @@ int32_t tuya_p2p_rtc_listen_break()
 
 int32_t tuya_p2p_rtc_get_session_info(int32_t handle, tuya_p2p_rtc_session_info_t *info)
 {
+    if (info == NULL) {
+        return TUYA_P2P_ERROR_INVALID_PARAMETER;
+    }
+    tal_mutex_lock(g_p2p_session_mutex);
+    tuya_p2p_rtc_session_t *rtc = g_pRtcSession;
+    if (rtc == NULL) {
+        tal_mutex_unlock(g_p2p_session_mutex);
+        return TUYA_P2P_ERROR_INVALID_SESSION_HANDLE;
+    }
+    info->handle = handle;
+    info->send_bytes = rtc->send_stat.bytes;
+    info->send_kbps = 0;
+    info->send_cpu_us_per_mbit = 0;
+    if (rtc->send_stat.last_ms > rtc->send_stat.first_ms) {
+        // bits per millisecond is kbit per second
+        info->send_kbps = (uint32_t)(rtc->send_stat.bytes * 8 / (rtc->send_stat.last_ms - rtc->send_stat.first_ms));
+    }
+    if (rtc->send_stat.bytes > 0) {
+        uint64_t cpu_us = rtc->send_stat.enc_cpu_us + rtc->send_stat.out_cpu_us;
+        info->send_cpu_us_per_mbit = (uint32_t)(cpu_us * 1000000 / (rtc->send_stat.bytes * 8));
+    }
+    tal_mutex_unlock(g_p2p_session_mutex);
     return 0;
 }
 
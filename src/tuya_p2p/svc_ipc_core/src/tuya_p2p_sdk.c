@@ -14,6 +14,10 @@
 #define PRE_TOPIC     "smart/device/in/"
 #define MQ_SERV_TOPIC "smart/device/out/"
 
+#ifndef TUYA_P2P_MAX_CLIENT_NUM
+#define TUYA_P2P_MAX_CLIENT_NUM 2
+#endif
+
 VOID tuya_ipc_upload_skills(VOID);
 OPERATE_RET gw_active_set_ext_param(IN CHAR_T *param);
 CHAR_T *gw_active_get_ext_param(VOID);
@@ -35,7 +39,7 @@ OPERATE_RET TUYA_APP_Start(TUYA_IPC_SDK_VAR_S *pSdkVar)
 
     // Initialize P2P component
     MEDIA_STREAM_VAR_T stream_var = {0};
-    stream_var.max_client_num = 1;
+    stream_var.max_client_num = TUYA_P2P_MAX_CLIENT_NUM;
     stream_var.def_live_mode = TRANS_DEFAULT_STANDARD;
     stream_var.recv_buffer_size = 16 * 1024;
     INT_T preconnect = stream_var.low_power ? 0 : 1;
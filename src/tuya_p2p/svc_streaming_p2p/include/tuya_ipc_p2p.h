@@ -75,6 +75,12 @@ OPERATE_RET p2p_rtc_listen_stop();
 // OPERATE_RET tuya_ipc_init_trans_av_info(TRANS_IPC_AV_INFO_T *av_info);
 OPERATE_RET tuya_p2p_rtc_register_get_video_frame_cb(tuya_p2p_rtc_get_frame_cb_t pCallback);
 OPERATE_RET tuya_p2p_rtc_register_get_audio_frame_cb(tuya_p2p_rtc_get_frame_cb_t pCallback);
+// called by the media producer when a frame can be taken with the get frame callbacks,
+// the media pump then sleeps until notified instead of polling the callbacks every 10ms
+OPERATE_RET tuya_p2p_rtc_notify_frame_ready(VOID);
+// packetize synthetic h264 frames once and fan them out to viewers draining at different rates,
+// checks that slow viewers only resume at key frames; needs ENABLE_P2P_FANOUT_LOOPBACK, call it before p2p_init
+OPERATE_RET tuya_p2p_rtc_fanout_loopback(UINT_T viewers, UINT_T frames);
 INT_T OnGetVideoFrameCallback(MEDIA_FRAME *pMediaFrame);
 INT_T OnGetAudioFrameCallback(MEDIA_FRAME *pMediaFrame);
 
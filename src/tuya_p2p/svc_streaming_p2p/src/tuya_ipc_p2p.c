@@ -10,6 +10,7 @@
 #include "tal_system.h"
 #include "tal_memory.h"
 #include "tal_thread.h"
+#include "tal_semaphore.h"
 #include "tuya_ipc_p2p.h"
 #include "tuya_ipc_p2p_error.h"
 #include "tuya_ipc_p2p_inner.h"
@@ -33,6 +34,11 @@
 #define P2P_RECV_TIMEOUT            (30)
 
 #define P2P_CHECK_USER_TIMES (10000) // 10s
+
+// media pump wait without a frame, the producer wakes it with tuya_p2p_rtc_notify_frame_ready
+#define P2P_MEDIA_IDLE_WAIT_MS (100)
+// frame poll period for producers that never notify
+#define P2P_MEDIA_POLL_MS (10)
 // Password synchronization structure
 typedef struct P2P_CMD_PASSWD_ {
     int mark;        // Custom identification mark
@@ -73,13 +79,65 @@ typedef struct P2P_CMD_PARSE_ {
 #define STACK_SIZE_P2P_DETECT     65536
 #define STACK_SIZE_P2P_LISTEN     131072
 
+// Viewer sessions served at the same time, the p2p var max_client_num is capped to it
+#ifndef P2P_SESSION_MAX
+#define P2P_SESSION_MAX (4)
+#endif
+// kcp send, one segment occupies 1600 bytes
+#define P2P_KCP_SEG_SIZE (1600)
+// a viewer with more unsent rtp bytes than this skips to the next key frame
+#ifndef P2P_VIEWER_LAG_BYTES
+#define P2P_VIEWER_LAG_BYTES (256 * 1024)
+#endif
+
+typedef struct P2P_RTP_PKT {
+    struct P2P_RTP_PKT *next;
+    UINT_T ref;       // viewers that have not sent or skipped it yet
+    BYTE_T type;      // 0/1 video/audio
+    BOOL_T key;       // packet of a key frame
+    BOOL_T start;     // first packet of a frame
+    BOOL_T queued;    // in the fan-out list, the last viewer frees it
+    UINT64_T time_ms; // frame absolute time (ms)
+    INT_T len;
+    CHAR_T data[0]; // rtp packet
+} P2P_RTP_PKT_T;
+
+#define P2P_RTP_PKT_OF(packet) ((P2P_RTP_PKT_T *)((CHAR_T *)(packet) - OFFSET(P2P_RTP_PKT_T, data)))
+
 typedef struct {
-    INT_T client;
-    INT_T channel;
-    CHAR_T *p_rtp_buff;                         // RTP data buffer, reference size MTU+100
-    INT_T fix_len;                              // Supplementary private header data
-    CHAR_T ext_head_buff[P2P_EXT_HEAD_MAX_LEN]; // According to extended video header protocol head+ext(8)+rtp_len
-} RTP_PACK_NAL_ARG_T;
+    BOOL_T attached;
+    BOOL_T wait_key;       // skip video until the next key frame
+    UINT_T gen;            // session generation the viewer was attached for
+    P2P_RTP_PKT_T *cursor; // next packet to send, NULL when caught up
+    UINT_T backlog;        // rtp bytes from cursor to the tail of the list
+    UINT_T sent;           // packets sent
+    UINT_T dropped;        // packets skipped because the viewer fell behind
+} P2P_VIEWER_T;
+
+/*
+ * Every frame is packetized once into a list of reference counted rtp
+ * packets. Each viewer walks the list with its own cursor, the last one
+ * passing a packet frees it. Only the media thread touches the list.
+ */
+typedef struct {
+    P2P_RTP_PKT_T *head;
+    P2P_RTP_PKT_T *tail;
+    UINT_T bytes; // rtp bytes in the list
+    UINT_T readers;
+    P2P_VIEWER_T *viewers[P2P_SESSION_MAX];
+    // attributes of the frame being packetized
+    BYTE_T type;
+    BOOL_T key;
+    BOOL_T start;
+    UINT64_T time_ms;
+    CHAR_T buff[P2P_RTP_PACK_LEN]; // ext head + rtp packet being sent
+} P2P_FANOUT_T;
+
+typedef struct {
+    VOID *encoder; // RTP packetizer kept across frames
+    INT_T payload; // RTP payload type the packetizer was created for
+    USHORT_T seq;  // RTP packet sequence number
+} P2P_RTP_STREAM_T;
 
 typedef enum {
     P2P_IDLE = 0,
@@ -100,41 +158,50 @@ typedef struct {
 
 typedef struct {
     MUTEX_HANDLE cmutex;
-    TUYA_IPC_P2P_AUTH_T str_P2p_auth;
+    INT_T index; // Slot in the session table
+    UINT_T gen;  // Bumped when the session is released
     /*******client*******/
     INT_T session; // Save session number
     INT_T status;  // Session status  0 not started
     /*******p2p server*******/
     P2P_CMD_E cmd; // Signal status information
     P2P_CMD_PARSE_T pb_resp_head;
-    CHAR_T *p_video_rtp_buff; // Video RTP data buffer, reference size MTU+100
-    CHAR_T *p_audio_rtp_buff; // Audio RTP data buffer, reference size MTU+100
-    USHORT_T video_seq_num;   // Video RTP packet sequence number
-    USHORT_T audio_seq_num;   // Audio RTP packet sequence number
-    BOOL_T key_frame;
-    UINT64_T v_pts;                                  // Video PTS
-    UINT64_T v_timestamp;                            // Video absolute time (ms)
-    UINT64_T a_pts;                                  // Audio PTS
-    UINT64_T a_timestamp;                            // Audio absolute time (ms)
     INT_T video_req_id;                              // Video request ID, used for preview, playback and other services
     INT_T audio_req_id;                              // Audio request ID
     TRANSFER_VIDEO_CLARITY_TYPE_INNER_E cur_clarity; // Current video clarity type
     P2P_DATA_PARSE_T proto_parse;
+    THREAD_HANDLE cmd_recv_proc_thread; // Command receive thread handle
+    P2P_VIEWER_T viewer;                // Fan-out state, owned by the media thread
+    /******* p2p server*******/
+} P2P_SESSION_T;
+
+typedef struct {
+    INT_T (*free_size)(P2P_SESSION_T *pSession, INT_T channel);
+    INT_T (*send)(P2P_SESSION_T *pSession, INT_T channel, CHAR_T *buff, INT_T len);
+} P2P_VIEWER_IO_T;
+
+typedef struct {
+    TUYA_IPC_P2P_AUTH_T str_P2p_auth;
     TRANS_IPC_AV_INFO_T av_Info; // TODO currently video parameters must be consistent
 
     tuya_p2p_rtc_disconnect_cb_t on_disconnect_callback;
     tuya_p2p_rtc_get_frame_cb_t on_get_video_frame_callback;
     tuya_p2p_rtc_get_frame_cb_t on_get_audio_frame_callback;
-    THREAD_HANDLE cmd_recv_proc_thread;   // Command receive thread handle
     THREAD_HANDLE video_send_proc_thread; // Video send thread handle
     // TAL_VENC_FRAME_T tal_video_frame;
     // TAL_AUDIO_FRAME_INFO_T tal_audio_frame;
     MEDIA_FRAME media_frame;
     MEDIA_FRAME media_audio_frame;
-    /******* p2p server*******/
-} P2P_SESSION_T;
-
-STATIC P2P_SESSION_T *sg_p2p_session = NULL;
+    SEM_HANDLE frame_sem; // posted when a frame is ready or the media pump has new work
+    BOOL_T frame_notify;  // the producer notifies frames, no need to poll the frame callbacks
+    P2P_RTP_STREAM_T video_rtp;
+    P2P_RTP_STREAM_T audio_rtp;
+    P2P_FANOUT_T fanout;
+    INT_T session_num;
+    P2P_SESSION_T *sessions;
+} P2P_MGR_T;
+
+STATIC P2P_MGR_T *sg_p2p_mgr = NULL;
 INT_T g_listen_start = 0;               // Flag variable to control listen thread start or stop
 THREAD_HANDLE g_listen_thrd_hdl = NULL; // Listen thread handle
 
@@ -142,10 +209,6 @@ OPERATE_RET p2p_deal_with_listen(INT_T session);
 OPERATE_RET p2p_get_userinfo(INT_T session, INT_T p2pType);
 IPC_STREAM_TYPE p2p_get_chn_idx(TRANSFER_VIDEO_CLARITY_TYPE_INNER_E cur_clarity);
 TRANSFER_VIDEO_CLARITY_TYPE p2p_clarity_trans(TRANSFER_VIDEO_CLARITY_TYPE_INNER_E type);
-INT_T p2p_prepare_video_send_resource(P2P_SESSION_T *pSession);
-INT_T p2p_release_video_send_resource(P2P_SESSION_T *pSession);
-INT_T p2p_prepare_audio_send_resource(P2P_SESSION_T *pSession);
-INT_T p2p_release_audio_send_resource(P2P_SESSION_T *pSession);
 INT_T __p2p_session_clear(P2P_SESSION_T *pSession);
 INT_T __p2p_session_all_stop(P2P_SESSION_T *pSession);
 INT_T __p2p_session_release_va(P2P_SESSION_T *pSession);
@@ -206,25 +269,46 @@ OPERATE_RET p2p_rtc_listen_stop()
 
 P2P_SESSION_T *p2p_get_idle_session(INT_T *index)
 {
-    INT_T status = -1;
     INT_T i;
-    if (sg_p2p_session == NULL)
+    P2P_SESSION_T *pSession = NULL;
+    if (sg_p2p_mgr == NULL)
         return NULL;
     PR_DEBUG("p2p_get_idle_session begin\n");
-    status = sg_p2p_session->status;
-    if (P2P_SESSION_IDLE == status) {
-        *index = i;
-        sg_p2p_session->status = P2P_SESSION_INITING;
-        return sg_p2p_session;
+    for (i = 0; i < sg_p2p_mgr->session_num; i++) {
+        pSession = &sg_p2p_mgr->sessions[i];
+        tal_mutex_lock(pSession->cmutex);
+        if (P2P_SESSION_IDLE == pSession->status) {
+            pSession->status = P2P_SESSION_INITING;
+            tal_mutex_unlock(pSession->cmutex);
+            *index = i;
+            return pSession;
+        }
+        tal_mutex_unlock(pSession->cmutex);
     }
     PR_DEBUG("p2p_get_idle_session end\n");
     return NULL;
 }
 
+STATIC VOID __p2p_session_set_status(P2P_SESSION_T *pSession, INT_T status)
+{
+    tal_mutex_lock(pSession->cmutex);
+    pSession->status = status;
+    tal_mutex_unlock(pSession->cmutex);
+}
+
 OPERATE_RET p2p_deal_with_listen(INT_T session)
 {
-    OPERATE_RET ret = OPRT_OK;
     BOOL_T userCheckEnable = FALSE;
+    INT_T index = -1;
+    P2P_SESSION_T *pSession = NULL;
+
+    // Each viewer takes a session slot, refuse the connection when all of them are in use
+    pSession = p2p_get_idle_session(&index);
+    if (NULL == pSession) {
+        PR_ERR("no idle session for [%d]", session);
+        __p2p_rtc_close(session, RTC_CLOSE_REASON_SESSION_FULL, NULL);
+        return OPRT_COM_ERROR;
+    }
 
     // First verify user information, close corresponding session if not qualified
     if (OPRT_OK != p2p_get_userinfo(session, 1)) {
@@ -234,33 +318,28 @@ OPERATE_RET p2p_deal_with_listen(INT_T session)
         if (FALSE == userCheckEnable) {
             PR_ERR("resend p2p passwd to service");
             // Resend passwd once
-            if (OPRT_OK == tuya_ipc_p2p_update_pw(sg_p2p_session->str_P2p_auth.p2p_passwd)) {
+            if (OPRT_OK == tuya_ipc_p2p_update_pw(sg_p2p_mgr->str_P2p_auth.p2p_passwd)) {
                 userCheckEnable = TRUE;
             }
         }
+        // Only this viewer is refused, the others keep their sessions
+        __p2p_session_set_status(pSession, P2P_SESSION_IDLE);
         __p2p_rtc_close(session, RTC_CLOSE_REASON_AUTH_FAIL, NULL);
-        tuya_p2p_rtc_notify_exit();
-        tuya_p2p_rtc_deinit();
         return OPRT_COM_ERROR;
     } else {
         // Once verification is successful, no more authentication exception handling
         userCheckEnable = TRUE;
     }
 
-    // Request session-related resources
-    if (OPRT_OK != (ret = p2p_prepare_video_send_resource(sg_p2p_session))) {
-        goto RET;
-    }
-    if (OPRT_OK != (ret = p2p_prepare_audio_send_resource(sg_p2p_session))) {
-        goto RET;
-    }
-
     // Save connection information
-    sg_p2p_session->session = session;
-    sg_p2p_session->status = P2P_SESSION_RUNNING;
+    tal_mutex_lock(pSession->cmutex);
+    pSession->session = session;
+    pSession->status = P2P_SESSION_RUNNING;
+    tal_mutex_unlock(pSession->cmutex);
+    tal_semaphore_post(sg_p2p_mgr->frame_sem);
+    PR_DEBUG("session[%d] takes slot[%d]", session, index);
 
-RET:
-    return ret;
+    return OPRT_OK;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -335,11 +414,11 @@ OPERATE_RET p2p_get_userinfo(INT_T session, INT_T p2pType)
     tal_md5_create_init(&md5);
     tal_md5_starts_ret(md5);
     unsigned char decrypt[16];
-    tal_md5_update_ret(md5, (BYTE_T *)(sg_p2p_session->str_P2p_auth.p2p_passwd),
-                       strlen(sg_p2p_session->str_P2p_auth.p2p_passwd));
+    tal_md5_update_ret(md5, (BYTE_T *)(sg_p2p_mgr->str_P2p_auth.p2p_passwd),
+                       strlen(sg_p2p_mgr->str_P2p_auth.p2p_passwd));
     tal_md5_update_ret(md5, (BYTE_T *)"||", 2);
-    tal_md5_update_ret(md5, (BYTE_T *)(sg_p2p_session->str_P2p_auth.gw_local_key),
-                       strlen(sg_p2p_session->str_P2p_auth.gw_local_key));
+    tal_md5_update_ret(md5, (BYTE_T *)(sg_p2p_mgr->str_P2p_auth.gw_local_key),
+                       strlen(sg_p2p_mgr->str_P2p_auth.gw_local_key));
     tal_md5_finish_ret(md5, decrypt);
     tal_md5_free(md5);
 
@@ -351,7 +430,7 @@ OPERATE_RET p2p_get_userinfo(INT_T session, INT_T p2pType)
     }
     sign[offset] = 0;
 
-    if (strcmp(strUserInfo.user, sg_p2p_session->str_P2p_auth.p2p_name) == 0 && strcmp(strUserInfo.passwd, sign) == 0) {
+    if (strcmp(strUserInfo.user, sg_p2p_mgr->str_P2p_auth.p2p_name) == 0 && strcmp(strUserInfo.passwd, sign) == 0) {
         PR_DEBUG("auth success");
         return OPRT_OK;
     }
@@ -359,8 +438,8 @@ OPERATE_RET p2p_get_userinfo(INT_T session, INT_T p2pType)
     CHAR_T lk_dm5[32 + 1] = {0};
     tal_md5_create_init(&md5);
     tal_md5_starts_ret(md5);
-    tal_md5_update_ret(md5, (BYTE_T *)(sg_p2p_session->str_P2p_auth.gw_local_key),
-                       strlen(sg_p2p_session->str_P2p_auth.gw_local_key));
+    tal_md5_update_ret(md5, (BYTE_T *)(sg_p2p_mgr->str_P2p_auth.gw_local_key),
+                       strlen(sg_p2p_mgr->str_P2p_auth.gw_local_key));
     tal_md5_finish_ret(md5, decrypt);
     tal_md5_free(md5);
     offset = 0;
@@ -430,99 +509,21 @@ TRANSFER_VIDEO_CLARITY_TYPE p2p_clarity_trans(TRANSFER_VIDEO_CLARITY_TYPE_INNER_
     return eVideoClarityHigh;
 }
 
-INT_T p2p_prepare_video_send_resource(P2P_SESSION_T *pSession)
-{
-    if (pSession == NULL) {
-        PR_DEBUG("session is NULL");
-        return OPRT_INVALID_PARM;
-    }
-
-    if (NULL != pSession->p_video_rtp_buff) {
-        return OPRT_OK;
-    }
-
-    pSession->p_video_rtp_buff = (CHAR_T *)Malloc(P2P_RTP_PACK_LEN);
-    if (NULL == pSession->p_video_rtp_buff) {
-        PR_ERR("session:[%d] video rtp buffer malloc failed", pSession->session);
-        return OPRT_MALLOC_FAILED;
-    }
-    memset(pSession->p_video_rtp_buff, 0x00, P2P_RTP_PACK_LEN);
-
-    PR_DEBUG("session:[%d] malloc video send buffer success", pSession->session);
-    return OPRT_OK;
-}
-
-INT_T p2p_release_video_send_resource(P2P_SESSION_T *pSession)
-{
-    if (pSession == NULL) {
-        PR_DEBUG("session is NULL");
-        return OPRT_INVALID_PARM;
-    }
-
-    if (NULL == pSession->p_video_rtp_buff) {
-        return OPRT_OK;
-    }
-
-    Free(pSession->p_video_rtp_buff);
-    pSession->p_video_rtp_buff = NULL;
-
-    PR_DEBUG("session:[%d] release video send buffer success", pSession->session);
-    return OPRT_OK;
-}
-
-INT_T p2p_prepare_audio_send_resource(P2P_SESSION_T *pSession)
-{
-    if (pSession == NULL) {
-        PR_DEBUG("session is NULL");
-        return OPRT_INVALID_PARM;
-    }
-
-    if (NULL != pSession->p_audio_rtp_buff) {
-        return OPRT_OK;
-    }
-
-    pSession->p_audio_rtp_buff = (CHAR_T *)Malloc(P2P_RTP_PACK_LEN);
-    if (NULL == pSession->p_audio_rtp_buff) {
-        PR_ERR("session:[%d] audio rtp buffer malloc failed", pSession->session);
-        return OPRT_MALLOC_FAILED;
-    }
-    memset(pSession->p_audio_rtp_buff, 0x00, P2P_RTP_PACK_LEN);
-
-    PR_DEBUG("session:[%d] malloc audio send buffer success", pSession->session);
-    return OPRT_OK;
-}
-
-INT_T p2p_release_audio_send_resource(P2P_SESSION_T *pSession)
-{
-    if (pSession == NULL) {
-        PR_DEBUG("session is NULL");
-        return OPRT_INVALID_PARM;
-    }
-
-    if (NULL == pSession->p_audio_rtp_buff) {
-        return OPRT_OK;
-    }
-
-    Free(pSession->p_audio_rtp_buff);
-    pSession->p_audio_rtp_buff = NULL;
-
-    PR_DEBUG("session:[%d] release audio send buffer success", pSession->session);
-    return OPRT_OK;
-}
-
 OPERATE_RET p2p_send_rtp_data(INT_T client, INT_T channel, CHAR_T *buff, INT_T length)
 {
-    if (channel < TUYA_VDATA_CHANNEL || channel > TUYA_ADATA_CHANNEL) {
+    if (channel < TUYA_VDATA_CHANNEL || channel > TUYA_ADATA_CHANNEL || NULL == sg_p2p_mgr || client < 0 ||
+        client >= sg_p2p_mgr->session_num) {
         PR_ERR("input errorclient[%d]channel[%d]", client, channel);
         return OPRT_INVALID_PARM;
     }
     INT_T ret = 0;
+    P2P_SESSION_T *pSession = &sg_p2p_mgr->sessions[client];
     // Send data
-    if ((0 == (P2P_VIDEO & sg_p2p_session->cmd)) && (0 == (P2P_PB_VIDEO & sg_p2p_session->cmd)) &&
-        (0 == (P2P_AUDIO & sg_p2p_session->cmd)) && (0 == (P2P_PB_AUDIO & sg_p2p_session->cmd))) {
+    if ((0 == (P2P_VIDEO & pSession->cmd)) && (0 == (P2P_PB_VIDEO & pSession->cmd)) &&
+        (0 == (P2P_AUDIO & pSession->cmd)) && (0 == (P2P_PB_AUDIO & pSession->cmd))) {
         return OPRT_OK;
     }
-    ret = tuya_p2p_rtc_send_data(sg_p2p_session->session, channel, buff, length, -1);
+    ret = tuya_p2p_rtc_send_data(pSession->session, channel, buff, length, -1);
     if (ret != length) {
         PR_ERR("Write data failed [%d][%d]", ret, length);
     }
@@ -532,11 +533,12 @@ OPERATE_RET p2p_send_rtp_data(INT_T client, INT_T channel, CHAR_T *buff, INT_T l
 /***********************************************************
  *  Function: __p2p_ext_protocol_pack
  *  Note:Transport extension protocol packet assembly
- *  Input: client channel number, pResult result buffer, type 0/1 video/audio
+ *  Input: pSession viewer session, pkt rtp packet of the fan-out list, pResult result buffer
  *  Output: pResultLen result buffer size
  *  Return:
  ***********************************************************/
-STATIC VOID __p2p_ext_protocol_pack(INT_T client, INT_T type, CHAR_T *p_result, INT_T *p_result_len)
+STATIC VOID __p2p_ext_protocol_pack(P2P_SESSION_T *pSession, P2P_RTP_PKT_T *pkt, CHAR_T *p_result,
+                                    INT_T *p_result_len)
 {
     if (NULL == p_result || NULL == p_result_len) {
         PR_ERR("input error");
@@ -544,177 +546,344 @@ STATIC VOID __p2p_ext_protocol_pack(INT_T client, INT_T type, CHAR_T *p_result,
     }
 
     INT_T fix_len = 0; // 20180428 supplementary header data
-    UINT64_T tmpTime;
-    INT_T ipcChan = client;
-    IPC_STREAM_E curClirtyChn = p2p_get_chn_idx(sg_p2p_session->cur_clarity);
+    IPC_STREAM_E curClirtyChn = p2p_get_chn_idx(pSession->cur_clarity);
+    TRANS_IPC_AV_INFO_T *av_Info = &sg_p2p_mgr->av_Info;
     C2C_AV_TRANS_FIXED_HEADER *pav_Info = (C2C_AV_TRANS_FIXED_HEADER *)p_result;
 
-    if (0 == type) {
-        tmpTime = sg_p2p_session->v_timestamp;
-        pav_Info->request_id = sg_p2p_session->video_req_id;
-        if (TRUE == sg_p2p_session->key_frame) {
+    memset(p_result, 0, P2P_EXT_HEAD_MAX_LEN);
+    if (0 == pkt->type) {
+        pav_Info->request_id = pSession->video_req_id;
+        if (TRUE == pkt->key) {
             fix_len = sizeof(C2C_AV_TRANS_FIXED_HEADER) + EXT_PROTOCOL_V0_LEN;
             pav_Info->extension_length = 8;
             *(BYTE_T *)&p_result[sizeof(C2C_AV_TRANS_FIXED_HEADER)] = TY_EXT_VIDEO_PARAM;
             *(BYTE_T *)&p_result[sizeof(C2C_AV_TRANS_FIXED_HEADER) + 1] = 0;
-            *(SHORT_T *)&p_result[sizeof(C2C_AV_TRANS_FIXED_HEADER) + 2] =
-                (SHORT_T)sg_p2p_session->av_Info.width[curClirtyChn];
-            *(SHORT_T *)&p_result[sizeof(C2C_AV_TRANS_FIXED_HEADER) + 4] =
-                (SHORT_T)sg_p2p_session->av_Info.height[curClirtyChn];
-            *(SHORT_T *)&p_result[sizeof(C2C_AV_TRANS_FIXED_HEADER) + 6] =
-                (SHORT_T)sg_p2p_session->av_Info.fps[curClirtyChn];
+            *(SHORT_T *)&p_result[sizeof(C2C_AV_TRANS_FIXED_HEADER) + 2] = (SHORT_T)av_Info->width[curClirtyChn];
+            *(SHORT_T *)&p_result[sizeof(C2C_AV_TRANS_FIXED_HEADER) + 4] = (SHORT_T)av_Info->height[curClirtyChn];
+            *(SHORT_T *)&p_result[sizeof(C2C_AV_TRANS_FIXED_HEADER) + 6] = (SHORT_T)av_Info->fps[curClirtyChn];
         } else {
             fix_len = sizeof(C2C_AV_TRANS_FIXED_HEADER) + 4;
             pav_Info->extension_length = 0;
         }
     } else {
-        tmpTime = sg_p2p_session->a_timestamp;
-        pav_Info->request_id = sg_p2p_session->audio_req_id;
+        pav_Info->request_id = pSession->audio_req_id;
         fix_len = sizeof(C2C_AV_TRANS_FIXED_HEADER) + EXT_PROTOCOL_V0_LEN;
         pav_Info->extension_length = 8;
         *(BYTE_T *)&p_result[sizeof(C2C_AV_TRANS_FIXED_HEADER)] = TY_EXT_AUDIO_PARAM;
         *(BYTE_T *)&p_result[sizeof(C2C_AV_TRANS_FIXED_HEADER) + 1] = 0;
-        *(SHORT_T *)&p_result[sizeof(C2C_AV_TRANS_FIXED_HEADER) + 2] = (SHORT_T)sg_p2p_session->av_Info.audio_sample;
-        *(SHORT_T *)&p_result[sizeof(C2C_AV_TRANS_FIXED_HEADER) + 4] = (SHORT_T)sg_p2p_session->av_Info.audio_channel;
-        *(SHORT_T *)&p_result[sizeof(C2C_AV_TRANS_FIXED_HEADER) + 6] = (SHORT_T)sg_p2p_session->av_Info.audio_databits;
+        *(SHORT_T *)&p_result[sizeof(C2C_AV_TRANS_FIXED_HEADER) + 2] = (SHORT_T)av_Info->audio_sample;
+        *(SHORT_T *)&p_result[sizeof(C2C_AV_TRANS_FIXED_HEADER) + 4] = (SHORT_T)av_Info->audio_channel;
+        *(SHORT_T *)&p_result[sizeof(C2C_AV_TRANS_FIXED_HEADER) + 6] = (SHORT_T)av_Info->audio_databits;
     }
-    pav_Info->time_ms = tmpTime;
+    pav_Info->time_ms = pkt->time_ms;
     *p_result_len = fix_len;
 
     return;
 }
 
-STATIC OPERATE_RET __p2p_check_free_buffer_size(INT_T client, INT_T channel, INT_T len)
+STATIC INT_T __p2p_rtc_free_size(P2P_SESSION_T *pSession, INT_T channel)
 {
-    OPERATE_RET ret = OPRT_OK;
     INT_T sendFreeSize = 0;
     INT_T writeSize = 0;
 
-    ret = tuya_p2p_rtc_check_buffer(sg_p2p_session->session, channel, (uint32_t *)&writeSize, NULL,
-                                    (uint32_t *)&sendFreeSize);
-    if (OPRT_OK != ret) {
-        return ret;
+    if (OPRT_OK != tuya_p2p_rtc_check_buffer(pSession->session, channel, (uint32_t *)&writeSize, NULL,
+                                             (uint32_t *)&sendFreeSize)) {
+        return 0;
+    }
+    return sendFreeSize;
+}
+
+STATIC INT_T __p2p_rtc_send(P2P_SESSION_T *pSession, INT_T channel, CHAR_T *buff, INT_T len)
+{
+    return p2p_send_rtp_data(pSession->index, channel, buff, len);
+}
+
+STATIC CONST P2P_VIEWER_IO_T sg_p2p_rtc_io = {
+    .free_size = __p2p_rtc_free_size,
+    .send = __p2p_rtc_send,
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+STATIC VOID __p2p_fanout_collect(P2P_FANOUT_T *fo)
+{
+    P2P_RTP_PKT_T *pkt = NULL;
+
+    // packets are freed in order, the head is the oldest one
+    while (fo->head && 0 == fo->head->ref) {
+        pkt = fo->head;
+        fo->head = pkt->next;
+        fo->bytes -= pkt->len;
+        Free(pkt);
+    }
+    if (NULL == fo->head) {
+        fo->tail = NULL;
+    }
+}
+
+STATIC VOID __p2p_fanout_publish(P2P_FANOUT_T *fo, P2P_RTP_PKT_T *pkt)
+{
+    UINT_T i;
+    P2P_VIEWER_T *viewer = NULL;
+
+    // without viewers the packet is not queued and rtp_free drops it
+    if (0 == fo->readers) {
+        return;
     }
+    pkt->next = NULL;
+    pkt->ref = fo->readers;
+    pkt->queued = TRUE;
+    if (fo->tail) {
+        fo->tail->next = pkt;
+    } else {
+        fo->head = pkt;
+    }
+    fo->tail = pkt;
+    fo->bytes += pkt->len;
 
-    INT_T rtp_cnt = len / RTP_MTU_LEN + 1;
-    INT_T need_size = rtp_cnt * 1600; // kcp send, one segment occupies 1600 bytes
-    if (need_size > sendFreeSize) {
-        STATIC INT_T retry_sum = 0; // Total retry count when buffer is full
-        if (retry_sum % 100 == 0) {
-            PR_ERR("Check_Buffer not enough writeSize[%d] sendFreeSize[%d] len[%d] session[%d] channel[%d]", writeSize,
-                   sendFreeSize, len, sg_p2p_session->session, channel);
+    for (i = 0; i < fo->readers; i++) {
+        viewer = fo->viewers[i];
+        if (NULL == viewer->cursor) {
+            viewer->cursor = pkt;
         }
-        retry_sum++;
-        ret = OPRT_RESOURCE_NOT_READY;
+        viewer->backlog += pkt->len;
     }
-    return ret;
+}
+
+STATIC VOID __p2p_fanout_advance(P2P_VIEWER_T *viewer)
+{
+    P2P_RTP_PKT_T *pkt = viewer->cursor;
+
+    viewer->cursor = pkt->next;
+    viewer->backlog -= pkt->len;
+    pkt->ref--;
+}
+
+STATIC VOID __p2p_fanout_attach(P2P_FANOUT_T *fo, P2P_VIEWER_T *viewer, UINT_T gen)
+{
+    if (fo->readers >= P2P_SESSION_MAX) {
+        return;
+    }
+    memset(viewer, 0, sizeof(P2P_VIEWER_T));
+    viewer->attached = TRUE;
+    viewer->wait_key = TRUE; // a new viewer starts with a key frame
+    viewer->gen = gen;
+    fo->viewers[fo->readers++] = viewer;
+}
+
+STATIC VOID __p2p_fanout_detach(P2P_FANOUT_T *fo, P2P_VIEWER_T *viewer)
+{
+    UINT_T i;
+
+    while (viewer->cursor) {
+        __p2p_fanout_advance(viewer);
+    }
+    for (i = 0; i < fo->readers; i++) {
+        if (fo->viewers[i] == viewer) {
+            fo->viewers[i] = fo->viewers[--fo->readers];
+            break;
+        }
+    }
+    viewer->attached = FALSE;
+    __p2p_fanout_collect(fo);
 }
 
 /***********************************************************
- *  Function: __p2p_pack_h265_rtp_and_send
- *  Note:IPC stream data assembly RTP and send
- *  Input: pData data header address, len data length, client channel number
+ *  Function: __p2p_fanout_skip_to_key
+ *  Note:Drop the backlog of a viewer up to the next key frame, or all of it and wait for one
+ *  Input: viewer viewer that fell behind
  *  Output: none
  *  Return:
  ***********************************************************/
-STATIC OPERATE_RET __p2p_pack_h265_rtp_and_send(INT_T client, CHAR_T *pData, INT_T len)
+STATIC VOID __p2p_fanout_skip_to_key(P2P_VIEWER_T *viewer)
 {
-    if (NULL == pData) {
-        PR_ERR("input error");
-        return OPRT_INVALID_PARM;
+    P2P_RTP_PKT_T *key = NULL;
+    P2P_RTP_PKT_T *pkt = NULL;
+
+    for (pkt = viewer->cursor ? viewer->cursor->next : NULL; pkt; pkt = pkt->next) {
+        if (0 == pkt->type && pkt->key && pkt->start) {
+            key = pkt;
+            break;
+        }
+    }
+    while (viewer->cursor && viewer->cursor != key) {
+        __p2p_fanout_advance(viewer);
+        viewer->dropped++;
     }
+    viewer->wait_key = (NULL == key);
+}
 
-    OPERATE_RET ret = __p2p_check_free_buffer_size(client, TUYA_VDATA_CHANNEL, len);
-    if (OPRT_OK != ret) {
-        return ret;
+/***********************************************************
+ *  Function: __p2p_fanout_flush
+ *  Note:Send the queued packets of a viewer while its channels have room
+ *  Input: fo fan-out list, pSession viewer session, io channel access
+ *  Output: none
+ *  Return: TRUE if packets are left for the viewer
+ ***********************************************************/
+STATIC BOOL_T __p2p_fanout_flush(P2P_FANOUT_T *fo, P2P_SESSION_T *pSession, CONST P2P_VIEWER_IO_T *io)
+{
+    P2P_VIEWER_T *viewer = &pSession->viewer;
+    P2P_RTP_PKT_T *pkt = NULL;
+    INT_T free_size[2] = {-1, -1}; // video/audio channel, read once per flush
+    INT_T channel = 0;
+    INT_T fix_len = 0;
+
+    if (viewer->backlog > P2P_VIEWER_LAG_BYTES) {
+        PR_DEBUG("session[%d] lags [%u] bytes, skip to the next key frame", pSession->session, viewer->backlog);
+        __p2p_fanout_skip_to_key(viewer);
+    }
+
+    while (viewer->cursor) {
+        pkt = viewer->cursor;
+        if (0 == pkt->type) {
+            if (!(P2P_VIDEO & pSession->cmd) || (viewer->wait_key && !(pkt->key && pkt->start))) {
+                __p2p_fanout_advance(viewer);
+                continue;
+            }
+            channel = TUYA_VDATA_CHANNEL;
+        } else {
+            if (!(P2P_AUDIO & pSession->cmd)) {
+                __p2p_fanout_advance(viewer);
+                continue;
+            }
+            channel = TUYA_ADATA_CHANNEL;
+        }
+
+        if (free_size[pkt->type] < 0) {
+            free_size[pkt->type] = io->free_size(pSession, channel);
+        }
+        if (free_size[pkt->type] < P2P_KCP_SEG_SIZE) {
+            // the channel is congested, keep the position and retry on the next round
+            break;
+        }
+        free_size[pkt->type] -= P2P_KCP_SEG_SIZE;
+        if (0 == pkt->type) {
+            viewer->wait_key = FALSE;
+        }
+
+        __p2p_ext_protocol_pack(pSession, pkt, fo->buff, &fix_len);
+        *(INT_T *)&fo->buff[fix_len - 4] = pkt->len;
+        memcpy(fo->buff + fix_len, pkt->data, pkt->len);
+        io->send(pSession, channel, fo->buff, fix_len + pkt->len);
+        viewer->sent++;
+        __p2p_fanout_advance(viewer);
     }
+    __p2p_fanout_collect(fo);
 
-    if (NULL == sg_p2p_session->p_video_rtp_buff) {
-        PR_ERR("video rtp buffer is NULL");
-        return OPRT_INVALID_PARM;
+    return (NULL != viewer->cursor);
+}
+
+/***********************************************************
+ *  Function: __p2p_fanout_frame
+ *  Note:Set the attributes of the next frame, the packets it is split into carry them
+ *  Input: fo fan-out list, type 0/1 video/audio, key key frame, time_ms frame absolute time
+ *  Output: none
+ *  Return:
+ ***********************************************************/
+STATIC VOID __p2p_fanout_frame(P2P_FANOUT_T *fo, BYTE_T type, BOOL_T key, UINT64_T time_ms)
+{
+    fo->type = type;
+    fo->key = key;
+    fo->start = TRUE;
+    fo->time_ms = time_ms;
+}
+
+/***********************************************************
+ *  Function: __p2p_rtp_encoder_get
+ *  Note:Get the packetizer of a stream, it is shared by all viewers and only rebuilt for a new codec
+ *  Input: stream rtp stream, payload/name codec, ssrc
+ *  Output: none
+ *  Return: packetizer, NULL on error
+ ***********************************************************/
+STATIC VOID *__p2p_rtp_encoder_get(P2P_RTP_STREAM_T *stream, INT_T payload, CONST CHAR_T *name, UINT_T ssrc)
+{
+    STATIC struct rtp_payload_t rtp_packer = {
+        .alloc = rtp_alloc,
+        .free = rtp_free,
+        .packet = rtp_pack_packet_handler,
+    };
+
+    if (stream->encoder && stream->payload == payload) {
+        return stream->encoder;
+    }
+    if (stream->encoder) {
+        rtp_payload_encode_destroy(stream->encoder);
     }
 
-    RTP_PACK_NAL_ARG_T rtp_pack_nal_arg;
-    rtp_pack_nal_arg.client = client;
-    rtp_pack_nal_arg.channel = TUYA_VDATA_CHANNEL;
-    rtp_pack_nal_arg.p_rtp_buff = sg_p2p_session->p_video_rtp_buff;
-    memset(rtp_pack_nal_arg.ext_head_buff, 0, P2P_EXT_HEAD_MAX_LEN);
-    __p2p_ext_protocol_pack(client, 0, rtp_pack_nal_arg.ext_head_buff, &rtp_pack_nal_arg.fix_len);
+    stream->encoder = rtp_payload_encode_create(payload, name, stream->seq, ssrc, &rtp_packer, &sg_p2p_mgr->fanout);
+    stream->payload = payload;
+    if (NULL == stream->encoder) {
+        PR_ERR("rtp_payload_encode_create %s failed", name);
+    }
+
+    return stream->encoder;
+}
 
+/***********************************************************
+ *  Function: __p2p_pack_rtp
+ *  Note:Packetize a frame once into the fan-out list
+ *  Input: stream rtp stream, payload/name codec, ssrc, pData data header address, len data length, pts
+ *  Output: none
+ *  Return:
+ ***********************************************************/
+STATIC OPERATE_RET __p2p_pack_rtp(P2P_RTP_STREAM_T *stream, INT_T payload, CONST CHAR_T *name, UINT_T ssrc,
+                                  CHAR_T *pData, INT_T len, UINT_T pts)
+{
+    OPERATE_RET ret = OPRT_OK;
     void *pRtpDelegate = NULL;
-    struct rtp_payload_t rtp_packer;
-    rtp_packer.alloc = rtp_alloc;
-    rtp_packer.free = rtp_free;
-    rtp_packer.packet = rtp_pack_packet_handler;
-    uint16_t seq = sg_p2p_session->video_seq_num;
-    uint32_t ssrc = 10;
-    uint32_t timestamp = (UINT_T)sg_p2p_session->v_pts;
-    pRtpDelegate = rtp_payload_encode_create(/*H265_PAY_LOAD*/ 95, "H265", seq, ssrc, &rtp_packer, &rtp_pack_nal_arg);
+    uint32_t timestamp = pts;
+
+    pRtpDelegate = __p2p_rtp_encoder_get(stream, payload, name, ssrc);
+    if (NULL == pRtpDelegate) {
+        return OPRT_MALLOC_FAILED;
+    }
     ret = rtp_payload_encode_input(pRtpDelegate, pData, len, timestamp);
     if (OPRT_OK != ret) {
-        PR_ERR("rtp_payload_encode_input h264 error:%d", ret);
+        PR_ERR("rtp_payload_encode_input %s error:%d", name, ret);
     }
-    rtp_payload_encode_getinfo(pRtpDelegate, &sg_p2p_session->video_seq_num, &timestamp);
-    rtp_payload_encode_destroy(pRtpDelegate);
+    rtp_payload_encode_getinfo(pRtpDelegate, &stream->seq, &timestamp);
 
     return ret;
 }
 
 /***********************************************************
- *  Function: __p2p_pack_h264_rtp_and_send
- *  Note:IPC stream data assembly RTP and send
- *  Input: pData data header address, len data length, client channel number
+ *  Function: __p2p_pack_h265_rtp
+ *  Note:IPC stream data assembly RTP
+ *  Input: pData data header address, len data length, pts video pts
  *  Output: none
  *  Return:
  ***********************************************************/
-STATIC OPERATE_RET __p2p_pack_h264_rtp_and_send(INT_T client, CHAR_T *pData, INT_T len)
+STATIC OPERATE_RET __p2p_pack_h265_rtp(CHAR_T *pData, INT_T len, UINT_T pts)
 {
     if (NULL == pData) {
         PR_ERR("input error");
         return OPRT_INVALID_PARM;
     }
 
-    UINT_T max_frame_size = /*tuya_ipc_media_adapter_get_max_frame(0, 0, 0)*/ (300 * 1024);
-    if (len > max_frame_size) {
-        PR_ERR("frame len too big[%d]", len);
-        return OPRT_INVALID_PARM;
-    }
-
-    OPERATE_RET ret;
-    ret = __p2p_check_free_buffer_size(client, TUYA_VDATA_CHANNEL, len);
-    if (OPRT_OK != ret) {
-        return ret;
-    }
+    return __p2p_pack_rtp(&sg_p2p_mgr->video_rtp, /*H265_PAY_LOAD*/ 95, "H265", 10, pData, len, pts);
+}
 
-    if (NULL == sg_p2p_session->p_video_rtp_buff) {
-        PR_ERR("video rtp buffer is NULL");
+/***********************************************************
+ *  Function: __p2p_pack_h264_rtp
+ *  Note:IPC stream data assembly RTP
+ *  Input: pData data header address, len data length, pts video pts
+ *  Output: none
+ *  Return:
+ ***********************************************************/
+STATIC OPERATE_RET __p2p_pack_h264_rtp(CHAR_T *pData, INT_T len, UINT_T pts)
+{
+    if (NULL == pData) {
+        PR_ERR("input error");
         return OPRT_INVALID_PARM;
     }
 
-    RTP_PACK_NAL_ARG_T rtp_pack_nal_arg;
-    rtp_pack_nal_arg.client = client;
-    rtp_pack_nal_arg.channel = TUYA_VDATA_CHANNEL;
-    rtp_pack_nal_arg.p_rtp_buff = sg_p2p_session->p_video_rtp_buff;
-    memset(rtp_pack_nal_arg.ext_head_buff, 0, P2P_EXT_HEAD_MAX_LEN);
-    __p2p_ext_protocol_pack(client, 0, rtp_pack_nal_arg.ext_head_buff, &rtp_pack_nal_arg.fix_len);
-
-    void *pRtpDelegate = NULL;
-    struct rtp_payload_t rtp_packer;
-    rtp_packer.alloc = rtp_alloc;
-    rtp_packer.free = rtp_free;
-    rtp_packer.packet = rtp_pack_packet_handler;
-    uint16_t seq = sg_p2p_session->video_seq_num;
-    uint32_t ssrc = 10;
-    uint32_t timestamp = (UINT_T)sg_p2p_session->v_pts;
-    pRtpDelegate = rtp_payload_encode_create(/*H264_PAY_LOAD*/ 96, "H264", seq, ssrc, &rtp_packer, &rtp_pack_nal_arg);
-    ret = rtp_payload_encode_input(pRtpDelegate, pData, len, timestamp);
-    if (OPRT_OK != ret) {
-        PR_ERR("rtp_payload_encode_input h264 error:%d", ret);
+    UINT_T max_frame_size = /*tuya_ipc_media_adapter_get_max_frame(0, 0, 0)*/ (300 * 1024);
+    if (len > max_frame_size) {
+        PR_ERR("frame len too big[%d]", len);
+        return OPRT_INVALID_PARM;
     }
-    rtp_payload_encode_getinfo(pRtpDelegate, &sg_p2p_session->video_seq_num, &timestamp);
-    rtp_payload_encode_destroy(pRtpDelegate);
 
-    return ret;
+    return __p2p_pack_rtp(&sg_p2p_mgr->video_rtp, /*H264_PAY_LOAD*/ 96, "H264", 10, pData, len, pts);
 }
 
 /***********************************************************
@@ -789,16 +958,16 @@ STATIC OPERATE_RET __p2p_pack_h264_rtp_and_send(INT_T client, CHAR_T *pData, INT
 // }
 
 /***********************************************************
- *  Function: __p2p_pack_g711_rtp_and_send
- *  Note:IPC audio data assembly RTP and send
- *  Input: pData data header address, len data length, client channel number, mode g711 mode
+ *  Function: __p2p_pack_g711_rtp
+ *  Note:IPC audio data assembly RTP
+ *  Input: pData data header address, len data length, pts audio pts, mode g711 mode
  *  Output: none
  *  Return:
  ***********************************************************/
-STATIC OPERATE_RET __p2p_pack_g711_rtp_and_send(INT_T client, CHAR_T *pData, INT_T len, INT_T mode)
+STATIC OPERATE_RET __p2p_pack_g711_rtp(CHAR_T *pData, INT_T len, UINT_T pts, INT_T mode)
 {
     if (NULL == pData) {
-        PR_ERR("data[%p] client num [%d]", pData, client);
+        PR_ERR("data[%p]", pData);
         return OPRT_INVALID_PARM;
     }
 
@@ -807,32 +976,6 @@ STATIC OPERATE_RET __p2p_pack_g711_rtp_and_send(INT_T client, CHAR_T *pData, INT
         return OPRT_INVALID_PARM;
     }
 
-    OPERATE_RET ret = OPRT_OK;
-    ret = __p2p_check_free_buffer_size(client, TUYA_ADATA_CHANNEL, len);
-    if (OPRT_OK != ret) {
-        return ret;
-    }
-
-    if (NULL == sg_p2p_session->p_audio_rtp_buff) {
-        PR_ERR("audio rtp buffer is NULL");
-        return OPRT_INVALID_PARM;
-    }
-
-    RTP_PACK_NAL_ARG_T rtp_pack_nal_arg;
-    rtp_pack_nal_arg.client = client;
-    rtp_pack_nal_arg.channel = TUYA_ADATA_CHANNEL;
-    rtp_pack_nal_arg.p_rtp_buff = sg_p2p_session->p_audio_rtp_buff;
-    memset(rtp_pack_nal_arg.ext_head_buff, 0, P2P_EXT_HEAD_MAX_LEN);
-    __p2p_ext_protocol_pack(client, 1, rtp_pack_nal_arg.ext_head_buff, &rtp_pack_nal_arg.fix_len);
-
-    void *pRtpDelegate = NULL;
-    struct rtp_payload_t rtp_packer;
-    rtp_packer.alloc = rtp_alloc;
-    rtp_packer.free = rtp_free;
-    rtp_packer.packet = rtp_pack_packet_handler;
-    uint16_t seq = sg_p2p_session->audio_seq_num;
-    uint32_t ssrc = 11;
-    uint32_t timestamp = (UINT_T)sg_p2p_session->a_pts;
     int payload = 0;
     char *codec_name = NULL;
     if (TY_AV_CODEC_AUDIO_G711U == mode) {
@@ -845,15 +988,8 @@ STATIC OPERATE_RET __p2p_pack_g711_rtp_and_send(INT_T client, CHAR_T *pData, INT
         codec_name = "PCM";
         payload = 99 /*RTP_PCM_PAYLOAD*/;
     }
-    pRtpDelegate = rtp_payload_encode_create(payload, codec_name, seq, ssrc, &rtp_packer, &rtp_pack_nal_arg);
-    ret = rtp_payload_encode_input(pRtpDelegate, pData, len, timestamp);
-    if (OPRT_OK != ret) {
-        PR_ERR("rtp_payload_encode_input h264 error:%d", ret);
-    }
-    rtp_payload_encode_getinfo(pRtpDelegate, &sg_p2p_session->audio_seq_num, &timestamp);
-    rtp_payload_encode_destroy(pRtpDelegate);
 
-    return ret;
+    return __p2p_pack_rtp(&sg_p2p_mgr->audio_rtp, payload, codec_name, 11, pData, len, pts);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -870,22 +1006,33 @@ OPERATE_RET tuya_ipc_p2p_set_limit_mode(BOOL_T islimit)
 
 OPERATE_RET tuya_ipc_init_trans_av_info(TRANS_IPC_AV_INFO_T *av_info)
 {
-    memcpy(&sg_p2p_session->av_Info, av_info, sizeof(TRANS_IPC_AV_INFO_T));
+    memcpy(&sg_p2p_mgr->av_Info, av_info, sizeof(TRANS_IPC_AV_INFO_T));
     return OPRT_OK;
 }
 
 OPERATE_RET tuya_p2p_rtc_register_get_video_frame_cb(tuya_p2p_rtc_get_frame_cb_t pCallback)
 {
-    sg_p2p_session->on_get_video_frame_callback = pCallback;
+    sg_p2p_mgr->on_get_video_frame_callback = pCallback;
     return OPRT_OK;
 }
 
 OPERATE_RET tuya_p2p_rtc_register_get_audio_frame_cb(tuya_p2p_rtc_get_frame_cb_t pCallback)
 {
-    sg_p2p_session->on_get_audio_frame_callback = pCallback;
+    sg_p2p_mgr->on_get_audio_frame_callback = pCallback;
     return OPRT_OK;
 }
 
+OPERATE_RET tuya_p2p_rtc_notify_frame_ready(VOID)
+{
+    if (NULL == sg_p2p_mgr || NULL == sg_p2p_mgr->frame_sem) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    // from now on the media pump sleeps until notified instead of polling the frame callbacks
+    sg_p2p_mgr->frame_notify = TRUE;
+    return tal_semaphore_post(sg_p2p_mgr->frame_sem);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /***********************************************************
@@ -904,6 +1051,7 @@ STATIC INT_T __p2p_session_trans_video_start(P2P_SESSION_T *pSession)
     // Wait for previous data transmission to end
     PR_DEBUG("session[%d]video video_start wait_concurr_idle", pSession->session);
     pSession->cmd |= P2P_VIDEO;
+    tal_semaphore_post(sg_p2p_mgr->frame_sem);
     PR_DEBUG("session[%d] video start success", pSession->session);
     return OPRT_OK;
 }
@@ -942,6 +1090,7 @@ STATIC INT_T __p2p_session_trans_audio_start(P2P_SESSION_T *pSession)
 
     PR_DEBUG("session[%d] send audio start to dev", pSession->session);
     pSession->cmd |= P2P_AUDIO;
+    tal_semaphore_post(sg_p2p_mgr->frame_sem);
     PR_DEBUG("session:[%d] audio start success", pSession->session);
     return OPRT_OK;
 }
@@ -1290,22 +1439,22 @@ STATIC INT_T __p2p_read_cmd(P2P_SESSION_T *pSession)
     return 0;
 }
 
+STATIC VOID __p2p_proto_parse_reset(P2P_SESSION_T *pSession)
+{
+    memset(&pSession->proto_parse, 0x00, sizeof(pSession->proto_parse));
+    pSession->proto_parse.read_size = P2P_CMD_HEAD_LEN;
+    pSession->proto_parse.flag = READ_HEADER_PART;
+}
+
 STATIC void __p2p_cmd_recv_proc(PVOID_T pArg)
 {
-    P2P_SESSION_T *pSession = NULL;
+    P2P_SESSION_T *pSession = (P2P_SESSION_T *)pArg;
     INT_T ret;
 
-    memset(&sg_p2p_session->proto_parse, 0x00, sizeof(sg_p2p_session->proto_parse));
-    sg_p2p_session->proto_parse.read_size = P2P_CMD_HEAD_LEN;
-    sg_p2p_session->proto_parse.flag = READ_HEADER_PART;
-    while (tal_thread_get_state(sg_p2p_session->cmd_recv_proc_thread) == THREAD_STATE_RUNNING) {
-        if (P2P_SESSION_IDLE == sg_p2p_session->status) {
-            tal_system_sleep(5);
-            continue;
-        }
-        pSession = sg_p2p_session;
+    __p2p_proto_parse_reset(pSession);
+    while (tal_thread_get_state(pSession->cmd_recv_proc_thread) == THREAD_STATE_RUNNING) {
         tal_mutex_lock(pSession->cmutex);
-        if (P2P_SESSION_CLOSING == pSession->status) {
+        if (P2P_SESSION_IDLE == pSession->status || P2P_SESSION_CLOSING == pSession->status) {
             tal_mutex_unlock(pSession->cmutex);
             tal_system_sleep(5);
             continue;
@@ -1318,12 +1467,13 @@ STATIC void __p2p_cmd_recv_proc(PVOID_T pArg)
 
         ret = __p2p_read_cmd(pSession);
         if (0 != ret) {
-            PR_ERR("session[%d] read cmd failed [%d]", pSession->session, ret);
+            INT_T session = pSession->session;
+            PR_ERR("session[%d] read cmd failed [%d] cmd [%d]", session, ret, pSession->cmd);
             __p2p_session_clear(pSession);
             //__p2p_wait_concurr_idle(pSession, WAIT_ALL_BUF);
+            // Close this viewer and free its slot, the other viewers keep running
             __p2p_session_release_va(pSession);
-            tuya_p2p_rtc_notify_exit();
-            printf("pSession->cmd: %d\n", sg_p2p_session->cmd);
+            __p2p_rtc_close(session, RTC_CLOSE_REASON_RECV_ERR, pSession);
         }
     }
 
@@ -1339,102 +1489,131 @@ STATIC void __p2p_cmd_recv_proc(PVOID_T pArg)
  *  Output: none
  *  Return:
  ***********************************************************/
+STATIC VOID __p2p_media_wait(BOOL_T idle, BOOL_T pending)
+{
+    UINT_T timeout = P2P_MEDIA_IDLE_WAIT_MS;
+
+    // idle waits for a state change, a missing frame waits for the producer unless it only can be polled,
+    // a viewer with queued packets retries once its channel drained a bit
+    if (pending || (!idle && !sg_p2p_mgr->frame_notify)) {
+        timeout = P2P_MEDIA_POLL_MS;
+    }
+    tal_semaphore_wait(sg_p2p_mgr->frame_sem, timeout);
+}
+
+/***********************************************************
+ *  Function: __p2p_viewer_update
+ *  Note:Attach the sessions that want live media to the fan-out list, detach stopped or closed ones
+ *  Input: fo fan-out list
+ *  Output: none
+ *  Return: media wanted by at least one viewer
+ ***********************************************************/
+STATIC P2P_CMD_E __p2p_viewer_update(P2P_FANOUT_T *fo)
+{
+    INT_T i;
+    UINT_T gen = 0;
+    P2P_CMD_E cmd = P2P_IDLE;
+    P2P_CMD_E want = P2P_IDLE;
+    P2P_SESSION_T *pSession = NULL;
+
+    for (i = 0; i < sg_p2p_mgr->session_num; i++) {
+        pSession = &sg_p2p_mgr->sessions[i];
+        tal_mutex_lock(pSession->cmutex);
+        cmd = (P2P_SESSION_RUNNING == pSession->status) ? (pSession->cmd & (P2P_VIDEO | P2P_AUDIO)) : P2P_IDLE;
+        gen = pSession->gen;
+        tal_mutex_unlock(pSession->cmutex);
+
+        // a slot released and taken again in between gets a new viewer that starts at a key frame
+        if (pSession->viewer.attached && (P2P_IDLE == cmd || pSession->viewer.gen != gen)) {
+            PR_DEBUG("session[%d] detach sent[%u] dropped[%u]", pSession->session, pSession->viewer.sent,
+                     pSession->viewer.dropped);
+            __p2p_fanout_detach(fo, &pSession->viewer);
+        }
+        if (!pSession->viewer.attached && P2P_IDLE != cmd) {
+            __p2p_fanout_attach(fo, &pSession->viewer, gen);
+        }
+        want |= cmd;
+    }
+
+    return want;
+}
+
 STATIC void __p2p_media_send_proc(PVOID_T pArg)
 {
-    INT_T index = 0;
+    INT_T i = 0;
     UINT_T runCnt = 0;
-    P2P_SESSION_T *pSession = NULL;
+    UINT_T frames = 0;
+    UINT_T pts = 0;
+    BOOL_T pending = FALSE;
+    P2P_CMD_E want = P2P_IDLE;
+    P2P_FANOUT_T *fo = &sg_p2p_mgr->fanout;
     OPERATE_RET op_ret = -1;
     TY_AV_CODEC_ID type;
-    type = sg_p2p_session->av_Info.audio_codec;
+    type = sg_p2p_mgr->av_Info.audio_codec;
     // type = TY_AV_CODEC_AUDIO_PCM;
 
     PR_DEBUG("into p2p video send");
 
-    while (tal_thread_get_state(sg_p2p_session->video_send_proc_thread) == THREAD_STATE_RUNNING) {
+    while (tal_thread_get_state(sg_p2p_mgr->video_send_proc_thread) == THREAD_STATE_RUNNING) {
         if (runCnt % 2000 == 0) {
-            PR_DEBUG("media send proc alive [%d]", runCnt);
+            PR_DEBUG("media send proc alive [%d] viewers [%u] queued [%u]", runCnt, fo->readers, fo->bytes);
         }
         runCnt++;
 
-        if (P2P_SESSION_IDLE == sg_p2p_session->status) {
-            tal_system_sleep(5);
-            continue;
-        }
-
-        pSession = sg_p2p_session;
-        tal_mutex_lock(pSession->cmutex);
-        INT_T status = pSession->status;
-        P2P_CMD_E cmd = pSession->cmd;
-
-        if (P2P_SESSION_CLOSING == pSession->status) {
-            tal_mutex_unlock(pSession->cmutex);
-            tal_system_sleep(5);
-            continue;
-        }
-        if (P2P_SESSION_RUNNING != status) {
-            tal_mutex_unlock(pSession->cmutex);
-            continue;
-        }
-
         // The judgment when both are not opened should be placed at the end, otherwise it will appear: users close
         // audio and video at the same time, but do not release resources This judgment cannot be omitted, otherwise
         // thread idle running will occur
-        if (!(P2P_VIDEO & cmd) && !(P2P_AUDIO & cmd)) {
-            // pSession->p2p_buff_stat.live_video = P2P_BUFF_IDLE;
-            // pSession->p2p_buff_stat.live_audio = P2P_BUFF_IDLE;
-            tal_mutex_unlock(pSession->cmutex);
-            tal_system_sleep(5);
+        want = __p2p_viewer_update(fo);
+        if (!(P2P_VIDEO & want) && !(P2P_AUDIO & want)) {
+            __p2p_media_wait(TRUE, FALSE);
             continue;
         }
-        tal_mutex_unlock(pSession->cmutex);
 
-        if (P2P_VIDEO & cmd) {
-            if (sg_p2p_session->on_get_video_frame_callback == NULL) {
-                tal_system_sleep(10);
-                continue;
-            }
-            MEDIA_FRAME *pMediaFrame = &sg_p2p_session->media_frame;
-            op_ret = sg_p2p_session->on_get_video_frame_callback(pMediaFrame); // OnGetVideoFrameCallback(pMediaFrame)
+        // every frame is taken and packetized once whatever the number of viewers
+        frames = 0;
+        if ((P2P_VIDEO & want) && sg_p2p_mgr->on_get_video_frame_callback) {
+            MEDIA_FRAME *pMediaFrame = &sg_p2p_mgr->media_frame;
+            op_ret = sg_p2p_mgr->on_get_video_frame_callback(pMediaFrame); // OnGetVideoFrameCallback(pMediaFrame)
             if (op_ret == OPRT_OK) {
-                pSession->v_pts = (pMediaFrame->pts == 0) ? pMediaFrame->timestamp * 1000 : pMediaFrame->pts;
-                pSession->v_timestamp = pMediaFrame->timestamp;
-                if (eVideoIFrame == pMediaFrame->type) {
-                    pSession->key_frame = TRUE;
+                frames++;
+                pts = (UINT_T)((pMediaFrame->pts == 0) ? pMediaFrame->timestamp * 1000 : pMediaFrame->pts);
+                __p2p_fanout_frame(fo, 0, eVideoIFrame == pMediaFrame->type, pMediaFrame->timestamp);
+                if (TY_AV_CODEC_VIDEO_H265 != sg_p2p_mgr->av_Info.video_codec[0]) {
+                    op_ret = __p2p_pack_h264_rtp((CHAR_T *)pMediaFrame->data, pMediaFrame->size, pts);
                 } else {
-                    pSession->key_frame = FALSE;
+                    op_ret = __p2p_pack_h265_rtp((CHAR_T *)pMediaFrame->data, pMediaFrame->size, pts);
                 }
-                if (TY_AV_CODEC_VIDEO_H265 != sg_p2p_session->av_Info.video_codec[0]) {
-                    op_ret = __p2p_pack_h264_rtp_and_send(index, (CHAR_T *)pMediaFrame->data, pMediaFrame->size);
-                } else {
-                    op_ret = __p2p_pack_h265_rtp_and_send(index, (CHAR_T *)pMediaFrame->data, pMediaFrame->size);
-                }
-            } else {
-                // Buffer has no data yet
-                tal_system_sleep(10);
             }
         }
-        if (P2P_AUDIO & cmd) {
-            if (sg_p2p_session->on_get_audio_frame_callback == NULL) {
-                tal_system_sleep(10);
-                continue;
-            }
-            MEDIA_FRAME *pMediaFrame = &sg_p2p_session->media_audio_frame;
-            op_ret = sg_p2p_session->on_get_audio_frame_callback(pMediaFrame); // OnGetAudioFrameCallback(pMediaFrame)
+        if ((P2P_AUDIO & want) && sg_p2p_mgr->on_get_audio_frame_callback) {
+            MEDIA_FRAME *pMediaFrame = &sg_p2p_mgr->media_audio_frame;
+            op_ret = sg_p2p_mgr->on_get_audio_frame_callback(pMediaFrame); // OnGetAudioFrameCallback(pMediaFrame)
             if (op_ret == OPRT_OK) {
-                pSession->a_pts = (pMediaFrame->pts == 0) ? pMediaFrame->timestamp * 1000 : pMediaFrame->pts;
-                pSession->a_timestamp = pMediaFrame->timestamp;
+                frames++;
+                pts = (UINT_T)((pMediaFrame->pts == 0) ? pMediaFrame->timestamp * 1000 : pMediaFrame->pts);
+                __p2p_fanout_frame(fo, 1, FALSE, pMediaFrame->timestamp);
                 if (TY_AV_CODEC_AUDIO_AAC_ADTS == type) {
                     // op_ret = __p2p_pack_aac_rtp_and_send((CHAR_T *)node_a.data, node_a.size,index);
                 } else if (TY_AV_CODEC_AUDIO_G711A == type || TY_AV_CODEC_AUDIO_G711U == type ||
                            TY_AV_CODEC_AUDIO_PCM == type) {
-                    op_ret = __p2p_pack_g711_rtp_and_send(index, (CHAR_T *)pMediaFrame->data, pMediaFrame->size, type);
+                    op_ret = __p2p_pack_g711_rtp((CHAR_T *)pMediaFrame->data, pMediaFrame->size, pts, type);
                 }
-            } else {
-                // Buffer has no data yet
-                tal_system_sleep(10);
             }
         }
+
+        // each viewer sends at the pace of its own channel
+        pending = FALSE;
+        for (i = 0; i < sg_p2p_mgr->session_num; i++) {
+            if (sg_p2p_mgr->sessions[i].viewer.attached &&
+                __p2p_fanout_flush(fo, &sg_p2p_mgr->sessions[i], &sg_p2p_rtc_io)) {
+                pending = TRUE;
+            }
+        }
+
+        if (0 == frames) {
+            // Buffer has no data yet, a ready frame wakes the pump up at once
+            __p2p_media_wait(FALSE, pending);
+        }
     } // while
 
     PR_ERR("video send task exit");
@@ -1480,119 +1659,113 @@ INT_T __p2p_session_release_va(P2P_SESSION_T *pSession)
     // All functions closed
     PR_DEBUG("release va session[%d]", pSession->session);
     tal_mutex_lock(pSession->cmutex);
-    if (pSession->p_video_rtp_buff) {
-        Free(pSession->p_video_rtp_buff);
-        pSession->p_video_rtp_buff = NULL;
-    }
-    if (pSession->p_audio_rtp_buff) {
-        Free(pSession->p_audio_rtp_buff);
-        pSession->p_audio_rtp_buff = NULL;
-    }
     // memset(&pSession->session, 0x00, sizeof(P2P_SESSION_T) - OFFSET(P2P_SESSION_T, session));//Clear variables
     // outside the lock memset(&pSession->str_P2p_auth, 0, sizeof(pSession->str_P2p_auth));
     pSession->cur_clarity = TY_VIDEO_CLARITY_INNER_HIGH;
     pSession->status = P2P_SESSION_IDLE;
     pSession->cmd = P2P_IDLE;
     memset(&pSession->pb_resp_head, 0, sizeof(pSession->pb_resp_head));
-    pSession->video_seq_num = 0;
-    pSession->audio_seq_num = 0;
-    pSession->key_frame = false;
-    pSession->v_pts = 0;
-    pSession->v_timestamp = 0;
-    pSession->a_pts = 0;
-    pSession->a_timestamp = 0;
     pSession->video_req_id = 0;
     pSession->audio_req_id = 0;
-    // if (pSession->media_frame.data != NULL) {
-    //     free(pSession->media_frame.data);
-    //     pSession->media_frame.data = NULL;
-    // }
-    // memset(&pSession->media_frame, 0, sizeof(pSession->media_frame));
-    // if (pSession->media_audio_frame.data != NULL) {
-    //     free(pSession->media_audio_frame.data);
-    //     pSession->media_audio_frame.data = NULL;
-    // }
-    // memset(&pSession->media_audio_frame, 0, sizeof(pSession->media_audio_frame));
-    memset(&pSession->proto_parse, 0, sizeof(pSession->proto_parse));
-    memset(&pSession->av_Info, 0, sizeof(pSession->av_Info));
-    if (pSession->on_disconnect_callback)
-        pSession->on_disconnect_callback(); // Notify upper layer when receiving disconnect signal from cloud
+    // the media thread detaches the viewer and drops its queued packets
+    pSession->gen++;
+    __p2p_proto_parse_reset(pSession);
+    if (sg_p2p_mgr->on_disconnect_callback)
+        sg_p2p_mgr->on_disconnect_callback(); // Notify upper layer when receiving disconnect signal from cloud
     tal_mutex_unlock(pSession->cmutex);
+    tal_semaphore_post(sg_p2p_mgr->frame_sem);
     return 0;
 }
 
 OPERATE_RET p2p_init(IN CONST TUYA_IPC_P2P_VAR_T *p_var)
 {
     OPERATE_RET ret = OPRT_OK;
+    INT_T i = 0;
+    INT_T session_num = p_var->max_client_num;
+
+    if (session_num <= 0) {
+        session_num = 1;
+    } else if (session_num > P2P_SESSION_MAX) {
+        PR_WARN("max client num [%d] capped to [%d]", session_num, P2P_SESSION_MAX);
+        session_num = P2P_SESSION_MAX;
+    }
 
     // Initialize session information
-    sg_p2p_session = (P2P_SESSION_T *)Malloc(sizeof(P2P_SESSION_T));
-    if (NULL == sg_p2p_session) {
+    sg_p2p_mgr = (P2P_MGR_T *)Malloc(sizeof(P2P_MGR_T) + session_num * sizeof(P2P_SESSION_T));
+    if (NULL == sg_p2p_mgr) {
         PR_ERR("malloc p2p session failed");
         return OPRT_MALLOC_FAILED;
     }
-    memset(sg_p2p_session, 0, sizeof(P2P_SESSION_T));
-    tal_mutex_create_init(sg_p2p_session->cmutex);
+    memset(sg_p2p_mgr, 0, sizeof(P2P_MGR_T) + session_num * sizeof(P2P_SESSION_T));
+    sg_p2p_mgr->sessions = (P2P_SESSION_T *)(sg_p2p_mgr + 1);
+    sg_p2p_mgr->session_num = session_num;
+    ret = tal_semaphore_create_init(&sg_p2p_mgr->frame_sem, 0, 1);
+    if (ret != OPRT_OK) {
+        PR_ERR("create frame sem failed");
+        Free(sg_p2p_mgr);
+        sg_p2p_mgr = NULL;
+        return ret;
+    }
     // Get password and other verification information
-    memset(&(sg_p2p_session->str_P2p_auth), 0x00, sizeof(TUYA_IPC_P2P_AUTH_T));
-    tuya_ipc_get_p2p_auth(&(sg_p2p_session->str_P2p_auth));
+    memset(&(sg_p2p_mgr->str_P2p_auth), 0x00, sizeof(TUYA_IPC_P2P_AUTH_T));
+    tuya_ipc_get_p2p_auth(&(sg_p2p_mgr->str_P2p_auth));
     tuya_ipc_check_p2p_auth_update();
 
-    sg_p2p_session->cur_clarity = TY_VIDEO_CLARITY_INNER_HIGH;
+    // Initialize
+    int bufSize = 300 * 1024; // MAX_MEDIA_FRAME_SIZE
+    // memset(&sg_p2p_mgr->tal_video_frame, 0, sizeof(sg_p2p_mgr->tal_video_frame));
+    // sg_p2p_mgr->tal_video_frame.pbuf = (char*)malloc(bufSize);
+    // sg_p2p_mgr->tal_video_frame.buf_size = bufSize;
+
+    memset(&sg_p2p_mgr->media_frame, 0, sizeof(sg_p2p_mgr->media_frame));
+    sg_p2p_mgr->media_frame.data = (UCHAR_T *)malloc(bufSize);
+    sg_p2p_mgr->media_frame.size = bufSize;
 
-    // Start media-related threads
+    bufSize = 1280;
+    // memset(&sg_p2p_mgr->tal_audio_frame, 0, sizeof(sg_p2p_mgr->tal_audio_frame));
+    // sg_p2p_mgr->tal_audio_frame.pbuf = (char*)malloc(bufSize);
+    // sg_p2p_mgr->tal_audio_frame.buf_size = bufSize;
+
+    memset(&sg_p2p_mgr->media_audio_frame, 0, sizeof(sg_p2p_mgr->media_audio_frame));
+    sg_p2p_mgr->media_audio_frame.data = (UCHAR_T *)malloc(bufSize);
+    sg_p2p_mgr->media_audio_frame.size = bufSize;
+
+    memcpy(&sg_p2p_mgr->av_Info, &p_var->av_info, sizeof(TRANS_IPC_AV_INFO_T));
+    sg_p2p_mgr->on_disconnect_callback = p_var->on_disconnect_callback;
+    sg_p2p_mgr->on_get_video_frame_callback = p_var->on_get_video_frame_callback;
+    sg_p2p_mgr->on_get_audio_frame_callback = p_var->on_get_audio_frame_callback;
+
+    // Start media-related threads, each session has its own command thread
     THREAD_CFG_T thrd_param = {STACK_SIZE_P2P_MEDIA_RECV, THREAD_PRIO_2, NULL};
     thrd_param.stackDepth = STACK_SIZE_P2P_CMD_RECV;
     thrd_param.thrdname = (char *)"p2p_cmd_recv";
-    ret = tal_thread_create_and_start(&(sg_p2p_session->cmd_recv_proc_thread), NULL, NULL, __p2p_cmd_recv_proc, NULL,
-                                      &thrd_param);
-    if (ret != OPRT_OK) {
-        PR_ERR("create p2p_cmd_recv task failed");
-        goto RET;
+    for (i = 0; i < session_num; i++) {
+        P2P_SESSION_T *pSession = &sg_p2p_mgr->sessions[i];
+        tal_mutex_create_init(&pSession->cmutex);
+        pSession->index = i;
+        pSession->cur_clarity = TY_VIDEO_CLARITY_INNER_HIGH;
+        ret = tal_thread_create_and_start(&(pSession->cmd_recv_proc_thread), NULL, NULL, __p2p_cmd_recv_proc,
+                                          pSession, &thrd_param);
+        if (ret != OPRT_OK) {
+            PR_ERR("create p2p_cmd_recv task failed");
+            goto RET;
+        }
     }
     thrd_param.stackDepth = STACK_SIZE_P2P_MEDIA_SEND;
     thrd_param.thrdname = (char *)"p2p_media_send";
-    ret = tal_thread_create_and_start(&(sg_p2p_session->video_send_proc_thread), NULL, NULL, __p2p_media_send_proc,
+    ret = tal_thread_create_and_start(&(sg_p2p_mgr->video_send_proc_thread), NULL, NULL, __p2p_media_send_proc,
                                       NULL, &thrd_param);
     if (ret != OPRT_OK) {
         PR_ERR("create p2p_media_send task failed");
         goto RET;
     }
 
-    // Initialize
-    int bufSize = 300 * 1024; // MAX_MEDIA_FRAME_SIZE
-    // memset(&sg_p2p_session->tal_video_frame, 0, sizeof(sg_p2p_session->tal_video_frame));
-    // sg_p2p_session->tal_video_frame.pbuf = (char*)malloc(bufSize);
-    // sg_p2p_session->tal_video_frame.buf_size = bufSize;
-
-    memset(&sg_p2p_session->media_frame, 0, sizeof(sg_p2p_session->media_frame));
-    sg_p2p_session->media_frame.data = (UCHAR_T *)malloc(bufSize);
-    sg_p2p_session->media_frame.size = bufSize;
-
-    bufSize = 1280;
-    // memset(&sg_p2p_session->tal_audio_frame, 0, sizeof(sg_p2p_session->tal_audio_frame));
-    // sg_p2p_session->tal_audio_frame.pbuf = (char*)malloc(bufSize);
-    // sg_p2p_session->tal_audio_frame.buf_size = bufSize;
-
-    memset(&sg_p2p_session->media_audio_frame, 0, sizeof(sg_p2p_session->media_audio_frame));
-    sg_p2p_session->media_audio_frame.data = (UCHAR_T *)malloc(bufSize);
-    sg_p2p_session->media_audio_frame.size = bufSize;
-
-    memcpy(&sg_p2p_session->av_Info, &p_var->av_info, sizeof(TRANS_IPC_AV_INFO_T));
-    sg_p2p_session->on_disconnect_callback = p_var->on_disconnect_callback;
-    sg_p2p_session->on_get_video_frame_callback = p_var->on_get_video_frame_callback;
-    sg_p2p_session->on_get_audio_frame_callback = p_var->on_get_audio_frame_callback;
-
     return OPRT_OK;
 
 RET:
-    if (NULL != sg_p2p_session->p_video_rtp_buff) {
-        p2p_release_video_send_resource(sg_p2p_session);
+    for (i = 0; i < session_num; i++) {
+        __p2p_thread_exit(sg_p2p_mgr->sessions[i].cmd_recv_proc_thread);
     }
-    if (NULL != sg_p2p_session->p_audio_rtp_buff) {
-        p2p_release_audio_send_resource(sg_p2p_session);
-    }
-    __p2p_thread_exit(sg_p2p_session->cmd_recv_proc_thread);
     return ret;
 }
 
@@ -1695,30 +1868,193 @@ OPERATE_RET tuya_imm_p2p_album_play_send_finish(IN CONST CHAR_T *dev_id, IN CONS
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void *rtp_alloc(void *param, int bytes)
 {
-    int nBufferSize = bytes;
-    unsigned char *pBuffer = (unsigned char *)malloc(nBufferSize);
-    memset(pBuffer, 0, nBufferSize);
-    return pBuffer;
+    // the packet is built in its fan-out list node, every viewer sends it from there
+    P2P_RTP_PKT_T *pkt = (P2P_RTP_PKT_T *)Malloc(sizeof(P2P_RTP_PKT_T) + bytes);
+    if (NULL == pkt) {
+        return NULL;
+    }
+    memset(pkt, 0, sizeof(P2P_RTP_PKT_T));
+    return pkt->data;
 }
 
 void rtp_free(void *param, void *packet)
 {
-    free(packet);
-    packet = NULL;
+    P2P_RTP_PKT_T *pkt = P2P_RTP_PKT_OF(packet);
+
+    if (!pkt->queued) {
+        Free(pkt);
+    }
     return;
 }
 
 int rtp_pack_packet_handler(void *param, const void *packet, int bytes, uint32_t timestamp, int flags)
 {
-    //return 0;
-    CHAR_T *buf = (CHAR_T *)packet;
-    INT_T len = bytes;
-    RTP_PACK_NAL_ARG_T *nal_arg = (RTP_PACK_NAL_ARG_T *)param;
-    memcpy(nal_arg->p_rtp_buff, nal_arg->ext_head_buff, nal_arg->fix_len);
-    *(INT_T *)&nal_arg->p_rtp_buff[nal_arg->fix_len - 4] = len;
-    memcpy(nal_arg->p_rtp_buff + nal_arg->fix_len, buf, len);
-    return p2p_send_rtp_data(nal_arg->client, nal_arg->channel, nal_arg->p_rtp_buff, len + nal_arg->fix_len);
+    P2P_FANOUT_T *fo = (P2P_FANOUT_T *)param;
+    P2P_RTP_PKT_T *pkt = P2P_RTP_PKT_OF(packet);
+
+    pkt->type = fo->type;
+    pkt->key = fo->key;
+    pkt->start = fo->start;
+    pkt->time_ms = fo->time_ms;
+    pkt->len = bytes;
+    fo->start = FALSE;
+    __p2p_fanout_publish(fo, pkt);
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef ENABLE_P2P_FANOUT_LOOPBACK
+#define P2P_LOOP_FRAME (8 * 1024) // p frame size, a key frame is 4 times larger
+#define P2P_LOOP_GOP   (25)
+
+typedef struct {
+    INT_T credit;    // bytes the simulated channel takes this round
+    UINT_T bytes;    // bytes received
+    BOOL_T need_key; // the next video packet must start a key frame
+    UINT_T dropped;  // viewer drops seen so far
+    USHORT_T seq;    // rtp sequence number of the last video packet
+    UINT_T errors;
+} P2P_LOOP_VIEWER_T;
+
+STATIC P2P_LOOP_VIEWER_T sg_loop_viewer[P2P_SESSION_MAX];
+
+STATIC INT_T __p2p_loop_free_size(P2P_SESSION_T *pSession, INT_T channel)
+{
+    return sg_loop_viewer[pSession->index].credit;
+}
+
+STATIC INT_T __p2p_loop_send(P2P_SESSION_T *pSession, INT_T channel, CHAR_T *buff, INT_T len)
+{
+    P2P_LOOP_VIEWER_T *sim = &sg_loop_viewer[pSession->index];
+    P2P_RTP_PKT_T *pkt = pSession->viewer.cursor; // the viewer advances after the send
+    USHORT_T seq = ((BYTE_T)pkt->data[2] << 8) | (BYTE_T)pkt->data[3];
+
+    if (pSession->viewer.dropped != sim->dropped) {
+        sim->dropped = pSession->viewer.dropped;
+        sim->need_key = TRUE;
+    }
+    if (sim->need_key) {
+        if (!(pkt->key && pkt->start)) {
+            PR_ERR("viewer[%d] resumes without a key frame", pSession->index);
+            sim->errors++;
+        }
+        sim->need_key = FALSE;
+    } else if ((USHORT_T)(sim->seq + 1) != seq) {
+        PR_ERR("viewer[%d] gap %u -> %u without a drop", pSession->index, sim->seq, seq);
+        sim->errors++;
+    }
+    sim->seq = seq;
+    sim->credit -= P2P_KCP_SEG_SIZE;
+    sim->bytes += len;
+    return len;
+}
+
+STATIC CONST P2P_VIEWER_IO_T sg_p2p_loop_io = {
+    .free_size = __p2p_loop_free_size,
+    .send = __p2p_loop_send,
+};
+
+OPERATE_RET tuya_p2p_rtc_fanout_loopback(UINT_T viewers, UINT_T frames)
+{
+    OPERATE_RET ret = OPRT_OK;
+    UINT_T i, f, size;
+    UINT_T errors = 0;
+    BOOL_T key = FALSE;
+    CHAR_T *frame = NULL;
+    P2P_FANOUT_T *fo = NULL;
+    P2P_SESSION_T *pSession = NULL;
+
+    if (NULL != sg_p2p_mgr) {
+        PR_ERR("p2p is running, loopback is only available before p2p_init");
+        return OPRT_COM_ERROR;
+    }
+    if (0 == viewers || viewers > P2P_SESSION_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+
+    sg_p2p_mgr = (P2P_MGR_T *)Malloc(sizeof(P2P_MGR_T) + viewers * sizeof(P2P_SESSION_T));
+    if (NULL == sg_p2p_mgr) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memset(sg_p2p_mgr, 0, sizeof(P2P_MGR_T) + viewers * sizeof(P2P_SESSION_T));
+    sg_p2p_mgr->sessions = (P2P_SESSION_T *)(sg_p2p_mgr + 1);
+    sg_p2p_mgr->session_num = viewers;
+    fo = &sg_p2p_mgr->fanout;
+    frame = (CHAR_T *)Malloc(4 * P2P_LOOP_FRAME);
+    if (NULL == frame) {
+        ret = OPRT_MALLOC_FAILED;
+        goto EXIT;
+    }
+    memset(sg_loop_viewer, 0, sizeof(sg_loop_viewer));
+
+    // viewer 0 takes everything, every next one drains half as fast as the previous
+    for (i = 0; i < viewers; i++) {
+        pSession = &sg_p2p_mgr->sessions[i];
+        pSession->index = i;
+        pSession->session = i;
+        pSession->status = P2P_SESSION_RUNNING;
+        pSession->cmd = P2P_VIDEO;
+        __p2p_fanout_attach(fo, &pSession->viewer, 0);
+        sg_loop_viewer[i].need_key = TRUE;
+    }
+
+    for (f = 0; f < frames; f++) {
+        key = (0 == f % P2P_LOOP_GOP);
+        size = key ? 4 * P2P_LOOP_FRAME : P2P_LOOP_FRAME;
+        memset(frame, (BYTE_T)f | 0x80, size);
+        frame[0] = 0;
+        frame[1] = 0;
+        frame[2] = 0;
+        frame[3] = 1;
+        frame[4] = key ? 0x65 : 0x41; // idr / non idr slice
+        __p2p_fanout_frame(fo, 0, key, f * 40);
+        ret = __p2p_pack_h264_rtp(frame, size, f * 3600);
+        if (OPRT_OK != ret) {
+            goto EXIT;
+        }
+
+        for (i = 0; i < viewers; i++) {
+            sg_loop_viewer[i].credit = (0 == i) ? 0x7fffffff : (16 * P2P_KCP_SEG_SIZE) >> i;
+            __p2p_fanout_flush(fo, &sg_p2p_mgr->sessions[i], &sg_p2p_loop_io);
+        }
+    }
+
+    for (i = 0; i < viewers; i++) {
+        pSession = &sg_p2p_mgr->sessions[i];
+        PR_NOTICE("viewer[%u] sent[%u] bytes[%u] dropped[%u] backlog[%u] errors[%u]", i, pSession->viewer.sent,
+                  sg_loop_viewer[i].bytes, pSession->viewer.dropped, pSession->viewer.backlog,
+                  sg_loop_viewer[i].errors);
+        errors += sg_loop_viewer[i].errors;
+        __p2p_fanout_detach(fo, &pSession->viewer);
+    }
+    if (fo->head || fo->bytes) {
+        PR_ERR("fan-out list not empty after detach, bytes[%u]", fo->bytes);
+        errors++;
+    }
+    if (0 != sg_p2p_mgr->sessions[0].viewer.dropped) {
+        PR_ERR("the unthrottled viewer dropped packets");
+        errors++;
+    }
+    ret = errors ? OPRT_COM_ERROR : OPRT_OK;
+
+EXIT:
+    for (i = 0; i < viewers; i++) {
+        if (sg_p2p_mgr->sessions[i].viewer.attached) {
+            __p2p_fanout_detach(fo, &sg_p2p_mgr->sessions[i].viewer);
+        }
+    }
+    if (sg_p2p_mgr->video_rtp.encoder) {
+        rtp_payload_encode_destroy(sg_p2p_mgr->video_rtp.encoder);
+    }
+    Free(sg_p2p_mgr);
+    sg_p2p_mgr = NULL;
+    if (frame) {
+        Free(frame);
+    }
+    return ret;
 }
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 